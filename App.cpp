@@ -140,6 +140,7 @@ void App::Run()
                 m_main->Update();
                 if (m_main->Draw3D())
                     m_deviceResources->Present();
+                m_main->EndFrame();
             }
 		}
 		else
@@ -0,0 +1,148 @@
+﻿#include "pch.h"
+#include "AssetArchive.h"
+#include <compressapi.h>
+
+#pragma comment(lib, "cabinet.lib")
+
+using namespace DX;
+
+namespace
+{
+    struct DecompressorHandle
+    {
+        DecompressorHandle() : m_handle(nullptr) {}
+        ~DecompressorHandle() { if (m_handle) CloseDecompressor(m_handle); }
+        DECOMPRESSOR_HANDLE m_handle;
+    };
+}
+
+AssetArchive::AssetArchive()
+    : m_toc(nullptr), m_names(nullptr), m_count(0)
+    , m_hits(0), m_misses(0), m_decompressed(0), m_bytesMapped(0), m_bytesDecompressed(0)
+{
+}
+
+bool AssetArchive::Open(const std::wstring& path)
+{
+    using namespace AssetPak;
+    Close();
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(path))
+        return false;
+
+    const Header* header = file->GetArray<Header>(0, 1);
+    if (!header || header->m_magic != MAGIC || header->m_version != VERSION || header->m_fileSize != file->GetSize())
+        return false;
+    const Entry* toc = file->GetArray<Entry>(header->m_tocOffset, header->m_entryCount);
+    const wchar_t* names = file->GetArray<wchar_t>(header->m_namesOffset, header->m_namesCount);
+    if (!toc || (!names && header->m_namesCount))
+        return false;
+    const uint32_t alignment = header->m_alignment;
+    if (!alignment || (alignment & (alignment - 1)) || alignment > MAX_ALIGNMENT)
+        return false;
+
+    // sorted by hash, names and aligned payloads inside the file
+    for (uint32_t i = 0; i < header->m_entryCount; ++i)
+    {
+        const Entry& e = toc[i];
+        if (i > 0 && toc[i - 1].m_hash > e.m_hash)
+            return false;
+        if ((uint64_t)e.m_nameOffset + e.m_nameLength > header->m_namesCount)
+            return false;
+        if (e.m_offset % alignment || !file->GetArray<uint8_t>(e.m_offset, e.m_storedSize))
+            return false;
+        if (e.m_compression == COMPRESSION_NONE ? e.m_storedSize != e.m_size : e.m_compression != COMPRESSION_XPRESS_HUFF)
+            return false;
+        if (e.m_size > SIZE_MAX)
+            return false;
+    }
+
+    m_file = file;
+    m_toc = toc;
+    m_names = names;
+    m_count = header->m_entryCount;
+    return true;
+}
+
+void AssetArchive::Close()
+{
+    // blobs handed out keep their own reference to the mapping
+    m_file.reset();
+    m_toc = nullptr;
+    m_names = nullptr;
+    m_count = 0;
+}
+
+const AssetPak::Entry* AssetArchive::Find(const std::wstring& name) const
+{
+    if (!m_toc)
+        return nullptr;
+    const std::wstring key = AssetPak::NormalizeName(name);
+    const uint64_t hash = AssetPak::HashName(key.c_str(), key.size());
+    auto it = std::lower_bound(m_toc, m_toc + m_count, hash,
+        [](const AssetPak::Entry& e, uint64_t h) { return e.m_hash < h; });
+    for (; it != m_toc + m_count && it->m_hash == hash; ++it)
+    {
+        if (it->m_nameLength == key.size() && wmemcmp(m_names + it->m_nameOffset, key.c_str(), key.size()) == 0)
+            return it;
+    }
+    return nullptr;
+}
+
+AssetArchive::Blob AssetArchive::Get(const std::wstring& name) const
+{
+    Blob blob;
+    const AssetPak::Entry* e = Find(name);
+    if (!e)
+    {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return blob;
+    }
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+
+    const uint8_t* stored = m_file->GetData() + e->m_offset;
+    if (e->m_compression == AssetPak::COMPRESSION_NONE)
+    {
+        blob.m_data = stored;
+        blob.m_size = (size_t)e->m_size;
+        blob.m_owner = m_file;
+        m_bytesMapped.fetch_add(e->m_size, std::memory_order_relaxed);
+        return blob;
+    }
+
+    DecompressorHandle decompressor;
+    if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, nullptr, &decompressor.m_handle))
+        return blob;
+    auto data = std::make_shared<std::vector<uint8_t>>((size_t)e->m_size);
+    SIZE_T written = 0;
+    if (!Decompress(decompressor.m_handle, stored, (SIZE_T)e->m_storedSize, data->data(), data->size(), &written) || written != data->size())
+    {
+        OutputDebugStringW((L"AssetArchive: corrupt entry " + name + L"\n").c_str());
+        return blob;
+    }
+    blob.m_data = data->data();
+    blob.m_size = data->size();
+    blob.m_owner = data;
+    m_decompressed.fetch_add(1, std::memory_order_relaxed);
+    m_bytesDecompressed.fetch_add(e->m_size, std::memory_order_relaxed);
+    return blob;
+}
+
+std::wstring AssetArchive::GetEntryName(uint32_t index) const
+{
+    if (index >= m_count)
+        return std::wstring();
+    return std::wstring(m_names + m_toc[index].m_nameOffset, m_toc[index].m_nameLength);
+}
+
+AssetArchive::Stats AssetArchive::GetStats() const
+{
+    // each counter is read on its own, a snapshot taken during Gets may be off by those
+    Stats s;
+    s.m_hits = m_hits.load(std::memory_order_relaxed);
+    s.m_misses = m_misses.load(std::memory_order_relaxed);
+    s.m_decompressed = m_decompressed.load(std::memory_order_relaxed);
+    s.m_bytesMapped = m_bytesMapped.load(std::memory_order_relaxed);
+    s.m_bytesDecompressed = m_bytesDecompressed.load(std::memory_order_relaxed);
+    return s;
+}
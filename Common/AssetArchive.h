@@ -0,0 +1,63 @@
+﻿#pragma once
+#include "MappedFile.h"
+#include "AssetArchiveFormat.h"
+
+namespace DX
+{
+    //* ***************************************************************** *//
+    //* AssetArchive
+    //* Read only .pak archive (see AssetArchiveFormat.h) mapped in memory.
+    //* Stored entries are handed out as spans into the mapping, compressed
+    //* ones are decompressed on every Get. Safe to use from several threads
+    //* ***************************************************************** *//
+    class AssetArchive
+    {
+    public:
+        // m_data stays valid while m_owner (the mapping or the decompressed copy) is alive
+        struct Blob
+        {
+            Blob() : m_data(nullptr), m_size(0) {}
+            explicit operator bool() const { return m_data != nullptr; }
+
+            const uint8_t* m_data;
+            size_t m_size;
+            std::shared_ptr<const void> m_owner;
+        };
+
+        struct Stats
+        {
+            uint32_t m_hits;
+            uint32_t m_misses;
+            uint32_t m_decompressed;
+            uint64_t m_bytesMapped;         // handed out without a copy
+            uint64_t m_bytesDecompressed;
+        };
+
+        AssetArchive();
+        AssetArchive(const AssetArchive&) = delete;
+        AssetArchive& operator=(const AssetArchive&) = delete;
+
+        // false when missing or not a valid archive, every offset is checked here once
+        bool Open(const std::wstring& path);
+        void Close();
+        bool IsOpen() const { return m_toc != nullptr; }
+
+        bool Contains(const std::wstring& name) const { return Find(name) != nullptr; }
+        Blob Get(const std::wstring& name) const; // empty when missing or it fails to decompress
+
+        uint32_t GetEntryCount() const { return m_count; }
+        std::wstring GetEntryName(uint32_t index) const;
+        Stats GetStats() const;
+
+    private:
+        const AssetPak::Entry* Find(const std::wstring& name) const;
+
+        std::shared_ptr<MappedFile> m_file;
+        const AssetPak::Entry* m_toc;
+        const wchar_t* m_names;
+        uint32_t m_count;
+        // Get is const and runs on several threads
+        mutable std::atomic<uint32_t> m_hits, m_misses, m_decompressed;
+        mutable std::atomic<uint64_t> m_bytesMapped, m_bytesDecompressed;
+    };
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <wctype.h>
+#include <string>
+
+namespace DX
+{
+    //* ***************************************************************** *//
+    //* AssetPak
+    //* On disk layout of the .pak asset archive, shared by the game and the
+    //* AssetPack tool: header, table of contents sorted by name hash, names
+    //* (UTF-16, not terminated) and the payloads, each one aligned
+    //* ***************************************************************** *//
+    namespace AssetPak
+    {
+        const uint32_t MAGIC = 'KAPS';                  // "SPAK"
+        const uint32_t VERSION = 1;
+        const uint32_t DEFAULT_ALIGNMENT = 16;
+        const uint32_t MAX_ALIGNMENT = 64 * 1024;
+
+        enum Compression : uint16_t
+        {
+            COMPRESSION_NONE = 0,
+            COMPRESSION_XPRESS_HUFF,                    // Windows compression API, buffer mode
+        };
+
+#pragma pack(push,1)
+        struct Header
+        {
+            uint32_t m_magic;
+            uint32_t m_version;
+            uint32_t m_entryCount;
+            uint32_t m_alignment;
+            uint64_t m_tocOffset;
+            uint64_t m_namesOffset;
+            uint64_t m_namesCount;                      // wchar_t
+            uint64_t m_fileSize;
+        };
+
+        struct Entry
+        {
+            uint64_t m_hash;                            // HashName of the normalized name
+            uint64_t m_offset;                          // from the start of the file, aligned
+            uint64_t m_storedSize;
+            uint64_t m_size;                            // once decompressed
+            uint32_t m_nameOffset;                      // wchar_t into the names
+            uint16_t m_nameLength;
+            uint16_t m_compression;
+        };
+#pragma pack(pop)
+
+        static_assert(sizeof(Header) == 48, "structure size mismatch");
+        static_assert(sizeof(Entry) == 40, "structure size mismatch");
+
+        // Names are matched lower case, with '\' separators and without a leading ".\"
+        inline std::wstring NormalizeName(const std::wstring& name)
+        {
+            std::wstring out;
+            out.reserve(name.size());
+            size_t i = 0;
+            while (i + 1 < name.size() && name[i] == L'.' && (name[i + 1] == L'\\' || name[i + 1] == L'/'))
+                i += 2;
+            for (; i < name.size(); ++i)
+            {
+                const wchar_t c = name[i];
+                out.push_back(c == L'/' ? L'\\' : (wchar_t)towlower(c));
+            }
+            return out;
+        }
+
+        // FNV-1a over the UTF-16 code units of a normalized name
+        inline uint64_t HashName(const wchar_t* name, size_t length)
+        {
+            uint64_t h = 14695981039346656037ULL;
+            for (size_t i = 0; i < length; ++i)
+            {
+                h ^= (uint16_t)name[i];
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+    }
+}
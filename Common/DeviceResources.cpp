@@ -4,6 +4,8 @@
 #include "Content/ShaderStructures.h"
 #include "Content/GlobalFlags.h"
 #include "Content/CameraFirstPerson.h"
+#include "Content/LevelPregeneration.h"
+#include "Content/XAudioSoundVoiceBackend.h"
 
 using namespace D2D1;
 using namespace DirectX;
@@ -759,55 +761,6 @@ DXGI_MODE_ROTATION DX::DeviceResources::ComputeDisplayRotation()
 	return rotation;
 }
 
-//////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////
-#pragma region RandomProvider
-void DX::RandomProvider::SetSeed(uint32_t seed)
-{
-    if (!m_gen || m_lastSeed != seed)
-        m_gen = std::make_unique<std::mt19937>(seed);
-    m_lastSeed = seed;
-}
-
-uint32_t DX::RandomProvider::Get(uint32_t minN, uint32_t maxN)
-{
-    // slow?
-    if (!m_gen)
-        SetSeed(RANDOM_DEFAULT_SEED);
-    return std::uniform_int_distribution<uint32_t>(minN, maxN)(*m_gen);
-}
-
-float DX::RandomProvider::GetF(float minN, float maxN)
-{
-    if (!m_gen)
-        SetSeed(RANDOM_DEFAULT_SEED);
-    if (minN > maxN) std::swap(minN, maxN);
-    return std::uniform_real_distribution<float>(minN, maxN)(*m_gen);
-}
-
-uint32_t DX::RandomProvider::Get01(float p)
-{
-    if (!m_gen)
-        SetSeed(RANDOM_DEFAULT_SEED);
-    return std::bernoulli_distribution(p)(*m_gen);
-}
-
-uint32_t DX::RandomProvider::GetWithDensity(const uint32_t* func, int count)
-{
-    const uint32_t prob = Get(0, 99);
-    uint32_t a = 0, i = 0;
-    for (i = 0; i < (uint32_t)count; ++i)
-    {
-        if (prob >= a && prob < func[i])
-            return i;
-        a = func[i];
-    }    
-    if (i >= (uint32_t)count)
-        throw std::exception("Out of range of prob. density function for room profiles");
-    return 0xffffffff;
-}
-#pragma endregion
-
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
@@ -899,12 +852,25 @@ float DX::GameResources::SoundGetDefaultPitch(uint32_t index) { return g_sndPitc
 DX::GameResources* DX::GameResources::instance = nullptr;
 DX::GameResources::GameResources(const std::shared_ptr<DX::DeviceResources>& device)
     : m_readyToRender(false), m_levelTime(0.0f), m_sprite(device), m_entityMgr(device)
-    , m_map(device), m_flashScreenTime(0.0f), m_flashColor(1,1,1,1)
+    , m_map(device), m_mapAudioRooms(m_map), m_flashScreenTime(0.0f), m_flashColor(1,1,1,1)
     , m_invincibleTime(-1.0f), m_curDensityMult(0.45f), m_curRoomIndex(-1)
     , m_bossIsReady(false), m_inMenu(true), m_deathMessage(0), m_bossDefeated(false)
+    , m_levelSeed(0), m_nextLevelSeed(0), m_nextMapPending(false), m_pregenerateLevels(true), m_levelSwapUs(0)
+    , m_frameHeapAllocations(0)
+    , m_useVoicePool(true)
 {   
     GameResources::instance = this;
-    // vertex shader and input layout
+    ZeroMemory(&m_frameArenaStats, sizeof(m_frameArenaStats));
+    SeedRandomStreams(RANDOM_DEFAULT_SEED);
+
+    // one mapping for every asset when the archive was packed (AssetPack), loose files otherwise
+    m_archive = std::make_shared<DX::AssetArchive>();
+    if (!m_archive->Open(L"assets\\assets.pak"))
+        m_archive.reset();
+    m_sprite.SetArchive(m_archive);
+    auto asset = [this](const wchar_t* name) { return m_archive ? m_archive->Get(name) : DX::AssetArchive::Blob(); };
+
+    // vertex shader and input layout; shaders are built with the game, after AssetPack ran, so they stay loose
     auto loadVSTask = DX::ReadDataAsync(L"BaseVertexShader.cso");
     auto loadPSTask = DX::ReadDataAsync(L"BasePixelShader.cso");
     auto loadSpriteVS = DX::ReadDataAsync(L"ScreenSpriteVS.cso");
@@ -912,7 +878,11 @@ DX::GameResources::GameResources(const std::shared_ptr<DX::DeviceResources>& dev
     auto loadPostPS = DX::ReadDataAsync(L"PostPS.cso");
 
     m_sprites = std::make_unique<SpriteBatch>(device->GetD3DDeviceContext());
-    m_fontConsole = std::make_unique<DirectX::SpriteFont>(device->GetD3DDevice(), L"assets\\fonts\\Courier_16.spritefont");
+    const auto font = asset(L"assets\\fonts\\Courier_16.spritefont");
+    if (font)
+        m_fontConsole = std::make_unique<DirectX::SpriteFont>(device->GetD3DDevice(), font.m_data, font.m_size);
+    else
+        m_fontConsole = std::make_unique<DirectX::SpriteFont>(device->GetD3DDevice(), L"assets\\fonts\\Courier_16.spritefont");
     m_commonStates = std::make_unique<DirectX::CommonStates>(device->GetD3DDevice());
     m_batch = std::make_unique<DirectX::PrimitiveBatch<VertexPositionColor>>(device->GetD3DDeviceContext());
     AUDIO_ENGINE_FLAGS aeflags = AudioEngine_Default;
@@ -920,24 +890,49 @@ DX::GameResources::GameResources(const std::shared_ptr<DX::DeviceResources>& dev
     aeflags = aeflags | AudioEngine_Debug;
 #endif
     m_audioEngine = std::make_unique<DirectX::AudioEngine>(aeflags);
-    DX::ThrowIfFailed(
-        DirectX::CreateWICTextureFromFile(
-            device->GetD3DDevice(), L"assets\\textures\\white.png",
-            (ID3D11Resource**)m_textureWhite.ReleaseAndGetAddressOf(),
-            m_textureWhiteSRV.ReleaseAndGetAddressOf()));
+    const auto white = asset(L"assets\\textures\\white.png");
+    if (white)
+    {
+        DX::ThrowIfFailed(
+            DirectX::CreateWICTextureFromMemory(
+                device->GetD3DDevice(), white.m_data, white.m_size,
+                (ID3D11Resource**)m_textureWhite.ReleaseAndGetAddressOf(),
+                m_textureWhiteSRV.ReleaseAndGetAddressOf()));
+    }
+    else
+    {
+        DX::ThrowIfFailed(
+            DirectX::CreateWICTextureFromFile(
+                device->GetD3DDevice(), L"assets\\textures\\white.png",
+                (ID3D11Resource**)m_textureWhite.ReleaseAndGetAddressOf(),
+                m_textureWhiteSRV.ReleaseAndGetAddressOf()));
+    }
 
     // SOUNDS, init values    
+    DX::MemoryTagScope soundTag(DX::MEMTAG_SOUND);
     m_soundEffects.resize(SFX_MAX);
     m_sounds.resize(SFX_MAX);
     for (int i = 0; i < SFX_MAX; ++i)
     {
         //concurrency::create_task([this,i] {
-            m_soundEffects[i] = std::move(std::make_unique<SoundEffect>(m_audioEngine.get(), g_sndNames[i]));
+            // archived waves play in place from the mapping
+            const auto wav = asset(g_sndNames[i]);
+            if (wav)
+                m_soundEffects[i] = std::make_unique<SoundEffect>(m_audioEngine.get(), wav.m_data, wav.m_size, wav.m_owner);
+            else
+                m_soundEffects[i] = std::move(std::make_unique<SoundEffect>(m_audioEngine.get(), g_sndNames[i]));
             m_sounds[i] = std::move(m_soundEffects[i]->CreateInstance());
             m_sounds[i]->SetVolume(g_sndVolumes[i]);
             m_sounds[i]->SetPitch(g_sndPitches[i]);
         //});
+        m_soundVolumes[i] = g_sndVolumes[i];
+        m_soundPitches[i] = g_sndPitches[i];
     }
+    std::vector<SoundEffect*> effects;
+    for (const auto& e : m_soundEffects)
+        effects.push_back(e.get());
+    m_voices.Initialize(std::make_unique<SpookyAdulthood::XAudioSoundVoiceBackend>(effects, SFX_VOICES), SFX_VOICES);
+    m_voices.SetRooms(&m_mapAudioRooms);
 
     // BASE VS constant buffer
     {
@@ -1005,6 +1000,7 @@ DX::GameResources::GameResources(const std::shared_ptr<DX::DeviceResources>& dev
 
 DX::GameResources::~GameResources()
 {
+    DiscardNextLevel();
     m_readyToRender = false;
     m_textureWhiteSRV.Reset();
     m_textureWhite.Reset();
@@ -1020,12 +1016,14 @@ DX::GameResources::~GameResources()
     m_fontConsole.reset();
     m_commonStates.reset();
     m_batch.reset();
+    m_voices.Shutdown();
     m_audioEngine.reset();
     m_sprite.ReleaseDeviceDependentResources();
 }
 
 void DX::GameResources::Update(const DX::StepTimer& timer, const CameraFirstPerson& camera)
 {
+    DX_PROFILE_SCOPE("GameResources::Update");
     if (!m_readyToRender)
         return;
 
@@ -1052,6 +1050,7 @@ void DX::GameResources::Update(const DX::StepTimer& timer, const CameraFirstPers
     {
         if (!audio->IsCriticalError())
             audio->Update();
+        m_voices.Update(stepTime, m_camera.GetPosition(), m_camera.m_forward);
 
         // Update player audio
         if (m_camera.m_moving)
@@ -1081,9 +1080,14 @@ void DX::GameResources::FlashScreen(float time, const XMFLOAT4& color)
     }
 }
 
-void DX::GameResources::SoundPlay(uint32_t index, bool loop) const
+void DX::GameResources::SoundPlay(uint32_t index, bool loop, SpookyAdulthood::SoundPriority prio)
 {
     if (index >= m_sounds.size()) return;
+    if (!loop && m_useVoicePool)
+    {
+        m_voices.Play(index, m_soundVolumes[index], m_soundPitches[index], prio);
+        return;
+    }
     auto s = m_sounds[index].get();
     if (!s) return;
     if (s->GetState() == DirectX::PLAYING )
@@ -1091,31 +1095,49 @@ void DX::GameResources::SoundPlay(uint32_t index, bool loop) const
     s->Play(loop);
 }
 
-void DX::GameResources::SoundAllStop() const
+uint32_t DX::GameResources::SoundPlayAt(uint32_t index, const XMFLOAT3& pos, float maxdist, SpookyAdulthood::SoundPriority prio)
+{
+    if (index >= m_sounds.size()) return SpookyAdulthood::SoundVoicePool::INVALID_VOICE;
+    if (!m_useVoicePool)
+    {
+        // shared instance, attenuated once at start
+        auto plPos = m_camera.GetPosition();
+        const float dist = sqrt((pos.x - plPos.x)*(pos.x - plPos.x) + (pos.z - plPos.z)*(pos.z - plPos.z));
+        SoundPlay(index, false);
+        m_sounds[index]->SetVolume(SoundGetDefaultVolume(index) * (1.0f - std::min(1.0f, dist / maxdist)));
+        return SpookyAdulthood::SoundVoicePool::INVALID_VOICE;
+    }
+    return m_voices.PlayAt(index, pos, maxdist, m_soundVolumes[index], m_soundPitches[index], prio);
+}
+
+void DX::GameResources::SoundAllStop()
 {
     for (uint32_t i = 0; i < SFX_MAX; ++i)
         SoundStop(i);
 }
 
-void DX::GameResources::SoundStop(uint32_t index) const
+void DX::GameResources::SoundStop(uint32_t index)
 {
     if (index >= m_sounds.size()) return;
+    m_voices.StopSound(index);
     auto s = m_sounds[index].get();
     if (!s) return;
     s->Stop();
 }
 
-void DX::GameResources::SoundPause(uint32_t index) const
+void DX::GameResources::SoundPause(uint32_t index)
 {
     if (index >= m_sounds.size()) return;
+    m_voices.PauseSound(index);
     auto s = m_sounds[index].get();
     if (!s) return;
     s->Pause();
 }
 
-void DX::GameResources::SoundResume(uint32_t index) const
+void DX::GameResources::SoundResume(uint32_t index)
 {
     if (index >= m_sounds.size()) return;
+    m_voices.ResumeSound(index);
     auto s = m_sounds[index].get();
     if (!s) return;
     switch (s->GetState())
@@ -1138,6 +1160,8 @@ void DX::GameResources::SoundPitch(uint32_t index, float p)
     if (!s) return;
     if (p < -1.0f)
         p = g_sndPitches[index];
+    m_soundPitches[index] = p;
+    m_voices.SetSoundPitch(index, p);
     s->SetPitch(p);
 }
 
@@ -1148,6 +1172,8 @@ void DX::GameResources::SoundVolume(uint32_t index, float v)
     if (!s) return;
     if (v < .0f)
         v = g_sndVolumes[index];
+    m_soundVolumes[index] = v;
+    m_voices.SetSoundVolume(index, v);
     s->SetVolume(v);
 }
 
@@ -1181,7 +1207,8 @@ bool DX::GameResources::PlayerShoot()
     auto startpos = m_camera.GetPosition();
     // compute all rays for shotgun (this is so ugly and expensive)
     const float A = 0.0f; // aperture angle shoot
-#define Rr (m_random.GetF(0.0f,0.2f))
+    auto& rnd = Random(RANDOM_PLAYER);
+#define Rr (rnd.GetF(0.0f,0.2f))
     const XMMATRIX rotations[7] = { // buh, we have memory enough!
         XMMatrixMultiply(XMMatrixRotationX(-A-Rr), XMMatrixRotationY(A+Rr)),
         XMMatrixMultiply(XMMatrixRotationX(-A-Rr),XMMatrixRotationY(-A-Rr)),
@@ -1222,7 +1249,7 @@ bool DX::GameResources::PlayerShoot()
         else if (wasHitM)
         {
             // hit only against map
-            hitM.y = m_camera.m_height - m_camera.m_pitchYaw.x + m_random.GetF(-0.15f, 0.15f);
+            hitM.y = m_camera.m_height - m_camera.m_pitchYaw.x + rnd.GetF(-0.15f, 0.15f);
             m_entityMgr.AddEntity(std::make_shared<EntityShootHit>(hitM));
         }
     }
@@ -1305,13 +1332,49 @@ void DX::GameResources::OnLeaveRoom(int roomLeaving)
 }
 
 
+void DX::GameResources::SeedRandomStreams(uint32_t levelSeed)
+{
+    // every stream only depends on the level seed, so one uint32 identifies the whole level
+    m_levelSeed = levelSeed;
+    const RandomProvider level(levelSeed);
+    for (uint32_t i = 0; i < RANDOM_STREAM_MAX; ++i)
+        m_randomStreams[i] = level.Split(i);
+}
+
 void DX::GameResources::GenerateNewLevel(bool forMenu)
 {
     m_bossDefeated = false;
     m_mapSettings.m_tileCount = XMUINT2(35, 35);
     m_mapSettings.m_minTileCount = XMUINT2(4, 4);
     m_mapSettings.m_maxTileCount = XMUINT2(15, 15);
-    m_map.Generate(m_mapSettings);
+    m_mapSettings.m_generateThumbTex = false; // built once below, whatever path made the map
+    m_levelSwapUs = time_call_us([&]
+    {
+        // built while the last level was played, at most we wait for the rest of it; a worker
+        // that failed half way is replaced by the same seed on demand
+        const bool pending = m_nextMapPending;
+        m_nextMapPending = false;
+        const uint32_t levelSeed = FinishNextLevel(pending, m_nextLevelSeed,
+            [&]
+            {
+                try { m_nextMapTask.wait(); }
+                catch (...) { m_nextMap.reset(); throw; }
+            },
+            [&] { m_map.Swap(*m_nextMap); },
+            [&](uint32_t seed)
+            {
+                m_map.Generate(m_mapSettings, seed);
+                m_map.CreateDeviceDependentResources();
+            },
+            [&]
+            {
+                // same seed sequence than PregenerateNextLevel
+                m_random.SetSeed(m_mapSettings.m_randomSeed);
+                return m_random.Next();
+            });
+        SeedRandomStreams(levelSeed);
+    });
+    m_levelTime = 0.0f;
     m_map.GenerateThumbTex(m_mapSettings.m_tileCount);
     SoundAllStop();
     m_inMenu = forMenu;
@@ -1338,6 +1401,43 @@ void DX::GameResources::GenerateNewLevel(bool forMenu)
         m_entityMgr.AddEntity(std::make_shared<EntityGun>(), EntityManager::ALL_ROOMS); // GUN
         m_entityMgr.AddEntity(std::make_shared<EntityCheckBossReady>(), EntityManager::ALL_ROOMS); // Is boss ready?
     }
+
+    PregenerateNextLevel();
+}
+
+void DX::GameResources::PregenerateNextLevel()
+{
+    if (!m_pregenerateLevels || m_nextMapPending)
+        return;
+
+    // same seed sequence than generating on demand
+    m_random.SetSeed(m_mapSettings.m_randomSeed);
+    m_nextLevelSeed = m_random.Next();
+    if (!m_nextMap)
+        m_nextMap = std::make_unique<LevelMap>(m_map.GetDevice());
+
+    // the worker only touches m_nextMap (it also frees the previous level swapped into it)
+    auto map = m_nextMap.get();
+    const auto settings = m_mapSettings;
+    const uint32_t seed = m_nextLevelSeed;
+    m_nextMapPending = true;
+    m_nextMapTask = concurrency::create_task([map, settings, seed]()
+    {
+        map->Generate(settings, seed);
+        map->CreateDeviceDependentResources().wait();
+    });
+}
+
+void DX::GameResources::DiscardNextLevel()
+{
+    // its buffers belong to the device it was built on, the next level is made on demand instead
+    if (m_nextMapPending)
+    {
+        m_nextMapPending = false;
+        try { m_nextMapTask.wait(); }
+        catch (...) {}
+    }
+    m_nextMap.reset();
 }
 
 void DX::GameResources::SpawnPlayer()
@@ -1364,7 +1464,7 @@ void DX::GameResources::BossIsReady()
     SoundPlay(SFX_LAUGH, false);
     // get the biggest room
     auto& biggestRoom = m_map.GetBiggestRoom();
-    const XMFLOAT3 pos = biggestRoom->GetRandomXZWithClearance();
+    const XMFLOAT3 pos = biggestRoom->GetRandomXZWithClearance(&Random(RANDOM_SPAWN));
     m_entityMgr.AddEntity(std::make_shared<EnemyBoss>(pos), biggestRoom->m_leafNdx);
     m_entityMgr.AddEntity(std::make_shared<EntityRandomSound>(SFX_PIANO, 5.0f, 30.0f,false,true), biggestRoom->m_leafNdx);
 }
@@ -1372,23 +1472,28 @@ void DX::GameResources::BossIsReady()
 void DX::GameResources::SetPause(bool p)
 {
     m_entityMgr.SetPause(p);
+    if (p)
+        m_voices.PauseAll();
+    else
+        m_voices.ResumeAll();
 }
 
 void DX::GameResources::ConsiderSpawnItem(const XMFLOAT3& pos, float p)
 {
     const float life = m_camera.m_life;
     const int bullets = m_camera.m_bullets;
-    if (m_random.Get01(p))
+    auto& rnd = Random(RANDOM_PLAYER);
+    if (rnd.Get01(p))
     {
-        if (m_random.Get01(0.5f))
+        if (rnd.Get01(0.5f))
         {
             // life
-            m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_LIFE, pos, m_random.GetF(0.15f,0.8f)));
+            m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_LIFE, pos, rnd.GetF(0.15f,0.8f)));
         }
         else
         {
             // bullets
-            m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_CANDY, pos, (float)m_random.Get(5, 20)));
+            m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_CANDY, pos, (float)rnd.Get(5, 20)));
         }
     }
 }
@@ -1404,13 +1509,14 @@ void DX::GameResources::GoBackMenu()
 
 void DX::GameResources::CreateAmmoRandomly()
 {
+    auto& rnd = Random(RANDOM_PLAYER);
     // for all finished rooms
     for (auto& r : m_map.GetRooms())
     {
         if (r->m_finished)
         {
-            auto p = r->GetRandomXZWithClearance();
-            m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_CANDY, p, (float)m_random.Get(15, 30)), r->m_leafNdx);
+            auto p = r->GetRandomXZWithClearance(&rnd);
+            m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_CANDY, p, (float)rnd.Get(15, 30)), r->m_leafNdx);
         }
     }
 
@@ -1418,8 +1524,8 @@ void DX::GameResources::CreateAmmoRandomly()
     auto& r = m_map.GetLeafAtIndex(m_curRoomIndex);
     for (int i = 0; i < 2; ++i)
     {
-        auto p = r->GetRandomXZWithClearance();
-        m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_CANDY, p, (float)m_random.Get(15, 30)), r->m_leafNdx);
+        auto p = r->GetRandomXZWithClearance(&rnd);
+        m_entityMgr.AddEntity(std::make_shared<EntityItem>(ITEM_CANDY, p, (float)rnd.Get(15, 30)), r->m_leafNdx);
     }
     
 }
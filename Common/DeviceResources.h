@@ -1,9 +1,11 @@
 ﻿#pragma once
-#include <random>
 #include "Content/Sprite.h"
 #include "Content/Entity.h"
 #include "Content/LevelMap.h"
 #include "Content/CameraFirstPerson.h"
+#include "Content/SoundVoicePool.h"
+#include "Common/AssetArchive.h"
+#include "Common/RandomProvider.h"
 
 namespace DX
 {
@@ -17,26 +19,6 @@ namespace DX
     class DeviceResources;
 
 
-    //* ***************************************************************** *//
-    //* RandomProvider
-    //* ***************************************************************** *//
-    class RandomProvider
-    {
-    public:
-        RandomProvider() :m_lastSeed(0) {}
-
-        void SetSeed(uint32_t seed);
-        uint32_t Get(uint32_t minN, uint32_t maxN);
-        uint32_t Get01(float p=0.5f);
-        float GetF(float minN, float maxN);
-        uint32_t GetWithDensity(const uint32_t* func, int count);
-
-    protected:
-        std::unique_ptr<std::mt19937> m_gen;
-        uint32_t m_lastSeed, m_seed;
-    };
-
-
     //* ***************************************************************** *//
     //* Global GAME dx/misc resources
     //* ***************************************************************** *//
@@ -70,6 +52,7 @@ namespace DX
             SFX_EMPTY = 23,
             SFX_MAX
         };
+        enum { SFX_VOICES = 24 }; // simultaneous one-shots
         GameResources(const std::shared_ptr<DX::DeviceResources>& device);
         ~GameResources();
 
@@ -83,6 +66,7 @@ namespace DX
         Microsoft::WRL::ComPtr<ID3D11PixelShader>	m_spritePS;
         Microsoft::WRL::ComPtr<ID3D11PixelShader>	m_postPS;
 
+        std::shared_ptr<DX::AssetArchive>           m_archive; // assets\assets.pak, null when running from loose files
         std::unique_ptr<DirectX::SpriteBatch>       m_sprites;
         SpookyAdulthood::SpriteManager              m_sprite;
         SpookyAdulthood::EntityManager              m_entityMgr;
@@ -95,9 +79,24 @@ namespace DX
         std::unique_ptr<DirectX::AudioEngine>       m_audioEngine;
         SpookyAdulthood::LevelMapGenerationSettings m_mapSettings;
         SpookyAdulthood::LevelMap                   m_map;
+        SpookyAdulthood::LevelMapAudioRooms         m_mapAudioRooms; // m_map for the voice pool occlusion
+        std::unique_ptr<SpookyAdulthood::LevelMap>  m_nextMap; // pre-generated in the background, swapped in GenerateNewLevel
+        concurrency::task<void>                     m_nextMapTask;
         concurrency::concurrent_vector<std::unique_ptr<DirectX::SoundEffect>> m_soundEffects;
-        concurrency::concurrent_vector<std::unique_ptr<DirectX::SoundEffectInstance>> m_sounds;
-        RandomProvider m_random;
+        concurrency::concurrent_vector<std::unique_ptr<DirectX::SoundEffectInstance>> m_sounds; // loops and player sounds
+        SpookyAdulthood::SoundVoicePool m_voices; // one-shots, a voice per play
+        float m_soundVolumes[SFX_MAX]; // current per sfx, one-shots start with them
+        float m_soundPitches[SFX_MAX];
+        bool m_useVoicePool; // def 1
+        RandomProvider m_random; // root, only used to pick the seed of every new level
+        RandomProvider m_randomStreams[RANDOM_STREAM_MAX];
+        uint32_t m_levelSeed;
+        uint32_t m_nextLevelSeed;
+        bool m_nextMapPending;
+        bool m_pregenerateLevels; // def 1
+        __int64 m_levelSwapUs; // cost of the last GenerateNewLevel map step (swap or full generation)
+        uint32_t m_frameHeapAllocations; // main thread operator new calls during the last frame
+        DX::FrameArena::Stats m_frameArenaStats; // main thread frame arena, last frame
         SpookyAdulthood::CameraFirstPerson  m_camera;
 
         float m_levelTime;
@@ -113,11 +112,12 @@ namespace DX
         bool m_inMenu;
         bool m_bossDefeated;
 
-        void SoundPlay(uint32_t index, bool loop=true)const;
-        void SoundAllStop()const;
-        void SoundStop(uint32_t index)const;
-        void SoundPause(uint32_t index)const;
-        void SoundResume(uint32_t index)const ;
+        void SoundPlay(uint32_t index, bool loop=true, SpookyAdulthood::SoundPriority prio=SpookyAdulthood::SOUND_PRIO_HIGH);
+        uint32_t SoundPlayAt(uint32_t index, const XMFLOAT3& pos, float maxdist, SpookyAdulthood::SoundPriority prio=SpookyAdulthood::SOUND_PRIO_NORMAL);
+        void SoundAllStop();
+        void SoundStop(uint32_t index);
+        void SoundPause(uint32_t index);
+        void SoundResume(uint32_t index);
         void SoundPitch(uint32_t index, float p);
         void SoundVolume(uint32_t index, float v);
         float SoundGetDefaultVolume(uint32_t index);
@@ -141,6 +141,11 @@ namespace DX
         void UpdateHeartVolumeAndPitch();
         void GoBackMenu();
         void CreateAmmoRandomly();
+        void SeedRandomStreams(uint32_t levelSeed);
+        void PregenerateNextLevel();
+        void DiscardNextLevel();
+        inline RandomProvider& Random(RandomStream s) { return m_randomStreams[s]; }
+        inline RandomProvider RandomForRoom(RandomStream s, int roomIndex) const { return m_randomStreams[s].Split((uint32_t)roomIndex); }
 
         static GameResources* instance; // added later in the project for simplicity on interfaces (will burn in hell I know)
 
@@ -0,0 +1,83 @@
+﻿#include "pch.h"
+#include "FrameAllocator.h"
+#include "MemoryTracker.h"
+
+using namespace DX;
+
+std::atomic<uint32_t> FrameArena::s_frame(0);
+std::atomic<uint32_t> FrameArena::s_totalBlocks(0);
+
+FrameArena& FrameArena::Get()
+{
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+void FrameArena::EndFrame()
+{
+    const uint32_t frame = s_frame.fetch_add(1, std::memory_order_relaxed) + 1;
+    // the caller's arena starts the new frame now, so its stats cover whole frames
+    Get().Recycle(frame);
+}
+
+FrameArena::FrameArena()
+    : m_frame(GetFrame())
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void FrameArena::Recycle(uint32_t frame)
+{
+    m_frame = frame;
+    Region& region = m_regions[frame % Buffering];
+    region.m_block = 0;
+    region.m_offset = 0;
+    m_stats.m_allocations = 0;
+    m_stats.m_bytes = 0;
+}
+
+void FrameArena::AddBlock(Region& region, size_t minSize)
+{
+    MemoryTagScope tag(MEMTAG_FRAMEARENA);
+    Block block;
+    block.m_size = minSize > BlockSize ? minSize : BlockSize;
+    block.m_data.reset(new uint8_t[block.m_size]);
+    m_stats.m_capacity += block.m_size;
+    region.m_blocks.push_back(std::move(block));
+    ++m_stats.m_blocks;
+    s_totalBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    const uint32_t frame = GetFrame();
+    if (frame != m_frame)
+        Recycle(frame);
+
+    Region& region = m_regions[m_frame % Buffering];
+    for (;;)
+    {
+        if (region.m_block < region.m_blocks.size())
+        {
+            const Block& block = region.m_blocks[region.m_block];
+            const uintptr_t base = (uintptr_t)block.m_data.get();
+            const uintptr_t p = (base + region.m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+            if (p - base <= block.m_size && size <= block.m_size - (p - base))
+            {
+                const size_t end = (size_t)(p - base) + size;
+                ++m_stats.m_allocations;
+                m_stats.m_bytes += end - region.m_offset;
+                region.m_offset = end;
+                return (void*)p;
+            }
+            // the rest of this block is wasted until the region is recycled
+            ++region.m_block;
+            region.m_offset = 0;
+            continue;
+        }
+
+        if (size > SIZE_MAX - alignment)
+            throw std::bad_alloc();
+        AddBlock(region, size + alignment);
+    }
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+namespace DX
+{
+    //* ***************************************************************** *//
+    //* FrameArena
+    //* Per thread bump allocator for data that only lives during a frame.
+    //* Each thread owns its arena (no locks), split in Buffering regions:
+    //* what is allocated in frame N stays valid until frame N+Buffering
+    //* starts on that thread. Blocks are kept across frames, so once warm
+    //* a frame does no heap allocation at all
+    //* ***************************************************************** *//
+    class FrameArena
+    {
+    public:
+        static const uint32_t Buffering = 2;
+        static const size_t BlockSize = 64 * 1024;
+
+        struct Stats
+        {
+            uint32_t m_allocations;     // this frame
+            size_t m_bytes;             // this frame, alignment padding included
+            size_t m_capacity;          // all regions
+            uint32_t m_blocks;          // all regions
+        };
+
+        // arena of the calling thread
+        static FrameArena& Get();
+        // called once per frame by the main loop, after presenting. Other threads
+        // recycle their region lazily, on their first allocation of the new frame
+        static void EndFrame();
+        static uint32_t GetFrame() { return s_frame.load(std::memory_order_relaxed); }
+        // total blocks allocated by every arena, growth past the warm up is a heap allocation
+        static uint32_t GetTotalBlocks() { return s_totalBlocks.load(std::memory_order_relaxed); }
+
+        FrameArena();
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        void* Allocate(size_t size, size_t alignment);
+        const Stats& GetStats() const { return m_stats; }
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]> m_data;
+            size_t m_size;
+        };
+
+        struct Region
+        {
+            Region() : m_block(0), m_offset(0) {}
+
+            std::vector<Block> m_blocks;
+            size_t m_block;             // current one
+            size_t m_offset;            // into the current block
+        };
+
+        void Recycle(uint32_t frame);
+        void AddBlock(Region& region, size_t minSize);
+
+        Region m_regions[Buffering];
+        uint32_t m_frame;
+        Stats m_stats;
+
+        static std::atomic<uint32_t> s_frame;
+        static std::atomic<uint32_t> s_totalBlocks;
+    };
+
+    //* ***************************************************************** *//
+    //* FrameAllocator
+    //* STL allocator on top of the FrameArena of the thread that built the
+    //* container. deallocate does nothing, the memory goes away with the
+    //* frame, so a container must not be used past Buffering frames and
+    //* must not be grown from other threads. Reassign it with a fresh one
+    //* (v = FrameVector<T>()) every frame instead of clear()
+    //* ***************************************************************** *//
+    template<typename T>
+    class FrameAllocator
+    {
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        template<typename U> struct rebind { typedef FrameAllocator<U> other; };
+
+        FrameAllocator() : m_arena(&FrameArena::Get()) {}
+        template<typename U> FrameAllocator(const FrameAllocator<U>& other) : m_arena(other.m_arena) {}
+
+        T* allocate(size_t n)
+        {
+            if (n > SIZE_MAX / sizeof(T))
+                throw std::bad_alloc();
+            return static_cast<T*>(m_arena->Allocate(n * sizeof(T), __alignof(T)));
+        }
+        void deallocate(T*, size_t) {}
+
+        template<typename U> bool operator==(const FrameAllocator<U>& other) const { return m_arena == other.m_arena; }
+        template<typename U> bool operator!=(const FrameAllocator<U>& other) const { return m_arena != other.m_arena; }
+
+    private:
+        template<typename U> friend class FrameAllocator;
+        FrameArena* m_arena;
+    };
+
+    template<typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+namespace DX
+{
+    //* ***************************************************************** *//
+    //* MappedFile
+    //* Read only memory mapped file, the view lives as long as the object
+    //* ***************************************************************** *//
+    class MappedFile
+    {
+    public:
+        MappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_data(nullptr), m_size(0) {}
+        ~MappedFile() { Close(); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const std::wstring& path)
+        {
+            Close();
+            m_file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0 || (uint64_t)size.QuadPart > SIZE_MAX)
+            {
+                Close();
+                return false;
+            }
+            m_mapping = CreateFileMappingFromApp(m_file, nullptr, PAGE_READONLY, 0, nullptr);
+            if (m_mapping)
+                m_data = (const uint8_t*)MapViewOfFileFromApp(m_mapping, FILE_MAP_READ, 0, 0);
+            if (!m_data)
+            {
+                Close();
+                return false;
+            }
+            m_size = (size_t)size.QuadPart;
+            return true;
+        }
+
+        void Close()
+        {
+            if (m_data) UnmapViewOfFile(m_data);
+            if (m_mapping) CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+            m_mapping = nullptr;
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        const uint8_t* GetData() const { return m_data; }
+        size_t GetSize() const { return m_size; }
+
+        // typed view of count elements at offset, nullptr when out of the file
+        template<typename T>
+        const T* GetArray(uint64_t offset, uint64_t count) const
+        {
+            if (!m_data || offset > m_size || count > (m_size - offset) / sizeof(T))
+                return nullptr;
+            return reinterpret_cast<const T*>(m_data + offset);
+        }
+
+    private:
+        HANDLE m_file;
+        HANDLE m_mapping;
+        const uint8_t* m_data;
+        size_t m_size;
+    };
+
+    // Writes a buffer to a file, overwriting it
+    inline bool WriteFileData(const std::wstring& path, const void* data, size_t size)
+    {
+        HANDLE file = CreateFile2(path.c_str(), GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        const uint8_t* ptr = (const uint8_t*)data;
+        bool ok = true;
+        while (ok && size)
+        {
+            DWORD written = 0;
+            const DWORD chunk = (DWORD)(std::min)(size, (size_t)0x40000000);
+            ok = WriteFile(file, ptr, chunk, &written, nullptr) && written == chunk;
+            ptr += written;
+            size -= written;
+        }
+        CloseHandle(file);
+        return ok;
+    }
+}
@@ -0,0 +1,160 @@
+﻿#pragma once
+#include <math.h>
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+//* ***************************************************************** *//
+//* Math helpers
+//* Scalar XMFLOAT2/XMFLOAT3 helpers the whole game uses, through pch.h.
+//* Only DirectXMath, so the device independent sources that use them
+//* also build for the tests under Tests/
+//* ***************************************************************** *//
+
+template<typename T, typename R, typename K>
+inline T Clamp(const T& v, const R& _min, const K& _max)
+{
+    return v < _min ? _min : (v>_max?_max:v);
+}
+
+inline XMFLOAT3 XM3Sub(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+inline void XM3Sub_inplace(XMFLOAT3& a, const XMFLOAT3& b)
+{
+    a.x -= b.x;
+    a.y -= b.y;
+    a.z -= b.z;
+}
+
+inline XMFLOAT3 XM3Mul(const XMFLOAT3& a, float s)
+{
+    return XMFLOAT3(a.x*s, a.y*s, a.z*s);
+}
+
+inline void XM3Mul_inplace(XMFLOAT3& a, float s)
+{
+    a.x *= s; a.y *= s; a.z *= s;
+}
+
+inline float XM3LenSq(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    const float xyz[3] = { a.x - b.x, a.y - b.y, a.z - b.z };
+    return xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2];
+}
+
+inline float XM3LenSq(const XMFLOAT3& a)
+{
+    return a.x*a.x + a.y*a.y + a.z*a.z;
+}
+
+inline XMFLOAT3 XM3Add(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+inline void XM3Add_inplace(XMFLOAT3& a, const XMFLOAT3& b)
+{
+    a.x += b.x; a.y += b.y; a.z += b.z;
+}
+
+inline float XM3Len(const XMFLOAT3& a)
+{
+    return sqrt(XM3LenSq(a));
+}
+
+inline void XM3Normalize_inplace(XMFLOAT3& a)
+{
+    const float il = 1.0f / XM3Len(a);
+    a.x *= il;
+    a.y *= il;
+    a.z *= il;
+}
+
+inline XMFLOAT3 XM3Normalize(const XMFLOAT3& a)
+{
+    XMFLOAT3 _a = a;
+    XM3Normalize_inplace(_a);
+    return _a;
+}
+
+// ret a + b*c
+inline XMFLOAT3 XM3Mad(const XMFLOAT3& a, const XMFLOAT3& b, float c)
+{
+    return XMFLOAT3(a.x + b.x*c, a.y + b.y*c, a.z + b.z*c);
+}
+
+inline void XM3Mad_inplace(XMFLOAT3& a, const XMFLOAT3& b, float c)
+{
+    a.x += b.x*c; a.y += b.y*c; a.z += b.z*c;
+}
+
+inline XMFLOAT3 XM3Neg(const XMFLOAT3& a)
+{
+    return XMFLOAT3(-a.x, -a.y, -a.z);
+}
+
+inline XMFLOAT3 XM3Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    XMVECTOR v1 = XMLoadFloat3(&a);
+    XMVECTOR v2 = XMLoadFloat3(&b);
+    XMFLOAT3 r;
+    XMStoreFloat3(&r, XMVector3Cross(v1, v2));
+    return r;
+}
+
+inline float XM3Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+inline bool operator ==(const DirectX::XMUINT2& a, const DirectX::XMUINT2& b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+inline bool XM3Eq(const XMFLOAT3& a, const XMFLOAT3& b, float EPSI=0.0001f)
+{
+    return fabs(a.x - b.x) < EPSI && fabs(a.y - b.y) < EPSI && fabs(a.z - b.z) < EPSI;
+}
+
+inline bool XM2Eq(const XMFLOAT2& a, const XMFLOAT2& b, float EPSI = 0.0001f)
+{
+    return fabs(a.x - b.x) < EPSI && fabs(a.y - b.y) < EPSI;
+}
+
+inline XMFLOAT2 XM2Neg(const XMFLOAT2& a)
+{
+    return XMFLOAT2(-a.x, -a.y);
+}
+
+inline const XMFLOAT3& XM3Zero()
+{
+    static XMFLOAT3 g_zero(0, 0, 0);
+    return g_zero;
+}
+
+inline const XMFLOAT3& XM3Up()
+{
+    static XMFLOAT3 g_up(0, 1, 0);
+    return g_up;
+}
+
+inline const XMFLOAT4& XM4Zero()
+{
+    static XMFLOAT4 g_zero(0, 0, 0, 0);
+    return g_zero;
+}
+
+inline XMFLOAT2 XM2Mul(const XMFLOAT2& v, float s)
+{
+    return XMFLOAT2(v.x*s, v.y*s);
+}
+
+inline void XM2Mul_inplace(XMFLOAT2& v, float s)
+{
+    v.x *= s;
+    v.y *= s;
+}
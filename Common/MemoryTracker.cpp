@@ -0,0 +1,179 @@
+﻿#include "pch.h"
+#include "MemoryTracker.h"
+#if defined(_MSC_VER)
+#include <new.h>
+#else
+#include <new>
+#endif
+#if DX_MEMORY_TRACKING
+#include <crtdbg.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    // trivially initialized, so usable from operator new before any constructor runs
+    thread_local uint64_t t_heapAllocations = 0;
+    thread_local uint32_t t_tag = MEMTAG_UNTAGGED;
+
+#if DX_MEMORY_TRACKING
+    // zero initialized, no constructor to wait for either
+    struct TagCounters
+    {
+        std::atomic<int64_t> m_liveBytes;
+        std::atomic<int64_t> m_liveAllocations;
+        std::atomic<int64_t> m_peakBytes;
+        std::atomic<uint64_t> m_allocations;
+    };
+    TagCounters g_tags[MEMTAG_COUNT];
+
+    void TrackAlloc(uint32_t tag, size_t size)
+    {
+        TagCounters& c = g_tags[tag];
+        const int64_t live = c.m_liveBytes.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+        c.m_liveAllocations.fetch_add(1, std::memory_order_relaxed);
+        c.m_allocations.fetch_add(1, std::memory_order_relaxed);
+        int64_t peak = c.m_peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.m_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void TrackFree(uint32_t tag, size_t size)
+    {
+        TagCounters& c = g_tags[tag];
+        c.m_liveBytes.fetch_sub((int64_t)size, std::memory_order_relaxed);
+        c.m_liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    }
+#endif
+
+    void* HeapAllocate(size_t size)
+    {
+        ++t_heapAllocations;
+        if (!size)
+            size = 1;
+        for (;;)
+        {
+#if DX_MEMORY_TRACKING
+            const uint32_t tag = t_tag;
+            if (void* p = _malloc_dbg(size, _CLIENT_BLOCK | (tag << 16), nullptr, 0))
+            {
+                TrackAlloc(tag, size);
+                return p;
+            }
+#else
+            if (void* p = malloc(size))
+                return p;
+#endif
+#if defined(_MSC_VER)
+            if (_callnewh(size) == 0)
+                throw std::bad_alloc();
+#else
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+#endif
+        }
+    }
+
+    void HeapFree(void* p)
+    {
+        if (!p)
+            return;
+#if DX_MEMORY_TRACKING
+        const int blockType = _CrtReportBlockType(p);
+        if (_BLOCK_TYPE(blockType) == _CLIENT_BLOCK && _BLOCK_SUBTYPE(blockType) < MEMTAG_COUNT)
+        {
+            TrackFree(_BLOCK_SUBTYPE(blockType), _msize_dbg(p, _CLIENT_BLOCK));
+            _free_dbg(p, _CLIENT_BLOCK);
+            return;
+        }
+        // not ours (another module's operator new)
+        _free_dbg(p, _UNKNOWN_BLOCK);
+#else
+        free(p);
+#endif
+    }
+}
+
+//* ***************************************************************** *//
+//* Replacement global operator new/delete. Same CRT heap as the default
+//* ones, plus a per thread counter so a test can check a steady frame
+//* does not touch the heap, and the tag accounting in debug builds
+//* ***************************************************************** *//
+void* __cdecl operator new(size_t size)
+{
+    return HeapAllocate(size);
+}
+
+void* __cdecl operator new[](size_t size)
+{
+    return HeapAllocate(size);
+}
+
+void __cdecl operator delete(void* p) noexcept
+{
+    HeapFree(p);
+}
+
+void __cdecl operator delete(void* p, size_t) noexcept
+{
+    HeapFree(p);
+}
+
+void __cdecl operator delete[](void* p) noexcept
+{
+    HeapFree(p);
+}
+
+void __cdecl operator delete[](void* p, size_t) noexcept
+{
+    HeapFree(p);
+}
+
+uint64_t DX::GetThreadHeapAllocations()
+{
+    return t_heapAllocations;
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag)
+    : m_prevTag((MemoryTag)t_tag)
+{
+    t_tag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+    t_tag = m_prevTag;
+}
+
+const char* MemoryTracker::GetTagName(MemoryTag tag)
+{
+    static const char* s_names[MEMTAG_COUNT] = { "Untagged", "LevelMap", "Entities", "Sprites", "Sound", "FrameArena" };
+    return tag < MEMTAG_COUNT ? s_names[tag] : "?";
+}
+
+void MemoryTracker::GetSnapshot(MemorySnapshot& out)
+{
+    memset(&out, 0, sizeof(out));
+#if DX_MEMORY_TRACKING
+    out.m_tracking = true;
+    for (uint32_t i = 0; i < MEMTAG_COUNT; ++i)
+    {
+        out.m_tags[i].m_liveBytes = g_tags[i].m_liveBytes.load(std::memory_order_relaxed);
+        out.m_tags[i].m_liveAllocations = g_tags[i].m_liveAllocations.load(std::memory_order_relaxed);
+        out.m_tags[i].m_peakBytes = g_tags[i].m_peakBytes.load(std::memory_order_relaxed);
+        out.m_tags[i].m_allocations = g_tags[i].m_allocations.load(std::memory_order_relaxed);
+    }
+#endif
+}
+
+void MemoryTracker::ResetPeaks()
+{
+#if DX_MEMORY_TRACKING
+    for (auto& c : g_tags)
+        c.m_peakBytes.store(c.m_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+#endif
+}
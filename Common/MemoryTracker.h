@@ -0,0 +1,97 @@
+﻿#pragma once
+
+// Tagged heap accounting, on top of the debug CRT heap so only in MSVC debug builds.
+// Define DX_MEMORY_TRACKING=0 to turn it off there
+#if !defined(DX_MEMORY_TRACKING)
+#if defined(_DEBUG) && defined(_MSC_VER)
+#define DX_MEMORY_TRACKING 1
+#else
+#define DX_MEMORY_TRACKING 0
+#endif
+#endif
+
+namespace DX
+{
+    // what the memory is for, set per thread with MemoryTagScope or per container with TaggedAllocator
+    enum MemoryTag : uint32_t
+    {
+        MEMTAG_UNTAGGED = 0,
+        MEMTAG_LEVELMAP,        // BSP nodes, segments, pillars, portals, thumb texture
+        MEMTAG_ENTITIES,        // entities and the room collections
+        MEMTAG_SPRITES,         // sprites, animations and their instances
+        MEMTAG_SOUND,           // sound effects, wave data, voices
+        MEMTAG_FRAMEARENA,      // FrameArena blocks
+        MEMTAG_COUNT
+    };
+
+    struct MemoryTagStats
+    {
+        int64_t m_liveBytes;
+        int64_t m_liveAllocations;
+        int64_t m_peakBytes;            // high-water mark of m_liveBytes
+        uint64_t m_allocations;         // since start
+    };
+
+    struct MemorySnapshot
+    {
+        MemoryTagStats m_tags[MEMTAG_COUNT];
+        bool m_tracking;                // false when compiled out, everything is 0 then
+    };
+
+    //* ***************************************************************** *//
+    //* MemoryTracker
+    //* The replacement global operator new (MemoryTracker.cpp) tags every
+    //* block with the calling thread's tag. Blocks from the debug CRT heap
+    //* carry the tag as their client block subtype, so delete finds it
+    //* without a header, and blocks allocated by other modules (the CRT
+    //* DLLs) are freed untouched. Counters are atomics, any thread
+    //* ***************************************************************** *//
+    class MemoryTracker
+    {
+    public:
+        static const char* GetTagName(MemoryTag tag);
+        static void GetSnapshot(MemorySnapshot& out);
+        // high-water marks restart from the current live bytes
+        static void ResetPeaks();
+    };
+
+    class MemoryTagScope
+    {
+    public:
+        explicit MemoryTagScope(MemoryTag tag);
+        ~MemoryTagScope();
+        MemoryTagScope(const MemoryTagScope&) = delete;
+        MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+    private:
+        MemoryTag m_prevTag;
+    };
+
+    // STL allocator whose blocks are always tagged Tag, whatever scope the container grows in
+    template<typename T, MemoryTag Tag>
+    class TaggedAllocator
+    {
+    public:
+        typedef T value_type;
+
+        template<typename U> struct rebind { typedef TaggedAllocator<U, Tag> other; };
+
+        TaggedAllocator() {}
+        template<typename U> TaggedAllocator(const TaggedAllocator<U, Tag>&) {}
+
+        T* allocate(size_t n)
+        {
+            if (n > SIZE_MAX / sizeof(T))
+                throw std::bad_alloc();
+            MemoryTagScope tag(Tag);
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        void deallocate(T* p, size_t) { ::operator delete(p); }
+
+        template<typename U> bool operator==(const TaggedAllocator<U, Tag>&) const { return true; }
+        template<typename U> bool operator!=(const TaggedAllocator<U, Tag>&) const { return false; }
+    };
+
+    // operator new calls made by the calling thread since it started (all builds)
+    uint64_t GetThreadHeapAllocations();
+}
@@ -0,0 +1,283 @@
+﻿#include "pch.h"
+#include "Profiler.h"
+#include "DirectXHelper.h"
+
+#if DX_PROFILER
+
+#include <mutex>
+
+using namespace DX;
+
+namespace
+{
+    struct ThreadRing
+    {
+        explicit ThreadRing(uint32_t threadId)
+            : m_threadId(threadId), m_head(0), m_read(0), m_events(new Profiler::Event[Profiler::RingSize]) {}
+
+        uint32_t m_threadId;
+        std::atomic<uint32_t> m_head;   // events written, by the owner thread only (wraps)
+        uint32_t m_read;                // drained up to here by EndFrame
+        std::unique_ptr<Profiler::Event[]> m_events;
+    };
+
+    struct SiteWindow
+    {
+        SiteWindow() : m_next(0), m_filled(0), m_calls(0) {}
+
+        uint64_t m_ticks[Profiler::StatsWindow];
+        uint32_t m_next;
+        uint32_t m_filled;
+        uint32_t m_calls;               // since the last refresh
+    };
+
+    struct ProfilerState
+    {
+        ProfilerState() : m_frames(0)
+        {
+            LARGE_INTEGER t;
+            QueryPerformanceFrequency(&t);
+            m_qpcFrequency = (uint64_t)t.QuadPart;
+            QueryPerformanceCounter(&t);
+            m_qpcStart = (uint64_t)t.QuadPart;
+            m_ticksStart = Profiler::Now();
+        }
+
+        // registration (first use of a site or a thread) and the readers, never the markers
+        std::mutex m_lock;
+        std::vector<const ProfileSite*> m_sites;
+        std::vector<std::unique_ptr<ThreadRing>> m_rings;
+
+        // main thread only
+        std::vector<SiteWindow> m_windows;
+        std::vector<Profiler::ScopeStats> m_stats;
+        std::vector<Profiler::Event> m_events;      // scratch, kept to not allocate every frame
+        std::vector<const ProfileSite*> m_sitesCopy;
+        std::vector<uint32_t> m_order;              // site of every m_stats entry
+        uint32_t m_frames;              // since the last refresh
+
+        uint64_t m_qpcFrequency, m_qpcStart, m_ticksStart;
+    };
+
+    ProfilerState& State()
+    {
+        static ProfilerState state;
+        return state;
+    }
+
+    thread_local ThreadRing* t_ring = nullptr;
+    thread_local uint16_t t_site = Profiler::NoParent;
+    thread_local uint16_t t_depth = 0;
+
+    ThreadRing& Ring()
+    {
+        if (!t_ring)
+        {
+            auto& state = State();
+            std::lock_guard<std::mutex> lock(state.m_lock);
+            state.m_rings.emplace_back(new ThreadRing(GetCurrentThreadId()));
+            t_ring = state.m_rings.back().get();
+        }
+        return *t_ring;
+    }
+
+    double TicksPerUs(const ProfilerState& state)
+    {
+#if defined(_M_IX86) || defined(_M_X64)
+        // tsc calibrated against QPC over the whole run
+        LARGE_INTEGER t;
+        QueryPerformanceCounter(&t);
+        const uint64_t ticks = Profiler::Now();
+        const double us = (double)((uint64_t)t.QuadPart - state.m_qpcStart) * 1000000.0 / (double)state.m_qpcFrequency;
+        return us > 0.0 ? (double)(ticks - state.m_ticksStart) / us : 1.0;
+#else
+        return (double)state.m_qpcFrequency / 1000000.0;
+#endif
+    }
+
+    // copies the events of a ring in [from, head) that were not overwritten while copying
+    uint32_t CopyEvents(const ThreadRing& ring, uint32_t from, std::vector<Profiler::Event>& out)
+    {
+        const uint32_t head = ring.m_head.load(std::memory_order_acquire);
+        if (head - from > Profiler::RingSize)
+            from = head - Profiler::RingSize;
+        const size_t first = out.size();
+        for (uint32_t i = from; i != head; ++i)
+            out.push_back(ring.m_events[i & (Profiler::RingSize - 1)]);
+
+        // the owner may have lapped us during the copy, drop what it overwrote
+        const uint32_t after = ring.m_head.load(std::memory_order_acquire);
+        if (after - from > Profiler::RingSize)
+        {
+            const uint32_t lost = std::min(after - from - Profiler::RingSize, head - from);
+            out.erase(out.begin() + first, out.begin() + first + lost);
+        }
+        return head;
+    }
+
+    void AddSiteTree(const std::vector<const ProfileSite*>& sites, uint16_t parent, uint32_t depth,
+        std::vector<Profiler::ScopeStats>& stats, std::vector<uint32_t>& order)
+    {
+        // parents are always registered before their children
+        for (size_t i = parent == Profiler::NoParent ? 0 : parent + 1; i < sites.size(); ++i)
+        {
+            if (sites[i]->m_parent != parent)
+                continue;
+            Profiler::ScopeStats s = {};
+            s.m_name = sites[i]->m_name;
+            s.m_depth = depth;
+            order.push_back((uint32_t)i);
+            stats.push_back(s);
+            AddSiteTree(sites, (uint16_t)i, depth + 1, stats, order);
+        }
+    }
+
+    // a JSON string: quotes and backslashes escaped, control characters as \u00XX
+    void WriteJsonString(FILE* f, const char* s)
+    {
+        fputc('"', f);
+        for (; *s; ++s)
+        {
+            const unsigned char c = (unsigned char)*s;
+            if (c == '"' || c == '\\')
+                fprintf(f, "\\%c", c);
+            else if (c < 0x20)
+                fprintf(f, "\\u%04x", c);
+            else
+                fputc(c, f);
+        }
+        fputc('"', f);
+    }
+}
+
+ProfileSite::ProfileSite(const char* name)
+    : m_name(name), m_parent(t_site)
+{
+    auto& state = State();
+    std::lock_guard<std::mutex> lock(state.m_lock);
+    DX::ThrowIfFalse(state.m_sites.size() < Profiler::NoParent);
+    m_id = (uint16_t)state.m_sites.size();
+    state.m_sites.push_back(this);
+}
+
+ProfileScope::ProfileScope(const ProfileSite& site)
+    : m_site(site.m_id), m_prevSite(t_site)
+{
+    t_site = site.m_id;
+    ++t_depth;
+    m_begin = Profiler::Now();
+}
+
+ProfileScope::~ProfileScope()
+{
+    const uint64_t end = Profiler::Now();
+    t_site = m_prevSite;
+    --t_depth;
+
+    ThreadRing& ring = Ring();
+    const uint32_t head = ring.m_head.load(std::memory_order_relaxed);
+    Profiler::Event& e = ring.m_events[head & (Profiler::RingSize - 1)];
+    e.m_begin = m_begin;
+    e.m_end = end;
+    e.m_site = m_site;
+    e.m_depth = t_depth;
+    ring.m_head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::EndFrame()
+{
+    auto& state = State();
+    auto& events = state.m_events;
+    events.clear();
+    {
+        std::lock_guard<std::mutex> lock(state.m_lock);
+        for (auto& ring : state.m_rings)
+            ring->m_read = CopyEvents(*ring, ring->m_read, events);
+        if (state.m_windows.size() < state.m_sites.size())
+            state.m_windows.resize(state.m_sites.size());
+    }
+
+    for (const auto& e : events)
+    {
+        SiteWindow& w = state.m_windows[e.m_site];
+        w.m_ticks[w.m_next] = e.m_end - e.m_begin;
+        w.m_next = (w.m_next + 1) % StatsWindow;
+        if (w.m_filled < StatsWindow)
+            ++w.m_filled;
+        ++w.m_calls;
+    }
+
+    if (++state.m_frames < StatsInterval)
+        return;
+
+    auto& sites = state.m_sitesCopy;
+    {
+        std::lock_guard<std::mutex> lock(state.m_lock);
+        sites.assign(state.m_sites.begin(), state.m_sites.end());
+    }
+    auto& order = state.m_order;
+    order.clear();
+    state.m_stats.clear();
+    AddSiteTree(sites, NoParent, 0, state.m_stats, order);
+
+    const double ticksPerUs = TicksPerUs(state);
+    uint64_t sorted[StatsWindow];
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        SiteWindow& w = state.m_windows[order[i]];
+        ScopeStats& s = state.m_stats[i];
+        s.m_callsPerFrame = (float)w.m_calls / (float)state.m_frames;
+        w.m_calls = 0;
+        if (!w.m_filled)
+            continue;
+
+        std::copy(w.m_ticks, w.m_ticks + w.m_filled, sorted);
+        std::sort(sorted, sorted + w.m_filled);
+        uint64_t total = 0;
+        for (uint32_t k = 0; k < w.m_filled; ++k)
+            total += sorted[k];
+        s.m_meanUs = (float)((double)total / w.m_filled / ticksPerUs);
+        s.m_p50Us = (float)(sorted[(w.m_filled - 1) / 2] / ticksPerUs);
+        s.m_p99Us = (float)(sorted[(w.m_filled - 1) * 99 / 100] / ticksPerUs);
+        s.m_maxUs = (float)(sorted[w.m_filled - 1] / ticksPerUs);
+    }
+    state.m_frames = 0;
+}
+
+const std::vector<Profiler::ScopeStats>& Profiler::GetStats()
+{
+    return State().m_stats;
+}
+
+bool Profiler::ExportChromeTrace(const std::wstring& path)
+{
+    auto& state = State();
+    FILE* f = nullptr;
+    if (_wfopen_s(&f, path.c_str(), L"wt") != 0 || !f)
+        return false;
+
+    const double ticksPerUs = TicksPerUs(state);
+    std::vector<Event> events;
+    std::lock_guard<std::mutex> lock(state.m_lock);
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (auto& ring : state.m_rings)
+    {
+        events.clear();
+        CopyEvents(*ring, 0, events);
+        for (const auto& e : events)
+        {
+            fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+            WriteJsonString(f, state.m_sites[e.m_site]->m_name);
+            fprintf(f, ",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                (double)(e.m_begin - state.m_ticksStart) / ticksPerUs, (double)(e.m_end - e.m_begin) / ticksPerUs, ring->m_threadId);
+            first = false;
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    const bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+#endif
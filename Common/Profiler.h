@@ -0,0 +1,117 @@
+﻿#pragma once
+
+// Scoped CPU markers, only compiled in debug builds. Define DX_PROFILER=1 to force them on
+#if !defined(DX_PROFILER)
+#if defined(_DEBUG)
+#define DX_PROFILER 1
+#else
+#define DX_PROFILER 0
+#endif
+#endif
+
+#if DX_PROFILER
+
+#include <intrin.h>
+
+#define DX_PROFILE_CONCAT_(a, b) a##b
+#define DX_PROFILE_CONCAT(a, b) DX_PROFILE_CONCAT_(a, b)
+// times the rest of the enclosing block, name must be a string literal
+#define DX_PROFILE_SCOPE(name) \
+    static const DX::ProfileSite DX_PROFILE_CONCAT(s_profileSite, __LINE__)(name); \
+    DX::ProfileScope DX_PROFILE_CONCAT(profileScope, __LINE__)(DX_PROFILE_CONCAT(s_profileSite, __LINE__))
+
+namespace DX
+{
+    //* ***************************************************************** *//
+    //* ProfileSite
+    //* A marker location, registered once the first time it runs. Its
+    //* parent is the site that enclosed it then, that gives the tree
+    //* ***************************************************************** *//
+    struct ProfileSite
+    {
+        explicit ProfileSite(const char* name);
+
+        const char* m_name;
+        uint16_t m_id;
+        uint16_t m_parent;
+    };
+
+    //* ***************************************************************** *//
+    //* ProfileScope
+    //* Writes one event (begin, end, site, depth) to the ring of the
+    //* calling thread on destruction. No locks, no allocations
+    //* ***************************************************************** *//
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const ProfileSite& site);
+        ~ProfileScope();
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        uint64_t m_begin;
+        uint16_t m_site;
+        uint16_t m_prevSite;
+    };
+
+    //* ***************************************************************** *//
+    //* Profiler
+    //* Every thread owns a single producer ring of the last RingSize
+    //* events. The main thread drains them once per frame into a window
+    //* of durations per site, the stats (mean, p50, p99, max) come from
+    //* those windows and are refreshed every StatsInterval frames
+    //* ***************************************************************** *//
+    class Profiler
+    {
+    public:
+        static const uint16_t NoParent = 0xffff;
+        static const uint32_t RingSize = 1 << 14;   // events per thread, power of 2
+        static const uint32_t StatsWindow = 256;    // last calls per site
+        static const uint32_t StatsInterval = 30;   // frames
+
+        struct Event
+        {
+            uint64_t m_begin;
+            uint64_t m_end;
+            uint16_t m_site;
+            uint16_t m_depth;
+        };
+
+        struct ScopeStats
+        {
+            const char* m_name;
+            uint32_t m_depth;           // in the site tree
+            float m_callsPerFrame;
+            float m_meanUs;
+            float m_p50Us;
+            float m_p99Us;
+            float m_maxUs;
+        };
+
+        // rdtsc on x86/x64, QPC elsewhere
+        static uint64_t Now()
+        {
+#if defined(_M_IX86) || defined(_M_X64)
+            return __rdtsc();
+#else
+            LARGE_INTEGER t;
+            QueryPerformanceCounter(&t);
+            return (uint64_t)t.QuadPart;
+#endif
+        }
+
+        // main thread, once per frame
+        static void EndFrame();
+        // sites in tree order, every one after its parent
+        static const std::vector<ScopeStats>& GetStats();
+        // the events still in every ring as Chrome trace JSON (chrome://tracing, Perfetto)
+        static bool ExportChromeTrace(const std::wstring& path);
+    };
+}
+
+#else
+
+#define DX_PROFILE_SCOPE(name) ((void)0)
+
+#endif
@@ -0,0 +1,166 @@
+﻿#include "pch.h"
+#include "RandomProvider.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Counter based generator: every value is a pure hash of (key, counter), so a stream is just a
+// 32 bits key and can be split/copied freely, and 4 consecutive values are computed at once in Fill.
+static inline uint32_t RandomMix(uint32_t x)
+{
+    x ^= x >> 16; x *= 0x21f0aaadu;
+    x ^= x >> 15; x *= 0x735a2d97u;
+    x ^= x >> 15;
+    return x;
+}
+
+uint32_t DX::RandomProvider::Hash(uint32_t key, uint32_t counter)
+{
+    // key goes in twice so two streams are not just shifted copies of the same sequence
+    return RandomMix(RandomMix(counter ^ key) + key);
+}
+
+void DX::RandomProvider::SetSeed(uint32_t seed)
+{
+    if (!m_seeded || m_lastSeed != seed)
+    {
+        m_key = Hash(seed, 0x5eed5eed);
+        m_counter = 0;
+    }
+    m_lastSeed = seed;
+    m_seeded = true;
+}
+
+DX::RandomProvider DX::RandomProvider::Split(uint32_t stream) const
+{
+    RandomProvider child;
+    child.m_key = Hash(m_key ^ 0x9e3779b9u, stream);
+    child.m_lastSeed = m_lastSeed;
+    child.m_seeded = true;
+    return child;
+}
+
+uint32_t DX::RandomProvider::Next()
+{
+    if (!m_seeded)
+        SetSeed(DEFAULT_SEED);
+    return Hash(m_key, m_counter++);
+}
+
+uint32_t DX::RandomProvider::Get(uint32_t minN, uint32_t maxN)
+{
+    if (minN > maxN) std::swap(minN, maxN);
+    const uint32_t range = maxN - minN + 1; // 0 when it's the whole 32 bits range
+    const uint32_t x = Next();
+    return range ? minN + (uint32_t)(((uint64_t)x * range) >> 32) : x;
+}
+
+float DX::RandomProvider::GetF(float minN, float maxN)
+{
+    if (minN > maxN) std::swap(minN, maxN);
+    const float scale = (maxN - minN) * (1.0f / 16777216.0f);
+    return minN + (float)(Next() >> 8) * scale;
+}
+
+uint32_t DX::RandomProvider::Get01(float p)
+{
+    return GetF(0.0f, 1.0f) < p ? 1 : 0;
+}
+
+uint32_t DX::RandomProvider::GetWithDensity(const uint32_t* func, int count)
+{
+    const uint32_t prob = Get(0, 99);
+    uint32_t a = 0, i = 0;
+    for (i = 0; i < (uint32_t)count; ++i)
+    {
+        if (prob >= a && prob < func[i])
+            return i;
+        a = func[i];
+    }    
+    if (i >= (uint32_t)count)
+        throw std::out_of_range("Out of range of prob. density function for room profiles");
+    return 0xffffffff;
+}
+
+#if defined(_XM_SSE_INTRINSICS_)
+// SSE2 has no 32 bits mullo, emulated with two 32x32->64 multiplies
+static inline __m128i RandomMulLo(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// high 32 bits of the 32x32 product, same as ((uint64_t)a*b)>>32
+static inline __m128i RandomMulHi(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_srli_epi64(_mm_mul_epu32(a, b), 32);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_or_si128(even, _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0)));
+}
+
+static inline __m128i RandomMix4(__m128i x)
+{
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16)); x = RandomMulLo(x, _mm_set1_epi32(0x21f0aaad));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15)); x = RandomMulLo(x, _mm_set1_epi32(0x735a2d97));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    return x;
+}
+
+// 4 consecutive counters, same values as 4 calls to Next()
+static inline __m128i RandomHash4(__m128i key, __m128i counter)
+{
+    return RandomMix4(_mm_add_epi32(RandomMix4(_mm_xor_si128(counter, key)), key));
+}
+#endif
+
+void DX::RandomProvider::Fill(uint32_t* out, size_t count, uint32_t minN, uint32_t maxN)
+{
+    if (!m_seeded)
+        SetSeed(DEFAULT_SEED);
+    if (minN > maxN) std::swap(minN, maxN);
+    size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+    const uint32_t range = maxN - minN + 1;
+    const __m128i key = _mm_set1_epi32((int)m_key);
+    const __m128i vmin = _mm_set1_epi32((int)minN);
+    const __m128i vrange = _mm_set1_epi32((int)range);
+    const __m128i step = _mm_set1_epi32(4);
+    __m128i counter = _mm_add_epi32(_mm_set1_epi32((int)m_counter), _mm_set_epi32(3, 2, 1, 0));
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i x = RandomHash4(key, counter);
+        if (range)
+            x = _mm_add_epi32(vmin, RandomMulHi(x, vrange));
+        _mm_storeu_si128((__m128i*)(out + i), x);
+        counter = _mm_add_epi32(counter, step);
+    }
+    m_counter += (uint32_t)i;
+#endif
+    for (; i < count; ++i)
+        out[i] = Get(minN, maxN);
+}
+
+void DX::RandomProvider::FillF(float* out, size_t count, float minN, float maxN)
+{
+    if (!m_seeded)
+        SetSeed(DEFAULT_SEED);
+    if (minN > maxN) std::swap(minN, maxN);
+    size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128i key = _mm_set1_epi32((int)m_key);
+    const __m128 vmin = _mm_set1_ps(minN);
+    const __m128 vscale = _mm_set1_ps((maxN - minN) * (1.0f / 16777216.0f));
+    const __m128i step = _mm_set1_epi32(4);
+    __m128i counter = _mm_add_epi32(_mm_set1_epi32((int)m_counter), _mm_set_epi32(3, 2, 1, 0));
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i x = _mm_srli_epi32(RandomHash4(key, counter), 8);
+        _mm_storeu_ps(out + i, _mm_add_ps(vmin, _mm_mul_ps(_mm_cvtepi32_ps(x), vscale)));
+        counter = _mm_add_epi32(counter, step);
+    }
+    m_counter += (uint32_t)i;
+#endif
+    for (; i < count; ++i)
+        out[i] = GetF(minN, maxN);
+}
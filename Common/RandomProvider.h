@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace DX
+{
+    //* ***************************************************************** *//
+    //* RandomProvider
+    //* Counter-based generator: every number is a hash of (key, counter).
+    //* Streams are split by deriving a new key, so they are independent,
+    //* cheap to create and can be generated in batches or in parallel.
+    //* ***************************************************************** *//
+    class RandomProvider
+    {
+    public:
+        static const uint32_t DEFAULT_SEED = 997; // used when drawing from a stream that was never seeded
+
+        RandomProvider() : m_key(0), m_counter(0), m_lastSeed(0), m_seeded(false) {}
+        explicit RandomProvider(uint32_t seed) : m_counter(0), m_lastSeed(seed), m_seeded(true) { m_key = Hash(seed, 0x5eed5eed); }
+
+        void SetSeed(uint32_t seed);
+        RandomProvider Split(uint32_t stream) const; // child stream, only depends on this key (not on the counter)
+        uint32_t Next();
+        uint32_t Get(uint32_t minN, uint32_t maxN);
+        uint32_t Get01(float p=0.5f);
+        float GetF(float minN, float maxN);
+        uint32_t GetWithDensity(const uint32_t* func, int count);
+
+        // bulk versions, same values as calling Get/GetF count times
+        void Fill(uint32_t* out, size_t count, uint32_t minN, uint32_t maxN);
+        void FillF(float* out, size_t count, float minN, float maxN);
+
+        uint32_t GetSeed() const { return m_lastSeed; }
+        uint32_t GetCounter() const { return m_counter; }
+        static uint32_t Hash(uint32_t key, uint32_t counter);
+
+    protected:
+        uint32_t m_key;     // stream identifier
+        uint32_t m_counter; // position in the stream
+        uint32_t m_lastSeed;
+        bool m_seeded;
+    };
+
+    // Named streams, every subsystem draws from its own sequence so consuming 
+    // numbers in one of them does not change what the others generate.
+    enum RandomStream
+    {
+        RANDOM_LEVEL=0,     // bsp, rooms, portals, teleports and room meshes
+        RANDOM_SPAWN,       // entities population (split per room)
+        RANDOM_AI,          // enemies behaviour
+        RANDOM_PLAYER,      // shooting spread, items
+        RANDOM_STREAM_MAX
+    };
+}
@@ -1,14 +1,66 @@
 ﻿#pragma once
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <ostream>
+#if defined(_WIN32)
 #include <wrl.h>
+#endif
 
 namespace DX
 {
-	// Helper class for animation and simulation timing.
-	class StepTimer
+#if defined(_WIN32)
+	// QueryPerformanceCounter, the clock the game runs on.
+	struct QpcClock
+	{
+		QpcClock()
+		{
+			LARGE_INTEGER frequency;
+			if (!QueryPerformanceFrequency(&frequency))
+			{
+				throw ref new Platform::FailureException();
+			}
+			m_frequency = frequency.QuadPart;
+		}
+
+		uint64_t GetFrequency() const { return m_frequency; }
+
+		uint64_t Now() const
+		{
+			LARGE_INTEGER currentTime;
+			if (!QueryPerformanceCounter(&currentTime))
+			{
+				throw ref new Platform::FailureException();
+			}
+			return currentTime.QuadPart;
+		}
+
+		uint64_t m_frequency;
+	};
+#endif
+
+	// std::chrono::steady_clock, portable (tools, tests on other platforms).
+	struct ChronoClock
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		uint64_t GetFrequency() const { return Clock::period::den / Clock::period::num; }
+		uint64_t Now() const { return static_cast<uint64_t>(Clock::now().time_since_epoch().count()); }
+	};
+
+	// Helper class for animation and simulation timing. TClock provides GetFrequency and Now
+	// in its own units, see QpcClock and ChronoClock.
+	// Besides the timing it keeps frame pacing statistics over the last PacingWindow frames:
+	// real frame times, a histogram of them, percentiles, hitches and how many fixed step
+	// updates every frame ran.
+	template<typename TClock>
+	class BasicStepTimer
 	{
 	public:
-		StepTimer() : 
+		BasicStepTimer() : 
 			m_elapsedTicks(0),
 			m_totalTicks(0),
 			m_leftOverTicks(0),
@@ -17,48 +69,107 @@ namespace DX
 			m_framesThisSecond(0),
 			m_qpcSecondCounter(0),
 			m_isFixedTimeStep(false),
-			m_targetElapsedTicks(TicksPerSecond / 60)
+			m_targetElapsedTicks(TicksPerSecond / 60),
+			m_maxUpdatesPerFrame(0),
+			m_droppedTicks(0),
+			m_updatesThisFrame(0),
+			m_pacingFrames(0),
+			m_pacingNext(0),
+			m_hitchTicks(0),
+			m_hitchCount(0),
+			m_catchUpFrames(0)
 		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_qpcFrequency = m_clock.GetFrequency();
+			m_qpcLastTime = m_clock.Now();
 
 			// Initialize max delta to 1/10 of a second.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_qpcMaxDelta = m_qpcFrequency / 10;
+
+			std::fill(m_histogram, m_histogram + HistogramBuckets, 0);
 		}
 
 		// Get elapsed time since the previous Update call.
-		uint64 GetElapsedTicks() const						{ return m_elapsedTicks; }
+		uint64_t GetElapsedTicks() const					{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
 
 		// Get total time since the start of the program.
-		uint64 GetTotalTicks() const						{ return m_totalTicks; }
+		uint64_t GetTotalTicks() const						{ return m_totalTicks; }
 		double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
 		// Get total number of updates since start of the program.
-		uint32 GetFrameCount() const						{ return m_frameCount; }
+		uint32_t GetFrameCount() const						{ return m_frameCount; }
 
 		// Get the current framerate.
-		uint32 GetFramesPerSecond() const					{ return m_framesPerSecond; }
+		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
 
 		// Set whether to use fixed or variable timestep mode.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
 		// Set how often to call Update when in fixed timestep mode.
-		void SetTargetElapsedTicks(uint64 targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
+		void SetTargetElapsedTicks(uint64_t targetElapsed)	{ m_targetElapsedTicks = targetElapsed; }
 		void SetTargetElapsedSeconds(double targetElapsed)	{ m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
 
+		// Fixed timestep mode: at most this many catch-up Updates per Tick, the simulation time
+		// that doesn't fit is dropped (and counted) instead of running later. 0 = no limit.
+		void SetMaxUpdatesPerFrame(uint32_t maxUpdates)		{ m_maxUpdatesPerFrame = maxUpdates; }
+		uint64_t GetDroppedTicks() const					{ return m_droppedTicks; }
+		double GetDroppedSeconds() const					{ return TicksToSeconds(m_droppedTicks); }
+
+		// Updates run by the last Tick (0 when it was too early in fixed timestep mode).
+		uint32_t GetUpdatesThisFrame() const				{ return m_updatesThisFrame; }
+		// Ticks in the window that ran more than one Update.
+		uint32_t GetCatchUpFrames() const					{ return m_catchUpFrames; }
+
 		// Integer format represents time using 10,000,000 ticks per second.
-		static const uint64 TicksPerSecond = 10000000;
+		static const uint64_t TicksPerSecond = 10000000;
 
-		static double TicksToSeconds(uint64 ticks)			{ return static_cast<double>(ticks) / TicksPerSecond; }
-		static uint64 SecondsToTicks(double seconds)		{ return static_cast<uint64>(seconds * TicksPerSecond); }
+		static double TicksToSeconds(uint64_t ticks)		{ return static_cast<double>(ticks) / TicksPerSecond; }
+		static uint64_t SecondsToTicks(double seconds)		{ return static_cast<uint64_t>(seconds * TicksPerSecond); }
+
+		// Frame pacing. Frame times are the real time between Ticks, before the clamp.
+		static const uint32_t PacingWindow = 512;
+		static const uint32_t HistogramBuckets = 64;		// 1 ms each, the last one collects the rest
+
+		uint32_t GetPacingFrameCount() const				{ return m_pacingFrames; }
+		const uint32_t* GetHistogram() const				{ return m_histogram; }
+
+		// percentile in [0, 100] of the frame times in the window, in ticks. Exact (not from
+		// the histogram), sorts a copy of the window.
+		uint64_t GetFrameTimePercentile(double percentile) const
+		{
+			if (!m_pacingFrames)
+			{
+				return 0;
+			}
+			std::copy(m_frameTicks, m_frameTicks + m_pacingFrames, m_sortScratch);
+			const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+			const uint32_t nth = static_cast<uint32_t>(clamped / 100.0 * (m_pacingFrames - 1) + 0.5);
+			std::nth_element(m_sortScratch, m_sortScratch + nth, m_sortScratch + m_pacingFrames);
+			return m_sortScratch[nth];
+		}
+
+		// Called from Tick, before any Update, for every frame that took more than thresholdTicks.
+		// A zero threshold disables it.
+		void SetHitchCallback(uint64_t thresholdTicks, std::function<void(uint64_t frameTicks)> callback)
+		{
+			m_hitchTicks = thresholdTicks;
+			m_hitchCallback = std::move(callback);
+		}
+		uint32_t GetHitchCount() const						{ return m_hitchCount; }
+
+		// The frames in the window, oldest first: index, frame ms, updates.
+		void WriteFrameTimesCsv(std::ostream& out) const
+		{
+			out << "frame,ms,updates\n";
+			const uint32_t first = m_pacingFrames < PacingWindow ? 0 : m_pacingNext;
+			for (uint32_t i = 0; i < m_pacingFrames; ++i)
+			{
+				const uint32_t k = (first + i) % PacingWindow;
+				out << i << ',' << TicksToSeconds(m_frameTicks[k]) * 1000.0 << ',' << m_frameUpdates[k] << '\n';
+			}
+		}
+
+		TClock& GetClock()									{ return m_clock; }
 
 		// After an intentional timing discontinuity (for instance a blocking IO operation)
 		// call this to avoid having the fixed timestep logic attempt a set of catch-up 
@@ -66,10 +177,7 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw ref new Platform::FailureException();
-			}
+			m_qpcLastTime = m_clock.Now();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
@@ -82,18 +190,16 @@ namespace DX
 		void Tick(const TUpdate& update)
 		{
 			// Query the current time.
-			LARGE_INTEGER currentTime;
+			const uint64_t currentTime = m_clock.Now();
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw ref new Platform::FailureException();
-			}
-
-			uint64 timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
+			uint64_t timeDelta = currentTime - m_qpcLastTime;
 
 			m_qpcLastTime = currentTime;
 			m_qpcSecondCounter += timeDelta;
 
+			// The real frame time, for pacing.
+			const uint64_t frameTicks = QpcToTicks(timeDelta);
+
 			// Clamp excessively large time deltas (e.g. after paused in the debugger).
 			if (timeDelta > m_qpcMaxDelta)
 			{
@@ -102,9 +208,18 @@ namespace DX
 
 			// Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
 			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
+			timeDelta /= m_qpcFrequency;
 
-			uint32 lastFrameCount = m_frameCount;
+			uint32_t lastFrameCount = m_frameCount;
+
+			if (m_hitchTicks && frameTicks > m_hitchTicks)
+			{
+				m_hitchCount++;
+				if (m_hitchCallback)
+				{
+					m_hitchCallback(frameTicks);
+				}
+			}
 
 			if (m_isFixedTimeStep)
 			{
@@ -117,13 +232,21 @@ namespace DX
 				// accumulate enough tiny errors that it would drop a frame. It is better to just round 
 				// small deviations down to zero to leave things running smoothly.
 
-				if (abs(static_cast<int64>(timeDelta - m_targetElapsedTicks)) < TicksPerSecond / 4000)
+				if (llabs(static_cast<int64_t>(timeDelta - m_targetElapsedTicks)) < static_cast<int64_t>(TicksPerSecond / 4000))
 				{
 					timeDelta = m_targetElapsedTicks;
 				}
 
 				m_leftOverTicks += timeDelta;
 
+				// Catch-up limiter: keep the fraction of a step, drop whole steps past the limit.
+				if (m_maxUpdatesPerFrame && m_leftOverTicks >= m_targetElapsedTicks * (m_maxUpdatesPerFrame + 1))
+				{
+					const uint64_t kept = m_targetElapsedTicks * m_maxUpdatesPerFrame + m_leftOverTicks % m_targetElapsedTicks;
+					m_droppedTicks += m_leftOverTicks - kept;
+					m_leftOverTicks = kept;
+				}
+
 				while (m_leftOverTicks >= m_targetElapsedTicks)
 				{
 					m_elapsedTicks = m_targetElapsedTicks;
@@ -145,39 +268,106 @@ namespace DX
 				update();
 			}
 
+			m_updatesThisFrame = m_frameCount - lastFrameCount;
+			AddPacingFrame(frameTicks, m_updatesThisFrame);
+
 			// Track the current framerate.
 			if (m_frameCount != lastFrameCount)
 			{
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64>(m_qpcFrequency.QuadPart))
+			if (m_qpcSecondCounter >= m_qpcFrequency)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_qpcSecondCounter %= m_qpcFrequency;
 			}
 		}
 
 	private:
-		// Source timing data uses QPC units.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
-		uint64 m_qpcMaxDelta;
+		uint64_t QpcToTicks(uint64_t qpc) const
+		{
+			// split so it doesn't overflow for long deltas
+			return qpc / m_qpcFrequency * TicksPerSecond + qpc % m_qpcFrequency * TicksPerSecond / m_qpcFrequency;
+		}
+
+		static uint32_t HistogramBucket(uint64_t ticks)
+		{
+			const uint64_t ms = ticks / (TicksPerSecond / 1000);
+			return static_cast<uint32_t>(std::min<uint64_t>(ms, HistogramBuckets - 1));
+		}
+
+		void AddPacingFrame(uint64_t frameTicks, uint32_t updates)
+		{
+			if (m_pacingFrames == PacingWindow)
+			{
+				// evict the oldest
+				m_histogram[HistogramBucket(m_frameTicks[m_pacingNext])]--;
+				if (m_frameUpdates[m_pacingNext] > 1)
+				{
+					m_catchUpFrames--;
+				}
+			}
+			else
+			{
+				m_pacingFrames++;
+			}
+
+			m_frameTicks[m_pacingNext] = frameTicks;
+			m_frameUpdates[m_pacingNext] = updates;
+			m_histogram[HistogramBucket(frameTicks)]++;
+			if (updates > 1)
+			{
+				m_catchUpFrames++;
+			}
+			m_pacingNext = (m_pacingNext + 1) % PacingWindow;
+		}
+
+		TClock m_clock;
+
+		// Source timing data uses clock units.
+		uint64_t m_qpcFrequency;
+		uint64_t m_qpcLastTime;
+		uint64_t m_qpcMaxDelta;
 
 		// Derived timing data uses a canonical tick format.
-		uint64 m_elapsedTicks;
-		uint64 m_totalTicks;
-		uint64 m_leftOverTicks;
+		uint64_t m_elapsedTicks;
+		uint64_t m_totalTicks;
+		uint64_t m_leftOverTicks;
 
 		// Members for tracking the framerate.
-		uint32 m_frameCount;
-		uint32 m_framesPerSecond;
-		uint32 m_framesThisSecond;
-		uint64 m_qpcSecondCounter;
+		uint32_t m_frameCount;
+		uint32_t m_framesPerSecond;
+		uint32_t m_framesThisSecond;
+		uint64_t m_qpcSecondCounter;
 
 		// Members for configuring fixed timestep mode.
 		bool m_isFixedTimeStep;
-		uint64 m_targetElapsedTicks;
+		uint64_t m_targetElapsedTicks;
+		uint32_t m_maxUpdatesPerFrame;
+		uint64_t m_droppedTicks;
+
+		// Members for frame pacing, m_frameTicks and m_frameUpdates are rings of PacingWindow.
+		uint32_t m_updatesThisFrame;
+		uint32_t m_pacingFrames;
+		uint32_t m_pacingNext;
+		uint64_t m_frameTicks[PacingWindow];
+		uint32_t m_frameUpdates[PacingWindow];
+		uint32_t m_histogram[HistogramBuckets];
+		mutable uint64_t m_sortScratch[PacingWindow];
+		uint64_t m_hitchTicks;
+		uint32_t m_hitchCount;
+		uint32_t m_catchUpFrames;
+		std::function<void(uint64_t)> m_hitchCallback;
 	};
+
+#if defined(_WIN32)
+	// The game's timer, a class so it can be forward declared.
+	class StepTimer : public BasicStepTimer<QpcClock>
+	{
+	};
+#endif
+
+	typedef BasicStepTimer<ChronoClock> ChronoStepTimer;
 }
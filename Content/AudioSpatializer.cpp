@@ -0,0 +1,205 @@
+﻿#include "pch.h"
+#include "AudioSpatializer.h"
+
+using namespace SpookyAdulthood;
+
+AudioSpatializer::Settings::Settings()
+    : m_speedOfSound(343.0f), m_dopplerScale(1.0f), m_openPortalGain(0.6f), m_closedPortalGain(0.2f), m_maxPortalHops(3)
+{
+}
+
+AudioSpatializer::AudioSpatializer()
+    : m_rooms(nullptr), m_roomsVersion(0), m_count(0)
+{
+}
+
+void AudioSpatializer::SetRooms(const AudioRoomGraph* rooms)
+{
+    m_rooms = rooms;
+    m_edges.clear();
+    m_roomGains.clear();
+    if (!rooms) return;
+
+    m_roomsVersion = rooms->GetVersion();
+    const int roomCount = (int)rooms->GetRoomCount();
+    const uint32_t portals = rooms->GetPortalCount();
+    m_edges.reserve(portals);
+    for (uint32_t i = 0; i < portals; ++i)
+    {
+        PortalEdge e;
+        if (!rooms->GetPortalRooms(i, e.m_rooms[0], e.m_rooms[1])) continue;
+        e.m_portal = i;
+        if (e.m_rooms[0] >= 0 && e.m_rooms[1] >= 0 && e.m_rooms[0] < roomCount && e.m_rooms[1] < roomCount)
+            m_edges.push_back(e);
+    }
+    m_roomGains.assign(roomCount, 1.0f);
+}
+
+int AudioSpatializer::RoomAt(const XMFLOAT3& pos) const
+{
+    return m_rooms ? m_rooms->RoomAt(pos) : -1;
+}
+
+float AudioSpatializer::GetRoomGain(int roomIndex) const
+{
+    return (roomIndex >= 0 && roomIndex < (int)m_roomGains.size()) ? m_roomGains[roomIndex] : 1.0f;
+}
+
+void AudioSpatializer::UpdateRoomGains(int listenerRoom)
+{
+    if (!m_rooms) return;
+    // the game's map object gets swapped to the next level
+    if (m_rooms->GetVersion() != m_roomsVersion || m_rooms->GetRoomCount() != m_roomGains.size())
+        SetRooms(m_rooms);
+    if (listenerRoom < 0 || listenerRoom >= (int)m_roomGains.size())
+    {
+        std::fill(m_roomGains.begin(), m_roomGains.end(), 1.0f);
+        return;
+    }
+
+    // loudest path through at most m_maxPortalHops doors
+    std::fill(m_roomGains.begin(), m_roomGains.end(), 0.0f);
+    m_roomGains[listenerRoom] = 1.0f;
+    for (uint32_t hop = 0; hop < m_settings.m_maxPortalHops; ++hop)
+    {
+        // from the gains of the previous hop, or edges in a row would cross several doors in one
+        m_hopGains = m_roomGains;
+        bool changed = false;
+        for (const auto& e : m_edges)
+        {
+            const float g = m_rooms->IsPortalOpen(e.m_portal) ? m_settings.m_openPortalGain : m_settings.m_closedPortalGain;
+            const float a = m_hopGains[e.m_rooms[0]]*g;
+            const float b = m_hopGains[e.m_rooms[1]]*g;
+            if (a > m_roomGains[e.m_rooms[1]]) { m_roomGains[e.m_rooms[1]] = a; changed = true; }
+            if (b > m_roomGains[e.m_rooms[0]]) { m_roomGains[e.m_rooms[0]] = b; changed = true; }
+        }
+        if (!changed) break;
+    }
+}
+
+void AudioSpatializer::Clear()
+{
+    m_count = 0;
+}
+
+uint32_t AudioSpatializer::AddEmitter(const XMFLOAT3& pos, const XMFLOAT3& velocity, float maxDist, float volume, int roomIndex)
+{
+    const uint32_t i = m_count++;
+    const size_t padded = (m_count + 3) & ~3u;
+    if (m_posX.size() < padded)
+    {
+        for (auto v : { &m_posX, &m_posZ, &m_velX, &m_velZ, &m_volume, &m_occlusion, &m_gain, &m_pan, &m_left, &m_right, &m_doppler })
+            v->resize(padded, 0.0f);
+        m_maxDist.resize(padded, 1.0f);
+        m_room.resize(padded, -1);
+    }
+    m_posX[i] = pos.x;
+    m_posZ[i] = pos.z;
+    m_velX[i] = velocity.x;
+    m_velZ[i] = velocity.z;
+    m_maxDist[i] = std::max(maxDist, 1e-3f);
+    m_volume[i] = volume;
+    m_room[i] = roomIndex;
+
+    // the lanes after the last emitter stay silent
+    for (size_t j = m_count; j < padded; ++j)
+    {
+        m_volume[j] = 0.0f;
+        m_maxDist[j] = 1.0f;
+        m_room[j] = -1;
+    }
+    return i;
+}
+
+void AudioSpatializer::Process(const XMFLOAT3& listenerPos, const XMFLOAT3& listenerForward, const XMFLOAT3& listenerVelocity, int listenerRoom)
+{
+    UpdateRoomGains(listenerRoom);
+    const uint32_t padded = (m_count + 3) & ~3u;
+    for (uint32_t i = 0; i < padded; ++i)
+        m_occlusion[i] = GetRoomGain(m_room[i]);
+
+    // right of the listener on the floor, right handed
+    const float fl = sqrtf(listenerForward.x*listenerForward.x + listenerForward.z*listenerForward.z);
+    const float rightX = fl > 0.0f ? -listenerForward.z / fl : 1.0f;
+    const float rightZ = fl > 0.0f ? listenerForward.x / fl : 0.0f;
+
+    const float c = m_settings.m_speedOfSound;
+    const XMVECTOR lx = XMVectorReplicate(listenerPos.x);
+    const XMVECTOR lz = XMVectorReplicate(listenerPos.z);
+    const XMVECTOR lvx = XMVectorReplicate(listenerVelocity.x*m_settings.m_dopplerScale);
+    const XMVECTOR lvz = XMVectorReplicate(listenerVelocity.z*m_settings.m_dopplerScale);
+    const XMVECTOR rx = XMVectorReplicate(rightX);
+    const XMVECTOR rz = XMVectorReplicate(rightZ);
+    const XMVECTOR speed = XMVectorReplicate(c);
+    const XMVECTOR halfSpeed = XMVectorReplicate(c*0.5f);
+    const XMVECTOR dopplerScale = XMVectorReplicate(m_settings.m_dopplerScale);
+    const XMVECTOR minRatio = XMVectorReplicate(0.5f), maxRatio = XMVectorReplicate(2.0f);
+    const XMVECTOR eps = XMVectorReplicate(1e-4f);
+    const XMVECTOR quarterPi = XMVectorReplicate(XM_PIDIV4);
+    const XMVECTOR zero = XMVectorZero(), one = XMVectorSplatOne();
+
+    for (uint32_t i = 0; i < padded; i += 4)
+    {
+        const XMVECTOR dx = XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)&m_posX[i]), lx);
+        const XMVECTOR dz = XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)&m_posZ[i]), lz);
+        const XMVECTOR dist = XMVectorSqrt(XMVectorMultiplyAdd(dx, dx, XMVectorMultiply(dz, dz)));
+        const XMVECTOR near0 = XMVectorLess(dist, eps);
+        const XMVECTOR invDist = XMVectorSelect(XMVectorReciprocal(XMVectorMax(dist, eps)), zero, near0);
+        const XMVECTOR ux = XMVectorMultiply(dx, invDist);
+        const XMVECTOR uz = XMVectorMultiply(dz, invDist);
+
+        // linear falloff, same curve as the voice pool
+        const XMVECTOR att = XMVectorSaturate(XMVectorSubtract(one, XMVectorDivide(dist, XMLoadFloat4((const XMFLOAT4*)&m_maxDist[i]))));
+        const XMVECTOR gain = XMVectorMultiply(XMVectorMultiply(att, XMLoadFloat4((const XMFLOAT4*)&m_volume[i])), XMLoadFloat4((const XMFLOAT4*)&m_occlusion[i]));
+
+        // equal power pan
+        const XMVECTOR pan = XMVectorMultiplyAdd(ux, rx, XMVectorMultiply(uz, rz));
+        XMVECTOR s, co;
+        XMVectorSinCos(&s, &co, XMVectorMultiply(XMVectorAdd(pan, one), quarterPi));
+
+        // doppler along the listener to emitter axis: listener approaching raises, emitter receding lowers
+        const XMVECTOR vl = XMVectorClamp(XMVectorMultiplyAdd(lvx, ux, XMVectorMultiply(lvz, uz)), XMVectorNegate(halfSpeed), halfSpeed);
+        const XMVECTOR ve = XMVectorClamp(XMVectorMultiply(dopplerScale, XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&m_velX[i]), ux,
+            XMVectorMultiply(XMLoadFloat4((const XMFLOAT4*)&m_velZ[i]), uz))), XMVectorNegate(halfSpeed), halfSpeed);
+        const XMVECTOR doppler = XMVectorClamp(XMVectorDivide(XMVectorAdd(speed, vl), XMVectorAdd(speed, ve)), minRatio, maxRatio);
+
+        XMStoreFloat4((XMFLOAT4*)&m_gain[i], gain);
+        XMStoreFloat4((XMFLOAT4*)&m_pan[i], pan);
+        XMStoreFloat4((XMFLOAT4*)&m_left[i], XMVectorMultiply(gain, co));
+        XMStoreFloat4((XMFLOAT4*)&m_right[i], XMVectorMultiply(gain, s));
+        XMStoreFloat4((XMFLOAT4*)&m_doppler[i], doppler);
+    }
+}
+
+void AudioSpatializer::ProcessScalar(const XMFLOAT3& listenerPos, const XMFLOAT3& listenerForward, const XMFLOAT3& listenerVelocity, int listenerRoom)
+{
+    UpdateRoomGains(listenerRoom);
+
+    const float fl = sqrtf(listenerForward.x*listenerForward.x + listenerForward.z*listenerForward.z);
+    const float rightX = fl > 0.0f ? -listenerForward.z / fl : 1.0f;
+    const float rightZ = fl > 0.0f ? listenerForward.x / fl : 0.0f;
+    const float c = m_settings.m_speedOfSound;
+    const float ds = m_settings.m_dopplerScale;
+
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        m_occlusion[i] = GetRoomGain(m_room[i]);
+        const float dx = m_posX[i] - listenerPos.x;
+        const float dz = m_posZ[i] - listenerPos.z;
+        const float dist = sqrtf(dx*dx + dz*dz);
+        const float invDist = dist < 1e-4f ? 0.0f : 1.0f / dist;
+        const float ux = dx*invDist, uz = dz*invDist;
+
+        const float gain = m_volume[i] * Clamp(1.0f - dist / m_maxDist[i], 0.0f, 1.0f) * m_occlusion[i];
+        const float pan = ux*rightX + uz*rightZ;
+        const float angle = (pan + 1.0f)*XM_PIDIV4;
+        const float vl = Clamp(ds*(listenerVelocity.x*ux + listenerVelocity.z*uz), -c*0.5f, c*0.5f);
+        const float ve = Clamp(ds*(m_velX[i] * ux + m_velZ[i] * uz), -c*0.5f, c*0.5f);
+
+        m_gain[i] = gain;
+        m_pan[i] = pan;
+        m_left[i] = gain*cosf(angle);
+        m_right[i] = gain*sinf(angle);
+        m_doppler[i] = Clamp((c + vl) / (c + ve), 0.5f, 2.0f);
+    }
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+namespace SpookyAdulthood
+{
+    //* ***************************************************************** *//
+    //* AudioRoomGraph
+    //* Rooms and doors as the spatializer sees them. The game adapts the
+    //* LevelMap (LevelMapAudioRooms), tests and tools can hand in anything
+    //* ***************************************************************** *//
+    class AudioRoomGraph
+    {
+    public:
+        virtual ~AudioRoomGraph() {}
+        virtual uint32_t GetVersion() const = 0; // changes when the rooms or portals are rebuilt
+        virtual uint32_t GetRoomCount() const = 0;
+        virtual int RoomAt(const XMFLOAT3& pos) const = 0; // -1 outside every room
+        virtual uint32_t GetPortalCount() const = 0;
+        virtual bool GetPortalRooms(uint32_t portal, int& roomA, int& roomB) const = 0; // false if it doesn't join two rooms
+        virtual bool IsPortalOpen(uint32_t portal) const = 0;
+    };
+
+    //* ***************************************************************** *//
+    //* AudioSpatializer
+    //* Mono emitters against one listener on the floor plane (right handed,
+    //* like the camera). Attenuation, equal power stereo gains, doppler and
+    //* occlusion through the level portals for every emitter in one SoA
+    //* pass, four emitters per DirectXMath op. Plain math, no XAudio2.
+    //* ***************************************************************** *//
+    class AudioSpatializer
+    {
+    public:
+        struct Settings
+        {
+            Settings();
+
+            float m_speedOfSound;       // units per second
+            float m_dopplerScale;       // 0 disables doppler
+            float m_openPortalGain;     // per open door crossed
+            float m_closedPortalGain;   // per closed door crossed
+            uint32_t m_maxPortalHops;   // rooms further away are silent
+        };
+
+        AudioSpatializer();
+        inline void SetSettings(const Settings& settings) { m_settings = settings; }
+        inline const Settings& GetSettings() const { return m_settings; }
+
+        // room graph for occlusion, edges rebuilt when its version changes; nullptr disables occlusion
+        void SetRooms(const AudioRoomGraph* rooms);
+        int RoomAt(const XMFLOAT3& pos) const; // -1 outside every room
+        float GetRoomGain(int roomIndex) const; // occlusion of a room as of the last Process
+
+        void Clear();
+        uint32_t AddEmitter(const XMFLOAT3& pos, const XMFLOAT3& velocity, float maxDist, float volume, int roomIndex);
+        inline uint32_t GetCount() const { return m_count; }
+
+        void Process(const XMFLOAT3& listenerPos, const XMFLOAT3& listenerForward, const XMFLOAT3& listenerVelocity, int listenerRoom);
+        void ProcessScalar(const XMFLOAT3& listenerPos, const XMFLOAT3& listenerForward, const XMFLOAT3& listenerVelocity, int listenerRoom); // reference
+
+        // per emitter, from the last Process
+        inline float GetGain(uint32_t i) const { return m_gain[i]; }        // volume, distance and occlusion
+        inline float GetPan(uint32_t i) const { return m_pan[i]; }          // -1 left .. 1 right
+        inline float GetLeft(uint32_t i) const { return m_left[i]; }        // mono to stereo matrix, gain included
+        inline float GetRight(uint32_t i) const { return m_right[i]; }
+        inline float GetDoppler(uint32_t i) const { return m_doppler[i]; }  // frequency ratio
+        inline float GetOcclusion(uint32_t i) const { return m_occlusion[i]; }
+
+    private:
+        struct PortalEdge
+        {
+            int m_rooms[2];
+            uint32_t m_portal;
+        };
+
+        void UpdateRoomGains(int listenerRoom);
+
+        Settings m_settings;
+        const AudioRoomGraph* m_rooms;
+        uint32_t m_roomsVersion;
+        std::vector<PortalEdge> m_edges;
+        std::vector<float> m_roomGains;
+        std::vector<float> m_hopGains; // scratch for UpdateRoomGains
+        uint32_t m_count;
+
+        // SoA, padded to a multiple of 4 with silent emitters
+        std::vector<float> m_posX, m_posZ, m_velX, m_velZ, m_maxDist, m_volume;
+        std::vector<int> m_room;
+        std::vector<float> m_occlusion, m_gain, m_pan, m_left, m_right, m_doppler;
+    };
+}
@@ -0,0 +1,39 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+
+using namespace SpookyAdulthood;
+
+void Benchmarks::RunAll(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    OutputDebugStringW(L"---- Benchmarks ----\n");
+    Random();
+    LevelGeneration(device);
+    LevelCache(device);
+    AudioMixer();
+    VoicePool();
+    WaveBankStreaming();
+    Spatializer(device);
+    WavLoading();
+    AdpcmDecode();
+    ArchiveLoading();
+    SpriteDecode(device);
+    DDSParsing();
+    SpriteBatching();
+    SpriteFontText(device);
+    MeshOptimization(device);
+    PrimitiveGeneration();
+    ModelLoading(device);
+    FrameAllocation();
+    MemoryAccounting(device);
+    Collision();
+    OutputDebugStringW(L"--------------------\n");
+}
+
+void Benchmarks::Report(const wchar_t* name, __int64 us, size_t count)
+{
+    wchar_t buff[256];
+    const double nsPerItem = count ? (double)us*1000.0 / (double)count : 0.0;
+    swprintf_s(buff, L"%-32s %10lld us  %8.3f ns/item  (%zu items)\n", name, us, nsPerItem, count);
+    OutputDebugStringW(buff);
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+namespace DX { class DeviceResources; }
+
+namespace SpookyAdulthood
+{
+    //* ***************************************************************** *//
+    //* Benchmarks
+    //* Debug micro benchmarks (key 1), results go to the debugger output
+    //* One Benchmarks<Subsystem>.cpp per group; correctness checks
+    //* live in the Tests/ driver instead
+    //* ***************************************************************** *//
+    struct Benchmarks
+    {
+        static void RunAll(const std::shared_ptr<DX::DeviceResources>& device);
+        static void Random();
+        static void LevelGeneration(const std::shared_ptr<DX::DeviceResources>& device);
+        static void LevelCache(const std::shared_ptr<DX::DeviceResources>& device);
+        static void AudioMixer();
+        static void VoicePool();
+        static void WaveBankStreaming();
+        static void Spatializer(const std::shared_ptr<DX::DeviceResources>& device);
+        static void WavLoading();
+        static void AdpcmDecode();
+        static void ArchiveLoading();
+        static void SpriteDecode(const std::shared_ptr<DX::DeviceResources>& device);
+        static void DDSParsing();
+        static void SpriteBatching();
+        static void SpriteFontText(const std::shared_ptr<DX::DeviceResources>& device);
+        static void MeshOptimization(const std::shared_ptr<DX::DeviceResources>& device);
+        static void PrimitiveGeneration();
+        static void ModelLoading(const std::shared_ptr<DX::DeviceResources>& device);
+        static void FrameAllocation();
+        static void MemoryAccounting(const std::shared_ptr<DX::DeviceResources>& device);
+        static void Collision();
+        static bool CollisionCrossCheck();
+
+        static void Report(const wchar_t* name, __int64 us, size_t count);
+    };
+}
@@ -0,0 +1,623 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+#include "GlobalFlags.h"
+#include "ImageDecoder.h"
+#include "../Common/MappedFile.h"
+#include "../Common/AssetArchive.h"
+#include "../DirectXTK/Inc/DDSParser.h"
+#include "../DirectXTK/Src/dds.h"
+#include "../DirectXTK/Inc/ModelParser.h"
+#include "../DirectXTK/Src/BinaryReader.h"
+#include "../DirectXTK/Src/SDKMesh.h"
+#include "../DirectXTK/Src/CMO.h"
+
+#include <random>
+
+using namespace SpookyAdulthood;
+
+void Benchmarks::ArchiveLoading()
+{
+    // every archived asset read as a loose file (open, size, read, close) vs looked up in the mapped archive
+    DX::AssetArchive archive;
+    if (!archive.Open(L"assets\\assets.pak"))
+    {
+        OutputDebugStringW(L"  no assets\\assets.pak, pack it with AssetPack\n");
+        return;
+    }
+
+    std::vector<std::wstring> names;
+    for (uint32_t i = 0; i < archive.GetEntryCount(); ++i)
+        names.push_back(archive.GetEntryName(i));
+
+    size_t looseBytes = 0, missing = 0;
+    const __int64 looseUs = time_call_us([&]
+    {
+        for (const auto& name : names)
+        {
+            HANDLE file = CreateFile2(name.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                ++missing;
+                continue;
+            }
+            LARGE_INTEGER size;
+            DWORD read = 0;
+            if (GetFileSizeEx(file, &size))
+            {
+                std::vector<uint8_t> data((size_t)size.QuadPart);
+                if (!data.empty() && ReadFile(file, data.data(), (DWORD)data.size(), &read, nullptr))
+                    looseBytes += read;
+            }
+            CloseHandle(file);
+        }
+    });
+    Report(L"Assets loose files", looseUs, names.size());
+
+    size_t archiveBytes = 0, corrupt = 0;
+    const __int64 archiveUs = time_call_us([&]
+    {
+        for (const auto& name : names)
+        {
+            auto blob = archive.Get(name);
+            if (blob)
+                archiveBytes += blob.m_size;
+            else
+                ++corrupt;
+        }
+    });
+    Report(L"Assets archive", archiveUs, names.size());
+
+    const auto stats = archive.GetStats();
+    wchar_t buff[256];
+    swprintf_s(buff, L"  %zu/%zu bytes, %u entries decompressed (%llu bytes), %zu loose files missing\n",
+        archiveBytes, looseBytes, stats.m_decompressed, stats.m_bytesDecompressed, missing);
+    OutputDebugStringW(buff);
+    if (corrupt)
+        OutputDebugStringW(L"ERROR: archive entries failed to load\n");
+}
+
+void Benchmarks::SpriteDecode(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    // the game's sprite files: WIC one by one (the old path) vs the portable decoder serial and on the pool
+    auto& sprites = device->GetGameResources()->m_sprite;
+    std::vector<DX::MappedFile> files(sprites.GetSpriteCount());
+    size_t fileBytes = 0;
+    for (int i = 0; i < sprites.GetSpriteCount(); ++i)
+    {
+        if (files[i].Open(sprites.GetSprite(i).m_filename))
+            fileBytes += files[i].GetSize();
+    }
+
+    Report(L"Sprites WIC (decode+upload)", time_call_us([&]
+    {
+        for (const auto& file : files)
+        {
+            if (!file.GetData()) continue;
+            Microsoft::WRL::ComPtr<ID3D11Resource> tex;
+            DirectX::CreateWICTextureFromMemory(device->GetD3DDevice(), file.GetData(), file.GetSize(), tex.GetAddressOf(), nullptr);
+        }
+    }), files.size());
+
+    std::vector<DecodedImage> serial(files.size()), parallel(files.size());
+    size_t decoded = 0;
+    const __int64 serialUs = time_call_us([&]
+    {
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            if (files[i].GetData() && DecodePNG(files[i].GetData(), files[i].GetSize(), serial[i]) == PNG_OK)
+                ++decoded;
+        }
+    });
+    Report(L"Sprites DecodePNG serial", serialUs, files.size());
+
+    Report(L"Sprites DecodePNG parallel", time_call_us([&]
+    {
+        concurrency::parallel_for(size_t(0), files.size(), [&](size_t i)
+        {
+            if (files[i].GetData())
+                DecodePNG(files[i].GetData(), files[i].GetSize(), parallel[i]);
+        });
+    }), files.size());
+
+    size_t pixelBytes = 0;
+    bool same = true;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        pixelBytes += serial[i].m_pixels.size();
+        same = same && serial[i].m_pixels == parallel[i].m_pixels;
+    }
+    wchar_t buff[256];
+    swprintf_s(buff, L"  %zu/%zu decoded, %.1f MB/s in, %.1f MB/s pixels (serial)\n", decoded, files.size(),
+        serialUs ? fileBytes / (1024.0*1024.0)*1e6 / serialUs : 0.0, serialUs ? pixelBytes / (1024.0*1024.0)*1e6 / serialUs : 0.0);
+    OutputDebugStringW(buff);
+    if (!same)
+        OutputDebugStringW(L"ERROR: serial and parallel decodes differ\n");
+
+    // pixel kernels on a 2048x2048 image, Tests/ImageDecoderTests.cpp checks them against the scalar ones
+    static const size_t N = 2048 * 2048;
+    std::vector<uint8_t> rgb(N * 3), rgba(N * 4), rgbaRef(N * 4);
+    DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+    for (auto& b : rgb)
+        b = (uint8_t)rnd.Get(0, 255);
+
+    Report(L"RGBToRGBA scalar", time_call_us([&] { PixelKernels::RGBToRGBAScalar(rgb.data(), rgbaRef.data(), N); }), N);
+    Report(L"RGBToRGBA", time_call_us([&] { PixelKernels::RGBToRGBA(rgb.data(), rgba.data(), N); }), N);
+
+    for (size_t i = 0; i < N; ++i)
+        rgba[i * 4 + 3] = rgbaRef[i * 4 + 3] = (uint8_t)rnd.Get(0, 255);
+    Report(L"Premultiply scalar", time_call_us([&] { PixelKernels::PremultiplyScalar(rgbaRef.data(), N); }), N);
+    Report(L"Premultiply", time_call_us([&] { PixelKernels::Premultiply(rgba.data(), N); }), N);
+}
+
+void Benchmarks::DDSParsing()
+{
+    // in memory files of the layouts the parser handles: legacy BC1 with mips, legacy cube, DX10 BC7 array, DX10 volume
+    struct Layout { bool dx10; DXGI_FORMAT format; uint32_t dim, width, height, depth, mips, items; bool cube; DDS_PIXELFORMAT pf; };
+    const DDS_PIXELFORMAT none = {};
+    const Layout layouts[] =
+    {
+        { false, DXGI_FORMAT_BC1_UNORM, DDS_DIMENSION_TEXTURE2D, 1024, 1024, 1, 11, 1, false, DDSPF_DXT1 },
+        { false, DXGI_FORMAT_BC3_UNORM, DDS_DIMENSION_TEXTURE2D, 256, 256, 1, 9, 1, true, DDSPF_DXT5 },
+        { true, DXGI_FORMAT_BC7_UNORM, DDS_DIMENSION_TEXTURE2D, 512, 512, 1, 10, 8, false, none },
+        { true, DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE3D, 64, 64, 64, 7, 1, false, none },
+    };
+
+    std::vector<std::vector<uint8_t>> files;
+    for (const auto& l : layouts)
+    {
+        const size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + (l.dx10 ? sizeof(DDS_HEADER_DXT10) : 0);
+        size_t bits = 0;
+        for (uint32_t item = 0; item < l.items * (l.cube ? 6 : 1); ++item)
+        {
+            for (uint32_t mip = 0; mip < l.mips; ++mip)
+            {
+                const uint32_t w = std::max(1u, l.width >> mip), h = std::max(1u, l.height >> mip), d = std::max(1u, l.depth >> mip);
+                bits += l.format == DXGI_FORMAT_R8G8B8A8_UNORM ? size_t(w)*h*d * 4
+                    : size_t(std::max(1u, (w + 3) / 4))*std::max(1u, (h + 3) / 4)*(l.format == DXGI_FORMAT_BC1_UNORM ? 8 : 16);
+            }
+        }
+
+        std::vector<uint8_t> file(headerSize + bits, 0);
+        DDS_HEADER header = {};
+        header.size = sizeof(DDS_HEADER);
+        header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP | (l.dim == DDS_DIMENSION_TEXTURE3D ? DDS_HEADER_FLAGS_VOLUME : 0);
+        header.width = l.width;
+        header.height = l.height;
+        header.depth = l.depth;
+        header.mipMapCount = l.mips;
+        header.ddspf = l.dx10 ? DDSPF_DX10 : l.pf;
+        header.caps2 = l.cube ? DDS_CUBEMAP | DDS_CUBEMAP_ALLFACES : 0;
+        memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+        memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+        if (l.dx10)
+        {
+            DDS_HEADER_DXT10 ext = {};
+            ext.dxgiFormat = l.format;
+            ext.resourceDimension = l.dim;
+            ext.arraySize = l.items;
+            memcpy(file.data() + sizeof(uint32_t) + sizeof(header), &ext, sizeof(ext));
+        }
+        files.push_back(std::move(file));
+    }
+
+    // every view must land inside its file, back to back, ending where the parser says the data ends
+    auto viewsInside = [](const std::vector<uint8_t>& file, const DDSTextureInfo& info, std::vector<DDSSubresource>& subs)
+    {
+        subs.resize(size_t(info.mipLevels)*info.arraySize);
+        if (GetDDSSubresources(info, subs.data(), subs.size()) != subs.size())
+            return false;
+        const uint8_t* next = info.bitData;
+        for (const auto& sub : subs)
+        {
+            if (sub.data != next)
+                return false;
+            next += sub.slicePitch*sub.depth;
+        }
+        return info.bitData >= file.data() && next == info.bitData + info.bitSize && next <= file.data() + file.size();
+    };
+
+    std::vector<DDSSubresource> subs;
+    size_t bytes = 0;
+    for (const auto& file : files)
+        bytes += file.size();
+
+    static const size_t N = 1 << 16;
+    size_t views = 0;
+    Report(L"DDS parse + views", time_call_us([&]
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            const auto& file = files[i % files.size()];
+            DDSTextureInfo info;
+            if (SUCCEEDED(ParseDDSTexture(file.data(), file.size(), info)))
+            {
+                subs.resize(size_t(info.mipLevels)*info.arraySize);
+                views += GetDDSSubresources(info, subs.data(), subs.size());
+            }
+        }
+    }), N);
+
+    // what the file loader did before: a fresh allocation and a copy of every byte
+    static const size_t COPIES = 64;
+    std::vector<uint8_t> copy;
+    Report(L"DDS copy into new buffer", time_call_us([&]
+    {
+        for (size_t i = 0; i < COPIES; ++i)
+        {
+            const auto& file = files[i % files.size()];
+            copy.assign(file.begin(), file.end());
+        }
+    }), COPIES);
+
+    // mutated headers and truncations: whatever is accepted must keep its views inside the file
+    // (Tests/DDSParserTests.cpp fails on any that don't, here they are counted).
+    // Mutates a scratch copy in place and restores the header, the payload is never copied again
+    DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+    static const size_t MUTATIONS = 100000;
+    const uint32_t headerSize = (uint32_t)(sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10));
+    auto scratch = files;
+    size_t accepted = 0, escaped = 0;
+    const __int64 fuzzUs = time_call_us([&]
+    {
+        for (size_t i = 0; i < MUTATIONS; ++i)
+        {
+            auto& file = scratch[i % files.size()];
+            size_t size = file.size();
+            for (uint32_t m = rnd.Get(1, 4); m > 0; --m)
+            {
+                const uint32_t at = rnd.Get(0, headerSize - 4) & ~3u;
+                switch (rnd.Get(0, 2))
+                {
+                case 0: file[at + rnd.Get(0, 3)] ^= (uint8_t)(1 << rnd.Get(0, 7)); break;
+                case 1: { const uint32_t v = rnd.Get(0, 1) ? rnd.Get(0, 70000) : 0xffffffffu >> rnd.Get(0, 31); memcpy(&file[at], &v, sizeof(v)); } break;
+                case 2: size = rnd.Get(0, (uint32_t)size); break;
+                }
+            }
+
+            DDSTextureInfo info;
+            if (SUCCEEDED(ParseDDSTexture(file.data(), size, info)))
+            {
+                ++accepted;
+                const bool inside = viewsInside(file, info, subs) && info.bitData + info.bitSize <= file.data() + size;
+                escaped += inside ? 0 : 1;
+            }
+            memcpy(file.data(), files[i % files.size()].data(), headerSize);
+        }
+    });
+    Report(L"DDS mutated headers", fuzzUs, MUTATIONS);
+
+    wchar_t buff[256];
+    swprintf_s(buff, L"  %zu views over %.1f MB per round, %zu/%zu mutations accepted, %zu outside the file\n", views * files.size() / N,
+        bytes / (1024.0*1024.0), accepted, MUTATIONS, escaped);
+    OutputDebugStringW(buff);
+}
+
+namespace
+{
+    typedef std::vector<VertexPositionNormalTexture> ModelVertices;
+    typedef std::vector<uint16_t> ModelIndices;
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& file, const T* data, size_t count)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        file.insert(file.end(), bytes, bytes + sizeof(T)*count);
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& file, const T& value) { Append(file, &value, 1); }
+
+    void AppendCMOString(std::vector<uint8_t>& file, const wchar_t* str)
+    {
+        const uint32_t length = (uint32_t)wcslen(str);
+        Append(file, length);
+        Append(file, str, length);
+    }
+
+    // a single mesh .VBO
+    std::vector<uint8_t> BuildVBO(const ModelVertices& vertices, const ModelIndices& indices)
+    {
+        std::vector<uint8_t> file;
+        Append(file, (uint32_t)vertices.size());
+        Append(file, (uint32_t)indices.size());
+        Append(file, vertices.data(), vertices.size());
+        Append(file, indices.data(), indices.size());
+        return file;
+    }
+
+    // .CMO of meshCount copies of the mesh, one untextured material and one submesh each
+    std::vector<uint8_t> BuildCMO(const ModelVertices& vertices, const ModelIndices& indices, uint32_t meshCount)
+    {
+        std::vector<VertexPositionNormalTangentColorTexture> cmoVertices;
+        cmoVertices.reserve(vertices.size());
+        for (const auto& v : vertices)
+            cmoVertices.emplace_back(v.position, v.normal, XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), 0xffffffff, v.textureCoordinate);
+
+        VSD3DStarter::Material material = {};
+        material.Diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+        material.SpecularPower = 16.0f;
+        XMStoreFloat4x4(&material.UVTransform, XMMatrixIdentity());
+
+        VSD3DStarter::SubMesh submesh = {};
+        submesh.PrimCount = (uint32_t)(indices.size() / 3);
+
+        VSD3DStarter::MeshExtents extents = {};
+        extents.Radius = 1.0f;
+        extents.MinX = extents.MinY = extents.MinZ = -1.0f;
+        extents.MaxX = extents.MaxY = extents.MaxZ = 1.0f;
+
+        std::vector<uint8_t> file;
+        Append(file, meshCount);
+        for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+        {
+            AppendCMOString(file, L"mesh");
+            Append(file, 1u);
+            AppendCMOString(file, L"material");
+            Append(file, material);
+            AppendCMOString(file, L"");
+            for (uint32_t t = 0; t < VSD3DStarter::MAX_TEXTURE; ++t)
+                AppendCMOString(file, L"");
+            Append(file, uint8_t(0));
+            Append(file, 1u);
+            Append(file, submesh);
+            Append(file, 1u);
+            Append(file, (uint32_t)indices.size());
+            Append(file, indices.data(), indices.size());
+            Append(file, 1u);
+            Append(file, (uint32_t)cmoVertices.size());
+            Append(file, cmoVertices.data(), cmoVertices.size());
+            Append(file, 0u);
+            Append(file, extents);
+        }
+        return file;
+    }
+
+    // .SDKMESH of meshCount meshes sharing one vertex and one 32 bit index buffer, one subset each
+    std::vector<uint8_t> BuildSDKMESH(const ModelVertices& vertices, const ModelIndices& indices, uint32_t meshCount)
+    {
+        using namespace DXUT;
+        SDKMESH_HEADER header = {};
+        header.Version = SDKMESH_FILE_VERSION;
+        header.NumVertexBuffers = 1;
+        header.NumIndexBuffers = 1;
+        header.NumMeshes = meshCount;
+        header.NumTotalSubsets = meshCount;
+        header.NumMaterials = 1;
+        header.HeaderSize = sizeof(SDKMESH_HEADER) + sizeof(SDKMESH_VERTEX_BUFFER_HEADER) + sizeof(SDKMESH_INDEX_BUFFER_HEADER);
+        header.VertexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
+        header.IndexStreamHeadersOffset = header.VertexStreamHeadersOffset + sizeof(SDKMESH_VERTEX_BUFFER_HEADER);
+        header.MeshDataOffset = header.HeaderSize;
+        header.SubsetDataOffset = header.MeshDataOffset + sizeof(SDKMESH_MESH)*meshCount;
+        header.FrameDataOffset = header.SubsetDataOffset + sizeof(SDKMESH_SUBSET)*meshCount;
+        header.MaterialDataOffset = header.FrameDataOffset;
+        const uint64_t subsetIndexOffset = header.MaterialDataOffset + sizeof(SDKMESH_MATERIAL);
+        header.NonBufferDataSize = subsetIndexOffset + sizeof(uint32_t)*meshCount - header.HeaderSize;
+        const uint64_t bufferDataOffset = header.HeaderSize + header.NonBufferDataSize;
+        const uint64_t indexCount = uint64_t(indices.size())*meshCount;
+        header.BufferDataSize = sizeof(VertexPositionNormalTexture)*vertices.size()*meshCount + sizeof(uint32_t)*indexCount;
+
+        SDKMESH_VERTEX_BUFFER_HEADER vb = {};
+        vb.NumVertices = vertices.size()*meshCount;
+        vb.SizeBytes = sizeof(VertexPositionNormalTexture)*vb.NumVertices;
+        vb.StrideBytes = sizeof(VertexPositionNormalTexture);
+        const D3DVERTEXELEMENT9 end = { 0xFF, 0, D3DDECLTYPE_UNUSED, 0, 0, 0 };
+        std::fill(std::begin(vb.Decl), std::end(vb.Decl), end);
+        vb.Decl[0] = { 0, 0, D3DDECLTYPE_FLOAT3, 0, D3DDECLUSAGE_POSITION, 0 };
+        vb.Decl[1] = { 0, 12, D3DDECLTYPE_FLOAT3, 0, D3DDECLUSAGE_NORMAL, 0 };
+        vb.Decl[2] = { 0, 24, D3DDECLTYPE_FLOAT2, 0, D3DDECLUSAGE_TEXCOORD, 0 };
+        vb.DataOffset = bufferDataOffset;
+
+        SDKMESH_INDEX_BUFFER_HEADER ib = {};
+        ib.NumIndices = indexCount;
+        ib.SizeBytes = sizeof(uint32_t)*indexCount;
+        ib.IndexType = IT_32BIT;
+        ib.DataOffset = bufferDataOffset + vb.SizeBytes;
+
+        std::vector<uint8_t> file;
+        Append(file, header);
+        Append(file, vb);
+        Append(file, ib);
+        for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+        {
+            SDKMESH_MESH mh = {};
+            strcpy_s(mh.Name, "mesh");
+            mh.NumVertexBuffers = 1;
+            mh.NumSubsets = 1;
+            mh.BoundingBoxExtents = XMFLOAT3(1.0f, 1.0f, 1.0f);
+            mh.SubsetOffset = subsetIndexOffset + sizeof(uint32_t)*mesh;
+            Append(file, mh);
+        }
+        for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+        {
+            SDKMESH_SUBSET subset = {};
+            subset.PrimitiveType = PT_TRIANGLE_LIST;
+            subset.IndexStart = uint64_t(indices.size())*mesh;
+            subset.IndexCount = indices.size();
+            subset.VertexCount = vertices.size();
+            Append(file, subset);
+        }
+        SDKMESH_MATERIAL material = {};
+        strcpy_s(material.Name, "material");
+        material.Diffuse = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+        Append(file, material);
+        for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+            Append(file, mesh);
+        for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+            Append(file, vertices.data(), vertices.size());
+        for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+        {
+            const uint32_t base = (uint32_t)(vertices.size()*mesh);
+            for (uint16_t i : indices)
+                Append(file, base + i);
+        }
+        return file;
+    }
+
+    // Parses a model file and checks every view the parser hands out lies inside it, touching
+    // nothing but the tables. Throws on files the parser rejects
+    typedef std::function<bool(const uint8_t*, size_t)> ModelParse;
+
+    bool ViewInside(const uint8_t* data, size_t size, const void* view, uint64_t bytes)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(view);
+        return p >= data && p <= data + size && bytes <= uint64_t(data + size - p);
+    }
+
+    bool ParseVBOFile(const uint8_t* data, size_t size)
+    {
+        VBOModelInfo info;
+        ParseVBO(data, size, info);
+        return ViewInside(data, size, info.vertices, uint64_t(info.vertexCount)*sizeof(VertexPositionNormalTexture))
+            && ViewInside(data, size, info.indices, uint64_t(info.indexCount)*sizeof(uint16_t));
+    }
+
+    bool ParseCMOFile(const uint8_t* data, size_t size)
+    {
+        std::vector<CMOMeshInfo> meshes;
+        ParseCMO(data, size, meshes);
+        bool inside = true;
+        for (const auto& mesh : meshes)
+        {
+            inside = inside && ViewInside(data, size, mesh.submeshes, uint64_t(mesh.submeshCount)*sizeof(VSD3DStarter::SubMesh))
+                && ViewInside(data, size, mesh.extents, sizeof(VSD3DStarter::MeshExtents));
+            for (const auto& material : mesh.materials)
+                inside = inside && ViewInside(data, size, material.material, sizeof(VSD3DStarter::Material));
+            for (const auto& ib : mesh.indexBuffers)
+                inside = inside && ViewInside(data, size, ib.indices, uint64_t(ib.indexCount)*sizeof(uint16_t));
+            for (const auto& vb : mesh.vertexBuffers)
+                inside = inside && ViewInside(data, size, vb.vertices, uint64_t(vb.vertexCount)*sizeof(VertexPositionNormalTangentColorTexture));
+        }
+        return inside;
+    }
+
+    bool ParseSDKMESHFile(const uint8_t* data, size_t size)
+    {
+        SDKMESHModelInfo info;
+        ParseSDKMESH(data, size, info);
+        bool inside = ViewInside(data, size, info.meshes, uint64_t(info.header->NumMeshes)*sizeof(DXUT::SDKMESH_MESH))
+            && ViewInside(data, size, info.subsets, uint64_t(info.header->NumTotalSubsets)*sizeof(DXUT::SDKMESH_SUBSET))
+            && ViewInside(data, size, info.materials, uint64_t(info.header->NumMaterials)*sizeof(DXUT::SDKMESH_MATERIAL));
+        for (uint32_t j = 0; j < info.header->NumVertexBuffers; ++j)
+            inside = inside && ViewInside(data, size, info.vertexData[j], info.vertexBuffers[j].SizeBytes);
+        for (uint32_t j = 0; j < info.header->NumIndexBuffers; ++j)
+            inside = inside && ViewInside(data, size, info.indexData[j], info.indexBuffers[j].SizeBytes);
+        return inside;
+    }
+}
+
+void Benchmarks::ModelLoading(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    // The game ships no models, so .VBO, .CMO and .SDKMESH files are built from a GeoSphere 6,
+    // the latter two with 16 copies of it: read into the heap then parsed (the old loader I/O) vs
+    // mapped and parsed in place, and the full Model::CreateFrom* load with buffers and effects.
+    // Then mutated and truncated copies of small files must be rejected or parse to views inside
+    // the file
+    ModelVertices vertices;
+    ModelIndices indices;
+    GeometricPrimitive::CreateGeoSphere(vertices, indices, 1.0f, 6);
+    ModelVertices smallVertices;
+    ModelIndices smallIndices;
+    GeometricPrimitive::CreateGeoSphere(smallVertices, smallIndices, 1.0f, 1);
+
+    ID3D11Device* d3dDevice = device->GetD3DDevice();
+    EffectFactory effects(d3dDevice);
+    struct ModelFile
+    {
+        const wchar_t* name;
+        std::vector<uint8_t> data, small;
+        size_t vertices;
+        ModelParse parse;
+        std::function<void(const wchar_t*)> load;
+    };
+    const uint32_t meshes = 16;
+    ModelFile files[] =
+    {
+        { L"vbo", BuildVBO(vertices, indices), BuildVBO(smallVertices, smallIndices), vertices.size(), ParseVBOFile,
+            [&](const wchar_t* path) { Model::CreateFromVBO(d3dDevice, path); } },
+        { L"cmo", BuildCMO(vertices, indices, meshes), BuildCMO(smallVertices, smallIndices, 3), vertices.size()*meshes, ParseCMOFile,
+            [&](const wchar_t* path) { Model::CreateFromCMO(d3dDevice, path, effects); } },
+        { L"sdkmesh", BuildSDKMESH(vertices, indices, meshes), BuildSDKMESH(smallVertices, smallIndices, 3), vertices.size()*meshes, ParseSDKMESHFile,
+            [&](const wchar_t* path) { Model::CreateFromSDKMESH(d3dDevice, path, effects); } },
+    };
+
+    const std::wstring folder(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path->Data());
+    wchar_t name[64], buff[256];
+    for (auto& file : files)
+    {
+        const std::wstring path = folder + L"\\benchmark." + file.name;
+        if (!DX::WriteFileData(path, file.data.data(), file.data.size()))
+        {
+            swprintf_s(buff, L"ERROR: cannot write %s\n", path.c_str());
+            OutputDebugStringW(buff);
+            continue;
+        }
+
+        bool inside = true;
+        const __int64 readUs = time_call_us([&]
+        {
+            std::unique_ptr<uint8_t[]> data;
+            size_t size = 0;
+            inside = SUCCEEDED(BinaryReader::ReadEntireFile(path.c_str(), data, &size)) && file.parse(data.get(), size) && inside;
+        });
+        const __int64 mapUs = time_call_us([&]
+        {
+            MappedFileView view;
+            inside = SUCCEEDED(view.Open(path.c_str())) && file.parse(view.GetData(), view.GetSize()) && inside;
+        });
+        const __int64 loadUs = time_call_us([&] { file.load(path.c_str()); });
+
+        swprintf_s(name, L"Model %s read+parse", file.name);
+        Report(name, readUs, file.vertices);
+        swprintf_s(name, L"Model %s map+parse", file.name);
+        Report(name, mapUs, file.vertices);
+        swprintf_s(name, L"Model %s CreateFrom", file.name);
+        Report(name, loadUs, file.vertices);
+        swprintf_s(buff, L"  %.1f MB\n", file.data.size() / (1024.0*1024.0));
+        OutputDebugStringW(buff);
+        if (!inside)
+        {
+            swprintf_s(buff, L"ERROR: %s parse failed or handed out views outside the file\n", file.name);
+            OutputDebugStringW(buff);
+        }
+        DeleteFileW(path.c_str());
+
+        // random byte, 0xff and small or huge count stores, sometimes truncated
+        std::mt19937 rng(RANDOM_DEFAULT_SEED);
+        const size_t mutations = 5000;
+        size_t accepted = 0, outside = 0;
+        std::vector<uint8_t> mutated;
+        const __int64 fuzzUs = time_call_us([&]
+        {
+            for (size_t i = 0; i < mutations; ++i)
+            {
+                mutated = file.small;
+                for (uint32_t k = 1 + rng() % 4; k > 0; --k)
+                {
+                    const size_t pos = rng() % mutated.size();
+                    const uint32_t value = rng() % 3 == 0 ? 0xffffffff : rng() % 64;
+                    switch (rng() % 3)
+                    {
+                    case 0: mutated[pos] = (uint8_t)rng(); break;
+                    case 1: mutated[pos] = 0xff; break;
+                    default: memcpy(mutated.data() + pos, &value, std::min(sizeof(value), mutated.size() - pos)); break;
+                    }
+                }
+                if (rng() % 4 == 0)
+                    mutated.resize(rng() % mutated.size());
+                try
+                {
+                    outside += file.parse(mutated.data(), mutated.size()) ? 0 : 1;
+                    ++accepted;
+                }
+                catch (const std::exception&)
+                {
+                }
+            }
+        });
+        swprintf_s(name, L"Model %s fuzz", file.name);
+        Report(name, fuzzUs, mutations);
+        swprintf_s(buff, L"  %zu of %zu mutated files accepted, %zu with views outside them\n", accepted, mutations, outside);
+        OutputDebugStringW(buff);
+    }
+}
@@ -0,0 +1,393 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+#include "GlobalFlags.h"
+#include "SoundVoicePool.h"
+#include "AudioSpatializer.h"
+#include "../Common/MappedFile.h"
+#include "../DirectXTK/Audio/RIFFReader.h"
+#include "../DirectXTK/Audio/WAVFileReader.h"
+#include "../DirectXTK/Audio/ADPCMCodec.h"
+#include <thread>
+
+using namespace SpookyAdulthood;
+
+void Benchmarks::AudioMixer()
+{
+    // 1s of 22KHz mono, so every voice goes through the resampler
+    static const int SRC_RATE = 22050;
+    std::vector<int16_t> wave(SRC_RATE);
+    for (size_t i = 0; i < wave.size(); ++i)
+        wave[i] = (int16_t)(sinf(XM_2PI*440.0f*(float)i / SRC_RATE)*16000.0f);
+    WAVEFORMATEX wfx = {};
+    wfx.wFormatTag = WAVE_FORMAT_PCM;
+    wfx.nChannels = 1;
+    wfx.nSamplesPerSec = SRC_RATE;
+    wfx.wBitsPerSample = 16;
+    wfx.nBlockAlign = sizeof(int16_t);
+    wfx.nAvgBytesPerSec = SRC_RATE * sizeof(int16_t);
+
+    // one 10ms block per render, the budget is 1ms of mixing for it
+    static const size_t BLOCK_FRAMES = 441;
+    static const int BLOCKS = 100;
+    static const __int64 BUDGET_US = 1000;
+    std::vector<float> output(BLOCK_FRAMES * 2);
+    size_t fitInBudget = 0;
+    for (size_t voices = 16; voices <= 1024; voices *= 2)
+    {
+        DirectX::SoftwareMixer mixer(44100, voices);
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        for (size_t v = 0; v < voices; ++v)
+            mixer.Play(&wfx, (const uint8_t*)wave.data(), wave.size()*sizeof(int16_t), 1.0f / voices, rnd.GetF(-1.0f, 1.0f), rnd.GetF(-1.0f, 1.0f), true);
+
+        const __int64 us = time_call_us([&]
+        {
+            for (int b = 0; b < BLOCKS; ++b)
+                mixer.Render(output.data(), BLOCK_FRAMES);
+        });
+        wchar_t name[64];
+        swprintf_s(name, L"SoftwareMixer %zu voices", voices);
+        Report(name, us / BLOCKS, BLOCK_FRAMES*voices);
+        if (us / BLOCKS <= BUDGET_US)
+            fitInBudget = voices;
+    }
+
+    wchar_t buff[128];
+    swprintf_s(buff, L"SoftwareMixer: %zu voices fit in %lld us per 10ms block\n", fitInBudget, BUDGET_US);
+    OutputDebugStringW(buff);
+}
+
+void Benchmarks::VoicePool()
+{
+    // null backend: 8 voices, every sfx lasts 1s, a burst of 64 plays per frame around the listener
+    static const uint32_t VOICES = 8;
+    static const uint32_t SFX = 4;
+    static const int FRAMES = 600;
+    static const int PLAYS_PER_FRAME = 64;
+    const SoundVoicePool::StealPolicy policies[] = { SoundVoicePool::STEAL_OLDEST, SoundVoicePool::STEAL_QUIETEST };
+    const wchar_t* names[] = { L"SoundVoicePool oldest", L"SoundVoicePool quietest" };
+    for (int p = 0; p < 2; ++p)
+    {
+        SoundVoicePool pool;
+        pool.Initialize(std::make_unique<NullSoundVoiceBackend>(std::vector<float>(SFX, 1.0f), VOICES), VOICES, policies[p]);
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        // a looping critical voice holds one of the voices throughout
+        pool.Play(0, 1.0f, 0.0f, SOUND_PRIO_CRITICAL, true);
+        const __int64 us = time_call_us([&]
+        {
+            for (int f = 0; f < FRAMES; ++f)
+            {
+                pool.Update(1.0f / 60.0f, XMFLOAT3(0, 0, 0));
+                for (int i = 0; i < PLAYS_PER_FRAME; ++i)
+                {
+                    const XMFLOAT3 pos(rnd.GetF(-12.0f, 12.0f), 0.0f, rnd.GetF(-12.0f, 12.0f));
+                    pool.PlayAt(rnd.Get(0, SFX - 1), pos, 8.0f, 1.0f, 0.0f, (SoundPriority)rnd.Get(SOUND_PRIO_LOW, SOUND_PRIO_HIGH));
+                }
+            }
+        });
+        Report(names[p], us, FRAMES*PLAYS_PER_FRAME);
+
+        const auto& st = pool.GetStats();
+        wchar_t buff[256];
+        swprintf_s(buff, L"  played=%u stolen=%u culled=%u rejected=%u peak=%u\n", st.m_played, st.m_stolen, st.m_culled, st.m_rejected, st.m_peak);
+        OutputDebugStringW(buff);
+    }
+}
+
+void Benchmarks::WaveBankStreaming()
+{
+    // 16MB of 44KHz 16-bit stereo noise (95s) behind a 4K header, streamed through rings of
+    // different sizes: drained as fast as the disk allows, then mixed 10ms blocks back to back
+    static const size_t HEADER_BYTES = 4096;
+    static const size_t DATA_BYTES = 16 * 1024 * 1024;
+    static const size_t BLOCK_FRAMES = 441;
+    static const int BLOCKS = 1000;
+    const std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path->Data()) + L"\\benchmark.xwb";
+    {
+        std::vector<uint8_t> file(HEADER_BYTES + DATA_BYTES);
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        for (size_t i = HEADER_BYTES; i < file.size(); ++i)
+            file[i] = (uint8_t)rnd.Get(0, 255);
+        if (!DX::WriteFileData(path, file.data(), file.size()))
+        {
+            OutputDebugStringW(L"ERROR: cannot write the wave bank file\n");
+            return;
+        }
+    }
+
+    WAVEFORMATEX wfx = {};
+    wfx.wFormatTag = WAVE_FORMAT_PCM;
+    wfx.nChannels = 2;
+    wfx.nSamplesPerSec = 44100;
+    wfx.wBitsPerSample = 16;
+    wfx.nBlockAlign = 4;
+    wfx.nAvgBytesPerSec = 44100 * 4;
+
+    const size_t packetSizes[] = { 16 * 1024, 64 * 1024 };
+    const size_t packetCounts[] = { 2, 4, 8 };
+    wchar_t name[64], buff[256];
+    std::vector<uint8_t> pull(64 * 1024);
+    std::vector<float> output(BLOCK_FRAMES * 2);
+    for (size_t packetSize : packetSizes)
+    {
+        for (size_t packetCount : packetCounts)
+        {
+            DirectX::WaveBankStream drained(path.c_str(), HEADER_BYTES, DATA_BYTES, packetSize, packetCount);
+            const __int64 drainUs = time_call_us([&]
+            {
+                while (!drained.IsEndOfStream())
+                {
+                    if (!drained.Read(pull.data(), pull.size()))
+                        std::this_thread::yield();
+                }
+            });
+            const auto io = drained.GetStatistics();
+            swprintf_s(name, L"WaveBankStream %zuK x%zu drain", packetSize / 1024, packetCount);
+            Report(name, drainUs, io.packetsRead);
+            swprintf_s(buff, L"  %.1f MB/s read time, latency %.2f ms avg %.2f ms max, %zu empty pulls, %zu KB ring\n",
+                io.throughputMBs, io.averageLatencyMS, io.maxLatencyMS, io.underruns, io.bufferBytes / 1024);
+            OutputDebugStringW(buff);
+
+            DirectX::WaveBankStream played(path.c_str(), HEADER_BYTES, DATA_BYTES, packetSize, packetCount);
+            DirectX::SoftwareMixer mixer(44100, 1);
+            mixer.PlayStream(&wfx, &played);
+            const __int64 mixUs = time_call_us([&]
+            {
+                for (int b = 0; b < BLOCKS; ++b)
+                    mixer.Render(output.data(), BLOCK_FRAMES);
+            });
+            swprintf_s(name, L"WaveBankStream %zuK x%zu mix", packetSize / 1024, packetCount);
+            Report(name, mixUs / BLOCKS, BLOCK_FRAMES);
+            const double audioUs = 1000000.0 * BLOCKS * BLOCK_FRAMES / 44100.0;
+            swprintf_s(buff, L"  %.0fx real time, %zu of %d blocks underran\n",
+                mixUs ? audioUs / mixUs : 0.0, mixer.GetStatistics().streamUnderruns, BLOCKS);
+            OutputDebugStringW(buff);
+        }
+    }
+    DeleteFileW(path.c_str());
+}
+
+void Benchmarks::Spatializer(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    // game sized level for the portal graph, emitters scattered over it with random velocities
+    LevelMapGenerationSettings settings;
+    settings.m_generateThumbTex = false;
+    settings.m_useCache = false;
+    LevelMap map(device);
+    map.Generate(settings, RANDOM_DEFAULT_SEED);
+    const LevelMapAudioRooms rooms(map);
+    const auto room = map.GetBiggestRoom();
+    const XMFLOAT3 listener((room->m_area.m_x0 + room->m_area.m_x1 + 1)*0.5f, 0.0f, (room->m_area.m_y0 + room->m_area.m_y1 + 1)*0.5f);
+    const XMFLOAT3 forward(0.6f, 0.0f, -0.8f), listenerVel(1.5f, 0.0f, -2.0f);
+
+    static const int FRAMES = 100;
+    wchar_t buff[256];
+    for (uint32_t emitters = 64; emitters <= 4096; emitters *= 4)
+    {
+        AudioSpatializer spatializer;
+        spatializer.SetRooms(&rooms);
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        const float w = (float)settings.m_tileCount.x, h = (float)settings.m_tileCount.y;
+        for (uint32_t i = 0; i < emitters; ++i)
+        {
+            const XMFLOAT3 pos(rnd.GetF(0.0f, w), 0.0f, rnd.GetF(0.0f, h));
+            const XMFLOAT3 vel(rnd.GetF(-3.0f, 3.0f), 0.0f, rnd.GetF(-3.0f, 3.0f));
+            spatializer.AddEmitter(pos, vel, rnd.GetF(4.0f, 16.0f), 1.0f, spatializer.RoomAt(pos));
+        }
+        const int listenerRoom = spatializer.RoomAt(listener);
+
+        const __int64 scalarUs = time_call_us([&]
+        {
+            for (int f = 0; f < FRAMES; ++f)
+                spatializer.ProcessScalar(listener, forward, listenerVel, listenerRoom);
+        });
+        std::vector<float> reference(emitters * 4);
+        for (uint32_t i = 0; i < emitters; ++i)
+        {
+            reference[i * 4] = spatializer.GetLeft(i);
+            reference[i * 4 + 1] = spatializer.GetRight(i);
+            reference[i * 4 + 2] = spatializer.GetDoppler(i);
+            reference[i * 4 + 3] = spatializer.GetPan(i);
+        }
+
+        const __int64 simdUs = time_call_us([&]
+        {
+            for (int f = 0; f < FRAMES; ++f)
+                spatializer.Process(listener, forward, listenerVel, listenerRoom);
+        });
+
+        wchar_t name[64];
+        swprintf_s(name, L"AudioSpatializer scalar %u", emitters);
+        Report(name, scalarUs / FRAMES, emitters);
+        swprintf_s(name, L"AudioSpatializer SIMD %u", emitters);
+        Report(name, simdUs / FRAMES, emitters);
+
+        float maxErr = 0.0f;
+        uint32_t audible = 0, occluded = 0;
+        for (uint32_t i = 0; i < emitters; ++i)
+        {
+            maxErr = std::max(maxErr, fabsf(reference[i * 4] - spatializer.GetLeft(i)));
+            maxErr = std::max(maxErr, fabsf(reference[i * 4 + 1] - spatializer.GetRight(i)));
+            maxErr = std::max(maxErr, fabsf(reference[i * 4 + 2] - spatializer.GetDoppler(i)));
+            maxErr = std::max(maxErr, fabsf(reference[i * 4 + 3] - spatializer.GetPan(i)));
+            if (spatializer.GetGain(i) > 0.0f) ++audible;
+            if (spatializer.GetOcclusion(i) < 1.0f) ++occluded;
+        }
+        swprintf_s(buff, L"  %u audible, %u occluded by portals, max diff to scalar %g\n", audible, occluded, maxErr);
+        OutputDebugStringW(buff);
+    }
+}
+
+namespace
+{
+    // RIFF WAVE image: 'junk' chunks before fmt/data so the scanner has headers to walk
+    void BuildWav(std::vector<uint8_t>& out, size_t junkChunks, size_t audioBytes, DX::RandomProvider& rnd)
+    {
+        auto put32 = [&](uint32_t v) { out.insert(out.end(), (const uint8_t*)&v, (const uint8_t*)&v + 4); };
+        out.clear();
+        put32(DirectX::RIFF::FOURCC_RIFF_TAG); put32(0); put32(DirectX::RIFF::FOURCC_WAVE_FILE_TAG);
+        for (size_t j = 0; j < junkChunks; ++j)
+        {
+            const uint32_t size = rnd.Get(0, 32) * 2;
+            put32('knuj'); put32(size);
+            out.resize(out.size() + size);
+        }
+        PCMWAVEFORMAT fmt = {};
+        fmt.wf.wFormatTag = WAVE_FORMAT_PCM;
+        fmt.wf.nChannels = 1;
+        fmt.wf.nSamplesPerSec = 22050;
+        fmt.wf.nBlockAlign = 2;
+        fmt.wf.nAvgBytesPerSec = 44100;
+        fmt.wBitsPerSample = 16;
+        put32(DirectX::RIFF::FOURCC_FORMAT_TAG); put32(sizeof(fmt));
+        out.insert(out.end(), (const uint8_t*)&fmt, (const uint8_t*)&fmt + sizeof(fmt));
+        put32(DirectX::RIFF::FOURCC_DATA_TAG); put32((uint32_t)audioBytes);
+        out.resize(out.size() + audioBytes);
+        const uint32_t riffSize = (uint32_t)out.size() - 8;
+        memcpy(out.data() + 4, &riffSize, 4);
+    }
+}
+
+void Benchmarks::WavLoading()
+{
+    // chunk scanner over an in-memory corpus
+    static const size_t FILES = 512;
+    DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+    std::vector<std::vector<uint8_t>> corpus(FILES);
+    size_t corpusBytes = 0;
+    for (auto& f : corpus)
+    {
+        BuildWav(f, rnd.Get(0, 256), rnd.Get(1, 64) * 1024, rnd);
+        corpusBytes += f.size();
+    }
+
+    size_t parsed = 0;
+    const __int64 scanUs = time_call_us([&]
+    {
+        for (const auto& f : corpus)
+        {
+            const WAVEFORMATEX* wfx = nullptr;
+            const uint8_t* data = nullptr;
+            uint32_t dataSize = 0, loopStart = 0, loopLength = 0;
+            bool dpds, seek;
+            if (SUCCEEDED(DirectX::RIFF::WaveFindFormatAndData(f.data(), f.size(), &wfx, &data, &dataSize, dpds, seek)) &&
+                SUCCEEDED(DirectX::RIFF::WaveFindLoopInfo(f.data(), f.size(), &loopStart, &loopLength)))
+                ++parsed;
+        }
+    });
+    Report(L"RIFF::WaveFindFormatAndData", scanUs, FILES);
+    wchar_t buff[256];
+    swprintf_s(buff, L"  %zu/%zu parsed, %.1f MB/s of corpus\n", parsed, FILES, scanUs ? corpusBytes / (double)scanUs : 0.0);
+    OutputDebugStringW(buff);
+
+    // ReadFile copy vs shared mapping, same 4MB file loaded repeatedly, then a renamed duplicate
+    static const int LOADS = 64;
+    const std::wstring folder(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path->Data());
+    const std::wstring path = folder + L"\\benchmark.wav", copyPath = folder + L"\\benchmark_copy.wav";
+    std::vector<uint8_t> wav;
+    BuildWav(wav, 16, 4 * 1024 * 1024, rnd);
+    if (!DX::WriteFileData(path, wav.data(), wav.size()) || !DX::WriteFileData(copyPath, wav.data(), wav.size()))
+    {
+        OutputDebugStringW(L"ERROR: cannot write the wav files\n");
+        return;
+    }
+
+    Report(L"LoadWAVAudioFromFileEx", time_call_us([&]
+    {
+        for (int i = 0; i < LOADS; ++i)
+        {
+            std::unique_ptr<uint8_t[]> data;
+            DirectX::WAVData result;
+            DirectX::LoadWAVAudioFromFileEx(path.c_str(), data, result);
+        }
+    }), LOADS);
+
+    std::vector<std::shared_ptr<const void>> mappings(LOADS + 1);
+    Report(L"LoadWAVAudioFromFileMapped", time_call_us([&]
+    {
+        DirectX::WAVData result;
+        for (int i = 0; i < LOADS; ++i)
+            DirectX::LoadWAVAudioFromFileMapped(path.c_str(), mappings[i], result);
+        DirectX::LoadWAVAudioFromFileMapped(copyPath.c_str(), mappings[LOADS], result);
+    }), LOADS + 1);
+
+    const auto stats = DirectX::GetWAVSampleCacheStatistics();
+    swprintf_s(buff, L"  cache: %zu samples %zu bytes, %zu loads %zu path hits %zu content hits\n",
+        stats.samples, stats.mappedBytes, stats.loads, stats.pathHits, stats.contentHits);
+    OutputDebugStringW(buff);
+    if (mappings[0] != mappings[LOADS])
+        OutputDebugStringW(L"ERROR: duplicate wav content is not shared\n");
+}
+
+void Benchmarks::AdpcmDecode()
+{
+    // 10s of 22KHz tone plus noise, decode cost per second of audio for scalar vs SIMD
+    static const int SRC_RATE = 22050;
+    static const size_t FRAMES = SRC_RATE * 10;
+    static const int SPB = DirectX::ADPCM::DEFAULT_SAMPLES_PER_BLOCK;
+    static const int DECODES = 20;
+    DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+    wchar_t buff[256];
+    for (int channels = 1; channels <= 2; ++channels)
+    {
+        std::vector<int16_t> pcm(FRAMES * channels);
+        for (size_t i = 0; i < FRAMES; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+                pcm[i*channels + c] = (int16_t)(sinf(XM_2PI*(220.0f + 110.0f*c)*(float)i / SRC_RATE)*12000.0f + rnd.GetF(-1000.0f, 1000.0f));
+        }
+
+        std::vector<uint8_t> encoded(DirectX::ADPCM::EncodedSize(FRAMES, channels, SPB));
+        const __int64 encodeUs = time_call_us([&]
+        {
+            DirectX::ADPCM::Encode(pcm.data(), FRAMES, channels, SPB, encoded.data());
+        });
+
+        const size_t decodedFrames = DirectX::ADPCM::DecodedFrames(encoded.size(), channels, SPB);
+        std::vector<int16_t> scalar(decodedFrames * channels), simd(decodedFrames * channels);
+        const __int64 scalarUs = time_call_us([&]
+        {
+            for (int i = 0; i < DECODES; ++i)
+                DirectX::ADPCM::DecodeScalar(encoded.data(), encoded.size(), channels, SPB, scalar.data());
+        });
+        const __int64 simdUs = time_call_us([&]
+        {
+            for (int i = 0; i < DECODES; ++i)
+                DirectX::ADPCM::Decode(encoded.data(), encoded.size(), channels, SPB, simd.data());
+        });
+
+        wchar_t name[64];
+        swprintf_s(name, L"ADPCM encode %d ch", channels);
+        Report(name, encodeUs, FRAMES);
+        swprintf_s(name, L"ADPCM decode scalar %d ch", channels);
+        Report(name, scalarUs / DECODES, decodedFrames);
+        swprintf_s(name, L"ADPCM decode SIMD %d ch", channels);
+        Report(name, simdUs / DECODES, decodedFrames);
+
+        const float seconds = (float)FRAMES / SRC_RATE;
+        swprintf_s(buff, L"  %.1f us per second of audio (scalar %.1f), %.2f:1, SNR %.1f dB\n",
+            simdUs / (DECODES*seconds), scalarUs / (DECODES*seconds), (float)(pcm.size()*sizeof(int16_t)) / encoded.size(),
+            DirectX::ADPCM::SignalToNoise(pcm.data(), simd.data(), pcm.size()));
+        OutputDebugStringW(buff);
+    }
+}
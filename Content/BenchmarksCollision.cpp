@@ -0,0 +1,711 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+#include "GlobalFlags.h"
+#include "CollisionAndSolving.h"
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    // Scenes for the collision primitives, generated from a fixed seed so every run (and every
+    // replacement of a primitive) sees the same queries
+    struct CollisionRay2D { XMFLOAT2 m_origin, m_dir; };
+    struct CollisionRay3D { XMFLOAT3 m_origin, m_dir; };
+    struct CollisionMove { XMFLOAT2 m_cur, m_next; };
+    struct CollisionBillboard { XMFLOAT3 m_pos; XMFLOAT2 m_size; float m_radius; };
+    struct CollisionTriangle { XMFLOAT3 m_v[3]; };
+    struct CollisionSphere { XMFLOAT3 m_center; float m_radius; };
+
+    struct CollisionScenes
+    {
+        static const int SOUP_SEGMENTS = 2048;
+        static const int SOUP_RAYS = 512;
+        static const int ROOM_SIZE = 32;
+        static const int ROOM_PILLAR_STEP = 4;
+        static const int ROOM_MOVES = 16384;
+        static const int FIELD_SIZE = 64;
+        static const int FIELD_RAYS = 256;
+        static const int GRAZING_QUERIES = 4096;
+
+        // random segment soup, rays across it (LevelMap::RaycastSeg, closest hit)
+        SegmentList m_soup;
+        std::vector<CollisionRay2D> m_soupRays;
+        // a room as LevelMap builds it: walls split by a portal on each side, a grid of pillars,
+        // and per frame camera moves inside it (CollisionAndSolving2D)
+        SegmentList m_room;
+        std::vector<CollisionMove> m_roomMoves;
+        // one billboard per tile and rays at eye height (EntityManager::RaycastEntity), plus the
+        // floor under them
+        std::vector<CollisionBillboard> m_field;
+        std::vector<CollisionRay3D> m_fieldRays;
+        // rays a hair off parallel to a segment, tangent to a sphere, along a plane and skimming
+        // a triangle, where the float math is least conditioned
+        std::vector<CollisionRay2D> m_grazingSegRays;
+        SegmentList m_grazingSegs;
+        std::vector<CollisionRay3D> m_grazingRays;
+        std::vector<CollisionSphere> m_grazingSpheres;
+        std::vector<CollisionTriangle> m_grazingTriangles;
+        std::vector<XMFLOAT3> m_grazingPlaneNormals;
+
+        CollisionScenes()
+        {
+            DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+
+            m_soup.resize(SOUP_SEGMENTS);
+            for (auto& seg : m_soup)
+            {
+                const float a = rnd.GetF(0.0f, XM_2PI);
+                const float len = rnd.GetF(0.5f, 4.0f);
+                seg.start = XMFLOAT2(rnd.GetF(0.0f, 64.0f), rnd.GetF(0.0f, 64.0f));
+                seg.end = XMFLOAT2(seg.start.x + cosf(a)*len, seg.start.y + sinf(a)*len);
+                seg.normal = XMFLOAT2(-sinf(a), cosf(a));
+                seg.flags = CollSegment::WALL;
+            }
+            m_soupRays.resize(SOUP_RAYS);
+            for (auto& ray : m_soupRays)
+            {
+                const float a = rnd.GetF(0.0f, XM_2PI);
+                ray.m_origin = XMFLOAT2(rnd.GetF(0.0f, 64.0f), rnd.GetF(0.0f, 64.0f));
+                ray.m_dir = XMFLOAT2(cosf(a), sinf(a));
+            }
+
+            GenerateRoom(rnd);
+            GenerateField(rnd);
+            GenerateGrazing(rnd);
+        }
+
+        void GenerateRoom(DX::RandomProvider& rnd)
+        {
+            const float size = (float)ROOM_SIZE;
+            const float door = size*0.5f;
+            CollSegment seg;
+            auto push = [this, &seg](float x0, float y0, float x1, float y1, float nx, float ny, int flags)
+            {
+                seg.start = XMFLOAT2(x0, y0); seg.end = XMFLOAT2(x1, y1); seg.normal = XMFLOAT2(nx, ny); seg.flags = flags;
+                m_room.push_back(seg);
+            };
+            // north/south and west/east walls around a closed portal (collides) or an open one
+            for (int i = 0; i < 2; ++i)
+            {
+                const float y = i*size;
+                const float n = i ? -1.0f : 1.0f;
+                const int portal = CollSegment::PORTAL | (i ? CollSegment::DISABLED : 0);
+                push(0.0f, y, door, y, 0.0f, n, CollSegment::WALL);
+                push(door, y, door + 1.0f, y, 0.0f, n, portal);
+                push(door + 1.0f, y, size, y, 0.0f, n, CollSegment::WALL);
+                push(y, 0.0f, y, door, n, 0.0f, CollSegment::WALL);
+                push(y, door, y, door + 1.0f, n, 0.0f, portal);
+                push(y, door + 1.0f, y, size, n, 0.0f, CollSegment::WALL);
+            }
+            for (int py = ROOM_PILLAR_STEP; py < ROOM_SIZE; py += ROOM_PILLAR_STEP)
+            {
+                for (int px = ROOM_PILLAR_STEP; px < ROOM_SIZE; px += ROOM_PILLAR_STEP)
+                {
+                    const float x = (float)px, y = (float)py;
+                    push(x, y, x + 1, y, 0, -1, CollSegment::PILLAR);
+                    push(x + 1, y, x + 1, y + 1, 1, 0, CollSegment::PILLAR);
+                    push(x + 1, y + 1, x, y + 1, 0, 1, CollSegment::PILLAR);
+                    push(x, y + 1, x, y, -1, 0, CollSegment::PILLAR);
+                }
+            }
+
+            // walking speed steps, some of them running into the pillars and walls
+            m_roomMoves.resize(ROOM_MOVES);
+            for (auto& move : m_roomMoves)
+            {
+                float x, y;
+                do
+                {
+                    x = rnd.GetF(0.3f, size - 0.3f);
+                    y = rnd.GetF(0.3f, size - 0.3f);
+                } while ((int)x % ROOM_PILLAR_STEP == 0 && (int)y % ROOM_PILLAR_STEP == 0);
+                const float a = rnd.GetF(0.0f, XM_2PI);
+                const float step = rnd.GetF(0.02f, 0.5f);
+                move.m_cur = XMFLOAT2(x, y);
+                move.m_next = XMFLOAT2(x + cosf(a)*step, y + sinf(a)*step);
+            }
+        }
+
+        void GenerateField(DX::RandomProvider& rnd)
+        {
+            m_field.resize(FIELD_SIZE*FIELD_SIZE);
+            for (int i = 0; i < FIELD_SIZE*FIELD_SIZE; ++i)
+            {
+                auto& b = m_field[i];
+                const float s = rnd.GetF(0.5f, 1.0f);
+                b.m_pos = XMFLOAT3((i % FIELD_SIZE) + rnd.GetF(0.3f, 0.7f), s*0.5f, (i / FIELD_SIZE) + rnd.GetF(0.3f, 0.7f));
+                b.m_size = XMFLOAT2(s, s);
+                b.m_radius = s*0.5f;
+            }
+            m_fieldRays.resize(FIELD_RAYS);
+            for (auto& ray : m_fieldRays)
+            {
+                const float yaw = rnd.GetF(0.0f, XM_2PI);
+                const float pitch = rnd.GetF(-0.3f, 0.05f);
+                ray.m_origin = XMFLOAT3(rnd.GetF(0.0f, (float)FIELD_SIZE), 0.5f, rnd.GetF(0.0f, (float)FIELD_SIZE));
+                ray.m_dir = XMFLOAT3(sinf(yaw)*cosf(pitch), sinf(pitch), cosf(yaw)*cosf(pitch));
+            }
+        }
+
+        void GenerateGrazing(DX::RandomProvider& rnd)
+        {
+            // angles from 1e-7 to 1e-2 radians, offsets around the touching distance
+            auto angle = [&rnd] { return powf(10.0f, rnd.GetF(-7.0f, -2.0f))*(rnd.Get01() ? 1.0f : -1.0f); };
+            auto offset = [&rnd] { return powf(10.0f, rnd.GetF(-6.0f, -1.0f))*(rnd.Get01() ? 1.0f : -1.0f); };
+
+            m_grazingSegs.resize(GRAZING_QUERIES);
+            m_grazingSegRays.resize(GRAZING_QUERIES);
+            for (int i = 0; i < GRAZING_QUERIES; ++i)
+            {
+                auto& seg = m_grazingSegs[i];
+                const float a = rnd.GetF(0.0f, XM_2PI);
+                const float len = rnd.GetF(1.0f, 8.0f);
+                const XMFLOAT2 d(cosf(a), sinf(a)), n(-d.y, d.x);
+                seg.start = XMFLOAT2(rnd.GetF(0.0f, 64.0f), rnd.GetF(0.0f, 64.0f));
+                seg.end = XMFLOAT2(seg.start.x + d.x*len, seg.start.y + d.y*len);
+                seg.normal = n;
+                seg.flags = CollSegment::WALL;
+                // from behind the segment start, slightly off its line and slightly turned into it
+                const float back = rnd.GetF(0.0f, 16.0f), off = offset(), ra = a + angle();
+                auto& ray = m_grazingSegRays[i];
+                ray.m_origin = XMFLOAT2(seg.start.x - d.x*back + n.x*off, seg.start.y - d.y*back + n.y*off);
+                ray.m_dir = XMFLOAT2(cosf(ra), sinf(ra));
+            }
+
+            m_grazingRays.resize(GRAZING_QUERIES);
+            m_grazingSpheres.resize(GRAZING_QUERIES);
+            m_grazingTriangles.resize(GRAZING_QUERIES);
+            m_grazingPlaneNormals.resize(GRAZING_QUERIES);
+            for (int i = 0; i < GRAZING_QUERIES; ++i)
+            {
+                // a ray along +x skewed by a tiny angle, the shapes are placed to just touch it
+                auto& ray = m_grazingRays[i];
+                const float yaw = rnd.GetF(0.0f, XM_2PI), tilt = angle();
+                const XMFLOAT3 fw(cosf(yaw)*cosf(tilt), sinf(tilt), sinf(yaw)*cosf(tilt));
+                const XMFLOAT3 side(-sinf(yaw), 0.0f, cosf(yaw));
+                ray.m_origin = XMFLOAT3(rnd.GetF(0.0f, 64.0f), rnd.GetF(0.0f, 2.0f), rnd.GetF(0.0f, 64.0f));
+                ray.m_dir = fw;
+
+                // sphere tangent to the ray
+                const float dist = rnd.GetF(1.0f, 16.0f), r = rnd.GetF(0.25f, 1.0f), off = r + offset();
+                auto& sphere = m_grazingSpheres[i];
+                sphere.m_center = XM3Mad(XM3Mad(ray.m_origin, fw, dist), side, off);
+                sphere.m_radius = r;
+
+                // horizontal triangle the ray skims, crossing its plane about the middle
+                auto& tri = m_grazingTriangles[i];
+                const XMFLOAT3 c = XM3Mad(ray.m_origin, fw, dist);
+                const float e = rnd.GetF(0.5f, 2.0f), y = c.y + offset()*0.01f;
+                tri.m_v[0] = XMFLOAT3(c.x - e, y, c.z - e);
+                tri.m_v[1] = XMFLOAT3(c.x + e, y, c.z - e);
+                tri.m_v[2] = XMFLOAT3(c.x, y, c.z + e);
+
+                // plane normal almost perpendicular to the ray, facing it
+                const float pa = angle();
+                m_grazingPlaneNormals[i] = XM3Normalize(XM3Mad(XM3Mul(XM3Up(), cosf(pa)), fw, -fabsf(sinf(pa))));
+            }
+        }
+    };
+
+    // Double precision references of the CollisionAndSolving.cpp primitives, with their contracts
+    // and quirks. Each one also bounds the error the float version can make on the query; when a
+    // decision (hit or not, which wall) is within that bound the query is counted as ambiguous and
+    // not compared. A replacement must agree with these everywhere else
+    enum RefResult { REF_MISS, REF_HIT, REF_AMBIGUOUS };
+    static const double REF_EPS = 8.0 * FLT_EPSILON;
+
+    struct RefV3
+    {
+        double x, y, z;
+        RefV3(double _x, double _y, double _z) : x(_x), y(_y), z(_z) {}
+        RefV3(const XMFLOAT3& v) : x(v.x), y(v.y), z(v.z) {}
+        RefV3 operator-(const RefV3& b) const { return RefV3(x - b.x, y - b.y, z - b.z); }
+        RefV3 operator*(double s) const { return RefV3(x*s, y*s, z*s); }
+        double Dot(const RefV3& b) const { return x*b.x + y*b.y + z*b.z; }
+        RefV3 Cross(const RefV3& b) const { return RefV3(y*b.z - z*b.y, z*b.x - x*b.z, x*b.y - y*b.x); }
+        double Length() const { return sqrt(Dot(*this)); }
+    };
+
+    struct RefHit
+    {
+        double m_frac;
+        double m_error; // how far the float frac may be off
+    };
+
+    // segment p1p2 against p3p4, frac along p1p2 (FPSCDRaycast)
+    RefResult RefSegments(const XMFLOAT2& p1, const XMFLOAT2& p2, const XMFLOAT2& p3, const XMFLOAT2& p4, RefHit& out)
+    {
+        const double ax = (double)p2.x - p1.x, ay = (double)p2.y - p1.y;
+        const double bx = (double)p4.x - p3.x, by = (double)p4.y - p3.y;
+        const double cx = (double)p1.x - p3.x, cy = (double)p1.y - p3.y;
+        const double lenA = sqrt(ax*ax + ay*ay), lenB = sqrt(bx*bx + by*by);
+        const double den = by*ax - bx*ay;
+        const double sinAngle = fabs(den) / (lenA*lenB);
+        // error of a float hit along either segment, in world units
+        const double extent = fabs(p1.x) + fabs(p1.y) + fabs(p3.x) + fabs(p3.y) + sqrt(cx*cx + cy*cy) + lenA + lenB;
+        const double error = REF_EPS*extent / std::max(sinAngle, 1e-12);
+        if (sinAngle < 1e-9)
+        {
+            // parallel: the float version may still see them crossing if they are on the same line
+            const double dist = fabs(bx*cy - by*cx) / lenB;
+            return dist <= REF_EPS*extent ? REF_AMBIGUOUS : REF_MISS;
+        }
+        const double fx = (bx*cy - by*cx) / den;
+        const double fy = (ax*cy - ay*cx) / den;
+        const double mx = error / lenA, my = error / lenB;
+        if (fx < -mx || fx > 1.0 + mx || fy < -my || fy > 1.0 + my)
+            return REF_MISS;
+        if (fx <= mx || fx >= 1.0 - mx || fy <= my || fy >= 1.0 - my)
+            return REF_AMBIGUOUS;
+        out.m_frac = fx;
+        out.m_error = mx;
+        return REF_HIT;
+    }
+
+    RefResult RefRaySegment(const XMFLOAT2& origin, const XMFLOAT2& dir, const CollSegment& seg, RefHit& out)
+    {
+        // the float version builds its 1000 units segment in float, so does this
+        const XMFLOAT2 endP(origin.x + dir.x*1000.0f, origin.y + dir.y*1000.0f);
+        return RefSegments(origin, endP, seg.start, seg.end, out);
+    }
+
+    RefResult RefRaySphere(const XMFLOAT3& origin, const XMFLOAT3& dir, const XMFLOAT3& center, float radius, RefHit& out)
+    {
+        const RefV3 d(dir), L = RefV3(origin) - RefV3(center);
+        const double radiusSq = (double)radius*radius;
+        const double a = d.Dot(d), b = 2.0*d.Dot(L), c = L.Dot(L) - radiusSq;
+        const double discr = b*b - 4.0*a*c;
+        const double discrError = REF_EPS*(b*b + 4.0*a*(L.Dot(L) + radiusSq) + 4.0*a*(fabs(center.x) + fabs(center.y) + fabs(center.z))*L.Length());
+        if (discr < -discrError)
+            return REF_MISS;
+        if (discr <= discrError)
+            return REF_AMBIGUOUS;
+        const double sq = sqrt(discr);
+        const double tError = (sqrt(discr + discrError) - sq + REF_EPS*(fabs(b) + sq)) / (2.0*a);
+        const double t0 = (-b - sq) / (2.0*a), t1 = (-b + sq) / (2.0*a);
+        if (fabs(t0) <= tError || fabs(t1) <= tError)
+            return REF_AMBIGUOUS;
+        if (t1 < 0.0)
+            return REF_MISS;
+        out.m_frac = t0 >= 0.0 ? t0 : t1;
+        out.m_error = tError;
+        return REF_HIT;
+    }
+
+    RefResult RefRayPlane(const XMFLOAT3& origin, const XMFLOAT3& dir, const XMFLOAT3& normal, const XMFLOAT3& p, RefHit& out)
+    {
+        const RefV3 n(normal), d(dir);
+        const double den = n.Dot(d);
+        const double denError = REF_EPS*n.Length()*d.Length();
+        if (den >= -1e-6 + denError)
+            return REF_MISS;
+        if (den > -1e-6 - denError)
+            return REF_AMBIGUOUS;
+        // IntersectRayPlane divides the distance along the normalized direction to p, kept as is
+        const RefV3 po = RefV3(p) - RefV3(origin);
+        const double poLen = po.Length();
+        if (poLen == 0.0)
+            return REF_AMBIGUOUS;
+        const double f = po.Dot(n) / poLen / den;
+        const double fError = REF_EPS*(1.0 + fabs(f))*(1.0 + n.Length()*d.Length() / fabs(den));
+        if (fabs(f) <= fError)
+            return REF_AMBIGUOUS;
+        if (f < 0.0)
+            return REF_MISS;
+        out.m_frac = f;
+        out.m_error = fError;
+        return REF_HIT;
+    }
+
+    RefResult RefRayTriangle(const XMFLOAT3& P, const XMFLOAT3& w, const XMFLOAT3 V[3], RefHit& out)
+    {
+        const RefV3 v0(V[0]), e1 = RefV3(V[1]) - v0, e2 = RefV3(V[2]) - v0, dw(w);
+        const RefV3 q = dw.Cross(e2);
+        const double a = e1.Dot(q);
+        const RefV3 sp = RefV3(P) - v0;
+        const double extent = sp.Length() + fabs(V[0].x) + fabs(V[0].y) + fabs(V[0].z);
+        const double aError = REF_EPS*e1.Length()*dw.Length()*e2.Length();
+        if (fabs(a) <= 0.0001 - aError)
+            return REF_MISS;
+        if (fabs(a) <= 0.0001 + aError)
+            return REF_AMBIGUOUS;
+        const RefV3 s = sp*(1.0 / a);
+        const RefV3 r = s.Cross(e1);
+        const double bx = s.Dot(q), by = r.Dot(dw), bz = 1.0 - bx - by;
+        const double bError = REF_EPS*extent*dw.Length()*(e1.Length() + e2.Length()) / fabs(a);
+        if (bx < -bError || by < -bError || bz < -bError)
+            return REF_MISS;
+        if (bx <= bError || by <= bError || bz <= bError)
+            return REF_AMBIGUOUS;
+        const double t = e2.Dot(r);
+        const double tError = REF_EPS*extent*e1.Length()*e2.Length() / fabs(a)*(1.0 + bError);
+        if (fabs(t) <= tError)
+            return REF_AMBIGUOUS;
+        if (t < 0.0)
+            return REF_MISS;
+        out.m_frac = t;
+        out.m_error = tError;
+        return REF_HIT;
+    }
+
+    // the quad faces the camera yaw, split in the two triangles IntersectRayBillboardQuad tests
+    RefResult RefRayBillboardQuad(const XMFLOAT3& raypos, const XMFLOAT3& dir, const XMFLOAT3& center, const XMFLOAT2& size, float yaw, RefHit& out)
+    {
+        const double c = cos((double)yaw), s = sin((double)yaw);
+        XMFLOAT3 quad[4];
+        const float corners[4][2] = { { -0.5f,-0.5f },{ 0.5f,-0.5f },{ 0.5f,0.5f },{ -0.5f,0.5f } };
+        for (int i = 0; i < 4; ++i)
+        {
+            const double x = corners[i][0] * size.x, y = corners[i][1] * size.y;
+            quad[i] = XMFLOAT3((float)(x*c + center.x), (float)(y + center.y), (float)(-x*s + center.z));
+        }
+        const XMFLOAT3 tri0[3] = { quad[0], quad[2], quad[3] };
+        const XMFLOAT3 tri1[3] = { quad[0], quad[1], quad[2] };
+        const RefResult r0 = RefRayTriangle(raypos, dir, tri0, out);
+        if (r0 == REF_HIT)
+            return REF_HIT;
+        const RefResult r1 = RefRayTriangle(raypos, dir, tri1, out);
+        // on the diagonal either triangle takes it, at the same frac
+        if (r1 == REF_HIT)
+            return REF_HIT;
+        return r0 == REF_AMBIGUOUS || r1 == REF_AMBIGUOUS ? REF_AMBIGUOUS : REF_MISS;
+    }
+
+    // CollisionAndSolving2D in double. Ambiguous when the float version could pick another wall
+    // (two hits within the error of each other) or slide the other way along it
+    bool RefCollisionAndSolving2D(const SegmentList& segs, const XMFLOAT2& curPos, const XMFLOAT2& nextPos, float radius, int iter, XMFLOAT2& out, double& outError)
+    {
+        if (segs.empty() || iter == 0)
+        {
+            out = nextPos;
+            return true;
+        }
+        const double fx0 = (double)nextPos.x - curPos.x, fy0 = (double)nextPos.y - curPos.y;
+        const double len = sqrt(fx0*fx0 + fy0*fy0);
+        if (len == 0.0)
+        {
+            out = nextPos;
+            return true;
+        }
+        const double fx = fx0 / len, fy = fy0 / len;
+        const double ext = len + radius;
+        const double cx = curPos.x, cy = curPos.y;
+        const double rays[3][2] = { { cx - fy*radius, cy + fx*radius },{ cx, cy },{ cx + fy*radius, cy - fx*radius } };
+
+        double minFrac = DBL_MAX, minError = 0.0;
+        int closest = -1;
+        bool tie = false;
+        for (size_t j = 0; j < segs.size(); ++j)
+        {
+            const auto& seg = segs[j];
+            if (seg.IsDisabled())
+                continue;
+            for (int i = 0; i < 3; ++i)
+            {
+                const XMFLOAT2 p1((float)rays[i][0], (float)rays[i][1]);
+                const XMFLOAT2 p2((float)(rays[i][0] + fx*ext), (float)(rays[i][1] + fy*ext));
+                RefHit hit;
+                const RefResult r = RefSegments(p1, p2, seg.start, seg.end, hit);
+                if (r == REF_AMBIGUOUS)
+                {
+                    tie = true;
+                    continue;
+                }
+                if (r != REF_HIT)
+                    continue;
+                if (closest != -1 && closest != (int)j && fabs(hit.m_frac - minFrac) <= hit.m_error + minError)
+                    tie = true;
+                if (hit.m_frac < minFrac)
+                {
+                    minFrac = hit.m_frac;
+                    minError = hit.m_error;
+                    closest = (int)j;
+                }
+            }
+        }
+        // tie only matters when the winner could change to another wall
+        if (tie && closest != -1)
+            return false;
+        if (closest == -1)
+        {
+            if (tie)
+                return false;
+            out = nextPos;
+            return true;
+        }
+
+        const auto& seg = segs[(size_t)closest];
+        const double wx = (double)seg.end.x - seg.start.x, wy = (double)seg.end.y - seg.start.y;
+        const double wl = sqrt(wx*wx + wy*wy);
+        const double t = (wx*fx + wy*fy) / wl;
+        if (fabs(t) <= 1e-5)
+            return false;
+        const double sign = t > 0.0 ? 1.0 : -1.0;
+        const XMFLOAT2 slid((float)(cx + wx / wl*len*sign), (float)(cy + wy / wl*len*sign));
+        outError += 1e-5*(1.0 + len);
+        return RefCollisionAndSolving2D(segs, curPos, slid, radius, iter - 1, out, outError);
+    }
+
+    struct CollisionCheck
+    {
+        const wchar_t* m_name;
+        const wchar_t* m_knownDefect; // reported, but doesn't fail the check until the primitive is fixed
+        size_t m_queries, m_hits, m_ambiguous, m_mismatches;
+        double m_maxError; // worst float frac error, in units of the allowed error
+
+        explicit CollisionCheck(const wchar_t* name, const wchar_t* knownDefect = nullptr) :
+            m_name(name), m_knownDefect(knownDefect), m_queries(0), m_hits(0), m_ambiguous(0), m_mismatches(0), m_maxError(0.0) {}
+
+        void Add(bool hit, float frac, RefResult ref, const RefHit& refHit)
+        {
+            ++m_queries;
+            if (ref == REF_AMBIGUOUS)
+            {
+                ++m_ambiguous;
+                return;
+            }
+            if (hit != (ref == REF_HIT))
+            {
+                ++m_mismatches;
+                return;
+            }
+            if (!hit)
+                return;
+            ++m_hits;
+            const double error = fabs((double)frac - refHit.m_frac) / (refHit.m_error + 1e-6*(1.0 + fabs(refHit.m_frac)));
+            m_maxError = std::max(m_maxError, error);
+            if (error > 1.0)
+                ++m_mismatches;
+        }
+
+        bool Print() const
+        {
+            wchar_t buff[256];
+            swprintf_s(buff, L"  %-22s %7zu queries %7zu hits %6zu ambiguous  max error %.3f\n", m_name, m_queries, m_hits, m_ambiguous, m_maxError);
+            OutputDebugStringW(buff);
+            if (m_mismatches && m_knownDefect)
+            {
+                swprintf_s(buff, L"KNOWN DEFECT: %zu %s queries differ from the double precision reference, %s\n", m_mismatches, m_name, m_knownDefect);
+                OutputDebugStringW(buff);
+                return true;
+            }
+            if (m_mismatches)
+            {
+                swprintf_s(buff, L"ERROR: %zu %s queries differ from the double precision reference\n", m_mismatches, m_name);
+                OutputDebugStringW(buff);
+            }
+            return m_mismatches == 0;
+        }
+    };
+}
+
+void Benchmarks::Collision()
+{
+    // the CollisionAndSolving primitives over the scenes above, ns per query and queries per
+    // second, then the cross-check of the same scenes
+    const CollisionScenes scenes;
+    wchar_t buff[256];
+    size_t sink = 0;
+    auto report = [&buff, &sink](const wchar_t* name, __int64 us, size_t count)
+    {
+        Report(name, us, count);
+        swprintf_s(buff, L"  %.2f M queries/s (%zu)\n", us ? (double)count / (double)us : 0.0, sink);
+        OutputDebugStringW(buff);
+    };
+    XMFLOAT2 hit2;
+    XMFLOAT3 hit3;
+    float frac;
+
+    // ray against every segment of the soup, keeping the closest (LevelMap::RaycastSeg)
+    report(L"Ray/segment soup", time_call_us([&]
+    {
+        for (const auto& ray : scenes.m_soupRays)
+        {
+            float minFrac = FLT_MAX;
+            for (const auto& seg : scenes.m_soup)
+            {
+                if (IntersectRaySegment(ray.m_origin, ray.m_dir, seg, hit2, frac) && frac < minFrac)
+                    minFrac = frac;
+            }
+            sink += minFrac != FLT_MAX;
+        }
+    }), scenes.m_soupRays.size()*scenes.m_soup.size());
+
+    // a camera move per query against the whole room
+    static const float CAMERA_RADIUS = 0.25f;
+    report(L"Solve2D pillar room", time_call_us([&]
+    {
+        for (const auto& move : scenes.m_roomMoves)
+        {
+            const XMFLOAT2 solved = CollisionAndSolving2D(&scenes.m_room, move.m_cur, move.m_next, CAMERA_RADIUS);
+            sink += solved.x != move.m_next.x || solved.y != move.m_next.y;
+        }
+    }), scenes.m_roomMoves.size());
+
+    // every billboard of the field per ray: the bounding sphere alone, the quad alone and the
+    // sphere then quad of EntityManager::RaycastEntity
+    const size_t fieldQueries = scenes.m_fieldRays.size()*scenes.m_field.size();
+    report(L"Ray/sphere field", time_call_us([&]
+    {
+        for (const auto& ray : scenes.m_fieldRays)
+        {
+            for (const auto& b : scenes.m_field)
+                sink += IntersectRaySphere(ray.m_origin, ray.m_dir, b.m_pos, b.m_radius, hit3, frac);
+        }
+    }), fieldQueries);
+    report(L"Ray/billboard field", time_call_us([&]
+    {
+        for (const auto& ray : scenes.m_fieldRays)
+        {
+            for (const auto& b : scenes.m_field)
+                sink += IntersectRayBillboardQuad(ray.m_origin, ray.m_dir, b.m_pos, b.m_size, hit3, frac);
+        }
+    }), fieldQueries);
+    report(L"Ray/entity field", time_call_us([&]
+    {
+        for (const auto& ray : scenes.m_fieldRays)
+        {
+            for (const auto& b : scenes.m_field)
+            {
+                sink += IntersectRaySphere(ray.m_origin, ray.m_dir, b.m_pos, b.m_radius, hit3, frac)
+                    && IntersectRayBillboardQuad(ray.m_origin, ray.m_dir, b.m_pos, b.m_size, hit3, frac);
+            }
+        }
+    }), fieldQueries);
+    report(L"Ray/floor plane", time_call_us([&]
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            for (const auto& ray : scenes.m_fieldRays)
+                sink += IntersectRayPlane(ray.m_origin, ray.m_dir, XM3Up(), XM3Zero(), hit3, frac);
+        }
+    }), 64 * scenes.m_fieldRays.size());
+
+    // the badly conditioned cases
+    const size_t grazingQueries = CollisionScenes::GRAZING_QUERIES;
+    report(L"Ray/segment grazing", time_call_us([&]
+    {
+        for (size_t i = 0; i < grazingQueries; ++i)
+            sink += IntersectRaySegment(scenes.m_grazingSegRays[i].m_origin, scenes.m_grazingSegRays[i].m_dir, scenes.m_grazingSegs[i], hit2, frac);
+    }), grazingQueries);
+    report(L"Ray/sphere tangent", time_call_us([&]
+    {
+        for (size_t i = 0; i < grazingQueries; ++i)
+        {
+            const auto& ray = scenes.m_grazingRays[i];
+            sink += IntersectRaySphere(ray.m_origin, ray.m_dir, scenes.m_grazingSpheres[i].m_center, scenes.m_grazingSpheres[i].m_radius, hit3, frac);
+        }
+    }), grazingQueries);
+    report(L"Ray/triangle grazing", time_call_us([&]
+    {
+        for (size_t i = 0; i < grazingQueries; ++i)
+        {
+            const auto& ray = scenes.m_grazingRays[i];
+            XMFLOAT3 bar;
+            sink += IntersectRayTriangle(ray.m_origin, ray.m_dir, scenes.m_grazingTriangles[i].m_v, bar, frac);
+        }
+    }), grazingQueries);
+    report(L"Ray/plane grazing", time_call_us([&]
+    {
+        for (size_t i = 0; i < grazingQueries; ++i)
+        {
+            const auto& ray = scenes.m_grazingRays[i];
+            sink += IntersectRayPlane(ray.m_origin, ray.m_dir, scenes.m_grazingPlaneNormals[i], scenes.m_grazingTriangles[i].m_v[0], hit3, frac);
+        }
+    }), grazingQueries);
+
+    CollisionCrossCheck();
+}
+
+bool Benchmarks::CollisionCrossCheck()
+{
+    // every query of the collision scenes against the double precision references, no timings.
+    // Also on its own (key F4) to validate a replacement of a primitive without the whole suite
+    const CollisionScenes scenes;
+    const float yaw = DX::GameResources::instance->m_camera.m_pitchYaw.y;
+    OutputDebugStringW(L"Collision cross-check\n");
+    XMFLOAT2 hit2;
+    XMFLOAT3 hit3, bar;
+    float frac;
+    RefHit ref;
+    bool ok = true;
+
+    {
+        CollisionCheck check(L"ray/segment soup");
+        for (const auto& ray : scenes.m_soupRays)
+        {
+            for (const auto& seg : scenes.m_soup)
+            {
+                const bool hit = IntersectRaySegment(ray.m_origin, ray.m_dir, seg, hit2, frac);
+                check.Add(hit, frac, RefRaySegment(ray.m_origin, ray.m_dir, seg, ref), ref);
+            }
+        }
+        for (size_t i = 0; i < scenes.m_grazingSegs.size(); ++i)
+        {
+            const auto& ray = scenes.m_grazingSegRays[i];
+            const bool hit = IntersectRaySegment(ray.m_origin, ray.m_dir, scenes.m_grazingSegs[i], hit2, frac);
+            check.Add(hit, frac, RefRaySegment(ray.m_origin, ray.m_dir, scenes.m_grazingSegs[i], ref), ref);
+        }
+        ok &= check.Print();
+    }
+
+    {
+        // the solved position, not a frac; hits are the moves that touched a wall
+        static const float CAMERA_RADIUS = 0.25f;
+        CollisionCheck check(L"solve2D pillar room");
+        for (const auto& move : scenes.m_roomMoves)
+        {
+            XMFLOAT2 refPos;
+            double refError = 0.0;
+            const XMFLOAT2 solved = CollisionAndSolving2D(&scenes.m_room, move.m_cur, move.m_next, CAMERA_RADIUS);
+            ++check.m_queries;
+            if (!RefCollisionAndSolving2D(scenes.m_room, move.m_cur, move.m_next, CAMERA_RADIUS, 3, refPos, refError))
+            {
+                ++check.m_ambiguous;
+                continue;
+            }
+            check.m_hits += solved.x != move.m_next.x || solved.y != move.m_next.y;
+            const double dx = (double)solved.x - refPos.x, dy = (double)solved.y - refPos.y;
+            const double error = sqrt(dx*dx + dy*dy) / (refError + 1e-5);
+            check.m_maxError = std::max(check.m_maxError, error);
+            check.m_mismatches += error > 1.0;
+        }
+        ok &= check.Print();
+    }
+
+    {
+        CollisionCheck sphere(L"ray/sphere", L"IntersectRaySphere subtracts the radius where the squared radius belongs");
+        CollisionCheck quad(L"ray/billboard"), plane(L"ray/plane");
+        for (const auto& ray : scenes.m_fieldRays)
+        {
+            for (const auto& b : scenes.m_field)
+            {
+                bool hit = IntersectRaySphere(ray.m_origin, ray.m_dir, b.m_pos, b.m_radius, hit3, frac);
+                sphere.Add(hit, frac, RefRaySphere(ray.m_origin, ray.m_dir, b.m_pos, b.m_radius, ref), ref);
+                hit = IntersectRayBillboardQuad(ray.m_origin, ray.m_dir, b.m_pos, b.m_size, hit3, frac);
+                quad.Add(hit, frac, RefRayBillboardQuad(ray.m_origin, ray.m_dir, b.m_pos, b.m_size, yaw, ref), ref);
+            }
+            const bool hit = IntersectRayPlane(ray.m_origin, ray.m_dir, XM3Up(), XM3Zero(), hit3, frac);
+            plane.Add(hit, frac, RefRayPlane(ray.m_origin, ray.m_dir, XM3Up(), XM3Zero(), ref), ref);
+        }
+        CollisionCheck triangle(L"ray/triangle grazing");
+        for (size_t i = 0; i < scenes.m_grazingRays.size(); ++i)
+        {
+            const auto& ray = scenes.m_grazingRays[i];
+            const auto& s = scenes.m_grazingSpheres[i];
+            const auto& tri = scenes.m_grazingTriangles[i];
+            bool hit = IntersectRaySphere(ray.m_origin, ray.m_dir, s.m_center, s.m_radius, hit3, frac);
+            sphere.Add(hit, frac, RefRaySphere(ray.m_origin, ray.m_dir, s.m_center, s.m_radius, ref), ref);
+            hit = IntersectRayTriangle(ray.m_origin, ray.m_dir, tri.m_v, bar, frac);
+            triangle.Add(hit, frac, RefRayTriangle(ray.m_origin, ray.m_dir, tri.m_v, ref), ref);
+            hit = IntersectRayPlane(ray.m_origin, ray.m_dir, scenes.m_grazingPlaneNormals[i], tri.m_v[0], hit3, frac);
+            plane.Add(hit, frac, RefRayPlane(ray.m_origin, ray.m_dir, scenes.m_grazingPlaneNormals[i], tri.m_v[0], ref), ref);
+        }
+        ok &= sphere.Print();
+        ok &= quad.Print();
+        ok &= triangle.Print();
+        ok &= plane.Print();
+    }
+    return ok;
+}
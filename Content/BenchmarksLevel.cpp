@@ -0,0 +1,109 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+#include "GlobalFlags.h"
+
+#include <random>
+
+using namespace SpookyAdulthood;
+
+void Benchmarks::Random()
+{
+    static const size_t N = 1 << 22;
+    std::vector<uint32_t> ints(N);
+    std::vector<float> floats(N);
+    volatile uint32_t sink = 0;
+
+    // old provider, for reference
+    Report(L"mt19937 uniform_int", time_call_us([&]
+    {
+        std::mt19937 gen(RANDOM_DEFAULT_SEED);
+        for (size_t i = 0; i < N; ++i)
+            ints[i] = std::uniform_int_distribution<uint32_t>(0, 99)(gen);
+    }), N);
+
+    Report(L"RandomProvider::Get", time_call_us([&]
+    {
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        for (size_t i = 0; i < N; ++i)
+            ints[i] = rnd.Get(0, 99);
+    }), N);
+
+    Report(L"RandomProvider::Fill", time_call_us([&]
+    {
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        rnd.Fill(ints.data(), N, 0, 99);
+    }), N);
+
+    Report(L"RandomProvider::GetF", time_call_us([&]
+    {
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        for (size_t i = 0; i < N; ++i)
+            floats[i] = rnd.GetF(-1.0f, 1.0f);
+    }), N);
+
+    Report(L"RandomProvider::FillF", time_call_us([&]
+    {
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        rnd.FillF(floats.data(), N, -1.0f, 1.0f);
+    }), N);
+
+    Report(L"RandomProvider::Split", time_call_us([&]
+    {
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        uint32_t acc = 0;
+        for (size_t i = 0; i < N; ++i)
+            acc += rnd.Split((uint32_t)i).Next();
+        sink = acc;
+    }), N);
+}
+
+void Benchmarks::LevelGeneration(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    // big map, deep recursion, so there's enough work to split
+    LevelMapGenerationSettings settings;
+    settings.m_tileCount = XMUINT2(1024, 1024);
+    settings.m_maxRecursiveDepth = 24;
+    settings.m_generateThumbTex = false;
+    const DX::RandomProvider levelStream(RANDOM_DEFAULT_SEED);
+
+    const unsigned int cores = concurrency::GetProcessorCount();
+    for (unsigned int n = 1; ; n = (std::min)(n * 2, cores))
+    {
+        concurrency::CurrentScheduler::Create(concurrency::SchedulerPolicy(2, 
+            concurrency::MinConcurrency, 1, concurrency::MaxConcurrency, n));
+        LevelMap map(device);
+        const __int64 us = time_call_us([&] { map.GenerateBSP(settings, levelStream); });
+        concurrency::CurrentScheduler::Detach();
+
+        wchar_t name[64];
+        swprintf_s(name, L"LevelMap::GenerateBSP %u cores", n);
+        Report(name, us, map.GetRooms().size());
+        if (n == cores)
+            break;
+    }
+}
+
+void Benchmarks::LevelCache(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    LevelMapGenerationSettings settings;
+    settings.m_tileCount = XMUINT2(256, 256);
+    settings.m_generateThumbTex = false;
+    settings.m_useCache = false;
+    const uint32_t levelSeed = RANDOM_DEFAULT_SEED;
+    const std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path->Data()) + L"\\benchmark.lvc";
+
+    LevelMap generated(device), loaded(device);
+    Report(L"LevelMap::Generate", time_call_us([&] { generated.Generate(settings, levelSeed); }), generated.GetRooms().size());
+
+    bool ok = true;
+    Report(L"LevelMap::SaveCache", time_call_us([&] { ok = generated.SaveCache(path, settings); }), generated.GetRooms().size());
+    if (!ok)
+    {
+        OutputDebugStringW(L"ERROR: cannot write the level cache\n");
+        return;
+    }
+    Report(L"LevelMap::LoadCache", time_call_us([&] { ok = loaded.LoadCache(path, settings); }), loaded.GetRooms().size());
+    if (!ok)
+        OutputDebugStringW(L"ERROR: cannot load the level cache\n");
+}
@@ -0,0 +1,180 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+#include "GlobalFlags.h"
+
+using namespace SpookyAdulthood;
+
+void Benchmarks::FrameAllocation()
+{
+    // a frame's worth of transient sprite lists (no reserve, like the game's scratch vectors) on the
+    // heap vs on the frame arena. Runs from SceneRenderer::Update, between frames, when nothing
+    // frame scoped is alive, so advancing the frame here is safe
+    static const int FRAMES = 256;
+    static const int WARMUP = 8;
+    static const int LISTS = 64;
+    static const int ITEMS = 256;
+    size_t sink = 0;
+    auto fill = [&sink](auto& sprites, int list)
+    {
+        SpriteRender sprR = {};
+        for (int i = 0; i < ITEMS; ++i)
+        {
+            sprR.m_position = XMFLOAT3((float)i, 0.0f, (float)list);
+            sprR.m_index = (size_t)(list*ITEMS + i);
+            sprites.push_back(sprR);
+        }
+        sink += sprites.back().m_index;
+    };
+
+    const uint64_t heapBefore = DX::GetThreadHeapAllocations();
+    const __int64 heapUs = time_call_us([&]
+    {
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            for (int l = 0; l < LISTS; ++l)
+            {
+                std::vector<SpriteRender> sprites;
+                fill(sprites, l);
+            }
+        }
+    });
+    const uint64_t heapAllocs = DX::GetThreadHeapAllocations() - heapBefore;
+
+    auto arenaFrame = [&]
+    {
+        for (int l = 0; l < LISTS; ++l)
+        {
+            DX::FrameVector<SpriteRender> sprites;
+            fill(sprites, l);
+        }
+        DX::FrameArena::EndFrame();
+    };
+    for (int f = 0; f < WARMUP; ++f)
+        arenaFrame();
+    const uint64_t arenaBefore = DX::GetThreadHeapAllocations();
+    const __int64 arenaUs = time_call_us([&]
+    {
+        for (int f = WARMUP; f < FRAMES; ++f)
+            arenaFrame();
+    });
+    const uint64_t arenaAllocs = DX::GetThreadHeapAllocations() - arenaBefore;
+
+    Report(L"Frame lists heap", heapUs, (size_t)FRAMES*LISTS*ITEMS);
+    Report(L"Frame lists arena", arenaUs, (size_t)(FRAMES - WARMUP)*LISTS*ITEMS);
+    wchar_t buff[256];
+    const auto& stats = DX::FrameArena::Get().GetStats();
+    swprintf_s(buff, L"  heap %.1f allocs/frame, arena %.1f allocs/frame after warm up, %u blocks %.1f KB (%zu)\n",
+        (double)heapAllocs / FRAMES, (double)arenaAllocs / (FRAMES - WARMUP), stats.m_blocks, stats.m_capacity / 1024.0, sink);
+    OutputDebugStringW(buff);
+
+    // the same lists built on the pool, each worker on its own arena. A worker may still grow its
+    // arena the first times it runs (heap, but counted as blocks), anything else is a leak to the heap.
+    // Tests/MemoryTests.cpp fails on either leak, here they are only reported
+    std::atomic<uint32_t> workerHeapLists(0);
+    std::atomic<size_t> workerSink(0);
+    const uint32_t blocksBefore = DX::FrameArena::GetTotalBlocks();
+    const __int64 parallelUs = time_call_us([&]
+    {
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            concurrency::parallel_for(0, LISTS, [&](int l)
+            {
+                auto& arena = DX::FrameArena::Get();
+                const uint32_t blocks = arena.GetStats().m_blocks;
+                const uint64_t heap = DX::GetThreadHeapAllocations();
+                {
+                    DX::FrameVector<SpriteRender> sprites;
+                    SpriteRender sprR = {};
+                    for (int i = 0; i < ITEMS; ++i)
+                    {
+                        sprR.m_index = (size_t)(l*ITEMS + i);
+                        sprites.push_back(sprR);
+                    }
+                    workerSink += sprites.back().m_index;
+                }
+                if (DX::GetThreadHeapAllocations() != heap && arena.GetStats().m_blocks == blocks)
+                    ++workerHeapLists;
+            });
+            DX::FrameArena::EndFrame();
+        }
+    });
+    Report(L"Frame lists arena parallel", parallelUs, (size_t)FRAMES*LISTS*ITEMS);
+    swprintf_s(buff, L"  %u arena blocks added by the workers, %u lists on the heap (%zu)\n",
+        DX::FrameArena::GetTotalBlocks() - blocksBefore, workerHeapLists.load(), workerSink.load());
+    OutputDebugStringW(buff);
+}
+
+void Benchmarks::MemoryAccounting(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    DX::MemorySnapshot before, during, after;
+    DX::MemoryTracker::GetSnapshot(before);
+    if (!before.m_tracking)
+    {
+        OutputDebugStringW(L"Memory tracking compiled out\n");
+        return;
+    }
+    wchar_t buff[256];
+
+    // tracked operator new/delete, small blocks
+    static const size_t N = 1 << 18;
+    std::vector<void*> blocks(N);
+    const __int64 allocUs = time_call_us([&]
+    {
+        DX::MemoryTagScope tag(DX::MEMTAG_ENTITIES);
+        for (size_t i = 0; i < N; ++i)
+            blocks[i] = ::operator new(16 + (i & 63));
+    });
+    const __int64 freeUs = time_call_us([&]
+    {
+        for (size_t i = 0; i < N; ++i)
+            ::operator delete(blocks[i]);
+    });
+    Report(L"Tracked operator new", allocUs, N);
+    Report(L"Tracked operator delete", freeUs, N);
+
+    // a container tag wins over the thread's
+    {
+        DX::MemoryTagScope tag(DX::MEMTAG_LEVELMAP);
+        DX::MemoryTracker::GetSnapshot(before);
+        std::vector<int, DX::TaggedAllocator<int, DX::MEMTAG_SPRITES>> tagged;
+        tagged.reserve(1000);
+        DX::MemoryTracker::GetSnapshot(during);
+        if (during.m_tags[DX::MEMTAG_SPRITES].m_liveBytes - before.m_tags[DX::MEMTAG_SPRITES].m_liveBytes != (int64_t)(1000 * sizeof(int)))
+            OutputDebugStringW(L"ERROR: TaggedAllocator block not accounted to its tag\n");
+    }
+
+    // a whole level is LevelMap memory, and all of it goes away with the map. The background
+    // level must be done so it doesn't move the counters meanwhile
+    auto gameRes = device->GetGameResources();
+    if (gameRes->m_nextMapPending)
+    {
+        try { gameRes->m_nextMapTask.wait(); }
+        catch (...) {}
+    }
+    LevelMapGenerationSettings settings;
+    settings.m_tileCount = XMUINT2(256, 256);
+    settings.m_useCache = false;
+    DX::MemoryTracker::GetSnapshot(before);
+    {
+        LevelMap map(device);
+        map.Generate(settings, RANDOM_DEFAULT_SEED);
+        DX::MemoryTracker::GetSnapshot(during);
+    }
+    DX::MemoryTracker::GetSnapshot(after);
+
+    const auto& b = before.m_tags[DX::MEMTAG_LEVELMAP];
+    const auto& d = during.m_tags[DX::MEMTAG_LEVELMAP];
+    const auto& a = after.m_tags[DX::MEMTAG_LEVELMAP];
+    swprintf_s(buff, L"  256x256 level: %.1f KB in %lld blocks, peak %.1f KB\n",
+        (d.m_liveBytes - b.m_liveBytes) / 1024.0, d.m_liveAllocations - b.m_liveAllocations, d.m_peakBytes / 1024.0);
+    OutputDebugStringW(buff);
+    if (d.m_liveBytes <= b.m_liveBytes)
+        OutputDebugStringW(L"ERROR: level generation not accounted to LevelMap\n");
+    if (a.m_liveBytes != b.m_liveBytes || a.m_liveAllocations != b.m_liveAllocations)
+    {
+        swprintf_s(buff, L"ERROR: %lld LevelMap bytes (%lld blocks) still alive after the map\n",
+            a.m_liveBytes - b.m_liveBytes, a.m_liveAllocations - b.m_liveAllocations);
+        OutputDebugStringW(buff);
+    }
+}
@@ -0,0 +1,364 @@
+﻿#include "pch.h"
+#include "Benchmarks.h"
+#include "../Common/DeviceResources.h"
+#include "GlobalFlags.h"
+#include "../Common/DirectXHelper.h"
+#include "../DirectXTK/Inc/SpriteBatchKernels.h"
+#include "../DirectXTK/Inc/MeshOptimizer.h"
+#include "ShaderStructures.h"
+
+using namespace SpookyAdulthood;
+
+void Benchmarks::SpriteBatching()
+{
+    // 100k sprites through the SpriteBatch CPU stages, no device: the std::sort it used to do vs
+    // keys + radix sort, and one sprite at a time vs four at once vertex expansion
+    using SpriteBatchKernels::SpriteInfo;
+    static const size_t N = 100000;
+    static const int ROUNDS = 10;
+    const XMVECTOR textureSize = XMVectorSet(512.0f, 512.0f, 0.0f, 0.0f);
+    const XMVECTOR inverseTextureSize = XMVectorReciprocal(textureSize);
+    auto fakeTexture = [](uint32_t t) { return reinterpret_cast<ID3D11ShaderResourceView*>((uintptr_t)(t + 1) * 256); };
+
+    std::unique_ptr<SpriteInfo, decltype(&_aligned_free)> storage((SpriteInfo*)_aligned_malloc(sizeof(SpriteInfo)*N, __alignof(SpriteInfo)), &_aligned_free);
+    DX::ThrowIfFalse(storage != nullptr);
+    SpriteInfo* sprites = storage.get();
+    std::vector<const SpriteInfo*> queue(N), sorted(N);
+    std::vector<uint32_t> textureIds(N), indices(N), scratch(N);
+    std::vector<uint64_t> keys(N);
+    std::vector<VertexPositionColorTexture> scalar(N * SpriteBatchKernels::VerticesPerSprite), simd(scalar.size());
+
+    for (int workload = 0; workload < 2; ++workload)
+    {
+        // HUD: atlas rects in texels, few layers, no rotation. Particles: whole textures, rotated, any depth
+        const bool hud = workload == 0;
+        const SpriteSortMode mode = hud ? SpriteSortMode_BackToFrontTexture : SpriteSortMode_BackToFront;
+        DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+        for (size_t i = 0; i < N; ++i)
+        {
+            SpriteInfo& sp = sprites[i];
+            if (hud)
+            {
+                sp.source = XMFLOAT4A((float)rnd.Get(0, 15) * 32.0f, (float)rnd.Get(0, 15) * 32.0f, 32.0f, 32.0f);
+                sp.destination = XMFLOAT4A(rnd.GetF(0.0f, 1920.0f), rnd.GetF(0.0f, 1080.0f), 32.0f, 32.0f);
+                sp.originRotationDepth = XMFLOAT4A(0.0f, 0.0f, 0.0f, (float)rnd.Get(0, 3) * 0.25f);
+                sp.texture = fakeTexture(rnd.Get(0, 7));
+                sp.flags = SpriteInfo::SourceInTexels | SpriteInfo::DestSizeInPixels;
+            }
+            else
+            {
+                const float scale = rnd.GetF(0.01f, 0.1f);
+                sp.source = XMFLOAT4A(0.0f, 0.0f, 1.0f, 1.0f);
+                sp.destination = XMFLOAT4A(rnd.GetF(0.0f, 1920.0f), rnd.GetF(0.0f, 1080.0f), scale, scale);
+                sp.originRotationDepth = XMFLOAT4A(256.0f, 256.0f, rnd.GetF(-XM_PI, XM_PI), rnd.GetF(0.0f, 1.0f));
+                sp.texture = fakeTexture((uint32_t)(i / 2500) % 4);
+                sp.flags = (int)rnd.Get(0, SpriteEffects_FlipBoth);
+            }
+            sp.color = XMFLOAT4A(rnd.GetF(0.0f, 1.0f), rnd.GetF(0.0f, 1.0f), rnd.GetF(0.0f, 1.0f), 1.0f);
+            queue[i] = &sp;
+        }
+
+        const __int64 stdSortUs = time_call_us([&]
+        {
+            for (int r = 0; r < ROUNDS; ++r)
+            {
+                sorted = queue;
+                std::sort(sorted.begin(), sorted.end(), [](const SpriteInfo* x, const SpriteInfo* y)
+                {
+                    return x->originRotationDepth.w > y->originRotationDepth.w;
+                });
+            }
+        });
+        const __int64 radixUs = time_call_us([&]
+        {
+            for (int r = 0; r < ROUNDS; ++r)
+            {
+                const bool withTextures = mode == SpriteSortMode_BackToFrontTexture;
+                if (withTextures)
+                    SpriteBatchKernels::AssignTextureIds(queue.data(), N, textureIds.data());
+                SpriteBatchKernels::BuildSortKeys(queue.data(), withTextures ? textureIds.data() : nullptr, N, mode, keys.data());
+                SpriteBatchKernels::RadixSortIndices(keys.data(), N, indices.data(), scratch.data());
+                for (size_t i = 0; i < N; ++i)
+                    sorted[i] = queue[indices[i]];
+            }
+        });
+
+        size_t batches = 1;
+        for (size_t i = 1; i < N; ++i)
+            batches += sorted[i]->texture != sorted[i - 1]->texture ? 1 : 0;
+
+        const __int64 scalarUs = time_call_us([&]
+        {
+            for (int r = 0; r < ROUNDS; ++r)
+            {
+                for (size_t i = 0; i < N; ++i)
+                    SpriteBatchKernels::ExpandSprite(sorted[i], textureSize, inverseTextureSize, &scalar[i * SpriteBatchKernels::VerticesPerSprite]);
+            }
+        });
+        const __int64 simdUs = time_call_us([&]
+        {
+            for (int r = 0; r < ROUNDS; ++r)
+                SpriteBatchKernels::ExpandSprites(sorted.data(), N, textureSize, inverseTextureSize, simd.data());
+        });
+
+        const wchar_t* workloadName = hud ? L"HUD" : L"particles";
+        wchar_t name[64];
+        swprintf_s(name, L"Sprite %s std::sort", workloadName);
+        Report(name, stdSortUs / ROUNDS, N);
+        swprintf_s(name, L"Sprite %s radix sort", workloadName);
+        Report(name, radixUs / ROUNDS, N);
+        swprintf_s(name, L"Sprite %s expand scalar", workloadName);
+        Report(name, scalarUs / ROUNDS, N);
+        swprintf_s(name, L"Sprite %s expand SIMD", workloadName);
+        Report(name, simdUs / ROUNDS, N);
+
+        wchar_t buff[256];
+        swprintf_s(buff, L"  %s: %zu texture changes after the keyed sort\n", workloadName, batches);
+        OutputDebugStringW(buff);
+    }
+}
+
+void Benchmarks::SpriteFontText(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    // a long console page through each text stage, per glyph. The batch records into a deferred
+    // context whose command list is thrown away, so nothing reaches the screen
+    auto font = device->GetGameResources()->m_fontConsole.get();
+    if (!font) return;
+    static const int LINES = 200;
+    static const int COLUMNS = 120;
+    static const int ROUNDS = 10;
+    const size_t glyphs = (size_t)LINES * COLUMNS;
+
+    // mostly ASCII with some Latin-1, only characters the font has
+    std::vector<wchar_t> ascii, latin1;
+    std::vector<SpriteFont::Glyph> sorted;
+    for (uint32_t c = 0; c <= 0xffff; ++c)
+    {
+        if (!font->ContainsCharacter((wchar_t)c)) continue;
+        sorted.push_back(*font->FindGlyph((wchar_t)c));
+        if (c > 0x20 && c < 0x7f) ascii.push_back((wchar_t)c);
+        else if (c > 0xa0 && c <= 0xff) latin1.push_back((wchar_t)c);
+    }
+    if (ascii.empty()) return;
+    DX::RandomProvider rnd(RANDOM_DEFAULT_SEED);
+    std::wstring text;
+    for (int l = 0; l < LINES; ++l)
+    {
+        for (int c = 0; c < COLUMNS; ++c)
+        {
+            const auto& set = (!latin1.empty() && rnd.Get(0, 15) == 0) ? latin1 : ascii;
+            text += set[rnd.Get(0, (uint32_t)set.size() - 1)];
+        }
+        text += L'\n';
+    }
+
+    // what FindGlyph did before: a binary search per character
+    float searchSum = 0.0f, tableSum = 0.0f;
+    const __int64 searchUs = time_call_us([&]
+    {
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            for (wchar_t ch : text)
+            {
+                auto it = std::lower_bound(sorted.begin(), sorted.end(), ch, [](const SpriteFont::Glyph& g, wchar_t c) { return g.Character < (uint32_t)c; });
+                if (it != sorted.end() && it->Character == (uint32_t)ch) searchSum += it->XAdvance;
+            }
+        }
+    });
+    const __int64 tableUs = time_call_us([&]
+    {
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            for (wchar_t ch : text)
+            {
+                if (font->ContainsCharacter(ch)) tableSum += font->FindGlyph(ch)->XAdvance;
+            }
+        }
+    });
+
+    XMVECTOR measured = XMVectorZero();
+    const __int64 measureUs = time_call_us([&]
+    {
+        for (int r = 0; r < ROUNDS; ++r)
+            measured = font->MeasureString(text.c_str());
+    });
+    TextLayout layout;
+    const __int64 layoutUs = time_call_us([&]
+    {
+        for (int r = 0; r < ROUNDS; ++r)
+            layout = font->LayoutString(text.c_str());
+    });
+
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> deferred;
+    DX::ThrowIfFailed(device->GetD3DDevice()->CreateDeferredContext(0, &deferred));
+    SpriteBatch batch(deferred.Get());
+    batch.SetViewport(CD3D11_VIEWPORT(0.0f, 0.0f, 1920.0f, 1080.0f));
+    const __int64 drawUs = time_call_us([&]
+    {
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            batch.Begin();
+            font->DrawString(&batch, text.c_str(), XMFLOAT2(0, 0));
+            batch.End();
+        }
+    });
+    const __int64 replayUs = time_call_us([&]
+    {
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            batch.Begin();
+            layout.Draw(&batch, XMFLOAT2(0, 0));
+            batch.End();
+        }
+    });
+    Microsoft::WRL::ComPtr<ID3D11CommandList> discarded;
+    DX::ThrowIfFailed(deferred->FinishCommandList(FALSE, &discarded));
+
+    Report(L"Glyph lookup binary search", searchUs / ROUNDS, text.size());
+    Report(L"Glyph lookup table", tableUs / ROUNDS, text.size());
+    Report(L"Font MeasureString", measureUs / ROUNDS, glyphs);
+    Report(L"Font LayoutString", layoutUs / ROUNDS, glyphs);
+    Report(L"Font DrawString + End", drawUs / ROUNDS, glyphs);
+    Report(L"Font TextLayout Draw + End", replayUs / ROUNDS, glyphs);
+
+    wchar_t buff[256];
+    swprintf_s(buff, L"  %.1f M glyphs/s DrawString, %.1f M glyphs/s cached TextLayout\n",
+        drawUs ? glyphs * ROUNDS / (double)drawUs : 0.0, replayUs ? glyphs * ROUNDS / (double)replayUs : 0.0);
+    OutputDebugStringW(buff);
+
+    const RECT a = font->MeasureDrawBounds(text.c_str(), XMFLOAT2(0, 0));
+    const RECT b = layout.GetDrawBounds(XMFLOAT2(0, 0));
+    if (searchSum != tableSum || !XMVector2Equal(measured, layout.GetSize()) || memcmp(&a, &b, sizeof(RECT)) != 0)
+        OutputDebugStringW(L"ERROR: TextLayout or the glyph table disagrees with SpriteFont\n");
+}
+
+void Benchmarks::MeshOptimization(const std::shared_ptr<DX::DeviceResources>& device)
+{
+    // DirectXTK primitives as generated vs reordered for a 16 entry FIFO post-transform cache.
+    // ACMR = vertex shader runs per triangle, ATVR = runs per distinct vertex
+    using namespace DirectX::MeshOptimizer;
+    typedef std::vector<VertexPositionNormalTexture> Vertices;
+    typedef std::vector<uint16_t> Indices;
+    const std::pair<const wchar_t*, std::function<void(Vertices&, Indices&)>> primitives[] =
+    {
+        { L"Sphere 64",     [](Vertices& v, Indices& i) { GeometricPrimitive::CreateSphere(v, i, 1.0f, 64); } },
+        { L"GeoSphere 5",   [](Vertices& v, Indices& i) { GeometricPrimitive::CreateGeoSphere(v, i, 1.0f, 5); } },
+        { L"Torus 64",      [](Vertices& v, Indices& i) { GeometricPrimitive::CreateTorus(v, i, 1.0f, 0.333f, 64); } },
+        { L"Cylinder 64",   [](Vertices& v, Indices& i) { GeometricPrimitive::CreateCylinder(v, i, 1.0f, 1.0f, 64); } },
+        { L"Teapot 16",     [](Vertices& v, Indices& i) { GeometricPrimitive::CreateTeapot(v, i, 1.0f, 16); } },
+    };
+
+    wchar_t name[64], buff[256];
+    for (const auto& primitive : primitives)
+    {
+        Vertices vertices;
+        Indices indices;
+        primitive.second(vertices, indices);
+        const auto before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+        Indices forsyth(indices), tipsify(indices);
+        const __int64 forsythUs = time_call_us([&] { OptimizeFaces(forsyth.data(), forsyth.size(), vertices.size(), FaceOrder_Forsyth); });
+        const __int64 tipsifyUs = time_call_us([&] { OptimizeFaces(tipsify.data(), tipsify.size(), vertices.size(), FaceOrder_Tipsify); });
+        Vertices meshVertices(vertices);
+        Indices meshIndices(indices);
+        const __int64 meshUs = time_call_us([&] { OptimizeMesh(meshVertices, meshIndices); });
+
+        const auto forsythStats = AnalyzeVertexCache(forsyth.data(), forsyth.size(), vertices.size());
+        const auto tipsifyStats = AnalyzeVertexCache(tipsify.data(), tipsify.size(), vertices.size());
+        const auto meshStats = AnalyzeVertexCache(meshIndices.data(), meshIndices.size(), meshVertices.size());
+
+        swprintf_s(name, L"%s Forsyth", primitive.first);
+        Report(name, forsythUs, before.triangles);
+        swprintf_s(name, L"%s Tipsify", primitive.first);
+        Report(name, tipsifyUs, before.triangles);
+        swprintf_s(name, L"%s OptimizeMesh", primitive.first);
+        Report(name, meshUs, before.triangles);
+        swprintf_s(buff, L"  ACMR %.3f -> Forsyth %.3f, Tipsify %.3f, overdraw+fetch %.3f  ATVR %.3f -> %.3f\n",
+            before.acmr, forsythStats.acmr, tipsifyStats.acmr, meshStats.acmr, before.atvr, meshStats.atvr);
+        OutputDebugStringW(buff);
+    }
+
+    // room meshes are one quad per tile face with no shared corners (the texture coordinates
+    // differ), so 2.0 is both where they start and the best any order can do
+    LevelMapGenerationSettings settings;
+    settings.m_tileCount = XMUINT2(128, 128);
+    settings.m_generateThumbTex = false;
+    settings.m_useCache = false;
+    LevelMap map(device);
+    map.Generate(settings, RANDOM_DEFAULT_SEED);
+
+    size_t triangles = 0, transformedBefore = 0, transformedAfter = 0;
+    __int64 roomsUs = 0;
+    std::vector<VertexPositionNormalColorTextureNdx> roomVertices;
+    std::vector<unsigned short> roomIndices;
+    for (const auto& room : map.GetRooms())
+    {
+        room->BuildMesh(map, roomVertices, roomIndices);
+        transformedBefore += AnalyzeVertexCache(roomIndices.data(), roomIndices.size(), roomVertices.size()).transformed;
+        roomsUs += time_call_us([&] { OptimizeMesh(roomVertices, roomIndices, &VertexPositionNormalColorTextureNdx::position); });
+        const auto after = AnalyzeVertexCache(roomIndices.data(), roomIndices.size(), roomVertices.size());
+        transformedAfter += after.transformed;
+        triangles += after.triangles;
+    }
+    Report(L"Room meshes OptimizeMesh", roomsUs, triangles);
+    swprintf_s(buff, L"  ACMR %.3f -> %.3f over %zu rooms\n", triangles ? transformedBefore / (double)triangles : 0.0,
+        triangles ? transformedAfter / (double)triangles : 0.0, map.GetRooms().size());
+    OutputDebugStringW(buff);
+    if (transformedAfter > transformedBefore)
+        OutputDebugStringW(L"ERROR: room meshes got worse\n");
+}
+
+void Benchmarks::PrimitiveGeneration()
+{
+    // DirectXTK procedural primitives, generated (cache cleared first) vs served from the geometry
+    // cache. Rings, slices and patches go wide from 4096 vertices on; levels whose vertex count
+    // does not fit 16 bit indices are skipped
+    typedef std::vector<VertexPositionNormalTexture> Vertices;
+    typedef std::vector<uint16_t> Indices;
+    const std::pair<const wchar_t*, std::function<void(Vertices&, Indices&, size_t)>> primitives[] =
+    {
+        { L"Sphere",    [](Vertices& v, Indices& i, size_t t) { GeometricPrimitive::CreateSphere(v, i, 1.0f, t); } },
+        { L"GeoSphere", [](Vertices& v, Indices& i, size_t t) { GeometricPrimitive::CreateGeoSphere(v, i, 1.0f, t); } },
+        { L"Torus",     [](Vertices& v, Indices& i, size_t t) { GeometricPrimitive::CreateTorus(v, i, 1.0f, 0.333f, t); } },
+        { L"Teapot",    [](Vertices& v, Indices& i, size_t t) { GeometricPrimitive::CreateTeapot(v, i, 1.0f, t); } },
+    };
+    static const size_t levels[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+    wchar_t name[64], buff[256];
+    for (const auto& primitive : primitives)
+    {
+        for (size_t tessellation : levels)
+        {
+            Vertices generated, cached;
+            Indices generatedIndices, cachedIndices;
+            __int64 generateUs = 0, cachedUs = 0;
+            try
+            {
+                GeometricPrimitive::ClearGeometryCache();
+                generateUs = time_call_us([&] { primitive.second(generated, generatedIndices, tessellation); });
+                cachedUs = time_call_us([&] { primitive.second(cached, cachedIndices, tessellation); });
+            }
+            catch (const std::exception&)
+            {
+                swprintf_s(buff, L"  %s %zu: out of range, skipped\n", primitive.first, tessellation);
+                OutputDebugStringW(buff);
+                continue;
+            }
+
+            swprintf_s(name, L"%s %zu generate", primitive.first, tessellation);
+            Report(name, generateUs, generated.size());
+            swprintf_s(name, L"%s %zu cached", primitive.first, tessellation);
+            Report(name, cachedUs, cached.size());
+
+            // the cache hands out copies of the generated collections, indices all in range
+            const bool inRange = std::all_of(generatedIndices.begin(), generatedIndices.end(), [&](uint16_t i) { return i < generated.size(); });
+            if (cachedIndices != generatedIndices || cached.size() != generated.size() || !inRange ||
+                memcmp(cached.data(), generated.data(), generated.size() * sizeof(VertexPositionNormalTexture)) != 0)
+            {
+                swprintf_s(buff, L"ERROR: %s %zu cached geometry differs from the generated one\n", primitive.first, tessellation);
+                OutputDebugStringW(buff);
+            }
+        }
+    }
+    GeometricPrimitive::ClearGeometryCache();
+}
@@ -6,31 +6,6 @@ using namespace DirectX;
 
 namespace SpookyAdulthood
 {
-    // P Bourke my good old friend...
-    static bool FPSCDRaycast(const XMFLOAT2& p1, const XMFLOAT2& p2, const XMFLOAT2& p3, const XMFLOAT2& p4, XMFLOAT2* outHit, float* outFrac)
-    {
-        const float den = (p4.y - p3.y)*(p2.x - p1.x) - (p4.x - p3.x)*(p2.y - p1.y);
-        if (den == 0.0f) 
-            return false; // parallel (no intersection)
-
-        const float iden = 1.0f / den;
-        const float fx = ( (p4.x - p3.x)*(p1.y - p3.y) - (p4.y - p3.y)*(p1.x - p3.x) ) * iden;
-        if (fx < 0 || fx >1.0f) 
-            return false; // out of seg bounds
-
-        const float fy = ((p2.x - p1.x)*(p1.y - p3.y) - (p2.y - p1.y)*(p1.x - p3.x) ) * iden;
-        if (fy < 0 || fy >1.0f)
-            return false; // out of seg bounds
-
-        if (fx == 0.0f && fy == 0.0f)
-            return false; // same line
-
-        *outFrac = fx;
-        outHit->x = p1.x + fx*(p2.x - p1.x);
-        outHit->y = p1.y + fx*(p2.y - p1.y);
-        return true;
-    }
-
     static float FPSCDClosestDistance(const XMFLOAT2& p1, const XMFLOAT2& p2, const XMFLOAT2& p3)
     {
         const XMVECTOR _p1 = XMLoadFloat2(&p1);
@@ -116,98 +91,6 @@ namespace SpookyAdulthood
         return nextPos;
     }
 
-    bool IntersectRaySegment(const XMFLOAT2& origin, const XMFLOAT2& dir, const CollSegment& seg, XMFLOAT2& outHit, float& outFrac)
-    {
-        XMFLOAT2 endP(origin.x + dir.x*1000.0f, origin.y + dir.y*1000.0f);
-        return FPSCDRaycast(origin, endP, seg.start, seg.end, &outHit, &outFrac);
-    }
-
-    static inline bool solveQuadratic(const float &a, const float &b, const float &c, float &x0, float &x1)
-    {
-        const float discr = b * b - 4 * a * c;
-        if (discr < 0) return false;
-        else if (discr == 0) x0 = x1 = -0.5f * b / a;
-        else {
-            float q = (b > 0) ?
-                -0.5f * (b + sqrt(discr)) :
-                -0.5f * (b - sqrt(discr));
-            x0 = q / a;
-            x1 = c / q;
-        }
-        if (x0 > x1) std::swap(x0, x1);
-
-        return true;
-    }
-
-    bool IntersectRaySphere(const XMFLOAT3& origin, const XMFLOAT3& dir, const XMFLOAT3& center, float radius, XMFLOAT3& outHit, float& outFrac)
-    {
-        const XMFLOAT3 L(origin.x - center.x, origin.y - center.y, origin.z - center.z);
-        const float a = XM3Dot(dir, dir);
-        const float b = 2.0f * XM3Dot(dir, L);
-        const float c = XM3Dot(L,L) - radius;
-        float t0, t1;
-        if (!solveQuadratic(a, b, c, t0, t1))
-            return false;
-        if (t0 > t1)
-            std::swap(t0, t1);
-        if (t0 < 0.0f)
-        {
-            t0 = t1; // if t0 is negative, use t1 instead
-            if (t0 < 0.0f) 
-                return false; // both negatives
-        }
-        outFrac = t0;
-        outHit.x = origin.x + dir.x *t0;
-        outHit.y = origin.y + dir.y *t0;
-        outHit.z = origin.z + dir.z *t0;
-        return true;
-    }
-
-    bool IntersectRayPlane(const XMFLOAT3& origin, const XMFLOAT3& dir, const XMFLOAT3& normal, const XMFLOAT3& p, XMFLOAT3& outHit, float& outFrac)
-    {
-        const float den = XM3Dot(normal, dir);
-        if (den < -1e-6f )
-        {
-            const XMFLOAT3 po = XM3Normalize(XM3Sub(p, origin));
-            const float f = XM3Dot(po, normal) / den;
-            outHit.x = origin.x + dir.x*f;
-            outHit.y = origin.y + dir.y*f;
-            outHit.z = origin.z + dir.z*f;
-            outFrac = f;
-            return f >= 0.0f;
-        }
-        return false;
-    }
-
-    bool IntersectRayTriangle(const XMFLOAT3& P, const XMFLOAT3& w, const XMFLOAT3 V[3], XMFLOAT3& barycentric, float& t)
-    {
-        // Edge vectors
-        const XMFLOAT3 e_1 = XM3Sub(V[1], V[0]);
-        const XMFLOAT3 e_2 = XM3Sub(V[2], V[0]);
-
-        // Face normal
-        const XMFLOAT3 n = XM3Normalize(XM3Cross(e_1, e_2));
-        const XMFLOAT3 q = XM3Cross(w, e_2);
-        const float a = XM3Dot(e_1, q);
-
-        // Backfacing or nearly parallel?
-        if (/* XM3Dot(n,w) >= 0.0f || */abs(a) <= 0.0001f) 
-            return false;
-
-        const float inva = 1.0f / a;
-        const XMFLOAT3 s = XM3Mul(XM3Sub(P, V[0]), inva);
-        const XMFLOAT3 r = XM3Cross(s, e_1);
-        barycentric.x = XM3Dot(s, q);
-        barycentric.y = XM3Dot(r, w);
-        barycentric.z = 1.0f - barycentric.x - barycentric.y;
-
-        // Intersected outside triangle?
-        if ((barycentric.x < 0.0f) || (barycentric.y < 0.0f) || (barycentric.z <0.0f)) 
-            return false;
-        t = XM3Dot(e_2, r);
-        return t >= 0.0f;
-    }
-
     inline void TransformQuad(XMFLOAT3* fourVertices, float yaw, const XMFLOAT3& pos, const XMFLOAT2& size)
     {
         using namespace DirectX::SimpleMath;
@@ -8,7 +8,7 @@
 using namespace SpookyAdulthood;
 
 static const XMFLOAT4 XM4RED(1, 0, 0, 1);
-#define RND (DX::GameResources::instance->m_random)
+#define RND (EntityManager::s_instance->ScopedRandom())
 #define CAM (DX::GameResources::instance->m_camera)
 const float FBIGVAL = 1e10;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -126,6 +126,12 @@ void Entity::PlaySoundDistance(uint32_t sound, float maxdist, bool loop)
 {
     // volume depending on distance
     auto gameRes = DX::GameResources::instance;
+    if (!loop)
+    {
+        // own voice, attenuated by the pool while it plays
+        gameRes->SoundPlayAt(sound, m_pos, maxdist);
+        return;
+    }
     gameRes->SoundPlay(sound, loop);
     UpdateSoundDistance(sound, maxdist);
 }
@@ -145,19 +151,20 @@ EntityManager* EntityManager::s_instance = nullptr;
 
 EntityManager::EntityManager(const std::shared_ptr<DX::DeviceResources>& device)
     : m_device(device), m_duringUpdate(false), m_curRoomIndex(-1), m_paused(true)
+    , m_lazySpawn(true), m_releaseFinishedRooms(false), m_spawnRandom(nullptr), m_rebuildingRoom(false)
 {
     EntityManager::s_instance = this;
 }
 
 void EntityManager::CreateEntities_Puky(LevelMapBSPNode* r, int n, uint32_t prob)
 {
-    auto& rnd = m_device->GetGameResources()->instance->m_random;
+    auto& rnd = SpawnRandom();
     XMFLOAT3 p;
     for (int i = 0; i < n; ++i)
     {
         if (rnd.Get(0, 99) < prob)
         {
-            p = r->GetRandomXZ(XMFLOAT2(0.15f, 0.15f));
+            p = r->GetRandomXZ(XMFLOAT2(0.15f, 0.15f), &rnd);
             p.y = rnd.GetF(0.2f, 0.8f);
             AddEntity(std::make_shared<EnemyPuky>(p), r->m_leafNdx);
         }
@@ -166,13 +173,13 @@ void EntityManager::CreateEntities_Puky(LevelMapBSPNode* r, int n, uint32_t prob
 
 void EntityManager::CreateEntities_Pumpkin(LevelMapBSPNode* r, int n, uint32_t prob)
 {
-    auto& rnd = m_device->GetGameResources()->instance->m_random;
+    auto& rnd = SpawnRandom();
     XMFLOAT3 p;
     for (int i = 0; i < n; ++i)
     {
         if (rnd.Get(0, 99) < prob)
         {
-            p = r->GetRandomXZ(XMFLOAT2(0.15f, 0.15f));
+            p = r->GetRandomXZ(XMFLOAT2(0.15f, 0.15f), &rnd);
             if ( r->Clearance(p))
                 AddEntity(std::make_shared<EnemyPumpkin>(p), r->m_leafNdx);
         }
@@ -181,13 +188,13 @@ void EntityManager::CreateEntities_Pumpkin(LevelMapBSPNode* r, int n, uint32_t p
 
 void EntityManager::CreateEntities_Girl(LevelMapBSPNode* r, int n, uint32_t prob)
 {
-    auto& rnd = m_device->GetGameResources()->instance->m_random;
+    auto& rnd = SpawnRandom();
     XMFLOAT3 p;
     for (int i = 0; i < n; ++i)
     {
         if (rnd.Get(0, 99) < prob)
         {
-            p = r->GetRandomXZ(XMFLOAT2(0.5f, 0.5f));
+            p = r->GetRandomXZ(XMFLOAT2(0.5f, 0.5f), &rnd);
             AddEntity(std::make_shared<EnemyGirl>(p), r->m_leafNdx);
         }
     }
@@ -195,13 +202,13 @@ void EntityManager::CreateEntities_Girl(LevelMapBSPNode* r, int n, uint32_t prob
 
 void EntityManager::CreateEntities_Gargoyle(LevelMapBSPNode* r, int n, uint32_t prob)
 {
-    auto& rnd = m_device->GetGameResources()->instance->m_random;
+    auto& rnd = SpawnRandom();
     XMFLOAT3 p;
     for (int i = 0; i < n; ++i)
     {
         if (rnd.Get(0, 99) < prob)
         {
-            p = r->GetRandomXZ(XMFLOAT2(0.75f, 0.75f));
+            p = r->GetRandomXZ(XMFLOAT2(0.75f, 0.75f), &rnd);
             if (r->Clearance(p))
                 AddEntity(std::make_shared<EnemyGargoyle>(p, rnd.GetF(3.0f,6.0f)), r->m_leafNdx);
         }
@@ -210,24 +217,36 @@ void EntityManager::CreateEntities_Gargoyle(LevelMapBSPNode* r, int n, uint32_t
 
 void EntityManager::CreateEntities_BlackHands(LevelMapBSPNode* r, int n, uint32_t prob)
 {
-    auto& rnd = m_device->GetGameResources()->instance->m_random;
+    auto& rnd = SpawnRandom();
     XMUINT2 p;
     for (int i = 0; i < n; ++i)
     {
         if (rnd.Get(0, 99) < prob)
         {
-            p = r->GetRandomTile();
+            p = r->GetRandomTile(&rnd);
             if (r->Clearance(p))
                 AddEntity(std::make_shared<EnemyBlackHands>(p, rnd.Get(6,16)), r->m_leafNdx);
         }
     }
 }
 
+DX::RandomProvider& EntityManager::ScopedRandom()
+{
+    return m_spawnRandom ? *m_spawnRandom : DX::GameResources::instance->Random(DX::RANDOM_AI);
+}
+
+DX::RandomProvider& EntityManager::SpawnRandom()
+{
+    return m_spawnRandom ? *m_spawnRandom : DX::GameResources::instance->Random(DX::RANDOM_SPAWN);
+}
+
 void EntityManager::ReserveAndCreateEntities(int roomCount)
 {
+    DX::MemoryTagScope memTag(DX::MEMTAG_ENTITIES);
     if (roomCount <= 0)
         throw std::exception("No rooms in entity manager?");
     m_rooms.resize(roomCount);
+    m_roomStates.assign(roomCount, ROOM_EMPTY);
 
     // TEST: DELETE
     //{
@@ -238,170 +257,208 @@ void EntityManager::ReserveAndCreateEntities(int roomCount)
     //    return;
     //}
 
+    // lazy: rooms are populated in SetCurrentRoom when they get adjacent to the player's
+    if (!m_lazySpawn)
+    {
+        for (int i = 0; i < roomCount; ++i)
+            PopulateRoom(i);
+    }
+}
+
+void EntityManager::PopulateRoom(int roomIndex)
+{
+    DX::MemoryTagScope memTag(DX::MEMTAG_ENTITIES);
+    if (roomIndex < 0 || roomIndex >= (int)m_roomStates.size() || m_roomStates[roomIndex] == ROOM_POPULATED)
+        return;
 
-    // will create the entities depending on the room profiles
     auto gameRes = m_device->GetGameResources();
-    auto& rnd = gameRes->m_random;
-    auto& rooms = gameRes->m_map.GetRooms();
+    auto r = gameRes->m_map.GetLeafAtIndex(roomIndex);
+    const bool rebuild = m_roomStates[roomIndex] == ROOM_RELEASED;
+    m_roomStates[roomIndex] = ROOM_POPULATED;
+    if (r->m_finished && !rebuild) 
+        return;
+
+    // every room has its own stream, same entities whenever and in whatever order it's populated
+    auto rnd = gameRes->RandomForRoom(DX::RANDOM_SPAWN, roomIndex);
+    m_spawnRandom = &rnd;
+    m_rebuildingRoom = rebuild;
+    CreateRoomPopulation(r);
+    m_spawnRandom = nullptr;
+    m_rebuildingRoom = false;
+}
+
+void EntityManager::ReleaseRoom(int roomIndex)
+{
+    if (roomIndex < 0 || roomIndex >= (int)m_roomStates.size() || m_roomStates[roomIndex] != ROOM_POPULATED)
+        return;
+
+    // what was added later (items, teleports...) is kept
+    auto& entities = m_rooms[roomIndex];
+    entities.erase(std::remove_if(entities.begin(), entities.end(), [](const auto& e) { return (e->m_flags & Entity::SPAWNED) != 0; }), entities.end());
+    entities.shrink_to_fit();
+    m_roomStates[roomIndex] = ROOM_RELEASED;
+}
+
+void EntityManager::CreateRoomPopulation(const std::shared_ptr<LevelMapBSPNode>& r)
+{
+    // will create the entities depending on the room profiles
+    auto& rnd = *m_spawnRandom;
     XMUINT2 decoProbs[DECORMAX];     
-    for (auto& r : rooms)
-    {
-        if (r->m_finished) continue;
-        ZeroMemory(decoProbs, sizeof(XMUINT2)*DECORMAX);
-        switch (r->m_profile)
+    ZeroMemory(decoProbs, sizeof(XMUINT2)*DECORMAX);
+    switch (r->m_profile)
+    {
+    case LevelMap::RP_NORMAL0:
+        decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 30);
+        decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 4), 50);
+        decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 4), 50);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 10), 80);
+        CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 70);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Puky(r.get(), rnd.Get(0, 3), 40);
+            CreateEntities_Girl(r.get(), rnd.Get(0, 3), 60);
+            CreateEntities_BlackHands(r.get(), rnd.Get(0, 3), 80);
+            if (rnd.Get01(0.7f))
+                AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_NORMAL1:
+        decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 50);
+        decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 8), 70);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(0, 15), 80);
+        CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 70);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Girl(r.get(), rnd.Get(0, 2), 60);
+            CreateEntities_Gargoyle(r.get(), rnd.Get(0, 2), 60);
+            AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
+            if (rnd.Get01(0.4f))
+                AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_GRAVE:
+        decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 3), 20);
+        decoProbs[GRAVE] = XMUINT2(rnd.Get(3, 20), 90);
+        decoProbs[TREEBLACK] = XMUINT2(rnd.Get(1, 4), 70);
+        decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 4), 50);
+        decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 4), 50);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 10), 80);
+        CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 80);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Girl(r.get(), rnd.Get(0, 3), 80);
+            CreateEntities_BlackHands(r.get(), rnd.Get(0, 2), 50);
+            CreateEntities_Gargoyle(r.get(), rnd.Get(0, 2), 60);
+            AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_OWL, 8.0f, 30.0f), r->m_leafNdx);
+            for (int i = rnd.Get(0, 3); i > 0; --i)
+                if (rnd.Get01())
+                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_WOODS: 
+        decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 20);
+        decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 60);
+        decoProbs[TREEBLACK] = XMUINT2(rnd.Get(5, 20), 100);
+        decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 4), 50);
+        decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 4), 50);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
+        if (r->m_leafNdx)
         {
-        case LevelMap::RP_NORMAL0:
-            decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 30);
-            decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 4), 50);
-            decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 4), 50);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 10), 80);
-            CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 70);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Puky(r.get(), rnd.Get(0, 3), 40);
-                CreateEntities_Girl(r.get(), rnd.Get(0, 3), 60);
-                CreateEntities_BlackHands(r.get(), rnd.Get(0, 3), 80);
-                if (rnd.Get01(0.7f))
-                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_NORMAL1:
-            decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 50);
-            decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 8), 70);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(0, 15), 80);
-            CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 70);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Girl(r.get(), rnd.Get(0, 2), 60);
-                CreateEntities_Gargoyle(r.get(), rnd.Get(0, 2), 60);
-                AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
-                if (rnd.Get01(0.4f))
-                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_GRAVE:
-            decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 3), 20);
-            decoProbs[GRAVE] = XMUINT2(rnd.Get(3, 20), 90);
-            decoProbs[TREEBLACK] = XMUINT2(rnd.Get(1, 4), 70);
-            decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 4), 50);
-            decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 4), 50);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 10), 80);
-            CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 80);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Girl(r.get(), rnd.Get(0, 3), 80);
-                CreateEntities_BlackHands(r.get(), rnd.Get(0, 2), 50);
-                CreateEntities_Gargoyle(r.get(), rnd.Get(0, 2), 60);
-                AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_OWL, 8.0f, 30.0f), r->m_leafNdx);
-                for (int i = rnd.Get(0, 3); i > 0; --i)
-                    if (rnd.Get01())
-                        AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_WOODS: 
-            decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 20);
-            decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 60);
-            decoProbs[TREEBLACK] = XMUINT2(rnd.Get(5, 20), 100);
-            decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 4), 50);
-            decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 4), 50);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 80);
-                CreateEntities_Girl(r.get(), rnd.Get(0, 5), 60);
-                CreateEntities_Puky(r.get(), rnd.Get(0, 5), 60);
-                AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_OWL, 8.0f, 30.0f), r->m_leafNdx);
-                for (int i = rnd.Get(0, 3); i > 0; --i)
-                    if (rnd.Get01())
-                        AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_BODYPILES: 
-            decoProbs[BODYPILE] = XMUINT2(rnd.Get(4, 10), 60);
-            decoProbs[GREENHAND] = XMUINT2(rnd.Get(4, 10), 40);
-            decoProbs[BLACKHAND] = XMUINT2(rnd.Get(4, 10), 40);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(4, 15), 80);
             CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 80);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_BlackHands(r.get(), rnd.Get(0, 2), 50);
-                CreateEntities_Puky(r.get(), rnd.Get(0, 3), 40);
-                AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
-                if (rnd.Get01(0.3f))
-                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_GARGOYLES: 
-            decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 20);
-            decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 60);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
-            CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 70);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Gargoyle(r.get(), rnd.Get(1, 10), 65);
-                CreateEntities_Girl(r.get(), rnd.Get(0, 3), 70);
-                AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
-                for (int i = rnd.Get(0, 3); i > 0; --i)
-                    if (rnd.Get01())
-                        AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_HANDS: 
-            decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 20);
-            decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 10), 50);
-            decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 10), 50);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
+            CreateEntities_Girl(r.get(), rnd.Get(0, 5), 60);
+            CreateEntities_Puky(r.get(), rnd.Get(0, 5), 60);
+            AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_OWL, 8.0f, 30.0f), r->m_leafNdx);
+            for (int i = rnd.Get(0, 3); i > 0; --i)
+                if (rnd.Get01())
+                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_BODYPILES: 
+        decoProbs[BODYPILE] = XMUINT2(rnd.Get(4, 10), 60);
+        decoProbs[GREENHAND] = XMUINT2(rnd.Get(4, 10), 40);
+        decoProbs[BLACKHAND] = XMUINT2(rnd.Get(4, 10), 40);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(4, 15), 80);
+        CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 80);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_BlackHands(r.get(), rnd.Get(0, 2), 50);
+            CreateEntities_Puky(r.get(), rnd.Get(0, 3), 40);
             AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Girl(r.get(), rnd.Get(0, 3), 50);
-                CreateEntities_BlackHands(r.get(), rnd.Get(1, 8), 40);
-                for (int i = rnd.Get(0, 3); i > 0; --i)
-                    if (rnd.Get01())
-                        AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_SCARYMESSAGES: 
-            decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 60);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);            
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Gargoyle(r.get(), rnd.Get(1, 5), 80);
-                for (int i = rnd.Get(0, 3); i > 0; --i)
-                    if (rnd.Get01())
-                        AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        case LevelMap::RP_PUMPKINFIELD: 
-            decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 3), 70);
-            decoProbs[TREEBLACK] = XMUINT2(rnd.Get(5, 10), 80);
-            decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
-            CreateEntities_Pumpkin(r.get(), rnd.Get(5, 20), 80);
+            if (rnd.Get01(0.3f))
+                AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_GARGOYLES: 
+        decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 20);
+        decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 60);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
+        CreateEntities_Pumpkin(r.get(), rnd.Get(0, 5), 70);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Gargoyle(r.get(), rnd.Get(1, 10), 65);
+            CreateEntities_Girl(r.get(), rnd.Get(0, 3), 70);
             AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
-            if (r->m_leafNdx)
-            {
-                CreateEntities_Girl(r.get(), rnd.Get(0, 3), 50);
-                CreateEntities_Puky(r.get(), rnd.Get(0, 5), 50);
-                AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_OWL, 8.0f, 30.0f), r->m_leafNdx);
+            for (int i = rnd.Get(0, 3); i > 0; --i)
                 if (rnd.Get01())
-                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance()), r->m_leafNdx);
-            }break;
-        }
+                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_HANDS: 
+        decoProbs[BODYPILE] = XMUINT2(rnd.Get(0, 2), 20);
+        decoProbs[GREENHAND] = XMUINT2(rnd.Get(0, 10), 50);
+        decoProbs[BLACKHAND] = XMUINT2(rnd.Get(0, 10), 50);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
+        AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Girl(r.get(), rnd.Get(0, 3), 50);
+            CreateEntities_BlackHands(r.get(), rnd.Get(1, 8), 40);
+            for (int i = rnd.Get(0, 3); i > 0; --i)
+                if (rnd.Get01())
+                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_SCARYMESSAGES: 
+        decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 5), 60);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);            
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Gargoyle(r.get(), rnd.Get(1, 5), 80);
+            for (int i = rnd.Get(0, 3); i > 0; --i)
+                if (rnd.Get01())
+                    AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    case LevelMap::RP_PUMPKINFIELD: 
+        decoProbs[GRAVE] = XMUINT2(rnd.Get(0, 3), 70);
+        decoProbs[TREEBLACK] = XMUINT2(rnd.Get(5, 10), 80);
+        decoProbs[SKULL] = XMUINT2(rnd.Get(2, 8), 80);
+        CreateEntities_Pumpkin(r.get(), rnd.Get(5, 20), 80);
+        AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_CAT, 8.0f, 30.0f), r->m_leafNdx);
+        if (r->m_leafNdx)
+        {
+            CreateEntities_Girl(r.get(), rnd.Get(0, 3), 50);
+            CreateEntities_Puky(r.get(), rnd.Get(0, 5), 50);
+            AddEntity(std::make_shared<EntityRandomSound>(DX::GameResources::SFX_OWL, 8.0f, 30.0f), r->m_leafNdx);
+            if (rnd.Get01())
+                AddEntity(std::make_shared<EnemyGhost>(r->GetRandomXZWithClearance(&rnd)), r->m_leafNdx);
+        }break;
+    }
 
-        // decorations
-        XMFLOAT2 shrink(0, 0), s;
-        for ( int i = 0; i < DECORMAX; ++i )
-        { 
-            const auto& p = decoProbs[i];
-            if (p.x == 0 || p.y == 0) continue;
-            for (uint32_t j = 0; j < p.x; ++j)
+    // decorations
+    XMFLOAT2 shrink(0, 0), s;
+    for ( int i = 0; i < DECORMAX; ++i )
+    { 
+        const auto& p = decoProbs[i];
+        if (p.x == 0 || p.y == 0) continue;
+        for (uint32_t j = 0; j < p.x; ++j)
+        {
+            if (rnd.Get(0, 99) < p.y)
             {
-                if (rnd.Get(0, 99) < p.y)
-                {
-                    s = EntitySingleDecoration::GetSizeOf((DecorType)i);
-                    shrink.x = shrink.y = s.x*0.5f; 
-                    auto decopos = r->GetRandomXZ(shrink);
-                    if ( r->Clearance( XMUINT2((UINT)decopos.x, (UINT)decopos.z) ) )
-                        AddEntity(std::make_shared<EntitySingleDecoration>((DecorType)i, decopos), r->m_leafNdx);
-                }
+                s = EntitySingleDecoration::GetSizeOf((DecorType)i);
+                shrink.x = shrink.y = s.x*0.5f; 
+                auto decopos = r->GetRandomXZ(shrink, &rnd);
+                if ( r->Clearance( XMUINT2((UINT)decopos.x, (UINT)decopos.z) ) )
+                    AddEntity(std::make_shared<EntitySingleDecoration>((DecorType)i, decopos), r->m_leafNdx);
             }
         }
+    }
 
-        // checking end of room
+    // checking end of room
+    if (!m_rebuildingRoom)
         AddEntity(std::make_shared<EntityRoomChecker_AllDead>(), r->m_leafNdx);
-    }
 }
 
 void EntityManager::SetCurrentRoom(int roomIndex) 
@@ -411,6 +468,27 @@ void EntityManager::SetCurrentRoom(int roomIndex)
         int old = m_curRoomIndex;
         m_curRoomIndex = roomIndex;
         auto gameRes = DX::GameResources::instance;
+        if (roomIndex != -1)
+        {
+            // the room and the ones next to it (doors, teleport) must be there before getting in
+            PopulateRoom(roomIndex);
+            gameRes->m_map.GetAdjacentRooms(roomIndex, m_adjacentRooms);
+            for (int ri : m_adjacentRooms)
+                PopulateRoom(ri);
+            m_adjacentRooms.push_back(roomIndex);
+
+            // can't touch the room collections while they're being updated, next time
+            if (m_releaseFinishedRooms && !m_duringUpdate)
+            {
+                const auto& rooms = gameRes->m_map.GetRooms();
+                for (int i = 0; i < (int)m_roomStates.size(); ++i)
+                {
+                    if (m_roomStates[i] == ROOM_POPULATED && rooms[i]->m_finished &&
+                        std::find(m_adjacentRooms.begin(), m_adjacentRooms.end(), i) == m_adjacentRooms.end())
+                        ReleaseRoom(i);
+                }
+            }
+        }
         if (old != -1)
             gameRes->OnLeaveRoom(old);
         
@@ -421,8 +499,11 @@ void EntityManager::SetCurrentRoom(int roomIndex)
 
 void EntityManager::Update(const DX::StepTimer& stepTimer, const CameraFirstPerson& camera)
 {
+    DX_PROFILE_SCOPE("EntityManager::Update");
+    DX::MemoryTagScope memTag(DX::MEMTAG_ENTITIES); // what entities spawn while updating
     if (m_curRoomIndex == -1) return;
     m_duringUpdate = true;
+    m_entitiesToAdd = EntitiesToAdd(); // on this frame's arena
     for (int pass = 0; pass < 2; ++pass)
     {
         auto& entities = !pass ? m_rooms[m_curRoomIndex] : m_omniEntities;
@@ -467,7 +548,7 @@ void EntityManager::Update(const DX::StepTimer& stepTimer, const CameraFirstPers
             auto& whatColl = e->m_roomIndex >= 0 ? m_rooms[e->m_roomIndex] : m_omniEntities;
             whatColl.push_back(e);
         }
-        m_entitiesToAdd.clear();
+        m_entitiesToAdd = EntitiesToAdd();
     }
 
 #ifdef _DEBUG
@@ -491,6 +572,7 @@ void EntityManager::Update(const DX::StepTimer& stepTimer, const CameraFirstPers
 
 void EntityManager::RenderSprites3D(const CameraFirstPerson& camera)
 {
+    DX_PROFILE_SCOPE("EntityManager::RenderSprites3D");
     auto gameRes = m_device->GetGameResources();
     if (!gameRes || !gameRes->m_readyToRender || m_curRoomIndex==-1)
         return;
@@ -511,6 +593,7 @@ void EntityManager::RenderSprites3D(const CameraFirstPerson& camera)
 
 void EntityManager::RenderSprites2D(const CameraFirstPerson& camera)
 {
+    DX_PROFILE_SCOPE("EntityManager::RenderSprites2D");
     auto gameRes = m_device->GetGameResources();
     if (!gameRes || !gameRes->m_readyToRender || m_curRoomIndex==-1)
         return;
@@ -549,20 +632,25 @@ void EntityManager::RenderModel3D(const CameraFirstPerson& camera)
 
 void EntityManager::AddEntity(const std::shared_ptr<Entity>& entity, float timeout, int roomIndex)
 {
-    const int ri = roomIndex < 0 ? m_curRoomIndex : roomIndex;
-    auto& entities = roomIndex == -2 ? m_omniEntities : m_rooms[ri];
-    auto& coll = m_duringUpdate ? m_entitiesToAdd : entities;
-    coll.push_back(entity);
-    entity->m_roomIndex = ri;
     entity->m_timeOut = timeout;
+    AddEntity(entity, roomIndex);
 }
 
 void EntityManager::AddEntity(const std::shared_ptr<Entity>& entity, int roomIndex)
 {
+    if (m_spawnRandom)
+    {
+        // rebuilding a released room, enemies were already killed, only the static stuff
+        if (m_rebuildingRoom && entity->CanDie())
+            return;
+        entity->m_flags |= Entity::SPAWNED;
+    }
     const int ri = roomIndex < 0 ? m_curRoomIndex : roomIndex;
     auto& entities = roomIndex == -2 ? m_omniEntities : m_rooms[ri];
-    auto& coll = m_duringUpdate ? m_entitiesToAdd : entities;
-    coll.push_back(entity);
+    if (m_duringUpdate)
+        m_entitiesToAdd.push_back(entity);
+    else
+        entities.push_back(entity);
     entity->m_roomIndex = ri;
 }
 
@@ -570,8 +658,9 @@ void EntityManager::Clear()
 {
     for (auto& rc : m_rooms)
         rc.clear();
-    m_entitiesToAdd.clear();
+    m_entitiesToAdd = EntitiesToAdd();
     m_omniEntities.clear();
+    m_roomStates.clear();
     m_curRoomIndex = -1;
 }
 
@@ -641,49 +730,52 @@ void EntityManager::CreateDeviceDependentResources()
     auto gameRes = m_device->GetGameResources();
     auto& sprite = gameRes->m_sprite;
 
-    sprite.CreateSprite(L"assets\\sprites\\puky.png"); // 0
-    sprite.CreateSprite(L"assets\\sprites\\hand.png"); // 1
-    sprite.CreateSprite(L"assets\\sprites\\gun0.png"); // 2
-    sprite.CreateSprite(L"assets\\sprites\\pointinghand.png"); // 3
-    sprite.CreateSprite(L"assets\\sprites\\anx1.png"); // 4
-    sprite.CreateSprite(L"assets\\sprites\\dep1.png"); // 5
-    sprite.CreateSprite(L"assets\\sprites\\grave1.png"); // 6
-    sprite.CreateSprite(L"assets\\sprites\\crosshair.png"); // 7
-    sprite.CreateSprite(L"assets\\sprites\\tree1.png"); // 8
-    sprite.CreateSprite(L"assets\\sprites\\msgdie.png"); // 9
-    sprite.CreateSprite(L"assets\\sprites\\garg1.png"); // 10
-    sprite.CreateSprite(L"assets\\sprites\\bodpile1.png"); // 11
-    sprite.CreateSprite(L"assets\\sprites\\girl1.png"); // 12
-    sprite.CreateSprite(L"assets\\sprites\\gunshoot0.png"); // 13
-    sprite.CreateSprite(L"assets\\sprites\\gunshoot1.png"); // 14
-    sprite.CreateSprite(L"assets\\sprites\\gunshoot2.png"); // 15
-    sprite.CreateSprite(L"assets\\sprites\\gun1.png"); // 16
-    sprite.CreateSprite(L"assets\\sprites\\gun2.png"); // 17
-    sprite.CreateSprite(L"assets\\sprites\\gun3.png"); // 18
-    sprite.CreateSprite(L"assets\\sprites\\proj0.png"); // 19
-    sprite.CreateSprite(L"assets\\sprites\\hit00.png"); // 20
-    sprite.CreateSprite(L"assets\\sprites\\hit01.png"); // 21
-    sprite.CreateSprite(L"assets\\sprites\\hit10.png"); // 22 
-    sprite.CreateSprite(L"assets\\sprites\\hit11.png"); // 23
-    sprite.CreateSprite(L"assets\\sprites\\door0.png"); // 24
-    sprite.CreateSprite(L"assets\\sprites\\teleport0.png"); // 25
-    sprite.CreateSprite(L"assets\\sprites\\teleport1.png"); // 26
-    sprite.CreateSprite(L"assets\\sprites\\teleport2.png"); // 27
-    sprite.CreateSprite(L"assets\\sprites\\garg2.png"); // 28
-    sprite.CreateSprite(L"assets\\textures\\white.png"); // 29
-    sprite.CreateSprite(L"assets\\sprites\\pumpkin.png"); // 30
-    sprite.CreateSprite(L"assets\\sprites\\door1.png"); // 31
-    sprite.CreateSprite(L"assets\\sprites\\skull.png"); // 32
-    sprite.CreateSprite(L"assets\\textures\\blue.png"); // 33
-    sprite.CreateSprite(L"assets\\textures\\red.png"); // 34
-    sprite.CreateSprite(L"assets\\sprites\\itemcandy.png"); // 35
-    sprite.CreateSprite(L"assets\\sprites\\heart.png"); // 36
-    sprite.CreateSprite(L"assets\\sprites\\splash.png"); // 37
-    sprite.CreateSprite(L"assets\\sprites\\splashspooky.png"); // 38
-    sprite.CreateSprite(L"assets\\sprites\\micro.png"); // 39
-    sprite.CreateSprite(L"assets\\sprites\\scarejam.png"); // 40
-    sprite.CreateSprite(L"assets\\sprites\\leftclick.png"); // 41
-    sprite.CreateSprite(L"assets\\sprites\\help.png"); // 42
+    // decoded together on the worker pool, indices stay in this order
+    sprite.CreateSprites(std::vector<std::wstring>{
+        L"assets\\sprites\\puky.png", // 0
+        L"assets\\sprites\\hand.png", // 1
+        L"assets\\sprites\\gun0.png", // 2
+        L"assets\\sprites\\pointinghand.png", // 3
+        L"assets\\sprites\\anx1.png", // 4
+        L"assets\\sprites\\dep1.png", // 5
+        L"assets\\sprites\\grave1.png", // 6
+        L"assets\\sprites\\crosshair.png", // 7
+        L"assets\\sprites\\tree1.png", // 8
+        L"assets\\sprites\\msgdie.png", // 9
+        L"assets\\sprites\\garg1.png", // 10
+        L"assets\\sprites\\bodpile1.png", // 11
+        L"assets\\sprites\\girl1.png", // 12
+        L"assets\\sprites\\gunshoot0.png", // 13
+        L"assets\\sprites\\gunshoot1.png", // 14
+        L"assets\\sprites\\gunshoot2.png", // 15
+        L"assets\\sprites\\gun1.png", // 16
+        L"assets\\sprites\\gun2.png", // 17
+        L"assets\\sprites\\gun3.png", // 18
+        L"assets\\sprites\\proj0.png", // 19
+        L"assets\\sprites\\hit00.png", // 20
+        L"assets\\sprites\\hit01.png", // 21
+        L"assets\\sprites\\hit10.png", // 22
+        L"assets\\sprites\\hit11.png", // 23
+        L"assets\\sprites\\door0.png", // 24
+        L"assets\\sprites\\teleport0.png", // 25
+        L"assets\\sprites\\teleport1.png", // 26
+        L"assets\\sprites\\teleport2.png", // 27
+        L"assets\\sprites\\garg2.png", // 28
+        L"assets\\textures\\white.png", // 29
+        L"assets\\sprites\\pumpkin.png", // 30
+        L"assets\\sprites\\door1.png", // 31
+        L"assets\\sprites\\skull.png", // 32
+        L"assets\\textures\\blue.png", // 33
+        L"assets\\textures\\red.png", // 34
+        L"assets\\sprites\\itemcandy.png", // 35
+        L"assets\\sprites\\heart.png", // 36
+        L"assets\\sprites\\splash.png", // 37
+        L"assets\\sprites\\splashspooky.png", // 38
+        L"assets\\sprites\\micro.png", // 39
+        L"assets\\sprites\\scarejam.png", // 40
+        L"assets\\sprites\\leftclick.png", // 41
+        L"assets\\sprites\\help.png" // 42
+    });
 
     sprite.CreateAnimation(std::vector<int>{13, 14}, 20.0f); // 0
 }
@@ -710,17 +802,10 @@ int EntityManager::CountAliveEnemies(int roomIndex)
 {
     const int ri = roomIndex < 0 ? m_curRoomIndex : roomIndex;
     if (ri == -1) return 0;
-    int count = 0;
-    for (int pass = 0; pass < 3; ++pass)
-    {
-        auto& entities = !pass ? m_rooms[ri] : (pass==1 ? m_omniEntities : m_entitiesToAdd);
-        for (auto& e : entities)
-        {
-            if (e->CanDie())
-                ++count;
-        }
-    }
-    return count;
+    auto countAlive = [](const std::shared_ptr<Entity>& e) { return e->CanDie(); };
+    return (int)(std::count_if(m_rooms[ri].begin(), m_rooms[ri].end(), countAlive)
+        + std::count_if(m_omniEntities.begin(), m_omniEntities.end(), countAlive)
+        + std::count_if(m_entitiesToAdd.begin(), m_entitiesToAdd.end(), countAlive));
 }
 void EntityManager::SetPause(bool p)
 {
@@ -1050,7 +1135,7 @@ EntityRandomSound::EntityRandomSound(uint32_t sound, float time0, float time1, b
     if (playOnFirst)
         DX::GameResources::instance->SoundPlay(m_sound, false);
     else
-        m_waitTime = DX::GameResources::instance->m_random.GetF(m_time0, m_time1);
+        m_waitTime = RND.GetF(m_time0, m_time1);
 }
 
 void EntityRandomSound::Update(float stepTime, const CameraFirstPerson& camera)
@@ -1061,7 +1146,7 @@ void EntityRandomSound::Update(float stepTime, const CameraFirstPerson& camera)
         DX::GameResources::instance->SoundPlay(m_sound, false);
         if ( m_end )
             Invalidate();
-        m_waitTime = m_waitTime = DX::GameResources::instance->m_random.GetF(m_time0, m_time1);
+        m_waitTime = m_waitTime = RND.GetF(m_time0, m_time1);
     }
 }
 
@@ -1110,7 +1195,7 @@ void EntityEnemyBase::FadeOut(float duration, bool invAfter)
 EntityProjectile* EntityEnemyBase::ShootToPlayer(int projSprIndex, float speed, const XMFLOAT3& offs, const XMFLOAT2& size, float life, bool predict, float waitTime)
 {
     auto gameRes = DX::GameResources::instance;
-    auto& rnd = gameRes->m_random;
+    auto& rnd = gameRes->Random(DX::RANDOM_AI);
     auto& cam = gameRes->m_camera;
 
     XMFLOAT3 origin = XM3Add(m_pos, offs);
@@ -1250,7 +1335,7 @@ void EnemyGargoyle::Update(float stepTime, const CameraFirstPerson& camera)
             {
                 auto gameRes = DX::GameResources::instance;
                 ShootToPlayer(19, 3.0f, XMFLOAT3(0, 0.5f, 0), XMFLOAT2(0.5f,0.5f));
-                m_timeToNextShoot = gameRes->m_random.GetF(0.5f, 5.0f);
+                m_timeToNextShoot = gameRes->Random(DX::RANDOM_AI).GetF(0.5f, 5.0f);
             }
         }
         else
@@ -1298,7 +1383,7 @@ void EnemyGirl::Update(float stepTime, const CameraFirstPerson& camera)
     if (m_timeOut < FBIGVAL) return; // is dying
     m_waitingForNextTarget -= stepTime;
     auto gameRes = DX::GameResources::instance;
-    auto& rnd = gameRes->m_random;
+    auto& rnd = gameRes->Random(DX::RANDOM_AI);
     switch (m_state)
     {
     case WAITING: 
@@ -1408,14 +1493,14 @@ void EnemyGirl::DoHit()
     {
         if (GetNextTargetPoint())
         {
-            m_speed = gameRes->m_random.GetF(2.0f, 4.5f);
+            m_speed = gameRes->Random(DX::RANDOM_AI).GetF(2.0f, 4.5f);
             m_state = GOING;
         }
         m_hitTime = 0.0f;
     }
     else
     {
-        m_hitTime = gameRes->m_random.GetF(1.0f, 3.5f);
+        m_hitTime = gameRes->Random(DX::RANDOM_AI).GetF(1.0f, 3.5f);
     }
     ModulateToColor(XM4RED, 0.5f);
     
@@ -1633,7 +1718,7 @@ EntitySingleDecoration::EntitySingleDecoration(DecorType type, const XMFLOAT3& p
     : m_type(type)
 {
     m_pos = pos;
-    auto& rnd = DX::GameResources::instance->m_random;
+    auto& rnd = RND;
     // we know the size and sprite index and pos.y of every decoration type
     switch (m_type)
     {
@@ -1771,8 +1856,8 @@ void EnemyGhost::DoHit()
     }
     else
     {
-        PlaySoundDistance(DX::GameResources::SFX_OUCH, 6.0f);       
         gameRes->SoundPitch(DX::GameResources::SFX_OUCH, -1.0f);
+        PlaySoundDistance(DX::GameResources::SFX_OUCH, 6.0f);
     }
 }
 
@@ -1818,8 +1903,8 @@ void EnemyGhost::JumpNextTargetPoint()
     const auto& selected = allowedMoves[RND.Get(0, c - 1)];
     m_pos.x = selected.x + 0.5f;
     m_pos.z = selected.y + 0.5f;
-    PlaySoundDistance(DX::GameResources::SFX_DASH, 8.0f);
     DX::GameResources::instance->SoundPitch(DX::GameResources::SFX_DASH, RND.GetF(-0.9f, 0.9f));
+    PlaySoundDistance(DX::GameResources::SFX_DASH, 8.0f);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1866,7 +1951,7 @@ EnemyBoss::EnemyBoss(const XMFLOAT3& pos)
         throw std::exception("No room for boss");
     m_roomNode->m_tag = 0x55000033;
     m_roomNode->m_finished = false;
-    auto& rnd = gameRes->m_random;
+    auto& rnd = gameRes->Random(DX::RANDOM_AI);
     const int n = rnd.Get(5, 15);
     for (int i = 0; i < n; ++i)
     {
@@ -1994,12 +2079,12 @@ void EnemyBoss::DoHit()
     {
         PlaySoundDistance(DX::GameResources::SFX_LAUGH, 8.0f, false);
         ShootToPlayer(9, 5.0f, XMFLOAT3(0, 0.5f, 0), XMFLOAT2(0.5f, 0.4f));
-        if ( gameRes->m_random.Get01() )
+        if ( gameRes->Random(DX::RANDOM_AI).Get01() )
             JumpRandom();
     }
 
     static const uint32_t densfunc[STATEMAX] = { 40,80,100 };
-    m_state = (eState)gameRes->m_random.GetWithDensity(densfunc, STATEMAX);
+    m_state = (eState)gameRes->Random(DX::RANDOM_AI).GetWithDensity(densfunc, STATEMAX);
     m_timeUntilNextState = 5.0f;
     SelectNextMovingPoint();
 }
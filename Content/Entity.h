@@ -2,7 +2,7 @@
 #include <DirectXMath.h>
 
 using namespace DirectX;
-namespace DX { class StepTimer;  class DeviceResources; }
+namespace DX { class StepTimer;  class DeviceResources; class RandomProvider; }
 
 namespace SpookyAdulthood
 {
@@ -29,7 +29,8 @@ namespace SpookyAdulthood
             COLLIDE=1<<6,
 
             INVALID=1<<7,
-            INACTIVE=1<<8
+            INACTIVE=1<<8,
+            SPAWNED=1<<9 // created by the room population
         };
 
         enum InvReason
@@ -91,6 +92,9 @@ namespace SpookyAdulthood
         void ReleaseDeviceDependentResources();
         void ReserveAndCreateEntities(int roomCount);
         void SetCurrentRoom(int roomIndex);
+        void PopulateRoom(int roomIndex);
+        void ReleaseRoom(int roomIndex);
+        DX::RandomProvider& ScopedRandom(); // room stream while populating, AI stream otherwise
 
         // romIndex can be -1 (current), -2 (persistent) or > 0 for specific room
         void AddEntity(const std::shared_ptr<Entity>& entity, int roomIndex= CURRENT_ROOM);
@@ -114,6 +118,8 @@ namespace SpookyAdulthood
         static EntityManager* s_instance;
         std::shared_ptr<DX::DeviceResources> m_device;
         void CreateEntities_Pumpkin(LevelMapBSPNode* room, int n, uint32_t prob);
+        bool m_lazySpawn; // def 1, rooms are populated when they get adjacent to the player's one
+        bool m_releaseFinishedRooms; // def 0, finished rooms away from the player drop their entities
 
     protected:
         bool RaycastEntity(const Entity& e, const XMFLOAT3& raypos, const XMFLOAT3& dir, XMFLOAT3& outhit, float& frac);
@@ -121,13 +127,21 @@ namespace SpookyAdulthood
         void CreateEntities_Girl(LevelMapBSPNode* room, int n, uint32_t prob);
         void CreateEntities_Gargoyle(LevelMapBSPNode* room, int n, uint32_t prob);
         void CreateEntities_BlackHands(LevelMapBSPNode* room, int n, uint32_t prob);
+        void CreateRoomPopulation(const std::shared_ptr<LevelMapBSPNode>& room);
+        DX::RandomProvider& SpawnRandom();
 
+        enum RoomState { ROOM_EMPTY=0, ROOM_POPULATED, ROOM_RELEASED };
         friend class Entity;
-        typedef std::vector<std::shared_ptr<Entity>> EntitiesCollection;
+        typedef std::vector<std::shared_ptr<Entity>, DX::TaggedAllocator<std::shared_ptr<Entity>, DX::MEMTAG_ENTITIES>> EntitiesCollection;
+        typedef DX::FrameVector<std::shared_ptr<Entity>> EntitiesToAdd; // only filled during Update
         
         std::vector<EntitiesCollection> m_rooms;
         EntitiesCollection m_omniEntities;
-        EntitiesCollection m_entitiesToAdd;
+        EntitiesToAdd m_entitiesToAdd;
+        std::vector<uint8_t> m_roomStates; // RoomState
+        std::vector<int> m_adjacentRooms; // scratch
+        DX::RandomProvider* m_spawnRandom; // only while populating a room
+        bool m_rebuildingRoom;
         int m_curRoomIndex;
         bool m_duringUpdate;
         bool m_paused;
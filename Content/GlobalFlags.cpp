@@ -1,6 +1,7 @@
 ﻿#include "pch.h"
 #include "GlobalFlags.h"
 #include "../Common/DeviceResources.h"
+#include <fstream>
 
 using namespace DirectX;
 
@@ -18,7 +19,15 @@ namespace SpookyAdulthood
     bool GlobalFlags::SpawnProjectile = false;
     int GlobalFlags::ShootHits = 0;
     bool GlobalFlags::KillRoom = false;
+    bool GlobalFlags::RunBenchmarks = false;
     bool GlobalFlags::DrawFlags = false;
+    bool GlobalFlags::DrawProfiler = false;
+    bool GlobalFlags::ExportProfile = false;
+    bool GlobalFlags::ExportFrameTimes = false;
+    bool GlobalFlags::CheckCollisions = false;
+
+    // the main loop timer, for the pacing stats
+    static const DX::StepTimer* g_timer = nullptr;
     XMFLOAT2 GlobalFlags::DrawGlobalsPos(10, 10);
 
     template<typename T>
@@ -82,6 +91,72 @@ namespace SpookyAdulthood
                 swprintf(buff, 256, L"CamPos=%.2f, %.2f, %.2f", cp.x, cp.y, cp.z);
                 f->DrawString(s, buff, p, Colors::White);
                 p.y += padY;
+
+                swprintf(buff, 256, L"Level swap=%lld us (seed %08x)", dxCommon->m_levelSwapUs, dxCommon->m_levelSeed);
+                f->DrawString(s, buff, p, Colors::White);
+                p.y += padY;
+
+                const auto& vs = dxCommon->m_voices.GetStats();
+                swprintf(buff, 256, L"Voices=%u/%u (peak %u) stolen=%u culled=%u rejected=%u", 
+                    vs.m_active, dxCommon->m_voices.GetMaxVoices(), vs.m_peak, vs.m_stolen, vs.m_culled, vs.m_rejected);
+                f->DrawString(s, buff, p, Colors::White);
+                p.y += padY;
+
+                const auto& fa = dxCommon->m_frameArenaStats;
+                swprintf(buff, 256, L"Frame heap allocs=%u arena=%u allocs %.1f/%.1f KB (%u blocks)",
+                    dxCommon->m_frameHeapAllocations, fa.m_allocations, fa.m_bytes / 1024.0f, fa.m_capacity / 1024.0f, fa.m_blocks);
+                f->DrawString(s, buff, p, Colors::White);
+                p.y += padY;
+
+                DX::MemorySnapshot mem;
+                DX::MemoryTracker::GetSnapshot(mem);
+                for (uint32_t i = 0; mem.m_tracking && i < DX::MEMTAG_COUNT; ++i)
+                {
+                    const auto& t = mem.m_tags[i];
+                    swprintf(buff, 256, L"Mem %-10S %9.1f KB %7lld blocks  peak %9.1f KB  %llu allocs",
+                        DX::MemoryTracker::GetTagName((DX::MemoryTag)i), t.m_liveBytes / 1024.0, t.m_liveAllocations, t.m_peakBytes / 1024.0, t.m_allocations);
+                    f->DrawString(s, buff, p, Colors::White);
+                    p.y += padY;
+                }
+
+                if (g_timer)
+                {
+                    const auto ms = [](uint64_t ticks) { return (float)(DX::StepTimer::TicksToSeconds(ticks) * 1000.0); };
+                    swprintf(buff, 256, L"Frame p50=%.1f p99=%.1f max=%.1f ms hitches=%u catch-up=%u dropped=%.0f ms (F3 csv)",
+                        ms(g_timer->GetFrameTimePercentile(50)), ms(g_timer->GetFrameTimePercentile(99)), ms(g_timer->GetFrameTimePercentile(100)),
+                        g_timer->GetHitchCount(), g_timer->GetCatchUpFrames(), g_timer->GetDroppedSeconds() * 1000.0);
+                    f->DrawString(s, buff, p, Colors::White);
+                    p.y += padY;
+                }
+            }
+            s->End();
+        }
+#endif
+
+#if DX_PROFILER
+        if (ExportProfile)
+        {
+            ExportProfile = false;
+            const std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path->Data()) + L"\\profile.json";
+            const bool ok = DX::Profiler::ExportChromeTrace(path);
+            swprintf(buff, 256, L"%s %s\n", ok ? L"Profile written to" : L"ERROR: can't write profile", path.c_str());
+            OutputDebugStringW(buff);
+        }
+
+        if (DrawProfiler)
+        {
+            s->Begin();
+            {
+                swprintf(buff, 256, L"%-40S %7s %8s %8s %8s %8s", "Scope (F2 export)", L"calls", L"mean us", L"p50", L"p99", L"max");
+                f->DrawString(s, buff, p, Colors::Yellow);
+                p.y += padY;
+                for (const auto& st : DX::Profiler::GetStats())
+                {
+                    swprintf(buff, 256, L"%*S%-*S %7.1f %8.1f %8.1f %8.1f %8.1f", st.m_depth * 2, "", 40 - st.m_depth * 2, st.m_name,
+                        st.m_callsPerFrame, st.m_meanUs, st.m_p50Us, st.m_p99Us, st.m_maxUs);
+                    f->DrawString(s, buff, p, Colors::White);
+                    p.y += padY;
+                }
             }
             s->End();
         }
@@ -90,6 +165,17 @@ namespace SpookyAdulthood
 
     void GlobalFlags::Update(const DX::StepTimer& timer)
     {
+        g_timer = &timer;
+        if (ExportFrameTimes)
+        {
+            ExportFrameTimes = false;
+            const std::wstring path = std::wstring(Windows::Storage::ApplicationData::Current->TemporaryFolder->Path->Data()) + L"\\frametimes.csv";
+            std::ofstream csv(path.c_str());
+            timer.WriteFrameTimesCsv(csv);
+            wchar_t buff[256];
+            swprintf(buff, 256, L"%s %s\n", csv.good() ? L"Frame times written to" : L"ERROR: can't write frame times", path.c_str());
+            OutputDebugStringW(buff);
+        }
     }
 
     void GlobalFlags::OnKeyDown(Windows::System::VirtualKey virtualKey)
@@ -113,6 +199,9 @@ namespace SpookyAdulthood
             case VirtualKey::Number0:
                 DrawFlags = !DrawFlags;
             break;            
+            case VirtualKey::Number1:
+                RunBenchmarks = true;
+            break;
             case VirtualKey::Number2:
                 SpawnPlayer = true;
             break;
@@ -142,6 +231,18 @@ namespace SpookyAdulthood
             case VirtualKey::Number9:
                 KillRoom = true;
             break;
+            case VirtualKey::F1:
+                DrawProfiler = !DrawProfiler;
+            break;
+            case VirtualKey::F2:
+                ExportProfile = true;
+            break;
+            case VirtualKey::F3:
+                ExportFrameTimes = true;
+            break;
+            case VirtualKey::F4:
+                CheckCollisions = true;
+            break;
 #endif
 
         }
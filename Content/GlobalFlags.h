@@ -4,7 +4,7 @@ namespace DX { class DeviceResources; }
 namespace SpookyAdulthood
 {
 
-    static const uint32_t RANDOM_DEFAULT_SEED = 997;
+    static const uint32_t RANDOM_DEFAULT_SEED = DX::RandomProvider::DEFAULT_SEED;
 
     struct GlobalFlags
     {
@@ -14,6 +14,7 @@ namespace SpookyAdulthood
         static bool DrawDebugLines; // def 0
         static bool DrawLevelGeometry; // def 1
         static bool DrawFlags; // def 1
+        static bool DrawProfiler; // def 0
         static bool DrawWireframe; // def 0
         static bool ThumbMapAll; // def 0
         static bool AllLit; // def 0
@@ -22,6 +23,10 @@ namespace SpookyAdulthood
         static bool SpawnPlayer; // def 0 (auto)
         static bool SpawnProjectile; // def 0 (auto)
         static bool KillRoom; // def 0 (auto)
+        static bool RunBenchmarks; // def 0 (auto)
+        static bool ExportProfile; // def 0 (auto)
+        static bool ExportFrameTimes; // def 0 (auto)
+        static bool CheckCollisions; // def 0 (auto)
 
         static DirectX::XMFLOAT2 DrawGlobalsPos; // def 10,10
         static int ShootHits; // def 0
@@ -0,0 +1,602 @@
+﻿#include "pch.h"
+#include "ImageDecoder.h"
+
+using namespace SpookyAdulthood;
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+#pragma region Inflate
+namespace
+{
+    // Canonical Huffman decoder: codes up to FAST_BITS long resolve with one table
+    // lookup, longer ones by comparing against the first code of every length
+    enum { FAST_BITS = 9, FAST_SIZE = 1 << FAST_BITS, MAX_BITS = 15 };
+
+    struct Huffman
+    {
+        uint16_t m_fast[FAST_SIZE];     // (length << 9) | symbol, 0 when the code is longer
+        uint16_t m_firstCode[MAX_BITS + 2];
+        uint16_t m_firstSymbol[MAX_BITS + 2];
+        int32_t m_maxCode[MAX_BITS + 2];   // one past the last code of each length, left aligned to 16 bits
+        uint8_t m_size[288];
+        uint16_t m_value[288];
+
+        bool Build(const uint8_t* lengths, int count)
+        {
+            int sizes[MAX_BITS + 1] = {};
+            memset(m_fast, 0, sizeof(m_fast));
+            for (int i = 0; i < count; ++i)
+                ++sizes[lengths[i]];
+            sizes[0] = 0;
+            for (int i = 1; i <= MAX_BITS; ++i)
+            {
+                if (sizes[i] > (1 << i))
+                    return false;
+            }
+
+            int nextCode[MAX_BITS + 1];
+            int code = 0, symbol = 0;
+            for (int i = 1; i <= MAX_BITS; ++i)
+            {
+                nextCode[i] = code;
+                m_firstCode[i] = (uint16_t)code;
+                m_firstSymbol[i] = (uint16_t)symbol;
+                code += sizes[i];
+                if (sizes[i] && code - 1 >= (1 << i))
+                    return false;
+                m_maxCode[i] = code << (16 - i);
+                code <<= 1;
+                symbol += sizes[i];
+            }
+            m_maxCode[MAX_BITS + 1] = 0x10000;
+
+            for (int i = 0; i < count; ++i)
+            {
+                const int s = lengths[i];
+                if (!s) continue;
+                const int c = nextCode[s] - m_firstCode[s] + m_firstSymbol[s];
+                m_size[c] = (uint8_t)s;
+                m_value[c] = (uint16_t)i;
+                if (s <= FAST_BITS)
+                {
+                    // codes are stored msb first, the bit reader hands them out lsb first
+                    int j = ReverseBits(nextCode[s], s);
+                    while (j < FAST_SIZE)
+                    {
+                        m_fast[j] = (uint16_t)((s << 9) | i);
+                        j += 1 << s;
+                    }
+                }
+                ++nextCode[s];
+            }
+            return true;
+        }
+
+        static int ReverseBits(int v, int bits)
+        {
+            int r = 0;
+            for (int i = 0; i < bits; ++i, v >>= 1)
+                r = (r << 1) | (v & 1);
+            return r;
+        }
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size) : m_ptr(data), m_end(data + size), m_bits(0), m_count(0), m_overrun(false) {}
+
+        // past the end of the input the buffer is left short, readers check m_count
+        void Refill()
+        {
+            while (m_count <= 56 && m_ptr < m_end)
+            {
+                m_bits |= (uint64_t)*m_ptr++ << m_count;
+                m_count += 8;
+            }
+        }
+
+        uint32_t Get(int n)
+        {
+            if (m_count < n) Refill();
+            if (m_count < n) { m_overrun = true; return 0; }
+            const uint32_t v = (uint32_t)(m_bits & ((1ULL << n) - 1));
+            m_bits >>= n;
+            m_count -= n;
+            return v;
+        }
+
+        int Decode(const Huffman& h)
+        {
+            if (m_count < 16) Refill();
+            const int fast = h.m_fast[m_bits & (FAST_SIZE - 1)];
+            if (fast)
+            {
+                const int s = fast >> 9;
+                if (s > m_count) { m_overrun = true; return -1; }
+                m_bits >>= s;
+                m_count -= s;
+                return fast & 511;
+            }
+            const int k = Huffman::ReverseBits((int)(m_bits & 0xffff), 16);
+            int s = FAST_BITS + 1;
+            while (k >= h.m_maxCode[s])
+                ++s;
+            if (s > MAX_BITS || s > m_count)
+                return -1;
+            const int b = (k >> (16 - s)) - h.m_firstCode[s] + h.m_firstSymbol[s];
+            if (b < 0 || b >= 288 || h.m_size[b] != s)
+                return -1;
+            m_bits >>= s;
+            m_count -= s;
+            return h.m_value[b];
+        }
+
+        // stored blocks start on a byte boundary
+        void AlignToByte() { const int drop = m_count & 7; m_bits >>= drop; m_count -= drop; }
+
+        bool CopyBytes(uint8_t* dst, size_t n)
+        {
+            // drain what is buffered, then straight from the input
+            while (n && m_count >= 8)
+            {
+                *dst++ = (uint8_t)m_bits;
+                m_bits >>= 8;
+                m_count -= 8;
+                --n;
+            }
+            if ((size_t)(m_end - m_ptr) < n)
+                return false;
+            if (n) // an empty stored block into an empty image has no dst
+                memcpy(dst, m_ptr, n);
+            m_ptr += n;
+            return true;
+        }
+
+        bool Overrun() const { return m_overrun; }
+
+    private:
+        const uint8_t* m_ptr;
+        const uint8_t* m_end;
+        uint64_t m_bits;
+        int m_count;
+        bool m_overrun;
+    };
+
+    const uint16_t g_lengthBase[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+    const uint8_t g_lengthExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+    const uint16_t g_distBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+    const uint8_t g_distExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+    const uint8_t g_codeLengthOrder[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+    bool BuildDynamic(BitReader& in, Huffman& lit, Huffman& dist)
+    {
+        const int hlit = (int)in.Get(5) + 257;
+        const int hdist = (int)in.Get(5) + 1;
+        const int hclen = (int)in.Get(4) + 4;
+        if (hlit > 286 || hdist > 30)
+            return false;
+
+        uint8_t clen[19] = {};
+        for (int i = 0; i < hclen; ++i)
+            clen[g_codeLengthOrder[i]] = (uint8_t)in.Get(3);
+        Huffman lengths;
+        if (!lengths.Build(clen, 19))
+            return false;
+
+        uint8_t all[286 + 30] = {};
+        int n = 0;
+        while (n < hlit + hdist)
+        {
+            const int c = in.Decode(lengths);
+            if (c < 0 || in.Overrun())
+                return false;
+            if (c < 16)
+            {
+                all[n++] = (uint8_t)c;
+                continue;
+            }
+            int repeat = 0;
+            uint8_t value = 0;
+            if (c == 16)
+            {
+                if (!n) return false;
+                value = all[n - 1];
+                repeat = 3 + (int)in.Get(2);
+            }
+            else if (c == 17)
+                repeat = 3 + (int)in.Get(3);
+            else
+                repeat = 11 + (int)in.Get(7);
+            if (n + repeat > hlit + hdist)
+                return false;
+            memset(all + n, value, repeat);
+            n += repeat;
+        }
+        return lit.Build(all, hlit) && dist.Build(all + hlit, hdist);
+    }
+
+    bool BuildFixed(Huffman& lit, Huffman& dist)
+    {
+        uint8_t l[288], d[30];
+        memset(l, 8, 144);
+        memset(l + 144, 9, 112);
+        memset(l + 256, 7, 24);
+        memset(l + 280, 8, 8);
+        memset(d, 5, 30);
+        return lit.Build(l, 288) && dist.Build(d, 30);
+    }
+}
+
+bool SpookyAdulthood::Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t expectedSize)
+{
+    // zlib header: deflate, window up to 32K, no preset dictionary
+    if (size < 2 || (data[0] & 0x0f) != 8 || (data[0] >> 4) > 7 || ((data[0] << 8) | data[1]) % 31 || (data[1] & 0x20))
+        return false;
+
+    out.resize(expectedSize);
+    uint8_t* dst = out.data();
+    uint8_t* const dstEnd = dst + expectedSize;
+    BitReader in(data + 2, size - 2);
+    std::unique_ptr<Huffman> lit(new Huffman), dist(new Huffman);
+
+    bool last = false;
+    while (!last)
+    {
+        last = in.Get(1) != 0;
+        const uint32_t type = in.Get(2);
+        if (type == 0)
+        {
+            in.AlignToByte();
+            const uint32_t len = in.Get(16);
+            const uint32_t nlen = in.Get(16);
+            if ((len ^ 0xffff) != nlen || len > (size_t)(dstEnd - dst) || !in.CopyBytes(dst, len))
+                return false;
+            dst += len;
+            continue;
+        }
+        if (type == 3 || !(type == 1 ? BuildFixed(*lit, *dist) : BuildDynamic(in, *lit, *dist)))
+            return false;
+
+        for (;;)
+        {
+            const int sym = in.Decode(*lit);
+            if (sym < 0 || in.Overrun())
+                return false;
+            if (sym < 256)
+            {
+                if (dst == dstEnd) return false;
+                *dst++ = (uint8_t)sym;
+                continue;
+            }
+            if (sym == 256)
+                break;
+            if (sym > 285)
+                return false;
+            const size_t len = g_lengthBase[sym - 257] + in.Get(g_lengthExtra[sym - 257]);
+            const int dsym = in.Decode(*dist);
+            if (dsym < 0 || dsym > 29)
+                return false;
+            const size_t back = g_distBase[dsym] + in.Get(g_distExtra[dsym]);
+            if (back > (size_t)(dst - out.data()) || len > (size_t)(dstEnd - dst))
+                return false;
+            const uint8_t* src = dst - back;
+            if (back >= len)
+            {
+                memcpy(dst, src, len);
+                dst += len;
+            }
+            else
+            {
+                // overlapping run, byte by byte
+                for (size_t i = 0; i < len; ++i)
+                    *dst++ = src[i];
+            }
+        }
+    }
+    return dst == dstEnd && !in.Overrun();
+}
+#pragma endregion
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+#pragma region PixelKernels
+void PixelKernels::RGBToRGBAScalar(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+    }
+}
+
+void PixelKernels::RGBToRGBA(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+    size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+    // 4 pixels per step from a 16 byte load, so stop 6 pixels early to stay inside src
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    for (; i + 6 <= pixels; i += 4)
+    {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        const __m128i p01 = _mm_unpacklo_epi32(x, _mm_srli_si128(x, 3));
+        const __m128i p23 = _mm_unpacklo_epi32(_mm_srli_si128(x, 6), _mm_srli_si128(x, 9));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_unpacklo_epi64(p01, p23), alpha));
+    }
+#endif
+    RGBToRGBAScalar(src + i * 3, dst + i * 4, pixels - i);
+}
+
+void PixelKernels::PremultiplyScalar(uint8_t* rgba, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i, rgba += 4)
+    {
+        const uint32_t a = rgba[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            // exact round(v*a/255)
+            const uint32_t t = rgba[c] * a + 128;
+            rgba[c] = (uint8_t)((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+void PixelKernels::Premultiply(uint8_t* rgba, size_t pixels)
+{
+    size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);   // alpha lanes pass through
+    for (; i + 4 <= pixels; i += 4)
+    {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(rgba + i * 4));
+        __m128i halves[2] = { _mm_unpacklo_epi8(x, zero), _mm_unpackhi_epi8(x, zero) };
+        for (auto& h : halves)
+        {
+            // alpha of each pixel in its 4 lanes, 1.0 (255) in the alpha lane itself
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(h, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            a = _mm_or_si128(_mm_andnot_si128(alphaMask, a), _mm_and_si128(alphaMask, _mm_set1_epi16(255)));
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(h, a), round);
+            h = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+        _mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+    }
+#endif
+    PremultiplyScalar(rgba + i * 4, pixels - i);
+}
+#pragma endregion
+
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+#pragma region PNG
+namespace
+{
+    uint32_t ReadBE32(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    uint8_t Paeth(int a, int b, int c)
+    {
+        const int p = a + b - c;
+        const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        if (pa <= pb && pa <= pc) return (uint8_t)a;
+        return (uint8_t)(pb <= pc ? b : c);
+    }
+
+    // Undoes the per-row filters in place, rows are 1 filter byte + stride bytes
+    bool Unfilter(uint8_t* data, uint32_t height, size_t stride, int bpp)
+    {
+        const uint8_t* prior = nullptr;
+        uint8_t* out = data;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t filter = data[y * (stride + 1)];
+            uint8_t* row = data + y * (stride + 1) + 1;
+            switch (filter)
+            {
+            case 0:
+                break;
+            case 1:
+                for (size_t x = bpp; x < stride; ++x)
+                    row[x] = (uint8_t)(row[x] + row[x - bpp]);
+                break;
+            case 2:
+                if (prior)
+                {
+                    size_t x = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                    for (; x + 16 <= stride; x += 16)
+                    {
+                        const __m128i r = _mm_loadu_si128((const __m128i*)(row + x));
+                        _mm_storeu_si128((__m128i*)(row + x), _mm_add_epi8(r, _mm_loadu_si128((const __m128i*)(prior + x))));
+                    }
+#endif
+                    for (; x < stride; ++x)
+                        row[x] = (uint8_t)(row[x] + prior[x]);
+                }
+                break;
+            case 3:
+                for (size_t x = 0; x < stride; ++x)
+                {
+                    const int left = x >= (size_t)bpp ? row[x - bpp] : 0;
+                    const int up = prior ? prior[x] : 0;
+                    row[x] = (uint8_t)(row[x] + ((left + up) >> 1));
+                }
+                break;
+            case 4:
+                for (size_t x = 0; x < stride; ++x)
+                {
+                    const int left = x >= (size_t)bpp ? row[x - bpp] : 0;
+                    const int up = prior ? prior[x] : 0;
+                    const int upLeft = (prior && x >= (size_t)bpp) ? prior[x - bpp] : 0;
+                    row[x] = (uint8_t)(row[x] + Paeth(left, up, upLeft));
+                }
+                break;
+            default:
+                return false;
+            }
+            // compact the rows as we go, the filter bytes are not needed anymore
+            memmove(out, row, stride);
+            prior = out;
+            out += stride;
+        }
+        return true;
+    }
+}
+
+PngResult SpookyAdulthood::DecodePNG(const uint8_t* data, size_t size, DecodedImage& out, bool premultiply)
+{
+    static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    if (size < 8 + 25 || memcmp(data, signature, 8) != 0)
+        return PNG_CORRUPT;
+
+    uint32_t width = 0, height = 0;
+    int depth = 0, colorType = -1, interlace = 0;
+    uint8_t palette[256 * 4];
+    uint32_t paletteCount = 0;
+    bool hasKey = false;
+    uint16_t key[3] = {};
+    bool sRGB = false;
+    std::vector<uint8_t> idat;
+
+    // chunk CRCs are not checked, the zlib stream catches truncated data
+    size_t pos = 8;
+    bool ended = false;
+    while (!ended)
+    {
+        if (size - pos < 12)
+            return PNG_CORRUPT;
+        const uint32_t len = ReadBE32(data + pos);
+        const uint32_t type = ReadBE32(data + pos + 4);
+        if (len > size - pos - 12)
+            return PNG_CORRUPT;
+        const uint8_t* chunk = data + pos + 8;
+        switch (type)
+        {
+        case 0x49484452: // IHDR
+            if (len != 13 || pos != 8)
+                return PNG_CORRUPT;
+            width = ReadBE32(chunk);
+            height = ReadBE32(chunk + 4);
+            depth = chunk[8];
+            colorType = chunk[9];
+            interlace = chunk[12];
+            if (!width || !height || width > (1u << 16) || height > (1u << 16) || chunk[10] || chunk[11] || interlace > 1)
+                return PNG_CORRUPT;
+            break;
+        case 0x504c5445: // PLTE
+            if (len % 3 || len > 256 * 3)
+                return PNG_CORRUPT;
+            paletteCount = len / 3;
+            for (uint32_t i = 0; i < paletteCount; ++i)
+            {
+                palette[i * 4 + 0] = chunk[i * 3 + 0];
+                palette[i * 4 + 1] = chunk[i * 3 + 1];
+                palette[i * 4 + 2] = chunk[i * 3 + 2];
+                palette[i * 4 + 3] = 255;
+            }
+            break;
+        case 0x74524e53: // tRNS
+            if (colorType == 3)
+            {
+                if (len > paletteCount)
+                    return PNG_CORRUPT;
+                for (uint32_t i = 0; i < len; ++i)
+                    palette[i * 4 + 3] = chunk[i];
+            }
+            else if (colorType == 2 && len == 6)
+            {
+                hasKey = true;
+                for (int c = 0; c < 3; ++c)
+                    key[c] = (uint16_t)((chunk[c * 2] << 8) | chunk[c * 2 + 1]);
+            }
+            break;
+        case 0x73524742: // sRGB
+            sRGB = true;
+            break;
+        case 0x49444154: // IDAT
+            idat.insert(idat.end(), chunk, chunk + len);
+            break;
+        case 0x49454e44: // IEND
+            ended = true;
+            break;
+        }
+        pos += 12 + len;
+    }
+
+    if (colorType < 0 || idat.empty() || (colorType == 3 && !paletteCount))
+        return PNG_CORRUPT;
+
+    int channels = 0;
+    switch (colorType)
+    {
+    case 2: channels = 3; break;
+    case 3: channels = 1; break;
+    case 6: channels = 4; break;
+    case 0:
+    case 4: return PNG_UNSUPPORTED; // WIC loads these as R8/RG, keep that
+    default: return PNG_CORRUPT;
+    }
+    const bool paletteDepth = colorType == 3 && (depth == 1 || depth == 2 || depth == 4);
+    if (depth == 16 || interlace)
+        return PNG_UNSUPPORTED;
+    if (depth != 8 && !paletteDepth)
+        return PNG_CORRUPT;
+
+    const size_t stride = ((size_t)width * channels * depth + 7) / 8;
+    const int bpp = std::max(1, channels * depth / 8);
+    std::vector<uint8_t> raw;
+    if (!Inflate(idat.data(), idat.size(), raw, (stride + 1) * height) || !Unfilter(raw.data(), height, stride, bpp))
+        return PNG_CORRUPT;
+
+    out.m_width = width;
+    out.m_height = height;
+    out.m_sRGB = sRGB;
+    out.m_premultiplied = premultiply;
+    out.m_pixels.resize((size_t)width * height * 4);
+    uint8_t* dst = out.m_pixels.data();
+    const size_t pixels = (size_t)width * height;
+
+    if (colorType == 6)
+    {
+        memcpy(dst, raw.data(), pixels * 4);
+    }
+    else if (colorType == 2)
+    {
+        PixelKernels::RGBToRGBA(raw.data(), dst, pixels);
+        if (hasKey)
+        {
+            for (size_t i = 0; i < pixels; ++i)
+            {
+                uint8_t* p = dst + i * 4;
+                if (p[0] == key[0] && p[1] == key[1] && p[2] == key[2])
+                    p[3] = 0;
+            }
+        }
+    }
+    else
+    {
+        const int perByte = 8 / depth;
+        const uint32_t mask = (1u << depth) - 1;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* row = raw.data() + y * stride;
+            for (uint32_t x = 0; x < width; ++x, dst += 4)
+            {
+                const uint32_t index = depth == 8 ? row[x] : (row[x / perByte] >> ((perByte - 1 - x % perByte) * depth)) & mask;
+                if (index >= paletteCount)
+                    return PNG_CORRUPT;
+                memcpy(dst, palette + index * 4, 4);
+            }
+        }
+    }
+
+    if (premultiply)
+        PixelKernels::Premultiply(out.m_pixels.data(), pixels);
+    return PNG_OK;
+}
+#pragma endregion
@@ -0,0 +1,44 @@
+﻿#pragma once
+
+namespace SpookyAdulthood
+{
+    //* ***************************************************************** *//
+    //* Image decoding
+    //* Portable PNG decoder (no WIC, no Windows headers) producing RGBA8,
+    //* plus the SSE2 pixel kernels it uses. Runs on any thread
+    //* ***************************************************************** *//
+    struct DecodedImage
+    {
+        DecodedImage() : m_width(0), m_height(0), m_sRGB(false), m_premultiplied(false) {}
+
+        uint32_t m_width;
+        uint32_t m_height;
+        std::vector<uint8_t> m_pixels;  // RGBA8, m_width*4 bytes per row
+        bool m_sRGB;                    // had an sRGB chunk, uploaded as an _SRGB format like the WIC loader does
+        bool m_premultiplied;
+    };
+
+    enum PngResult
+    {
+        PNG_OK = 0,
+        PNG_UNSUPPORTED,                // valid but left to WIC: grayscale, 16 bit, interlaced
+        PNG_CORRUPT,
+    };
+
+    // 8 bit truecolor, truecolor+alpha and palette (1/2/4/8 bit) images, tRNS included
+    PngResult DecodePNG(const uint8_t* data, size_t size, DecodedImage& out, bool premultiply = false);
+
+    // zlib stream (RFC 1950/1951) into out, which must end up exactly expectedSize bytes
+    bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out, size_t expectedSize);
+
+    namespace PixelKernels
+    {
+        // 24 bit RGB to RGBA8 with opaque alpha
+        void RGBToRGBA(const uint8_t* src, uint8_t* dst, size_t pixels);
+        void RGBToRGBAScalar(const uint8_t* src, uint8_t* dst, size_t pixels);
+
+        // rgb*a/255 rounded to nearest, in place. Both versions match bit for bit
+        void Premultiply(uint8_t* rgba, size_t pixels);
+        void PremultiplyScalar(uint8_t* rgba, size_t pixels);
+    }
+}
@@ -0,0 +1,190 @@
+﻿#include "pch.h"
+#include "LevelBSP.h"
+#include "../Common/RandomProvider.h"
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    // in LevelMap::RoomProfile order
+    const uint32_t RPDENSITY[LevelBSPNode::PROFILE_COUNT] = {
+        10, 30, 40, 50, 60, 70, 80, 90, 100
+    };
+
+    // probability range of a tile being a pillar, none when 0
+    const float RPPILLARS[LevelBSPNode::PROFILE_COUNT][2] = {
+        { 0.01f, 0.3f },    // RP_NORMAL0
+        { 0.2f, 0.5f },     // RP_NORMAL1
+        { 0.0f, 0.0f },     // RP_GRAVE
+        { 0.0f, 0.0f },     // RP_WOODS
+        { 0.01f, 0.15f },   // RP_BODYPILES
+        { 0.01f, 0.1f },    // RP_GARGOYLES
+        { 0.01f, 0.2f },    // RP_HANDS
+        { 0.01f, 0.05f },   // RP_SCARYMESSAGES
+        { 0.0f, 0.0f },     // RP_PUMPKINFIELD
+    };
+
+    void SplitArea(const LevelMapBSPTileArea& area, uint32_t at, LevelBSPNode::NodeType wallDir, LevelMapBSPTileArea* outAreas)
+    {
+        outAreas[0] = outAreas[1] = area;
+        switch (wallDir)
+        {
+        case LevelBSPNode::WALL_VERT:
+            outAreas[0].m_x0 = area.m_x0; outAreas[0].m_x1 = at - 1;
+            outAreas[1].m_x0 = at; outAreas[1].m_x1 = area.m_x1;
+            break;
+
+        case LevelBSPNode::WALL_HORIZ:
+            outAreas[0].m_y0 = area.m_y0; outAreas[0].m_y1 = at - 1;
+            outAreas[1].m_y0 = at; outAreas[1].m_y1 = area.m_y1;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    bool CanBeRoom(const LevelMapBSPTileArea& area, const LevelBSPParams& params, uint32_t depth, DX::RandomProvider& random)
+    {
+        // not there yet
+        if (depth < params.m_minRecursiveDepth || area.SizeX() >= params.m_maxTileCount[0] || area.SizeY() >= params.m_maxTileCount[1])
+            return false;
+
+        // minimum enough to be a room
+        if (depth >= params.m_maxRecursiveDepth || area.SizeX() == params.m_minTileCount[0] || area.SizeY() == params.m_minTileCount[1])
+            return true;
+
+        float dice = random.Get(1, 100)*0.01f;
+        return dice < params.m_probRoom;
+    }
+}
+
+bool LevelBSPNode::operator ==(const LevelBSPNode& rhs) const
+{
+    return m_area == rhs.m_area && m_type == rhs.m_type && m_children[0] == rhs.m_children[0] && m_children[1] == rhs.m_children[1] &&
+        m_profile == rhs.m_profile && m_firstPillar == rhs.m_firstPillar && m_pillarCount == rhs.m_pillarCount;
+}
+
+void LevelBSPLayout::Generate(const LevelBSPParams& params, const DX::RandomProvider& stream)
+{
+    Clear();
+    LevelMapBSPTileArea area(0, params.m_tileCount[0] - 1, 0, params.m_tileCount[1] - 1);
+    RecursiveGenerate(area, params, 0, stream);
+}
+
+void LevelBSPLayout::Append(const LevelBSPLayout& subtree)
+{
+    const int32_t nodeBase = (int32_t)m_nodes.size();
+    const uint32_t pillarBase = (uint32_t)m_pillars.size();
+    for (LevelBSPNode n : subtree.m_nodes)
+    {
+        for (int i = 0; i < 2; ++i)
+            if (n.m_children[i] != -1) n.m_children[i] += nodeBase;
+        n.m_firstPillar += pillarBase;
+        m_nodes.push_back(n);
+    }
+    m_pillars.insert(m_pillars.end(), subtree.m_pillars.begin(), subtree.m_pillars.end());
+}
+
+void LevelBSPLayout::RecursiveGenerate(const LevelMapBSPTileArea& area, const LevelBSPParams& params, uint32_t depth, DX::RandomProvider random)
+{
+    // nodes are referenced by index, the vector grows while the children are generated
+    const size_t self = m_nodes.size();
+    {
+        LevelBSPNode node;
+        node.m_area = area;
+        node.m_type = LevelBSPNode::NODE_UNKNOWN;
+        node.m_children[0] = node.m_children[1] = -1;
+        node.m_profile = 0;
+        node.m_firstPillar = (uint32_t)m_pillars.size();
+        node.m_pillarCount = 0;
+        m_nodes.push_back(node);
+    }
+
+    // It's an EMPTY? any dimension is not large enough to be a room
+    if (area.SizeX() < params.m_minTileCount[0] ||
+        area.SizeY() < params.m_minTileCount[1])
+    {
+        m_nodes[self].m_type = LevelBSPNode::NODE_EMPTY;
+        // leaf, no children
+        return;
+    }
+
+    // Can be a ROOM?
+    if (CanBeRoom(area, params, depth, random))
+    {
+        m_nodes[self].m_type = LevelBSPNode::NODE_ROOM;
+        const uint32_t profile = random.GetWithDensity(RPDENSITY, LevelBSPNode::PROFILE_COUNT);
+        m_nodes[self].m_profile = profile;
+
+        // pillars, not next to a door (can block a door)
+        const float* probRange = RPPILLARS[profile];
+        if (probRange[1] > 0.0f && area.SizeX() > 2 && area.SizeY() > 2)
+        {
+            uint32_t sx = area.SizeX() - 2;
+            uint32_t sy = area.SizeY() - 2;
+            if (sx >= params.m_minForPillars[0] && sy >= params.m_minForPillars[1])
+            {
+                // compute no of pillars, a new one is added only if it doesn't exist already
+                int areaSize = sx*sy;
+                float p = random.GetF(probRange[0], probRange[1]);
+                int nPillars = (int)(areaSize*p);
+                const size_t first = m_pillars.size();
+                m_pillars.reserve(first + nPillars);
+                for (int i = 0; i < nPillars; ++i)
+                {
+                    LevelBSPPillar newPillar;
+                    newPillar.x = random.Get(area.m_x0 + 1, area.m_x1 - 1);
+                    newPillar.y = random.Get(area.m_y0 + 1, area.m_y1 - 1);
+                    if (std::find(m_pillars.begin() + first, m_pillars.end(), newPillar) == m_pillars.end())
+                        m_pillars.push_back(newPillar);
+                }
+                m_nodes[self].m_pillarCount = (uint32_t)(m_pillars.size() - first);
+            }
+        }
+        // leaf, no children
+        return;
+    }
+
+    // WALL node (split)
+    const LevelBSPNode::NodeType wallDir = (LevelBSPNode::NodeType)(LevelBSPNode::WALL_VERT + (depth % 2)); // each depth alternate wall dir
+    uint32_t at = 0;
+    LevelMapBSPTileArea wallArea = area;
+    if (wallDir == LevelBSPNode::WALL_VERT) // random division plane
+    {
+        at = area.m_x0 + random.Get(0, area.SizeX() - 1);
+        wallArea.m_x0 = wallArea.m_x1 = at;
+    }
+    else
+    {
+        at = area.m_y0 + random.Get(0, area.SizeY() - 1);
+        wallArea.m_y0 = wallArea.m_y1 = at;
+    }
+    m_nodes[self].m_type = wallDir;
+    m_nodes[self].m_area = wallArea;
+
+    // get the two sub-areas and subdivide them recursively
+    LevelMapBSPTileArea newAreas[2];
+    SplitArea(area, at, wallDir, newAreas);
+    if (params.m_parallelMinTiles && area.CountTiles() >= params.m_parallelMinTiles)
+    {
+        // each half in its own layout, appended in order after
+        LevelBSPLayout halves[2];
+        concurrency::parallel_invoke(
+            [&] { halves[0].RecursiveGenerate(newAreas[0], params, depth + 1, random.Split(0)); },
+            [&] { halves[1].RecursiveGenerate(newAreas[1], params, depth + 1, random.Split(1)); });
+        for (int i = 0; i < 2; ++i)
+        {
+            m_nodes[self].m_children[i] = (int32_t)m_nodes.size();
+            Append(halves[i]);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            m_nodes[self].m_children[i] = (int32_t)m_nodes.size();
+            RecursiveGenerate(newAreas[i], params, depth + 1, random.Split(i));
+        }
+    }
+}
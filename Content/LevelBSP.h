@@ -0,0 +1,86 @@
+﻿#pragma once
+
+namespace DX { class RandomProvider; }
+
+namespace SpookyAdulthood
+{
+    //* ***************************************************************** *//
+    //* LevelMapBSPTileArea
+    //* ***************************************************************** *//
+    struct LevelMapBSPTileArea
+    {
+        LevelMapBSPTileArea(uint32_t x0=0, uint32_t x1=0, uint32_t y0=0, uint32_t y1=0) 
+            : m_x0(x0), m_x1(x1), m_y0(y0), m_y1(y1) 
+        {}
+        uint32_t SizeX() const { return m_x1 - m_x0 + 1; }
+        uint32_t SizeY() const { return m_y1 - m_y0 + 1; }
+        uint32_t CountTiles() const { return SizeX() * SizeY(); }
+        inline bool operator ==(const LevelMapBSPTileArea& rhs) const {
+            return m_x0 == rhs.m_x0 && m_x1 == rhs.m_x1 && m_y0 == rhs.m_y0 && m_y1 == rhs.m_y1;
+        }
+        template<typename P> // any point with x, y (XMUINT2)
+        inline bool Contains(const P& o) const {
+            return o.x >= m_x0 && o.x <= m_x1 && o.y >= m_y0 && o.y <= m_y1;
+        }        
+
+        uint32_t m_x0, m_x1;
+        uint32_t m_y0, m_y1;
+    };
+
+    //* ***************************************************************** *//
+    //* LevelBSPLayout
+    //* Device free BSP of a level (walls, rooms and their pillars) as flat
+    //* arrays: nodes in depth first order, the root first, children by
+    //* index. LevelMap builds its tree from it. Subtrees of at least
+    //* m_parallelMinTiles tiles are generated in parallel and every subtree
+    //* draws from a stream derived from its path, so the layout is the
+    //* same whatever the number of threads
+    //* ***************************************************************** *//
+    struct LevelBSPParams
+    {
+        uint32_t m_tileCount[2];
+        uint32_t m_minTileCount[2];     // minimum no in tiles for rooms
+        uint32_t m_maxTileCount[2];     // max no in tiles for rooms
+        uint32_t m_minForPillars[2];    // min dim to consider put pillars
+        uint32_t m_minRecursiveDepth;
+        uint32_t m_maxRecursiveDepth;
+        float m_probRoom;               // 0..1 probabilities to be a room if other req met
+        uint32_t m_parallelMinTiles;    // 0=never
+    };
+
+    struct LevelBSPNode
+    {
+        // same values than LevelMapBSPNode::NodeType
+        enum NodeType { NODE_UNKNOWN, NODE_ROOM, NODE_EMPTY, WALL_VERT, WALL_HORIZ };
+        static const uint32_t PROFILE_COUNT = 9; // LevelMap::RP_MAX
+
+        LevelMapBSPTileArea m_area;     // walls: the dividing row/column
+        NodeType m_type;
+        int32_t m_children[2];          // -1 when it's not a wall
+        uint32_t m_profile;             // rooms, a LevelMap::RoomProfile
+        uint32_t m_firstPillar;
+        uint32_t m_pillarCount;
+
+        bool operator ==(const LevelBSPNode& rhs) const;
+    };
+
+    struct LevelBSPPillar
+    {
+        uint32_t x, y;
+        bool operator ==(const LevelBSPPillar& rhs) const { return x == rhs.x && y == rhs.y; }
+    };
+
+    struct LevelBSPLayout
+    {
+        void Generate(const LevelBSPParams& params, const DX::RandomProvider& stream);
+        void Clear() { m_nodes.clear(); m_pillars.clear(); }
+        bool operator ==(const LevelBSPLayout& rhs) const { return m_nodes == rhs.m_nodes && m_pillars == rhs.m_pillars; }
+
+        std::vector<LevelBSPNode> m_nodes;
+        std::vector<LevelBSPPillar> m_pillars;
+
+    private:
+        void RecursiveGenerate(const LevelMapBSPTileArea& area, const LevelBSPParams& params, uint32_t depth, DX::RandomProvider random);
+        void Append(const LevelBSPLayout& subtree); // subtree indices are rebased
+    };
+}
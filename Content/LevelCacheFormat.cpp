@@ -0,0 +1,180 @@
+﻿#include "pch.h"
+#include "LevelCacheFormat.h"
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    template<typename T>
+    void LevelCacheAppend(std::vector<uint8_t>& out, LevelCacheHeader& header, LevelCacheSection section, const std::vector<T>& items)
+    {
+        header.sectionOffset[section] = (uint32_t)out.size();
+        header.sectionCount[section] = (uint32_t)items.size();
+        if (!items.empty())
+        {
+            const uint8_t* src = reinterpret_cast<const uint8_t*>(items.data());
+            out.insert(out.end(), src, src + items.size() * sizeof(T));
+        }
+    }
+
+    // typed view of a section, nullptr when out of the file or misaligned
+    template<typename T>
+    const T* LevelCacheSectionAt(const uint8_t* data, size_t size, const LevelCacheHeader& header, LevelCacheSection section)
+    {
+        const uint64_t offset = header.sectionOffset[section];
+        const uint64_t count = header.sectionCount[section];
+        if (offset > size || offset % alignof(T) != 0 || count > (size - offset) / sizeof(T))
+            return nullptr;
+        return reinterpret_cast<const T*>(data + offset);
+    }
+
+    inline bool InRange(int32_t i, uint32_t count, bool allowNone)
+    {
+        return (allowNone && i == -1) || (i >= 0 && (uint32_t)i < count);
+    }
+
+    bool ValidateNodes(const LevelCacheView& view)
+    {
+        const uint32_t nodeCount = view.Count(LCS_NODES);
+        const uint32_t leafCount = view.Count(LCS_LEAVES);
+        const uint32_t teleportCount = view.Count(LCS_TELEPORTS);
+        for (uint32_t i = 0; i < nodeCount; ++i)
+        {
+            const auto& cn = view.m_nodes[i];
+            if (cn.type < LevelBSPNode::NODE_UNKNOWN || cn.type > LevelBSPNode::WALL_HORIZ ||
+                cn.profile >= LevelBSPNode::PROFILE_COUNT ||
+                !InRange(cn.parent, nodeCount, true) ||
+                !InRange(cn.children[0], nodeCount, true) || !InRange(cn.children[1], nodeCount, true) ||
+                !InRange(cn.leafNdx, leafCount, true) || !InRange(cn.teleportNdx, teleportCount, true) ||
+                (uint64_t)cn.firstPillar + cn.pillarCount > view.Count(LCS_PILLARS) ||
+                (uint64_t)cn.firstSegment + cn.segmentCount > view.Count(LCS_SEGMENTS))
+                return false;
+
+            // both ways: a leaf index names this node and a teleport contains it
+            if (cn.leafNdx != -1 && view.m_leaves[cn.leafNdx] != (int32_t)i)
+                return false;
+            if (cn.teleportNdx != -1)
+            {
+                const auto& ct = view.m_teleports[cn.teleportNdx];
+                if (ct.leaves[0] != (int32_t)i && ct.leaves[1] != (int32_t)i)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // every node is reached exactly once from node 0 and knows its parent, so no cycles
+    // (the loader links parents with shared_ptrs) and nothing unreachable
+    bool ValidateTree(const LevelCacheView& view)
+    {
+        const uint32_t nodeCount = view.Count(LCS_NODES);
+        if (view.m_nodes[0].parent != -1)
+            return false;
+
+        std::vector<bool> visited(nodeCount, false);
+        std::vector<int32_t> stack(1, 0);
+        visited[0] = true;
+        uint32_t reached = 1;
+        while (!stack.empty())
+        {
+            const int32_t parent = stack.back();
+            stack.pop_back();
+            for (int32_t child : view.m_nodes[parent].children)
+            {
+                if (child == -1)
+                    continue;
+                if (visited[child] || view.m_nodes[child].parent != parent)
+                    return false;
+                visited[child] = true;
+                ++reached;
+                stack.push_back(child);
+            }
+        }
+        return reached == nodeCount;
+    }
+
+    bool ValidateLeaves(const LevelCacheView& view)
+    {
+        for (uint32_t i = 0; i < view.Count(LCS_LEAVES); ++i)
+        {
+            const int32_t n = view.m_leaves[i];
+            if (!InRange(n, view.Count(LCS_NODES), false) || view.m_nodes[n].leafNdx != (int32_t)i ||
+                view.m_nodes[n].type != LevelBSPNode::NODE_ROOM)
+                return false;
+        }
+        return true;
+    }
+
+    // portals and teleports connect rooms (GetAdjacentRooms reads their leaf index)
+    bool IsRoom(const LevelCacheView& view, int32_t n)
+    {
+        return InRange(n, view.Count(LCS_NODES), false) && view.m_nodes[n].leafNdx != -1;
+    }
+
+    bool ValidateLinks(const LevelCacheView& view)
+    {
+        for (uint32_t i = 0; i < view.Count(LCS_PORTALS); ++i)
+        {
+            const auto& cp = view.m_portals[i];
+            if (!IsRoom(view, cp.leaves[0]) || !IsRoom(view, cp.leaves[1]) || !InRange(cp.wallNode, view.Count(LCS_NODES), false))
+                return false;
+        }
+        for (uint32_t i = 0; i < view.Count(LCS_TELEPORTS); ++i)
+        {
+            const auto& ct = view.m_teleports[i];
+            if (!IsRoom(view, ct.leaves[0]) || !IsRoom(view, ct.leaves[1]))
+                return false;
+        }
+        return true;
+    }
+}
+
+std::vector<uint8_t> SpookyAdulthood::LevelCacheWrite(const LevelCacheData& data, uint32_t levelSeed, uint32_t settingsFingerprint, LevelCacheUInt2 tileCount)
+{
+    LevelCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LEVELCACHE_MAGIC;
+    header.version = LEVELCACHE_VERSION;
+    header.levelSeed = levelSeed;
+    header.settingsFingerprint = settingsFingerprint;
+    header.tileCount = tileCount;
+
+    std::vector<uint8_t> out(sizeof(header));
+    LevelCacheAppend(out, header, LCS_NODES, data.m_nodes);
+    LevelCacheAppend(out, header, LCS_LEAVES, data.m_leaves);
+    LevelCacheAppend(out, header, LCS_PORTALS, data.m_portals);
+    LevelCacheAppend(out, header, LCS_TELEPORTS, data.m_teleports);
+    LevelCacheAppend(out, header, LCS_PILLARS, data.m_pillars);
+    LevelCacheAppend(out, header, LCS_SEGMENTS, data.m_segments);
+    memcpy(out.data(), &header, sizeof(header));
+    return out;
+}
+
+bool SpookyAdulthood::LevelCacheRead(const uint8_t* data, size_t size, uint32_t settingsFingerprint, LevelCacheView* outView)
+{
+    if (!data || size < sizeof(LevelCacheHeader) || reinterpret_cast<uintptr_t>(data) % alignof(LevelCacheHeader) != 0)
+        return false;
+
+    LevelCacheView view;
+    view.m_header = reinterpret_cast<const LevelCacheHeader*>(data);
+    const auto& header = *view.m_header;
+    if (header.magic != LEVELCACHE_MAGIC || header.version != LEVELCACHE_VERSION ||
+        header.settingsFingerprint != settingsFingerprint)
+        return false;
+
+    view.m_nodes = LevelCacheSectionAt<LevelCacheNode>(data, size, header, LCS_NODES);
+    view.m_leaves = LevelCacheSectionAt<int32_t>(data, size, header, LCS_LEAVES);
+    view.m_portals = LevelCacheSectionAt<LevelCachePortal>(data, size, header, LCS_PORTALS);
+    view.m_teleports = LevelCacheSectionAt<LevelCacheTeleport>(data, size, header, LCS_TELEPORTS);
+    view.m_pillars = LevelCacheSectionAt<LevelCacheUInt2>(data, size, header, LCS_PILLARS);
+    view.m_segments = LevelCacheSectionAt<LevelCacheSegment>(data, size, header, LCS_SEGMENTS);
+    if (!view.m_nodes || !view.m_leaves || !view.m_portals || !view.m_teleports || !view.m_pillars || !view.m_segments ||
+        !view.Count(LCS_NODES))
+        return false;
+
+    if (!ValidateNodes(view) || !ValidateLeaves(view) || !ValidateLinks(view) || !ValidateTree(view))
+        return false;
+
+    *outView = view;
+    return true;
+}
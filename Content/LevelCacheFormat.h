@@ -0,0 +1,112 @@
+﻿#pragma once
+#include "LevelBSP.h"
+
+namespace SpookyAdulthood
+{
+    //* ***************************************************************** *//
+    //* LevelCache format
+    //* Binary level: header + flat arrays of PODs, node references are indices.
+    //* Loaded with a read only mapping, every section is used in place, so
+    //* LevelCacheRead checks every index once and after that they are trusted.
+    //* ***************************************************************** *//
+    static const uint32_t LEVELCACHE_MAGIC = 0x4c4b5053; // 'SPKL'
+    static const uint32_t LEVELCACHE_VERSION = 1;
+
+    enum LevelCacheSection
+    {
+        LCS_NODES = 0,
+        LCS_LEAVES,     // node index of every leaf, in leaf index order
+        LCS_PORTALS,
+        LCS_TELEPORTS,
+        LCS_PILLARS,    // all rooms, each node has its range
+        LCS_SEGMENTS,   // all rooms, each node has its range
+        LCS_MAX
+    };
+
+    struct LevelCacheUInt2 // XMUINT2 layout
+    {
+        uint32_t x, y;
+    };
+
+    struct LevelCacheSegment // CollSegment layout
+    {
+        float start[2], end[2];
+        float normal[2];
+        int32_t flags;
+    };
+
+    struct LevelCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t levelSeed;
+        uint32_t settingsFingerprint;
+        LevelCacheUInt2 tileCount;
+        uint32_t sectionOffset[LCS_MAX]; // from the start of the file
+        uint32_t sectionCount[LCS_MAX];  // in elements
+    };
+
+    struct LevelCacheNode
+    {
+        enum { HAS_PILLARS = 1 << 0, HAS_SEGMENTS = 1 << 1, FINISHED = 1 << 2 };
+        LevelMapBSPTileArea area;
+        int32_t type;       // LevelBSPNode::NodeType
+        int32_t parent;
+        int32_t children[2];
+        int32_t leafNdx;
+        int32_t teleportNdx;
+        uint32_t tag;
+        uint32_t profile;   // LevelMap::RoomProfile
+        uint32_t flags;
+        uint32_t firstPillar, pillarCount;
+        uint32_t firstSegment, segmentCount;
+    };
+
+    struct LevelCachePortal
+    {
+        int32_t leaves[2];
+        int32_t wallNode;
+        int32_t index;
+        int32_t open;
+    };
+
+    struct LevelCacheTeleport
+    {
+        int32_t leaves[2];
+        LevelCacheUInt2 positions[2];
+        int32_t open;
+    };
+
+    // the sections of a level, nodes in pre-order from the root
+    struct LevelCacheData
+    {
+        std::vector<LevelCacheNode> m_nodes;
+        std::vector<int32_t> m_leaves;
+        std::vector<LevelCachePortal> m_portals;
+        std::vector<LevelCacheTeleport> m_teleports;
+        std::vector<LevelCacheUInt2> m_pillars;
+        std::vector<LevelCacheSegment> m_segments;
+    };
+
+    // pointers into the file, only valid while it is mapped
+    struct LevelCacheView
+    {
+        const LevelCacheHeader* m_header;
+        const LevelCacheNode* m_nodes;
+        const int32_t* m_leaves;
+        const LevelCachePortal* m_portals;
+        const LevelCacheTeleport* m_teleports;
+        const LevelCacheUInt2* m_pillars;
+        const LevelCacheSegment* m_segments;
+
+        uint32_t Count(LevelCacheSection section) const { return m_header->sectionCount[section]; }
+    };
+
+    std::vector<uint8_t> LevelCacheWrite(const LevelCacheData& data, uint32_t levelSeed, uint32_t settingsFingerprint, LevelCacheUInt2 tileCount);
+
+    // false when the file is not a level for these settings or anything in it is out of range:
+    // sections outside the file or misaligned, unknown node types or profiles, indices past
+    // their section, leaves that don't point back to their node, teleports that don't contain
+    // the leaves using them, or a node graph that is not a tree rooted at node 0.
+    bool LevelCacheRead(const uint8_t* data, size_t size, uint32_t settingsFingerprint, LevelCacheView* outView);
+}
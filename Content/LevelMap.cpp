@@ -2,6 +2,8 @@
 #include "LevelMap.h"
 #include "../Common/DirectXHelper.h"
 #include "../Common/DeviceResources.h"
+#include "../Common/MappedFile.h"
+#include "LevelCacheFormat.h"
 #include "ShaderStructures.h"
 #include "CameraFirstPerson.h"
 #include "GlobalFlags.h"
@@ -67,6 +69,7 @@ LevelMapGenerationSettings::LevelMapGenerationSettings()
     , m_probRoom(0.05f), m_generateThumbTex(true)
     , m_maxTileCount(8,8), m_minForPillars(3,3)
     , m_pillarsProbRange(0.01f, 0.2f) // between 1%-20% of pillars for a room
+    , m_parallelMinTiles(64*64), m_useCache(true)
 {
 }
 
@@ -79,6 +82,20 @@ void LevelMapGenerationSettings::Validate() const
     DX::ThrowIfFalse(m_minTileCount.x >= 2 && m_minTileCount.y >= 2);
     // left stuff to check for :(
 }
+
+LevelBSPParams LevelMapGenerationSettings::GetBSPParams() const
+{
+    LevelBSPParams params;
+    params.m_tileCount[0] = m_tileCount.x; params.m_tileCount[1] = m_tileCount.y;
+    params.m_minTileCount[0] = m_minTileCount.x; params.m_minTileCount[1] = m_minTileCount.y;
+    params.m_maxTileCount[0] = m_maxTileCount.x; params.m_maxTileCount[1] = m_maxTileCount.y;
+    params.m_minForPillars[0] = m_minForPillars.x; params.m_minForPillars[1] = m_minForPillars.y;
+    params.m_minRecursiveDepth = m_minRecursiveDepth;
+    params.m_maxRecursiveDepth = m_maxRecursiveDepth;
+    params.m_probRoom = m_probRoom;
+    params.m_parallelMinTiles = m_parallelMinTiles;
+    return params;
+}
 //////////////////////////////////////////////////////////////////////////
 #pragma endregion
 
@@ -139,191 +156,144 @@ LevelMapBSPNodePtr LevelMapBSPPortal::GetOtherLeaf(LevelMapBSPNodePtr l) const
 LevelMap::LevelMap(const std::shared_ptr<DX::DeviceResources>& device)
     : m_root(nullptr)
     , m_device(device)
+    , m_levelSeed(0)
+    , m_random(nullptr)
 {
     XMStoreFloat4x4(&m_levelTransform, XMMatrixIdentity());
 }
 
 void LevelMap::Generate(const LevelMapGenerationSettings& settings)
 {
-    settings.Validate();
-
-    Destroy();
-
-    m_root = std::make_shared<LevelMapBSPNode>();
-    LevelMapBSPTileArea area(0, settings.m_tileCount.x - 1, 0, settings.m_tileCount.y - 1);
     auto gameRes = m_device->GetGameResources();
+    // the settings seed picks the level seed, everything else is derived from it
     gameRes->m_random.SetSeed(settings.m_randomSeed);
-    LevelMapBSPNodePtr lastRoom;
-    RecursiveGenerate(m_root, area, settings, 0);        
-    GenerateVisibility(settings);
-    GenerateCollisionInfo();
-    if (settings.m_generateThumbTex)
-        GenerateThumbTex(settings.m_tileCount);
+    const uint32_t levelSeed = gameRes->m_random.Next();
+    gameRes->SeedRandomStreams(levelSeed);
+    Generate(settings, levelSeed);
     CreateDeviceDependentResources();
     if (m_device && gameRes)
         gameRes->m_levelTime = .0f;
 }
 
-void LevelMap::RecursiveGenerate(LevelMapBSPNodePtr& node, LevelMapBSPTileArea& area, const LevelMapGenerationSettings& settings, uint32_t depth)
+void LevelMap::Generate(const LevelMapGenerationSettings& settings, uint32_t levelSeed)
 {
-    node->m_area = area;
-    // It's an EMPTY? any dimension is not large enough to be a room
-    if (area.SizeX() < settings.m_minTileCount.x ||
-        area.SizeY() < settings.m_minTileCount.y)
-    {
-        node->m_type = LevelMapBSPNode::NODE_EMPTY;
-        // leaf, no children
+    DX::MemoryTagScope memTag(DX::MEMTAG_LEVELMAP);
+    settings.Validate();
+
+    Destroy();
+
+    // shipped level for this seed?
+    if (settings.m_useCache && LoadCache(GetCachePath(levelSeed), settings))
         return;
-    }
 
-    auto& random = m_device->GetGameResources()->m_random;
-    // Can be a ROOM?
-    if ( CanBeRoom(node, area, settings, depth) )
-    {
-        node->m_type = LevelMapBSPNode::NODE_ROOM;
-        node->m_leafNdx = (int)m_leaves.size();
-        m_leaves.push_back(node);
-        GenerateDetailsForRoom(node, settings);
-        // leaf, no children
-    }
-    else
-    {
-        // WALL node (split)
-        node->m_type = (LevelMapBSPNode::NodeType)(LevelMapBSPNode::WALL_VERT + (depth % 2)); // each depth alternate wall dir
-        uint32_t at = 0;
-        if (node->m_type == LevelMapBSPNode::WALL_VERT) // random division plane
-        {
-            at = area.m_x0 + random.Get(0, area.SizeX() - 1);
-            node->m_area.m_x0 = node->m_area.m_x1 = at;
-        }
-        else
-        {
-            at = area.m_y0 + random.Get(0, area.SizeY() - 1);
-            node->m_area.m_y0 = node->m_area.m_y1 = at;
-        }
-        //if (at == 0) at = 1;
-        // get the two sub-areas and subdivide them recursively
-        LevelMapBSPTileArea newAreas[2];
-        SplitNode(area, at, node->m_type, newAreas);
-        for (int i = 0; i < 2; ++i)
-        {
-            node->m_children[i] = std::make_shared<LevelMapBSPNode>();
-            node->m_children[i]->m_parent = node;
-            RecursiveGenerate(node->m_children[i], newAreas[i], settings, depth + 1);            
-        }
-    }
+    // the same stream GameResources::SeedRandomStreams gives to RANDOM_LEVEL, but owned here
+    m_levelSeed = levelSeed;
+    DX::RandomProvider random = DX::RandomProvider(levelSeed).Split(RANDOM_LEVEL);
+    m_random = &random;
+    GenerateBSP(settings, random);
+    GenerateVisibility(settings);
+    GenerateCollisionInfo();
+    if (settings.m_generateThumbTex)
+        GenerateThumbTex(settings.m_tileCount);
+    m_random = nullptr;
 }
 
-static const uint32_t RPDENSITY[LevelMap::RP_MAX] = {
-    10, 30, 40, 50, 60, 70, 80, 90, 100
-};
-
-void LevelMap::GenerateDetailsForRoom(LevelMapBSPNodePtr& node, const LevelMapGenerationSettings& settings)
+void LevelMap::Swap(LevelMap& other)
 {
-    auto& random = m_device->GetGameResources()->m_random;    
-    node->m_profile = random.GetWithDensity(RPDENSITY, RP_MAX);
+    std::swap(m_root, other.m_root);
+    std::swap(m_leaves, other.m_leaves);
+    std::swap(m_teleports, other.m_teleports);
+    std::swap(m_portals, other.m_portals);
+    std::swap(m_leafPortals, other.m_leafPortals);
+    std::swap(m_levelTransform, other.m_levelTransform);
+    std::swap(m_cameraCurLeaf, other.m_cameraCurLeaf);
+    std::swap(m_levelSeed, other.m_levelSeed);
+    std::swap(m_device, other.m_device);
+    m_atlasTexture.Swap(other.m_atlasTexture);
+    m_atlasTextureSRV.Swap(other.m_atlasTextureSRV);
+    // thumb texture owns raw memory, field by field
+    std::swap(m_thumbTex.m_sysMem, other.m_thumbTex.m_sysMem);
+    std::swap(m_thumbTex.m_dim, other.m_thumbTex.m_dim);
+    m_thumbTex.m_texture.Swap(other.m_thumbTex.m_texture);
+    m_thumbTex.m_textureView.Swap(other.m_thumbTex.m_textureView);
+}
 
-    switch (node->m_profile)
-    {
-        case RP_NORMAL0:
-            GeneratePillarsForRoom(node, settings.m_minForPillars, XMFLOAT2(0.01f, 0.3f));
-            break;
-        case RP_NORMAL1:
-            GeneratePillarsForRoom(node, settings.m_minForPillars, XMFLOAT2(0.2f, 0.5f));
-            break;
-        case RP_GRAVE: break;
-        case RP_WOODS: break;
-        case RP_BODYPILES: 
-            GeneratePillarsForRoom(node, settings.m_minForPillars, XMFLOAT2(0.01f, 0.15f));
-            break;
-        case RP_GARGOYLES: 
-            GeneratePillarsForRoom(node, settings.m_minForPillars, XMFLOAT2(0.01f, 0.1f));
-            break;
-        case RP_HANDS: 
-            GeneratePillarsForRoom(node, settings.m_minForPillars, XMFLOAT2(0.01f, 0.2f));
-            break;
-        case RP_SCARYMESSAGES: 
-            GeneratePillarsForRoom(node, settings.m_minForPillars, XMFLOAT2(0.01f, 0.05f));
-            break;
-        case RP_PUMPKINFIELD: break;
-    }
+DX::RandomProvider LevelMap::RandomForRoom(int roomIndex) const
+{
+    return DX::RandomProvider(m_levelSeed).Split(RANDOM_LEVEL).Split((uint32_t)roomIndex);
 }
 
-void LevelMap::GeneratePillarsForRoom(LevelMapBSPNodePtr& node, const XMUINT2& minForPillars, const XMFLOAT2& probRange)
+static_assert((int)LevelBSPNode::NODE_ROOM == (int)LevelMapBSPNode::NODE_ROOM && (int)LevelBSPNode::NODE_EMPTY == (int)LevelMapBSPNode::NODE_EMPTY &&
+    (int)LevelBSPNode::WALL_VERT == (int)LevelMapBSPNode::WALL_VERT && (int)LevelBSPNode::WALL_HORIZ == (int)LevelMapBSPNode::WALL_HORIZ, "LevelBSP node types");
+static_assert(LevelBSPNode::PROFILE_COUNT == (uint32_t)LevelMap::RP_MAX, "LevelBSP room profiles");
+
+void LevelMap::GenerateBSP(const LevelMapGenerationSettings& settings, const DX::RandomProvider& levelStream)
 {
-    // pillars
-    auto& random = m_device->GetGameResources()->m_random;
-    const auto& area = node->m_area;
-    if (area.SizeX() > 2 && area.SizeY() > 2)
+    static const uint32_t BSP_STREAM = 0xb5b0;
+
+    m_leaves.clear();
+    LevelBSPLayout layout;
+    layout.Generate(settings.GetBSPParams(), levelStream.Split(BSP_STREAM));
+
+    // the layout is in depth first order, the tree is linked the same way
+    std::vector<LevelMapBSPNodePtr> nodes(layout.m_nodes.size());
+    for (auto& n : nodes)
+        n = std::make_shared<LevelMapBSPNode>();
+    for (size_t i = 0; i < nodes.size(); ++i)
     {
-        // we don't want pillars next to a door (can block a door)
-        uint32_t sx = area.SizeX() - 2;
-        uint32_t sy = area.SizeY() - 2;
-        if (sx >= minForPillars.x && sy >= minForPillars.y)
+        const auto& ln = layout.m_nodes[i];
+        auto& n = nodes[i];
+        n->m_area = ln.m_area;
+        n->m_type = (LevelMapBSPNode::NodeType)ln.m_type;
+        n->m_profile = ln.m_profile;
+        for (int c = 0; c < 2; ++c)
         {
-            // compute no of pillars to generate and allocate vector
-            int areaSize = sx*sy;
-            float p = random.GetF(probRange.x, probRange.y);
-            int nPillars = (int)(areaSize*p);
-            if (nPillars && !node->m_pillars)
-            {
-                node->m_pillars = std::make_unique<std::vector<XMUINT2>>();
-                node->m_pillars->reserve(nPillars);
-            }
-
-            // generate a pillar randomly and check if it exists already before adding
-            for (int i = 0; i < nPillars; ++i)
+            if (ln.m_children[c] == -1) continue;
+            n->m_children[c] = nodes[ln.m_children[c]];
+            n->m_children[c]->m_parent = n;
+        }
+        if (ln.m_pillarCount)
+        {
+            n->m_pillars = std::make_unique<std::vector<XMUINT2>>();
+            n->m_pillars->reserve(ln.m_pillarCount);
+            for (uint32_t p = 0; p < ln.m_pillarCount; ++p)
             {
-                XMUINT2 newPillar;
-                newPillar.x = random.Get(area.m_x0 + 1, area.m_x1 - 1);
-                newPillar.y = random.Get(area.m_y0 + 1, area.m_y1 - 1);
-                auto it = std::find_if(node->m_pillars->begin(), node->m_pillars->end(), [&](const auto& rhs)->bool {return rhs.x == newPillar.x && rhs.y == newPillar.y; });
-                if (it == node->m_pillars->end())
-                    node->m_pillars->push_back(newPillar);
+                const auto& lp = layout.m_pillars[ln.m_firstPillar + p];
+                n->m_pillars->push_back(XMUINT2(lp.x, lp.y));
             }
         }
     }
+    m_root = nodes[0];
+    // leaf indices are assigned after, in the same depth first order of the serial version
+    RecursiveGatherLeaves(m_root);
 }
 
-void LevelMap::SplitNode(const LevelMapBSPTileArea& area, uint32_t at, LevelMapBSPNode::NodeType wallDir, LevelMapBSPTileArea* outAreas)
+void LevelMap::RecursiveGatherLeaves(const LevelMapBSPNodePtr& node)
 {
-    DX::ThrowIfFalse(wallDir == LevelMapBSPNode::WALL_VERT || wallDir == LevelMapBSPNode::WALL_HORIZ);
-    outAreas[0] = outAreas[1] = area;
-    switch (wallDir)
+    if (!node) return;
+    if (node->IsLeaf())
     {
-    case LevelMapBSPNode::WALL_VERT:
-        DX::ThrowIfFalse(at <= area.m_x1);
-        outAreas[0].m_x0 = area.m_x0; outAreas[0].m_x1 = at - 1;
-        outAreas[1].m_x0 = at; outAreas[1].m_x1 = area.m_x1;
-        break;
-
-    case LevelMapBSPNode::WALL_HORIZ:
-        DX::ThrowIfFalse(at <= area.m_y1);
-        outAreas[0].m_y0 = area.m_y0; outAreas[0].m_y1 = at - 1;
-        outAreas[1].m_y0 = at; outAreas[1].m_y1 = area.m_y1;
-        break;
+        node->m_leafNdx = (int)m_leaves.size();
+        m_leaves.push_back(node);
+        return;
     }
+    RecursiveGatherLeaves(node->m_children[0]);
+    RecursiveGatherLeaves(node->m_children[1]);
 }
 
-bool LevelMap::CanBeRoom(const LevelMapBSPNodePtr& node, const LevelMapBSPTileArea& area, const LevelMapGenerationSettings& settings, uint32_t depth)
+// children keep a shared_ptr to the parent, break the cycles so the tree can be freed
+void LevelMap::RecursiveUnlinkParents(const LevelMapBSPNodePtr& node)
 {
-    // not there yet
-    if (depth < settings.m_minRecursiveDepth || area.SizeX() >= settings.m_maxTileCount.x || area.SizeY() >= settings.m_maxTileCount.y) 
-        return false;
-
-    // minimum enough to be a room
-    if (depth >= settings.m_maxRecursiveDepth || area.SizeX() == settings.m_minTileCount.x || area.SizeY() == settings.m_minTileCount.y)
-        return true;
-
-    
-    auto& random = m_device->GetGameResources()->m_random;
-    float dice = random.Get(1, 100)*0.01f;
-    return dice < settings.m_probRoom;
+    if (!node) return;
+    node->m_parent = nullptr;
+    RecursiveUnlinkParents(node->m_children[0]);
+    RecursiveUnlinkParents(node->m_children[1]);
 }
 
 void LevelMap::Destroy()
 {
     ReleaseDeviceDependentResources();
+    RecursiveUnlinkParents(m_root);
     m_root = nullptr;
     m_cameraCurLeaf = nullptr;
     m_leaves.clear();
@@ -335,6 +305,7 @@ void LevelMap::Destroy()
 
 void LevelMap::GenerateThumbTex(XMUINT2 tcount, const XMUINT2* playerPos)
 {
+    DX::MemoryTagScope memTag(DX::MEMTAG_LEVELMAP);
     if (!m_root) return;
     
     m_thumbTex.Destroy();
@@ -518,7 +489,7 @@ int LevelMap::VisComputeRandomPortalIndex(const LevelMapBSPTileArea& areaA, cons
     }
 
     // random cell along the wallDir
-    return m_device->GetGameResources()->m_random.Get(a, b);
+    return m_random->Get(a, b);
 }
 
 void LevelMap::VisGenerateTeleport(const LevelMapBSPNodePtr& roomA, const LevelMapBSPNodePtr& roomB)
@@ -557,7 +528,7 @@ bool LevelMap::HasNode(const LevelMapBSPNodePtr& node, const LevelMapBSPNodePtr&
 
 XMUINT2 LevelMap::GetRandomInArea(const LevelMapBSPNodePtr& node, bool checkNotInPortal/*=true*/)
 {
-    auto& random = m_device->GetGameResources()->m_random;
+    auto& random = *m_random;
     const auto& area = node->m_area;
 
     XMUINT2 rndPos;
@@ -639,7 +610,7 @@ void LevelMap::GenerateTeleports(const VisMatrix& visMatrix)
         return;
 
     // generate teleports between sets 2-by-2    
-    auto& random = m_device->GetGameResources()->m_random;
+    auto& random = *m_random;
     for (size_t i = 1; i < allRoomSets.size(); ++i)
     {
         const RoomSet& a = allRoomSets[i - 1];
@@ -670,24 +641,28 @@ void LevelMap::GenerateTeleports(const VisMatrix& visMatrix)
     }
 }
 
-void LevelMap::CreateDeviceDependentResources()
+concurrency::task<void> LevelMap::CreateDeviceDependentResources()
 {
-    if (!m_root) return;
+    if (!m_root) return concurrency::task_from_result();
+    std::vector<concurrency::task<void>> tasks;
     // buffers for each room
+    tasks.reserve(m_leaves.size() + 1);
     for (auto& leaf : m_leaves)
     {
-        concurrency::create_task([this, leaf]() {
+        tasks.push_back(concurrency::create_task([this, leaf]() {
+            DX::MemoryTagScope memTag(DX::MEMTAG_LEVELMAP);
             leaf->CreateDeviceDependentResources(*this, m_device); 
-        });
+        }));
     }
-    auto& loadTexTask = concurrency::create_task([this]() {
+    tasks.push_back(concurrency::create_task([this]() {
         DX::ThrowIfFailed(
             DirectX::CreateWICTextureFromFile(
                 m_device->GetD3DDevice(), L"assets\\textures\\atlaslevel.png",
                 (ID3D11Resource**)m_atlasTexture.ReleaseAndGetAddressOf(),
                 m_atlasTextureSRV.ReleaseAndGetAddressOf()));
-    });
-
+    }));
+    // callers that need the meshes ready (background level) can wait on it
+    return concurrency::when_all(tasks.begin(), tasks.end());
 }
 
 void LevelMap::ReleaseDeviceDependentResources()
@@ -715,6 +690,7 @@ void LevelMap::Update(const DX::StepTimer& timer, const CameraFirstPerson& camer
 
 void LevelMap::Render(const CameraFirstPerson& camera)
 {
+    DX_PROFILE_SCOPE("LevelMap::Render");
     if (!m_root)
         return;
 
@@ -891,6 +867,22 @@ LevelMapBSPNodePtr LevelMap::GetLeafAt(const XMFLOAT3& pos) const
     return nullptr;
 }
 
+int LevelMapAudioRooms::RoomAt(const XMFLOAT3& pos) const
+{
+    if (pos.x < 0.0f || pos.z < 0.0f) return -1;
+    const auto room = m_map.GetLeafAt(pos);
+    return room ? room->m_leafNdx : -1;
+}
+
+bool LevelMapAudioRooms::GetPortalRooms(uint32_t portal, int& roomA, int& roomB) const
+{
+    const auto& p = m_map.GetPortals()[portal];
+    if (!p.m_leaves[0] || !p.m_leaves[1]) return false;
+    roomA = p.m_leaves[0]->m_leafNdx;
+    roomB = p.m_leaves[1]->m_leafNdx;
+    return true;
+}
+
 XMUINT2 LevelMap::GetRandomPosition()
 {
     if (!m_root || m_leaves.empty())
@@ -966,6 +958,7 @@ bool LevelMap::RaycastDir(const XMFLOAT3& origin, const XMFLOAT3& dir, XMFLOAT3&
 
 bool LevelMap::RaycastSeg(const XMFLOAT3& origin, const XMFLOAT3& end, XMFLOAT3& outHit, float optRad, float offsHit)
 {
+    DX_PROFILE_SCOPE("LevelMap::RaycastSeg");
     XMFLOAT3 dir2D = XM3Sub(end, origin);
     dir2D.y = 0.0f;
     const float distSq = XM3LenSq(dir2D);
@@ -1010,6 +1003,24 @@ bool LevelMap::RaycastSeg(const XMFLOAT3& origin, const XMFLOAT3& end, XMFLOAT3&
     return wasHit;
 }
 
+void LevelMap::GetAdjacentRooms(int roomIndex, std::vector<int>& outRooms) const
+{
+    outRooms.clear();
+    if (roomIndex < 0 || roomIndex >= (int)m_leaves.size())
+        return;
+
+    const auto& leaf = m_leaves[roomIndex];
+    auto range = m_leafPortals.equal_range(leaf.get());
+    for (auto it = range.first; it != range.second; ++it)
+        outRooms.push_back(m_portals[it->second].GetOtherLeaf(leaf)->m_leafNdx);
+
+    if (leaf->m_teleportNdx != -1)
+    {
+        const auto& tp = m_teleports[leaf->m_teleportNdx];
+        outRooms.push_back((tp.m_leaves[0] == leaf ? tp.m_leaves[1] : tp.m_leaves[0])->m_leafNdx);
+    }
+}
+
 LevelMapBSPNodePtr LevelMap::GetBiggestRoom() const
 {
     LevelMapBSPNodePtr maxRoom;
@@ -1035,7 +1046,7 @@ void LevelMap::ToggleRoomDoors(int roomIndex, bool open)
     m_cameraCurLeaf->m_tag = 0xffffff77;
 
     // disable collision segments for this leaf
-    std::vector<CollSegment> portalSegments; 
+    DX::FrameVector<CollSegment> portalSegments; // scratch, on the frame arena
     portalSegments.reserve(4);
     auto leaf = roomIndex < 0 ? m_cameraCurLeaf : m_leaves[roomIndex];
     if (!leaf) 
@@ -1121,17 +1132,13 @@ LevelMapBSPNode::PortalDir LevelMapBSPNode::GetPortalDirAt(const LevelMap& lmap,
     return NONE;
 }
 
-void LevelMapBSPNode::CreateDeviceDependentResources(const LevelMap& lmap, const std::shared_ptr<DX::DeviceResources>& device)
+void LevelMapBSPNode::BuildMesh(const LevelMap& lmap, std::vector<VertexPositionNormalColorTextureNdx>& vertices, std::vector<unsigned short>& indices)
 {
-    if (m_dx || !IsLeaf())
-        return;
-    m_dx = std::make_shared<NodeDXResources>();
-
     const auto& area = m_area;
     const int pvc = m_pillars ? (int)m_pillars->size() : 0;
-    std::vector<VertexPositionNormalColorTextureNdx> vertices;
+    vertices.clear();
     vertices.reserve(area.CountTiles() * 4 + pvc*16);
-    std::vector<unsigned short> indices; 
+    indices.clear();
     indices.reserve(area.CountTiles() * 6 + pvc*24);
     {
         static const float EP = 1.0f;
@@ -1145,7 +1152,8 @@ void LevelMapBSPNode::CreateDeviceDependentResources(const LevelMap& lmap, const
         {
             quadVerts[i].color = argb;
         }
-        auto& random = device->GetGameResources()->m_random;
+        // own stream per room, meshes are created in parallel tasks
+        auto random = lmap.RandomForRoom(m_leafNdx);
         UINT FLOORTEX = random.Get(5,8);
         UINT CEILINGTEX = random.Get(0, 4);
         UINT WALLTEX = random.Get(3, 7);
@@ -1350,6 +1358,17 @@ void LevelMapBSPNode::CreateDeviceDependentResources(const LevelMap& lmap, const
             }
         }
     }
+}
+
+void LevelMapBSPNode::CreateDeviceDependentResources(const LevelMap& lmap, const std::shared_ptr<DX::DeviceResources>& device)
+{
+    if (m_dx || !IsLeaf())
+        return;
+    m_dx = std::make_shared<NodeDXResources>();
+
+    std::vector<VertexPositionNormalColorTextureNdx> vertices;
+    std::vector<unsigned short> indices;
+    BuildMesh(lmap, vertices, indices);
     m_dx->m_indexCount = indices.size();
     DX::ThrowIfFalse(!vertices.empty() && !indices.empty());
 
@@ -1502,9 +1521,9 @@ bool LevelMapBSPNode::IsPillar(const XMUINT2& ppos)const
     }) != m_pillars->end();
 }
 
-XMFLOAT3 LevelMapBSPNode::GetRandomXZ(const XMFLOAT2& shrink) const
+XMFLOAT3 LevelMapBSPNode::GetRandomXZ(const XMFLOAT2& shrink, DX::RandomProvider* rnd) const
 {
-    auto& r = DX::GameResources::instance->m_random;
+    auto& r = rnd ? *rnd : DX::GameResources::instance->Random(RANDOM_AI);
     float a, b;
     XMFLOAT3 xz;
     a = (float)m_area.m_x0 + shrink.x;
@@ -1517,7 +1536,7 @@ XMFLOAT3 LevelMapBSPNode::GetRandomXZ(const XMFLOAT2& shrink) const
     return xz;
 }
 
-XMFLOAT3 LevelMapBSPNode::GetRandomXZWithClearance() const
+XMFLOAT3 LevelMapBSPNode::GetRandomXZWithClearance(DX::RandomProvider* rnd) const
 {
     // get free tiles
     std::vector<XMUINT2> freeTiles; freeTiles.reserve(m_area.CountTiles());
@@ -1534,14 +1553,15 @@ XMFLOAT3 LevelMapBSPNode::GetRandomXZWithClearance() const
     if (freeTiles.empty())
         throw std::exception("No free tiles in this room");
 
-    t = freeTiles[DX::GameResources::instance->m_random.Get(0, (int)freeTiles.size() - 1)];
+    auto& r = rnd ? *rnd : DX::GameResources::instance->Random(RANDOM_AI);
+    t = freeTiles[r.Get(0, (int)freeTiles.size() - 1)];
     return XMFLOAT3(t.x + 0.5f, 0.0f, t.y + 0.5f);
 }
 
 
-XMUINT2 LevelMapBSPNode::GetRandomTile() const
+XMUINT2 LevelMapBSPNode::GetRandomTile(DX::RandomProvider* rnd) const
 {
-    auto& r = DX::GameResources::instance->m_random;
+    auto& r = rnd ? *rnd : DX::GameResources::instance->Random(RANDOM_AI);
     XMUINT2 t;
     t.x = r.Get(m_area.m_x0, m_area.m_x1);
     t.y = r.Get(m_area.m_y0, m_area.m_y1);
@@ -1599,3 +1619,191 @@ void LevelMapThumbTexture::SetAt(uint32_t x, uint32_t y, uint32_t value)
 }
 #pragma endregion
 
+//////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////
+#pragma region LevelMap Cache
+// Format and validation live in LevelCacheFormat, this converts to and from the node graph
+namespace
+{
+    static_assert(sizeof(LevelCacheUInt2) == sizeof(XMUINT2), "pillars and positions are stored as XMUINT2");
+    static_assert(sizeof(LevelCacheSegment) == sizeof(CollSegment), "segments are stored as CollSegment");
+
+    static void LevelCacheGatherNodes(const LevelMapBSPNodePtr& node, std::vector<LevelMapBSPNode*>& nodes, std::map<const LevelMapBSPNode*, int32_t>& indices)
+    {
+        if (!node) return;
+        indices[node.get()] = (int32_t)nodes.size();
+        nodes.push_back(node.get());
+        LevelCacheGatherNodes(node->m_children[0], nodes, indices);
+        LevelCacheGatherNodes(node->m_children[1], nodes, indices);
+    }
+
+    inline LevelCacheUInt2 ToCache(const XMUINT2& v) { LevelCacheUInt2 r = { v.x, v.y }; return r; }
+    inline XMUINT2 FromCache(const LevelCacheUInt2& v) { return XMUINT2(v.x, v.y); }
+}
+
+uint32_t LevelMapGenerationSettings::Fingerprint() const
+{
+    // everything that changes the generated level for a given seed; the float by its bits
+    uint32_t probRoomBits;
+    static_assert(sizeof(probRoomBits) == sizeof(m_probRoom), "m_probRoom is a 32 bit float");
+    memcpy(&probRoomBits, &m_probRoom, sizeof(probRoomBits));
+    const uint32_t values[] = {
+        m_tileCount.x, m_tileCount.y, m_minTileCount.x, m_minTileCount.y,
+        m_maxTileCount.x, m_maxTileCount.y, m_minForPillars.x, m_minForPillars.y,
+        m_minRecursiveDepth, m_maxRecursiveDepth,
+        probRoomBits, LEVELCACHE_VERSION
+    };
+    uint32_t h = 0;
+    for (uint32_t v : values)
+        h = DX::RandomProvider::Hash(h, v);
+    return h;
+}
+
+std::wstring LevelMap::GetCachePath(uint32_t levelSeed)
+{
+    wchar_t name[32];
+    swprintf_s(name, L"\\assets\\levels\\%08x.lvc", levelSeed);
+    return std::wstring(Windows::ApplicationModel::Package::Current->InstalledLocation->Path->Data()) + name;
+}
+
+bool LevelMap::SaveCache(const std::wstring& path, const LevelMapGenerationSettings& settings) const
+{
+    if (!m_root) return false;
+
+    std::vector<LevelMapBSPNode*> nodes;
+    std::map<const LevelMapBSPNode*, int32_t> indices;
+    LevelCacheGatherNodes(m_root, nodes, indices);
+    auto indexOf = [&](const LevelMapBSPNodePtr& n) -> int32_t { return n ? indices.at(n.get()) : -1; };
+
+    LevelCacheData data;
+    data.m_nodes.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const auto n = nodes[i];
+        auto& cn = data.m_nodes[i];
+        ZeroMemory(&cn, sizeof(cn));
+        cn.area = n->m_area;
+        cn.type = n->m_type;
+        cn.parent = indexOf(n->m_parent);
+        cn.children[0] = indexOf(n->m_children[0]);
+        cn.children[1] = indexOf(n->m_children[1]);
+        cn.leafNdx = n->m_leafNdx;
+        cn.teleportNdx = n->m_teleportNdx;
+        cn.tag = n->m_tag;
+        cn.profile = n->IsLeaf() ? n->m_profile : 0;
+        cn.flags = n->m_finished ? LevelCacheNode::FINISHED : 0;
+        if (n->m_pillars)
+        {
+            cn.flags |= LevelCacheNode::HAS_PILLARS;
+            cn.firstPillar = (uint32_t)data.m_pillars.size();
+            cn.pillarCount = (uint32_t)n->m_pillars->size();
+            for (const auto& p : *n->m_pillars)
+                data.m_pillars.push_back(ToCache(p));
+        }
+        if (n->m_collisionSegments)
+        {
+            cn.flags |= LevelCacheNode::HAS_SEGMENTS;
+            cn.firstSegment = (uint32_t)data.m_segments.size();
+            cn.segmentCount = (uint32_t)n->m_collisionSegments->size();
+            const auto src = reinterpret_cast<const LevelCacheSegment*>(n->m_collisionSegments->data());
+            data.m_segments.insert(data.m_segments.end(), src, src + cn.segmentCount);
+        }
+    }
+
+    data.m_leaves.reserve(m_leaves.size());
+    for (const auto& l : m_leaves)
+        data.m_leaves.push_back(indexOf(l));
+
+    data.m_portals.reserve(m_portals.size());
+    for (const auto& p : m_portals)
+    {
+        LevelCachePortal cp = { { indexOf(p.m_leaves[0]), indexOf(p.m_leaves[1]) }, indexOf(p.m_wallNode), p.m_index, p.m_open ? 1 : 0 };
+        data.m_portals.push_back(cp);
+    }
+
+    data.m_teleports.reserve(m_teleports.size());
+    for (const auto& t : m_teleports)
+    {
+        LevelCacheTeleport ct = { { indexOf(t.m_leaves[0]), indexOf(t.m_leaves[1]) }, { ToCache(t.m_positions[0]), ToCache(t.m_positions[1]) }, t.m_open ? 1 : 0 };
+        data.m_teleports.push_back(ct);
+    }
+
+    const auto out = LevelCacheWrite(data, m_levelSeed, settings.Fingerprint(), ToCache(settings.m_tileCount));
+    return DX::WriteFileData(path, out.data(), out.size());
+}
+
+bool LevelMap::LoadCache(const std::wstring& path, const LevelMapGenerationSettings& settings)
+{
+    DX::MemoryTagScope memTag(DX::MEMTAG_LEVELMAP);
+    DX::MappedFile file;
+    if (!file.Open(path))
+        return false;
+
+    LevelCacheView view;
+    if (!LevelCacheRead(file.GetData(), file.GetSize(), settings.Fingerprint(), &view))
+        return false;
+
+    Destroy();
+    m_levelSeed = view.m_header->levelSeed;
+
+    const uint32_t nodeCount = view.Count(LCS_NODES);
+    std::vector<LevelMapBSPNodePtr> nodes(nodeCount);
+    for (auto& n : nodes)
+        n = std::make_shared<LevelMapBSPNode>();
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        const auto& cn = view.m_nodes[i];
+        auto& n = nodes[i];
+        n->m_area = cn.area;
+        n->m_type = (LevelMapBSPNode::NodeType)cn.type;
+        if (cn.parent != -1) n->m_parent = nodes[cn.parent];
+        if (cn.children[0] != -1) n->m_children[0] = nodes[cn.children[0]];
+        if (cn.children[1] != -1) n->m_children[1] = nodes[cn.children[1]];
+        n->m_leafNdx = cn.leafNdx;
+        n->m_teleportNdx = cn.teleportNdx;
+        n->m_tag = cn.tag;
+        n->m_profile = cn.profile;
+        n->m_finished = (cn.flags & LevelCacheNode::FINISHED) != 0;
+        if (cn.flags & LevelCacheNode::HAS_PILLARS)
+        {
+            const auto pillars = view.m_pillars + cn.firstPillar;
+            n->m_pillars = std::make_unique<std::vector<XMUINT2>>();
+            n->m_pillars->reserve(cn.pillarCount);
+            for (uint32_t p = 0; p < cn.pillarCount; ++p)
+                n->m_pillars->push_back(FromCache(pillars[p]));
+        }
+        if (cn.flags & LevelCacheNode::HAS_SEGMENTS)
+        {
+            const auto segments = reinterpret_cast<const CollSegment*>(view.m_segments + cn.firstSegment);
+            n->m_collisionSegments = std::make_shared<SegmentList>(segments, segments + cn.segmentCount);
+        }
+    }
+    m_root = nodes[0];
+
+    m_leaves.reserve(view.Count(LCS_LEAVES));
+    for (uint32_t i = 0; i < view.Count(LCS_LEAVES); ++i)
+        m_leaves.push_back(nodes[view.m_leaves[i]]);
+
+    m_portals.reserve(view.Count(LCS_PORTALS));
+    for (uint32_t i = 0; i < view.Count(LCS_PORTALS); ++i)
+    {
+        const auto& cp = view.m_portals[i];
+        LevelMapBSPPortal portal = { { nodes[cp.leaves[0]], nodes[cp.leaves[1]] }, nodes[cp.wallNode], cp.index, cp.open != 0 };
+        m_leafPortals.insert(std::make_pair(portal.m_leaves[0].get(), i));
+        m_leafPortals.insert(std::make_pair(portal.m_leaves[1].get(), i));
+        m_portals.push_back(portal);
+    }
+
+    m_teleports.reserve(view.Count(LCS_TELEPORTS));
+    for (uint32_t i = 0; i < view.Count(LCS_TELEPORTS); ++i)
+    {
+        const auto& ct = view.m_teleports[i];
+        LevelMapBSPTeleport tport = { { nodes[ct.leaves[0]], nodes[ct.leaves[1]] }, { FromCache(ct.positions[0]), FromCache(ct.positions[1]) }, ct.open != 0 };
+        m_teleports.push_back(tport);
+    }
+
+    if (settings.m_generateThumbTex)
+        GenerateThumbTex(FromCache(view.m_header->tileCount));
+    return true;
+}
+#pragma endregion
@@ -1,15 +1,18 @@
 ﻿#pragma once
 #include <DirectXMath.h>
 #include "CollisionAndSolving.h"
+#include "LevelBSP.h"
+#include "AudioSpatializer.h"
 
 using namespace DirectX;
 
-namespace DX { class DeviceResources; }
+namespace DX { class DeviceResources; class RandomProvider; }
 
 namespace SpookyAdulthood
 {
     struct LevelMapBSPNode;
     struct NodeDXResources;
+    struct VertexPositionNormalColorTextureNdx;
     struct VisMatrix;
     struct CameraFirstPerson;
     class LevelMap;
@@ -19,28 +22,6 @@ namespace SpookyAdulthood
     typedef std::shared_ptr<LevelMapBSPNode> LevelMapBSPNodePtr;
     typedef std::shared_ptr<NodeDXResources> NodeDXResourcesPtr;
 
-    //* ***************************************************************** *//
-    //* LevelMapBSPTileArea
-    //* ***************************************************************** *//
-    struct LevelMapBSPTileArea
-    {
-        LevelMapBSPTileArea(uint32_t x0=0, uint32_t x1=0, uint32_t y0=0, uint32_t y1=0) 
-            : m_x0(x0), m_x1(x1), m_y0(y0), m_y1(y1) 
-        {}
-        uint32_t SizeX() const { return m_x1 - m_x0 + 1; }
-        uint32_t SizeY() const { return m_y1 - m_y0 + 1; }
-        uint32_t CountTiles() const { return SizeX() * SizeY(); }
-        inline bool operator ==(const LevelMapBSPTileArea& rhs) const {
-            return m_x0 == rhs.m_x0 && m_x1 == rhs.m_x1 && m_y0 == rhs.m_y0 && m_y1 == rhs.m_y1;
-        }
-        inline bool Contains(const XMUINT2& o) const {
-            return o.x >= m_x0 && o.x <= m_x1 && o.y >= m_y0 && o.y <= m_y1;
-        }        
-
-        uint32_t m_x0, m_x1;
-        uint32_t m_y0, m_y1;
-    };
-
     //* ***************************************************************** *//
     //* LevelMapBSPNode
     //* ***************************************************************** *//
@@ -55,12 +36,15 @@ namespace SpookyAdulthood
         inline bool IsWall() const { return m_type == WALL_VERT || m_type == WALL_HORIZ;  }
         void CreateDeviceDependentResources(const LevelMap& lmap, const std::shared_ptr<DX::DeviceResources>& device);
         void ReleaseDeviceDependentResources();
+        // CPU side of the room geometry (floor, ceiling, walls, pillars), one quad per tile face
+        void BuildMesh(const LevelMap& lmap, std::vector<VertexPositionNormalColorTextureNdx>& vertices, std::vector<unsigned short>& indices);
         PortalDir GetPortalDirAt(const LevelMap& lmap, uint32_t x, uint32_t y);
         void GenerateCollisionSegments(const LevelMap& lmap);
         bool IsPillar(const XMUINT2& ppos)const;
-        XMFLOAT3 GetRandomXZ(const XMFLOAT2& shrink = XMFLOAT2(0, 0)) const;
-        XMFLOAT3 GetRandomXZWithClearance() const;
-        XMUINT2 GetRandomTile() const;
+        // rnd defaults to the AI stream
+        XMFLOAT3 GetRandomXZ(const XMFLOAT2& shrink = XMFLOAT2(0, 0), DX::RandomProvider* rnd=nullptr) const;
+        XMFLOAT3 GetRandomXZWithClearance(DX::RandomProvider* rnd=nullptr) const;
+        XMUINT2 GetRandomTile(DX::RandomProvider* rnd=nullptr) const;
         inline bool Clearance(const XMUINT2& pos) const { return m_area.Contains(pos) && !IsPillar(pos); };
         inline bool Clearance(const XMFLOAT3& pos) const { return Clearance(XMUINT2((UINT)pos.x, (UINT)pos.z)); }
 
@@ -144,7 +128,12 @@ namespace SpookyAdulthood
         uint32_t m_maxRecursiveDepth;
         float m_probRoom; // 0..1 probabilities to be a room if other req met
         float m_charRadius;
+        uint32_t m_parallelMinTiles; // subtrees with at least these tiles generate their children in parallel (0=never)
         bool m_generateThumbTex;
+        bool m_useCache; // load the shipped level for a seed (GetCachePath) instead of generating it
+
+        uint32_t Fingerprint() const; // caches are only valid for the same settings
+        LevelBSPParams GetBSPParams() const;
     };
 
     //* ***************************************************************** *//
@@ -188,8 +177,16 @@ namespace SpookyAdulthood
 
 		LevelMap(const std::shared_ptr<DX::DeviceResources>& device);
         ~LevelMap() { Destroy(); }
-		void Generate(const LevelMapGenerationSettings& settings);
-        void CreateDeviceDependentResources();
+		void Generate(const LevelMapGenerationSettings& settings); // picks the next level seed
+        // doesn't touch GameResources, can run in a worker while this map isn't used
+        void Generate(const LevelMapGenerationSettings& settings, uint32_t levelSeed);
+        void Swap(LevelMap& other);
+        // versioned binary level (tree, portals, teleports, pillars, collision), meshes are built on load
+        bool SaveCache(const std::wstring& path, const LevelMapGenerationSettings& settings) const;
+        bool LoadCache(const std::wstring& path, const LevelMapGenerationSettings& settings);
+        static std::wstring GetCachePath(uint32_t levelSeed);
+        void GenerateBSP(const LevelMapGenerationSettings& settings, const DX::RandomProvider& levelStream); // only tree and rooms
+        concurrency::task<void> CreateDeviceDependentResources();
         void ReleaseDeviceDependentResources();
         void Update(const DX::StepTimer& timer, const CameraFirstPerson& camera);
         void Render(const CameraFirstPerson& camera);
@@ -206,6 +203,10 @@ namespace SpookyAdulthood
         const std::vector<LevelMapBSPNodePtr>& GetRooms() const { return m_leaves; }
         void ToggleRoomDoors(int roomIndex=-1, bool open=true);
         LevelMapBSPNodePtr GetBiggestRoom() const;
+        DX::RandomProvider RandomForRoom(int roomIndex) const; // same than GameResources::RandomForRoom(RANDOM_LEVEL)
+        uint32_t GetLevelSeed() const { return m_levelSeed; }
+        const std::shared_ptr<DX::DeviceResources>& GetDevice() const { return m_device; }
+        void GetAdjacentRooms(int roomIndex, std::vector<int>& outRooms) const; // through doors and teleport
 
         bool RaycastDir(const XMFLOAT3& origin, const XMFLOAT3& dir, XMFLOAT3& outHit);
         bool RaycastSeg(const XMFLOAT3& origin, const XMFLOAT3& end, XMFLOAT3& outHit, float optRad=-1.0f, float offsHit=0.0f);
@@ -213,9 +214,8 @@ namespace SpookyAdulthood
 	private:
         friend struct LevelMapBSPNode;
         void Destroy();
-        void RecursiveGenerate(LevelMapBSPNodePtr& node, LevelMapBSPTileArea& area, const LevelMapGenerationSettings& settings, uint32_t depth);
-        void GenerateDetailsForRoom(LevelMapBSPNodePtr& node, const LevelMapGenerationSettings& settings);
-        void GeneratePillarsForRoom(LevelMapBSPNodePtr& node, const XMUINT2& minForPillars, const XMFLOAT2& probRange);
+        void RecursiveGatherLeaves(const LevelMapBSPNodePtr& node);
+        void RecursiveUnlinkParents(const LevelMapBSPNodePtr& node);
         void GenerateVisibility(const LevelMapGenerationSettings& settings);
         void GenerateCollisionInfo();
         bool VisRoomAreContiguous(const LevelMapBSPNodePtr& roomA, const LevelMapBSPNodePtr& roomB);
@@ -223,8 +223,6 @@ namespace SpookyAdulthood
         void VisGenerateTeleport(const LevelMapBSPNodePtr& roomA, const LevelMapBSPNodePtr& roomB);
         int VisComputeRandomPortalIndex(const LevelMapBSPTileArea& area1, const LevelMapBSPTileArea& area2, LevelMapBSPNode::NodeType wallDir);
         bool HasNode(const LevelMapBSPNodePtr& node, const LevelMapBSPNodePtr& lookFor);
-        void SplitNode(const LevelMapBSPTileArea& area, uint32_t at, LevelMapBSPNode::NodeType wallDir, LevelMapBSPTileArea* outAreas);
-        bool CanBeRoom(const LevelMapBSPNodePtr& node, const LevelMapBSPTileArea& area, const LevelMapGenerationSettings& settings, uint32_t depth);
         void GenerateTeleports(const VisMatrix& visMatrix);
         XMUINT2 GetRandomInArea(const LevelMapBSPNodePtr& node, bool checkNotInPortal=true);
         bool RenderSetCommonState(const CameraFirstPerson& camera);
@@ -238,11 +236,29 @@ namespace SpookyAdulthood
         LevelMapThumbTexture m_thumbTex;        
         XMFLOAT4X4 m_levelTransform;
         LevelMapBSPNodePtr m_cameraCurLeaf;
+        uint32_t m_levelSeed;
+        DX::RandomProvider* m_random; // level stream, only while generating
 
         // DX resources
         std::shared_ptr<DX::DeviceResources> m_device;
         Microsoft::WRL::ComPtr<ID3D11Texture2D>  m_atlasTexture;
         Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_atlasTextureSRV;
     };
+
+    // the map's rooms and doors for the audio occlusion, follows the map through Swap
+    class LevelMapAudioRooms : public AudioRoomGraph
+    {
+    public:
+        explicit LevelMapAudioRooms(const LevelMap& map) : m_map(map) {}
+        virtual uint32_t GetVersion() const override { return m_map.GetLevelSeed(); }
+        virtual uint32_t GetRoomCount() const override { return (uint32_t)m_map.GetRooms().size(); }
+        virtual int RoomAt(const XMFLOAT3& pos) const override;
+        virtual uint32_t GetPortalCount() const override { return (uint32_t)m_map.GetPortals().size(); }
+        virtual bool GetPortalRooms(uint32_t portal, int& roomA, int& roomB) const override;
+        virtual bool IsPortalOpen(uint32_t portal) const override { return m_map.GetPortals()[portal].m_open; }
+
+    private:
+        const LevelMap& m_map;
+    };
 }
 
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+namespace SpookyAdulthood
+{
+    //* ***************************************************************** *//
+    //* FinishNextLevel
+    //* The map step of GameResources::GenerateNewLevel without the device.
+    //* pending: a worker is building pendingSeed in the background
+    //*   wait():           waits for it, throws what the worker threw
+    //*   swap():           takes the level it built
+    //*   generate(seed):   builds seed on demand
+    //*   newSeed():        the seed when nothing was pregenerated
+    //* A failed worker is replaced by its seed on demand, so the player
+    //* always gets the announced level. Returns the seed of the level,
+    //* the random streams must be seeded with it
+    //* ***************************************************************** *//
+    template<typename TWait, typename TSwap, typename TGenerate, typename TNewSeed>
+    uint32_t FinishNextLevel(bool pending, uint32_t pendingSeed, const TWait& wait, const TSwap& swap, const TGenerate& generate, const TNewSeed& newSeed)
+    {
+        if (!pending)
+        {
+            const uint32_t seed = newSeed();
+            generate(seed);
+            return seed;
+        }
+
+        bool built = false;
+        try
+        {
+            wait();
+            built = true;
+        }
+        catch (...)
+        {
+        }
+
+        if (built)
+            swap();
+        else
+            generate(pendingSeed);
+        return pendingSeed;
+    }
+}
@@ -5,6 +5,7 @@
 #include "Sprite.h"
 #include "GlobalFlags.h"
 #include "CameraFirstPerson.h"
+#include "Benchmarks.h"
 
 using namespace SpookyAdulthood;
 
@@ -39,6 +40,7 @@ void SceneRenderer::CreateWindowSizeDependentResources()
 // Called once per frame, rotates the cube and calculates the model and view matrices.
 void SceneRenderer::Update(DX::StepTimer const& timer)
 {
+    DX_PROFILE_SCOPE("SceneRenderer::Update");
     if (!m_loadingComplete)
         return;
 
@@ -86,11 +88,24 @@ void SceneRenderer::Update(DX::StepTimer const& timer)
         GlobalFlags::SpawnPlayer = false;
         gameRes->SpawnPlayer();
     }
+
+    if (GlobalFlags::RunBenchmarks)
+    {
+        GlobalFlags::RunBenchmarks = false;
+        Benchmarks::RunAll(m_deviceResources);
+    }
+
+    if (GlobalFlags::CheckCollisions)
+    {
+        GlobalFlags::CheckCollisions = false;
+        Benchmarks::CollisionCrossCheck();
+    }
 }
 
 // Renders one frame using the vertex and pixel shaders.
 void SceneRenderer::Render()
 {
+    DX_PROFILE_SCOPE("SceneRenderer::Render");
 	// Loading is asynchronous.
 	if (!m_loadingComplete)
 		return;
@@ -133,6 +148,8 @@ void SceneRenderer::ReleaseDeviceDependentResources()
 {
 	m_loadingComplete = false;
     auto gameRes = m_deviceResources->GetGameResources();
+    gameRes->DiscardNextLevel();
+    gameRes->m_map.ReleaseDeviceDependentResources();
     gameRes->m_sprite.ReleaseDeviceDependentResources();
     gameRes->m_entityMgr.ReleaseDeviceDependentResources();
     m_deviceResources->GetGameResources()->m_entityMgr.ReleaseDeviceDependentResources();
@@ -0,0 +1,378 @@
+﻿#include "pch.h"
+#include "SoundVoicePool.h"
+
+#include <float.h>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace SpookyAdulthood
+{
+    //////////////////////////////////////////////////////////////////////////
+    //////////////////////////////////////////////////////////////////////////
+#pragma region Backends
+    NullSoundVoiceBackend::NullSoundVoiceBackend(const std::vector<float>& durations, uint32_t slots)
+        : m_durations(durations), m_remaining(slots, 0.0f), m_paused(slots, false)
+    {
+    }
+
+    void NullSoundVoiceBackend::Play(uint32_t slot, uint32_t sfx, float /*volume*/, float /*pitch*/, bool loop)
+    {
+        if (loop)
+            m_remaining[slot] = FLT_MAX;
+        else
+            m_remaining[slot] = sfx < m_durations.size() ? m_durations[sfx] : 0.0f;
+        m_paused[slot] = false;
+    }
+
+    void NullSoundVoiceBackend::Stop(uint32_t slot)
+    {
+        m_remaining[slot] = 0.0f;
+    }
+
+    void NullSoundVoiceBackend::Update(float stepTime)
+    {
+        for (size_t i = 0; i < m_remaining.size(); ++i)
+        {
+            if (m_remaining[i] != FLT_MAX && !m_paused[i])
+                m_remaining[i] -= stepTime;
+        }
+    }
+#pragma endregion
+
+    //////////////////////////////////////////////////////////////////////////
+    //////////////////////////////////////////////////////////////////////////
+#pragma region SoundVoicePool
+    SoundVoicePool::SoundVoicePool()
+        : m_listener(0, 0, 0), m_order(0), m_policy(STEAL_OLDEST)
+    {
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+    void SoundVoicePool::Initialize(std::unique_ptr<SoundVoiceBackend>&& backend, uint32_t maxVoices, StealPolicy policy)
+    {
+        if (!backend || maxVoices == 0 || maxVoices > MAX_VOICES)
+            throw std::invalid_argument("SoundVoicePool needs a backend and 1..MAX_VOICES voices");
+        Shutdown();
+        m_backend = std::move(backend);
+        m_voices.resize(maxVoices);
+        memset(m_voices.data(), 0, sizeof(Voice)*maxVoices);
+        m_policy = policy;
+        m_order = 0;
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+    void SoundVoicePool::Shutdown()
+    {
+        if (m_backend)
+            StopAll();
+        m_backend.reset();
+        m_voices.clear();
+    }
+
+    uint32_t SoundVoicePool::Play(uint32_t sfx, float volume, float pitch, SoundPriority prio, bool loop)
+    {
+        return Start(sfx, nullptr, 0.0f, volume, pitch, prio, loop);
+    }
+
+    uint32_t SoundVoicePool::PlayAt(uint32_t sfx, const XMFLOAT3& pos, float maxDist, float volume, float pitch, SoundPriority prio, bool loop)
+    {
+        return Start(sfx, &pos, maxDist, volume, pitch, prio, loop);
+    }
+
+    uint32_t SoundVoicePool::Start(uint32_t sfx, const XMFLOAT3* pos, float maxDist, float volume, float pitch, SoundPriority prio, bool loop)
+    {
+        if (!m_backend) return INVALID_VOICE;
+
+        Voice v;
+        memset(&v, 0, sizeof(v));
+        v.m_pos = pos ? *pos : m_listener;
+        v.m_maxDist = maxDist;
+        v.m_volume = volume;
+        v.m_prevPos = v.m_pos;
+        v.m_pitch = pitch;
+        v.m_doppler = 1.0f;
+        v.m_sfx = sfx;
+        v.m_prio = prio;
+        v.m_positional = pos != nullptr && maxDist > 0.0f;
+        v.m_room = v.m_positional ? m_spatializer.RoomAt(v.m_pos) : -1;
+        v.m_loop = loop;
+        v.m_gain = ComputeGain(v);
+
+        // inaudible one-shots never take a voice, loops may come into range later
+        if (v.m_positional && !loop && v.m_gain <= 0.0f)
+        {
+            ++m_stats.m_culled;
+            return INVALID_VOICE;
+        }
+
+        const int slot = AcquireSlot(prio, v.m_gain);
+        if (slot < 0)
+        {
+            ++m_stats.m_rejected;
+            return INVALID_VOICE;
+        }
+
+        auto& dst = m_voices[slot];
+        v.m_generation = (dst.m_generation + 1) & 0xffffff;
+        v.m_order = ++m_order;
+        v.m_active = true;
+        dst = v;
+        m_backend->Play(slot, sfx, v.m_gain, pitch, loop);
+
+        ++m_stats.m_played;
+        ++m_stats.m_active;
+        m_stats.m_peak = std::max(m_stats.m_peak, m_stats.m_active);
+        return (v.m_generation << 8) | (uint32_t)(slot + 1);
+    }
+
+    int SoundVoicePool::AcquireSlot(SoundPriority prio, float gain)
+    {
+        int victim = -1;
+        for (int i = 0; i < (int)m_voices.size(); ++i)
+        {
+            const auto& v = m_voices[i];
+            if (!v.m_active)
+                return i;
+
+            // lowest priority first, then the policy
+            if (v.m_prio > prio || v.m_prio == SOUND_PRIO_CRITICAL)
+                continue;
+            if (victim == -1)
+            {
+                victim = i;
+                continue;
+            }
+            const auto& cur = m_voices[victim];
+            if (v.m_prio != cur.m_prio)
+            {
+                if (v.m_prio < cur.m_prio) victim = i;
+            }
+            else if (m_policy == STEAL_OLDEST ? v.m_order < cur.m_order : v.m_gain < cur.m_gain)
+            {
+                victim = i;
+            }
+        }
+
+        // quietest never replaces a louder voice of the same priority with a quieter one
+        if (victim != -1 && m_policy == STEAL_QUIETEST && m_voices[victim].m_prio == prio && m_voices[victim].m_gain >= gain)
+            return -1;
+
+        if (victim != -1)
+        {
+            Release(victim);
+            ++m_stats.m_stolen;
+        }
+        return victim;
+    }
+
+    float SoundVoicePool::ComputeGain(const Voice& v) const
+    {
+        if (!v.m_positional)
+            return v.m_volume;
+        const float dx = v.m_pos.x - m_listener.x;
+        const float dz = v.m_pos.z - m_listener.z;
+        const float dist = sqrt(dx*dx + dz*dz);
+        return v.m_volume*(1.0f - std::min(1.0f, dist / v.m_maxDist))*m_spatializer.GetRoomGain(v.m_room);
+    }
+
+    SoundVoicePool::Voice* SoundVoicePool::Find(uint32_t voice)
+    {
+        const uint32_t slot = (voice & 0xff) - 1;
+        if (voice == INVALID_VOICE || slot >= m_voices.size()) return nullptr;
+        auto& v = m_voices[slot];
+        return (v.m_active && v.m_generation == (voice >> 8)) ? &v : nullptr;
+    }
+
+    const SoundVoicePool::Voice* SoundVoicePool::Find(uint32_t voice) const
+    {
+        return const_cast<SoundVoicePool*>(this)->Find(voice);
+    }
+
+    void SoundVoicePool::Release(uint32_t slot)
+    {
+        auto& v = m_voices[slot];
+        if (!v.m_active) return;
+        m_backend->Stop(slot);
+        v.m_active = false;
+        --m_stats.m_active;
+    }
+
+    void SoundVoicePool::Stop(uint32_t voice)
+    {
+        auto v = Find(voice);
+        if (v)
+            Release((uint32_t)(v - m_voices.data()));
+    }
+
+    void SoundVoicePool::StopSound(uint32_t sfx)
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+        {
+            if (m_voices[i].m_active && m_voices[i].m_sfx == sfx)
+                Release(i);
+        }
+    }
+
+    void SoundVoicePool::StopAll()
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+            Release(i);
+    }
+
+    void SoundVoicePool::SetPaused(uint32_t slot, bool paused)
+    {
+        auto& v = m_voices[slot];
+        if (!v.m_active || v.m_paused == paused) return;
+        v.m_paused = paused;
+        if (paused)
+            m_backend->Pause(slot);
+        else
+            m_backend->Resume(slot);
+    }
+
+    void SoundVoicePool::SetVoiceVolume(uint32_t slot, float volume)
+    {
+        // positional voices get the new gain from the spatializer next Update
+        auto& v = m_voices[slot];
+        v.m_volume = volume;
+        if (!v.m_positional)
+        {
+            v.m_gain = volume;
+            m_backend->SetVolume(slot, volume);
+        }
+    }
+
+    void SoundVoicePool::SetVoicePitch(uint32_t slot, float pitch)
+    {
+        auto& v = m_voices[slot];
+        v.m_pitch = pitch;
+        if (v.m_positional)
+            m_backend->SetSpatial(slot, v.m_gain, v.m_pan, Clamp(pitch + log2f(v.m_doppler), -1.0f, 1.0f));
+        else
+            m_backend->SetPitch(slot, pitch);
+    }
+
+    void SoundVoicePool::PauseSound(uint32_t sfx)
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+        {
+            if (m_voices[i].m_active && m_voices[i].m_sfx == sfx)
+                SetPaused(i, true);
+        }
+    }
+
+    void SoundVoicePool::ResumeSound(uint32_t sfx)
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+        {
+            if (m_voices[i].m_active && m_voices[i].m_sfx == sfx)
+                SetPaused(i, false);
+        }
+    }
+
+    void SoundVoicePool::SetSoundVolume(uint32_t sfx, float volume)
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+        {
+            if (m_voices[i].m_active && m_voices[i].m_sfx == sfx)
+                SetVoiceVolume(i, volume);
+        }
+    }
+
+    void SoundVoicePool::SetSoundPitch(uint32_t sfx, float pitch)
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+        {
+            if (m_voices[i].m_active && m_voices[i].m_sfx == sfx)
+                SetVoicePitch(i, pitch);
+        }
+    }
+
+    void SoundVoicePool::PauseAll()
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+            SetPaused(i, true);
+    }
+
+    void SoundVoicePool::ResumeAll()
+    {
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+            SetPaused(i, false);
+    }
+
+    void SoundVoicePool::SetPosition(uint32_t voice, const XMFLOAT3& pos)
+    {
+        auto v = Find(voice);
+        if (v && v->m_positional)
+        {
+            v->m_pos = pos;
+            v->m_room = m_spatializer.RoomAt(pos);
+        }
+        else if (v)
+        {
+            v->m_pos = pos;
+        }
+    }
+
+    bool SoundVoicePool::IsPlaying(uint32_t voice) const
+    {
+        return Find(voice) != nullptr;
+    }
+
+    void SoundVoicePool::Update(float stepTime, const XMFLOAT3& listener, const XMFLOAT3& forward)
+    {
+        if (!m_backend) return;
+
+        // jumps faster than half the speed of sound are teleports and respawns, not motion
+        const float maxSpeed = m_spatializer.GetSettings().m_speedOfSound*0.5f;
+        auto velocity = [&](const XMFLOAT3& from, const XMFLOAT3& to)
+        {
+            if (stepTime <= 0.0f) return XMFLOAT3(0, 0, 0);
+            const XMFLOAT3 vel((to.x - from.x) / stepTime, 0.0f, (to.z - from.z) / stepTime);
+            return (vel.x*vel.x + vel.z*vel.z > maxSpeed*maxSpeed) ? XMFLOAT3(0, 0, 0) : vel;
+        };
+        const XMFLOAT3 listenerVel = velocity(m_listener, listener);
+        m_listener = listener;
+        m_backend->Update(stepTime);
+
+        m_spatializer.Clear();
+        m_spatialSlots.clear();
+        for (uint32_t i = 0; i < m_voices.size(); ++i)
+        {
+            auto& v = m_voices[i];
+            if (!v.m_active || v.m_paused) continue;
+            if (!m_backend->IsPlaying(i))
+            {
+                v.m_active = false;
+                --m_stats.m_active;
+                continue;
+            }
+            if (v.m_positional)
+            {
+                m_spatializer.AddEmitter(v.m_pos, velocity(v.m_prevPos, v.m_pos), v.m_maxDist, v.m_volume, v.m_room);
+                m_spatialSlots.push_back(i);
+                v.m_prevPos = v.m_pos;
+            }
+        }
+
+        // every positional voice in one batch, only changes reach the backend
+        m_spatializer.Process(listener, forward, listenerVel, m_spatializer.RoomAt(listener));
+        for (uint32_t e = 0; e < m_spatialSlots.size(); ++e)
+        {
+            const uint32_t slot = m_spatialSlots[e];
+            auto& v = m_voices[slot];
+            const float gain = m_spatializer.GetGain(e);
+            const float pan = m_spatializer.GetPan(e);
+            const float doppler = m_spatializer.GetDoppler(e);
+            if (fabsf(gain - v.m_gain) > 1e-3f || fabsf(pan - v.m_pan) > 1e-2f || fabsf(doppler - v.m_doppler) > 1e-3f)
+            {
+                v.m_gain = gain;
+                v.m_pan = pan;
+                v.m_doppler = doppler;
+                m_backend->SetSpatial(slot, gain, pan, Clamp(v.m_pitch + log2f(doppler), -1.0f, 1.0f));
+            }
+        }
+    }
+#pragma endregion
+}
@@ -0,0 +1,148 @@
+﻿#pragma once
+#include "AudioSpatializer.h"
+
+using namespace DirectX;
+
+namespace SpookyAdulthood
+{
+    enum SoundPriority
+    {
+        SOUND_PRIO_LOW = 0,   // ambience, can always be stolen
+        SOUND_PRIO_NORMAL,    // enemies, items
+        SOUND_PRIO_HIGH,      // player feedback
+        SOUND_PRIO_CRITICAL   // never stolen
+    };
+
+    //* ***************************************************************** *//
+    //* SoundVoiceBackend
+    //* What actually plays a pool slot. Slots are stable indices [0, maxVoices)
+    //* The game's is XAudioSoundVoiceBackend, in its own header
+    //* ***************************************************************** *//
+    class SoundVoiceBackend
+    {
+    public:
+        virtual ~SoundVoiceBackend() {}
+        virtual void Play(uint32_t slot, uint32_t sfx, float volume, float pitch, bool loop) = 0;
+        virtual void Stop(uint32_t slot) = 0;
+        virtual void SetVolume(uint32_t slot, float volume) = 0;
+        virtual void SetPitch(uint32_t slot, float pitch) = 0;
+        virtual void Pause(uint32_t slot) = 0;
+        virtual void Resume(uint32_t slot) = 0;
+        virtual bool IsPlaying(uint32_t slot) = 0; // false while paused
+        virtual void Update(float /*stepTime*/) {}
+        // positional voices, pan -1..1 and pitch in octaves
+        virtual void SetSpatial(uint32_t slot, float volume, float /*pan*/, float /*pitch*/) { SetVolume(slot, volume); }
+    };
+
+    // no audio at all, a voice just lasts the duration of its sfx (headless runs, tests)
+    class NullSoundVoiceBackend : public SoundVoiceBackend
+    {
+    public:
+        NullSoundVoiceBackend(const std::vector<float>& durations, uint32_t slots);
+        virtual void Play(uint32_t slot, uint32_t sfx, float volume, float pitch, bool loop) override;
+        virtual void Stop(uint32_t slot) override;
+        virtual void SetVolume(uint32_t /*slot*/, float /*volume*/) override {}
+        virtual void SetPitch(uint32_t /*slot*/, float /*pitch*/) override {}
+        virtual void Pause(uint32_t slot) override { m_paused[slot] = true; }
+        virtual void Resume(uint32_t slot) override { m_paused[slot] = false; }
+        virtual bool IsPlaying(uint32_t slot) override { return !m_paused[slot] && m_remaining[slot] > 0.0f; }
+        virtual void Update(float stepTime) override;
+
+    private:
+        std::vector<float> m_durations; // seconds, per sfx
+        std::vector<float> m_remaining; // seconds, per slot
+        std::vector<bool> m_paused;     // per slot
+    };
+
+    //* ***************************************************************** *//
+    //* SoundVoicePool
+    //* Bounded set of voices allocated per play request. When full, a voice
+    //* of lower or equal priority is stolen (oldest or quietest); positional
+    //* one-shots out of range are culled before taking a voice. Positional
+    //* voices are spatialized together every Update (AudioSpatializer).
+    //* ***************************************************************** *//
+    class SoundVoicePool
+    {
+    public:
+        enum StealPolicy { STEAL_OLDEST, STEAL_QUIETEST };
+        enum { INVALID_VOICE = 0, MAX_VOICES = 255 };
+
+        struct Stats
+        {
+            uint32_t m_active;
+            uint32_t m_peak;
+            uint32_t m_played;
+            uint32_t m_stolen;
+            uint32_t m_culled;
+            uint32_t m_rejected; // full and nothing could be stolen
+        };
+
+        SoundVoicePool();
+        void Initialize(std::unique_ptr<SoundVoiceBackend>&& backend, uint32_t maxVoices, StealPolicy policy=STEAL_OLDEST);
+        void Shutdown();
+
+        uint32_t Play(uint32_t sfx, float volume, float pitch, SoundPriority prio, bool loop=false);
+        uint32_t PlayAt(uint32_t sfx, const XMFLOAT3& pos, float maxDist, float volume, float pitch, SoundPriority prio, bool loop=false);
+        void Stop(uint32_t voice);
+        void StopSound(uint32_t sfx); // every voice playing sfx
+        void StopAll();
+        // every voice playing sfx; positional voices keep their attenuation, doppler and pan
+        void PauseSound(uint32_t sfx);
+        void ResumeSound(uint32_t sfx);
+        void SetSoundVolume(uint32_t sfx, float volume);
+        void SetSoundPitch(uint32_t sfx, float pitch);
+        void PauseAll();
+        void ResumeAll();
+        void SetPosition(uint32_t voice, const XMFLOAT3& pos);
+        bool IsPlaying(uint32_t voice) const;
+        void Update(float stepTime, const XMFLOAT3& listener, const XMFLOAT3& forward=XMFLOAT3(0, 0, -1));
+        inline void SetRooms(const AudioRoomGraph* rooms) { m_spatializer.SetRooms(rooms); } // portal occlusion
+        inline AudioSpatializer& GetSpatializer() { return m_spatializer; }
+
+        inline void SetStealPolicy(StealPolicy policy) { m_policy = policy; }
+        inline StealPolicy GetStealPolicy() const { return m_policy; }
+        inline const Stats& GetStats() const { return m_stats; }
+        inline uint32_t GetMaxVoices() const { return (uint32_t)m_voices.size(); }
+
+    private:
+        struct Voice
+        {
+            XMFLOAT3 m_pos;
+            XMFLOAT3 m_prevPos; // at the last Update, for the velocity
+            float m_maxDist;
+            float m_volume; // as requested
+            float m_gain;   // after distance attenuation and occlusion
+            float m_pitch;  // as requested
+            float m_pan;
+            float m_doppler;
+            int m_room;
+            uint64_t m_order;
+            uint32_t m_sfx;
+            uint32_t m_generation;
+            SoundPriority m_prio;
+            bool m_active;
+            bool m_paused;
+            bool m_positional;
+            bool m_loop;
+        };
+
+        uint32_t Start(uint32_t sfx, const XMFLOAT3* pos, float maxDist, float volume, float pitch, SoundPriority prio, bool loop);
+        int AcquireSlot(SoundPriority prio, float gain);
+        float ComputeGain(const Voice& v) const;
+        Voice* Find(uint32_t voice);
+        const Voice* Find(uint32_t voice) const;
+        void Release(uint32_t slot);
+        void SetPaused(uint32_t slot, bool paused);
+        void SetVoiceVolume(uint32_t slot, float volume);
+        void SetVoicePitch(uint32_t slot, float pitch);
+
+        std::unique_ptr<SoundVoiceBackend> m_backend;
+        std::vector<Voice> m_voices;
+        AudioSpatializer m_spatializer;
+        std::vector<uint32_t> m_spatialSlots; // emitter index -> slot
+        XMFLOAT3 m_listener;
+        uint64_t m_order;
+        StealPolicy m_policy;
+        Stats m_stats;
+    };
+}
@@ -2,6 +2,9 @@
 #include "Sprite.h"
 #include "../Common/DirectXHelper.h"
 #include "../Common/DeviceResources.h"
+#include "../Common/AssetArchive.h"
+#include "../Common/MappedFile.h"
+#include "ImageDecoder.h"
 #include "CameraFirstPerson.h"
 #include "GlobalFlags.h"
 
@@ -15,6 +18,7 @@ namespace SpookyAdulthood
         : m_device(device)
     {
         m_rendering[R3D] = m_rendering[R2D] = false;
+        ZeroMemory(&m_loadStats, sizeof(m_loadStats));
     }
 
     void SpriteManager::CreateDeviceDependentResources()
@@ -73,10 +77,7 @@ namespace SpookyAdulthood
         m_vertexBuffer.Reset();
         m_indexBuffer.Reset();
 
-        for (int i = 0; i < (int)m_sprites.size(); ++i)
-        {
-            CreateSprite(m_sprites[i].m_filename, i);
-        }
+        LoadSprites(0, (int)m_sprites.size());
     }
     
     void SpriteManager::Draw3D(int spriteIndex, const XMFLOAT3& position, const XMFLOAT2& size, const XMFLOAT4& modulate, 
@@ -108,14 +109,36 @@ namespace SpookyAdulthood
 
     int SpriteManager::CreateSprite(const std::wstring& pathToTex, int at/*=-1*/)
     {
+        DX::MemoryTagScope memTag(DX::MEMTAG_SPRITES);
         Sprite spr;
         spr.m_filename = pathToTex;
         std::transform(spr.m_filename.begin(), spr.m_filename.end(), spr.m_filename.begin(), ::towlower);
-        if (pathToTex.substr(pathToTex.find_last_of(L".") + 1) == L"dds")
+        const bool dds = spr.m_filename.substr(spr.m_filename.find_last_of(L".") + 1) == L"dds";
+        const auto blob = m_archive ? m_archive->Get(pathToTex) : DX::AssetArchive::Blob();
+        if (blob && dds)
         {
             DX::ThrowIfFailed(
-                DirectX::CreateDDSTextureFromFile(
-                    m_device->GetD3DDevice(), pathToTex.c_str(),
+                DirectX::CreateDDSTextureFromMemory(
+                    m_device->GetD3DDevice(), blob.m_data, blob.m_size,
+                    (ID3D11Resource**)spr.m_texture.ReleaseAndGetAddressOf(),
+                    spr.m_textureSRV.ReleaseAndGetAddressOf()));
+        }
+        else if (blob)
+        {
+            DX::ThrowIfFailed(
+                DirectX::CreateWICTextureFromMemory(
+                    m_device->GetD3DDevice(), blob.m_data, blob.m_size,
+                    (ID3D11Resource**)spr.m_texture.ReleaseAndGetAddressOf(),
+                    spr.m_textureSRV.ReleaseAndGetAddressOf()));
+        }
+        else if (dds)
+        {
+            // parsed in place from the mapped view, the loader's subresources point into it
+            DX::MappedFile file;
+            DX::ThrowIfFalse(file.Open(pathToTex));
+            DX::ThrowIfFailed(
+                DirectX::CreateDDSTextureFromMemory(
+                    m_device->GetD3DDevice(), file.GetData(), file.GetSize(),
                     (ID3D11Resource**)spr.m_texture.ReleaseAndGetAddressOf(),
                     spr.m_textureSRV.ReleaseAndGetAddressOf()));
         }
@@ -140,10 +163,142 @@ namespace SpookyAdulthood
         return at;
     }
 
+    int SpriteManager::CreateSprites(const std::vector<std::wstring>& paths)
+    {
+        DX::MemoryTagScope memTag(DX::MEMTAG_SPRITES);
+        const int first = (int)m_sprites.size();
+        m_sprites.resize(first + paths.size());
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            auto& name = m_sprites[first + i].m_filename;
+            name = paths[i];
+            std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+        }
+        LoadSprites(first, (int)paths.size());
+        return first;
+    }
+
+    void SpriteManager::LoadSprites(int first, int count)
+    {
+        DX::MemoryTagScope memTag(DX::MEMTAG_SPRITES);
+        struct Pending
+        {
+            Pending() : m_fileBytes(0), m_decoded(false), m_us(0) {}
+
+            DecodedImage m_image;
+            size_t m_fileBytes;
+            bool m_decoded;
+            __int64 m_us;
+        };
+        std::vector<Pending> pending(count);
+
+        D3D_FEATURE_LEVEL level = m_device->GetD3DDevice()->GetFeatureLevel();
+        const uint32_t maxSize = level >= D3D_FEATURE_LEVEL_11_0 ? D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+            : (level >= D3D_FEATURE_LEVEL_10_0 ? D3D10_REQ_TEXTURE2D_U_OR_V_DIMENSION
+            : (level >= D3D_FEATURE_LEVEL_9_3 ? D3D_FL9_3_REQ_TEXTURE2D_U_OR_V_DIMENSION : D3D_FL9_1_REQ_TEXTURE2D_U_OR_V_DIMENSION));
+
+        // read + decode on the pool. Pixels stay straight alpha, the sprite shaders premultiply
+        ZeroMemory(&m_loadStats, sizeof(m_loadStats));
+        const __int64 decodeStageUs = time_call_us([&]
+        {
+            concurrency::parallel_for(0, count, [&](int i)
+            {
+                const auto& name = m_sprites[first + i].m_filename;
+                if (name.size() < 4 || name.compare(name.size() - 4, 4, L".png") != 0)
+                    return;
+
+                auto& p = pending[i];
+                DX::AssetArchive::Blob blob;
+                DX::MappedFile file;
+                const uint8_t* data = nullptr;
+                if (m_archive)
+                    blob = m_archive->Get(name);
+                if (blob)
+                {
+                    data = blob.m_data;
+                    p.m_fileBytes = blob.m_size;
+                }
+                else if (file.Open(name))
+                {
+                    data = file.GetData();
+                    p.m_fileBytes = file.GetSize();
+                }
+                if (!data)
+                    return;
+
+                p.m_us = time_call_us([&] { p.m_decoded = DecodePNG(data, p.m_fileBytes, p.m_image) == PNG_OK; });
+                if (p.m_decoded && (p.m_image.m_width > maxSize || p.m_image.m_height > maxSize))
+                {
+                    p.m_decoded = false;
+                    p.m_image = DecodedImage();
+                }
+            });
+        });
+
+        // upload only consumes finished buffers; anything the decoder left (dds, grayscale, huge) takes the WIC/DDS path
+        const __int64 uploadUs = time_call_us([&]
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                auto& p = pending[i];
+                if (p.m_decoded)
+                {
+                    CreateTexture(p.m_image, m_sprites[first + i]);
+                    ++m_loadStats.m_decoded;
+                    m_loadStats.m_fileBytes += p.m_fileBytes;
+                    m_loadStats.m_pixelBytes += p.m_image.m_pixels.size();
+                    m_loadStats.m_decodeUs += p.m_us;
+                    p.m_image = DecodedImage();
+                }
+                else
+                {
+                    CreateSprite(m_sprites[first + i].m_filename, first + i);
+                }
+            }
+        });
+
+        m_loadStats.m_count = (uint32_t)count;
+        m_loadStats.m_decodeStageUs = decodeStageUs;
+        m_loadStats.m_uploadUs = uploadUs;
+        m_loadStats.m_totalUs = decodeStageUs + uploadUs;
+
+        wchar_t buff[256];
+        const double mb = 1.0 / (1024.0 * 1024.0);
+        swprintf_s(buff, L"Sprites: %u ready in %.2f ms (decode %.2f ms, upload %.2f ms), %u through WIC/DDS, %.1f MB/s in, %.1f MB/s pixels per worker\n",
+            m_loadStats.m_count, m_loadStats.m_totalUs / 1000.0, decodeStageUs / 1000.0, uploadUs / 1000.0, m_loadStats.m_count - m_loadStats.m_decoded,
+            m_loadStats.m_decodeUs ? m_loadStats.m_fileBytes*mb*1e6 / m_loadStats.m_decodeUs : 0.0,
+            m_loadStats.m_decodeUs ? m_loadStats.m_pixelBytes*mb*1e6 / m_loadStats.m_decodeUs : 0.0);
+        OutputDebugStringW(buff);
+    }
+
+    void SpriteManager::CreateTexture(const DecodedImage& image, Sprite& spr)
+    {
+        // same result as the WIC loader without a context: one mip, _SRGB when the png says so
+        D3D11_TEXTURE2D_DESC desc = {};
+        desc.Width = image.m_width;
+        desc.Height = image.m_height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = image.m_sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+        D3D11_SUBRESOURCE_DATA init = {};
+        init.pSysMem = image.m_pixels.data();
+        init.SysMemPitch = image.m_width * 4;
+        init.SysMemSlicePitch = (UINT)image.m_pixels.size();
+
+        auto device = m_device->GetD3DDevice();
+        DX::ThrowIfFailed(device->CreateTexture2D(&desc, &init, spr.m_texture.ReleaseAndGetAddressOf()));
+        DX::ThrowIfFailed(device->CreateShaderResourceView(spr.m_texture.Get(), nullptr, spr.m_textureSRV.ReleaseAndGetAddressOf()));
+    }
+
     void SpriteManager::Begin3D(const CameraFirstPerson& camera)
     {
         DX::ThrowIfFalse(!m_rendering[R3D]);
         m_rendering[R3D] = true;
+        ResetSpritesToRender(R3D);
 
         auto dxCommon = m_device->GetGameResources();
         if (!dxCommon->m_readyToRender) return;
@@ -163,11 +318,20 @@ namespace SpookyAdulthood
         m_cbData.view = camera.m_view;
         m_cbData.projection = camera.m_projection;
         m_camPosition = camera.GetPosition();
-        m_spritesToRender[R3D].clear();
+    }
+
+    void SpriteManager::ResetSpritesToRender(int which)
+    {
+        // frame memory, the previous vector is dropped rather than cleared. Reserving what
+        // the last frame drew keeps it to a single arena allocation
+        const size_t lastCount = m_spritesToRender[which].size();
+        m_spritesToRender[which] = DX::FrameVector<SpriteRender>();
+        m_spritesToRender[which].reserve(lastCount);
     }
 
     void SpriteManager::End3D()
     {
+        DX_PROFILE_SCOPE("SpriteManager::End3D");
         DX::ThrowIfFalse(m_rendering[R3D]);
         m_rendering[R3D] = false;
 
@@ -249,6 +413,7 @@ namespace SpookyAdulthood
     {
         DX::ThrowIfFalse(!m_rendering[R2D]);
         m_rendering[R2D] = true;
+        ResetSpritesToRender(R2D);
         m_aspectRatio = camera.m_aspectRatio;
 
         auto dxCommon = m_device->GetGameResources();
@@ -265,11 +430,11 @@ namespace SpookyAdulthood
         context->OMSetDepthStencilState(dxCommon->m_commonStates->DepthNone(), 0);
         context->OMSetBlendState(dxCommon->m_commonStates->AlphaBlend(), nullptr, 0xffffffff);
         context->RSSetState(dxCommon->m_commonStates->CullCounterClockwise());
-        m_spritesToRender[R2D].clear();
     }
 
     void SpriteManager::End2D()
     {
+        DX_PROFILE_SCOPE("SpriteManager::End2D");
         DX::ThrowIfFalse(m_rendering[R2D]);
         m_rendering[R2D] = false;
 
@@ -364,6 +529,7 @@ namespace SpookyAdulthood
 
     int SpriteManager::CreateAnimation(const std::vector<int>& spritesIndices, float fps, bool loop)
     {
+        DX::MemoryTagScope memTag(DX::MEMTAG_SPRITES);
         SpriteAnimation anim = { spritesIndices, 1.0f / fps, loop };
         m_animations.push_back(anim);
         return (int)m_animations.size() - 1;
@@ -371,6 +537,7 @@ namespace SpookyAdulthood
 
     int SpriteManager::CreateAnimationInstance(int animationIndex, int _at)
     {
+        DX::MemoryTagScope memTag(DX::MEMTAG_SPRITES);
         // look for a free usable slot (m_active==false)
         int at = -1;
         if (_at == -1 || _at <0 || _at >= (int)m_animInstances.size())
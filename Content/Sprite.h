@@ -2,11 +2,12 @@
 #include "ShaderStructures.h"
 
 using namespace DirectX;
-namespace DX { class DeviceResources; }
+namespace DX { class DeviceResources; class AssetArchive; }
 
 namespace SpookyAdulthood
 {
     struct CameraFirstPerson;
+    struct DecodedImage;
     struct Sprite
     {
         Microsoft::WRL::ComPtr<ID3D11Texture2D> m_texture;
@@ -14,6 +15,19 @@ namespace SpookyAdulthood
         std::wstring m_filename;
     };
 
+    // last CreateSprites batch, from the first file read to every texture uploaded
+    struct SpriteLoadStats
+    {
+        uint32_t m_count;
+        uint32_t m_decoded;         // by the portable decoder, the rest went through WIC/DDS
+        uint64_t m_fileBytes;       // of the decoded ones
+        uint64_t m_pixelBytes;
+        __int64 m_decodeUs;         // summed over the workers
+        __int64 m_decodeStageUs;    // wall clock of the parallel stage
+        __int64 m_uploadUs;
+        __int64 m_totalUs;
+    };
+
     struct SpriteRender
     {
         XMFLOAT3 m_position;
@@ -63,7 +77,13 @@ namespace SpookyAdulthood
         void Draw2D(int spriteIndex, const XMFLOAT2& position, const XMFLOAT2& size, float rot);
         void Draw2DAnimation(int instIndex, const XMFLOAT2& position, const XMFLOAT2& size, float rot);
 
+        // textures come from the archive when it has them, loose files otherwise
+        void SetArchive(const std::shared_ptr<const DX::AssetArchive>& archive) { m_archive = archive; }
         int CreateSprite(const std::wstring& pathToTex, int at = -1);
+        // reads and decodes the batch on the worker pool, then uploads it in order on this thread. Returns the first index
+        int CreateSprites(const std::vector<std::wstring>& paths);
+        const SpriteLoadStats& GetLoadStats() const { return m_loadStats; }
+        int GetSpriteCount() const { return (int)m_sprites.size(); }
         int CreateAnimation(const std::vector<int>& spritesIndices, float fps, bool loop=false);
         int CreateAnimationInstance(int animationIndex, int at=-1);
         
@@ -72,18 +92,24 @@ namespace SpookyAdulthood
         void DrawScreenQuad(ID3D11ShaderResourceView* srv, const XMFLOAT4& params0, const XMFLOAT4& params1=XMFLOAT4(0,0,0,0));
 
     private:
+        void LoadSprites(int first, int count);
+        void CreateTexture(const DecodedImage& image, Sprite& spr);
+        void ResetSpritesToRender(int which);
+
         std::shared_ptr<DX::DeviceResources>    m_device;
+        std::shared_ptr<const DX::AssetArchive> m_archive;
         Microsoft::WRL::ComPtr<ID3D11Buffer>	m_vertexBuffer;
         Microsoft::WRL::ComPtr<ID3D11Buffer>	m_indexBuffer;
         std::vector<Sprite> m_sprites;
         XMMATRIX m_camInvYaw, m_camInvPitch;
         ModelViewProjectionConstantBuffer m_cbData;
-        std::vector<SpriteRender> m_spritesToRender[2];
+        DX::FrameVector<SpriteRender> m_spritesToRender[2]; // rebuilt every frame on the frame arena
         std::vector<SpriteAnimation> m_animations;
         std::vector<SpriteAnimationInstance> m_animInstances;
         float m_aspectRatio;
         XMFLOAT3 m_camPosition;
         bool m_rendering[2];
+        SpriteLoadStats m_loadStats;
     };
 
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ using namespace Microsoft::WRL;
 UIRenderer::UIRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) : 
 	m_text(L""),
 	m_deviceResources(deviceResources),
+    m_textBullets(-1),
     m_time(.0f)
 {
 	ZeroMemory(&m_textMetrics, sizeof(DWRITE_TEXT_METRICS));
@@ -47,12 +48,20 @@ UIRenderer::UIRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResourc
 // Updates the text to be displayed.
 void UIRenderer::Update(DX::StepTimer const& timer)
 {
+    DX_PROFILE_SCOPE("UIRenderer::Update");
 	// Update display text.
 	uint32 fps = timer.GetFramesPerSecond();
     auto gameRes = DX::GameResources::instance;
     int ri = gameRes->m_curRoomIndex;
 	//m_text = (fps > 0) ? std::to_wstring(fps) + L" / " + std::to_wstring(ri) : L" - FPS";
-    m_text = std::wstring(L"Treats " ) + std::to_wstring(gameRes->m_camera.m_bullets);
+    m_time += (float)timer.GetElapsedSeconds();
+
+    // the text (and its layout) only changes with the bullets, not every frame
+    const int bullets = gameRes->m_camera.m_bullets;
+    if (m_textLayout && bullets == m_textBullets)
+        return;
+    m_textBullets = bullets;
+    m_text = std::wstring(L"Treats " ) + std::to_wstring(bullets);
 
 	ComPtr<IDWriteTextLayout> textLayout;
 	DX::ThrowIfFailed(
@@ -73,8 +82,6 @@ void UIRenderer::Update(DX::StepTimer const& timer)
 	DX::ThrowIfFailed(
 		m_textLayout->GetMetrics(&m_textMetrics)
 		);
-
-    m_time += (float)timer.GetElapsedSeconds();
 }
 
 // Renders a frame to the screen.
@@ -103,25 +110,22 @@ void UIRenderer::Render()
         if (gameRes->m_deathMessage)
         {
             auto s = gameRes->m_sprites.get();
-            auto f = gameRes->m_fontConsole.get();            
-           
-            const wchar_t* text = gameRes->m_deathMessage == 1
-                ? L"YOU DIE! <No more bullets>"
-                : L"YOU DIE!";
+            if (m_retryLayout.GetGlyphCount() == 0)
+                BuildTextLayouts(*gameRes->m_fontConsole);
+
+            const auto& death = m_deathLayout[gameRes->m_deathMessage == 1 ? 1 : 0];
 
             s->Begin();
-            auto measure = f->MeasureString(text);
+            auto measure = death.GetSize();
             const float padY = XMVectorGetY(measure);
             float padX = XMVectorGetX(measure);
             XMFLOAT2 p(logicalSize.Width*0.5f - padX*0.5f, logicalSize.Height*0.5f - padY);
-            f->DrawString(s, text, p, DirectX::Colors::Black);
+            death.Draw(s, p, DirectX::Colors::Black);
             p.y += padY;
 
-            const wchar_t* text2 = L"[Left-Click] try again / (ESC) Menu";
-            measure = f->MeasureString(text2);
-            padX = XMVectorGetX(measure);
+            padX = XMVectorGetX(m_retryLayout.GetSize());
             p.x = logicalSize.Width*0.5f - padX*0.5f;
-            f->DrawString(s, text2, p, DirectX::Colors::Black);
+            m_retryLayout.Draw(s, p, DirectX::Colors::Black);
             s->End();
         }
     } 
@@ -149,25 +153,26 @@ void UIRenderer::Render()
 
         {
             auto s = gameRes->m_sprites.get();
-            auto f = gameRes->m_fontConsole.get();
-            const wchar_t* text = L"Congratulations, send a screenshot to mmrom@microsoft.com";
-            auto measure = f->MeasureString(text);
+            if (m_retryLayout.GetGlyphCount() == 0)
+                BuildTextLayouts(*gameRes->m_fontConsole);
+
+            auto measure = m_congratsLayout.GetSize();
             const float padY = XMVectorGetY(measure);
             const float padX = XMVectorGetX(measure);
 
             s->Begin();
             XMFLOAT2 p(10, logicalSize.Height - padY*4);
-            f->DrawString(s, L"A game by Manu Marin", p, DirectX::Colors::White);
-            p.y += padY;
-            f->DrawString(s, L"mmrom@microsoft.com", p, DirectX::Colors::White);
-            p.y += padY;
-            f->DrawString(s, L"(F1) Help / (ESC) Exit", p, DirectX::Colors::White);
+            for (const auto& line : m_creditsLayout)
+            {
+                line.Draw(s, p, DirectX::Colors::White);
+                p.y += padY;
+            }
 
             if (gameRes->m_bossDefeated)
             {
                 p.x = logicalSize.Width *0.5f - padX*0.5f;
                 p.y = padY*4.0f;
-                f->DrawString(s, text, p, DirectX::Colors::Green);
+                m_congratsLayout.Draw(s, p, DirectX::Colors::Green);
             }
             s->End();
         }        
@@ -202,4 +207,21 @@ void UIRenderer::CreateDeviceDependentResources()
 void UIRenderer::ReleaseDeviceDependentResources()
 {
 	m_whiteBrush.Reset();
+
+    // they reference the font texture, rebuilt from the new font on the next Render
+    for (auto& l : m_deathLayout) l = DirectX::TextLayout();
+    for (auto& l : m_creditsLayout) l = DirectX::TextLayout();
+    m_retryLayout = DirectX::TextLayout();
+    m_congratsLayout = DirectX::TextLayout();
+}
+
+void UIRenderer::BuildTextLayouts(const DirectX::SpriteFont& font)
+{
+    m_deathLayout[0] = font.LayoutString(L"YOU DIE!");
+    m_deathLayout[1] = font.LayoutString(L"YOU DIE! <No more bullets>");
+    m_retryLayout = font.LayoutString(L"[Left-Click] try again / (ESC) Menu");
+    m_creditsLayout[0] = font.LayoutString(L"A game by Manu Marin");
+    m_creditsLayout[1] = font.LayoutString(L"mmrom@microsoft.com");
+    m_creditsLayout[2] = font.LayoutString(L"(F1) Help / (ESC) Exit");
+    m_congratsLayout = font.LayoutString(L"Congratulations, send a screenshot to mmrom@microsoft.com");
 }
\ No newline at end of file
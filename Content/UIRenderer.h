@@ -22,11 +22,19 @@ namespace SpookyAdulthood
 
 		// Resources related to text rendering.
 		std::wstring                                    m_text;
+		int                                             m_textBullets; // m_text is built for this count
 		DWRITE_TEXT_METRICS	                            m_textMetrics;
 		Microsoft::WRL::ComPtr<ID2D1SolidColorBrush>    m_whiteBrush;
 		Microsoft::WRL::ComPtr<ID2D1DrawingStateBlock1> m_stateBlock;
 		Microsoft::WRL::ComPtr<IDWriteTextLayout3>      m_textLayout;
 		Microsoft::WRL::ComPtr<IDWriteTextFormat2>      m_textFormat;
         float m_time;
+
+        // Constant strings drawn with the console font, laid out once instead of every frame
+        void BuildTextLayouts(const DirectX::SpriteFont& font);
+        DirectX::TextLayout m_deathLayout[2];       // "YOU DIE!" and the no bullets variant
+        DirectX::TextLayout m_retryLayout;
+        DirectX::TextLayout m_creditsLayout[3];
+        DirectX::TextLayout m_congratsLayout;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+﻿#include "pch.h"
+#include "XAudioSoundVoiceBackend.h"
+
+using namespace DirectX;
+
+namespace SpookyAdulthood
+{
+    XAudioSoundVoiceBackend::XAudioSoundVoiceBackend(const std::vector<DirectX::SoundEffect*>& effects, uint32_t slots)
+        : m_effects(effects), m_instances(slots), m_instanceSfx(slots, UINT32_MAX)
+    {
+    }
+
+    void XAudioSoundVoiceBackend::Play(uint32_t slot, uint32_t sfx, float volume, float pitch, bool loop)
+    {
+        auto& inst = m_instances[slot];
+        if (!inst || m_instanceSfx[slot] != sfx)
+        {
+            inst.reset();
+            if (sfx >= m_effects.size() || !m_effects[sfx]) return;
+            inst = m_effects[sfx]->CreateInstance();
+            m_instanceSfx[slot] = sfx;
+        }
+        inst->Stop();
+        inst->SetVolume(volume);
+        inst->SetPitch(pitch);
+        inst->Play(loop);
+    }
+
+    void XAudioSoundVoiceBackend::Stop(uint32_t slot)
+    {
+        if (m_instances[slot])
+            m_instances[slot]->Stop();
+    }
+
+    void XAudioSoundVoiceBackend::SetVolume(uint32_t slot, float volume)
+    {
+        if (m_instances[slot])
+            m_instances[slot]->SetVolume(volume);
+    }
+
+    void XAudioSoundVoiceBackend::SetPitch(uint32_t slot, float pitch)
+    {
+        if (m_instances[slot])
+            m_instances[slot]->SetPitch(pitch);
+    }
+
+    void XAudioSoundVoiceBackend::Pause(uint32_t slot)
+    {
+        if (m_instances[slot])
+            m_instances[slot]->Pause();
+    }
+
+    void XAudioSoundVoiceBackend::Resume(uint32_t slot)
+    {
+        if (m_instances[slot])
+            m_instances[slot]->Resume();
+    }
+
+    bool XAudioSoundVoiceBackend::IsPlaying(uint32_t slot)
+    {
+        return m_instances[slot] && m_instances[slot]->GetState() == DirectX::PLAYING;
+    }
+
+    void XAudioSoundVoiceBackend::SetSpatial(uint32_t slot, float volume, float pan, float pitch)
+    {
+        auto& inst = m_instances[slot];
+        if (!inst) return;
+        inst->SetVolume(volume);
+        inst->SetPan(pan);
+        inst->SetPitch(pitch);
+    }
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+#include "SoundVoicePool.h"
+
+namespace SpookyAdulthood
+{
+    // one SoundEffectInstance per slot, recreated when the slot changes sfx
+    class XAudioSoundVoiceBackend : public SoundVoiceBackend
+    {
+    public:
+        XAudioSoundVoiceBackend(const std::vector<DirectX::SoundEffect*>& effects, uint32_t slots);
+        virtual void Play(uint32_t slot, uint32_t sfx, float volume, float pitch, bool loop) override;
+        virtual void Stop(uint32_t slot) override;
+        virtual void SetVolume(uint32_t slot, float volume) override;
+        virtual void SetPitch(uint32_t slot, float pitch) override;
+        virtual void Pause(uint32_t slot) override;
+        virtual void Resume(uint32_t slot) override;
+        virtual bool IsPlaying(uint32_t slot) override;
+        virtual void SetSpatial(uint32_t slot, float volume, float pan, float pitch) override;
+
+    private:
+        std::vector<DirectX::SoundEffect*> m_effects;
+        std::vector<std::unique_ptr<DirectX::SoundEffectInstance>> m_instances;
+        std::vector<uint32_t> m_instanceSfx;
+    };
+}
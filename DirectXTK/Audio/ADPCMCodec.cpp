@@ -0,0 +1,402 @@
+//--------------------------------------------------------------------------------------
+// File: ADPCMCodec.cpp
+//
+// Microsoft ADPCM block encoder and decoder (standard 7 coefficient sets)
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//-------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "ADPCMCodec.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <memory>
+
+using namespace DirectX;
+
+
+const short ADPCM::g_Coefficients1[ ADPCM::NUM_COEFFICIENTS ] = { 256,  512, 0, 192, 240,  460,  392 };
+const short ADPCM::g_Coefficients2[ ADPCM::NUM_COEFFICIENTS ] = {   0, -256, 0,  64,   0, -208, -232 };
+
+namespace
+{
+    const int c_AdaptationTable[ 16 ] =
+    {
+        230, 230, 230, 230, 307, 409, 512, 614,
+        768, 614, 512, 409, 307, 230, 230, 230
+    };
+
+    const int c_MinDelta = 16;
+    const int c_MaxDelta = INT32_MAX / 768; // keeps every product below in 32 bits
+
+    inline int16_t ReadInt16( const uint8_t* p )
+    {
+        return int16_t( p[0] | ( p[1] << 8 ) );
+    }
+
+    inline void WriteInt16( uint8_t* p, int value )
+    {
+        p[0] = uint8_t( value & 0xff );
+        p[1] = uint8_t( ( value >> 8 ) & 0xff );
+    }
+
+    inline int Clamp16( int value )
+    {
+        return std::min( 32767, std::max( -32768, value ) );
+    }
+
+    inline int AdaptDelta( int delta, int nibble )
+    {
+        delta = ( c_AdaptationTable[ nibble ] * delta ) >> 8;
+        return std::min( c_MaxDelta, std::max( c_MinDelta, delta ) );
+    }
+
+    // Frames held by a block of 'bytes' bytes
+    inline size_t BlockFrames( size_t bytes, int channels )
+    {
+        const size_t header = size_t( ADPCM::HEADER_LENGTH * channels );
+        return ( bytes < header ) ? 0 : 2 + ( ( bytes - header ) * 2 ) / size_t( channels );
+    }
+
+    struct ChannelState
+    {
+        int coef1;
+        int coef2;
+        int delta;
+        int sample1;
+        int sample2;
+    };
+
+    void ReadHeader( const uint8_t* block, int channels, int channel, ChannelState& state )
+    {
+        const int predictor = std::min<int>( block[ channel ], ADPCM::NUM_COEFFICIENTS - 1 );
+        state.coef1 = ADPCM::g_Coefficients1[ predictor ];
+        state.coef2 = ADPCM::g_Coefficients2[ predictor ];
+        state.delta = std::min( c_MaxDelta, std::max<int>( c_MinDelta, ReadInt16( block + channels + channel * 2 ) ) );
+        state.sample1 = ReadInt16( block + channels * 3 + channel * 2 );
+        state.sample2 = ReadInt16( block + channels * 5 + channel * 2 );
+    }
+
+    void DecodeBlock( const uint8_t* block, size_t frames, int channels, int16_t* output )
+    {
+        ChannelState state[2];
+        for( int c = 0; c < channels; ++c )
+        {
+            ReadHeader( block, channels, c, state[c] );
+            output[ c ] = int16_t( state[c].sample2 );
+            output[ channels + c ] = int16_t( state[c].sample1 );
+        }
+
+        const uint8_t* nibbles = block + ADPCM::HEADER_LENGTH * channels;
+        const size_t count = ( frames - 2 ) * size_t( channels );
+        int16_t* out = output + 2 * channels;
+        for( size_t k = 0; k < count; ++k )
+        {
+            auto& s = state[ k % channels ];
+            const int nibble = ( k & 1 ) ? ( nibbles[ k >> 1 ] & 0xf ) : ( nibbles[ k >> 1 ] >> 4 );
+            const int predict = ( s.sample1 * s.coef1 + s.sample2 * s.coef2 ) >> 8;
+            const int sample = Clamp16( predict + ( ( nibble ^ 8 ) - 8 ) * s.delta );
+            s.delta = AdaptDelta( s.delta, nibble );
+            s.sample2 = s.sample1;
+            s.sample1 = sample;
+            out[ k ] = int16_t( sample );
+        }
+    }
+
+    // Encodes one channel of a block with the given predictor, returns the squared error.
+    // Nibbles are written when 'nibbles' is not null.
+    int64_t EncodeChannel( const int16_t* pcm, size_t frames, int channels, int channel, int predictor, int delta, uint8_t* nibbles, int* finalDelta )
+    {
+        ChannelState s;
+        s.coef1 = ADPCM::g_Coefficients1[ predictor ];
+        s.coef2 = ADPCM::g_Coefficients2[ predictor ];
+        s.delta = delta;
+        s.sample2 = pcm[ channel ];
+        s.sample1 = pcm[ channels + channel ];
+
+        int64_t error = 0;
+        for( size_t f = 2; f < frames; ++f )
+        {
+            const int target = pcm[ f * channels + channel ];
+            const int predict = ( s.sample1 * s.coef1 + s.sample2 * s.coef2 ) >> 8;
+            const int residual = target - predict;
+
+            // round to nearest step
+            int q = ( residual + ( ( residual < 0 ) ? -( s.delta >> 1 ) : ( s.delta >> 1 ) ) ) / s.delta;
+            q = std::min( 7, std::max( -8, q ) );
+
+            const int nibble = q & 0xf;
+            const int sample = Clamp16( predict + q * s.delta );
+            const int64_t diff = int64_t( target - sample );
+            error += diff * diff;
+
+            if ( nibbles )
+            {
+                const size_t k = ( f - 2 ) * channels + channel;
+                if ( k & 1 )
+                    nibbles[ k >> 1 ] |= uint8_t( nibble );
+                else
+                    nibbles[ k >> 1 ] |= uint8_t( nibble << 4 );
+            }
+
+            s.delta = AdaptDelta( s.delta, nibble );
+            s.sample2 = s.sample1;
+            s.sample1 = sample;
+        }
+
+        if ( finalDelta )
+            *finalDelta = s.delta;
+
+        return error;
+    }
+
+#if defined(_XM_SSE_INTRINSICS_)
+    // Low 32 bits of a 32x32 multiply per lane (SSE2 has no pmulld)
+    inline __m128i MulLo32( __m128i a, __m128i b )
+    {
+        const __m128i even = _mm_mul_epu32( a, b );
+        const __m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+        return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE(0, 0, 2, 0) ), _mm_shuffle_epi32( odd, _MM_SHUFFLE(0, 0, 2, 0) ) );
+    }
+
+    inline __m128i Select( __m128i mask, __m128i a, __m128i b )
+    {
+        return _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) );
+    }
+
+    // Decodes four full blocks' channels at once: lane j is channel (j % channels) of block (j / channels).
+    // Nibbles and results go through transposed scratch buffers so each step is one vector per field.
+    void DecodeLanes( const uint8_t* blocks, size_t blockAlign, size_t frames, int channels, int16_t* output, uint8_t* nibbleScratch, int16_t* sampleScratch )
+    {
+        const size_t steps = frames - 2;
+
+        ChannelState state[4];
+        for( int j = 0; j < 4; ++j )
+        {
+            const uint8_t* block = blocks + ( j / channels ) * blockAlign;
+            const int c = j % channels;
+            ReadHeader( block, channels, c, state[j] );
+
+            int16_t* out = output + ( j / channels ) * frames * channels;
+            out[ c ] = int16_t( state[j].sample2 );
+            out[ channels + c ] = int16_t( state[j].sample1 );
+
+            const uint8_t* nibbles = block + ADPCM::HEADER_LENGTH * channels;
+            for( size_t i = 0; i < steps; ++i )
+            {
+                const size_t k = i * channels + c;
+                nibbleScratch[ i * 4 + j ] = ( k & 1 ) ? ( nibbles[ k >> 1 ] & 0xf ) : ( nibbles[ k >> 1 ] >> 4 );
+            }
+        }
+
+        // (sample1, sample2) and (coef1, coef2) as 16-bit pairs so pmaddwd gives the prediction
+        __m128i sample1 = _mm_setr_epi32( state[0].sample1, state[1].sample1, state[2].sample1, state[3].sample1 );
+        __m128i sample2 = _mm_setr_epi32( state[0].sample2, state[1].sample2, state[2].sample2, state[3].sample2 );
+        __m128i delta = _mm_setr_epi32( state[0].delta, state[1].delta, state[2].delta, state[3].delta );
+        const __m128i coefs = _mm_setr_epi16( short( state[0].coef1 ), short( state[0].coef2 ), short( state[1].coef1 ), short( state[1].coef2 ),
+                                              short( state[2].coef1 ), short( state[2].coef2 ), short( state[3].coef1 ), short( state[3].coef2 ) );
+        const __m128i low16 = _mm_set1_epi32( 0xffff );
+        const __m128i eight = _mm_set1_epi32( 8 );
+        const __m128i minDelta = _mm_set1_epi32( c_MinDelta );
+        const __m128i maxDelta = _mm_set1_epi32( c_MaxDelta );
+        const __m128i zero = _mm_setzero_si128();
+
+        for( size_t i = 0; i < steps; ++i )
+        {
+            const uint32_t packed = *reinterpret_cast<const uint32_t*>( nibbleScratch + i * 4 );
+            const __m128i nibble = _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_cvtsi32_si128( int( packed ) ), zero ), zero );
+            const __m128i adapt = _mm_setr_epi32( c_AdaptationTable[ packed & 0xf ], c_AdaptationTable[ ( packed >> 8 ) & 0xf ],
+                                                  c_AdaptationTable[ ( packed >> 16 ) & 0xf ], c_AdaptationTable[ packed >> 24 ] );
+
+            const __m128i pairs = _mm_or_si128( _mm_and_si128( sample1, low16 ), _mm_slli_epi32( sample2, 16 ) );
+            const __m128i predict = _mm_srai_epi32( _mm_madd_epi16( pairs, coefs ), 8 );
+            const __m128i step = MulLo32( _mm_sub_epi32( _mm_xor_si128( nibble, eight ), eight ), delta );
+
+            // saturate to 16 bits and sign extend back
+            const __m128i packedSample = _mm_packs_epi32( _mm_add_epi32( predict, step ), zero );
+            const __m128i sample = _mm_srai_epi32( _mm_unpacklo_epi16( packedSample, packedSample ), 16 );
+            _mm_storel_epi64( reinterpret_cast<__m128i*>( sampleScratch + i * 4 ), packedSample );
+
+            delta = _mm_srai_epi32( MulLo32( adapt, delta ), 8 );
+            delta = Select( _mm_cmpgt_epi32( delta, minDelta ), delta, minDelta );
+            delta = Select( _mm_cmpgt_epi32( delta, maxDelta ), maxDelta, delta );
+
+            sample2 = sample1;
+            sample1 = sample;
+        }
+
+        for( int j = 0; j < 4; ++j )
+        {
+            int16_t* out = output + ( j / channels ) * frames * channels + 2 * channels + ( j % channels );
+            for( size_t i = 0; i < steps; ++i )
+                out[ i * channels ] = sampleScratch[ i * 4 + j ];
+        }
+    }
+#endif
+}
+
+
+size_t ADPCM::BlockAlign( int channels, int samplesPerBlock )
+{
+    return size_t( HEADER_LENGTH * channels + ( samplesPerBlock - 2 ) * channels / 2 );
+}
+
+
+size_t ADPCM::EncodedSize( size_t frames, int channels, int samplesPerBlock )
+{
+    const size_t blocks = frames / samplesPerBlock;
+    size_t remainder = frames % samplesPerBlock;
+    size_t bytes = blocks * BlockAlign( channels, samplesPerBlock );
+    if ( remainder )
+    {
+        remainder = std::max<size_t>( remainder, 2 );
+        bytes += HEADER_LENGTH * channels + ( ( remainder - 2 ) * channels + 1 ) / 2;
+    }
+    return bytes;
+}
+
+
+size_t ADPCM::DecodedFrames( size_t bytes, int channels, int samplesPerBlock )
+{
+    const size_t blockAlign = BlockAlign( channels, samplesPerBlock );
+    return ( bytes / blockAlign ) * samplesPerBlock + BlockFrames( bytes % blockAlign, channels );
+}
+
+
+_Use_decl_annotations_
+size_t ADPCM::Encode( const int16_t* pcm, size_t frames, int channels, int samplesPerBlock, uint8_t* output )
+{
+    assert( channels == 1 || channels == 2 );
+    assert( samplesPerBlock >= 4 && ( channels == 2 || !( samplesPerBlock & 1 ) ) );
+
+    int delta[2] = { c_MinDelta, c_MinDelta };
+    int16_t tail[2 * 2];
+
+    uint8_t* out = output;
+    for( size_t first = 0; first < frames; first += samplesPerBlock )
+    {
+        size_t count = std::min<size_t>( samplesPerBlock, frames - first );
+        const int16_t* block = pcm + first * channels;
+        if ( count < 2 )
+        {
+            // a block always carries two raw frames
+            for( int c = 0; c < channels; ++c )
+                tail[c] = tail[ channels + c ] = block[c];
+            block = tail;
+            count = 2;
+        }
+
+        const size_t blockBytes = HEADER_LENGTH * channels + ( ( count - 2 ) * channels + 1 ) / 2;
+        memset( out, 0, blockBytes );
+
+        for( int c = 0; c < channels; ++c )
+        {
+            // keep the coefficient set with the least error, the step size carries over between blocks
+            int best = 0;
+            int64_t bestError = INT64_MAX;
+            for( int p = 0; p < NUM_COEFFICIENTS; ++p )
+            {
+                const int64_t error = EncodeChannel( block, count, channels, c, p, delta[c], nullptr, nullptr );
+                if ( error < bestError )
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+
+            out[ c ] = uint8_t( best );
+            WriteInt16( out + channels + c * 2, delta[c] );
+            WriteInt16( out + channels * 3 + c * 2, block[ channels + c ] );
+            WriteInt16( out + channels * 5 + c * 2, block[ c ] );
+            (void)EncodeChannel( block, count, channels, c, best, delta[c], out + HEADER_LENGTH * channels, &delta[c] );
+            delta[c] = std::min( delta[c], 0x7fff ); // the header field is 16 bits
+        }
+
+        out += blockBytes;
+    }
+
+    assert( size_t( out - output ) == EncodedSize( frames, channels, samplesPerBlock ) );
+    return size_t( out - output );
+}
+
+
+_Use_decl_annotations_
+size_t ADPCM::DecodeScalar( const uint8_t* data, size_t bytes, int channels, int samplesPerBlock, int16_t* output )
+{
+    const size_t blockAlign = BlockAlign( channels, samplesPerBlock );
+
+    size_t total = 0;
+    for( size_t offset = 0; offset < bytes; offset += blockAlign )
+    {
+        const size_t frames = BlockFrames( std::min( blockAlign, bytes - offset ), channels );
+        if ( frames < 2 )
+            break;
+
+        DecodeBlock( data + offset, frames, channels, output + total * channels );
+        total += frames;
+    }
+
+    return total;
+}
+
+
+_Use_decl_annotations_
+size_t ADPCM::Decode( const uint8_t* data, size_t bytes, int channels, int samplesPerBlock, int16_t* output )
+{
+#if defined(_XM_SSE_INTRINSICS_)
+    const size_t blockAlign = BlockAlign( channels, samplesPerBlock );
+    const size_t blocksPerGroup = 4 / channels;
+    const size_t groups = ( bytes / blockAlign ) / blocksPerGroup;
+
+    size_t total = 0;
+    if ( groups > 0 && samplesPerBlock > 2 )
+    {
+        const size_t steps = samplesPerBlock - 2;
+        std::unique_ptr<uint8_t[]> nibbleScratch( new uint8_t[ steps * 4 ] );
+        std::unique_ptr<int16_t[]> sampleScratch( new int16_t[ steps * 4 ] ); // movq stores, no alignment needed
+
+        for( size_t g = 0; g < groups; ++g )
+        {
+            DecodeLanes( data + g * blocksPerGroup * blockAlign, blockAlign, samplesPerBlock, channels,
+                         output + total * channels, nibbleScratch.get(), sampleScratch.get() );
+            total += blocksPerGroup * samplesPerBlock;
+        }
+    }
+
+    // leftover full blocks and the partial last block
+    const size_t consumed = groups * blocksPerGroup * blockAlign;
+    return total + DecodeScalar( data + consumed, bytes - consumed, channels, samplesPerBlock, output + total * channels );
+#else
+    return DecodeScalar( data, bytes, channels, samplesPerBlock, output );
+#endif
+}
+
+
+_Use_decl_annotations_
+float ADPCM::SignalToNoise( const int16_t* reference, const int16_t* test, size_t samples )
+{
+    double signal = 0.0;
+    double noise = 0.0;
+    for( size_t j = 0; j < samples; ++j )
+    {
+        const double r = reference[ j ];
+        const double d = r - double( test[ j ] );
+        signal += r * r;
+        noise += d * d;
+    }
+
+    if ( noise <= 0.0 )
+        return 144.f; // past the dynamic range of 16-bit audio
+
+    return float( 10.0 * log10( std::max( signal, 1.0 ) / noise ) );
+}
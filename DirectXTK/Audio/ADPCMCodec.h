@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------------
+// File: ADPCMCodec.h
+//
+// Microsoft ADPCM block encoder and decoder (standard 7 coefficient sets)
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace DirectX
+{
+    namespace ADPCM
+    {
+        const int HEADER_LENGTH = 7;            // Bytes of block header per channel
+        const int NUM_COEFFICIENTS = 7;
+        const int DEFAULT_SAMPLES_PER_BLOCK = 512;
+
+        extern const short g_Coefficients1[ NUM_COEFFICIENTS ];
+        extern const short g_Coefficients2[ NUM_COEFFICIENTS ];
+
+        // Bytes of one full block
+        size_t BlockAlign( int channels, int samplesPerBlock );
+
+        // Bytes needed to encode 'frames' frames; the last block is shortened rather than padded
+        size_t EncodedSize( size_t frames, int channels, int samplesPerBlock );
+
+        // Frames held by 'bytes' of encoded data (the last block may be partial)
+        size_t DecodedFrames( size_t bytes, int channels, int samplesPerBlock );
+
+        // 16-bit interleaved PCM to ADPCM, 1 or 2 channels; each block keeps the coefficient set
+        // with the least squared error. Returns the bytes written (EncodedSize)
+        size_t Encode( _In_reads_(frames * channels) const int16_t* pcm, size_t frames, int channels, int samplesPerBlock,
+                       _Out_writes_bytes_(EncodedSize(frames, channels, samplesPerBlock)) uint8_t* output );
+
+        // ADPCM to 16-bit interleaved PCM. Decode runs four blocks (or channels) in lockstep in SIMD
+        // lanes and matches DecodeScalar bit for bit. Both return the frames written (DecodedFrames)
+        size_t Decode( _In_reads_bytes_(bytes) const uint8_t* data, size_t bytes, int channels, int samplesPerBlock,
+                       _Out_writes_(DecodedFrames(bytes, channels, samplesPerBlock) * channels) int16_t* output );
+
+        size_t DecodeScalar( _In_reads_bytes_(bytes) const uint8_t* data, size_t bytes, int channels, int samplesPerBlock,
+                             _Out_writes_(DecodedFrames(bytes, channels, samplesPerBlock) * channels) int16_t* output );
+
+        // Signal to noise ratio of 'test' against 'reference', in dB (large when identical)
+        float SignalToNoise( _In_reads_(samples) const int16_t* reference, _In_reads_(samples) const int16_t* test, size_t samples );
+    }
+}
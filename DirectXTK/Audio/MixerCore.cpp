@@ -0,0 +1,568 @@
+//--------------------------------------------------------------------------------------
+// File: MixerCore.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "MixerCore.h"
+
+#include <math.h>
+#include <stdexcept>
+
+using namespace DirectX;
+using namespace DirectX::Mixer;
+
+
+namespace
+{
+    inline size_t SampleBytes( SampleFormat format )
+    {
+        switch( format )
+        {
+        case SAMPLE_PCM8:   return 1;
+        case SAMPLE_PCM16:  return 2;
+        default:            return 4;
+        }
+    }
+
+    inline float SampleToFloat( const uint8_t* data, SampleFormat format, size_t index )
+    {
+        switch( format )
+        {
+        case SAMPLE_PCM8:   return ( float( data[ index ] ) - 128.f ) * ( 1.f / 128.f );
+        case SAMPLE_PCM16:  return float( reinterpret_cast<const int16_t*>( data )[ index ] ) * ( 1.f / 32768.f );
+        default:            return reinterpret_cast<const float*>( data )[ index ];
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+void DirectX::Mixer::ComputeGains( float volume, float pan, int channels, float* gains )
+{
+    // The only copy of the pan law, DirectX::ComputePan builds the XAudio2 matrix from it
+    if ( channels == 1 )
+    {
+        // mono sources are mixed as stereo with the same buffer on both inputs
+        const float left = std::max( -1.f, std::min( 1.f, ( pan >= 0 ) ? ( 1.f - pan ) : 1.f ) );
+        const float right = std::max( -1.f, std::min( 1.f, ( pan <= 0 ) ? ( pan + 1.f ) : 1.f ) );
+        gains[0] = left * volume;
+        gains[1] = 0.f;
+        gains[2] = right * volume;
+        gains[3] = 0.f;
+    }
+    else if ( -1.f <= pan && pan <= 0.f )
+    {
+        gains[0] = ( .5f * pan + 1.f ) * volume;    // .5 when pan is -1, 1 when pan is 0
+        gains[1] = ( .5f * -pan ) * volume;         // .5 when pan is -1, 0 when pan is 0
+        gains[2] = 0.f;                             //  0 when pan is -1, 0 when pan is 0
+        gains[3] = ( pan + 1.f ) * volume;          //  0 when pan is -1, 1 when pan is 0
+    }
+    else
+    {
+        gains[0] = ( -pan + 1.f ) * volume;         //  1 when pan is 0,   0 when pan is 1
+        gains[1] = 0.f;                             //  0 when pan is 0,   0 when pan is 1
+        gains[2] = ( .5f * pan ) * volume;          //  0 when pan is 0, .5f when pan is 1
+        gains[3] = ( .5f * -pan + 1.f ) * volume;   //  1 when pan is 0. .5f when pan is 1
+    }
+}
+
+
+_Use_decl_annotations_
+void DirectX::Mixer::MixStereo( float* out, const float* left, const float* right, size_t count, const float* g0, const float* g1 )
+{
+    if ( !count )
+        return;
+
+    const float inv = 1.f / float( count );
+    const float d[4] = { ( g1[0] - g0[0] ) * inv, ( g1[1] - g0[1] ) * inv, ( g1[2] - g0[2] ) * inv, ( g1[3] - g0[3] ) * inv };
+    size_t i = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+    const __m128 ramp = _mm_setr_ps( 0.f, 1.f, 2.f, 3.f );
+    __m128 gLL = _mm_add_ps( _mm_set1_ps( g0[0] ), _mm_mul_ps( ramp, _mm_set1_ps( d[0] ) ) );
+    __m128 gLR = _mm_add_ps( _mm_set1_ps( g0[1] ), _mm_mul_ps( ramp, _mm_set1_ps( d[1] ) ) );
+    __m128 gRL = _mm_add_ps( _mm_set1_ps( g0[2] ), _mm_mul_ps( ramp, _mm_set1_ps( d[2] ) ) );
+    __m128 gRR = _mm_add_ps( _mm_set1_ps( g0[3] ), _mm_mul_ps( ramp, _mm_set1_ps( d[3] ) ) );
+    const __m128 dLL = _mm_set1_ps( d[0] * 4.f );
+    const __m128 dLR = _mm_set1_ps( d[1] * 4.f );
+    const __m128 dRL = _mm_set1_ps( d[2] * 4.f );
+    const __m128 dRR = _mm_set1_ps( d[3] * 4.f );
+
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const __m128 l = _mm_loadu_ps( left + i );
+        const __m128 r = _mm_loadu_ps( right + i );
+        const __m128 outL = _mm_add_ps( _mm_mul_ps( l, gLL ), _mm_mul_ps( r, gLR ) );
+        const __m128 outR = _mm_add_ps( _mm_mul_ps( l, gRL ), _mm_mul_ps( r, gRR ) );
+
+        float* dst = out + i * 2;
+        _mm_storeu_ps( dst, _mm_add_ps( _mm_loadu_ps( dst ), _mm_unpacklo_ps( outL, outR ) ) );
+        _mm_storeu_ps( dst + 4, _mm_add_ps( _mm_loadu_ps( dst + 4 ), _mm_unpackhi_ps( outL, outR ) ) );
+
+        gLL = _mm_add_ps( gLL, dLL );
+        gLR = _mm_add_ps( gLR, dLR );
+        gRL = _mm_add_ps( gRL, dRL );
+        gRR = _mm_add_ps( gRR, dRR );
+    }
+#endif
+
+    for( ; i < count; ++i )
+    {
+        const float t = float( i );
+        out[ i * 2 ]     += left[ i ] * ( g0[0] + d[0] * t ) + right[ i ] * ( g0[1] + d[1] * t );
+        out[ i * 2 + 1 ] += left[ i ] * ( g0[2] + d[2] * t ) + right[ i ] * ( g0[3] + d[3] * t );
+    }
+}
+
+
+//======================================================================================
+// VoicePool
+//======================================================================================
+
+VoicePool::VoicePool( int sampleRate, size_t maxVoices ) :
+    mSampleRate( sampleRate ),
+    mMasterVolume( 1.f ),
+    mPeakVoices( 0 ),
+    mRenderedFrames( 0 ),
+    mRejectedPlays( 0 ),
+    mStreamUnderruns( 0 )
+{
+    if ( sampleRate < MIN_SAMPLE_RATE || sampleRate > MAX_SAMPLE_RATE )
+        throw std::invalid_argument( "SoftwareMixer sample rate" );
+
+    if ( !maxVoices || maxVoices > 0xffff )
+        throw std::invalid_argument( "SoftwareMixer voice count" );
+
+    mVoices.resize( maxVoices );
+    memset( mVoices.data(), 0, sizeof(Voice) * maxVoices );
+
+    mFree.reserve( maxVoices );
+    for( size_t j = maxVoices; j > 0; --j )
+        mFree.push_back( uint32_t( j - 1 ) );
+
+    mNullSink.reset( new float[ BLOCK_FRAMES * 2 ] );
+    mStaging.resize( maxVoices );
+}
+
+
+VoicePool::Voice* VoicePool::Find( uint32_t handle )
+{
+    const uint32_t index = ( handle & 0xffff ) - 1;
+    if ( !handle || index >= mVoices.size() )
+        return nullptr;
+
+    auto& v = mVoices[ index ];
+    return ( v.active && v.generation == ( handle >> 16 ) ) ? &v : nullptr;
+}
+
+
+const VoicePool::Voice* VoicePool::Find( uint32_t handle ) const
+{
+    return const_cast<VoicePool*>( this )->Find( handle );
+}
+
+
+// Called with mMutex held: a cleared voice with its next generation, nullptr when the pool is full
+VoicePool::Voice* VoicePool::Allocate()
+{
+    if ( mFree.empty() )
+    {
+        ++mRejectedPlays;
+        return nullptr;
+    }
+
+    const uint32_t index = mFree.back();
+    mFree.pop_back();
+
+    auto& v = mVoices[ index ];
+    const uint16_t generation = uint16_t( v.generation + 1 );
+    memset( &v, 0, sizeof(Voice) );
+    v.generation = generation ? generation : 1;
+    v.active = true;
+    v.firstBlock = true;
+
+    mPeakVoices = std::max( mPeakVoices, mVoices.size() - mFree.size() );
+    return &v;
+}
+
+
+uint32_t VoicePool::Handle( const Voice& v ) const
+{
+    return ( uint32_t( v.generation ) << 16 ) | uint32_t( &v - mVoices.data() + 1 );
+}
+
+
+void VoicePool::Release( Voice& v )
+{
+    v.active = false;
+    mFree.push_back( uint32_t( &v - mVoices.data() ) );
+}
+
+
+void VoicePool::UpdateGains( Voice& v )
+{
+    ComputeGains( v.volume * mMasterVolume, v.pan, v.channels, v.gains );
+}
+
+
+_Use_decl_annotations_
+uint32_t VoicePool::Play( SampleFormat format, int channels, uint32_t sourceRate, const uint8_t* data, uint32_t frames,
+                          uint32_t loopBegin, uint32_t loopLength, float volume, float pitch, float pan, bool loop )
+{
+    if ( !data || !frames || channels < 1 || channels > 2 || !sourceRate )
+        throw std::invalid_argument( "SoftwareMixer::Play" );
+
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto voice = Allocate();
+    if ( !voice )
+        return INVALID_VOICE;
+
+    auto& v = *voice;
+    v.data = data;
+    v.frames = frames;
+    v.loopBegin = std::min<uint32_t>( loopBegin, frames - 1 );
+    v.loopEnd = loopLength ? uint32_t( std::min<uint64_t>( uint64_t( v.loopBegin ) + loopLength, frames ) ) : frames;
+    v.channels = channels;
+    v.format = format;
+    v.rateRatio = ( uint64_t( sourceRate ) << 32 ) / uint64_t( mSampleRate );
+    v.volume = volume;
+    v.pitch = pitch;
+    v.pan = pan;
+    v.loop = loop;
+    UpdateGains( v );
+
+    return Handle( v );
+}
+
+
+_Use_decl_annotations_
+uint32_t VoicePool::PlayStream( SampleFormat format, int channels, uint32_t sourceRate, StreamSource* source,
+                                float volume, float pitch, float pan )
+{
+    if ( !source || channels < 1 || channels > 2 || !sourceRate )
+        throw std::invalid_argument( "SoftwareMixer::PlayStream" );
+
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto voice = Allocate();
+    if ( !voice )
+        return INVALID_VOICE;
+
+    auto& v = *voice;
+    auto& staging = mStaging[ &v - mVoices.data() ];
+    if ( !staging )
+        staging.reset( new uint8_t[ STREAM_STAGING_BYTES ] );
+
+    v.data = staging.get();
+    v.stream = source;
+    v.lookahead = 1;
+    v.channels = channels;
+    v.format = format;
+    v.rateRatio = ( uint64_t( sourceRate ) << 32 ) / uint64_t( mSampleRate );
+    v.volume = volume;
+    v.pitch = pitch;
+    v.pan = pan;
+    UpdateGains( v );
+
+    return Handle( v );
+}
+
+
+// Linear interpolating resampler into planar float, returns the number of frames written
+// (less than count only when a non looping voice reaches its end)
+template<SampleFormat format>
+_Use_decl_annotations_
+size_t VoicePool::Resample( Voice& v, float* left, float* right, size_t count, uint64_t step )
+{
+    const uint64_t end = uint64_t( v.loop ? v.loopEnd : v.frames - std::min( v.frames, v.lookahead ) ) << 32;
+    const uint64_t loopBegin = uint64_t( v.loopBegin ) << 32;
+    const uint64_t loopLength = uint64_t( v.loopEnd - v.loopBegin ) << 32;
+    const int channels = v.channels;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        if ( v.position >= end )
+        {
+            if ( !v.loop || !loopLength )
+                return i;
+            // a step can be longer than the whole loop (short loops pitched up)
+            v.position = loopBegin + ( v.position - end ) % loopLength;
+        }
+
+        const size_t index = size_t( v.position >> 32 );
+        const float frac = float( uint32_t( v.position ) ) * ( 1.f / 4294967296.f );
+        size_t next = index + 1;
+        if ( next >= v.frames || ( v.loop && next >= v.loopEnd ) )
+            next = v.loop ? v.loopBegin : index;
+
+        const float a0 = SampleToFloat( v.data, format, index * channels );
+        const float b0 = SampleToFloat( v.data, format, next * channels );
+        left[ i ] = a0 + ( b0 - a0 ) * frac;
+        if ( channels > 1 )
+        {
+            const float a1 = SampleToFloat( v.data, format, index * channels + 1 );
+            const float b1 = SampleToFloat( v.data, format, next * channels + 1 );
+            right[ i ] = a1 + ( b1 - a1 ) * frac;
+        }
+
+        v.position += step;
+    }
+
+    return count;
+}
+
+
+// Streamed voices resample from their staging buffer, topped up from the source until the
+// block is done; a source that has nothing yet pads the block with silence (an underrun)
+template<SampleFormat format>
+_Use_decl_annotations_
+size_t VoicePool::ResampleStream( Voice& v, float* left, float* right, size_t count, uint64_t step )
+{
+    const size_t frameBytes = SampleBytes( format ) * v.channels;
+    uint8_t* staging = mStaging[ &v - mVoices.data() ].get();
+
+    size_t done = 0;
+    for(;;)
+    {
+        // drop the frames played past, keeping the one being interpolated from
+        const uint32_t passed = uint32_t( std::min<uint64_t>( v.position >> 32, v.frames ) );
+        if ( passed )
+        {
+            const size_t passedBytes = passed * frameBytes;
+            memmove( staging, staging + passedBytes, v.streamBytes - passedBytes );
+            v.streamBytes -= uint32_t( passedBytes );
+            v.position -= uint64_t( passed ) << 32;
+        }
+
+        const size_t got = v.stream->Read( staging + v.streamBytes, STREAM_STAGING_BYTES - v.streamBytes );
+        v.streamBytes += uint32_t( got );
+        v.frames = uint32_t( v.streamBytes / frameBytes );
+
+        // the last frame staged is held back until the one after it arrives to interpolate towards
+        const bool ended = v.stream->IsEndOfStream();
+        v.lookahead = ended ? 0 : 1;
+
+        done += Resample<format>( v, left + done, right + done, count - done, step );
+        if ( done == count || ended )
+            return done;
+
+        if ( !got )
+        {
+            ++mStreamUnderruns;
+            std::fill( left + done, left + count, 0.f );
+            std::fill( right + done, right + count, 0.f );
+            return count;
+        }
+    }
+}
+
+
+_Use_decl_annotations_
+void VoicePool::Render( float* output, size_t frames )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    float left[ BLOCK_FRAMES ];
+    float right[ BLOCK_FRAMES ];
+
+    for( size_t offset = 0; offset < frames; offset += BLOCK_FRAMES )
+    {
+        const size_t count = std::min( BLOCK_FRAMES, frames - offset );
+        float* out = output ? output + offset * 2 : mNullSink.get();
+        memset( out, 0, sizeof(float) * count * 2 );
+
+        for( auto& v : mVoices )
+        {
+            if ( !v.active || v.paused )
+                continue;
+
+            // pitch is in octaves, XAudio2SemitonesToFrequencyRatio( pitch * 12 )
+            const uint64_t step = uint64_t( double( v.rateRatio ) * double( powf( 2.f, v.pitch ) ) );
+
+            size_t done;
+            if ( v.stream )
+            {
+                switch( v.format )
+                {
+                case SAMPLE_PCM8:   done = ResampleStream<SAMPLE_PCM8>( v, left, right, count, step ); break;
+                case SAMPLE_PCM16:  done = ResampleStream<SAMPLE_PCM16>( v, left, right, count, step ); break;
+                default:            done = ResampleStream<SAMPLE_FLOAT>( v, left, right, count, step ); break;
+                }
+            }
+            else
+            {
+                switch( v.format )
+                {
+                case SAMPLE_PCM8:   done = Resample<SAMPLE_PCM8>( v, left, right, count, step ); break;
+                case SAMPLE_PCM16:  done = Resample<SAMPLE_PCM16>( v, left, right, count, step ); break;
+                default:            done = Resample<SAMPLE_FLOAT>( v, left, right, count, step ); break;
+                }
+            }
+
+            // new voices start at their gains, later changes are ramped over one block
+            if ( v.firstBlock )
+            {
+                memcpy( v.lastGains, v.gains, sizeof(v.gains) );
+                v.firstBlock = false;
+            }
+            MixStereo( out, left, ( v.channels > 1 ) ? right : left, done, v.lastGains, v.gains );
+            memcpy( v.lastGains, v.gains, sizeof(v.gains) );
+
+            if ( done < count )
+                Release( v );
+        }
+    }
+
+    mRenderedFrames += frames;
+}
+
+
+void VoicePool::Stop( uint32_t voice )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    if ( v )
+        Release( *v );
+}
+
+
+void VoicePool::StopAll()
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    for( auto& v : mVoices )
+    {
+        if ( v.active )
+            Release( v );
+    }
+}
+
+
+_Use_decl_annotations_
+size_t VoicePool::StopSource( const uint8_t* data )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    size_t stopped = 0;
+    for( auto& v : mVoices )
+    {
+        if ( v.active && v.data == data )
+        {
+            Release( v );
+            ++stopped;
+        }
+    }
+    return stopped;
+}
+
+
+void VoicePool::Pause( uint32_t voice )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    if ( v )
+        v->paused = true;
+}
+
+
+void VoicePool::Resume( uint32_t voice )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    if ( v )
+        v->paused = false;
+}
+
+
+void VoicePool::SetVolume( uint32_t voice, float volume )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    if ( v )
+    {
+        v->volume = volume;
+        UpdateGains( *v );
+    }
+}
+
+
+void VoicePool::SetPitch( uint32_t voice, float pitch )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    if ( v )
+        v->pitch = pitch;
+}
+
+
+void VoicePool::SetPan( uint32_t voice, float pan )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    if ( v )
+    {
+        v->pan = pan;
+        UpdateGains( *v );
+    }
+}
+
+
+bool VoicePool::IsPlaying( uint32_t voice ) const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    auto v = Find( voice );
+    return v && !v->paused;
+}
+
+
+float VoicePool::GetMasterVolume() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    return mMasterVolume;
+}
+
+
+void VoicePool::SetMasterVolume( float volume )
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    mMasterVolume = volume;
+    for( auto& v : mVoices )
+    {
+        if ( v.active )
+            UpdateGains( v );
+    }
+}
+
+
+Statistics VoicePool::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    Statistics stats;
+    stats.activeVoices = mVoices.size() - mFree.size();
+    stats.peakVoices = mPeakVoices;
+    stats.maxVoices = mVoices.size();
+    stats.rejectedPlays = mRejectedPlays;
+    stats.renderedFrames = mRenderedFrames;
+    stats.streamUnderruns = mStreamUnderruns;
+    return stats;
+}
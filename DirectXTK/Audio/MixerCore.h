@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------------------
+// File: MixerCore.h
+//
+// Device independent voice mixing used by SoftwareMixer: resampling, panning and the
+// voice pool, with no XAudio2 or Windows types so it builds and is tested anywhere
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace Mixer
+    {
+        const int MIN_SAMPLE_RATE = 1000;       // XAUDIO2_MIN_SAMPLE_RATE
+        const int MAX_SAMPLE_RATE = 200000;     // XAUDIO2_MAX_SAMPLE_RATE
+        const uint32_t INVALID_VOICE = 0;
+        const size_t BLOCK_FRAMES = 256;        // Frames resampled per voice before mixing
+        const size_t STREAM_STAGING_BYTES = 16384;  // Source data held per streamed voice between pulls
+
+        enum SampleFormat
+        {
+            SAMPLE_PCM8 = 0,
+            SAMPLE_PCM16,
+            SAMPLE_FLOAT,
+        };
+
+        struct Statistics
+        {
+            size_t      activeVoices;
+            size_t      peakVoices;
+            size_t      maxVoices;
+            size_t      rejectedPlays;
+            uint64_t    renderedFrames;
+            size_t      streamUnderruns;    // Blocks a streamed voice padded with silence because its source had nothing yet
+        };
+
+        // Pull source of a streamed voice, read from the render thread with the pool locked, so
+        // Read must not block: it copies what is already in memory and returns fewer bytes
+        // (possibly none) when the rest hasn't arrived yet
+        class StreamSource
+        {
+        public:
+            virtual ~StreamSource() {}
+
+            virtual size_t Read( _Out_writes_bytes_to_(maxBytes, return) uint8_t* dest, size_t maxBytes ) = 0;
+            virtual bool IsEndOfStream() const = 0;
+        };
+
+        // Output gains (LL LR RL RR) of a mono or stereo source scaled by volume, the pan law
+        // DirectX::ComputePan also builds the XAudio2 matrices from
+        void ComputeGains( float volume, float pan, int channels, _Out_writes_(4) float* gains );
+
+        // Adds a planar stereo block to interleaved stereo output through a 2x2 matrix,
+        // ramping the matrix from g0 to g1 across the block to avoid zipper noise
+        void MixStereo( _Inout_updates_(count * 2) float* out, _In_reads_(count) const float* left, _In_reads_(count) const float* right,
+                        size_t count, _In_reads_(4) const float* g0, _In_reads_(4) const float* g1 );
+
+        // Fixed size pool of voices reading interleaved mono/stereo sample data, rendered into
+        // interleaved stereo float. Volume, pitch (-1..1 octaves) and pan match SoundEffectInstance.
+        // Every method is thread safe.
+        class VoicePool
+        {
+        public:
+            VoicePool( int sampleRate, size_t maxVoices );
+
+            VoicePool(VoicePool const&) = delete;
+            VoicePool& operator= (VoicePool const&) = delete;
+
+            uint32_t Play( SampleFormat format, int channels, uint32_t sourceRate,
+                           _In_ const uint8_t* data, uint32_t frames, uint32_t loopBegin, uint32_t loopLength,
+                           float volume, float pitch, float pan, bool loop );
+                // Returns the voice handle, INVALID_VOICE when the pool is full. data is referenced, not copied
+
+            uint32_t PlayStream( SampleFormat format, int channels, uint32_t sourceRate, _In_ StreamSource* source,
+                                 float volume, float pitch, float pan );
+                // Plays interleaved sample data pulled from source as it renders, until the source
+                // reaches its end; source is referenced and must outlive the voice
+
+            void Stop( uint32_t voice );
+            void StopAll();
+            size_t StopSource( _In_ const uint8_t* data );
+                // Stops the voices reading from data (so it can be freed), returns how many
+            void Pause( uint32_t voice );
+            void Resume( uint32_t voice );
+
+            void SetVolume( uint32_t voice, float volume );
+            void SetPitch( uint32_t voice, float pitch );
+            void SetPan( uint32_t voice, float pan );
+            bool IsPlaying( uint32_t voice ) const;
+
+            float GetMasterVolume() const;
+            void SetMasterVolume( float volume );
+
+            void Render( _Out_writes_opt_(frames * 2) float* output, size_t frames );
+                // A null output renders into a null sink (same cost, voices advance)
+
+            int GetSampleRate() const { return mSampleRate; }
+            size_t GetMaxVoices() const { return mVoices.size(); }
+            Statistics GetStatistics() const;
+
+        private:
+            struct Voice
+            {
+                const uint8_t*  data;
+                uint32_t        frames;
+                uint32_t        loopBegin;
+                uint32_t        loopEnd;
+                int             channels;
+                SampleFormat    format;
+                uint64_t        position;   // 32.32 fixed point, in source frames
+                uint64_t        rateRatio;  // source rate / output rate, 32.32 fixed point
+                float           volume;
+                float           pitch;
+                float           pan;
+                float           gains[4];   // LL LR RL RR, volume and pan applied
+                float           lastGains[4];
+                StreamSource*   stream;     // streamed voices: data is the staging buffer, frames what it holds
+                uint32_t        streamBytes;
+                uint32_t        lookahead;  // frames at the end of data not played until the next pull
+                uint16_t        generation;
+                bool            active;
+                bool            paused;
+                bool            loop;
+                bool            firstBlock;
+            };
+
+            Voice* Find( uint32_t handle );
+            const Voice* Find( uint32_t handle ) const;
+            Voice* Allocate();
+            uint32_t Handle( const Voice& v ) const;
+            void Release( Voice& v );
+            void UpdateGains( Voice& v );
+
+            template<SampleFormat format>
+            static size_t Resample( Voice& v, _Out_writes_(count) float* left, _Out_writes_(count) float* right, size_t count, uint64_t step );
+
+            template<SampleFormat format>
+            size_t ResampleStream( Voice& v, _Out_writes_(count) float* left, _Out_writes_(count) float* right, size_t count, uint64_t step );
+
+            int                         mSampleRate;
+            float                       mMasterVolume;
+            size_t                      mPeakVoices;
+            uint64_t                    mRenderedFrames;
+            size_t                      mRejectedPlays;
+            size_t                      mStreamUnderruns;
+            std::vector<Voice>          mVoices;
+            std::vector<uint32_t>       mFree;
+            std::unique_ptr<float[]>    mNullSink;
+            std::vector<std::unique_ptr<uint8_t[]>> mStaging;   // per voice, allocated on its first stream
+            mutable std::mutex          mMutex;
+        };
+    }
+}
@@ -0,0 +1,296 @@
+//--------------------------------------------------------------------------------------
+// File: PacketStream.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "PacketStream.h"
+
+#include <stdexcept>
+
+using namespace DirectX;
+using namespace DirectX::Streaming;
+
+
+_Use_decl_annotations_
+PacketStream::PacketStream( const wchar_t* fileName, uint64_t dataOffset, uint32_t dataLength, size_t packetSize, size_t packetCount, bool loop ) :
+    mFile( fileName, packetCount ),
+    mBuffers( nullptr ),
+    mPacketSize( ( std::max<size_t>( packetSize, SECTOR_SIZE ) + SECTOR_SIZE - 1 ) & ~( SECTOR_SIZE - 1 ) ),
+    mPacketCount( packetCount ),
+    mDataOffset( dataOffset ),
+    mDataLength( dataLength ),
+    mLoop( loop ),
+    mBytesRead( 0 ),
+    mBytesDelivered( 0 ),
+    mPacketsRead( 0 ),
+    mUnderruns( 0 ),
+    mLatency( 0 ),
+    mMaxLatency( 0 ),
+    mBusy( 0 ),
+    mStop( false )
+{
+    if ( packetCount < 2 || mPacketSize > UINT32_MAX )
+        throw std::invalid_argument( "PacketStream needs at least two packets" );
+
+    mStorage.reset( new uint8_t[ mPacketSize * mPacketCount + SECTOR_SIZE ] );
+    mBuffers = reinterpret_cast<uint8_t*>( ( reinterpret_cast<uintptr_t>( mStorage.get() ) + SECTOR_SIZE - 1 ) & ~uintptr_t( SECTOR_SIZE - 1 ) );
+
+    mPackets.reset( new Packet[ mPacketCount ] );
+    for( size_t j = 0; j < mPacketCount; ++j )
+        mPackets[ j ].buffer = mBuffers + j * mPacketSize;
+
+    Start();
+}
+
+
+PacketStream::~PacketStream()
+{
+    Stop();
+}
+
+
+void PacketStream::Start()
+{
+    for( size_t j = 0; j < mPacketCount; ++j )
+    {
+        mPackets[ j ].state = PACKET_FREE;
+        mPackets[ j ].last = false;
+    }
+
+    mNextRead = 0;
+    mIssueIndex = mCompleteIndex = mReadIndex = 0;
+    mInFlight = 0;
+    mIssueDone = ( mDataLength == 0 );
+    mEndOfStream = ( mDataLength == 0 );
+    mStop = false;
+
+    mThread = std::thread( &PacketStream::IOThread, this );
+}
+
+
+void PacketStream::Stop()
+{
+    if ( !mThread.joinable() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mStop = true;
+    }
+    mWake.notify_one();
+
+    // Reads in flight complete as aborted, the thread drains them before it exits
+    mFile.Cancel();
+    mThread.join();
+}
+
+
+void PacketStream::IOThread()
+{
+    std::unique_lock<std::mutex> lock( mMutex );
+
+    for(;;)
+    {
+        // Queue a read into every free packet ahead of the consumer
+        while ( !mStop && !mIssueDone && mPackets[ mIssueIndex ].state == PACKET_FREE )
+        {
+            auto& p = mPackets[ mIssueIndex ];
+
+            const uint64_t fileStart = mDataOffset + mNextRead;
+            const uint64_t alignedStart = fileStart & ~uint64_t( SECTOR_SIZE - 1 );
+            p.begin = p.cursor = uint32_t( fileStart - alignedStart );
+            const uint32_t valid = std::min<uint32_t>( uint32_t( mPacketSize ) - p.begin, mDataLength - mNextRead );
+            p.end = p.begin + valid;
+            p.readSize = uint32_t( ( size_t( p.end ) + SECTOR_SIZE - 1 ) & ~( SECTOR_SIZE - 1 ) );
+            p.last = false;
+
+            mNextRead += valid;
+            if ( mNextRead >= mDataLength )
+            {
+                if ( mLoop )
+                {
+                    mNextRead = 0;
+                }
+                else
+                {
+                    p.last = true;
+                    mIssueDone = true;
+                }
+            }
+
+            p.state = PACKET_READING;
+            p.issueTime = Clock::now();
+            if ( !mInFlight++ )
+                mBusyStart = p.issueTime;
+            const size_t slot = mIssueIndex;
+            mIssueIndex = ( mIssueIndex + 1 ) % mPacketCount;
+
+            lock.unlock();
+            mFile.Issue( slot, alignedStart, p.buffer, p.readSize );
+            lock.lock();
+        }
+
+        if ( mStop )
+            break;
+
+        // Wait for the oldest read; packets complete in the order they were queued
+        auto& p = mPackets[ mCompleteIndex ];
+        if ( p.state == PACKET_READING )
+        {
+            lock.unlock();
+            const int64_t bytes = mFile.Wait( mCompleteIndex );
+            const Clock::time_point now = Clock::now();
+            lock.lock();
+
+            if ( bytes < 0 )
+            {
+                if ( mStop )
+                    break;
+
+                // StreamFile traced the failure, end the stream here rather than play garbage
+                p.end = p.begin;
+                p.last = true;
+                mIssueDone = true;
+            }
+            else
+            {
+                // a truncated file ends early
+                if ( uint64_t( bytes ) < p.end )
+                    p.end = std::max( p.begin, uint32_t( bytes ) );
+                mBytesRead += uint64_t( bytes );
+            }
+
+            const Clock::duration latency = now - p.issueTime;
+            mLatency += latency;
+            mMaxLatency = std::max( mMaxLatency, latency );
+            ++mPacketsRead;
+            if ( !--mInFlight )
+                mBusy += now - mBusyStart;
+
+            p.state = PACKET_READY;
+            mCompleteIndex = ( mCompleteIndex + 1 ) % mPacketCount;
+            continue;
+        }
+
+        // Everything queued is ready, sleep until the consumer frees a packet
+        mWake.wait( lock, [&]() { return mStop || ( !mIssueDone && mPackets[ mIssueIndex ].state == PACKET_FREE ); } );
+    }
+
+    // Drain cancelled reads, their buffers must not be released while the OS may still write them
+    for( size_t j = 0; j < mPacketCount; ++j )
+    {
+        auto& p = mPackets[ j ];
+        if ( p.state == PACKET_READING )
+        {
+            lock.unlock();
+            (void)mFile.Wait( j );
+            lock.lock();
+            p.state = PACKET_FREE;
+        }
+    }
+    mInFlight = 0;
+}
+
+
+_Use_decl_annotations_
+size_t PacketStream::Read( uint8_t* dest, size_t maxBytes )
+{
+    if ( !dest && maxBytes > 0 )
+        throw std::invalid_argument( "PacketStream::Read" );
+
+    std::unique_lock<std::mutex> lock( mMutex );
+
+    size_t copied = 0;
+    bool freed = false;
+    while ( copied < maxBytes && !mEndOfStream )
+    {
+        auto& p = mPackets[ mReadIndex ];
+        if ( p.state != PACKET_READY )
+            break;
+
+        const size_t count = std::min<size_t>( maxBytes - copied, p.end - p.cursor );
+        memcpy( dest + copied, p.buffer + p.cursor, count );
+        p.cursor += uint32_t( count );
+        copied += count;
+
+        if ( p.cursor >= p.end )
+        {
+            if ( p.last )
+                mEndOfStream = true;
+
+            p.state = PACKET_FREE;
+            mReadIndex = ( mReadIndex + 1 ) % mPacketCount;
+            freed = true;
+        }
+    }
+
+    if ( copied < maxBytes && !mEndOfStream )
+        ++mUnderruns;
+
+    mBytesDelivered += copied;
+
+    lock.unlock();
+    if ( freed )
+        mWake.notify_one();
+
+    return copied;
+}
+
+
+bool PacketStream::IsEndOfStream() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mEndOfStream;
+}
+
+
+void PacketStream::Restart()
+{
+    Stop();
+    Start();
+}
+
+
+size_t PacketStream::GetBufferedBytes() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    size_t bytes = 0;
+    for( size_t j = 0; j < mPacketCount; ++j )
+    {
+        auto& p = mPackets[ j ];
+        if ( p.state == PACKET_READY )
+            bytes += p.end - p.cursor;
+    }
+    return bytes;
+}
+
+
+Statistics PacketStream::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+
+    typedef std::chrono::duration<double, std::milli> Milliseconds;
+    const double latencyMS = Milliseconds( mLatency ).count();
+    const double busyMS = Milliseconds( mBusy ).count();
+
+    Statistics stats;
+    stats.bytesRead = mBytesRead;
+    stats.bytesDelivered = mBytesDelivered;
+    stats.packetsRead = mPacketsRead;
+    stats.underruns = mUnderruns;
+    stats.bufferBytes = mPacketSize * mPacketCount;
+    stats.averageLatencyMS = mPacketsRead ? float( latencyMS / double( mPacketsRead ) ) : 0.f;
+    stats.maxLatencyMS = float( Milliseconds( mMaxLatency ).count() );
+    stats.throughputMBs = ( busyMS > 0.0 ) ? float( double( mBytesRead ) / ( busyMS / 1000.0 ) / ( 1024.0 * 1024.0 ) ) : 0.f;
+    return stats;
+}
@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// File: PacketStream.h
+//
+// The prefetch ring behind WaveBankStream, with no XAudio2 or Windows types (file I/O
+// goes through StreamFile.h) so it builds and is tested anywhere
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "StreamFile.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+namespace DirectX
+{
+    namespace Streaming
+    {
+        struct Statistics
+        {
+            uint64_t    bytesRead;
+            uint64_t    bytesDelivered;
+            size_t      packetsRead;
+            size_t      underruns;
+            size_t      bufferBytes;
+            float       averageLatencyMS;
+            float       maxLatencyMS;
+            float       throughputMBs;
+        };
+
+        // Reads dataLength bytes at dataOffset of a file in packets of packetSize (rounded up
+        // to SECTOR_SIZE) into a ring of packetCount buffers, one read in flight per free
+        // packet on a background I/O thread. Read never blocks. Every method is thread safe.
+        class PacketStream
+        {
+        public:
+            PacketStream( _In_z_ const wchar_t* fileName, uint64_t dataOffset, uint32_t dataLength,
+                          size_t packetSize, size_t packetCount, bool loop );
+
+            PacketStream(PacketStream const&) = delete;
+            PacketStream& operator= (PacketStream const&) = delete;
+
+            ~PacketStream();
+
+            size_t Read( _Out_writes_bytes_to_(maxBytes, return) uint8_t* dest, size_t maxBytes );
+                // Fewer bytes than asked while not at the end of the data counts as an underrun
+            bool IsEndOfStream() const;
+            void Restart();
+
+            size_t GetBufferedBytes() const;
+            Statistics GetStatistics() const;
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            enum PacketState
+            {
+                PACKET_FREE = 0,    // owned by the I/O thread, nothing in it
+                PACKET_READING,     // read in flight
+                PACKET_READY,       // owned by the consumer
+            };
+
+            struct Packet
+            {
+                uint8_t*            buffer;
+                uint32_t            readSize;   // bytes requested, sector multiple
+                uint32_t            begin;      // first byte of entry data in the buffer
+                uint32_t            end;        // one past the last byte of entry data
+                uint32_t            cursor;     // consumer position, begin..end
+                Clock::time_point   issueTime;
+                PacketState         state;
+                bool                last;       // holds the end of a non looping entry
+            };
+
+            void Start();
+            void Stop();
+            void IOThread();
+
+            StreamFile                      mFile;
+            std::unique_ptr<uint8_t[]>      mStorage;
+            uint8_t*                        mBuffers;       // mStorage aligned to SECTOR_SIZE
+            std::unique_ptr<Packet[]>       mPackets;
+            size_t                          mPacketSize;
+            size_t                          mPacketCount;
+            uint64_t                        mDataOffset;
+            uint32_t                        mDataLength;
+            bool                            mLoop;
+
+            // I/O thread side
+            uint32_t                        mNextRead;      // entry relative offset of the next packet
+            size_t                          mIssueIndex;
+            size_t                          mCompleteIndex;
+            size_t                          mInFlight;
+            bool                            mIssueDone;
+            Clock::time_point               mBusyStart;
+
+            // consumer side
+            size_t                          mReadIndex;
+            bool                            mEndOfStream;
+
+            // statistics
+            uint64_t                        mBytesRead;
+            uint64_t                        mBytesDelivered;
+            size_t                          mPacketsRead;
+            size_t                          mUnderruns;
+            Clock::duration                 mLatency;
+            Clock::duration                 mMaxLatency;
+            Clock::duration                 mBusy;
+
+            mutable std::mutex              mMutex;
+            std::condition_variable         mWake;
+            std::thread                     mThread;
+            bool                            mStop;
+        };
+    }
+}
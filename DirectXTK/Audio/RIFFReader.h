@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------
+// File: RIFFReader.h
+//
+// In-place RIFF chunk scanner for .WAV data (no file I/O, no allocations)
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <objbase.h>
+#endif
+#include <mmreg.h> // off Windows, the WAVEFORMAT stand-in in Tests/Compat
+
+
+namespace DirectX
+{
+    namespace RIFF
+    {
+        const uint32_t FOURCC_RIFF_TAG      = 'FFIR';
+        const uint32_t FOURCC_FORMAT_TAG    = ' tmf';
+        const uint32_t FOURCC_DATA_TAG      = 'atad';
+        const uint32_t FOURCC_WAVE_FILE_TAG = 'EVAW';
+        const uint32_t FOURCC_XWMA_FILE_TAG = 'AMWX';
+        const uint32_t FOURCC_DLS_SAMPLE    = 'pmsw';
+        const uint32_t FOURCC_MIDI_SAMPLE   = 'lpms';
+        const uint32_t FOURCC_XWMA_DPDS     = 'sdpd';
+        const uint32_t FOURCC_XMA_SEEK      = 'kees';
+
+        #pragma pack(push,1)
+        struct RIFFChunk
+        {
+            uint32_t tag;
+            uint32_t size;
+        };
+
+        struct RIFFChunkHeader
+        {
+            uint32_t tag;
+            uint32_t size;
+            uint32_t riff;
+        };
+        #pragma pack(pop)
+
+        static_assert( sizeof(RIFFChunk) == 8, "structure size mismatch");
+        static_assert( sizeof(RIFFChunkHeader) == 12, "structure size mismatch");
+
+        // Smallest buffer that can hold a valid .WAV
+        const size_t MIN_WAV_SIZE = sizeof(RIFFChunk)*2 + sizeof(uint32_t) + sizeof(WAVEFORMAT);
+
+        // Returns the first chunk with the tag whose header lies in [data, data+sizeBytes), nullptr if none.
+        // The walk never steps outside the buffer, whatever the chunk sizes say.
+        const RIFFChunk* FindChunk( _In_reads_bytes_(sizeBytes) const uint8_t* data, _In_ size_t sizeBytes, _In_ uint32_t tag );
+
+        // 'fmt ' and 'data' of a RIFF WAVE/XWMA image, validated against the buffer.
+        // dpds/seek report that the format needs a packet or seek table
+        HRESULT WaveFindFormatAndData( _In_reads_bytes_(wavDataSize) const uint8_t* wavData, _In_ size_t wavDataSize,
+                                       _Outptr_ const WAVEFORMATEX** pwfx, _Outptr_ const uint8_t** pdata, _Out_ uint32_t* dataSize,
+                                       _Out_ bool& dpds, _Out_ bool& seek );
+
+        // First forward loop from a 'wsmp' or 'smpl' chunk, zero when there is none
+        HRESULT WaveFindLoopInfo( _In_reads_bytes_(wavDataSize) const uint8_t* wavData, _In_ size_t wavDataSize,
+                                  _Out_ uint32_t* pLoopStart, _Out_ uint32_t* pLoopLength );
+
+        // A uint32_t table chunk ('dpds' or 'seek'), null when the chunk is missing
+        HRESULT WaveFindTable( _In_reads_bytes_(wavDataSize) const uint8_t* wavData, _In_ size_t wavDataSize, _In_ uint32_t tag,
+                               _Outptr_result_maybenull_ const uint32_t** pData, _Out_ uint32_t* dataCount );
+    }
+}
@@ -0,0 +1,433 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareMixer.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "SoundCommon.h"
+#include "ADPCMCodec.h"
+#include "MixerCore.h"
+
+#include <mutex>
+
+using namespace DirectX;
+
+
+//======================================================================================
+// SoftwareMixer
+//======================================================================================
+
+// Internal object implementation class: WAVEFORMATEX and SoundEffect sources are turned
+// into sample data for the XAudio2-free Mixer::VoicePool (MixerCore.h), which does the work
+class SoftwareMixer::Impl
+{
+public:
+    Impl( int sampleRate, size_t maxVoices ) :
+        mPool( sampleRate, maxVoices ),
+        mDecodedBytes( 0 ),
+        mStreams( maxVoices )
+    {
+    }
+
+    uint32_t Play( const WAVEFORMATEX* wfx, const uint8_t* startAudio, size_t audioBytes, uint32_t loopBegin, uint32_t loopLength,
+                   float volume, float pitch, float pan, bool loop );
+    uint32_t PlayStream( const WAVEFORMATEX* wfx, WaveBankStream* stream, float volume, float pitch, float pan );
+
+    void ReleaseSource( const uint8_t* startAudio );
+
+    Mixer::VoicePool    mPool;
+
+    // MS-ADPCM sources are decoded once to 16-bit PCM, keyed by their data pointer until
+    // ReleaseSource; the size and block header guard against the pointer being reused
+    struct DecodedAudio
+    {
+        size_t                      audioBytes;
+        size_t                      decodedBytes;
+        uint8_t                     header[ ADPCM::HEADER_LENGTH * 2 ];
+        std::unique_ptr<int16_t[]>  samples;
+    };
+
+    const int16_t* Decode( const uint8_t* startAudio, size_t audioBytes, int channels, int samplesPerBlock, size_t frames );
+
+    std::map<const uint8_t*, DecodedAudio>  mDecoded;
+    size_t                                  mDecodedBytes;
+    std::mutex                              mDecodeMutex;   // taken before the pool's, also guards mStreams
+
+    // Wave bank streams are pulled by the pool through these, one per voice slot; a slot's
+    // adapter is replaced when the slot streams again, by then the pool no longer reads it
+    class StreamAdapter : public Mixer::StreamSource
+    {
+    public:
+        explicit StreamAdapter( WaveBankStream* stream ) : mStream( stream ) {}
+
+        virtual size_t Read( uint8_t* dest, size_t maxBytes ) override { return mStream->Read( dest, maxBytes ); }
+        virtual bool IsEndOfStream() const override { return mStream->IsEndOfStream(); }
+
+    private:
+        WaveBankStream* mStream;
+    };
+
+    std::vector<std::unique_ptr<StreamAdapter>> mStreams;
+};
+
+
+namespace
+{
+    // PCM and float sources are played as they are
+    bool GetSampleFormat( _In_ const WAVEFORMATEX* wfx, _Out_ Mixer::SampleFormat& format )
+    {
+        switch( GetFormatTag( wfx ) )
+        {
+        case WAVE_FORMAT_PCM:
+            if ( wfx->wBitsPerSample == 8 )
+                format = Mixer::SAMPLE_PCM8;
+            else if ( wfx->wBitsPerSample == 16 )
+                format = Mixer::SAMPLE_PCM16;
+            else
+            {
+                DebugTrace( "ERROR: SoftwareMixer only supports 8-bit or 16-bit integer PCM (%u bits)\n", wfx->wBitsPerSample );
+                return false;
+            }
+            break;
+
+        case WAVE_FORMAT_IEEE_FLOAT:
+            if ( wfx->wBitsPerSample != 32 )
+                return false;
+            format = Mixer::SAMPLE_FLOAT;
+            break;
+
+        default:
+            DebugTrace( "ERROR: SoftwareMixer only supports PCM, MS-ADPCM and IEEE float sources (format %u)\n", GetFormatTag( wfx ) );
+            return false;
+        }
+
+        if ( wfx->nChannels < 1 || wfx->nChannels > 2 || !wfx->nBlockAlign || !wfx->nSamplesPerSec )
+        {
+            DebugTrace( "ERROR: SoftwareMixer only supports mono or stereo sources\n" );
+            return false;
+        }
+
+        return true;
+    }
+}
+
+
+// Called with mDecodeMutex held
+const int16_t* SoftwareMixer::Impl::Decode( const uint8_t* startAudio, size_t audioBytes, int channels, int samplesPerBlock, size_t frames )
+{
+    const size_t headerBytes = std::min<size_t>( audioBytes, ADPCM::HEADER_LENGTH * channels );
+    auto it = mDecoded.find( startAudio );
+    if ( it != mDecoded.end() )
+    {
+        if ( it->second.audioBytes == audioBytes && !memcmp( it->second.header, startAudio, headerBytes ) )
+            return it->second.samples.get();
+
+        // other audio at the same address, nothing can still be reading the old copy
+        mPool.StopSource( reinterpret_cast<const uint8_t*>( it->second.samples.get() ) );
+        mDecodedBytes -= it->second.decodedBytes;
+        mDecoded.erase( it );
+    }
+
+    DecodedAudio entry;
+    entry.audioBytes = audioBytes;
+    entry.decodedBytes = frames * channels * sizeof(int16_t);
+    memset( entry.header, 0, sizeof(entry.header) );
+    memcpy( entry.header, startAudio, headerBytes );
+    entry.samples.reset( new int16_t[ frames * channels ] );
+    (void)ADPCM::Decode( startAudio, audioBytes, channels, samplesPerBlock, entry.samples.get() );
+
+    const int16_t* samples = entry.samples.get();
+    mDecodedBytes += entry.decodedBytes;
+    mDecoded.insert( std::make_pair( startAudio, std::move( entry ) ) );
+    return samples;
+}
+
+
+void SoftwareMixer::Impl::ReleaseSource( const uint8_t* startAudio )
+{
+    std::lock_guard<std::mutex> lock( mDecodeMutex );
+
+    auto it = mDecoded.find( startAudio );
+    if ( it != mDecoded.end() )
+    {
+        mPool.StopSource( reinterpret_cast<const uint8_t*>( it->second.samples.get() ) );
+        mDecodedBytes -= it->second.decodedBytes;
+        mDecoded.erase( it );
+    }
+
+    mPool.StopSource( startAudio );
+}
+
+
+uint32_t SoftwareMixer::Impl::Play( const WAVEFORMATEX* wfx, const uint8_t* startAudio, size_t audioBytes, uint32_t loopBegin, uint32_t loopLength,
+                                    float volume, float pitch, float pan, bool loop )
+{
+    if ( !wfx || !startAudio || !audioBytes )
+        throw std::exception( "SoftwareMixer::Play" );
+
+    if ( GetFormatTag( wfx ) == WAVE_FORMAT_ADPCM )
+    {
+        if ( wfx->nChannels < 1 || wfx->nChannels > 2 || !wfx->nSamplesPerSec )
+        {
+            DebugTrace( "ERROR: SoftwareMixer only supports mono or stereo sources\n" );
+            return InvalidVoice;
+        }
+
+        auto wfadpcm = reinterpret_cast<const ADPCMWAVEFORMAT*>( wfx );
+        const int samplesPerBlock = wfadpcm->wSamplesPerBlock;
+        if ( wfx->cbSize < 32 /*MSADPCM_FORMAT_EXTRA_BYTES*/ || samplesPerBlock < 4
+             || wfx->nBlockAlign != ADPCM::BlockAlign( wfx->nChannels, samplesPerBlock ) )
+        {
+            DebugTrace( "ERROR: SoftwareMixer found an invalid MS-ADPCM format\n" );
+            return InvalidVoice;
+        }
+
+        const size_t frames = ADPCM::DecodedFrames( audioBytes, wfx->nChannels, samplesPerBlock );
+        if ( !frames || frames > UINT32_MAX )
+            return InvalidVoice;
+
+        // held until the voice is started so ReleaseSource can't free the copy in between
+        std::lock_guard<std::mutex> lock( mDecodeMutex );
+        auto samples = Decode( startAudio, audioBytes, wfx->nChannels, samplesPerBlock, frames );
+
+        // Played from the decoded 16-bit copy
+        return mPool.Play( Mixer::SAMPLE_PCM16, wfx->nChannels, wfx->nSamplesPerSec, reinterpret_cast<const uint8_t*>( samples ), uint32_t( frames ),
+                           loopBegin, loopLength, volume, pitch, pan, loop );
+    }
+
+    Mixer::SampleFormat format;
+    if ( !GetSampleFormat( wfx, format ) )
+        return InvalidVoice;
+
+    const size_t frames = audioBytes / wfx->nBlockAlign;
+    if ( !frames || frames > UINT32_MAX )
+        return InvalidVoice;
+
+    return mPool.Play( format, wfx->nChannels, wfx->nSamplesPerSec, startAudio, uint32_t( frames ),
+                       loopBegin, loopLength, volume, pitch, pan, loop );
+}
+
+
+uint32_t SoftwareMixer::Impl::PlayStream( const WAVEFORMATEX* wfx, WaveBankStream* stream, float volume, float pitch, float pan )
+{
+    if ( !wfx || !stream )
+        throw std::exception( "SoftwareMixer::PlayStream" );
+
+    // wave bank streams hand out raw entry bytes, so there is no decoded copy to play MS-ADPCM from
+    if ( GetFormatTag( wfx ) == WAVE_FORMAT_ADPCM )
+    {
+        DebugTrace( "ERROR: SoftwareMixer only streams PCM and IEEE float entries\n" );
+        return InvalidVoice;
+    }
+
+    Mixer::SampleFormat format;
+    if ( !GetSampleFormat( wfx, format ) )
+        return InvalidVoice;
+
+    std::lock_guard<std::mutex> lock( mDecodeMutex );
+    std::unique_ptr<StreamAdapter> adapter( new StreamAdapter( stream ) );
+    const uint32_t voice = mPool.PlayStream( format, wfx->nChannels, wfx->nSamplesPerSec, adapter.get(), volume, pitch, pan );
+    if ( voice != InvalidVoice )
+        mStreams[ ( voice & 0xffff ) - 1 ] = std::move( adapter );
+    return voice;
+}
+
+
+// Public constructor.
+_Use_decl_annotations_
+SoftwareMixer::SoftwareMixer( int sampleRate, size_t maxVoices )
+  : pImpl( new Impl( sampleRate, maxVoices ) )
+{
+    static_assert( Mixer::MIN_SAMPLE_RATE == XAUDIO2_MIN_SAMPLE_RATE && Mixer::MAX_SAMPLE_RATE == XAUDIO2_MAX_SAMPLE_RATE, "sample rate range" );
+    static_assert( Mixer::INVALID_VOICE == InvalidVoice, "voice handles" );
+}
+
+
+// Move constructor.
+SoftwareMixer::SoftwareMixer(SoftwareMixer&& moveFrom)
+  : pImpl(std::move(moveFrom.pImpl))
+{
+}
+
+
+// Move assignment.
+SoftwareMixer& SoftwareMixer::operator= (SoftwareMixer&& moveFrom)
+{
+    pImpl = std::move(moveFrom.pImpl);
+    return *this;
+}
+
+
+// Public destructor.
+SoftwareMixer::~SoftwareMixer()
+{
+}
+
+
+// Public methods.
+_Use_decl_annotations_
+uint32_t SoftwareMixer::Play( const WAVEFORMATEX* wfx, const uint8_t* startAudio, size_t audioBytes, float volume, float pitch, float pan, bool loop )
+{
+    return pImpl->Play( wfx, startAudio, audioBytes, 0, 0, volume, pitch, pan, loop );
+}
+
+
+_Use_decl_annotations_
+uint32_t SoftwareMixer::Play( const SoundEffect* effect, float volume, float pitch, float pan, bool loop )
+{
+    assert( effect != 0 );
+
+    XAUDIO2_BUFFER buffer;
+#if defined(_XBOX_ONE) || (_WIN32_WINNT < _WIN32_WINNT_WIN8) || (_WIN32_WINNT >= _WIN32_WINNT_WIN10)
+    XAUDIO2_BUFFER_WMA wmaBuffer;
+    (void)effect->FillSubmitBuffer( buffer, wmaBuffer );
+#else
+    effect->FillSubmitBuffer( buffer );
+#endif
+
+    return pImpl->Play( effect->GetFormat(), buffer.pAudioData, buffer.AudioBytes, buffer.LoopBegin, buffer.LoopLength, volume, pitch, pan, loop );
+}
+
+
+_Use_decl_annotations_
+uint32_t SoftwareMixer::PlayStream( const WAVEFORMATEX* wfx, WaveBankStream* stream, float volume, float pitch, float pan )
+{
+    return pImpl->PlayStream( wfx, stream, volume, pitch, pan );
+}
+
+
+_Use_decl_annotations_
+void SoftwareMixer::ReleaseSource( const uint8_t* startAudio )
+{
+    pImpl->ReleaseSource( startAudio );
+}
+
+
+_Use_decl_annotations_
+void SoftwareMixer::ReleaseSource( const SoundEffect* effect )
+{
+    assert( effect != 0 );
+
+    XAUDIO2_BUFFER buffer;
+#if defined(_XBOX_ONE) || (_WIN32_WINNT < _WIN32_WINNT_WIN8) || (_WIN32_WINNT >= _WIN32_WINNT_WIN10)
+    XAUDIO2_BUFFER_WMA wmaBuffer;
+    (void)effect->FillSubmitBuffer( buffer, wmaBuffer );
+#else
+    effect->FillSubmitBuffer( buffer );
+#endif
+
+    pImpl->ReleaseSource( buffer.pAudioData );
+}
+
+
+void SoftwareMixer::Stop( uint32_t voice )
+{
+    pImpl->mPool.Stop( voice );
+}
+
+
+void SoftwareMixer::StopAll()
+{
+    pImpl->mPool.StopAll();
+}
+
+
+void SoftwareMixer::Pause( uint32_t voice )
+{
+    pImpl->mPool.Pause( voice );
+}
+
+
+void SoftwareMixer::Resume( uint32_t voice )
+{
+    pImpl->mPool.Resume( voice );
+}
+
+
+void SoftwareMixer::SetVolume( uint32_t voice, float volume )
+{
+    assert( volume >= -XAUDIO2_MAX_VOLUME_LEVEL && volume <= XAUDIO2_MAX_VOLUME_LEVEL );
+
+    pImpl->mPool.SetVolume( voice, volume );
+}
+
+
+void SoftwareMixer::SetPitch( uint32_t voice, float pitch )
+{
+    assert( pitch >= -1.f && pitch <= 1.f );
+
+    pImpl->mPool.SetPitch( voice, pitch );
+}
+
+
+void SoftwareMixer::SetPan( uint32_t voice, float pan )
+{
+    assert( pan >= -1.f && pan <= 1.f );
+
+    pImpl->mPool.SetPan( voice, pan );
+}
+
+
+bool SoftwareMixer::IsPlaying( uint32_t voice ) const
+{
+    return pImpl->mPool.IsPlaying( voice );
+}
+
+
+float SoftwareMixer::GetMasterVolume() const
+{
+    return pImpl->mPool.GetMasterVolume();
+}
+
+
+void SoftwareMixer::SetMasterVolume( float volume )
+{
+    assert( volume >= -XAUDIO2_MAX_VOLUME_LEVEL && volume <= XAUDIO2_MAX_VOLUME_LEVEL );
+
+    pImpl->mPool.SetMasterVolume( volume );
+}
+
+
+_Use_decl_annotations_
+void SoftwareMixer::Render( float* output, size_t frames )
+{
+    pImpl->mPool.Render( output, frames );
+}
+
+
+int SoftwareMixer::GetSampleRate() const
+{
+    return pImpl->mPool.GetSampleRate();
+}
+
+
+size_t SoftwareMixer::GetMaxVoices() const
+{
+    return pImpl->mPool.GetMaxVoices();
+}
+
+
+SoftwareMixerStatistics SoftwareMixer::GetStatistics() const
+{
+    const Mixer::Statistics pool = pImpl->mPool.GetStatistics();
+
+    SoftwareMixerStatistics stats;
+    stats.activeVoices = pool.activeVoices;
+    stats.peakVoices = pool.peakVoices;
+    stats.maxVoices = pool.maxVoices;
+    stats.rejectedPlays = pool.rejectedPlays;
+    stats.renderedFrames = pool.renderedFrames;
+    stats.streamUnderruns = pool.streamUnderruns;
+
+    std::lock_guard<std::mutex> lock( pImpl->mDecodeMutex );
+    stats.decodedBytes = pImpl->mDecodedBytes;
+    return stats;
+}
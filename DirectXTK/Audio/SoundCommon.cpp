@@ -15,6 +15,7 @@
 
 #include "pch.h"
 #include "SoundCommon.h"
+#include "MixerCore.h"
 
 using namespace DirectX;
 
@@ -635,37 +636,20 @@ bool DirectX::ComputePan( float pan, int channels, float* matrix )
 {
     memset( matrix, 0, sizeof(float) * 16 );
 
+    // the software mixer's law, so both paths pan the same
+    float gains[4];
     if (channels == 1)
     {
-        // Mono panning
-        float left = ( pan >= 0 ) ? ( 1.f - pan ) : 1.f;
-        left = std::min<float>( 1.f, left );
-        left = std::max<float>( -1.f, left );
-
-        float right = ( pan <= 0 ) ? ( - pan - 1.f ) : 1.f;
-        right = std::min<float>( 1.f, right );
-        right = std::max<float>( -1.f, right );
-
-        matrix[0] = left;
-        matrix[1] = right;
+        // Mono panning: one source channel, the L and R rows
+        Mixer::ComputeGains( 1.f, pan, 1, gains );
+        matrix[0] = gains[0];
+        matrix[1] = gains[2];
     }
     else if (channels == 2)
     {
-        // Stereo panning
-        if ( -1.f <= pan && pan <= 0.f )
-        {
-            matrix[0] = .5f * pan + 1.f;    // .5 when pan is -1, 1 when pan is 0
-            matrix[1] = .5f * -pan;         // .5 when pan is -1, 0 when pan is 0
-            matrix[2] = 0.f;                //  0 when pan is -1, 0 when pan is 0
-            matrix[3] = pan + 1.f;          //  0 when pan is -1, 1 when pan is 0
-        }
-        else
-        {
-            matrix[0] = -pan + 1.f;         //  1 when pan is 0,   0 when pan is 1
-            matrix[1] = 0.f;                //  0 when pan is 0,   0 when pan is 1
-            matrix[2] = .5f * pan;          //  0 when pan is 0, .5f when pan is 1
-            matrix[3] = .5f * -pan + 1.f;   //  1 when pan is 0. .5f when pan is 1
-        }
+        // Stereo panning: LL LR RL RR
+        Mixer::ComputeGains( 1.f, pan, 2, gains );
+        memcpy( matrix, gains, sizeof(gains) );
     }
     else
     {
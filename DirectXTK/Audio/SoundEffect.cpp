@@ -154,6 +154,8 @@ public:
     const uint32_t*                     mSeekTable;
 #endif
 
+    std::shared_ptr<const void>         mMappedData;    // shared view of the .wav file, when loaded from one
+
 private:
     std::unique_ptr<uint8_t[]>          mWavData;
 
@@ -171,7 +173,7 @@ HRESULT SoundEffect::Impl::Initialize( AudioEngine* engine, std::unique_ptr<uint
 #endif
                                        uint32_t loopStart, uint32_t loopLength )
 {
-    if ( !engine || !IsValid( wfx ) || !startAudio || !audioBytes || !wavData )
+    if ( !engine || !IsValid( wfx ) || !startAudio || !audioBytes || ( !wavData && !mMappedData ) )
         return E_INVALIDARG;
 
     if ( audioBytes > UINT32_MAX )
@@ -185,7 +187,7 @@ HRESULT SoundEffect::Impl::Initialize( AudioEngine* engine, std::unique_ptr<uint
         // Take ownership of the buffer
         mWavData.reset( wavData.release() );
 
-        // WARNING: We assume the wfx and startAudio parameters are pointers into the wavData memory buffer
+        // WARNING: We assume the wfx and startAudio parameters are pointers into the wavData memory buffer (or mMappedData)
         mWaveFormat = wfx;
         mStartAudio = startAudio;
         break;
@@ -206,7 +208,7 @@ HRESULT SoundEffect::Impl::Initialize( AudioEngine* engine, std::unique_ptr<uint
         // Take ownership of the buffer
         mWavData.reset( wavData.release() );
 
-        // WARNING: We assume the wfx, startAudio, and mSeekTable parameters are pointers into the wavData memory buffer
+        // WARNING: We assume the wfx, startAudio, and mSeekTable parameters are pointers into the wavData memory buffer (or mMappedData)
         mWaveFormat = wfx;
         mStartAudio = startAudio;
         mSeekCount = static_cast<uint32_t>( seekCount );
@@ -361,7 +363,7 @@ SoundEffect::SoundEffect( AudioEngine* engine, const wchar_t* waveFileName )
 {
     WAVData wavInfo;
     std::unique_ptr<uint8_t[]> wavData;
-    HRESULT hr = LoadWAVAudioFromFileEx( waveFileName, wavData, wavInfo );
+    HRESULT hr = LoadWAVAudioFromFileMapped( waveFileName, pImpl->mMappedData, wavInfo );
     if ( FAILED(hr) )
     {
         DebugTrace( "ERROR: SoundEffect failed (%08X) to load from .wav file \"%ls\"\n", hr, waveFileName );
@@ -385,6 +387,39 @@ SoundEffect::SoundEffect( AudioEngine* engine, const wchar_t* waveFileName )
 }
 
 
+_Use_decl_annotations_
+SoundEffect::SoundEffect( AudioEngine* engine, const uint8_t* wavData, size_t wavDataSize, const std::shared_ptr<const void>& owner )
+  : pImpl(new Impl(engine) )
+{
+    WAVData wavInfo;
+    HRESULT hr = LoadWAVAudioInMemoryEx( wavData, wavDataSize, wavInfo );
+    if ( FAILED(hr) || !owner )
+    {
+        DebugTrace( "ERROR: SoundEffect failed (%08X) to load from .wav image\n", hr );
+        throw std::exception( "SoundEffect" );
+    }
+
+    // The chunks are parsed in place, the owner keeps wfx/startAudio/seek alive
+    pImpl->mMappedData = owner;
+
+    std::unique_ptr<uint8_t[]> noData;
+#if defined(_XBOX_ONE) || (_WIN32_WINNT < _WIN32_WINNT_WIN8) || (_WIN32_WINNT >= _WIN32_WINNT_WIN10)
+    hr = pImpl->Initialize( engine, noData, wavInfo.wfx, wavInfo.startAudio, wavInfo.audioBytes,
+                            wavInfo.seek, wavInfo.seekCount,
+                            wavInfo.loopStart, wavInfo.loopLength );
+#else
+    hr = pImpl->Initialize( engine, noData, wavInfo.wfx, wavInfo.startAudio, wavInfo.audioBytes,
+                            wavInfo.loopStart, wavInfo.loopLength );
+#endif
+
+    if ( FAILED(hr) )
+    {
+        DebugTrace( "ERROR: SoundEffect failed (%08X) to intialize from .wav image\n", hr );
+        throw std::exception( "SoundEffect" );
+    }
+}
+
+
 _Use_decl_annotations_
 SoundEffect::SoundEffect( AudioEngine* engine, std::unique_ptr<uint8_t[]>& wavData,
                           const WAVEFORMATEX* wfx, const uint8_t* startAudio, size_t audioBytes )
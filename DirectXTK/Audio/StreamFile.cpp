@@ -0,0 +1,265 @@
+//--------------------------------------------------------------------------------------
+// File: StreamFile.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "StreamFile.h"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include "PlatformHelpers.h"
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#endif
+
+using namespace DirectX;
+using namespace DirectX::Streaming;
+
+
+#if defined(_WIN32)
+
+//======================================================================================
+// OVERLAPPED ReadFile on a FILE_FLAG_NO_BUFFERING handle, one event per slot
+//======================================================================================
+
+class StreamFile::Impl
+{
+public:
+    struct Request
+    {
+        OVERLAPPED      overlapped;
+        ScopedHandle    event;
+        bool            started;    // false when ReadFile failed up front, there is nothing to wait for
+        bool            endOfFile;  // ReadFile failed up front at the end of the file
+    };
+
+    ScopedHandle                    mFile;
+    std::unique_ptr<Request[]>      mRequests;
+};
+
+
+_Use_decl_annotations_
+StreamFile::StreamFile( const wchar_t* fileName, size_t slots ) :
+    pImpl( new Impl )
+{
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    CREATEFILE2_EXTENDED_PARAMETERS params = { sizeof(CREATEFILE2_EXTENDED_PARAMETERS), 0 };
+    params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+    params.dwFileFlags = FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING;
+    pImpl->mFile.reset( safe_handle( CreateFile2( fileName,
+                                                  GENERIC_READ,
+                                                  FILE_SHARE_READ,
+                                                  OPEN_EXISTING,
+                                                  &params ) ) );
+#else
+    pImpl->mFile.reset( safe_handle( CreateFileW( fileName,
+                                                  GENERIC_READ,
+                                                  FILE_SHARE_READ,
+                                                  nullptr,
+                                                  OPEN_EXISTING,
+                                                  FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING,
+                                                  nullptr ) ) );
+#endif
+
+    if ( !pImpl->mFile )
+    {
+        DebugTrace( "ERROR: StreamFile failed (%08X) to open \"%ls\"\n", HRESULT_FROM_WIN32( GetLastError() ), fileName );
+        throw std::runtime_error( "StreamFile" );
+    }
+
+    pImpl->mRequests.reset( new Impl::Request[ slots ] );
+    for( size_t j = 0; j < slots; ++j )
+    {
+        auto& r = pImpl->mRequests[ j ];
+        r.event.reset( CreateEventEx( nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_MODIFY_STATE | SYNCHRONIZE ) );
+        if ( !r.event )
+            throw std::runtime_error( "CreateEventEx" );
+        r.started = false;
+        r.endOfFile = false;
+    }
+}
+
+
+StreamFile::~StreamFile()
+{
+}
+
+
+_Use_decl_annotations_
+void StreamFile::Issue( size_t slot, uint64_t offset, uint8_t* buffer, uint32_t bytes )
+{
+    auto& r = pImpl->mRequests[ slot ];
+
+    memset( &r.overlapped, 0, sizeof(OVERLAPPED) );
+    r.overlapped.Offset = DWORD( offset & 0xFFFFFFFF );
+    r.overlapped.OffsetHigh = DWORD( offset >> 32 );
+    r.overlapped.hEvent = r.event.get();
+    r.started = true;
+    r.endOfFile = false;
+
+    if ( !ReadFile( pImpl->mFile.get(), buffer, bytes, nullptr, &r.overlapped ) )
+    {
+        const DWORD error = GetLastError();
+        if ( error != ERROR_IO_PENDING )
+        {
+            // never queued, so GetOverlappedResult would wait on an event nothing signals
+            r.started = false;
+            r.endOfFile = ( error == ERROR_HANDLE_EOF );
+            if ( !r.endOfFile )
+                DebugTrace( "ERROR: StreamFile read failed (%08X)\n", HRESULT_FROM_WIN32( error ) );
+        }
+    }
+}
+
+
+int64_t StreamFile::Wait( size_t slot )
+{
+    auto& r = pImpl->mRequests[ slot ];
+    if ( !r.started )
+        return r.endOfFile ? 0 : -1;
+
+    r.started = false;
+
+    DWORD bytes = 0;
+    if ( !GetOverlappedResult( pImpl->mFile.get(), &r.overlapped, &bytes, TRUE ) )
+    {
+        const DWORD error = GetLastError();
+        if ( error == ERROR_HANDLE_EOF )
+            return 0;
+        if ( error != ERROR_OPERATION_ABORTED )
+            DebugTrace( "ERROR: StreamFile read failed (%08X)\n", HRESULT_FROM_WIN32( error ) );
+        return -1;
+    }
+
+    return int64_t( bytes );
+}
+
+
+void StreamFile::Cancel()
+{
+    (void)CancelIoEx( pImpl->mFile.get(), nullptr );
+}
+
+#else
+
+//======================================================================================
+// pread: Issue records the request and Wait performs it, so reads still happen on the
+// thread that waits (the stream's I/O thread) and never on the consumer's
+//======================================================================================
+
+class StreamFile::Impl
+{
+public:
+    struct Request
+    {
+        uint64_t    offset;
+        uint8_t*    buffer;
+        uint32_t    bytes;
+        uint32_t    cancelGeneration;
+    };
+
+    Impl() : mFile( -1 ), mCancelGeneration( 0 ) {}
+    ~Impl() { if ( mFile >= 0 ) close( mFile ); }
+
+    int                             mFile;
+    std::unique_ptr<Request[]>      mRequests;
+    std::atomic<uint32_t>           mCancelGeneration;  // bumped by Cancel, requests issued before it fail
+};
+
+
+_Use_decl_annotations_
+StreamFile::StreamFile( const wchar_t* fileName, size_t slots ) :
+    pImpl( new Impl )
+{
+    if ( !fileName )
+        throw std::invalid_argument( "StreamFile" );
+
+    std::string name( wcstombs( nullptr, fileName, 0 ) + 1, '\0' );
+    if ( wcstombs( &name[0], fileName, name.size() ) == size_t(-1) )
+        throw std::runtime_error( "StreamFile" );
+
+#if defined(O_DIRECT)
+    pImpl->mFile = open( name.c_str(), O_RDONLY | O_DIRECT );
+    if ( pImpl->mFile < 0 && errno == EINVAL )
+    {
+        // tmpfs and some network file systems have no unbuffered mode
+        pImpl->mFile = open( name.c_str(), O_RDONLY );
+    }
+#else
+    pImpl->mFile = open( name.c_str(), O_RDONLY );
+#endif
+
+    if ( pImpl->mFile < 0 )
+        throw std::runtime_error( "StreamFile" );
+
+    pImpl->mRequests.reset( new Impl::Request[ slots ] );
+    memset( pImpl->mRequests.get(), 0, sizeof(Impl::Request) * slots );
+}
+
+
+StreamFile::~StreamFile()
+{
+}
+
+
+_Use_decl_annotations_
+void StreamFile::Issue( size_t slot, uint64_t offset, uint8_t* buffer, uint32_t bytes )
+{
+    auto& r = pImpl->mRequests[ slot ];
+    r.offset = offset;
+    r.buffer = buffer;
+    r.bytes = bytes;
+    r.cancelGeneration = pImpl->mCancelGeneration;
+}
+
+
+int64_t StreamFile::Wait( size_t slot )
+{
+    auto& r = pImpl->mRequests[ slot ];
+
+    uint32_t done = 0;
+    while ( done < r.bytes )
+    {
+        if ( r.cancelGeneration != pImpl->mCancelGeneration )
+            return -1;
+
+        const uint32_t requested = r.bytes - done;
+        const ssize_t result = pread( pImpl->mFile, r.buffer + done, requested, off_t( r.offset + done ) );
+        if ( result < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            return -1;
+        }
+        done += uint32_t( result );
+
+        // short only at the end of the file; unbuffered reads can't continue from an unaligned offset
+        if ( uint32_t( result ) < requested )
+            break;
+    }
+
+    return int64_t( done );
+}
+
+
+void StreamFile::Cancel()
+{
+    ++pImpl->mCancelGeneration;
+}
+
+#endif
@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// File: StreamFile.h
+//
+// Platform shim for the unbuffered reads of wave bank streaming: OVERLAPPED ReadFile
+// on Windows, pread on the calling (I/O) thread elsewhere
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+
+
+namespace DirectX
+{
+    namespace Streaming
+    {
+        // Unbuffered reads need sector aligned offsets, sizes and buffers; 4K covers 512, 2048 (DVD) and 4096 byte sectors
+        const size_t SECTOR_SIZE = 4096;
+
+        // A file opened for unbuffered reads with a fixed number of request slots, one read in
+        // flight per slot. Issue and Wait are called from one thread, Cancel from any.
+        class StreamFile
+        {
+        public:
+            StreamFile( _In_z_ const wchar_t* fileName, size_t slots );
+                // Throws std::runtime_error when the file can't be opened
+
+            StreamFile(StreamFile const&) = delete;
+            StreamFile& operator= (StreamFile const&) = delete;
+
+            ~StreamFile();
+
+            void Issue( size_t slot, uint64_t offset, _Out_writes_bytes_(bytes) uint8_t* buffer, uint32_t bytes );
+                // Starts a read into buffer; offset, buffer and bytes are SECTOR_SIZE aligned
+
+            int64_t Wait( size_t slot );
+                // Blocks until the read of the slot finished, returns the bytes read (short at the
+                // end of the file) or -1 when it failed or was cancelled
+
+            void Cancel();
+                // Reads issued so far complete early as failed; the file stays usable
+
+        private:
+            class Impl;
+
+            std::unique_ptr<Impl> pImpl;
+        };
+    }
+}
@@ -52,4 +52,23 @@ namespace DirectX
     HRESULT LoadWAVAudioFromFileEx( _In_z_ const wchar_t* szFileName, 
                                     _Inout_ std::unique_ptr<uint8_t[]>& wavData,
                                     _Out_ WAVData& result );
+
+    // Maps the file read-only and parses it in place, without copying the audio. The result
+    // points into the view, which stays alive as long as 'mapping' (or another user of it) does.
+    // Views are shared process-wide: by path while the file is unchanged, and by content hash
+    // for duplicates and reloads with identical bytes.
+    HRESULT LoadWAVAudioFromFileMapped( _In_z_ const wchar_t* szFileName,
+                                        _Inout_ std::shared_ptr<const void>& mapping,
+                                        _Out_ WAVData& result );
+
+    struct WAVSampleCacheStatistics
+    {
+        size_t samples;         // Live mapped files
+        size_t mappedBytes;     // Their total size
+        size_t loads;           // Files mapped and parsed
+        size_t pathHits;        // Loads served by an unchanged file already mapped
+        size_t contentHits;     // Loads that found identical bytes already mapped
+    };
+
+    WAVSampleCacheStatistics GetWAVSampleCacheStatistics();
 }
\ No newline at end of file
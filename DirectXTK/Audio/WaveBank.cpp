@@ -122,6 +122,7 @@ public:
     AudioEngine*                        mEngine;
     std::list<SoundEffectInstance*>     mInstances;
     WaveBankReader                      mReader;
+    std::wstring                        mFileName;
     uint32_t                            mOneShots;
     bool                                mPrepared;
     bool                                mStreaming;
@@ -139,6 +140,7 @@ HRESULT WaveBank::Impl::Initialize( AudioEngine* engine, const wchar_t* wbFileNa
         return hr;
 
     mStreaming = mReader.IsStreamingBank();
+    mFileName = wbFileName;
 
     return S_OK;
 }
@@ -369,6 +371,51 @@ std::unique_ptr<SoundEffectInstance> WaveBank::CreateInstance( _In_z_ const char
 }
 
 
+std::unique_ptr<WaveBankStream> WaveBank::CreateStream( int index, size_t packetSize, size_t packetCount, bool loop )
+{
+    auto& wb = pImpl->mReader;
+
+    if ( !pImpl->mStreaming )
+    {
+        DebugTrace( "ERROR: WaveBankStreams can only be created from a streaming wave bank\n");
+        throw std::exception( "WaveBank::CreateStream" );
+    }
+
+    if ( index < 0 || uint32_t(index) >= wb.Count() )
+    {
+        // We don't throw an exception here as titles often simply ignore missing assets rather than fail
+        return std::unique_ptr<WaveBankStream>();
+    }
+
+    WaveBankReader::Metadata metadata;
+    HRESULT hr = wb.GetMetadata( index, metadata );
+    ThrowIfFailed( hr );
+
+    if ( uint64_t( metadata.offsetBytes ) + metadata.lengthBytes > wb.BankAudioSize() )
+    {
+        DebugTrace( "ERROR: Wave bank entry %d lies outside the wave data segment\n", index );
+        throw std::exception( "WaveBank::CreateStream" );
+    }
+
+    auto stream = new WaveBankStream( pImpl->mFileName.c_str(), uint64_t( wb.BankAudioOffset() ) + metadata.offsetBytes,
+                                      metadata.lengthBytes, packetSize, packetCount, loop );
+    return std::unique_ptr<WaveBankStream>( stream );
+}
+
+
+std::unique_ptr<WaveBankStream> WaveBank::CreateStream( _In_z_ const char* name, size_t packetSize, size_t packetCount, bool loop )
+{
+    int index = static_cast<int>( pImpl->mReader.Find( name ) );
+    if ( index == -1 )
+    {
+        // We don't throw an exception here as titles often simply ignore missing assets rather than fail
+        return std::unique_ptr<WaveBankStream>();
+    }
+
+    return CreateStream( index, packetSize, packetCount, loop );
+}
+
+
 void WaveBank::UnregisterInstance( _In_ SoundEffectInstance* instance )
 {
     auto it = std::find( pImpl->mInstances.begin(), pImpl->mInstances.end(), instance );
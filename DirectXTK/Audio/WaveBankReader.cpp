@@ -1342,6 +1342,12 @@ uint32_t WaveBankReader::BankAudioSize() const
 }
 
 
+uint32_t WaveBankReader::BankAudioOffset() const
+{
+    return pImpl->m_header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset;
+}
+
+
 _Use_decl_annotations_
 HRESULT WaveBankReader::GetFormat( uint32_t index, WAVEFORMATEX* pFormat, size_t maxsize ) const
 {
@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------
+// File: WaveBankStream.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "Audio.h"
+#include "PacketStream.h"
+
+using namespace DirectX;
+
+
+//======================================================================================
+// WaveBankStream
+//======================================================================================
+
+// Internal object implementation class: the ring and its I/O thread are Streaming::PacketStream
+// (PacketStream.h), which reads through the StreamFile platform shim
+class WaveBankStream::Impl : public Streaming::PacketStream
+{
+public:
+    Impl( _In_z_ const wchar_t* wbFileName, uint64_t dataOffset, uint32_t dataLength, size_t packetSize, size_t packetCount, bool loop ) :
+        PacketStream( wbFileName, dataOffset, dataLength, packetSize, packetCount, loop )
+    {
+    }
+};
+
+
+//--------------------------------------------------------------------------------------
+// WaveBankStream
+//--------------------------------------------------------------------------------------
+
+// Public constructor.
+_Use_decl_annotations_
+WaveBankStream::WaveBankStream( const wchar_t* wbFileName, uint64_t dataOffset, uint32_t dataLength, size_t packetSize, size_t packetCount, bool loop )
+  : pImpl( new Impl( wbFileName, dataOffset, dataLength, packetSize, packetCount, loop ) )
+{
+}
+
+
+// Move constructor.
+WaveBankStream::WaveBankStream(WaveBankStream&& moveFrom)
+  : pImpl(std::move(moveFrom.pImpl))
+{
+}
+
+
+// Move assignment.
+WaveBankStream& WaveBankStream::operator= (WaveBankStream&& moveFrom)
+{
+    pImpl = std::move(moveFrom.pImpl);
+    return *this;
+}
+
+
+// Public destructor.
+WaveBankStream::~WaveBankStream()
+{
+}
+
+
+// Public methods.
+_Use_decl_annotations_
+size_t WaveBankStream::Read( uint8_t* dest, size_t maxBytes )
+{
+    return pImpl->Read( dest, maxBytes );
+}
+
+
+bool WaveBankStream::IsEndOfStream() const
+{
+    return pImpl->IsEndOfStream();
+}
+
+
+void WaveBankStream::Restart()
+{
+    pImpl->Restart();
+}
+
+
+size_t WaveBankStream::GetBufferedBytes() const
+{
+    return pImpl->GetBufferedBytes();
+}
+
+
+WaveBankStreamStatistics WaveBankStream::GetStatistics() const
+{
+    const Streaming::Statistics ring = pImpl->GetStatistics();
+
+    WaveBankStreamStatistics stats;
+    stats.bytesRead = ring.bytesRead;
+    stats.bytesDelivered = ring.bytesDelivered;
+    stats.packetsRead = ring.packetsRead;
+    stats.underruns = ring.underruns;
+    stats.bufferBytes = ring.bufferBytes;
+    stats.averageLatencyMS = ring.averageLatencyMS;
+    stats.maxLatencyMS = ring.maxLatencyMS;
+    stats.throughputMBs = ring.throughputMBs;
+    return stats;
+}
@@ -66,6 +66,7 @@
 namespace DirectX
 {
     class SoundEffectInstance;
+    class WaveBankStream;
 
     //----------------------------------------------------------------------------------
     struct AudioStatistics
@@ -306,6 +307,10 @@ namespace DirectX
         std::unique_ptr<SoundEffectInstance> __cdecl CreateInstance( int index, SOUND_EFFECT_INSTANCE_FLAGS flags = SoundEffectInstance_Default );
         std::unique_ptr<SoundEffectInstance> __cdecl CreateInstance( _In_z_ const char* name, SOUND_EFFECT_INSTANCE_FLAGS flags = SoundEffectInstance_Default );
 
+        std::unique_ptr<WaveBankStream> __cdecl CreateStream( int index, size_t packetSize = 65536, size_t packetCount = 4, bool loop = false );
+        std::unique_ptr<WaveBankStream> __cdecl CreateStream( _In_z_ const char* name, size_t packetSize = 65536, size_t packetCount = 4, bool loop = false );
+            // Streaming banks only: reads the entry in packets into a prefetch ring, see WaveBankStream
+
         bool __cdecl IsPrepared() const;
         bool __cdecl IsInUse() const;
         bool __cdecl IsStreamingBank() const;
@@ -351,6 +356,10 @@ namespace DirectX
         SoundEffect( _In_ AudioEngine* engine, _Inout_ std::unique_ptr<uint8_t[]>& wavData,
                      _In_ const WAVEFORMATEX* wfx, _In_reads_bytes_(audioBytes) const uint8_t* startAudio, size_t audioBytes );
 
+        // Plays in place from a .wav image that 'owner' keeps alive (a view of a packed archive, say)
+        SoundEffect( _In_ AudioEngine* engine, _In_reads_bytes_(wavDataSize) const uint8_t* wavData, size_t wavDataSize,
+                     _In_ const std::shared_ptr<const void>& owner );
+
         SoundEffect( _In_ AudioEngine* engine, _Inout_ std::unique_ptr<uint8_t[]>& wavData,
                      _In_ const WAVEFORMATEX* wfx, _In_reads_bytes_(audioBytes) const uint8_t* startAudio, size_t audioBytes,
                      uint32_t loopStart, uint32_t loopLength );
@@ -679,4 +688,135 @@ namespace DirectX
 
         std::unique_ptr<Impl> pImpl;
     };
+
+
+    //----------------------------------------------------------------------------------
+    struct SoftwareMixerStatistics
+    {
+        size_t      activeVoices;       // Number of voices currently playing or paused
+        size_t      peakVoices;         // Highest number of simultaneous voices
+        size_t      maxVoices;          // Size of the voice pool
+        size_t      rejectedPlays;      // Play requests ignored because the pool was full
+        uint64_t    renderedFrames;     // Total output frames rendered
+        size_t      decodedBytes;       // Memory held by decoded copies of MS-ADPCM sources
+        size_t      streamUnderruns;    // Blocks a streamed voice padded with silence while its stream caught up
+    };
+
+    // CPU mixer that does not need an audio device or XAudio2 engine: voices from PCM/float
+    // data or SoundEffects are resampled and panned (same volume/pitch/pan semantics as
+    // SoundEffectInstance) into interleaved stereo float, for profiling and headless runs.
+    // Only this wrapper knows WAVEFORMATEX and SoundEffect, the mixing itself is Mixer::VoicePool
+    // (Audio/MixerCore.h), which builds without XAudio2 and is what the tests run
+    class SoftwareMixer
+    {
+    public:
+        static const uint32_t InvalidVoice = 0;
+
+        explicit SoftwareMixer( int sampleRate = 44100, size_t maxVoices = 64 );
+
+        SoftwareMixer(SoftwareMixer&& moveFrom);
+        SoftwareMixer& operator= (SoftwareMixer&& moveFrom);
+
+        SoftwareMixer(SoftwareMixer const&) = delete;
+        SoftwareMixer& operator= (SoftwareMixer const&) = delete;
+
+        virtual ~SoftwareMixer();
+
+        uint32_t __cdecl Play( _In_ const WAVEFORMATEX* wfx, _In_reads_bytes_(audioBytes) const uint8_t* startAudio, size_t audioBytes,
+                               float volume = 1.f, float pitch = 0.f, float pan = 0.f, bool loop = false );
+        uint32_t __cdecl Play( _In_ const SoundEffect* effect, float volume = 1.f, float pitch = 0.f, float pan = 0.f, bool loop = false );
+            // Starts a voice and returns its handle, InvalidVoice when the pool is full or the source is not 8/16-bit PCM, MS-ADPCM or float mono/stereo
+            // Note the audio data is referenced, it must outlive the voice; MS-ADPCM is decoded once on first play and the copy kept by the mixer
+
+        uint32_t __cdecl PlayStream( _In_ const WAVEFORMATEX* wfx, _In_ WaveBankStream* stream, float volume = 1.f, float pitch = 0.f, float pan = 0.f );
+            // Starts a voice that pulls 8/16-bit PCM or float mono/stereo data from the stream as it renders, until the end of the entry
+            // Note the stream is referenced, it must outlive the voice; a looping stream plays until stopped
+
+        void __cdecl ReleaseSource( _In_ const uint8_t* startAudio );
+        void __cdecl ReleaseSource( _In_ const SoundEffect* effect );
+            // Stops the voices playing this source and frees its decoded MS-ADPCM copy; call before the audio data is freed
+
+        void __cdecl Stop( uint32_t voice );
+        void __cdecl StopAll();
+        void __cdecl Pause( uint32_t voice );
+        void __cdecl Resume( uint32_t voice );
+
+        void __cdecl SetVolume( uint32_t voice, float volume );
+        void __cdecl SetPitch( uint32_t voice, float pitch );
+        void __cdecl SetPan( uint32_t voice, float pan );
+
+        bool __cdecl IsPlaying( uint32_t voice ) const;
+            // False once the voice finished, was stopped or its handle was reused
+
+        float __cdecl GetMasterVolume() const;
+        void __cdecl SetMasterVolume( float volume );
+
+        void __cdecl Render( _Out_writes_opt_(frames * 2) float* output, size_t frames );
+            // Mixes the next frames of interleaved stereo output; a null output renders into a null sink (same cost, voices advance)
+
+        int __cdecl GetSampleRate() const;
+        size_t __cdecl GetMaxVoices() const;
+        SoftwareMixerStatistics __cdecl GetStatistics() const;
+
+    private:
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
+
+
+    //----------------------------------------------------------------------------------
+    struct WaveBankStreamStatistics
+    {
+        uint64_t    bytesRead;          // Total bytes read from the file
+        uint64_t    bytesDelivered;     // Total bytes handed to the consumer
+        size_t      packetsRead;        // Completed packet reads
+        size_t      underruns;          // Pulls that found the next packet still in flight
+        size_t      bufferBytes;        // Memory held by the prefetch ring
+        float       averageLatencyMS;   // Mean time from issuing a packet read to its completion
+        float       maxLatencyMS;       // Worst packet read latency
+        float       throughputMBs;      // Bytes read per second of read time
+    };
+
+    // Reads one entry of a streaming wave bank in fixed-size, sector-aligned packets into a
+    // ring of prefetch buffers on a background I/O thread, so long music and ambience tracks
+    // play with a bounded memory footprint. The consumer (SoftwareMixer::PlayStream or a
+    // DynamicSoundEffectInstance callback) pulls bytes with Read and never blocks on the disk.
+    // The ring is Streaming::PacketStream (Audio/PacketStream.h), reading through the
+    // Audio/StreamFile.h shim: OVERLAPPED ReadFile on Windows, pread elsewhere.
+    class WaveBankStream
+    {
+    public:
+        WaveBankStream( _In_z_ const wchar_t* wbFileName, uint64_t dataOffset, uint32_t dataLength,
+                        size_t packetSize = 65536, size_t packetCount = 4, bool loop = false );
+            // dataOffset/dataLength locate the entry in the file; packetSize is rounded up to the sector size
+
+        WaveBankStream(WaveBankStream&& moveFrom);
+        WaveBankStream& operator= (WaveBankStream&& moveFrom);
+
+        WaveBankStream(WaveBankStream const&) = delete;
+        WaveBankStream& operator= (WaveBankStream const&) = delete;
+
+        virtual ~WaveBankStream();
+
+        size_t __cdecl Read( _Out_writes_bytes_to_(maxBytes, return) uint8_t* dest, size_t maxBytes );
+            // Copies up to maxBytes of entry data that is already in memory; fewer bytes than asked
+            // while not at the end of the entry counts as an underrun
+
+        bool __cdecl IsEndOfStream() const;
+            // True once every byte of a non-looping entry was delivered
+
+        void __cdecl Restart();
+            // Discards the ring and starts again from the beginning of the entry
+
+        size_t __cdecl GetBufferedBytes() const;
+        WaveBankStreamStatistics __cdecl GetStatistics() const;
+
+    private:
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+    };
 }
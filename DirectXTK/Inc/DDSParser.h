@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------
+// File: DDSParser.h
+//
+// Device independent DDS parsing. Validates the headers of a DDS file held in memory
+// (a mapped file, an archive entry, ...) and describes every subresource as a view
+// into those bytes, without copying them or touching Direct3D. Needs only dxgiformat.h,
+// so it also builds off Windows (see Tests/)
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <dxgiformat.h>
+#include <stdint.h>
+
+
+namespace DirectX
+{
+    enum DDS_ALPHA_MODE
+    {
+        DDS_ALPHA_MODE_UNKNOWN       = 0,
+        DDS_ALPHA_MODE_STRAIGHT      = 1,
+        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+        DDS_ALPHA_MODE_OPAQUE        = 3,
+        DDS_ALPHA_MODE_CUSTOM        = 4,
+    };
+
+    struct DDSTextureInfo
+    {
+        uint32_t        resourceDimension;  // D3D11_RESOURCE_DIMENSION_TEXTURE1D, 2D or 3D
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        depth;
+        uint32_t        mipLevels;
+        uint32_t        arraySize;          // 6 per cube for cube maps
+        DXGI_FORMAT     format;
+        bool            isCubeMap;
+        DDS_ALPHA_MODE  alphaMode;
+        const uint8_t*  bitData;            // first subresource, inside the parsed buffer
+        size_t          bitSize;            // bytes covered by the subresources, trailing data is ignored
+    };
+
+    // One mip of one array item; 'depth' slices of slicePitch bytes each
+    struct DDSSubresource
+    {
+        const uint8_t*  data;
+        size_t          rowPitch;
+        size_t          slicePitch;
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        depth;
+    };
+
+    // Validates the headers against the Direct3D 11 hardware limits and checks that every
+    // subresource lies within [ddsData, ddsData + ddsDataSize). Nothing outside that span is read
+    HRESULT __cdecl ParseDDSTexture(
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _Out_ DDSTextureInfo& info);
+
+    // Fills mipLevels * arraySize views of a parsed texture, in D3D11CalcSubresource order
+    // (item major). Returns the number written, 0 when count is too small
+    size_t __cdecl GetDDSSubresources(
+        _In_ const DDSTextureInfo& info,
+        _Out_writes_(count) DDSSubresource* subresources,
+        _In_ size_t count);
+}
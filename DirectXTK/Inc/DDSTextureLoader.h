@@ -28,18 +28,11 @@
 
 #include <stdint.h>
 
+#include "DDSParser.h"
+
 
 namespace DirectX
 {
-    enum DDS_ALPHA_MODE
-    {
-        DDS_ALPHA_MODE_UNKNOWN       = 0,
-        DDS_ALPHA_MODE_STRAIGHT      = 1,
-        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
-        DDS_ALPHA_MODE_OPAQUE        = 3,
-        DDS_ALPHA_MODE_CUSTOM        = 4,
-    };
-
     // Standard version
     HRESULT __cdecl CreateDDSTextureFromMemory(
         _In_ ID3D11Device* d3dDevice,
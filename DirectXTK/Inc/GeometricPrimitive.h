@@ -61,6 +61,16 @@ namespace DirectX
         static void __cdecl CreateIcosahedron   (std::vector<VertexPositionNormalTexture>& vertices, std::vector<uint16_t>& indices, float size = 1, bool rhcoords = true);
         static void __cdecl CreateTeapot        (std::vector<VertexPositionNormalTexture>& vertices, std::vector<uint16_t>& indices, float size = 1, size_t tessellation = 8, bool rhcoords = true);
 
+        // Reorder the triangles and vertices of primitives created after this call for the
+        // post-transform cache, overdraw and vertex fetch (see MeshOptimizer.h). Off by default,
+        // not synchronized with creation on other threads. The vector overloads above are
+        // never affected.
+        static void __cdecl SetMeshOptimization(bool enable);
+
+        // Generated vertices and indices are cached per shape and parameters, and shared by every
+        // later Create* call with the same arguments. This releases the cached copies.
+        static void __cdecl ClearGeometryCache();
+
         // Draw the primitive.
         void XM_CALLCONV Draw(FXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, FXMVECTOR color = Colors::White, _In_opt_ ID3D11ShaderResourceView* texture = nullptr, bool wireframe = false,
                               _In_opt_ std::function<void __cdecl()> setCustomState = nullptr ) const;
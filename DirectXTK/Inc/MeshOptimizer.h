@@ -0,0 +1,153 @@
+//--------------------------------------------------------------------------------------
+// File: MeshOptimizer.h
+//
+// Post-transform vertex cache, overdraw and vertex fetch optimization of indexed
+// triangle lists, plus a FIFO cache simulation to measure the result. Everything runs
+// on the CPU over plain index and vertex arrays; no Direct3D calls are made
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <stdint.h>
+#include <vector>
+
+
+namespace DirectX
+{
+    namespace MeshOptimizer
+    {
+        enum FaceOrder
+        {
+            FaceOrder_Forsyth,  // Forsyth's LRU scoring, degrades gracefully when the cache size is unknown
+            FaceOrder_Tipsify,  // Sander et al., linear time, best on a FIFO of the given size
+        };
+
+        // Sizes outside [MinCacheSize, MaxCacheSize] throw
+        static const uint32_t DefaultCacheSize = 16;
+        static const uint32_t MinCacheSize = 4;
+        static const uint32_t MaxCacheSize = 64;
+
+        // Clusters are split once their own ACMR drops below this factor of the unsplit one
+        static const float DefaultOverdrawThreshold = 1.05f;
+
+        // Remap entry of a vertex no triangle refers to
+        static const uint32_t UnusedVertex = uint32_t(-1);
+
+        struct VertexCacheStats
+        {
+            size_t  triangles;
+            size_t  vertices;       // distinct vertices referenced by the triangles
+            size_t  transformed;    // FIFO cache misses
+            float   acmr;           // transformed / triangles, 0.5 is the limit for large regular meshes
+            float   atvr;           // transformed / vertices, 1.0 is ideal
+        };
+
+        // Reorders the triangles of a triangle list in place for a post-transform cache of
+        // cacheSize entries. The set of triangles and their winding are unchanged.
+        void __cdecl OptimizeFaces(
+            _Inout_updates_(indexCount) uint16_t* indices,
+            _In_ size_t indexCount,
+            _In_ size_t vertexCount,
+            _In_ FaceOrder order = FaceOrder_Tipsify,
+            _In_ uint32_t cacheSize = DefaultCacheSize);
+
+        void __cdecl OptimizeFaces(
+            _Inout_updates_(indexCount) uint32_t* indices,
+            _In_ size_t indexCount,
+            _In_ size_t vertexCount,
+            _In_ FaceOrder order = FaceOrder_Tipsify,
+            _In_ uint32_t cacheSize = DefaultCacheSize);
+
+        // Tipsify ordering followed by the view independent overdraw pass of the same paper:
+        // the Tipsify output is cut into clusters, which are then sorted so that the ones facing
+        // away from the mesh centroid draw first. Positions are read positionStride bytes apart.
+        void __cdecl OptimizeOverdraw(
+            _Inout_updates_(indexCount) uint16_t* indices,
+            _In_ size_t indexCount,
+            _In_reads_bytes_(vertexCount * positionStride) const XMFLOAT3* positions,
+            _In_ size_t positionStride,
+            _In_ size_t vertexCount,
+            _In_ float threshold = DefaultOverdrawThreshold,
+            _In_ uint32_t cacheSize = DefaultCacheSize);
+
+        void __cdecl OptimizeOverdraw(
+            _Inout_updates_(indexCount) uint32_t* indices,
+            _In_ size_t indexCount,
+            _In_reads_bytes_(vertexCount * positionStride) const XMFLOAT3* positions,
+            _In_ size_t positionStride,
+            _In_ size_t vertexCount,
+            _In_ float threshold = DefaultOverdrawThreshold,
+            _In_ uint32_t cacheSize = DefaultCacheSize);
+
+        // Renumbers the vertices in the order the indices first reference them, so the vertex
+        // buffer is read front to back. Fills vertexRemap[old] = new (UnusedVertex for vertices
+        // no triangle uses) and returns the number of vertices still referenced.
+        size_t __cdecl OptimizeVertexFetch(
+            _Inout_updates_(indexCount) uint16_t* indices,
+            _In_ size_t indexCount,
+            _In_ size_t vertexCount,
+            _Out_writes_(vertexCount) uint32_t* vertexRemap);
+
+        size_t __cdecl OptimizeVertexFetch(
+            _Inout_updates_(indexCount) uint32_t* indices,
+            _In_ size_t indexCount,
+            _In_ size_t vertexCount,
+            _Out_writes_(vertexCount) uint32_t* vertexRemap);
+
+        // Applies a remap from OptimizeVertexFetch to vertices of any layout. The destination
+        // must not overlap the source and holds as many vertices as OptimizeVertexFetch returned.
+        void __cdecl RemapVertices(
+            _In_reads_bytes_(vertexCount * stride) const void* vertices,
+            _In_ size_t stride,
+            _In_ size_t vertexCount,
+            _In_reads_(vertexCount) const uint32_t* vertexRemap,
+            _Out_ void* optimizedVertices);
+
+        // Simulates a FIFO post-transform cache of cacheSize entries over the triangle list.
+        VertexCacheStats __cdecl AnalyzeVertexCache(
+            _In_reads_(indexCount) const uint16_t* indices,
+            _In_ size_t indexCount,
+            _In_ size_t vertexCount,
+            _In_ uint32_t cacheSize = DefaultCacheSize);
+
+        VertexCacheStats __cdecl AnalyzeVertexCache(
+            _In_reads_(indexCount) const uint32_t* indices,
+            _In_ size_t indexCount,
+            _In_ size_t vertexCount,
+            _In_ uint32_t cacheSize = DefaultCacheSize);
+
+        // Overdraw order, then vertex fetch order, for a mesh kept in vectors. Vertices no
+        // triangle refers to are dropped.
+        template<class TVertex, class TIndex>
+        void OptimizeMesh(
+            std::vector<TVertex>& vertices,
+            std::vector<TIndex>& indices,
+            XMFLOAT3 TVertex::* position = &TVertex::position,
+            float threshold = DefaultOverdrawThreshold,
+            uint32_t cacheSize = DefaultCacheSize)
+        {
+            if (vertices.empty() || indices.empty())
+                return;
+
+            OptimizeOverdraw(indices.data(), indices.size(), &(vertices.front().*position), sizeof(TVertex), vertices.size(), threshold, cacheSize);
+
+            std::vector<uint32_t> remap(vertices.size());
+            size_t used = OptimizeVertexFetch(indices.data(), indices.size(), vertices.size(), remap.data());
+
+            std::vector<TVertex> optimized(used);
+            RemapVertices(vertices.data(), sizeof(TVertex), vertices.size(), remap.data(), optimized.data());
+            vertices.swap(optimized);
+        }
+    }
+}
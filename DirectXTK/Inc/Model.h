@@ -121,23 +121,33 @@ namespace DirectX
         // Update all effects used by the model
         void __cdecl UpdateEffects( _In_ std::function<void __cdecl(IEffect*)> setEffect );
 
+        // With optimize set, the triangle list parts are reordered for the post-transform vertex cache
+        // while loading (see MeshOptimizer.h); VBO models also get their vertices in fetch order.
+        // The file overloads map the file and create the buffers straight from it (see ModelParser.h).
+
         // Loads a model from a Visual Studio Starter Kit .CMO file
         static std::unique_ptr<Model> __cdecl CreateFromCMO( _In_ ID3D11Device* d3dDevice, _In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize,
-                                                             _In_ IEffectFactory& fxFactory, bool ccw = true, bool pmalpha = false );
+                                                             _In_ IEffectFactory& fxFactory, bool ccw = true, bool pmalpha = false,
+                                                             bool optimize = false );
         static std::unique_ptr<Model> __cdecl CreateFromCMO( _In_ ID3D11Device* d3dDevice, _In_z_ const wchar_t* szFileName,
-                                                             _In_ IEffectFactory& fxFactory, bool ccw = true, bool pmalpha = false );
+                                                             _In_ IEffectFactory& fxFactory, bool ccw = true, bool pmalpha = false,
+                                                             bool optimize = false );
 
         // Loads a model from a DirectX SDK .SDKMESH file
         static std::unique_ptr<Model> __cdecl CreateFromSDKMESH( _In_ ID3D11Device* d3dDevice, _In_reads_bytes_(dataSize) const uint8_t* meshData, _In_ size_t dataSize,
-                                                                 _In_ IEffectFactory& fxFactory, bool ccw = false, bool pmalpha = false );
+                                                                 _In_ IEffectFactory& fxFactory, bool ccw = false, bool pmalpha = false,
+                                                                 bool optimize = false );
         static std::unique_ptr<Model> __cdecl CreateFromSDKMESH( _In_ ID3D11Device* d3dDevice, _In_z_ const wchar_t* szFileName,
-                                                                 _In_ IEffectFactory& fxFactory, bool ccw = false, bool pmalpha = false );
+                                                                 _In_ IEffectFactory& fxFactory, bool ccw = false, bool pmalpha = false,
+                                                                 bool optimize = false );
 
         // Loads a model from a .VBO file
         static std::unique_ptr<Model> __cdecl CreateFromVBO( _In_ ID3D11Device* d3dDevice, _In_reads_bytes_(dataSize) const uint8_t* meshData, _In_ size_t dataSize,
-                                                             _In_opt_ std::shared_ptr<IEffect> ieffect = nullptr, bool ccw = false, bool pmalpha = false );
+                                                             _In_opt_ std::shared_ptr<IEffect> ieffect = nullptr, bool ccw = false, bool pmalpha = false,
+                                                             bool optimize = false );
         static std::unique_ptr<Model> __cdecl CreateFromVBO( _In_ ID3D11Device* d3dDevice, _In_z_ const wchar_t* szFileName, 
-                                                             _In_opt_ std::shared_ptr<IEffect> ieffect = nullptr, bool ccw = false, bool pmalpha = false );
+                                                             _In_opt_ std::shared_ptr<IEffect> ieffect = nullptr, bool ccw = false, bool pmalpha = false,
+                                                             bool optimize = false );
 
     private:
         std::set<IEffect*>  mEffectCache;
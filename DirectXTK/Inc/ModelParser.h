@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------
+// File: ModelParser.h
+//
+// Device independent parsing of the CMO, SDKMESH and VBO model formats. Validates every
+// count and offset of a model file held in memory (a mapped file, an archive entry, ...)
+// and describes its vertex, index and material data as pointers into those bytes,
+// without copying them or touching Direct3D
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+
+// File structures, see SDKMesh.h and CMO.h
+namespace DXUT
+{
+    struct SDKMESH_HEADER;
+    struct SDKMESH_VERTEX_BUFFER_HEADER;
+    struct SDKMESH_INDEX_BUFFER_HEADER;
+    struct SDKMESH_MESH;
+    struct SDKMESH_SUBSET;
+    struct SDKMESH_FRAME;
+    struct SDKMESH_MATERIAL;
+}
+
+namespace VSD3DStarter
+{
+    struct Material;
+    struct SubMesh;
+    struct SkinningVertex;
+    struct MeshExtents;
+}
+
+
+namespace DirectX
+{
+    // .VBO: a single mesh of 16 bit indexed triangles
+    struct VBOModelInfo
+    {
+        const uint8_t*      vertices;       // vertexCount VertexPositionNormalTexture, 32 bytes each
+        size_t              vertexCount;
+        const uint16_t*     indices;
+        size_t              indexCount;
+    };
+
+    // .SDKMESH: the tables of the file. Every mesh refers to valid buffers, subsets and
+    // materials, and every subset drawn by a mesh lies within its index buffer
+    struct SDKMESHModelInfo
+    {
+        const DXUT::SDKMESH_HEADER*                 header;
+        const DXUT::SDKMESH_VERTEX_BUFFER_HEADER*   vertexBuffers;  // header->NumVertexBuffers
+        const DXUT::SDKMESH_INDEX_BUFFER_HEADER*    indexBuffers;   // header->NumIndexBuffers
+        const DXUT::SDKMESH_MESH*                   meshes;         // header->NumMeshes
+        const DXUT::SDKMESH_SUBSET*                 subsets;        // header->NumTotalSubsets
+        const DXUT::SDKMESH_FRAME*                  frames;         // header->NumFrames
+        const DXUT::SDKMESH_MATERIAL*               materials;      // header->NumMaterials
+        std::vector<const uint8_t*>                 vertexData;     // SizeBytes per vertex buffer
+        std::vector<const uint8_t*>                 indexData;      // SizeBytes per index buffer
+        std::vector<const uint32_t*>                meshSubsets;    // NumSubsets entries per mesh
+    };
+
+    // .CMO strings are UTF-16 and not null terminated
+    struct CMOString
+    {
+        const uint16_t* chars;
+        size_t          length;
+    };
+
+    static const size_t CMOMaxTextures = 8;
+
+    struct CMOMaterialInfo
+    {
+        CMOString                       name;
+        const VSD3DStarter::Material*   material;
+        CMOString                       pixelShader;
+        CMOString                       textures[CMOMaxTextures];
+    };
+
+    struct CMOIndexBufferInfo
+    {
+        const uint16_t* indices;
+        size_t          indexCount;
+    };
+
+    struct CMOVertexBufferInfo
+    {
+        const uint8_t*                          vertices;   // vertexCount VertexPositionNormalTangentColorTexture, 52 bytes each
+        const VSD3DStarter::SkinningVertex*     skinning;   // nullptr when the mesh has no skinning data
+        size_t                                  vertexCount;
+    };
+
+    // Every submesh refers to a valid material, index buffer and vertex buffer, and lies
+    // within its index buffer
+    struct CMOMeshInfo
+    {
+        CMOString                           name;
+        std::vector<CMOMaterialInfo>        materials;
+        const VSD3DStarter::SubMesh*        submeshes;
+        size_t                              submeshCount;
+        std::vector<CMOIndexBufferInfo>     indexBuffers;
+        std::vector<CMOVertexBufferInfo>    vertexBuffers;
+        const VSD3DStarter::MeshExtents*    extents;
+        bool                                skinning;
+        bool                                hasSkeleton;
+    };
+
+    // Each parser throws std::runtime_error when the file is malformed, with the messages the
+    // Model loaders have always used. Nothing outside [meshData, meshData + dataSize) is read,
+    // and the structures point into meshData, which must outlive them. The file structures
+    // are packed, so pointers into them may be unaligned
+    void __cdecl ParseVBO(
+        _In_reads_bytes_(dataSize) const uint8_t* meshData,
+        _In_ size_t dataSize,
+        _Out_ VBOModelInfo& info);
+
+    void __cdecl ParseSDKMESH(
+        _In_reads_bytes_(dataSize) const uint8_t* meshData,
+        _In_ size_t dataSize,
+        _Out_ SDKMESHModelInfo& info);
+
+    void __cdecl ParseCMO(
+        _In_reads_bytes_(dataSize) const uint8_t* meshData,
+        _In_ size_t dataSize,
+        _Out_ std::vector<CMOMeshInfo>& meshes);
+}
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------------
+// File: RadixSort.h
+//
+// Stable LSD radix sort of indices by 64 bit keys, used by SpriteBatch to order sprites
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+namespace DirectX
+{
+    // Stable LSD radix sort, 8 bits per pass, of the indices [0, count) by key. Passes where
+    // every key shares the same digit are skipped. scratch must hold count entries.
+    void __cdecl RadixSortIndices(
+        _In_reads_(count) uint64_t const* keys,
+        _In_ size_t count,
+        _Out_writes_(count) uint32_t* indices,
+        _Out_writes_(count) uint32_t* scratch);
+}
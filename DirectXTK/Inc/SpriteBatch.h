@@ -34,6 +34,8 @@ namespace DirectX
         SpriteSortMode_Texture,
         SpriteSortMode_BackToFront,
         SpriteSortMode_FrontToBack,
+        SpriteSortMode_BackToFrontTexture,  // Sprites at the same depth grouped by texture.
+        SpriteSortMode_FrontToBackTexture,
     };
     
     
@@ -77,6 +79,10 @@ namespace DirectX
         void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, FXMVECTOR color = Colors::White);
         void XM_CALLCONV Draw(_In_ ID3D11ShaderResourceView* texture, RECT const& destinationRectangle, _In_opt_ RECT const* sourceRectangle, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
 
+        // Draws count subrectangles of one texture sharing position, color, rotation, scale and effects, each
+        // with its own origin added to origin. Same as count Draw calls, but queued in one go (see TextLayout).
+        void XM_CALLCONV DrawRects(_In_ ID3D11ShaderResourceView* texture, FXMVECTOR position, _In_reads_(count) RECT const* sourceRectangles, _In_reads_(count) XMFLOAT2 const* origins, size_t count, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects = SpriteEffects_None, float layerDepth = 0);
+
         // Rotation mode to be applied to the sprite transformation
         void __cdecl SetRotation( DXGI_MODE_ROTATION mode );
         DXGI_MODE_ROTATION __cdecl GetRotation() const;
@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteBatchKernels.h
+//
+// The CPU stages of SpriteBatch (sort key generation, radix sort, vertex expansion)
+// with no Direct3D calls, so they can run and be measured without a device
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpriteBatch.h"
+#include "VertexTypes.h"
+#include "RadixSort.h"
+
+#include <stdint.h>
+
+
+namespace DirectX
+{
+    namespace SpriteBatchKernels
+    {
+        // Info about a single sprite that is waiting to be drawn. The texture is only
+        // compared, never dereferenced, by the functions below.
+        __declspec(align(16)) struct SpriteInfo
+        {
+            XMFLOAT4A source;
+            XMFLOAT4A destination;
+            XMFLOAT4A color;
+            XMFLOAT4A originRotationDepth;
+            ID3D11ShaderResourceView* texture;
+            int flags;
+
+
+            // Combine values from the public SpriteEffects enum with these internal-only flags.
+            static const int SourceInTexels = 4;
+            static const int DestSizeInPixels = 8;
+
+            static_assert((SpriteEffects_FlipBoth & (SourceInTexels | DestSizeInPixels)) == 0, "Flag bits must not overlap");
+        };
+
+        static const size_t VerticesPerSprite = 4;
+
+        // Numbers each distinct texture in order of first use, so sort keys do not depend on
+        // heap addresses. Returns the number of distinct textures.
+        size_t __cdecl AssignTextureIds(
+            _In_reads_(count) SpriteInfo const* const* sprites,
+            _In_ size_t count,
+            _Out_writes_(count) uint32_t* textureIds);
+
+        // Packs the layer depth (order preserving float bits, inverted for back to front) in the
+        // high 32 bits and the texture id in the low 32 bits. textureIds may be null for the
+        // depth-only modes; SpriteSortMode_Texture uses the id alone.
+        void __cdecl BuildSortKeys(
+            _In_reads_(count) SpriteInfo const* const* sprites,
+            _In_reads_opt_(count) uint32_t const* textureIds,
+            _In_ size_t count,
+            _In_ SpriteSortMode sortMode,
+            _Out_writes_(count) uint64_t* keys);
+
+        // Sorts the indices by BuildSortKeys output (RadixSort.h).
+        using DirectX::RadixSortIndices;
+
+        // Writes VerticesPerSprite vertices per sprite, all sprites sharing one texture of the
+        // given size. Four sprites are transformed at once in SIMD registers, the remainder one
+        // at a time; the output matches ExpandSprite bit for bit.
+        void XM_CALLCONV ExpandSprites(
+            _In_reads_(count) SpriteInfo const* const* sprites,
+            _In_ size_t count,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize,
+            _Out_writes_(count * VerticesPerSprite) VertexPositionColorTexture* vertices);
+
+        // Generates vertex data for a single sprite.
+        void XM_CALLCONV ExpandSprite(
+            _In_ SpriteInfo const* sprite,
+            FXMVECTOR textureSize,
+            FXMVECTOR inverseTextureSize,
+            _Out_writes_(VerticesPerSprite) VertexPositionColorTexture* vertices);
+    }
+}
@@ -15,9 +15,15 @@
 
 #include "SpriteBatch.h"
 
+#include <vector>
+
+#include <wrl\client.h>
+
 
 namespace DirectX
 {
+    class TextLayout;
+
     class SpriteFont
     {
     public:
@@ -42,6 +48,9 @@ namespace DirectX
 
         XMVECTOR XM_CALLCONV MeasureString(_In_z_ wchar_t const* text) const;
 
+        // Lays the string out once, for text that is drawn every frame without changing.
+        TextLayout __cdecl LayoutString(_In_z_ wchar_t const* text, SpriteEffects effects = SpriteEffects_None) const;
+
         RECT __cdecl MeasureDrawBounds(_In_z_ wchar_t const* text, XMFLOAT2 const& position) const;
         RECT XM_CALLCONV MeasureDrawBounds(_In_z_ wchar_t const* text, FXMVECTOR position) const;
 
@@ -78,4 +87,37 @@ namespace DirectX
 
         static const XMFLOAT2 Float2Zero;
     };
+
+
+    // The glyph quads and bounds of one string, built by SpriteFont::LayoutString. Draw replays
+    // them into a SpriteBatch with a single call, with no glyph lookups or measuring. Holds a
+    // reference on the font texture, so rebuild it when the font is recreated.
+    class TextLayout
+    {
+    public:
+        TextLayout();
+
+        void XM_CALLCONV Draw(_In_ SpriteBatch* spriteBatch, XMFLOAT2 const& position, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = Float2Zero, float scale = 1, float layerDepth = 0) const;
+        void XM_CALLCONV Draw(_In_ SpriteBatch* spriteBatch, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, float layerDepth = 0) const;
+
+        // Same as SpriteFont::MeasureString for the laid out text.
+        XMVECTOR XM_CALLCONV GetSize() const;
+
+        // Same as SpriteFont::MeasureDrawBounds, up to float rounding of the position.
+        RECT __cdecl GetDrawBounds(XMFLOAT2 const& position) const;
+
+        size_t __cdecl GetGlyphCount() const;
+
+    private:
+        friend class SpriteFont;
+
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> mTexture;
+        std::vector<RECT> mSourceRects;
+        std::vector<XMFLOAT2> mOrigins;     // per glyph, relative to the draw origin
+        SpriteEffects mEffects;
+        XMFLOAT2 mSize;
+        XMFLOAT4 mBounds;                   // left, top, right, bottom relative to the position
+
+        static const XMFLOAT2 Float2Zero;
+    };
 }
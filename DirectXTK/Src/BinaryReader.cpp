@@ -88,3 +88,67 @@ HRESULT BinaryReader::ReadEntireFile(_In_z_ wchar_t const* fileName, _Inout_ std
     
     return S_OK;
 }
+
+
+// Maps the whole file read-only. The view keeps the mapping alive, so no handle is kept.
+HRESULT MappedFileView::Open(_In_z_ wchar_t const* fileName)
+{
+    Close();
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(fileName, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)));
+#endif
+
+    if (!hFile)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // Empty files cannot be mapped, and the view must fit the address space.
+    if (!fileInfo.EndOfFile.QuadPart)
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    if (static_cast<uint64_t>(fileInfo.EndOfFile.QuadPart) > SIZE_MAX)
+        return E_FAIL;
+
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP || WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
+    ScopedHandle hMapping(CreateFileMappingFromApp(hFile.get(), nullptr, PAGE_READONLY, 0, nullptr));
+#else
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+#endif
+
+    if (!hMapping)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP || WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
+    void* view = MapViewOfFileFromApp(hMapping.get(), FILE_MAP_READ, 0, 0);
+#else
+    void* view = MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0);
+#endif
+
+    if (!view)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    mData = static_cast<uint8_t const*>(view);
+    mSize = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+
+    return S_OK;
+}
+
+
+void MappedFileView::Close()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+
+    mData = nullptr;
+    mSize = 0;
+}
@@ -72,4 +72,26 @@ namespace DirectX
 
         std::unique_ptr<uint8_t[]> mOwnedData;
     };
+
+
+    // Read-only view of an entire file mapped into memory, valid as long as the object lives.
+    class MappedFileView
+    {
+    public:
+        MappedFileView() : mData(nullptr), mSize(0) {}
+        ~MappedFileView() { Close(); }
+
+        MappedFileView(MappedFileView const&) = delete;
+        MappedFileView& operator= (MappedFileView const&) = delete;
+
+        HRESULT Open(_In_z_ wchar_t const* fileName);
+        void Close();
+
+        uint8_t const* GetData() const { return mData; }
+        size_t GetSize() const { return mSize; }
+
+    private:
+        uint8_t const* mData;
+        size_t mSize;
+    };
 }
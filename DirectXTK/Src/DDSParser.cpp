@@ -0,0 +1,381 @@
+//--------------------------------------------------------------------------------------
+// File: DDSParser.cpp
+//
+// Device independent DDS parsing (header validation and subresource layout)
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "DDSParser.h"
+
+#include "dds.h"
+#include "LoaderHelpers.h"
+
+using namespace DirectX;
+using namespace DirectX::LoaderHelpers;
+
+namespace
+{
+    // Direct3D 11 hardware requirements, repeated here so parsing needs no Direct3D headers
+    const uint32_t MAX_MIP_LEVELS = 15;                 // D3D11_REQ_MIP_LEVELS
+    const uint32_t MAX_TEXTURE1D_DIMENSION = 16384;     // D3D11_REQ_TEXTURE1D_U_DIMENSION
+    const uint32_t MAX_TEXTURE2D_DIMENSION = 16384;     // D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+    const uint32_t MAX_TEXTURECUBE_DIMENSION = 16384;   // D3D11_REQ_TEXTURECUBE_DIMENSION
+    const uint32_t MAX_TEXTURE3D_DIMENSION = 2048;      // D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION
+    const uint32_t MAX_ARRAY_SIZE = 2048;               // D3D11_REQ_TEXTURE1D/2D_ARRAY_AXIS_DIMENSION
+
+    // Largest surface we accept; keeps every pitch product exact in a 32-bit size_t
+    const uint64_t MAX_SURFACE_BYTES = 0x80000000ull;
+
+    //--------------------------------------------------------------------------------------
+    uint32_t CountMips(uint32_t width, uint32_t height, uint32_t depth)
+    {
+        uint32_t count = 1;
+        while (width > 1 || height > 1 || depth > 1)
+        {
+            width >>= 1;
+            height >>= 1;
+            depth >>= 1;
+            ++count;
+        }
+        return count;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Walks the subresources in file order. Validates them against bitSize when out is null,
+    // otherwise fills out (the layout was validated before)
+    HRESULT WalkSubresources(_In_ const DDSTextureInfo& info,
+        _In_ size_t bitSize,
+        _Out_opt_ size_t* usedBytes,
+        _Out_writes_opt_(info.mipLevels * info.arraySize) DDSSubresource* out)
+    {
+        uint64_t offset = 0;
+        size_t index = 0;
+        for (uint32_t item = 0; item < info.arraySize; ++item)
+        {
+            uint32_t w = info.width;
+            uint32_t h = info.height;
+            uint32_t d = info.depth;
+            for (uint32_t mip = 0; mip < info.mipLevels; ++mip)
+            {
+                size_t numBytes = 0;
+                size_t rowBytes = 0;
+                size_t numRows = 0;
+                GetSurfaceInfo(w, h, info.format, &numBytes, &rowBytes, &numRows);
+
+                // Dimensions are bounded, so rowBytes and numRows are exact; numBytes may not be on 32-bit
+                if (!rowBytes || uint64_t(rowBytes) * numRows >= MAX_SURFACE_BYTES)
+                {
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+
+                const uint64_t surfaceBytes = uint64_t(numBytes) * d;
+                if (surfaceBytes > bitSize - offset)
+                {
+                    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                }
+
+                if (out)
+                {
+                    auto& sub = out[index++];
+                    sub.data = info.bitData + offset;
+                    sub.rowPitch = rowBytes;
+                    sub.slicePitch = numBytes;
+                    sub.width = w;
+                    sub.height = h;
+                    sub.depth = d;
+                }
+
+                offset += surfaceBytes;
+
+                w = std::max<uint32_t>(w >> 1, 1);
+                h = std::max<uint32_t>(h >> 1, 1);
+                d = std::max<uint32_t>(d >> 1, 1);
+            }
+        }
+
+        if (usedBytes)
+        {
+            *usedBytes = static_cast<size_t>(offset);
+        }
+        return S_OK;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ParseDDSTexture(const uint8_t* ddsData, size_t ddsDataSize, DDSTextureInfo& info)
+{
+    memset(&info, 0, sizeof(info));
+    info.format = DXGI_FORMAT_UNKNOWN;
+    info.alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+
+    if (!ddsData)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Validate DDS file in memory
+    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+    {
+        return E_FAIL;
+    }
+
+    uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+
+    // Verify header to validate DDS file
+    if (header->size != sizeof(DDS_HEADER) ||
+        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    // Check for DX10 extension
+    const DDS_HEADER_DXT10* d3d10ext = nullptr;
+    if ((header->ddspf.flags & DDS_FOURCC) &&
+        (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
+        {
+            return E_FAIL;
+        }
+
+        d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>(ddsData + sizeof(uint32_t) + sizeof(DDS_HEADER));
+    }
+
+    uint32_t width = header->width;
+    uint32_t height = header->height;
+    uint32_t depth = header->depth;
+
+    uint32_t resDim = 0;
+    uint32_t arraySize = 1;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    bool isCubeMap = false;
+
+    uint32_t mipCount = header->mipMapCount;
+    if (0 == mipCount)
+    {
+        mipCount = 1;
+    }
+
+    if (d3d10ext)
+    {
+        arraySize = d3d10ext->arraySize;
+        if (arraySize == 0)
+        {
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        switch (d3d10ext->dxgiFormat)
+        {
+        case DXGI_FORMAT_AI44:
+        case DXGI_FORMAT_IA44:
+        case DXGI_FORMAT_P8:
+        case DXGI_FORMAT_A8P8:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        default:
+            if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
+            {
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+        }
+
+        format = d3d10ext->dxgiFormat;
+
+        switch (d3d10ext->resourceDimension)
+        {
+        case DDS_DIMENSION_TEXTURE1D:
+            // D3DX writes 1D textures with a fixed Height of 1
+            if ((header->flags & DDS_HEIGHT) && height != 1)
+            {
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+            height = depth = 1;
+            break;
+
+        case DDS_DIMENSION_TEXTURE2D:
+            if (d3d10ext->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+            {
+                // Bound before scaling so the face count can't wrap
+                if (arraySize > MAX_ARRAY_SIZE / 6)
+                {
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+                arraySize *= 6;
+                isCubeMap = true;
+            }
+            depth = 1;
+            break;
+
+        case DDS_DIMENSION_TEXTURE3D:
+            if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
+            {
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+
+            if (arraySize > 1)
+            {
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+            break;
+
+        default:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        resDim = d3d10ext->resourceDimension;
+    }
+    else
+    {
+        format = GetDXGIFormat(header->ddspf);
+
+        if (format == DXGI_FORMAT_UNKNOWN)
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+        {
+            resDim = DDS_DIMENSION_TEXTURE3D;
+        }
+        else
+        {
+            if (header->caps2 & DDS_CUBEMAP)
+            {
+                // We require all six faces to be defined
+                if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+                {
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+
+                arraySize = 6;
+                isCubeMap = true;
+            }
+
+            depth = 1;
+            resDim = DDS_DIMENSION_TEXTURE2D;
+
+            // Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
+        }
+
+        assert(BitsPerPixel(format) != 0);
+    }
+
+    // Bound sizes (for security purposes we don't trust DDS file metadata larger than the Direct3D hardware requirements)
+    if (!width || !height || !depth)
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    switch (resDim)
+    {
+    case DDS_DIMENSION_TEXTURE1D:
+        if ((arraySize > MAX_ARRAY_SIZE) ||
+            (width > MAX_TEXTURE1D_DIMENSION))
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+        break;
+
+    case DDS_DIMENSION_TEXTURE2D:
+        if (isCubeMap)
+        {
+            // This is the right bound because we set arraySize to (NumCubes*6) above
+            if ((arraySize > MAX_ARRAY_SIZE) ||
+                (width > MAX_TEXTURECUBE_DIMENSION) ||
+                (height > MAX_TEXTURECUBE_DIMENSION))
+            {
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+        }
+        else if ((arraySize > MAX_ARRAY_SIZE) ||
+            (width > MAX_TEXTURE2D_DIMENSION) ||
+            (height > MAX_TEXTURE2D_DIMENSION))
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+        break;
+
+    case DDS_DIMENSION_TEXTURE3D:
+        if ((arraySize > 1) ||
+            (width > MAX_TEXTURE3D_DIMENSION) ||
+            (height > MAX_TEXTURE3D_DIMENSION) ||
+            (depth > MAX_TEXTURE3D_DIMENSION))
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+        break;
+    }
+
+    if (mipCount > MAX_MIP_LEVELS)
+    {
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    if (mipCount > CountMips(width, height, depth))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    DDSTextureInfo parsed = {};
+    parsed.resourceDimension = resDim;
+    parsed.width = width;
+    parsed.height = height;
+    parsed.depth = depth;
+    parsed.mipLevels = mipCount;
+    parsed.arraySize = arraySize;
+    parsed.format = format;
+    parsed.isCubeMap = isCubeMap;
+    parsed.alphaMode = GetAlphaMode(header);
+
+    const size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER) + (d3d10ext ? sizeof(DDS_HEADER_DXT10) : 0);
+    parsed.bitData = ddsData + offset;
+
+    size_t usedBytes = 0;
+    HRESULT hr = WalkSubresources(parsed, ddsDataSize - offset, &usedBytes, nullptr);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    parsed.bitSize = usedBytes;
+    info = parsed;
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+size_t DirectX::GetDDSSubresources(const DDSTextureInfo& info, DDSSubresource* subresources, size_t count)
+{
+    const size_t total = size_t(info.mipLevels) * info.arraySize;
+    if (!subresources || !info.bitData || !total || count < total)
+    {
+        return 0;
+    }
+
+    if (FAILED(WalkSubresources(info, info.bitSize, nullptr, subresources)))
+    {
+        return 0;
+    }
+    return total;
+}
@@ -21,6 +21,7 @@
 #include "pch.h"
 
 #include "DDSTextureLoader.h"
+#include "DDSParser.h"
 
 #include "dds.h"
 #include "DirectXHelpers.h"
@@ -38,22 +39,17 @@ static_assert(DDS_RESOURCE_MISC_TEXTURECUBE == D3D11_RESOURCE_MISC_TEXTURECUBE,
 namespace
 {
     //--------------------------------------------------------------------------------------
-    HRESULT FillInitData(_In_ size_t width,
-        _In_ size_t height,
-        _In_ size_t depth,
-        _In_ size_t mipCount,
+    HRESULT FillInitData(_In_ size_t mipCount,
         _In_ size_t arraySize,
-        _In_ DXGI_FORMAT format,
         _In_ size_t maxsize,
-        _In_ size_t bitSize,
-        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_reads_(mipCount*arraySize) const DDSSubresource* subresources,
         _Out_ size_t& twidth,
         _Out_ size_t& theight,
         _Out_ size_t& tdepth,
         _Out_ size_t& skipMip,
         _Out_writes_(mipCount*arraySize) D3D11_SUBRESOURCE_DATA* initData)
     {
-        if (!bitData || !initData)
+        if (!subresources || !initData)
         {
             return E_POINTER;
         }
@@ -63,41 +59,28 @@ namespace
         theight = 0;
         tdepth = 0;
 
-        size_t NumBytes = 0;
-        size_t RowBytes = 0;
-        const uint8_t* pSrcBits = bitData;
-        const uint8_t* pEndBits = bitData + bitSize;
-
+        // The parser already checked every subresource against the source bytes
         size_t index = 0;
         for (size_t j = 0; j < arraySize; j++)
         {
-            size_t w = width;
-            size_t h = height;
-            size_t d = depth;
             for (size_t i = 0; i < mipCount; i++)
             {
-                GetSurfaceInfo(w,
-                    h,
-                    format,
-                    &NumBytes,
-                    &RowBytes,
-                    nullptr
-                );
-
-                if ((mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize))
+                const DDSSubresource& sub = subresources[j * mipCount + i];
+
+                if ((mipCount <= 1) || !maxsize || (sub.width <= maxsize && sub.height <= maxsize && sub.depth <= maxsize))
                 {
                     if (!twidth)
                     {
-                        twidth = w;
-                        theight = h;
-                        tdepth = d;
+                        twidth = sub.width;
+                        theight = sub.height;
+                        tdepth = sub.depth;
                     }
 
                     assert(index < mipCount * arraySize);
                     _Analysis_assume_(index < mipCount * arraySize);
-                    initData[index].pSysMem = reinterpret_cast<const void*>(pSrcBits);
-                    initData[index].SysMemPitch = static_cast<UINT>(RowBytes);
-                    initData[index].SysMemSlicePitch = static_cast<UINT>(NumBytes);
+                    initData[index].pSysMem = reinterpret_cast<const void*>(sub.data);
+                    initData[index].SysMemPitch = static_cast<UINT>(sub.rowPitch);
+                    initData[index].SysMemSlicePitch = static_cast<UINT>(sub.slicePitch);
                     ++index;
                 }
                 else if (!j)
@@ -105,29 +88,6 @@ namespace
                     // Count number of skipped mipmaps (first item only)
                     ++skipMip;
                 }
-
-                if (pSrcBits + (NumBytes*d) > pEndBits)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                }
-
-                pSrcBits += NumBytes * d;
-
-                w = w >> 1;
-                h = h >> 1;
-                d = d >> 1;
-                if (w == 0)
-                {
-                    w = 1;
-                }
-                if (h == 0)
-                {
-                    h = 1;
-                }
-                if (d == 0)
-                {
-                    d = 1;
-                }
             }
         }
 
@@ -374,9 +334,7 @@ namespace
         _In_opt_ ID3D11DeviceX* d3dDeviceX,
         _In_opt_ ID3D11DeviceContextX* d3dContextX,
 #endif
-        _In_ const DDS_HEADER* header,
-        _In_reads_bytes_(bitSize) const uint8_t* bitData,
-        _In_ size_t bitSize,
+        _In_ const DDSTextureInfo& info,
         _In_ size_t maxsize,
         _In_ D3D11_USAGE usage,
         _In_ unsigned int bindFlags,
@@ -388,170 +346,25 @@ namespace
     {
         HRESULT hr = S_OK;
 
-        UINT width = header->width;
-        UINT height = header->height;
-        UINT depth = header->depth;
-
-        uint32_t resDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
-        UINT arraySize = 1;
-        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-        bool isCubeMap = false;
-
-        size_t mipCount = header->mipMapCount;
-        if (0 == mipCount)
-        {
-            mipCount = 1;
-        }
-
-        if ((header->ddspf.flags & DDS_FOURCC) &&
-            (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
-        {
-            auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>((const char*)header + sizeof(DDS_HEADER));
-
-            arraySize = d3d10ext->arraySize;
-            if (arraySize == 0)
-            {
-                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-            }
-
-            switch (d3d10ext->dxgiFormat)
-            {
-            case DXGI_FORMAT_AI44:
-            case DXGI_FORMAT_IA44:
-            case DXGI_FORMAT_P8:
-            case DXGI_FORMAT_A8P8:
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
-            default:
-                if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-            }
-
-            format = d3d10ext->dxgiFormat;
-
-            switch (d3d10ext->resourceDimension)
-            {
-            case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
-                // D3DX writes 1D textures with a fixed Height of 1
-                if ((header->flags & DDS_HEIGHT) && height != 1)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-                }
-                height = depth = 1;
-                break;
-
-            case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
-                if (d3d10ext->miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE)
-                {
-                    arraySize *= 6;
-                    isCubeMap = true;
-                }
-                depth = 1;
-                break;
-
-            case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
-                if (!(header->flags & DDS_HEADER_FLAGS_VOLUME))
-                {
-                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
-                }
-
-                if (arraySize > 1)
-                {
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-                break;
-
-            default:
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-
-            resDim = d3d10ext->resourceDimension;
-        }
-        else
+        // Headers and sizes were validated by ParseDDSTexture
+        UINT width = info.width;
+        UINT height = info.height;
+        UINT depth = info.depth;
+        uint32_t resDim = info.resourceDimension;
+        UINT arraySize = info.arraySize;
+        DXGI_FORMAT format = info.format;
+        bool isCubeMap = info.isCubeMap;
+        size_t mipCount = info.mipLevels;
+
+        std::unique_ptr<DDSSubresource[]> subresources(new (std::nothrow) DDSSubresource[mipCount * arraySize]);
+        if (!subresources)
         {
-            format = GetDXGIFormat(header->ddspf);
-
-            if (format == DXGI_FORMAT_UNKNOWN)
-            {
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-
-            if (header->flags & DDS_HEADER_FLAGS_VOLUME)
-            {
-                resDim = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
-            }
-            else
-            {
-                if (header->caps2 & DDS_CUBEMAP)
-                {
-                    // We require all six faces to be defined
-                    if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
-                    {
-                        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                    }
-
-                    arraySize = 6;
-                    isCubeMap = true;
-                }
-
-                depth = 1;
-                resDim = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
-
-                // Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
-            }
-
-            assert(BitsPerPixel(format) != 0);
+            return E_OUTOFMEMORY;
         }
 
-        // Bound sizes (for security purposes we don't trust DDS file metadata larger than the Direct3D hardware requirements)
-        if (mipCount > D3D11_REQ_MIP_LEVELS)
-        {
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
-
-        switch (resDim)
+        if (GetDDSSubresources(info, subresources.get(), mipCount * arraySize) != mipCount * arraySize)
         {
-        case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
-            if ((arraySize > D3D11_REQ_TEXTURE1D_ARRAY_AXIS_DIMENSION) ||
-                (width > D3D11_REQ_TEXTURE1D_U_DIMENSION))
-            {
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-            break;
-
-        case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
-            if (isCubeMap)
-            {
-                // This is the right bound because we set arraySize to (NumCubes*6) above
-                if ((arraySize > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
-                    (width > D3D11_REQ_TEXTURECUBE_DIMENSION) ||
-                    (height > D3D11_REQ_TEXTURECUBE_DIMENSION))
-                {
-                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-                }
-            }
-            else if ((arraySize > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) ||
-                (width > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION) ||
-                (height > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION))
-            {
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-            break;
-
-        case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
-            if ((arraySize > 1) ||
-                (width > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
-                (height > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION) ||
-                (depth > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION))
-            {
-                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-            }
-            break;
-
-        default:
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            return E_UNEXPECTED;
         }
 
         bool autogen = false;
@@ -587,17 +400,6 @@ namespace
                 isCubeMap, nullptr, &tex, textureView);
             if (SUCCEEDED(hr))
             {
-                size_t numBytes = 0;
-                size_t rowBytes = 0;
-                GetSurfaceInfo(width, height, format, &numBytes, &rowBytes, nullptr);
-
-                if (numBytes > bitSize)
-                {
-                    (*textureView)->Release();
-                    *textureView = nullptr;
-                    tex->Release();
-                    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                }
 
                 D3D11_SHADER_RESOURCE_VIEW_DESC desc;
                 (*textureView)->GetDesc(&desc);
@@ -628,22 +430,12 @@ namespace
                     return E_OUTOFMEMORY;
                 }
 
-                const uint8_t* pSrcBits = bitData;
-                const uint8_t* pEndBits = bitData + bitSize;
+                // mipCount is 1 here, so subresource 'item' is the top level of each item
                 for (UINT item = 0; item < arraySize; ++item)
                 {
-                    if ((pSrcBits + numBytes) > pEndBits)
-                    {
-                        (*textureView)->Release();
-                        *textureView = nullptr;
-                        tex->Release();
-                        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                    }
-
-                    initData[item].pSysMem = pSrcBits;
-                    initData[item].SysMemPitch = static_cast<UINT>(rowBytes);
-                    initData[item].SysMemSlicePitch = static_cast<UINT>(numBytes);
-                    pSrcBits += numBytes;
+                    initData[item].pSysMem = subresources[item].data;
+                    initData[item].SysMemPitch = static_cast<UINT>(subresources[item].rowPitch);
+                    initData[item].SysMemSlicePitch = static_cast<UINT>(subresources[item].slicePitch);
                 }
 
                 ID3D11Resource* pStaging = nullptr;
@@ -693,28 +485,12 @@ namespace
                     pStaging->Release();
                 }
 #else 
-                if (arraySize > 1)
-                {
-                    const uint8_t* pSrcBits = bitData;
-                    const uint8_t* pEndBits = bitData + bitSize;
-                    for (UINT item = 0; item < arraySize; ++item)
-                    {
-                        if ((pSrcBits + numBytes) > pEndBits)
-                        {
-                            (*textureView)->Release();
-                            *textureView = nullptr;
-                            tex->Release();
-                            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-                        }
-
-                        UINT res = D3D11CalcSubresource(0, item, mipLevels);
-                        d3dContext->UpdateSubresource(tex, res, nullptr, pSrcBits, static_cast<UINT>(rowBytes), static_cast<UINT>(numBytes));
-                        pSrcBits += numBytes;
-                    }
-                }
-                else
+                // mipCount is 1 here, so subresource 'item' is the top level of each item
+                for (UINT item = 0; item < arraySize; ++item)
                 {
-                    d3dContext->UpdateSubresource(tex, 0, nullptr, bitData, static_cast<UINT>(rowBytes), static_cast<UINT>(numBytes));
+                    const DDSSubresource& sub = subresources[item];
+                    UINT res = D3D11CalcSubresource(0, item, mipLevels);
+                    d3dContext->UpdateSubresource(tex, res, nullptr, sub.data, static_cast<UINT>(sub.rowPitch), static_cast<UINT>(sub.slicePitch));
                 }
 #endif
 
@@ -743,7 +519,7 @@ namespace
             size_t twidth = 0;
             size_t theight = 0;
             size_t tdepth = 0;
-            hr = FillInitData(width, height, depth, mipCount, arraySize, format, maxsize, bitSize, bitData,
+            hr = FillInitData(mipCount, arraySize, maxsize, subresources.get(),
                 twidth, theight, tdepth, skipMip, initData.get());
 
             if (SUCCEEDED(hr))
@@ -784,7 +560,7 @@ namespace
                         break;
                     }
 
-                    hr = FillInitData(width, height, depth, mipCount, arraySize, format, maxsize, bitSize, bitData,
+                    hr = FillInitData(mipCount, arraySize, maxsize, subresources.get(),
                         twidth, theight, tdepth, skipMip, initData.get());
                     if (SUCCEEDED(hr))
                     {
@@ -869,49 +645,18 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx(ID3D11Device* d3dDevice,
     }
 
     // Validate DDS file in memory
-    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
-    {
-        return E_FAIL;
-    }
-
-    uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
-    if (dwMagicNumber != DDS_MAGIC)
-    {
-        return E_FAIL;
-    }
-
-    auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
-
-    // Verify header to validate DDS file
-    if (header->size != sizeof(DDS_HEADER) ||
-        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
-    {
-        return E_FAIL;
-    }
-
-    // Check for DX10 extension
-    bool bDXT10Header = false;
-    if ((header->ddspf.flags & DDS_FOURCC) &&
-        (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+    DDSTextureInfo info;
+    HRESULT hr = ParseDDSTexture(ddsData, ddsDataSize, info);
+    if (FAILED(hr))
     {
-        // Must be long enough for both headers and magic value
-        if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-        {
-            return E_FAIL;
-        }
-
-        bDXT10Header = true;
+        return hr;
     }
 
-    ptrdiff_t offset = sizeof(uint32_t)
-        + sizeof(DDS_HEADER)
-        + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-
-    HRESULT hr = CreateTextureFromDDS(d3dDevice, nullptr,
+    hr = CreateTextureFromDDS(d3dDevice, nullptr,
 #if defined(_XBOX_ONE) && defined(_TITLE)
         nullptr, nullptr,
 #endif
-        header, ddsData + offset, ddsDataSize - offset, maxsize,
+        info, maxsize,
         usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
         texture, textureView);
     if (SUCCEEDED(hr))
@@ -927,7 +672,7 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx(ID3D11Device* d3dDevice,
         }
 
         if (alphaMode)
-            *alphaMode = GetAlphaMode(header);
+            *alphaMode = info.alphaMode;
     }
 
     return hr;
@@ -972,49 +717,18 @@ _Use_decl_annotations_
     }
 
     // Validate DDS file in memory
-    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
-    {
-        return E_FAIL;
-    }
-
-    uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
-    if (dwMagicNumber != DDS_MAGIC)
-    {
-        return E_FAIL;
-    }
-
-    auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
-
-    // Verify header to validate DDS file
-    if (header->size != sizeof(DDS_HEADER) ||
-        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
-    {
-        return E_FAIL;
-    }
-
-    // Check for DX10 extension
-    bool bDXT10Header = false;
-    if ((header->ddspf.flags & DDS_FOURCC) &&
-        (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+    DDSTextureInfo info;
+    HRESULT hr = ParseDDSTexture(ddsData, ddsDataSize, info);
+    if (FAILED(hr))
     {
-        // Must be long enough for both headers and magic value
-        if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-        {
-            return E_FAIL;
-        }
-
-        bDXT10Header = true;
+        return hr;
     }
 
-    ptrdiff_t offset = sizeof(uint32_t)
-        + sizeof(DDS_HEADER)
-        + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-
-    HRESULT hr = CreateTextureFromDDS(d3dDevice, d3dContext,
+    hr = CreateTextureFromDDS(d3dDevice, d3dContext,
 #if defined(_XBOX_ONE) && defined(_TITLE)
         d3dDevice, d3dContext,
 #endif
-        header, ddsData + offset, ddsDataSize - offset, maxsize,
+        info, maxsize,
         usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
         texture, textureView);
     if (SUCCEEDED(hr))
@@ -1030,7 +744,7 @@ _Use_decl_annotations_
         }
 
         if (alphaMode)
-            *alphaMode = GetAlphaMode(header);
+            *alphaMode = info.alphaMode;
     }
 
     return hr;
@@ -1116,11 +830,18 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(ID3D11Device* d3dDevice,
         return hr;
     }
 
+    DDSTextureInfo info;
+    hr = ParseDDSTexture(ddsData.get(), static_cast<size_t>(bitData - ddsData.get()) + bitSize, info);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     hr = CreateTextureFromDDS(d3dDevice, nullptr,
 #if defined(_XBOX_ONE) && defined(_TITLE)
         nullptr, nullptr,
 #endif
-        header, bitData, bitSize, maxsize,
+        info, maxsize,
         usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
         texture, textureView);
 
@@ -1191,7 +912,7 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(ID3D11Device* d3dDevice,
 #endif
 
         if (alphaMode)
-            *alphaMode = GetAlphaMode(header);
+            *alphaMode = info.alphaMode;
     }
 
     return hr;
@@ -1250,11 +971,18 @@ _Use_decl_annotations_
         return hr;
     }
 
+    DDSTextureInfo info;
+    hr = ParseDDSTexture(ddsData.get(), static_cast<size_t>(bitData - ddsData.get()) + bitSize, info);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     hr = CreateTextureFromDDS(d3dDevice, d3dContext,
 #if defined(_XBOX_ONE) && defined(_TITLE)
         d3dDevice, d3dContext,
 #endif
-        header, bitData, bitSize, maxsize,
+        info, maxsize,
         usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
         texture, textureView);
 
@@ -1325,7 +1053,7 @@ _Use_decl_annotations_
 #endif
 
         if (alphaMode)
-            *alphaMode = GetAlphaMode(header);
+            *alphaMode = info.alphaMode;
     }
 
     return hr;
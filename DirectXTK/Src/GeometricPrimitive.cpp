@@ -18,6 +18,7 @@
 #include "DirectXHelpers.h"
 #include "SharedResourcePool.h"
 #include "Geometry.h"
+#include "MeshOptimizer.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -87,6 +88,8 @@ public:
 
     void CreateInputLayout(_In_ IEffect* effect, _Outptr_ ID3D11InputLayout** inputLayout) const;
 
+    static bool optimizeMeshes;
+
 private:
     ComPtr<ID3D11Buffer> mVertexBuffer;
     ComPtr<ID3D11Buffer> mIndexBuffer;
@@ -121,6 +124,8 @@ private:
 // Global pool of per-device-context GeometricPrimitive resources.
 SharedResourcePool<ID3D11DeviceContext*, GeometricPrimitive::Impl::SharedResources> GeometricPrimitive::Impl::sharedResourcesPool;
 
+bool GeometricPrimitive::Impl::optimizeMeshes = false;
+
 
 // Per-device-context constructor.
 GeometricPrimitive::Impl::SharedResources::SharedResources(_In_ ID3D11DeviceContext* deviceContext)
@@ -193,8 +198,22 @@ void GeometricPrimitive::Impl::Initialize(ID3D11DeviceContext* deviceContext, co
     ComPtr<ID3D11Device> device;
     deviceContext->GetDevice(&device);
 
-    CreateBuffer(device.Get(), vertices, D3D11_BIND_VERTEX_BUFFER, &mVertexBuffer);
-    CreateBuffer(device.Get(), indices, D3D11_BIND_INDEX_BUFFER, &mIndexBuffer);
+    if (optimizeMeshes)
+    {
+        // CreateCustom passes the caller's collections, so the optimizer works on copies.
+        VertexCollection optimizedVertices(vertices);
+        IndexCollection optimizedIndices(indices);
+
+        MeshOptimizer::OptimizeMesh(optimizedVertices, optimizedIndices);
+
+        CreateBuffer(device.Get(), optimizedVertices, D3D11_BIND_VERTEX_BUFFER, &mVertexBuffer);
+        CreateBuffer(device.Get(), optimizedIndices, D3D11_BIND_INDEX_BUFFER, &mIndexBuffer);
+    }
+    else
+    {
+        CreateBuffer(device.Get(), vertices, D3D11_BIND_VERTEX_BUFFER, &mVertexBuffer);
+        CreateBuffer(device.Get(), indices, D3D11_BIND_INDEX_BUFFER, &mIndexBuffer);
+    }
 
     mIndexCount = static_cast<UINT>(indices.size());
 }
@@ -355,6 +374,18 @@ void GeometricPrimitive::CreateInputLayout(IEffect* effect, ID3D11InputLayout**
 }
 
 
+void GeometricPrimitive::SetMeshOptimization(bool enable)
+{
+    Impl::optimizeMeshes = enable;
+}
+
+
+void GeometricPrimitive::ClearGeometryCache()
+{
+    DirectX::ClearGeometryCache();
+}
+
+
 //--------------------------------------------------------------------------------------
 // Cube (aka a Hexahedron) or Box
 //--------------------------------------------------------------------------------------
@@ -365,14 +396,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateCube(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeBox(vertices, indices, XMFLOAT3(size, size, size), rhcoords, false);
+    auto geometry = GetGeometry(GeometryShape_Box, XMFLOAT3(size, size, size), 0, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -383,7 +412,10 @@ void GeometricPrimitive::CreateCube(
     float size,
     bool rhcoords)
 {
-    ComputeBox(vertices, indices, XMFLOAT3(size, size, size), rhcoords, false);
+    auto geometry = GetGeometry(GeometryShape_Box, XMFLOAT3(size, size, size), 0, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -395,14 +427,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateBox(
     bool rhcoords,
     bool invertn)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeBox(vertices, indices, size, rhcoords, invertn);
+    auto geometry = GetGeometry(GeometryShape_Box, size, 0, rhcoords, invertn);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -414,7 +444,10 @@ void GeometricPrimitive::CreateBox(
     bool rhcoords,
     bool invertn)
 {
-    ComputeBox(vertices, indices, size, rhcoords, invertn);
+    auto geometry = GetGeometry(GeometryShape_Box, size, 0, rhcoords, invertn);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -430,14 +463,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateSphere(
     bool rhcoords,
     bool invertn)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeSphere(vertices, indices, diameter, tessellation, rhcoords, invertn);
+    auto geometry = GetGeometry(GeometryShape_Sphere, XMFLOAT3(diameter, 0, 0), tessellation, rhcoords, invertn);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -450,7 +481,10 @@ void GeometricPrimitive::CreateSphere(
     bool rhcoords,
     bool invertn)
 {
-    ComputeSphere(vertices, indices, diameter, tessellation, rhcoords, invertn);
+    auto geometry = GetGeometry(GeometryShape_Sphere, XMFLOAT3(diameter, 0, 0), tessellation, rhcoords, invertn);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -465,14 +499,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateGeoSphere(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeGeoSphere(vertices, indices, diameter, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_GeoSphere, XMFLOAT3(diameter, 0, 0), tessellation, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -483,7 +515,10 @@ void GeometricPrimitive::CreateGeoSphere(
     float diameter,
     size_t tessellation, bool rhcoords)
 {
-    ComputeGeoSphere(vertices, indices, diameter, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_GeoSphere, XMFLOAT3(diameter, 0, 0), tessellation, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -500,14 +535,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateCylinder(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeCylinder(vertices, indices, height, diameter, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Cylinder, XMFLOAT3(height, diameter, 0), tessellation, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -520,7 +553,10 @@ void GeometricPrimitive::CreateCylinder(
     size_t tessellation,
     bool rhcoords)
 {
-    ComputeCylinder(vertices, indices, height, diameter, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Cylinder, XMFLOAT3(height, diameter, 0), tessellation, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -533,14 +569,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateCone(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeCone(vertices, indices, diameter, height, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Cone, XMFLOAT3(diameter, height, 0), tessellation, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -553,7 +587,10 @@ void GeometricPrimitive::CreateCone(
     size_t tessellation,
     bool rhcoords)
 {
-    ComputeCone(vertices, indices, diameter, height, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Cone, XMFLOAT3(diameter, height, 0), tessellation, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -569,14 +606,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateTorus(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeTorus(vertices, indices, diameter, thickness, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Torus, XMFLOAT3(diameter, thickness, 0), tessellation, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -589,7 +624,10 @@ void GeometricPrimitive::CreateTorus(
     size_t tessellation,
     bool rhcoords)
 {
-    ComputeTorus(vertices, indices, diameter, thickness, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Torus, XMFLOAT3(diameter, thickness, 0), tessellation, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -603,14 +641,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateTetrahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeTetrahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Tetrahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -621,7 +657,10 @@ void GeometricPrimitive::CreateTetrahedron(
     float size,
     bool rhcoords)
 {
-    ComputeTetrahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Tetrahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -635,14 +674,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateOctahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeOctahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Octahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -653,7 +690,10 @@ void GeometricPrimitive::CreateOctahedron(
     float size,
     bool rhcoords)
 {
-    ComputeOctahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Octahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -667,14 +707,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateDodecahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeDodecahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Dodecahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -685,7 +723,10 @@ void GeometricPrimitive::CreateDodecahedron(
     float size,
     bool rhcoords)
 {
-    ComputeDodecahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Dodecahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -699,14 +740,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateIcosahedron(
     float size,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeIcosahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Icosahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -717,7 +756,10 @@ void GeometricPrimitive::CreateIcosahedron(
     float size,
     bool rhcoords)
 {
-    ComputeIcosahedron(vertices, indices, size, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Icosahedron, XMFLOAT3(size, 0, 0), 0, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
@@ -732,14 +774,12 @@ std::unique_ptr<GeometricPrimitive> GeometricPrimitive::CreateTeapot(
     size_t tessellation,
     bool rhcoords)
 {
-    VertexCollection vertices;
-    IndexCollection indices;
-    ComputeTeapot(vertices, indices, size, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Teapot, XMFLOAT3(size, 0, 0), tessellation, rhcoords, false);
 
     // Create the primitive object.
     std::unique_ptr<GeometricPrimitive> primitive(new GeometricPrimitive());
 
-    primitive->pImpl->Initialize(deviceContext, vertices, indices);
+    primitive->pImpl->Initialize(deviceContext, geometry->vertices, geometry->indices);
 
     return primitive;
 }
@@ -751,7 +791,10 @@ void GeometricPrimitive::CreateTeapot(
     size_t tessellation,
     bool rhcoords)
 {
-    ComputeTeapot(vertices, indices, size, tessellation, rhcoords);
+    auto geometry = GetGeometry(GeometryShape_Teapot, XMFLOAT3(size, 0, 0), tessellation, rhcoords, false);
+
+    vertices = geometry->vertices;
+    indices = geometry->indices;
 }
 
 
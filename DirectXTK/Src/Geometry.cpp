@@ -14,6 +14,9 @@
 #include "pch.h"
 #include "Geometry.h"
 #include "Bezier.h"
+#include "PlatformHelpers.h"
+
+#include <ppl.h>
 
 using namespace DirectX;
 
@@ -39,6 +42,25 @@ namespace
     }
 
 
+    // Generation loops whose iterations fill disjoint ranges of presized collections go to the
+    // PPL pool from this many vertices on; below it the task overhead outweighs the work.
+    const size_t ParallelVertexThreshold = 4096;
+
+    template<typename TBody>
+    inline void ForEachSlice(size_t count, size_t vertexCount, TBody body)
+    {
+        if (vertexCount >= ParallelVertexThreshold)
+        {
+            concurrency::parallel_for(size_t(0), count, body);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+                body(i);
+        }
+    }
+
+
     // Helper for flipping winding of geometric primitives for LH vs. RH coords
     inline void ReverseWinding(IndexCollection& indices, VertexCollection& vertices)
     {
@@ -153,9 +175,18 @@ void DirectX::ComputeSphere(VertexCollection& vertices, IndexCollection& indices
 
     float radius = diameter / 2;
 
-    // Create rings of vertices at progressively higher latitudes.
-    for (size_t i = 0; i <= verticalSegments; i++)
+    size_t stride = horizontalSegments + 1;
+    size_t vertexCount = (verticalSegments + 1) * stride;
+    CheckIndexOverflow(vertexCount - 1);
+
+    vertices.resize(vertexCount);
+    indices.resize(verticalSegments * stride * 6);
+
+    // Each ring of vertices, and the triangles joining it to the next one, only depend on the
+    // ring number, so rings are generated independently.
+    ForEachSlice(verticalSegments + 1, vertexCount, [&](size_t i)
     {
+        // Rings go from the south pole up to the north pole.
         float v = 1 - (float)i / verticalSegments;
 
         float latitude = (i * XM_PI / verticalSegments) - XM_PIDIV2;
@@ -179,29 +210,29 @@ void DirectX::ComputeSphere(VertexCollection& vertices, IndexCollection& indices
             XMVECTOR normal = XMVectorSet(dx, dy, dz, 0);
             XMVECTOR textureCoordinate = XMVectorSet(u, v, 0, 0);
 
-            vertices.push_back(VertexPositionNormalTexture(normal * radius, normal, textureCoordinate));
+            vertices[i * stride + j] = VertexPositionNormalTexture(normal * radius, normal, textureCoordinate);
         }
-    }
 
-    // Fill the index buffer with triangles joining each pair of latitude rings.
-    size_t stride = horizontalSegments + 1;
+        if (i == verticalSegments)
+            return;
+
+        // Fill the index buffer with triangles joining this ring to the next one.
+        uint16_t* ringIndices = &indices[i * stride * 6];
 
-    for (size_t i = 0; i < verticalSegments; i++)
-    {
         for (size_t j = 0; j <= horizontalSegments; j++)
         {
             size_t nextI = i + 1;
             size_t nextJ = (j + 1) % stride;
 
-            index_push_back(indices, i * stride + j);
-            index_push_back(indices, nextI * stride + j);
-            index_push_back(indices, i * stride + nextJ);
+            *ringIndices++ = static_cast<uint16_t>(i * stride + j);
+            *ringIndices++ = static_cast<uint16_t>(nextI * stride + j);
+            *ringIndices++ = static_cast<uint16_t>(i * stride + nextJ);
 
-            index_push_back(indices, i * stride + nextJ);
-            index_push_back(indices, nextI * stride + j);
-            index_push_back(indices, nextI * stride + nextJ);
+            *ringIndices++ = static_cast<uint16_t>(i * stride + nextJ);
+            *ringIndices++ = static_cast<uint16_t>(nextI * stride + j);
+            *ringIndices++ = static_cast<uint16_t>(nextI * stride + nextJ);
         }
-    }
+    });
 
     // Build RH above
     if (!rhcoords)
@@ -215,27 +246,61 @@ void DirectX::ComputeSphere(VertexCollection& vertices, IndexCollection& indices
 //--------------------------------------------------------------------------------------
 // Geodesic sphere
 //--------------------------------------------------------------------------------------
-void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation, bool rhcoords)
+namespace
 {
-    vertices.clear();
-    indices.clear();
+    // Open addressing table from an undirected edge to the index of the vertex which lies midway
+    // between its two vertices. Becuse the edge is undirected, (a,b) is the same as (b,a): keys
+    // pack the larger index in the high half. Zero never is a valid key, as a != b.
+    class EdgeSubdivisionMap
+    {
+    public:
+        explicit EdgeSubdivisionMap(size_t edgeCount)
+        {
+            // At most half full, so probe sequences stay short.
+            mShift = 31;
+            while ((size_t(1) << (32 - mShift)) < edgeCount * 2)
+                mShift--;
 
-    // An undirected edge between two vertices, represented by a pair of indexes into a vertex array.
-    // Becuse this edge is undirected, (a,b) is the same as (b,a).
-    typedef std::pair<uint16_t, uint16_t> UndirectedEdge;
+            mKeys.assign(size_t(1) << (32 - mShift), 0);
+            mValues.resize(mKeys.size());
+        }
 
-    // Makes an undirected edge. Rather than overloading comparison operators to give us the (a,b)==(b,a) property,
-    // we'll just ensure that the larger of the two goes first. This'll simplify things greatly.
-    auto makeUndirectedEdge = [](uint16_t a, uint16_t b)
-    {
-        return std::make_pair(std::max(a, b), std::min(a, b));
-    };
+        // Returns the slot for the edge's midpoint index. inserted tells whether the edge was new,
+        // in which case the caller must fill the slot.
+        uint16_t& FindOrInsert(uint16_t a, uint16_t b, bool& inserted)
+        {
+            uint32_t key = (uint32_t(std::max(a, b)) << 16) | std::min(a, b);
+            size_t mask = mKeys.size() - 1;
+
+            // Fibonacci hashing keeps the high bits, which depend on both indices.
+            for (size_t slot = (key * 2654435769u) >> mShift; ; slot = (slot + 1) & mask)
+            {
+                if (mKeys[slot] == key)
+                {
+                    inserted = false;
+                    return mValues[slot];
+                }
+
+                if (!mKeys[slot])
+                {
+                    mKeys[slot] = key;
+                    inserted = true;
+                    return mValues[slot];
+                }
+            }
+        }
 
-    // Key: an edge
-    // Value: the index of the vertex which lies midway between the two vertices pointed to by the key value
-    // This map is used to avoid duplicating vertices when subdividing triangles along edges.
-    typedef std::map<UndirectedEdge, uint16_t> EdgeSubdivisionMap;
+    private:
+        std::vector<uint32_t> mKeys;
+        std::vector<uint16_t> mValues;
+        uint32_t mShift;
+    };
+}
 
+void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation, bool rhcoords)
+{
+    vertices.clear();
+    indices.clear();
 
     static const XMFLOAT3 OctahedronVertices[] =
     {
@@ -277,13 +342,16 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
     {
         assert(indices.size() % 3 == 0); // sanity
 
-        // We use this to keep track of which edges have already been subdivided.
-        EdgeSubdivisionMap subdividedEdges;
+        const size_t triangleCount = indices.size() / 3;
+
+        // We use this to keep track of which edges have already been subdivided. The mesh is
+        // closed, so every edge is shared by two triangles.
+        EdgeSubdivisionMap subdividedEdges(triangleCount * 3 / 2);
 
         // The new index collection after subdivision.
         IndexCollection newIndices;
+        newIndices.reserve(indices.size() * 4);
 
-        const size_t triangleCount = indices.size() / 3;
         for (size_t iTriangle = 0; iTriangle < triangleCount; ++iTriangle)
         {
             // For each edge on this triangle, create a new vertex in the middle of that edge.
@@ -305,14 +373,13 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
             // Function that, when given the index of two vertices, creates a new vertex at the midpoint of those vertices.
             auto divideEdge = [&](uint16_t i0, uint16_t i1, XMFLOAT3& outVertex, uint16_t& outIndex)
             {
-                const UndirectedEdge edge = makeUndirectedEdge(i0, i1);
-
                 // Check to see if we've already generated this vertex
-                auto it = subdividedEdges.find(edge);
-                if (it != subdividedEdges.end())
+                bool inserted;
+                uint16_t& midpoint = subdividedEdges.FindOrInsert(i0, i1, inserted);
+                if (!inserted)
                 {
                     // We've already generated this vertex before
-                    outIndex = it->second; // the index of this vertex
+                    outIndex = midpoint; // the index of this vertex
                     outVertex = vertexPositions[outIndex]; // and the vertex itself
                 }
                 else
@@ -333,7 +400,7 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
                     vertexPositions.push_back(outVertex);
 
                     // Now add it to the map.
-                    subdividedEdges.insert(std::make_pair(edge, outIndex));
+                    midpoint = outIndex;
                 }
             };
 
@@ -364,10 +431,10 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
     }
 
     // Now that we've completed subdivision, fill in the final vertex collection
-    vertices.reserve(vertexPositions.size());
-    for (auto it = vertexPositions.begin(); it != vertexPositions.end(); ++it)
+    vertices.resize(vertexPositions.size());
+    ForEachSlice(vertexPositions.size(), vertexPositions.size(), [&](size_t i)
     {
-        auto vertexValue = *it;
+        auto vertexValue = vertexPositions[i];
 
         auto normal = XMVector3Normalize(XMLoadFloat3(&vertexValue));
         auto pos = XMVectorScale(normal, radius);
@@ -383,8 +450,8 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
         float v = latitude / XM_PI;
 
         auto texcoord = XMVectorSet(1.0f - u, v, 0.0f, 0.0f);
-        vertices.push_back(VertexPositionNormalTexture(pos, normal, texcoord));
-    }
+        vertices[i] = VertexPositionNormalTexture(pos, normal, texcoord);
+    });
 
     // There are a couple of fixes to do. One is a texture coordinate wraparound fixup. At some point, there will be
     // a set of triangles somewhere in the mesh with texture coordinates such that the wraparound across 0.0/1.0
@@ -397,6 +464,31 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
     // y=1 and ending at y=-1, and sweeping across the range of z=0 to z=1. x stays zero. It's along this edge that we
     // need to duplicate our vertices - and provide the correct texture coordinates.
     size_t preFixupVertexCount = vertices.size();
+
+    // The triangles using each vertex, in index buffer order. Fixing a vertex only replaces its own
+    // index, with a new one past preFixupVertexCount, so the lists stay valid as we go.
+    std::vector<uint32_t> vertexTriangleStart(preFixupVertexCount + 1, 0);
+    std::vector<uint32_t> vertexTriangles(indices.size());
+
+    for (auto it = indices.begin(); it != indices.end(); ++it)
+    {
+        vertexTriangleStart[*it + 1]++;
+    }
+
+    for (size_t i = 0; i < preFixupVertexCount; ++i)
+    {
+        vertexTriangleStart[i + 1] += vertexTriangleStart[i];
+    }
+
+    {
+        std::vector<uint32_t> cursor(vertexTriangleStart.begin(), vertexTriangleStart.end() - 1);
+
+        for (size_t j = 0; j < indices.size(); ++j)
+        {
+            vertexTriangles[cursor[indices[j]]++] = static_cast<uint32_t>(j - j % 3);
+        }
+    }
+
     for (size_t i = 0; i < preFixupVertexCount; ++i)
     {
         // This vertex is on the prime meridian if position.x and texcoord.u are both zero (allowing for small epsilon).
@@ -416,8 +508,10 @@ void DirectX::ComputeGeoSphere(VertexCollection& vertices, IndexCollection& indi
             vertices.push_back(v);
 
             // Now find all the triangles which contain this vertex and update them if necessary
-            for (size_t j = 0; j < indices.size(); j += 3)
+            for (uint32_t k = vertexTriangleStart[i]; k < vertexTriangleStart[i + 1]; ++k)
             {
+                size_t j = vertexTriangles[k];
+
                 uint16_t* triIndex0 = &indices[j + 0];
                 uint16_t* triIndex1 = &indices[j + 1];
                 uint16_t* triIndex2 = &indices[j + 2];
@@ -716,9 +810,15 @@ void DirectX::ComputeTorus(VertexCollection& vertices, IndexCollection& indices,
         throw std::out_of_range("tesselation parameter out of range");
 
     size_t stride = tessellation + 1;
+    size_t vertexCount = stride * stride;
+    CheckIndexOverflow(vertexCount - 1);
 
-    // First we loop around the main ring of the torus.
-    for (size_t i = 0; i <= tessellation; i++)
+    vertices.resize(vertexCount);
+    indices.resize(vertexCount * 6);
+
+    // First we loop around the main ring of the torus. Each slice of the tube only depends on
+    // its position around the ring, so slices are generated independently.
+    ForEachSlice(stride, vertexCount, [&](size_t i)
     {
         float u = (float)i / tessellation;
 
@@ -746,21 +846,22 @@ void DirectX::ComputeTorus(VertexCollection& vertices, IndexCollection& indices,
             position = XMVector3Transform(position, transform);
             normal = XMVector3TransformNormal(normal, transform);
 
-            vertices.push_back(VertexPositionNormalTexture(position, normal, textureCoordinate));
+            vertices[i * stride + j] = VertexPositionNormalTexture(position, normal, textureCoordinate);
 
             // And create indices for two triangles.
             size_t nextI = (i + 1) % stride;
             size_t nextJ = (j + 1) % stride;
 
-            index_push_back(indices, i * stride + j);
-            index_push_back(indices, i * stride + nextJ);
-            index_push_back(indices, nextI * stride + j);
+            uint16_t* quadIndices = &indices[(i * stride + j) * 6];
+            quadIndices[0] = static_cast<uint16_t>(i * stride + j);
+            quadIndices[1] = static_cast<uint16_t>(i * stride + nextJ);
+            quadIndices[2] = static_cast<uint16_t>(nextI * stride + j);
 
-            index_push_back(indices, i * stride + nextJ);
-            index_push_back(indices, nextI * stride + nextJ);
-            index_push_back(indices, nextI * stride + j);
+            quadIndices[3] = static_cast<uint16_t>(i * stride + nextJ);
+            quadIndices[4] = static_cast<uint16_t>(nextI * stride + nextJ);
+            quadIndices[5] = static_cast<uint16_t>(nextI * stride + j);
         }
-    }
+    });
 
     // Build RH above
     if (!rhcoords)
@@ -1117,8 +1218,9 @@ namespace
 {
 #include "TeapotData.inc"
 
-    // Tessellates the specified bezier patch.
-    void XM_CALLCONV TessellatePatch(VertexCollection& vertices, IndexCollection& indices, TeapotPatch const& patch, size_t tessellation, FXMVECTOR scale, bool isMirrored)
+    // Tessellates the specified bezier patch into (tessellation + 1)^2 vertices starting at
+    // vertices[vbase] and tessellation^2 * 6 indices.
+    void XM_CALLCONV TessellatePatch(VertexPositionNormalTexture* vertices, uint16_t* indices, size_t vbase, TeapotPatch const& patch, size_t tessellation, FXMVECTOR scale, bool isMirrored)
     {
         // Look up the 16 control points for this patch.
         XMVECTOR controlPoints[16];
@@ -1129,18 +1231,27 @@ namespace
         }
 
         // Create the index data.
-        size_t vbase = vertices.size();
         Bezier::CreatePatchIndices(tessellation, isMirrored, [&](size_t index)
         {
-            index_push_back(indices, vbase + index);
+            *indices++ = static_cast<uint16_t>(vbase + index);
         });
 
         // Create the vertex data.
+        vertices += vbase;
         Bezier::CreatePatchVertices(controlPoints, tessellation, isMirrored, [&](FXMVECTOR position, FXMVECTOR normal, FXMVECTOR textureCoordinate)
         {
-            vertices.push_back(VertexPositionNormalTexture(position, normal, textureCoordinate));
+            *vertices++ = VertexPositionNormalTexture(position, normal, textureCoordinate);
         });
     }
+
+
+    // One tessellation of a patch: which scale vector (see ComputeTeapot) and whether it is mirrored.
+    struct TeapotPatchInstance
+    {
+        TeapotPatch const* patch;
+        int scale;
+        bool isMirrored;
+    };
 }
 
         
@@ -1155,9 +1266,15 @@ void DirectX::ComputeTeapot(VertexCollection& vertices, IndexCollection& indices
 
     XMVECTOR scaleVector = XMVectorReplicate(size);
 
-    XMVECTOR scaleNegateX = scaleVector * g_XMNegateX;
-    XMVECTOR scaleNegateZ = scaleVector * g_XMNegateZ;
-    XMVECTOR scaleNegateXZ = scaleVector * g_XMNegateX * g_XMNegateZ;
+    const XMVECTOR scales[4] =
+    {
+        scaleVector,
+        scaleVector * g_XMNegateX,
+        scaleVector * g_XMNegateZ,
+        scaleVector * g_XMNegateX * g_XMNegateZ,
+    };
+
+    std::vector<TeapotPatchInstance> instances;
 
     for (int i = 0; i < sizeof(TeapotPatches) / sizeof(TeapotPatches[0]); i++)
     {
@@ -1165,20 +1282,134 @@ void DirectX::ComputeTeapot(VertexCollection& vertices, IndexCollection& indices
 
         // Because the teapot is symmetrical from left to right, we only store
         // data for one side, then tessellate each patch twice, mirroring in X.
-        TessellatePatch(vertices, indices, patch, tessellation, scaleVector, false);
-        TessellatePatch(vertices, indices, patch, tessellation, scaleNegateX, true);
+        instances.push_back({ &patch, 0, false });
+        instances.push_back({ &patch, 1, true });
 
         if (patch.mirrorZ)
         {
             // Some parts of the teapot (the body, lid, and rim, but not the
             // handle or spout) are also symmetrical from front to back, so
             // we tessellate them four times, mirroring in Z as well as X.
-            TessellatePatch(vertices, indices, patch, tessellation, scaleNegateZ, true);
-            TessellatePatch(vertices, indices, patch, tessellation, scaleNegateXZ, false);
+            instances.push_back({ &patch, 2, true });
+            instances.push_back({ &patch, 3, false });
         }
     }
 
+    // Every patch has the same number of vertices and indices, so each one knows where its output
+    // goes and patches are tessellated independently.
+    size_t patchVertexCount = (tessellation + 1) * (tessellation + 1);
+    size_t patchIndexCount = tessellation * tessellation * 6;
+    size_t vertexCount = instances.size() * patchVertexCount;
+    CheckIndexOverflow(vertexCount - 1);
+
+    vertices.resize(vertexCount);
+    indices.resize(instances.size() * patchIndexCount);
+
+    ForEachSlice(instances.size(), vertexCount, [&](size_t i)
+    {
+        TeapotPatchInstance const& instance = instances[i];
+
+        TessellatePatch(vertices.data(), &indices[i * patchIndexCount], i * patchVertexCount, *instance.patch, tessellation, scales[instance.scale], instance.isMirrored);
+    });
+
     // Built RH above
     if (!rhcoords)
         ReverseWinding(indices, vertices);
+}
+
+//--------------------------------------------------------------------------------------
+// Cache
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Every parameter that affects the generated geometry. All members are 32 bits wide, so
+    // there is no padding and keys compare as raw bytes.
+    struct GeometryKey
+    {
+        uint32_t shape;
+        uint32_t tessellation;
+        uint32_t flags;
+        float params[3];
+
+        bool operator< (GeometryKey const& other) const
+        {
+            return memcmp(this, &other, sizeof(GeometryKey)) < 0;
+        }
+    };
+
+    static_assert(sizeof(GeometryKey) == 6 * sizeof(uint32_t), "GeometryKey must not be padded");
+
+    std::mutex geometryCacheMutex;
+    std::map<GeometryKey, std::shared_ptr<const GeometryData>> geometryCache;
+
+
+    void ComputeGeometry(GeometryData& data, GeometryShape shape, const XMFLOAT3& params, size_t tessellation, bool rhcoords, bool invertn)
+    {
+        VertexCollection& vertices = data.vertices;
+        IndexCollection& indices = data.indices;
+
+        switch (shape)
+        {
+        case GeometryShape_Box:             ComputeBox(vertices, indices, params, rhcoords, invertn); break;
+        case GeometryShape_Sphere:          ComputeSphere(vertices, indices, params.x, tessellation, rhcoords, invertn); break;
+        case GeometryShape_GeoSphere:       ComputeGeoSphere(vertices, indices, params.x, tessellation, rhcoords); break;
+        case GeometryShape_Cylinder:        ComputeCylinder(vertices, indices, params.x, params.y, tessellation, rhcoords); break;
+        case GeometryShape_Cone:            ComputeCone(vertices, indices, params.x, params.y, tessellation, rhcoords); break;
+        case GeometryShape_Torus:           ComputeTorus(vertices, indices, params.x, params.y, tessellation, rhcoords); break;
+        case GeometryShape_Tetrahedron:     ComputeTetrahedron(vertices, indices, params.x, rhcoords); break;
+        case GeometryShape_Octahedron:      ComputeOctahedron(vertices, indices, params.x, rhcoords); break;
+        case GeometryShape_Dodecahedron:    ComputeDodecahedron(vertices, indices, params.x, rhcoords); break;
+        case GeometryShape_Icosahedron:     ComputeIcosahedron(vertices, indices, params.x, rhcoords); break;
+        case GeometryShape_Teapot:          ComputeTeapot(vertices, indices, params.x, tessellation, rhcoords); break;
+
+        default:
+            throw std::exception("Unknown geometry shape");
+        }
+    }
+}
+
+
+std::shared_ptr<const GeometryData> DirectX::GetGeometry(GeometryShape shape, const XMFLOAT3& params, size_t tessellation, bool rhcoords, bool invertn)
+{
+    GeometryKey key;
+    key.shape = static_cast<uint32_t>(shape);
+    key.tessellation = static_cast<uint32_t>(tessellation);
+    key.flags = (rhcoords ? 1u : 0u) | (invertn ? 2u : 0u);
+    key.params[0] = params.x;
+    key.params[1] = params.y;
+    key.params[2] = params.z;
+
+    if (key.tessellation != tessellation)
+        throw std::out_of_range("tesselation parameter out of range");
+
+    {
+        std::lock_guard<std::mutex> lock(geometryCacheMutex);
+
+        auto pos = geometryCache.find(key);
+
+        if (pos != geometryCache.end())
+            return pos->second;
+    }
+
+    // Generate outside the lock, so primitives of different shapes can be created concurrently. If
+    // two threads race on the same key the first entry stored wins and the other is dropped.
+    auto data = std::make_shared<GeometryData>();
+
+    ComputeGeometry(*data, shape, params, tessellation, rhcoords, invertn);
+
+    std::lock_guard<std::mutex> lock(geometryCacheMutex);
+
+    return geometryCache.insert(std::make_pair(key, std::shared_ptr<const GeometryData>(std::move(data)))).first->second;
+}
+
+
+void DirectX::ClearGeometryCache()
+{
+    std::map<GeometryKey, std::shared_ptr<const GeometryData>> released;
+
+    {
+        std::lock_guard<std::mutex> lock(geometryCacheMutex);
+
+        released.swap(geometryCache);
+    }
 }
\ No newline at end of file
@@ -29,4 +29,32 @@ namespace DirectX
     void ComputeDodecahedron(VertexCollection& vertices, IndexCollection& indices, float size, bool rhcoords);
     void ComputeIcosahedron(VertexCollection& vertices, IndexCollection& indices, float size, bool rhcoords);
     void ComputeTeapot(VertexCollection& vertices, IndexCollection& indices, float size, size_t tessellation, bool rhcoords);
+
+    // Shapes memoized by GetGeometry, with the meaning of params.x/y/z in the order of the
+    // matching Compute* arguments. Unused params, tessellation and invertn must be zero.
+    enum GeometryShape
+    {
+        GeometryShape_Box,          // size.x, size.y, size.z
+        GeometryShape_Sphere,       // diameter
+        GeometryShape_GeoSphere,    // diameter
+        GeometryShape_Cylinder,     // height, diameter
+        GeometryShape_Cone,         // diameter, height
+        GeometryShape_Torus,        // diameter, thickness
+        GeometryShape_Tetrahedron,  // size
+        GeometryShape_Octahedron,   // size
+        GeometryShape_Dodecahedron, // size
+        GeometryShape_Icosahedron,  // size
+        GeometryShape_Teapot,       // size
+    };
+
+    struct GeometryData
+    {
+        VertexCollection vertices;
+        IndexCollection indices;
+    };
+
+    // Returns the output of the Compute* function for the shape, generating it on first use.
+    // Entries are immutable and shared by every caller and thread until ClearGeometryCache.
+    std::shared_ptr<const GeometryData> GetGeometry(GeometryShape shape, const XMFLOAT3& params, size_t tessellation, bool rhcoords, bool invertn);
+    void ClearGeometryCache();
 }
\ No newline at end of file
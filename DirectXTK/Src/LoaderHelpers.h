@@ -15,8 +15,12 @@
 
 #pragma once
 
-#include "DDS.h"
-#include "DDSTextureLoader.h"
+#include "dds.h"
+#include "DDSParser.h"
+
+#if defined(_WIN32)
+#include "PlatformHelpers.h"
+#endif
 
 
 namespace DirectX
@@ -283,6 +287,7 @@ namespace DirectX
             }
         }
 
+#if defined(_WIN32)
         //--------------------------------------------------------------------------------------
         inline HRESULT LoadTextureDataFromFile(_In_z_ const wchar_t* fileName,
             std::unique_ptr<uint8_t[]>& ddsData,
@@ -400,6 +405,7 @@ namespace DirectX
 
             return S_OK;
         }
+#endif // _WIN32
 
         //--------------------------------------------------------------------------------------
         // Get surface information for a particular format
@@ -485,6 +491,9 @@ namespace DirectX
                 break;
 
 #endif
+
+            default:
+                break;
             }
 
             if (bc)
@@ -798,6 +807,9 @@ namespace DirectX
                     case DDS_ALPHA_MODE_OPAQUE:
                     case DDS_ALPHA_MODE_CUSTOM:
                         return mode;
+
+                    default:
+                        break;
                     }
                 }
                 else if ((MAKEFOURCC('D', 'X', 'T', '2') == header->ddspf.fourCC)
@@ -810,6 +822,7 @@ namespace DirectX
             return DDS_ALPHA_MODE_UNKNOWN;
         }
 
+#if defined(_WIN32)
         //--------------------------------------------------------------------------------------
         class auto_delete_file
         {
@@ -858,6 +871,7 @@ namespace DirectX
             LPCWSTR m_filename;
             Microsoft::WRL::ComPtr<IWICStream>& m_handle;
         };
+#endif // _WIN32
 
     }
 }
\ No newline at end of file
@@ -0,0 +1,760 @@
+//--------------------------------------------------------------------------------------
+// File: MeshOptimizer.cpp
+//
+// Vertex cache (Forsyth, Tipsify), overdraw and vertex fetch ordering of triangle lists
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace DirectX;
+using namespace DirectX::MeshOptimizer;
+
+namespace
+{
+    const uint32_t NoTriangle = uint32_t(-1);
+
+
+    // Throws on anything the orderings below cannot index safely.
+    template<typename index_t>
+    void ValidateTriangleList(_In_reads_(indexCount) const index_t* indices, size_t indexCount, size_t vertexCount)
+    {
+        if (!indices && indexCount)
+            throw std::runtime_error("Indices cannot be null");
+
+        if (indexCount % 3)
+            throw std::runtime_error("Expected triangular faces");
+
+        if (vertexCount >= UnusedVertex)
+            throw std::runtime_error("Too many vertices");
+
+        for (size_t j = 0; j < indexCount; ++j)
+        {
+            if (indices[j] >= vertexCount)
+                throw std::runtime_error("Index not in vertices list");
+        }
+    }
+
+
+    void ValidateCacheSize(uint32_t cacheSize)
+    {
+        if (cacheSize < MinCacheSize || cacheSize > MaxCacheSize)
+            throw std::runtime_error("Cache size out of range");
+    }
+
+
+    // Vertex to triangle adjacency in compressed rows; a degenerate triangle is listed once per corner.
+    struct Adjacency
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        template<typename index_t>
+        void Build(_In_reads_(faceCount * 3) const index_t* indices, size_t faceCount, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+
+            for (size_t j = 0; j < faceCount * 3; ++j)
+                ++offsets[indices[j] + 1];
+
+            for (size_t v = 0; v < vertexCount; ++v)
+                offsets[v + 1] += offsets[v];
+
+            triangles.resize(faceCount * 3);
+
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+            for (size_t j = 0; j < faceCount * 3; ++j)
+                triangles[fill[indices[j]]++] = static_cast<uint32_t>(j / 3);
+        }
+
+        uint32_t Valence(size_t vertex) const { return offsets[vertex + 1] - offsets[vertex]; }
+    };
+
+
+    // FIFO post-transform cache. A vertex is resident while fewer than cacheSize
+    // insertions happened after its own; Flush() ages every entry out at once.
+    class FifoCache
+    {
+    public:
+        FifoCache(size_t vertexCount, uint32_t cacheSize)
+            : mInserted(vertexCount, 0),
+              mClock(cacheSize),
+              mCacheSize(cacheSize)
+        {
+        }
+
+        // Returns true on a miss.
+        bool Access(uint32_t vertex)
+        {
+            if (mClock - mInserted[vertex] < mCacheSize)
+                return false;
+
+            mInserted[vertex] = ++mClock;
+            return true;
+        }
+
+        void Flush() { mClock += mCacheSize; }
+
+    private:
+        std::vector<uint64_t> mInserted;
+        uint64_t mClock;
+        uint64_t mCacheSize;
+    };
+
+
+    //----------------------------------------------------------------------------------
+    // Forsyth, "Linear-Speed Vertex Cache Optimisation"
+    //----------------------------------------------------------------------------------
+
+    const float CacheDecayPower = 1.5f;
+    const float LastTriScore = 0.75f;
+    const float ValenceBoostScale = 2.0f;
+    const float ValenceBoostPower = 0.5f;
+
+    const uint32_t MaxValenceScore = 32;
+
+    class ForsythScores
+    {
+    public:
+        explicit ForsythScores(uint32_t cacheSize)
+        {
+            for (uint32_t i = 0; i < cacheSize; ++i)
+            {
+                if (i < 3)
+                {
+                    // The last triangle's vertices score the same, so no fan direction is favoured.
+                    mCache[i] = LastTriScore;
+                }
+                else
+                {
+                    float scale = 1.0f - float(i - 3) / float(cacheSize - 3);
+                    mCache[i] = powf(scale, CacheDecayPower);
+                }
+            }
+
+            mValence[0] = 0;
+            for (uint32_t i = 1; i < MaxValenceScore; ++i)
+                mValence[i] = ValenceBoostScale * powf(float(i), -ValenceBoostPower);
+        }
+
+        float Score(int cachePosition, uint32_t liveTriangles) const
+        {
+            if (!liveTriangles)
+                return -1.0f;
+
+            float score = (cachePosition >= 0) ? mCache[cachePosition] : 0.0f;
+
+            score += (liveTriangles < MaxValenceScore) ? mValence[liveTriangles]
+                                                      : ValenceBoostScale * powf(float(liveTriangles), -ValenceBoostPower);
+
+            return score;
+        }
+
+    private:
+        float mCache[MaxCacheSize];
+        float mValence[MaxValenceScore];
+    };
+
+
+    template<typename index_t>
+    void ForsythOrder(_In_reads_(faceCount * 3) const index_t* indices, size_t faceCount, size_t vertexCount, uint32_t cacheSize,
+                      _Out_writes_(faceCount * 3) index_t* result)
+    {
+        const ForsythScores scores(cacheSize);
+
+        Adjacency adjacency;
+        adjacency.Build(indices, faceCount, vertexCount);
+
+        // The first live[v] entries of each adjacency row are the triangles not emitted yet.
+        std::vector<uint32_t> live(vertexCount);
+        std::vector<float> vertexScore(vertexCount);
+
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            live[v] = adjacency.Valence(v);
+            vertexScore[v] = scores.Score(-1, live[v]);
+        }
+
+        std::vector<uint8_t> emitted(faceCount, 0);
+
+        // Three extra slots hold the entries a new triangle pushes past the end.
+        uint32_t cache[MaxCacheSize + 3];
+        uint32_t nextCache[MaxCacheSize + 3];
+        size_t cacheCount = 0;
+
+        size_t cursor = 0;
+        uint32_t best = NoTriangle;
+
+        for (size_t n = 0; n < faceCount; ++n)
+        {
+            if (best == NoTriangle)
+            {
+                // Nothing left around the cache; restart from the next triangle in input order.
+                while (emitted[cursor])
+                    ++cursor;
+
+                best = static_cast<uint32_t>(cursor);
+            }
+
+            const index_t* tri = indices + best * 3;
+            memcpy(result + n * 3, tri, sizeof(index_t) * 3);
+            emitted[best] = 1;
+
+            size_t nextCount = 0;
+
+            for (size_t k = 0; k < 3; ++k)
+            {
+                uint32_t v = tri[k];
+
+                uint32_t* row = adjacency.triangles.data() + adjacency.offsets[v];
+                uint32_t* last = row + live[v] - 1;
+                *std::find(row, last, best) = *last;
+                --live[v];
+
+                if (std::find(nextCache, nextCache + nextCount, v) == nextCache + nextCount)
+                    nextCache[nextCount++] = v;
+            }
+
+            for (size_t i = 0; i < cacheCount; ++i)
+            {
+                uint32_t v = cache[i];
+
+                if (std::find(nextCache, nextCache + nextCount, v) == nextCache + nextCount)
+                    nextCache[nextCount++] = v;
+            }
+
+            // Entries that fell off the end lose their cache score.
+            for (size_t i = cacheSize; i < nextCount; ++i)
+            {
+                uint32_t v = nextCache[i];
+
+                vertexScore[v] = scores.Score(-1, live[v]);
+            }
+
+            cacheCount = std::min<size_t>(nextCount, cacheSize);
+
+            for (size_t i = 0; i < cacheCount; ++i)
+            {
+                uint32_t v = nextCache[i];
+
+                cache[i] = v;
+                vertexScore[v] = scores.Score(static_cast<int>(i), live[v]);
+            }
+
+            // Only triangles touching the cache can score above the unconnected rest.
+            best = NoTriangle;
+            float bestScore = -1.0f;
+
+            for (size_t i = 0; i < cacheCount; ++i)
+            {
+                uint32_t v = cache[i];
+
+                const uint32_t* row = adjacency.triangles.data() + adjacency.offsets[v];
+
+                for (uint32_t j = 0; j < live[v]; ++j)
+                {
+                    uint32_t t = row[j];
+
+                    float score = vertexScore[indices[t * 3]]
+                                + vertexScore[indices[t * 3 + 1]]
+                                + vertexScore[indices[t * 3 + 2]];
+
+                    if (score > bestScore)
+                    {
+                        bestScore = score;
+                        best = t;
+                    }
+                }
+            }
+        }
+    }
+
+
+    //----------------------------------------------------------------------------------
+    // Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and
+    // Reduced Overdraw"
+    //----------------------------------------------------------------------------------
+
+    // hardBoundaries receives the first triangle of every run that starts with a cold cache.
+    template<typename index_t>
+    void TipsifyOrder(_In_reads_(faceCount * 3) const index_t* indices, size_t faceCount, size_t vertexCount, uint32_t cacheSize,
+                      _Out_writes_(faceCount * 3) index_t* result, _Out_opt_ std::vector<uint32_t>* hardBoundaries)
+    {
+        Adjacency adjacency;
+        adjacency.Build(indices, faceCount, vertexCount);
+
+        std::vector<uint32_t> live(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            live[v] = adjacency.Valence(v);
+
+        std::vector<uint32_t> timeStamp(vertexCount, 0);
+        std::vector<uint8_t> emitted(faceCount, 0);
+
+        std::vector<uint32_t> deadEnd;
+        deadEnd.reserve(faceCount * 3);
+
+        std::vector<uint32_t> candidates;
+        candidates.reserve(64);
+
+        if (hardBoundaries)
+            hardBoundaries->clear();
+
+        uint32_t stamp = cacheSize + 1;
+        size_t cursor = 0;
+        size_t n = 0;
+
+        auto skipDeadEnd = [&]() -> uint32_t
+        {
+            while (!deadEnd.empty())
+            {
+                uint32_t d = deadEnd.back();
+                deadEnd.pop_back();
+
+                if (live[d])
+                    return d;
+            }
+
+            // Nothing recent is left; the cache is effectively flushed.
+            while (cursor < vertexCount)
+            {
+                if (live[cursor])
+                {
+                    if (hardBoundaries)
+                        hardBoundaries->push_back(static_cast<uint32_t>(n));
+
+                    return static_cast<uint32_t>(cursor);
+                }
+
+                ++cursor;
+            }
+
+            return UnusedVertex;
+        };
+
+        uint32_t fan = skipDeadEnd();
+
+        while (fan != UnusedVertex)
+        {
+            candidates.clear();
+
+            for (uint32_t j = adjacency.offsets[fan]; j < adjacency.offsets[fan + 1]; ++j)
+            {
+                uint32_t t = adjacency.triangles[j];
+                if (emitted[t])
+                    continue;
+
+                emitted[t] = 1;
+
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    uint32_t v = indices[t * 3 + k];
+
+                    result[n * 3 + k] = static_cast<index_t>(v);
+
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+
+                    if (stamp - timeStamp[v] > cacheSize)
+                        timeStamp[v] = stamp++;
+                }
+
+                ++n;
+            }
+
+            // Prefer the oldest candidate that will still be in the cache after its own fan.
+            fan = UnusedVertex;
+            int bestPriority = -1;
+
+            for (auto v : candidates)
+            {
+                if (!live[v])
+                    continue;
+
+                int priority = 0;
+                if (stamp - timeStamp[v] + 2 * live[v] <= cacheSize)
+                    priority = static_cast<int>(stamp - timeStamp[v]);
+
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fan = v;
+                }
+            }
+
+            if (fan == UnusedVertex)
+                fan = skipDeadEnd();
+        }
+
+        assert(n == faceCount);
+    }
+
+
+    inline const XMFLOAT3& PositionAt(_In_ const XMFLOAT3* positions, size_t stride, uint32_t vertex)
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * stride);
+    }
+
+
+    struct TriangleGeometry
+    {
+        float centroid[3];
+        float normal[3];    // unnormalized, its length is twice the area
+    };
+
+    template<typename index_t>
+    TriangleGeometry ComputeTriangle(_In_reads_(3) const index_t* tri, _In_ const XMFLOAT3* positions, size_t stride)
+    {
+        const XMFLOAT3& a = PositionAt(positions, stride, tri[0]);
+        const XMFLOAT3& b = PositionAt(positions, stride, tri[1]);
+        const XMFLOAT3& c = PositionAt(positions, stride, tri[2]);
+
+        float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+        float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+
+        TriangleGeometry g;
+        g.centroid[0] = (a.x + b.x + c.x) / 3.0f;
+        g.centroid[1] = (a.y + b.y + c.y) / 3.0f;
+        g.centroid[2] = (a.z + b.z + c.z) / 3.0f;
+        g.normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        g.normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        g.normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        return g;
+    }
+
+    inline float Length(_In_reads_(3) const float* v)
+    {
+        return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+
+
+    template<typename index_t>
+    void OverdrawOrder(_Inout_updates_(faceCount * 3) index_t* indices, size_t faceCount, _In_ const XMFLOAT3* positions, size_t stride,
+                       size_t vertexCount, float threshold, uint32_t cacheSize)
+    {
+        std::vector<index_t> ordered(faceCount * 3);
+        std::vector<uint32_t> hardBoundaries;
+        TipsifyOrder(indices, faceCount, vertexCount, cacheSize, ordered.data(), &hardBoundaries);
+        hardBoundaries.push_back(static_cast<uint32_t>(faceCount));
+
+        // Cut each cold-cache run further wherever the part so far already reaches (about) the
+        // ACMR of the whole run; the extra cache flushes then cost little.
+        std::vector<uint32_t> clusters;
+        FifoCache cache(vertexCount, cacheSize);
+
+        auto misses = [&](size_t t)
+        {
+            return int(cache.Access(ordered[t * 3])) + int(cache.Access(ordered[t * 3 + 1])) + int(cache.Access(ordered[t * 3 + 2]));
+        };
+
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+        {
+            size_t begin = hardBoundaries[h];
+            size_t end = hardBoundaries[h + 1];
+
+            cache.Flush();
+            size_t total = 0;
+            for (size_t t = begin; t < end; ++t)
+                total += misses(t);
+
+            float limit = threshold * float(total) / float(end - begin);
+
+            cache.Flush();
+            size_t start = begin;
+            size_t count = 0;
+            for (size_t t = begin; t < end; ++t)
+            {
+                count += misses(t);
+
+                if (t + 1 < end && float(count) <= limit * float(t + 1 - start))
+                {
+                    clusters.push_back(static_cast<uint32_t>(start));
+                    start = t + 1;
+                    count = 0;
+                    cache.Flush();
+                }
+            }
+
+            clusters.push_back(static_cast<uint32_t>(start));
+        }
+
+        clusters.push_back(static_cast<uint32_t>(faceCount));
+
+        // Area weighted centroid of the mesh, and which way its triangles face: the signed
+        // volume is negative when the winding makes the geometric normals point inwards.
+        float center[3] = {};
+        float area = 0.0f;
+        for (size_t t = 0; t < faceCount; ++t)
+        {
+            auto g = ComputeTriangle(ordered.data() + t * 3, positions, stride);
+            float a = Length(g.normal);
+            for (size_t k = 0; k < 3; ++k)
+                center[k] += g.centroid[k] * a;
+            area += a;
+        }
+
+        if (area > 0.0f)
+        {
+            for (size_t k = 0; k < 3; ++k)
+                center[k] /= area;
+        }
+
+        float volume = 0.0f;
+        for (size_t t = 0; t < faceCount; ++t)
+        {
+            auto g = ComputeTriangle(ordered.data() + t * 3, positions, stride);
+            for (size_t k = 0; k < 3; ++k)
+                volume += (g.centroid[k] - center[k]) * g.normal[k];
+        }
+
+        const float orientation = (volume < 0.0f) ? -1.0f : 1.0f;
+
+        // Clusters that face outwards the most are the likeliest occluders, so they draw first.
+        size_t clusterCount = clusters.size() - 1;
+
+        std::vector<float> sortKeys(clusterCount);
+        std::vector<uint32_t> sortOrder(clusterCount);
+
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            float centroid[3] = {};
+            float normal[3] = {};
+            float clusterArea = 0.0f;
+
+            for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                auto g = ComputeTriangle(ordered.data() + t * 3, positions, stride);
+                float a = Length(g.normal);
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    centroid[k] += g.centroid[k] * a;
+                    normal[k] += g.normal[k];
+                }
+                clusterArea += a;
+            }
+
+            float key = 0.0f;
+            float normalLength = Length(normal);
+            if (clusterArea > 0.0f && normalLength > 0.0f)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                    key += (centroid[k] / clusterArea - center[k]) * normal[k];
+
+                key *= orientation / normalLength;
+            }
+
+            sortKeys[c] = key;
+            sortOrder[c] = static_cast<uint32_t>(c);
+        }
+
+        std::stable_sort(sortOrder.begin(), sortOrder.end(), [&](uint32_t a, uint32_t b)
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        index_t* out = indices;
+        for (auto c : sortOrder)
+        {
+            size_t count = (clusters[c + 1] - clusters[c]) * 3;
+            memcpy(out, ordered.data() + clusters[c] * 3, count * sizeof(index_t));
+            out += count;
+        }
+    }
+
+
+    template<typename index_t>
+    void OptimizeFacesImpl(_Inout_updates_(indexCount) index_t* indices, size_t indexCount, size_t vertexCount, FaceOrder order, uint32_t cacheSize)
+    {
+        ValidateTriangleList(indices, indexCount, vertexCount);
+        ValidateCacheSize(cacheSize);
+
+        if (indexCount < 6)
+            return;
+
+        std::vector<index_t> result(indexCount);
+
+        switch (order)
+        {
+        case FaceOrder_Forsyth:
+            ForsythOrder(indices, indexCount / 3, vertexCount, cacheSize, result.data());
+            break;
+
+        case FaceOrder_Tipsify:
+            TipsifyOrder(indices, indexCount / 3, vertexCount, cacheSize, result.data(), nullptr);
+            break;
+
+        default:
+            throw std::runtime_error("Unknown face order");
+        }
+
+        memcpy(indices, result.data(), indexCount * sizeof(index_t));
+    }
+
+
+    template<typename index_t>
+    void OptimizeOverdrawImpl(_Inout_updates_(indexCount) index_t* indices, size_t indexCount, _In_ const XMFLOAT3* positions, size_t positionStride,
+                              size_t vertexCount, float threshold, uint32_t cacheSize)
+    {
+        ValidateTriangleList(indices, indexCount, vertexCount);
+        ValidateCacheSize(cacheSize);
+
+        if (!positions || positionStride < sizeof(XMFLOAT3))
+            throw std::runtime_error("Invalid positions");
+
+        if (indexCount < 6)
+            return;
+
+        OverdrawOrder(indices, indexCount / 3, positions, positionStride, vertexCount, threshold, cacheSize);
+    }
+
+
+    template<typename index_t>
+    size_t OptimizeVertexFetchImpl(_Inout_updates_(indexCount) index_t* indices, size_t indexCount, size_t vertexCount, _Out_writes_(vertexCount) uint32_t* vertexRemap)
+    {
+        ValidateTriangleList(indices, indexCount, vertexCount);
+
+        if (!vertexRemap && vertexCount)
+            throw std::runtime_error("Remap cannot be null");
+
+        std::fill(vertexRemap, vertexRemap + vertexCount, UnusedVertex);
+
+        uint32_t next = 0;
+        for (size_t j = 0; j < indexCount; ++j)
+        {
+            uint32_t& remap = vertexRemap[indices[j]];
+            if (remap == UnusedVertex)
+                remap = next++;
+
+            indices[j] = static_cast<index_t>(remap);
+        }
+
+        return next;
+    }
+
+
+    template<typename index_t>
+    VertexCacheStats AnalyzeVertexCacheImpl(_In_reads_(indexCount) const index_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+    {
+        ValidateTriangleList(indices, indexCount, vertexCount);
+
+        if (!cacheSize)
+            throw std::runtime_error("Cache size out of range");
+
+        VertexCacheStats stats = {};
+        stats.triangles = indexCount / 3;
+
+        std::vector<uint8_t> used(vertexCount, 0);
+        FifoCache cache(vertexCount, cacheSize);
+
+        for (size_t j = 0; j < indexCount; ++j)
+        {
+            uint32_t v = indices[j];
+
+            if (cache.Access(v))
+                ++stats.transformed;
+
+            if (!used[v])
+            {
+                used[v] = 1;
+                ++stats.vertices;
+            }
+        }
+
+        stats.acmr = stats.triangles ? float(stats.transformed) / float(stats.triangles) : 0.0f;
+        stats.atvr = stats.vertices ? float(stats.transformed) / float(stats.vertices) : 0.0f;
+
+        return stats;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Public entry points
+//--------------------------------------------------------------------------------------
+
+_Use_decl_annotations_
+void MeshOptimizer::OptimizeFaces(uint16_t* indices, size_t indexCount, size_t vertexCount, FaceOrder order, uint32_t cacheSize)
+{
+    OptimizeFacesImpl(indices, indexCount, vertexCount, order, cacheSize);
+}
+
+_Use_decl_annotations_
+void MeshOptimizer::OptimizeFaces(uint32_t* indices, size_t indexCount, size_t vertexCount, FaceOrder order, uint32_t cacheSize)
+{
+    OptimizeFacesImpl(indices, indexCount, vertexCount, order, cacheSize);
+}
+
+
+_Use_decl_annotations_
+void MeshOptimizer::OptimizeOverdraw(uint16_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t positionStride, size_t vertexCount,
+                                     float threshold, uint32_t cacheSize)
+{
+    OptimizeOverdrawImpl(indices, indexCount, positions, positionStride, vertexCount, threshold, cacheSize);
+}
+
+_Use_decl_annotations_
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t positionStride, size_t vertexCount,
+                                     float threshold, uint32_t cacheSize)
+{
+    OptimizeOverdrawImpl(indices, indexCount, positions, positionStride, vertexCount, threshold, cacheSize);
+}
+
+
+_Use_decl_annotations_
+size_t MeshOptimizer::OptimizeVertexFetch(uint16_t* indices, size_t indexCount, size_t vertexCount, uint32_t* vertexRemap)
+{
+    return OptimizeVertexFetchImpl(indices, indexCount, vertexCount, vertexRemap);
+}
+
+_Use_decl_annotations_
+size_t MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t* vertexRemap)
+{
+    return OptimizeVertexFetchImpl(indices, indexCount, vertexCount, vertexRemap);
+}
+
+
+_Use_decl_annotations_
+void MeshOptimizer::RemapVertices(const void* vertices, size_t stride, size_t vertexCount, const uint32_t* vertexRemap, void* optimizedVertices)
+{
+    if (!vertexCount)
+        return;
+
+    if (!vertices || !vertexRemap || !optimizedVertices || !stride)
+        throw std::runtime_error("Invalid arguments");
+
+    auto src = reinterpret_cast<const uint8_t*>(vertices);
+    auto dest = reinterpret_cast<uint8_t*>(optimizedVertices);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (vertexRemap[v] != UnusedVertex)
+            memcpy(dest + vertexRemap[v] * stride, src + v * stride, stride);
+    }
+}
+
+
+_Use_decl_annotations_
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint16_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    return AnalyzeVertexCacheImpl(indices, indexCount, vertexCount, cacheSize);
+}
+
+_Use_decl_annotations_
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    return AnalyzeVertexCacheImpl(indices, indexCount, vertexCount, cacheSize);
+}
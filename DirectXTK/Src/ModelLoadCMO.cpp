@@ -17,157 +17,20 @@
 #include "DDSTextureLoader.h"
 #include "Effects.h"
 #include "VertexTypes.h"
+#include "MeshOptimizer.h"
+#include "ModelParser.h"
 
 #include "DirectXHelpers.h"
 #include "PlatformHelpers.h"
 #include "BinaryReader.h"
 
+#include "CMO.h"
+
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
 
-//--------------------------------------------------------------------------------------
-// .CMO files are built by Visual Studio 2012 and an example renderer is provided
-// in the VS Direct3D Starter Kit
-// http://code.msdn.microsoft.com/Visual-Studio-3D-Starter-455a15f1
-//--------------------------------------------------------------------------------------
-
-namespace VSD3DStarter
-{
-    // .CMO files
-
-    // UINT - Mesh count
-    // { [Mesh count]
-    //      UINT - Length of name
-    //      wchar_t[] - Name of mesh (if length > 0)
-    //      UINT - Material count
-    //      { [Material count]
-    //          UINT - Length of material name
-    //          wchar_t[] - Name of material (if length > 0)
-    //          Material structure
-    //          UINT - Length of pixel shader name
-    //          wchar_t[] - Name of pixel shader (if length > 0)
-    //          { [8]
-    //              UINT - Length of texture name
-    //              wchar_t[] - Name of texture (if length > 0)
-    //          }
-    //      }
-    //      BYTE - 1 if there is skeletal animation data present
-    //      UINT - SubMesh count
-    //      { [SubMesh count]
-    //          SubMesh structure
-    //      }
-    //      UINT - IB Count
-    //      { [IB Count]
-    //          UINT - Number of USHORTs in IB
-    //          USHORT[] - Array of indices
-    //      }
-    //      UINT - VB Count
-    //      { [VB Count]
-    //          UINT - Number of verts in VB
-    //          Vertex[] - Array of vertices
-    //      }
-    //      UINT - Skinning VB Count
-    //      { [Skinning VB Count]
-    //          UINT - Number of verts in Skinning VB
-    //          SkinningVertex[] - Array of skinning verts
-    //      }
-    //      MeshExtents structure
-    //      [If skeleton animation data is not present, file ends here]
-    //      UINT - Bone count
-    //      { [Bone count]
-    //          UINT - Length of bone name
-    //          wchar_t[] - Bone name (if length > 0)
-    //          Bone structure
-    //      }
-    //      UINT - Animation clip count
-    //      { [Animation clip count]
-    //          UINT - Length of clip name
-    //          wchar_t[] - Clip name (if length > 0)
-    //          float - Start time
-    //          float - End time
-    //          UINT - Keyframe count
-    //          { [Keyframe count]
-    //              Keyframe structure
-    //          }
-    //      }
-    // }
-
-    #pragma pack(push,1)
-
-    struct Material
-    {
-        DirectX::XMFLOAT4   Ambient;
-        DirectX::XMFLOAT4   Diffuse;
-        DirectX::XMFLOAT4   Specular;
-        float               SpecularPower;
-        DirectX::XMFLOAT4   Emissive;
-        DirectX::XMFLOAT4X4 UVTransform;
-    };
-
-    const uint32_t MAX_TEXTURE = 8;
-
-    struct SubMesh
-    {
-        UINT MaterialIndex;
-        UINT IndexBufferIndex;
-        UINT VertexBufferIndex;
-        UINT StartIndex;
-        UINT PrimCount;
-    };
-
-    const uint32_t NUM_BONE_INFLUENCES = 4;
-
-    static_assert( sizeof(VertexPositionNormalTangentColorTexture) == 52, "mismatch with CMO vertex type" );
-
-    struct SkinningVertex
-    {
-        UINT boneIndex[NUM_BONE_INFLUENCES];
-        float boneWeight[NUM_BONE_INFLUENCES];
-    };
-
-    struct MeshExtents
-    {
-        float CenterX, CenterY, CenterZ;
-        float Radius;
-
-        float MinX, MinY, MinZ;
-        float MaxX, MaxY, MaxZ;
-    };
-
-    struct Bone
-    {
-        INT ParentIndex;
-        DirectX::XMFLOAT4X4 InvBindPos;
-        DirectX::XMFLOAT4X4 BindPos;
-        DirectX::XMFLOAT4X4 LocalTransform;
-    };
-    
-    struct Clip
-    {
-        float StartTime;
-        float EndTime;
-        UINT  keys;
-    };
-
-    struct Keyframe
-    {
-        UINT BoneIndex;
-        float Time;
-        DirectX::XMFLOAT4X4 Transform;
-    };
-
-    #pragma pack(pop)
-
-}; // namespace
-
-static_assert( sizeof(VSD3DStarter::Material) == 132, "CMO Mesh structure size incorrect" );
-static_assert( sizeof(VSD3DStarter::SubMesh) == 20, "CMO Mesh structure size incorrect" );
-static_assert( sizeof(VSD3DStarter::SkinningVertex)== 32, "CMO Mesh structure size incorrect" );
-static_assert( sizeof(VSD3DStarter::MeshExtents)== 40, "CMO Mesh structure size incorrect" );
-static_assert( sizeof(VSD3DStarter::Bone) == 196, "CMO Mesh structure size incorrect" );
-static_assert( sizeof(VSD3DStarter::Clip) == 12, "CMO Mesh structure size incorrect" );
-static_assert( sizeof(VSD3DStarter::Keyframe)== 72, "CMO Mesh structure size incorrect" );
+static_assert( sizeof(VertexPositionNormalTangentColorTexture) == VSD3DStarter::VERTEX_SIZE, "mismatch with CMO vertex type" );
 
 //--------------------------------------------------------------------------------------
 struct MaterialRecordCMO
@@ -237,7 +100,7 @@ static BOOL CALLBACK InitializeDecl( PINIT_ONCE initOnce, PVOID Parameter, PVOID
 //======================================================================================
 
 _Use_decl_annotations_
-std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, const uint8_t* meshData, size_t dataSize, IEffectFactory& fxFactory, bool ccw, bool pmalpha )
+std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, const uint8_t* meshData, size_t dataSize, IEffectFactory& fxFactory, bool ccw, bool pmalpha, bool optimize )
 {
     if ( !InitOnceExecuteOnce( &g_InitOnce, InitializeDecl, nullptr, nullptr ) )
         throw std::exception("One-time initialization failed");
@@ -247,133 +110,44 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
 
     auto fxFactoryDGSL = dynamic_cast<DGSLEffectFactory*>( &fxFactory );
 
-    // Meshes
-    auto nMesh = reinterpret_cast<const UINT*>( meshData );
-    size_t usedSize = sizeof(UINT);
-    if ( dataSize < usedSize )
-        throw std::exception("End of file");
-
-    if ( !*nMesh )
-        throw std::exception("No meshes found");
+    std::vector<CMOMeshInfo> meshInfo;
+    ParseCMO( meshData, dataSize, meshInfo );
 
     std::unique_ptr<Model> model(new Model());
 
-    for( UINT meshIndex = 0; meshIndex < *nMesh; ++meshIndex )
+    for( auto& mi : meshInfo )
     {
-        // Mesh name
-        auto nName = reinterpret_cast<const UINT*>( meshData + usedSize );
-        usedSize += sizeof(UINT);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
-        auto meshName = reinterpret_cast<const wchar_t*>( meshData + usedSize );
-
-        usedSize += sizeof(wchar_t)*(*nName);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
         auto mesh = std::make_shared<ModelMesh>();
-        mesh->name.assign( meshName, *nName );
+        mesh->name.assign( reinterpret_cast<const wchar_t*>( mi.name.chars ), mi.name.length );
         mesh->ccw = ccw;
         mesh->pmalpha = pmalpha;
 
         // Materials
-        auto nMats = reinterpret_cast<const UINT*>( meshData + usedSize );
-        usedSize += sizeof(UINT);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
+        size_t nMats = mi.materials.size();
 
         std::vector<MaterialRecordCMO> materials;
-        materials.reserve( *nMats );
-        for( UINT j = 0; j < *nMats; ++j )
+        materials.reserve( nMats );
+        for( auto& mat : mi.materials )
         {
             MaterialRecordCMO m;
-
-            // Material name
-            nName = reinterpret_cast<const UINT*>( meshData + usedSize );
-            usedSize += sizeof(UINT);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            auto matName = reinterpret_cast<const wchar_t*>( meshData + usedSize );
-
-            usedSize += sizeof(wchar_t)*(*nName);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            m.name.assign( matName, *nName );
-
-            // Material settings
-            auto matSetting = reinterpret_cast<const VSD3DStarter::Material*>( meshData + usedSize );
-            usedSize += sizeof(VSD3DStarter::Material);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            m.pMaterial = matSetting;
-
-            // Pixel shader name
-            nName = reinterpret_cast<const UINT*>( meshData + usedSize );
-            usedSize += sizeof(UINT);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            auto psName = reinterpret_cast<const wchar_t*>( meshData + usedSize );
-
-            usedSize += sizeof(wchar_t)*(*nName);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            m.pixelShader.assign( psName, *nName );
+            m.name.assign( reinterpret_cast<const wchar_t*>( mat.name.chars ), mat.name.length );
+            m.pMaterial = mat.material;
+            m.pixelShader.assign( reinterpret_cast<const wchar_t*>( mat.pixelShader.chars ), mat.pixelShader.length );
 
             for( UINT t = 0; t < VSD3DStarter::MAX_TEXTURE; ++t )
             {
-                nName = reinterpret_cast<const UINT*>( meshData + usedSize );
-                usedSize += sizeof(UINT);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-
-                auto txtName = reinterpret_cast<const wchar_t*>( meshData + usedSize );
-
-                usedSize += sizeof(wchar_t)*(*nName);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-
-                m.texture[t].assign( txtName, *nName );
+                m.texture[t].assign( reinterpret_cast<const wchar_t*>( mat.textures[t].chars ), mat.textures[t].length );
             }
 
             materials.emplace_back( m );
         }
 
-        assert( materials.size() == *nMats );
-
-        // Skeletal data?
-        auto bSkeleton = reinterpret_cast<const BYTE*>( meshData + usedSize );
-        usedSize += sizeof(BYTE);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
         // Submeshes
-        auto nSubmesh = reinterpret_cast<const UINT*>( meshData + usedSize );
-        usedSize += sizeof(UINT);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
-        if ( !*nSubmesh )
-            throw std::exception("No submeshes found\n");
-
-        auto subMesh = reinterpret_cast<const VSD3DStarter::SubMesh*>( meshData + usedSize );
-        usedSize += sizeof(VSD3DStarter::SubMesh) * (*nSubmesh);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
+        auto subMesh = mi.submeshes;
+        size_t nSubmesh = mi.submeshCount;
 
         // Index buffers
-        auto nIBs = reinterpret_cast<const UINT*>( meshData + usedSize );
-        usedSize += sizeof(UINT);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
-        if ( !*nIBs )
-            throw std::exception("No index buffers found\n");
+        size_t nIBs = mi.indexBuffers.size();
 
         struct IBData
         {
@@ -382,30 +156,48 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
         };
 
         std::vector<IBData> ibData;
-        ibData.reserve( *nIBs );
+        ibData.reserve( nIBs );
 
         std::vector<ComPtr<ID3D11Buffer>> ibs;
-        ibs.resize( *nIBs );
+        ibs.resize( nIBs );
+
+        std::vector<std::unique_ptr<USHORT[]>> optimizedIBs;
 
-        for( UINT j = 0; j < *nIBs; ++j )
+        for( UINT j = 0; j < nIBs; ++j )
         {
-            auto nIndexes = reinterpret_cast<const UINT*>( meshData + usedSize );
-            usedSize += sizeof(UINT);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
+            size_t nIndexes = mi.indexBuffers[j].indexCount;
+            size_t ibBytes = sizeof(USHORT) * nIndexes;
 
-            if ( !*nIndexes )
-                throw std::exception("Empty index buffer found\n");
+            auto indexes = mi.indexBuffers[j].indices;
 
-            size_t ibBytes = sizeof(USHORT) * (*(nIndexes));
+            if ( optimize )
+            {
+                // Reorder the triangles of every submesh drawn from this buffer, in a copy of the file data
+                std::unique_ptr<USHORT[]> optimized( new USHORT[ nIndexes ] );
+                memcpy( optimized.get(), indexes, ibBytes );
+
+                for( UINT k = 0; k < nSubmesh; ++k )
+                {
+                    auto& sm = subMesh[ k ];
 
-            auto indexes = reinterpret_cast<const USHORT*>( meshData + usedSize );
-            usedSize += ibBytes;
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
+                    if ( sm.IndexBufferIndex != j )
+                        continue;
+
+                    auto first = optimized.get() + sm.StartIndex;
+                    size_t count = sm.PrimCount * 3;
+                    if ( !count )
+                        continue;
+
+                    size_t nVerts = size_t( *std::max_element( first, first + count ) ) + 1;
+                    MeshOptimizer::OptimizeFaces( first, count, nVerts );
+                }
+
+                indexes = optimized.get();
+                optimizedIBs.emplace_back( std::move( optimized ) );
+            }
 
             IBData ib;
-            ib.nIndices = *nIndexes;
+            ib.nIndices = nIndexes;
             ib.ptr = indexes;
             ibData.emplace_back( ib );
 
@@ -424,93 +216,15 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
             SetDebugObjectName( ibs[j].Get(), "ModelCMO" ); 
         }
 
-        assert( ibData.size() == *nIBs );
-        assert( ibs.size() == *nIBs );
+        assert( ibData.size() == nIBs );
+        assert( ibs.size() == nIBs );
 
         // Vertex buffers
-        auto nVBs = reinterpret_cast<const UINT*>( meshData + usedSize );
-        usedSize += sizeof(UINT);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
-        if ( !*nVBs )
-            throw std::exception("No vertex buffers found\n");
-
-        struct VBData
-        {
-            size_t                                          nVerts;
-            const VertexPositionNormalTangentColorTexture*  ptr;
-            const VSD3DStarter::SkinningVertex*             skinPtr;
-        };
-
-        std::vector<VBData> vbData;
-        vbData.reserve( *nVBs );
-        for( UINT j = 0; j < *nVBs; ++j )
-        {
-            auto nVerts = reinterpret_cast<const UINT*>( meshData + usedSize );
-            usedSize += sizeof(UINT);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            if ( !*nVerts )
-                throw std::exception("Empty vertex buffer found\n");
-
-            size_t vbBytes = sizeof(VertexPositionNormalTangentColorTexture) * (*(nVerts));
-
-            auto verts = reinterpret_cast<const VertexPositionNormalTangentColorTexture*>( meshData + usedSize );
-            usedSize += vbBytes;
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            VBData vb;
-            vb.nVerts = *nVerts;
-            vb.ptr = verts;
-            vb.skinPtr = nullptr;
-            vbData.emplace_back( vb );
-        }
-
-        assert( vbData.size() == *nVBs );
-
-        // Skinning vertex buffers
-        auto nSkinVBs = reinterpret_cast<const UINT*>( meshData + usedSize );
-        usedSize += sizeof(UINT);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
-
-        if ( *nSkinVBs )
-        {
-            if ( *nSkinVBs != *nVBs )
-                throw std::exception("Number of VBs not equal to number of skin VBs");
-
-            for( UINT j = 0; j < *nSkinVBs; ++j )
-            {
-                auto nVerts = reinterpret_cast<const UINT*>( meshData + usedSize );
-                usedSize += sizeof(UINT);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-
-                if ( !*nVerts )
-                    throw std::exception("Empty skinning vertex buffer found\n");
-
-                if ( vbData[ j ].nVerts != *nVerts )
-                    throw std::exception("Mismatched number of verts for skin VBs");
-    
-                size_t vbBytes = sizeof(VSD3DStarter::SkinningVertex) * (*(nVerts));
-
-                auto verts = reinterpret_cast<const VSD3DStarter::SkinningVertex*>( meshData + usedSize );
-                usedSize += vbBytes;
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-
-                vbData[j].skinPtr = verts;
-            }
-        }
+        size_t nVBs = mi.vertexBuffers.size();
+        auto& vbData = mi.vertexBuffers;
 
         // Extents
-        auto extents = reinterpret_cast<const VSD3DStarter::MeshExtents*>( meshData + usedSize );
-        usedSize += sizeof(VSD3DStarter::MeshExtents);
-        if ( dataSize < usedSize )
-            throw std::exception("End of file");
+        auto extents = mi.extents;
 
         mesh->boundingSphere.Center.x = extents->CenterX;
         mesh->boundingSphere.Center.y = extents->CenterY;
@@ -521,102 +235,20 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
         XMVECTOR max = XMVectorSet( extents->MaxX, extents->MaxY, extents->MaxZ, 0.f );
         BoundingBox::CreateFromPoints( mesh->boundingBox, min, max );
 
-#if 0
-        // Animation data
-        if ( *bSkeleton )
-        {
-            // Bones
-            auto nBones = reinterpret_cast<const UINT*>( meshData + usedSize );
-            usedSize += sizeof(UINT);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            if ( !*nBones )
-                throw std::exception("Animation bone data is missing\n");
-
-            for( UINT j = 0; j < *nBones; ++j )
-            {
-                // Bone name
-                nName = reinterpret_cast<const UINT*>( meshData + usedSize );
-                usedSize += sizeof(UINT);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-
-                auto boneName = reinterpret_cast<const wchar_t*>( meshData + usedSize );
-
-                usedSize += sizeof(wchar_t)*(*nName);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-                
-                // TODO - What to do with bone name?
-                boneName;
-
-                // Bone settings
-                auto bones = reinterpret_cast<const VSD3DStarter::Bone*>( meshData + usedSize );
-                usedSize += sizeof(VSD3DStarter::Bone);
-                if ( dataSize < usedSize )  
-                    throw std::exception("End of file");
-
-                // TODO - What to do with bone data?
-                bones;
-            }
-
-            // Animation Clips
-            auto nClips = reinterpret_cast<const UINT*>( meshData + usedSize );
-            usedSize += sizeof(UINT);
-            if ( dataSize < usedSize )
-                throw std::exception("End of file");
-
-            for( UINT j = 0; j < *nClips; ++j )
-            {
-                // Clip name
-                nName = reinterpret_cast<const UINT*>( meshData + usedSize );
-                usedSize += sizeof(UINT);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
+        // TODO - Animation data (mi.hasSkeleton) is not loaded
 
-                auto clipName = reinterpret_cast<const wchar_t*>( meshData + usedSize );
-
-                usedSize += sizeof(wchar_t)*(*nName);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-                
-                // TODO - What to do with clip name?
-                clipName;
-
-                auto clip = reinterpret_cast<const VSD3DStarter::Clip*>( meshData + usedSize );
-                usedSize += sizeof(VSD3DStarter::Clip);
-                if ( dataSize < usedSize )
-                    throw std::exception("End of file");
-
-                if ( !clip->keys )
-                    throw std::exception("Keyframes missing in clip");
-
-                auto keys = reinterpret_cast<const VSD3DStarter::Keyframe*>( meshData + usedSize );
-                usedSize += sizeof(VSD3DStarter::Keyframe) * clip->keys;
-                if ( dataSize < usedSize )  
-                    throw std::exception("End of file");
-
-                // TODO - What to do with keys and clip->StartTime, clip->EndTime?
-                keys;
-            }
-        }
-#else
-        UNREFERENCED_PARAMETER(bSkeleton);
-#endif
-
-        bool enableSkinning = ( *nSkinVBs ) != 0;
+        bool enableSkinning = mi.skinning;
 
         // Build vertex buffers
         std::vector<ComPtr<ID3D11Buffer>> vbs;
-        vbs.resize( *nVBs );
+        vbs.resize( nVBs );
 
         const size_t stride = enableSkinning ? sizeof(VertexPositionNormalTangentColorTextureSkinning)
                                              : sizeof(VertexPositionNormalTangentColorTexture);
 
-        for( UINT j = 0; j < *nVBs; ++j )
+        for( UINT j = 0; j < nVBs; ++j )
         {
-            size_t nVerts = vbData[ j ].nVerts;
+            size_t nVerts = vbData[ j ].vertexCount;
 
             size_t bytes = stride * nVerts;
 
@@ -629,7 +261,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
             {
                 // Can use CMO vertex data directly
                 D3D11_SUBRESOURCE_DATA initData = {};
-                initData.pSysMem = vbData[j].ptr;
+                initData.pSysMem = vbData[j].vertices;
 
                 ThrowIfFailed(
                     d3dDevice->CreateBuffer( &desc, &initData, &vbs[j] )
@@ -642,17 +274,17 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
                 auto visited = reinterpret_cast<UINT*>( temp.get() + bytes );
                 memset( visited, 0xff, sizeof(UINT) * nVerts );
 
-                assert( vbData[j].ptr != 0 );
+                assert( vbData[j].vertices != 0 );
 
                 if ( enableSkinning )
                 {
                     // Combine CMO multi-stream data into a single stream
-                    auto skinptr = vbData[j].skinPtr;
+                    auto skinptr = vbData[j].skinning;
                     assert( skinptr != 0 );
 
                     uint8_t* ptr = temp.get();
 
-                    auto sptr = vbData[j].ptr;
+                    auto sptr = reinterpret_cast<const VertexPositionNormalTangentColorTexture*>( vbData[j].vertices );
 
                     for( size_t v = 0; v < nVerts; ++v )
                     {
@@ -668,23 +300,19 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
                 }
                 else
                 {
-                    memcpy( temp.get(), vbData[j].ptr, bytes );
+                    memcpy( temp.get(), vbData[j].vertices, bytes );
                 }
 
                 if ( !fxFactoryDGSL )
                 {
                     // Need to fix up VB tex coords for UV transform which is not supported by basic effects
-                    for( UINT k = 0; k < *nSubmesh; ++k )
+                    for( UINT k = 0; k < nSubmesh; ++k )
                     {
                         auto& sm = subMesh[ k ];
 
                         if ( sm.VertexBufferIndex != j )
                             continue;
 
-                        if ( (sm.IndexBufferIndex >= *nIBs)
-                             || (sm.MaterialIndex >= *nMats) )
-                             throw std::exception("Invalid submesh found\n");
-
                         XMMATRIX uvTransform = XMLoadFloat4x4( &materials[ sm.MaterialIndex ].pMaterial->UVTransform );
 
                         auto ib = ibData[ sm.IndexBufferIndex ].ptr;
@@ -741,10 +369,10 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
             SetDebugObjectName( vbs[j].Get(), "ModelCMO" ); 
         }
 
-        assert( vbs.size() == *nVBs );
+        assert( vbs.size() == nVBs );
         
         // Create Effects
-        for( UINT j = 0; j < *nMats; ++j )
+        for( UINT j = 0; j < nMats; ++j )
         {
             auto& m = materials[ j ];
 
@@ -797,15 +425,10 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
         }
 
         // Build mesh parts
-        for( UINT j = 0; j < *nSubmesh; ++j )
+        for( UINT j = 0; j < nSubmesh; ++j )
         {
             auto& sm = subMesh[j];
 
-            if ( (sm.IndexBufferIndex >= *nIBs)
-                 || (sm.VertexBufferIndex >= *nVBs)
-                 || (sm.MaterialIndex >= *nMats) )
-                 throw std::exception("Invalid submesh found\n");
-
             auto& mat = materials[ sm.MaterialIndex ];
 
             auto part = new ModelMeshPart();
@@ -834,18 +457,17 @@ std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, c
 
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, const wchar_t* szFileName, IEffectFactory& fxFactory, bool ccw, bool pmalpha )
+std::unique_ptr<Model> DirectX::Model::CreateFromCMO( ID3D11Device* d3dDevice, const wchar_t* szFileName, IEffectFactory& fxFactory, bool ccw, bool pmalpha, bool optimize )
 {
-    size_t dataSize = 0;
-    std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile( szFileName, data, &dataSize );
+    MappedFileView file;
+    HRESULT hr = file.Open( szFileName );
     if ( FAILED(hr) )
     {
         DebugTrace( "CreateFromCMO failed (%08X) loading '%ls'\n", hr, szFileName );
         throw std::exception( "CreateFromCMO" );
     }
 
-    auto model = CreateFromCMO( d3dDevice, data.get(), dataSize, fxFactory, ccw, pmalpha );
+    auto model = CreateFromCMO( d3dDevice, file.GetData(), file.GetSize(), fxFactory, ccw, pmalpha, optimize );
 
     model->name = szFileName;
 
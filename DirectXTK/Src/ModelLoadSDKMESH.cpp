@@ -16,6 +16,8 @@
 
 #include "Effects.h"
 #include "VertexTypes.h"
+#include "MeshOptimizer.h"
+#include "ModelParser.h"
 
 #include "DirectXHelpers.h"
 #include "PlatformHelpers.h"
@@ -313,91 +315,62 @@ namespace
 
         SetDebugObjectName(*pInputLayout, "ModelSDKMESH");
     }
-}
 
+    // Helper for reordering the triangle list subsets drawn from one index buffer. The parser
+    // has already checked that every subset lies within its index buffer.
+    template<typename index_t>
+    void OptimizeSubsets(_Inout_updates_(nIndices) index_t* indices, size_t nIndices, UINT ibIndex, const SDKMESHModelInfo& info)
+    {
+        UNREFERENCED_PARAMETER(nIndices);
 
-//======================================================================================
-// Model Loader
-//======================================================================================
+        for (UINT meshIndex = 0; meshIndex < info.header->NumMeshes; ++meshIndex)
+        {
+            auto& mh = info.meshes[meshIndex];
 
-_Use_decl_annotations_
-std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevice, const uint8_t* meshData, size_t dataSize, IEffectFactory& fxFactory, bool ccw, bool pmalpha )
-{
-    if ( !d3dDevice || !meshData )
-        throw std::exception("Device and meshData cannot be null");
+            if (mh.IndexBuffer != ibIndex)
+                continue;
 
-    // File Headers
-    if ( dataSize < sizeof(DXUT::SDKMESH_HEADER) )
-        throw std::exception("End of file");
-    auto header = reinterpret_cast<const DXUT::SDKMESH_HEADER*>( meshData );
+            auto subsets = info.meshSubsets[meshIndex];
 
-    size_t headerSize = sizeof( DXUT::SDKMESH_HEADER )
-                        + header->NumVertexBuffers * sizeof(DXUT::SDKMESH_VERTEX_BUFFER_HEADER)
-                        + header->NumIndexBuffers * sizeof(DXUT::SDKMESH_INDEX_BUFFER_HEADER);
-    if ( header->HeaderSize != headerSize )
-        throw std::exception("Not a valid SDKMESH file");
+            for (UINT j = 0; j < mh.NumSubsets; ++j)
+            {
+                auto& subset = info.subsets[subsets[j]];
 
-    if ( dataSize < header->HeaderSize )
-        throw std::exception("End of file");
+                if (subset.PrimitiveType != DXUT::PT_TRIANGLE_LIST
+                    || !subset.IndexCount
+                    || (subset.IndexCount % 3))
+                    continue;
 
-    if( header->Version != DXUT::SDKMESH_FILE_VERSION )
-        throw std::exception("Not a supported SDKMESH version");
-                          
-    if ( header->IsBigEndian )
-        throw std::exception("Loading BigEndian SDKMESH files not supported");
+                auto first = indices + subset.IndexStart;
+                size_t count = static_cast<size_t>(subset.IndexCount);
+                size_t nVerts = static_cast<size_t>(*std::max_element(first, first + count)) + 1;
 
-    if ( !header->NumMeshes )
-        throw std::exception("No meshes found");
+                MeshOptimizer::OptimizeFaces(first, count, nVerts);
+            }
+        }
+    }
+}
 
-    if ( !header->NumVertexBuffers )
-        throw std::exception("No vertex buffers found");
 
-    if ( !header->NumIndexBuffers )
-        throw std::exception("No index buffers found");
+//======================================================================================
+// Model Loader
+//======================================================================================
 
-    if ( !header->NumTotalSubsets )
-        throw std::exception("No subsets found");
+_Use_decl_annotations_
+std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevice, const uint8_t* meshData, size_t dataSize, IEffectFactory& fxFactory, bool ccw, bool pmalpha, bool optimize )
+{
+    if ( !d3dDevice || !meshData )
+        throw std::exception("Device and meshData cannot be null");
 
-    if ( !header->NumMaterials )
-        throw std::exception("No materials found");
+    SDKMESHModelInfo info;
+    ParseSDKMESH( meshData, dataSize, info );
 
-    // Sub-headers
-    if ( dataSize < header->VertexStreamHeadersOffset
-         || ( dataSize < (header->VertexStreamHeadersOffset + header->NumVertexBuffers * sizeof(DXUT::SDKMESH_VERTEX_BUFFER_HEADER) ) ) )
-        throw std::exception("End of file");
-    auto vbArray = reinterpret_cast<const DXUT::SDKMESH_VERTEX_BUFFER_HEADER*>( meshData + header->VertexStreamHeadersOffset );
-    
-    if ( dataSize < header->IndexStreamHeadersOffset
-         || ( dataSize < (header->IndexStreamHeadersOffset + header->NumIndexBuffers * sizeof(DXUT::SDKMESH_INDEX_BUFFER_HEADER) ) ) )
-        throw std::exception("End of file");
-    auto ibArray = reinterpret_cast<const DXUT::SDKMESH_INDEX_BUFFER_HEADER*>( meshData + header->IndexStreamHeadersOffset );
-
-    if ( dataSize < header->MeshDataOffset
-         || ( dataSize < (header->MeshDataOffset + header->NumMeshes * sizeof(DXUT::SDKMESH_MESH) ) ) )
-        throw std::exception("End of file");
-    auto meshArray = reinterpret_cast<const DXUT::SDKMESH_MESH*>( meshData + header->MeshDataOffset );
-
-    if ( dataSize < header->SubsetDataOffset
-         || ( dataSize < (header->SubsetDataOffset + header->NumTotalSubsets * sizeof(DXUT::SDKMESH_SUBSET) ) ) )
-        throw std::exception("End of file");
-    auto subsetArray = reinterpret_cast<const DXUT::SDKMESH_SUBSET*>( meshData + header->SubsetDataOffset );
-
-    if ( dataSize < header->FrameDataOffset
-         || (dataSize < (header->FrameDataOffset + header->NumFrames * sizeof(DXUT::SDKMESH_FRAME) ) ) )
-        throw std::exception("End of file");
-    // TODO - auto frameArray = reinterpret_cast<const DXUT::SDKMESH_FRAME*>( meshData + header->FrameDataOffset );
-
-    if ( dataSize < header->MaterialDataOffset
-         || (dataSize < (header->MaterialDataOffset + header->NumMaterials * sizeof(DXUT::SDKMESH_MATERIAL) ) ) )
-        throw std::exception("End of file");
-    auto materialArray = reinterpret_cast<const DXUT::SDKMESH_MATERIAL*>( meshData + header->MaterialDataOffset );
-
-    // Buffer data
-    uint64_t bufferDataOffset = header->HeaderSize + header->NonBufferDataSize;
-    if ( ( dataSize < bufferDataOffset )
-         || ( dataSize < bufferDataOffset + header->BufferDataSize ) )
-        throw std::exception("End of file");
-    const uint8_t* bufferData = meshData + bufferDataOffset; 
+    auto header = info.header;
+    auto vbArray = info.vertexBuffers;
+    auto ibArray = info.indexBuffers;
+    auto meshArray = info.meshes;
+    auto subsetArray = info.subsets;
+    auto materialArray = info.materials;
 
     // Create vertex buffers
     std::vector<ComPtr<ID3D11Buffer>> vbs;
@@ -413,10 +386,6 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
     {
         auto& vh = vbArray[j];
 
-        if ( dataSize < vh.DataOffset
-             || ( dataSize < vh.DataOffset + vh.SizeBytes ) )
-            throw std::exception("End of file");
-
         vbDecls[j] = std::make_shared<std::vector<D3D11_INPUT_ELEMENT_DESC>>();
         unsigned int flags = GetInputLayoutDesc(vh.Decl, *vbDecls[j].get());
 
@@ -431,7 +400,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
 
         materialFlags[j] = flags;
 
-        auto verts = reinterpret_cast<const uint8_t*>( bufferData + (vh.DataOffset - bufferDataOffset) );
+        auto verts = info.vertexData[j];
 
         D3D11_BUFFER_DESC desc = {};
         desc.Usage = D3D11_USAGE_DEFAULT;
@@ -456,14 +425,25 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
     {
         auto& ih = ibArray[j];
 
-        if ( dataSize < ih.DataOffset
-             || ( dataSize < ih.DataOffset + ih.SizeBytes ) )
-            throw std::exception("End of file");
+        auto indices = info.indexData[j];
 
-        if ( ih.IndexType != DXUT::IT_16BIT && ih.IndexType != DXUT::IT_32BIT )
-            throw std::exception("Invalid index buffer type found");
+        // The file is read-only, so the subsets are reordered in a copy
+        std::vector<uint8_t> optimized;
+        if ( optimize )
+        {
+            optimized.assign( indices, indices + ih.SizeBytes );
 
-        auto indices = reinterpret_cast<const uint8_t*>( bufferData + (ih.DataOffset - bufferDataOffset) );
+            if ( ih.IndexType == DXUT::IT_32BIT )
+            {
+                OptimizeSubsets( reinterpret_cast<uint32_t*>( optimized.data() ), optimized.size() / sizeof(uint32_t), j, info );
+            }
+            else
+            {
+                OptimizeSubsets( reinterpret_cast<uint16_t*>( optimized.data() ), optimized.size() / sizeof(uint16_t), j, info );
+            }
+
+            indices = optimized.data();
+        }
 
         D3D11_BUFFER_DESC desc = {};
         desc.Usage = D3D11_USAGE_DEFAULT;
@@ -490,29 +470,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
     for( UINT meshIndex = 0; meshIndex < header->NumMeshes; ++meshIndex )
     {
         auto& mh = meshArray[ meshIndex ];
-
-        if ( !mh.NumSubsets
-             || !mh.NumVertexBuffers
-             || mh.IndexBuffer >= header->NumIndexBuffers
-             || mh.VertexBuffers[0] >= header->NumVertexBuffers )
-            throw std::exception("Invalid mesh found");
-
-        // mh.NumVertexBuffers is sometimes not what you'd expect, so we skip validating it
-
-        if ( dataSize < mh.SubsetOffset
-             || (dataSize < mh.SubsetOffset + mh.NumSubsets*sizeof(UINT) ) )
-            throw std::exception("End of file");
-
-        auto subsets = reinterpret_cast<const UINT*>( meshData + mh.SubsetOffset );
-
-        if ( mh.NumFrameInfluences > 0 )
-        {
-            if ( dataSize < mh.FrameInfluenceOffset
-                 || (dataSize < mh.FrameInfluenceOffset + mh.NumFrameInfluences*sizeof(UINT) ) )
-                throw std::exception("End of file");
-
-            // TODO - auto influences = reinterpret_cast<const UINT*>( meshData + mh.FrameInfluenceOffset );
-        }
+        auto subsets = info.meshSubsets[ meshIndex ];
 
         auto mesh = std::make_shared<ModelMesh>();
         wchar_t meshName[ DXUT::MAX_MESH_NAME ];
@@ -530,11 +488,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
         mesh->meshParts.reserve( mh.NumSubsets );
         for( UINT j = 0; j < mh.NumSubsets; ++j )
         {
-            auto sIndex = subsets[ j ];
-            if ( sIndex >= header->NumTotalSubsets )
-                throw std::exception("Invalid mesh found");
-
-            auto& subset = subsetArray[ sIndex ];
+            auto& subset = subsetArray[ subsets[ j ] ];
 
             D3D11_PRIMITIVE_TOPOLOGY primType;
             switch( subset.PrimitiveType )
@@ -557,9 +511,6 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
                 throw std::exception("Unknown primitive type");
             }
 
-            if ( subset.MaterialID >= header->NumMaterials )
-                throw std::exception("Invalid mesh found");
-
             auto& mat = materials[ subset.MaterialID ];
 
             if ( !mat.effect )
@@ -602,18 +553,17 @@ std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevic
 
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevice, const wchar_t* szFileName, IEffectFactory& fxFactory, bool ccw, bool pmalpha )
+std::unique_ptr<Model> DirectX::Model::CreateFromSDKMESH( ID3D11Device* d3dDevice, const wchar_t* szFileName, IEffectFactory& fxFactory, bool ccw, bool pmalpha, bool optimize )
 {
-    size_t dataSize = 0;
-    std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile( szFileName, data, &dataSize );
+    MappedFileView file;
+    HRESULT hr = file.Open( szFileName );
     if ( FAILED(hr) )
     {
         DebugTrace( "CreateFromSDKMESH failed (%08X) loading '%ls'\n", hr, szFileName );
         throw std::exception( "CreateFromSDKMESH" );
     }
 
-    auto model = CreateFromSDKMESH( d3dDevice, data.get(), dataSize, fxFactory, ccw, pmalpha );
+    auto model = CreateFromSDKMESH( d3dDevice, file.GetData(), file.GetSize(), fxFactory, ccw, pmalpha, optimize );
 
     model->name = szFileName;
 
@@ -16,6 +16,8 @@
 
 #include "Effects.h"
 #include "VertexTypes.h"
+#include "MeshOptimizer.h"
+#include "ModelParser.h"
 
 #include "DirectXHelpers.h"
 #include "PlatformHelpers.h"
@@ -26,7 +28,7 @@
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
-static_assert(sizeof(VertexPositionNormalTexture) == 32, "VBO vertex size mismatch");
+static_assert(sizeof(VertexPositionNormalTexture) == VBO::VERTEX_SIZE, "VBO vertex size mismatch");
 
 namespace
 {
@@ -52,7 +54,7 @@ namespace
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
 std::unique_ptr<Model> DirectX::Model::CreateFromVBO(ID3D11Device* d3dDevice, const uint8_t* meshData, size_t dataSize,
-                                                     std::shared_ptr<IEffect> ieffect, bool ccw, bool pmalpha)
+                                                     std::shared_ptr<IEffect> ieffect, bool ccw, bool pmalpha, bool optimize)
 {
     if (!InitOnceExecuteOnce(&g_InitOnce, InitializeDecl, nullptr, nullptr))
         throw std::exception("One-time initialization failed");
@@ -60,25 +62,31 @@ std::unique_ptr<Model> DirectX::Model::CreateFromVBO(ID3D11Device* d3dDevice, co
     if ( !d3dDevice || !meshData )
         throw std::exception("Device and meshData cannot be null");
 
-    // File Header
-    if ( dataSize < sizeof(VBO::header_t) )
-        throw std::exception("End of file");
-    auto header = reinterpret_cast<const VBO::header_t*>( meshData );
+    VBOModelInfo info;
+    ParseVBO(meshData, dataSize, info);
 
-    if ( !header->numVertices || !header->numIndices )
-        throw std::exception("No vertices or indices found");
+    auto verts = reinterpret_cast<const VertexPositionNormalTexture*>(info.vertices);
+    size_t vertexCount = info.vertexCount;
+    size_t vertSize = sizeof(VertexPositionNormalTexture) * vertexCount;
 
-    size_t vertSize = sizeof(VertexPositionNormalTexture) * header->numVertices;
+    auto indices = info.indices;
+    size_t indexSize = sizeof(uint16_t) * info.indexCount;
 
-    if (dataSize < (vertSize + sizeof(VBO::header_t)))
-        throw std::exception("End of file");
-    auto verts = reinterpret_cast<const VertexPositionNormalTexture*>( meshData + sizeof(VBO::header_t) );
+    // The file is read-only, so an optimized copy replaces it
+    std::vector<VertexPositionNormalTexture> optimizedVerts;
+    std::vector<uint16_t> optimizedIndices;
+    if (optimize)
+    {
+        optimizedVerts.assign(verts, verts + info.vertexCount);
+        optimizedIndices.assign(indices, indices + info.indexCount);
 
-    size_t indexSize = sizeof(uint16_t) * header->numIndices;
+        MeshOptimizer::OptimizeMesh(optimizedVerts, optimizedIndices);
 
-    if (dataSize < (sizeof(VBO::header_t) + vertSize + indexSize))
-        throw std::exception("End of file");
-    auto indices = reinterpret_cast<const uint16_t*>( meshData + sizeof(VBO::header_t) + vertSize );
+        verts = optimizedVerts.data();
+        vertexCount = optimizedVerts.size();
+        vertSize = sizeof(VertexPositionNormalTexture) * vertexCount;
+        indices = optimizedIndices.data();
+    }
 
     // Create vertex buffer
     ComPtr<ID3D11Buffer> vb;
@@ -143,7 +151,7 @@ std::unique_ptr<Model> DirectX::Model::CreateFromVBO(ID3D11Device* d3dDevice, co
     }
 
     auto part = new ModelMeshPart();
-    part->indexCount = header->numIndices;
+    part->indexCount = static_cast<uint32_t>( info.indexCount );
     part->startIndex = 0;
     part->vertexStride = static_cast<UINT>( sizeof(VertexPositionNormalTexture) );
     part->inputLayout = il;
@@ -155,8 +163,8 @@ std::unique_ptr<Model> DirectX::Model::CreateFromVBO(ID3D11Device* d3dDevice, co
     auto mesh = std::make_shared<ModelMesh>();
     mesh->ccw = ccw;
     mesh->pmalpha = pmalpha;
-    BoundingSphere::CreateFromPoints(mesh->boundingSphere, header->numVertices, &verts->position, sizeof(VertexPositionNormalTexture));
-    BoundingBox::CreateFromPoints(mesh->boundingBox, header->numVertices, &verts->position, sizeof(VertexPositionNormalTexture));
+    BoundingSphere::CreateFromPoints(mesh->boundingSphere, vertexCount, &verts->position, sizeof(VertexPositionNormalTexture));
+    BoundingBox::CreateFromPoints(mesh->boundingBox, vertexCount, &verts->position, sizeof(VertexPositionNormalTexture));
     mesh->meshParts.emplace_back(part);
 
     std::unique_ptr<Model> model(new Model());
@@ -169,18 +177,17 @@ std::unique_ptr<Model> DirectX::Model::CreateFromVBO(ID3D11Device* d3dDevice, co
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
 std::unique_ptr<Model> DirectX::Model::CreateFromVBO(ID3D11Device* d3dDevice, const wchar_t* szFileName,
-                                                     std::shared_ptr<IEffect> ieffect, bool ccw, bool pmalpha)
+                                                     std::shared_ptr<IEffect> ieffect, bool ccw, bool pmalpha, bool optimize)
 {
-    size_t dataSize = 0;
-    std::unique_ptr<uint8_t[]> data;
-    HRESULT hr = BinaryReader::ReadEntireFile( szFileName, data, &dataSize );
+    MappedFileView file;
+    HRESULT hr = file.Open( szFileName );
     if ( FAILED(hr) )
     {
         DebugTrace( "CreateFromVBO failed (%08X) loading '%ls'\n", hr, szFileName );
         throw std::exception( "CreateFromVBO" );
     }
 
-    auto model = CreateFromVBO( d3dDevice, data.get(), dataSize, ieffect, ccw, pmalpha );
+    auto model = CreateFromVBO( d3dDevice, file.GetData(), file.GetSize(), ieffect, ccw, pmalpha, optimize );
 
     model->name = szFileName;
 
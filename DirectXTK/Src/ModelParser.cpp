@@ -0,0 +1,434 @@
+//--------------------------------------------------------------------------------------
+// File: ModelParser.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "ModelParser.h"
+
+#include <DirectXMath.h>
+#include <dxgiformat.h>
+#include <stdexcept>
+
+#include "SDKMesh.h"
+#include "CMO.h"
+#include "vbo.h"
+
+using namespace DirectX;
+
+static_assert(CMOMaxTextures == VSD3DStarter::MAX_TEXTURE, "CMO texture count mismatch");
+
+namespace
+{
+    // True when count elements of elementSize bytes starting at offset lie within the data.
+    // Written so that no intermediate value can wrap, whatever the file claims.
+    inline bool InBounds(size_t dataSize, uint64_t offset, uint64_t count, size_t elementSize)
+    {
+        return offset <= dataSize && count <= (dataSize - offset) / elementSize;
+    }
+
+    inline uint32_t ReadUInt(_In_reads_bytes_(sizeof(uint32_t)) const void* ptr)
+    {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+
+    // Sequential reader over the packed .CMO layout.
+    class CMOReader
+    {
+    public:
+        CMOReader(_In_reads_bytes_(dataSize) const uint8_t* meshData, size_t dataSize)
+          : mPos(meshData),
+            mEnd(meshData + dataSize)
+        { }
+
+        // Throws unless count elements of at least minSize bytes each can still follow, so
+        // that a corrupt count is caught before anything is allocated for it.
+        void CheckCount(size_t count, size_t minSize) const
+        {
+            if (count > static_cast<size_t>(mEnd - mPos) / minSize)
+                throw std::runtime_error("End of file");
+        }
+
+        template<typename T> const T* ReadArray(size_t count, size_t elementSize = sizeof(T))
+        {
+            CheckCount(count, elementSize);
+
+            auto result = reinterpret_cast<const T*>(mPos);
+
+            mPos += count * elementSize;
+
+            return result;
+        }
+
+        uint32_t ReadUInt()
+        {
+            return ::ReadUInt(ReadArray<uint8_t>(sizeof(uint32_t)));
+        }
+
+        uint8_t ReadByte()
+        {
+            return *ReadArray<uint8_t>(1);
+        }
+
+        CMOString ReadString()
+        {
+            CMOString result;
+            result.length = ReadUInt();
+            result.chars = ReadArray<uint16_t>(result.length);
+            return result;
+        }
+
+    private:
+        const uint8_t* mPos;
+        const uint8_t* mEnd;
+    };
+}
+
+
+//--------------------------------------------------------------------------------------
+// VBO
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::ParseVBO(const uint8_t* meshData, size_t dataSize, VBOModelInfo& info)
+{
+    memset(&info, 0, sizeof(info));
+
+    if (!meshData)
+        throw std::runtime_error("meshData cannot be null");
+
+    // File Header
+    if (dataSize < sizeof(VBO::header_t))
+        throw std::runtime_error("End of file");
+    auto header = reinterpret_cast<const VBO::header_t*>(meshData);
+
+    if (!header->numVertices || !header->numIndices)
+        throw std::runtime_error("No vertices or indices found");
+
+    if (!InBounds(dataSize, sizeof(VBO::header_t), header->numVertices, VBO::VERTEX_SIZE))
+        throw std::runtime_error("End of file");
+
+    size_t indexOffset = sizeof(VBO::header_t) + header->numVertices * VBO::VERTEX_SIZE;
+
+    if (!InBounds(dataSize, indexOffset, header->numIndices, sizeof(uint16_t)))
+        throw std::runtime_error("End of file");
+
+    info.vertices = meshData + sizeof(VBO::header_t);
+    info.vertexCount = header->numVertices;
+    info.indices = reinterpret_cast<const uint16_t*>(meshData + indexOffset);
+    info.indexCount = header->numIndices;
+}
+
+
+//--------------------------------------------------------------------------------------
+// SDKMESH
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::ParseSDKMESH(const uint8_t* meshData, size_t dataSize, SDKMESHModelInfo& info)
+{
+    info = SDKMESHModelInfo();
+
+    if (!meshData)
+        throw std::runtime_error("meshData cannot be null");
+
+    // File Headers
+    if (dataSize < sizeof(DXUT::SDKMESH_HEADER))
+        throw std::runtime_error("End of file");
+    auto header = reinterpret_cast<const DXUT::SDKMESH_HEADER*>(meshData);
+
+    uint64_t headerSize = sizeof(DXUT::SDKMESH_HEADER)
+                          + uint64_t(header->NumVertexBuffers) * sizeof(DXUT::SDKMESH_VERTEX_BUFFER_HEADER)
+                          + uint64_t(header->NumIndexBuffers) * sizeof(DXUT::SDKMESH_INDEX_BUFFER_HEADER);
+    if (header->HeaderSize != headerSize)
+        throw std::runtime_error("Not a valid SDKMESH file");
+
+    if (dataSize < header->HeaderSize)
+        throw std::runtime_error("End of file");
+
+    if (header->Version != DXUT::SDKMESH_FILE_VERSION)
+        throw std::runtime_error("Not a supported SDKMESH version");
+
+    if (header->IsBigEndian)
+        throw std::runtime_error("Loading BigEndian SDKMESH files not supported");
+
+    if (!header->NumMeshes)
+        throw std::runtime_error("No meshes found");
+
+    if (!header->NumVertexBuffers)
+        throw std::runtime_error("No vertex buffers found");
+
+    if (!header->NumIndexBuffers)
+        throw std::runtime_error("No index buffers found");
+
+    if (!header->NumTotalSubsets)
+        throw std::runtime_error("No subsets found");
+
+    if (!header->NumMaterials)
+        throw std::runtime_error("No materials found");
+
+    // Sub-headers
+    if (!InBounds(dataSize, header->VertexStreamHeadersOffset, header->NumVertexBuffers, sizeof(DXUT::SDKMESH_VERTEX_BUFFER_HEADER))
+        || !InBounds(dataSize, header->IndexStreamHeadersOffset, header->NumIndexBuffers, sizeof(DXUT::SDKMESH_INDEX_BUFFER_HEADER))
+        || !InBounds(dataSize, header->MeshDataOffset, header->NumMeshes, sizeof(DXUT::SDKMESH_MESH))
+        || !InBounds(dataSize, header->SubsetDataOffset, header->NumTotalSubsets, sizeof(DXUT::SDKMESH_SUBSET))
+        || !InBounds(dataSize, header->FrameDataOffset, header->NumFrames, sizeof(DXUT::SDKMESH_FRAME))
+        || !InBounds(dataSize, header->MaterialDataOffset, header->NumMaterials, sizeof(DXUT::SDKMESH_MATERIAL)))
+        throw std::runtime_error("End of file");
+
+    info.header = header;
+    info.vertexBuffers = reinterpret_cast<const DXUT::SDKMESH_VERTEX_BUFFER_HEADER*>(meshData + header->VertexStreamHeadersOffset);
+    info.indexBuffers = reinterpret_cast<const DXUT::SDKMESH_INDEX_BUFFER_HEADER*>(meshData + header->IndexStreamHeadersOffset);
+    info.meshes = reinterpret_cast<const DXUT::SDKMESH_MESH*>(meshData + header->MeshDataOffset);
+    info.subsets = reinterpret_cast<const DXUT::SDKMESH_SUBSET*>(meshData + header->SubsetDataOffset);
+    info.frames = reinterpret_cast<const DXUT::SDKMESH_FRAME*>(meshData + header->FrameDataOffset);
+    info.materials = reinterpret_cast<const DXUT::SDKMESH_MATERIAL*>(meshData + header->MaterialDataOffset);
+
+    // Buffer data
+    if (header->NonBufferDataSize > dataSize - header->HeaderSize
+        || !InBounds(dataSize, header->HeaderSize + header->NonBufferDataSize, header->BufferDataSize, 1))
+        throw std::runtime_error("End of file");
+
+    info.vertexData.reserve(header->NumVertexBuffers);
+    for (uint32_t j = 0; j < header->NumVertexBuffers; ++j)
+    {
+        auto& vh = info.vertexBuffers[j];
+
+        if (!InBounds(dataSize, vh.DataOffset, vh.SizeBytes, 1))
+            throw std::runtime_error("End of file");
+
+        info.vertexData.push_back(meshData + vh.DataOffset);
+    }
+
+    info.indexData.reserve(header->NumIndexBuffers);
+    for (uint32_t j = 0; j < header->NumIndexBuffers; ++j)
+    {
+        auto& ih = info.indexBuffers[j];
+
+        if (!InBounds(dataSize, ih.DataOffset, ih.SizeBytes, 1))
+            throw std::runtime_error("End of file");
+
+        if (ih.IndexType != DXUT::IT_16BIT && ih.IndexType != DXUT::IT_32BIT)
+            throw std::runtime_error("Invalid index buffer type found");
+
+        info.indexData.push_back(meshData + ih.DataOffset);
+    }
+
+    // Meshes and the subsets they draw
+    info.meshSubsets.reserve(header->NumMeshes);
+    for (uint32_t meshIndex = 0; meshIndex < header->NumMeshes; ++meshIndex)
+    {
+        auto& mh = info.meshes[meshIndex];
+
+        if (!mh.NumSubsets
+            || !mh.NumVertexBuffers
+            || mh.IndexBuffer >= header->NumIndexBuffers
+            || mh.VertexBuffers[0] >= header->NumVertexBuffers)
+            throw std::runtime_error("Invalid mesh found");
+
+        // mh.NumVertexBuffers is sometimes not what you'd expect, so we skip validating it
+
+        if (!InBounds(dataSize, mh.SubsetOffset, mh.NumSubsets, sizeof(uint32_t)))
+            throw std::runtime_error("End of file");
+
+        auto subsets = reinterpret_cast<const uint32_t*>(meshData + mh.SubsetOffset);
+
+        if (mh.NumFrameInfluences > 0
+            && !InBounds(dataSize, mh.FrameInfluenceOffset, mh.NumFrameInfluences, sizeof(uint32_t)))
+            throw std::runtime_error("End of file");
+
+        auto& ih = info.indexBuffers[mh.IndexBuffer];
+        uint64_t nIndices = ih.SizeBytes / ((ih.IndexType == DXUT::IT_32BIT) ? sizeof(uint32_t) : sizeof(uint16_t));
+
+        for (uint32_t j = 0; j < mh.NumSubsets; ++j)
+        {
+            uint32_t sIndex = ReadUInt(subsets + j);
+            if (sIndex >= header->NumTotalSubsets)
+                throw std::runtime_error("Invalid mesh found");
+
+            auto& subset = info.subsets[sIndex];
+
+            if (subset.PrimitiveType == DXUT::PT_QUAD_PATCH_LIST || subset.PrimitiveType == DXUT::PT_TRIANGLE_PATCH_LIST)
+                throw std::runtime_error("Direct3D9 era tessellation not supported");
+
+            if (subset.PrimitiveType > DXUT::PT_TRIANGLE_PATCH_LIST)
+                throw std::runtime_error("Unknown primitive type");
+
+            if (subset.MaterialID >= header->NumMaterials
+                || subset.IndexStart > nIndices
+                || subset.IndexCount > nIndices - subset.IndexStart)
+                throw std::runtime_error("Invalid mesh found");
+        }
+
+        info.meshSubsets.push_back(subsets);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// CMO
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::ParseCMO(const uint8_t* meshData, size_t dataSize, std::vector<CMOMeshInfo>& meshes)
+{
+    meshes.clear();
+
+    if (!meshData)
+        throw std::runtime_error("meshData cannot be null");
+
+    CMOReader reader(meshData, dataSize);
+
+    // Meshes
+    uint32_t nMesh = reader.ReadUInt();
+    if (!nMesh)
+        throw std::runtime_error("No meshes found");
+
+    // The smallest mesh is a name length, one material, submesh, IB and VB, and extents.
+    reader.CheckCount(nMesh, sizeof(uint32_t) * 6 + sizeof(uint8_t) + sizeof(VSD3DStarter::MeshExtents));
+    meshes.resize(nMesh);
+
+    for (uint32_t meshIndex = 0; meshIndex < nMesh; ++meshIndex)
+    {
+        auto& mesh = meshes[meshIndex];
+
+        // Mesh name
+        mesh.name = reader.ReadString();
+
+        // Materials
+        uint32_t nMats = reader.ReadUInt();
+        reader.CheckCount(nMats, sizeof(uint32_t) * (2 + CMOMaxTextures) + sizeof(VSD3DStarter::Material));
+
+        mesh.materials.resize(nMats);
+        for (auto& m : mesh.materials)
+        {
+            m.name = reader.ReadString();
+            m.material = reader.ReadArray<VSD3DStarter::Material>(1);
+            m.pixelShader = reader.ReadString();
+
+            for (size_t t = 0; t < CMOMaxTextures; ++t)
+            {
+                m.textures[t] = reader.ReadString();
+            }
+        }
+
+        // Skeletal data?
+        mesh.hasSkeleton = reader.ReadByte() != 0;
+
+        // Submeshes
+        uint32_t nSubmesh = reader.ReadUInt();
+        if (!nSubmesh)
+            throw std::runtime_error("No submeshes found\n");
+
+        mesh.submeshes = reader.ReadArray<VSD3DStarter::SubMesh>(nSubmesh);
+        mesh.submeshCount = nSubmesh;
+
+        // Index buffers
+        uint32_t nIBs = reader.ReadUInt();
+        if (!nIBs)
+            throw std::runtime_error("No index buffers found\n");
+
+        reader.CheckCount(nIBs, sizeof(uint32_t) + sizeof(uint16_t));
+        mesh.indexBuffers.resize(nIBs);
+        for (auto& ib : mesh.indexBuffers)
+        {
+            uint32_t nIndexes = reader.ReadUInt();
+            if (!nIndexes)
+                throw std::runtime_error("Empty index buffer found\n");
+
+            ib.indices = reader.ReadArray<uint16_t>(nIndexes);
+            ib.indexCount = nIndexes;
+        }
+
+        // Vertex buffers
+        uint32_t nVBs = reader.ReadUInt();
+        if (!nVBs)
+            throw std::runtime_error("No vertex buffers found\n");
+
+        reader.CheckCount(nVBs, sizeof(uint32_t) + VSD3DStarter::VERTEX_SIZE);
+        mesh.vertexBuffers.resize(nVBs);
+        for (auto& vb : mesh.vertexBuffers)
+        {
+            uint32_t nVerts = reader.ReadUInt();
+            if (!nVerts)
+                throw std::runtime_error("Empty vertex buffer found\n");
+
+            vb.vertices = reader.ReadArray<uint8_t>(nVerts, VSD3DStarter::VERTEX_SIZE);
+            vb.skinning = nullptr;
+            vb.vertexCount = nVerts;
+        }
+
+        // Skinning vertex buffers
+        uint32_t nSkinVBs = reader.ReadUInt();
+        if (nSkinVBs)
+        {
+            if (nSkinVBs != nVBs)
+                throw std::runtime_error("Number of VBs not equal to number of skin VBs");
+
+            for (auto& vb : mesh.vertexBuffers)
+            {
+                uint32_t nVerts = reader.ReadUInt();
+                if (!nVerts)
+                    throw std::runtime_error("Empty skinning vertex buffer found\n");
+
+                if (vb.vertexCount != nVerts)
+                    throw std::runtime_error("Mismatched number of verts for skin VBs");
+
+                vb.skinning = reader.ReadArray<VSD3DStarter::SkinningVertex>(nVerts);
+            }
+        }
+
+        mesh.skinning = nSkinVBs != 0;
+
+        // Extents
+        mesh.extents = reader.ReadArray<VSD3DStarter::MeshExtents>(1);
+
+        // Submeshes refer to existing buffers and materials, and draw within their index buffer
+        for (size_t j = 0; j < mesh.submeshCount; ++j)
+        {
+            VSD3DStarter::SubMesh sm;
+            memcpy(&sm, mesh.submeshes + j, sizeof(sm));
+
+            if (sm.IndexBufferIndex >= nIBs
+                || sm.VertexBufferIndex >= nVBs
+                || sm.MaterialIndex >= nMats)
+                throw std::runtime_error("Invalid submesh found\n");
+
+            size_t nIndices = mesh.indexBuffers[sm.IndexBufferIndex].indexCount;
+            if (sm.StartIndex > nIndices
+                || sm.PrimCount > (nIndices - sm.StartIndex) / 3)
+                throw std::runtime_error("Invalid submesh found\n");
+        }
+
+        // Animation data. Only its extent matters, to find the next mesh; the data after the
+        // last mesh is not read at all.
+        if (mesh.hasSkeleton && meshIndex + 1 < nMesh)
+        {
+            // Bones
+            uint32_t nBones = reader.ReadUInt();
+            for (uint32_t j = 0; j < nBones; ++j)
+            {
+                reader.ReadString();
+                reader.ReadArray<VSD3DStarter::Bone>(1);
+            }
+
+            // Animation Clips
+            uint32_t nClips = reader.ReadUInt();
+            for (uint32_t j = 0; j < nClips; ++j)
+            {
+                reader.ReadString();
+
+                auto clip = reader.ReadArray<VSD3DStarter::Clip>(1);
+                reader.ReadArray<VSD3DStarter::Keyframe>(ReadUInt(&clip->keys));
+            }
+        }
+    }
+}
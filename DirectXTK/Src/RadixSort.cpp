@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// File: RadixSort.cpp
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "RadixSort.h"
+
+
+_Use_decl_annotations_
+void __cdecl DirectX::RadixSortIndices(uint64_t const* keys, size_t count, uint32_t* indices, uint32_t* scratch)
+{
+    assert(count <= UINT32_MAX);
+
+    const int Passes = 8;
+    const int Buckets = 256;
+
+    // One read of the keys builds the histograms for every pass.
+    std::unique_ptr<size_t[]> histograms(new size_t[Passes * Buckets]());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = keys[i];
+
+        for (int pass = 0; pass < Passes; pass++)
+        {
+            histograms[pass * Buckets + ((key >> (pass * 8)) & 0xff)]++;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        indices[i] = static_cast<uint32_t>(i);
+    }
+
+    uint32_t* src = indices;
+    uint32_t* dst = scratch;
+
+    for (int pass = 0; pass < Passes; pass++)
+    {
+        size_t* histogram = &histograms[pass * Buckets];
+        int shift = pass * 8;
+
+        // Every key has the same digit, this pass would not move anything.
+        if (count == 0 || histogram[(keys[0] >> shift) & 0xff] == count)
+            continue;
+
+        size_t offset = 0;
+
+        for (int bucket = 0; bucket < Buckets; bucket++)
+        {
+            size_t bucketCount = histogram[bucket];
+
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t index = src[i];
+
+            dst[histogram[(keys[index] >> shift) & 0xff]++] = index;
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != indices)
+    {
+        memcpy(indices, src, sizeof(uint32_t) * count);
+    }
+}
@@ -14,6 +14,7 @@
 #include "pch.h"
 
 #include "SpriteBatch.h"
+#include "SpriteBatchKernels.h"
 #include "ConstantBuffer.h"
 #include "CommonStates.h"
 #include "VertexTypes.h"
@@ -83,25 +84,24 @@ public:
         FXMVECTOR originRotationDepth,
         int flags);
 
+    void XM_CALLCONV DrawRects(_In_ ID3D11ShaderResourceView* texture,
+        FXMVECTOR destination,
+        _In_reads_(count) RECT const* sourceRectangles,
+        _In_reads_(count) XMFLOAT2 const* origins,
+        size_t count,
+        FXMVECTOR color,
+        FXMVECTOR originRotationDepth,
+        int flags);
 
-    // Info about a single sprite that is waiting to be drawn.
-    __declspec(align(16)) struct SpriteInfo : public AlignedNew<SpriteInfo>
-    {
-        XMFLOAT4A source;
-        XMFLOAT4A destination;
-        XMFLOAT4A color;
-        XMFLOAT4A originRotationDepth;
-        ID3D11ShaderResourceView* texture;
-        int flags;
-
-
-        // Combine values from the public SpriteEffects enum with these internal-only flags.
-        static const int SourceInTexels = 4;
-        static const int DestSizeInPixels = 8;
 
-        static_assert((SpriteEffects_FlipBoth & (SourceInTexels | DestSizeInPixels)) == 0, "Flag bits must not overlap");
+    // Info about a single sprite that is waiting to be drawn. The fields live in SpriteBatchKernels,
+    // which sorts and expands them without touching the device.
+    __declspec(align(16)) struct SpriteInfo : public SpriteBatchKernels::SpriteInfo, public AlignedNew<SpriteInfo>
+    {
     };
 
+    typedef SpriteBatchKernels::SpriteInfo SpriteData;
+
     DXGI_MODE_ROTATION mRotation;
 
     bool mSetViewport;
@@ -115,12 +115,7 @@ private:
     void SortSprites();
     void GrowSortedSprites();
 
-    void RenderBatch(_In_ ID3D11ShaderResourceView* texture, _In_reads_(count) SpriteInfo const* const* sprites, size_t count);
-
-    static void XM_CALLCONV RenderSprite(_In_ SpriteInfo const* sprite,
-        _Out_writes_(VerticesPerSprite) VertexPositionColorTexture* vertices,
-        FXMVECTOR textureSize,
-        FXMVECTOR inverseTextureSize);
+    void RenderBatch(_In_ ID3D11ShaderResourceView* texture, _In_reads_(count) SpriteData const* const* sprites, size_t count);
 
     static XMVECTOR GetTextureSize(_In_ ID3D11ShaderResourceView* texture);
     XMMATRIX GetViewportTransform(_In_ ID3D11DeviceContext* deviceContext, DXGI_MODE_ROTATION rotation );
@@ -130,7 +125,7 @@ private:
     static const size_t MaxBatchSize = 2048;
     static const size_t MinBatchSize = 128;
     static const size_t InitialQueueSize = 64;
-    static const size_t VerticesPerSprite = 4;
+    static const size_t VerticesPerSprite = SpriteBatchKernels::VerticesPerSprite;
     static const size_t IndicesPerSprite = 6;
 
 
@@ -145,7 +140,14 @@ private:
     // actual data alone and just sort this array of pointers instead. But we want contiguous
     // memory for cache efficiency, so these pointers are just shortcuts into the single
     // mSpriteQueue array, and we take care to keep them in order when sorting is disabled.
-    std::vector<SpriteInfo const*> mSortedSprites;
+    std::vector<SpriteData const*> mSortedSprites;
+
+
+    // Scratch space for the keyed radix sort, kept between batches to avoid reallocating.
+    std::vector<uint32_t> mTextureIds;
+    std::vector<uint64_t> mSortKeys;
+    std::vector<uint32_t> mSortIndices;
+    std::vector<uint32_t> mSortScratch;
 
 
     // If each SpriteInfo instance held a refcount on its texture, could end up with
@@ -508,7 +510,9 @@ void XM_CALLCONV SpriteBatch::Impl::Draw(ID3D11ShaderResourceView* texture,
     if (mSortMode == SpriteSortMode_Immediate)
     {
         // If we are in immediate mode, draw this sprite straight away.
-        RenderBatch(texture, &sprite, 1);
+        SpriteData const* immediateSprite = sprite;
+
+        RenderBatch(texture, &immediateSprite, 1);
     }
     else
     {
@@ -527,6 +531,81 @@ void XM_CALLCONV SpriteBatch::Impl::Draw(ID3D11ShaderResourceView* texture,
 }
 
 
+// Adds a run of sprites that only differ in source rectangle and origin to the queue.
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::Impl::DrawRects(ID3D11ShaderResourceView* texture,
+    FXMVECTOR destination,
+    RECT const* sourceRectangles,
+    XMFLOAT2 const* origins,
+    size_t count,
+    FXMVECTOR color,
+    FXMVECTOR originRotationDepth,
+    int flags)
+{
+    if (!texture)
+        throw std::exception("Texture cannot be null");
+
+    if (!mInBeginEndPair)
+        throw std::exception("Begin must be called before Draw");
+
+    if (!count)
+        return;
+
+    // Make room for the whole run up front.
+    while (mSpriteQueueCount + count > mSpriteQueueArraySize)
+    {
+        GrowSpriteQueue();
+    }
+
+    SpriteInfo* sprites = &mSpriteQueue[mSpriteQueueCount];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        SpriteInfo* sprite = &sprites[i];
+
+        XMVECTOR source = LoadRect(&sourceRectangles[i]);
+        XMVECTOR dest = destination;
+
+        // If the destination size is relative to the source region, convert it to pixels.
+        if (!(flags & SpriteInfo::DestSizeInPixels))
+        {
+            dest = XMVectorPermute<0, 1, 6, 7>(dest, dest * source); // dest.zw *= source.zw
+        }
+
+        XMStoreFloat4A(&sprite->source, source);
+        XMStoreFloat4A(&sprite->destination, dest);
+        XMStoreFloat4A(&sprite->color, color);
+        XMStoreFloat4A(&sprite->originRotationDepth, originRotationDepth + XMLoadFloat2(&origins[i]));
+
+        sprite->texture = texture;
+        sprite->flags = flags | SpriteInfo::SourceInTexels | SpriteInfo::DestSizeInPixels;
+    }
+
+    if (mSortMode == SpriteSortMode_Immediate)
+    {
+        // If we are in immediate mode, draw the run straight away.
+        std::vector<SpriteData const*> immediateSprites(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            immediateSprites[i] = &sprites[i];
+        }
+
+        RenderBatch(texture, immediateSprites.data(), count);
+    }
+    else
+    {
+        // Queue the run for later sorting and batched rendering, holding one refcount on its texture.
+        mSpriteQueueCount += count;
+
+        if (mSpriteTextureReferences.empty() || texture != mSpriteTextureReferences.back().Get())
+        {
+            mSpriteTextureReferences.emplace_back(texture);
+        }
+    }
+}
+
+
 // Dynamically expands the array used to store pending sprite information.
 void SpriteBatch::Impl::GrowSpriteQueue()
 {
@@ -673,31 +752,33 @@ void SpriteBatch::Impl::SortSprites()
         GrowSortedSprites();
     }
 
-    switch (mSortMode)
+    if (mSortMode == SpriteSortMode_Deferred)
+        return;
+
+    // Pack (depth, texture id) into 64 bit keys and radix sort their indices. This is a
+    // stable sort, so sprites with identical keys keep the order they were drawn in.
+    bool useTextureIds = (mSortMode == SpriteSortMode_Texture ||
+                          mSortMode == SpriteSortMode_BackToFrontTexture ||
+                          mSortMode == SpriteSortMode_FrontToBackTexture);
+
+    mSortKeys.resize(mSpriteQueueCount);
+    mSortIndices.resize(mSpriteQueueCount);
+    mSortScratch.resize(mSpriteQueueCount);
+
+    if (useTextureIds)
     {
-        case SpriteSortMode_Texture:
-            // Sort by texture.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + mSpriteQueueCount, [](SpriteInfo const* x, SpriteInfo const* y) -> bool
-            {
-                return x->texture < y->texture;
-            });
-            break;
+        mTextureIds.resize(mSpriteQueueCount);
 
-        case SpriteSortMode_BackToFront:
-            // Sort back to front.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + mSpriteQueueCount, [](SpriteInfo const* x, SpriteInfo const* y) -> bool
-            {
-                return x->originRotationDepth.w > y->originRotationDepth.w;
-            });
-            break;
+        SpriteBatchKernels::AssignTextureIds(mSortedSprites.data(), mSpriteQueueCount, mTextureIds.data());
+    }
 
-        case SpriteSortMode_FrontToBack:
-            // Sort front to back.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + mSpriteQueueCount, [](SpriteInfo const* x, SpriteInfo const* y) -> bool
-            {
-                return x->originRotationDepth.w < y->originRotationDepth.w;
-            });
-            break;
+    SpriteBatchKernels::BuildSortKeys(mSortedSprites.data(), useTextureIds ? mTextureIds.data() : nullptr, mSpriteQueueCount, mSortMode, mSortKeys.data());
+    SpriteBatchKernels::RadixSortIndices(mSortKeys.data(), mSpriteQueueCount, mSortIndices.data(), mSortScratch.data());
+
+    // mSortedSprites still holds the queue order here, so the indices map straight back into mSpriteQueue.
+    for (size_t i = 0; i < mSpriteQueueCount; i++)
+    {
+        mSortedSprites[i] = &mSpriteQueue[mSortIndices[i]];
     }
 }
 
@@ -718,7 +799,7 @@ void SpriteBatch::Impl::GrowSortedSprites()
 
 // Submits a batch of sprites to the GPU.
 _Use_decl_annotations_
-void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInfo const* const* sprites, size_t count)
+void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteData const* const* sprites, size_t count)
 {
     auto deviceContext = mContextResources->deviceContext.Get();
 
@@ -770,14 +851,9 @@ void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInf
 #endif
 
         // Generate sprite vertex data.
-        for (size_t i = 0; i < batchSize; i++)
-        {
-            assert(i < count);
-            _Analysis_assume_(i < count);
-            RenderSprite(sprites[i], vertices, textureSize, inverseTextureSize);
-
-            vertices += VerticesPerSprite;
-        }
+        assert(batchSize <= count);
+        _Analysis_assume_(batchSize <= count);
+        SpriteBatchKernels::ExpandSprites(sprites, batchSize, textureSize, inverseTextureSize, vertices);
 
 #if defined(_XBOX_ONE) && defined(_TITLE)
         deviceContext->IASetPlacementVertexBuffer(0, mContextResources->vertexBuffer.Get(), grfxMemory, sizeof(VertexPositionColorTexture));
@@ -802,121 +878,6 @@ void SpriteBatch::Impl::RenderBatch(ID3D11ShaderResourceView* texture, SpriteInf
 }
 
 
-// Generates vertex data for drawing a single sprite.
-_Use_decl_annotations_
-void XM_CALLCONV SpriteBatch::Impl::RenderSprite(SpriteInfo const* sprite,
-    VertexPositionColorTexture* vertices,
-    FXMVECTOR textureSize,
-    FXMVECTOR inverseTextureSize)
-{
-    // Load sprite parameters into SIMD registers.
-    XMVECTOR source = XMLoadFloat4A(&sprite->source);
-    XMVECTOR destination = XMLoadFloat4A(&sprite->destination);
-    XMVECTOR color = XMLoadFloat4A(&sprite->color);
-    XMVECTOR originRotationDepth = XMLoadFloat4A(&sprite->originRotationDepth);
-
-    float rotation = sprite->originRotationDepth.z;
-    int flags = sprite->flags;
-
-    // Extract the source and destination sizes into separate vectors.
-    XMVECTOR sourceSize = XMVectorSwizzle<2, 3, 2, 3>(source);
-    XMVECTOR destinationSize = XMVectorSwizzle<2, 3, 2, 3>(destination);
-
-    // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
-    XMVECTOR isZeroMask = XMVectorEqual(sourceSize, XMVectorZero());
-    XMVECTOR nonZeroSourceSize = XMVectorSelect(sourceSize, g_XMEpsilon, isZeroMask);
-
-    XMVECTOR origin = XMVectorDivide(originRotationDepth, nonZeroSourceSize);
-
-    // Convert the source region from texels to mod-1 texture coordinate format.
-    if (flags & SpriteInfo::SourceInTexels)
-    {
-        source *= inverseTextureSize;
-        sourceSize *= inverseTextureSize;
-    }
-    else
-    {
-        origin *= inverseTextureSize;
-    }
-
-    // If the destination size is relative to the source region, convert it to pixels.
-    if (!(flags & SpriteInfo::DestSizeInPixels))
-    {
-        destinationSize *= textureSize;
-    }
-
-    // Compute a 2x2 rotation matrix.
-    XMVECTOR rotationMatrix1;
-    XMVECTOR rotationMatrix2;
-
-    if (rotation != 0)
-    {
-        float sin, cos;
-
-        XMScalarSinCos(&sin, &cos, rotation);
-
-        XMVECTOR sinV = XMLoadFloat(&sin);
-        XMVECTOR cosV = XMLoadFloat(&cos);
-
-        rotationMatrix1 = XMVectorMergeXY(cosV, sinV);
-        rotationMatrix2 = XMVectorMergeXY(-sinV, cosV);
-    }
-    else
-    {
-        rotationMatrix1 = g_XMIdentityR0;
-        rotationMatrix2 = g_XMIdentityR1;
-    }
-    
-    // The four corner vertices are computed by transforming these unit-square positions.
-    static XMVECTORF32 cornerOffsets[VerticesPerSprite] =
-    {
-        { 0, 0 },
-        { 1, 0 },
-        { 0, 1 },
-        { 1, 1 },
-    };
-
-    // Tricksy alert! Texture coordinates are computed from the same cornerOffsets
-    // table as vertex positions, but if the sprite is mirrored, this table
-    // must be indexed in a different order. This is done as follows:
-    //
-    //    position = cornerOffsets[i]
-    //    texcoord = cornerOffsets[i ^ SpriteEffects]
-
-    static_assert(SpriteEffects_FlipHorizontally == 1 &&
-                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the mirroring implementation must be updated to match");
-
-    int mirrorBits = flags & 3;
-
-    // Generate the four output vertices.
-    for (int i = 0; i < VerticesPerSprite; i++)
-    {
-        // Calculate position.
-        XMVECTOR cornerOffset = (cornerOffsets[i] - origin) * destinationSize;
-        
-        // Apply 2x2 rotation matrix.
-        XMVECTOR position1 = XMVectorMultiplyAdd(XMVectorSplatX(cornerOffset), rotationMatrix1, destination);
-        XMVECTOR position2 = XMVectorMultiplyAdd(XMVectorSplatY(cornerOffset), rotationMatrix2, position1);
-
-        // Set z = depth.
-        XMVECTOR position = XMVectorPermute<0, 1, 7, 6>(position2, originRotationDepth);
-
-        // Write position as a Float4, even though VertexPositionColor::position is an XMFLOAT3.
-        // This is faster, and harmless as we are just clobbering the first element of the
-        // following color field, which will immediately be overwritten with its correct value.
-        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertices[i].position), position);
-
-        // Write the color.
-        XMStoreFloat4(&vertices[i].color, color);
-
-        // Compute and write the texture coordinate.
-        XMVECTOR textureCoordinate = XMVectorMultiplyAdd(cornerOffsets[i ^ mirrorBits], sourceSize, source);
-
-        XMStoreFloat2(&vertices[i].textureCoordinate, textureCoordinate);
-    }
-}
-
-
 // Helper looks up the size of the specified texture.
 XMVECTOR SpriteBatch::Impl::GetTextureSize(_In_ ID3D11ShaderResourceView* texture)
 {
@@ -1177,6 +1138,29 @@ void XM_CALLCONV SpriteBatch::Draw(ID3D11ShaderResourceView* texture,
 }
 
 
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatch::DrawRects(ID3D11ShaderResourceView* texture,
+    FXMVECTOR position,
+    RECT const* sourceRectangles,
+    XMFLOAT2 const* origins,
+    size_t count,
+    FXMVECTOR color,
+    float rotation,
+    FXMVECTOR origin,
+    GXMVECTOR scale,
+    SpriteEffects effects,
+    float layerDepth)
+{
+    XMVECTOR destination = XMVectorPermute<0, 1, 4, 5>(position, scale); // x, y, scale.x, scale.y
+
+    XMVECTOR rotationDepth = XMVectorMergeXY(XMVectorReplicate(rotation), XMVectorReplicate(layerDepth));
+
+    XMVECTOR originRotationDepth = XMVectorPermute<0, 1, 4, 5>(origin, rotationDepth);
+
+    pImpl->DrawRects(texture, destination, sourceRectangles, origins, count, color, originRotationDepth, effects);
+}
+
+
 void SpriteBatch::SetRotation( DXGI_MODE_ROTATION mode )
 {
     pImpl->mRotation = mode;
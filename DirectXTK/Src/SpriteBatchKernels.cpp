@@ -0,0 +1,393 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteBatchKernels.cpp
+//
+// Device independent SpriteBatch stages (sorting and vertex generation)
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248929
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "SpriteBatchKernels.h"
+
+using namespace DirectX;
+using namespace DirectX::SpriteBatchKernels;
+
+namespace
+{
+    // The four corner vertices are computed by transforming these unit-square positions.
+    const XMVECTORF32 cornerOffsets[VerticesPerSprite] =
+    {
+        { 0, 0 },
+        { 1, 0 },
+        { 0, 1 },
+        { 1, 1 },
+    };
+
+    static_assert(SpriteEffects_FlipHorizontally == 1 &&
+                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the mirroring implementation must be updated to match");
+
+
+    // Maps a float to an unsigned integer with the same ordering. -0 and +0 share a key.
+    inline uint32_t OrderedFloatBits(float value)
+    {
+        value += 0.0f;
+
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    }
+
+
+    // Loads one field of four sprites and transposes it, so each vector holds one component of all four.
+    inline XMMATRIX XM_CALLCONV LoadTransposed(_In_reads_(4) SpriteInfo const* const* sprites, size_t offset)
+    {
+        auto field = [&](size_t i)
+        {
+            return XMLoadFloat4A(reinterpret_cast<XMFLOAT4A const*>(reinterpret_cast<uint8_t const*>(sprites[i]) + offset));
+        };
+
+        return XMMatrixTranspose(XMMATRIX(field(0), field(1), field(2), field(3)));
+    }
+}
+
+
+_Use_decl_annotations_
+size_t __cdecl SpriteBatchKernels::AssignTextureIds(SpriteInfo const* const* sprites, size_t count, uint32_t* textureIds)
+{
+    // Open addressing table keyed on the texture pointer, consulted only when the texture changes.
+    std::vector<std::pair<ID3D11ShaderResourceView*, uint32_t>> table(64);
+    size_t mask = table.size() - 1;
+    uint32_t textureCount = 0;
+
+    auto slot = [&](ID3D11ShaderResourceView* texture) -> size_t
+    {
+        size_t i = (reinterpret_cast<uintptr_t>(texture) >> 4) * 2654435761u & mask;
+
+        while (table[i].first && table[i].first != texture)
+            i = (i + 1) & mask;
+
+        return i;
+    };
+
+    ID3D11ShaderResourceView* lastTexture = nullptr;
+    uint32_t lastId = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ID3D11ShaderResourceView* texture = sprites[i]->texture;
+
+        assert(texture != nullptr);
+
+        if (texture != lastTexture)
+        {
+            size_t s = slot(texture);
+
+            if (!table[s].first)
+            {
+                // Keep the table at most half full.
+                if ((textureCount + 1) * 2 > table.size())
+                {
+                    std::vector<std::pair<ID3D11ShaderResourceView*, uint32_t>> previous(table.size() * 2);
+
+                    previous.swap(table);
+                    mask = table.size() - 1;
+
+                    for (auto const& entry : previous)
+                    {
+                        if (entry.first)
+                            table[slot(entry.first)] = entry;
+                    }
+
+                    s = slot(texture);
+                }
+
+                table[s] = std::make_pair(texture, textureCount++);
+            }
+
+            lastTexture = texture;
+            lastId = table[s].second;
+        }
+
+        textureIds[i] = lastId;
+    }
+
+    return textureCount;
+}
+
+
+_Use_decl_annotations_
+void __cdecl SpriteBatchKernels::BuildSortKeys(SpriteInfo const* const* sprites, uint32_t const* textureIds, size_t count, SpriteSortMode sortMode, uint64_t* keys)
+{
+    const bool useDepth = (sortMode != SpriteSortMode_Texture);
+    const bool backToFront = (sortMode == SpriteSortMode_BackToFront || sortMode == SpriteSortMode_BackToFrontTexture);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t depthBits = 0;
+
+        if (useDepth)
+        {
+            depthBits = OrderedFloatBits(sprites[i]->originRotationDepth.w);
+
+            if (backToFront)
+                depthBits = ~depthBits;
+        }
+
+        uint32_t textureId = textureIds ? textureIds[i] : 0;
+
+        keys[i] = (static_cast<uint64_t>(depthBits) << 32) | textureId;
+    }
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatchKernels::ExpandSprites(SpriteInfo const* const* sprites,
+    size_t count,
+    FXMVECTOR textureSize,
+    FXMVECTOR inverseTextureSize,
+    VertexPositionColorTexture* vertices)
+{
+    const XMVECTOR textureWidth = XMVectorSplatX(textureSize);
+    const XMVECTOR textureHeight = XMVectorSplatY(textureSize);
+    const XMVECTOR inverseWidth = XMVectorSplatX(inverseTextureSize);
+    const XMVECTOR inverseHeight = XMVectorSplatY(inverseTextureSize);
+
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4, sprites += 4, vertices += 4 * VerticesPerSprite)
+    {
+        // Structure of arrays: lane n of every vector below belongs to sprites[n].
+        XMMATRIX source = LoadTransposed(sprites, offsetof(SpriteInfo, source));
+        XMMATRIX destination = LoadTransposed(sprites, offsetof(SpriteInfo, destination));
+        XMMATRIX originRotationDepth = LoadTransposed(sprites, offsetof(SpriteInfo, originRotationDepth));
+
+        XMVECTOR flags = XMVectorSetInt(sprites[0]->flags, sprites[1]->flags, sprites[2]->flags, sprites[3]->flags);
+
+        auto flagMask = [&](int flag)
+        {
+            XMVECTOR bit = XMVectorReplicateInt(static_cast<uint32_t>(flag));
+
+            return XMVectorEqualInt(XMVectorAndInt(flags, bit), bit);
+        };
+
+        XMVECTOR sourceInTexels = flagMask(SpriteInfo::SourceInTexels);
+        XMVECTOR destSizeInPixels = flagMask(SpriteInfo::DestSizeInPixels);
+        XMVECTOR flipHorizontally = flagMask(SpriteEffects_FlipHorizontally);
+        XMVECTOR flipVertically = flagMask(SpriteEffects_FlipVertically);
+
+        XMVECTOR sourceX = source.r[0];
+        XMVECTOR sourceY = source.r[1];
+        XMVECTOR sourceWidth = source.r[2];
+        XMVECTOR sourceHeight = source.r[3];
+
+        // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
+        XMVECTOR originX = XMVectorDivide(originRotationDepth.r[0], XMVectorSelect(sourceWidth, g_XMEpsilon, XMVectorEqual(sourceWidth, zero)));
+        XMVECTOR originY = XMVectorDivide(originRotationDepth.r[1], XMVectorSelect(sourceHeight, g_XMEpsilon, XMVectorEqual(sourceHeight, zero)));
+
+        // Convert the source region from texels to mod-1 texture coordinate format, or else the origin.
+        sourceX = XMVectorSelect(sourceX, sourceX * inverseWidth, sourceInTexels);
+        sourceY = XMVectorSelect(sourceY, sourceY * inverseHeight, sourceInTexels);
+        sourceWidth = XMVectorSelect(sourceWidth, sourceWidth * inverseWidth, sourceInTexels);
+        sourceHeight = XMVectorSelect(sourceHeight, sourceHeight * inverseHeight, sourceInTexels);
+        originX = XMVectorSelect(originX * inverseWidth, originX, sourceInTexels);
+        originY = XMVectorSelect(originY * inverseHeight, originY, sourceInTexels);
+
+        // If the destination size is relative to the source region, convert it to pixels.
+        XMVECTOR destinationWidth = XMVectorSelect(destination.r[2] * textureWidth, destination.r[2], destSizeInPixels);
+        XMVECTOR destinationHeight = XMVectorSelect(destination.r[3] * textureHeight, destination.r[3], destSizeInPixels);
+
+        // Same scalar sin/cos and identity rows as ExpandSprite, so both paths round identically.
+        XMVECTORF32 cosines = { 1, 1, 1, 1 };
+        XMVECTORF32 sines = { 0, 0, 0, 0 };
+
+        for (size_t n = 0; n < 4; n++)
+        {
+            float rotation = sprites[n]->originRotationDepth.z;
+
+            if (rotation != 0)
+            {
+                float sin, cos;
+
+                XMScalarSinCos(&sin, &cos, rotation);
+
+                cosines.f[n] = cos;
+                sines.f[n] = sin;
+            }
+        }
+
+        XMVECTOR cosV = cosines;
+        XMVECTOR sinV = sines;
+        XMVECTOR negativeSinV = XMVectorSelect(zero, XMVectorNegate(sinV), XMVectorNotEqual(originRotationDepth.r[2], zero));
+
+        // Texture coordinates index the corner table with i ^ SpriteEffects; per lane that is a select.
+        XMVECTOR cornerU[2] = { XMVectorSelect(zero, one, flipHorizontally), XMVectorSelect(one, zero, flipHorizontally) };
+        XMVECTOR cornerV[2] = { XMVectorSelect(zero, one, flipVertically), XMVectorSelect(one, zero, flipVertically) };
+
+        XMVECTOR textureU[VerticesPerSprite];
+        XMVECTOR textureV[VerticesPerSprite];
+
+        for (size_t corner = 0; corner < VerticesPerSprite; corner++)
+        {
+            XMVECTOR cornerX = XMVectorSplatX(cornerOffsets[corner]);
+            XMVECTOR cornerY = XMVectorSplatY(cornerOffsets[corner]);
+
+            XMVECTOR offsetX = (cornerX - originX) * destinationWidth;
+            XMVECTOR offsetY = (cornerY - originY) * destinationHeight;
+
+            // Apply 2x2 rotation matrix.
+            XMVECTOR positionX = XMVectorMultiplyAdd(offsetX, cosV, destination.r[0]);
+            XMVECTOR positionY = XMVectorMultiplyAdd(offsetX, sinV, destination.r[1]);
+
+            positionX = XMVectorMultiplyAdd(offsetY, negativeSinV, positionX);
+            positionY = XMVectorMultiplyAdd(offsetY, cosV, positionY);
+
+            // Back to one (x, y, depth, rotation) vector per sprite.
+            XMMATRIX positions = XMMatrixTranspose(XMMATRIX(positionX, positionY, originRotationDepth.r[3], originRotationDepth.r[2]));
+
+            textureU[corner] = XMVectorMultiplyAdd(cornerU[corner & 1], sourceWidth, sourceX);
+            textureV[corner] = XMVectorMultiplyAdd(cornerV[corner >> 1], sourceHeight, sourceY);
+
+            for (size_t n = 0; n < 4; n++)
+            {
+                auto& vertex = vertices[n * VerticesPerSprite + corner];
+
+                // Position as a Float4, clobbering color.x which is written straight after.
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertex.position), positions.r[n]);
+                XMStoreFloat4(&vertex.color, XMLoadFloat4A(&sprites[n]->color));
+            }
+        }
+
+        // (u0, v0, u1, v1) and (u2, v2, u3, v3) per sprite.
+        XMMATRIX textureCoordinates01 = XMMatrixTranspose(XMMATRIX(textureU[0], textureV[0], textureU[1], textureV[1]));
+        XMMATRIX textureCoordinates23 = XMMatrixTranspose(XMMATRIX(textureU[2], textureV[2], textureU[3], textureV[3]));
+
+        for (size_t n = 0; n < 4; n++)
+        {
+            auto spriteVertices = vertices + n * VerticesPerSprite;
+
+            XMStoreFloat2(&spriteVertices[0].textureCoordinate, textureCoordinates01.r[n]);
+            XMStoreFloat2(&spriteVertices[1].textureCoordinate, XMVectorSwizzle<2, 3, 2, 3>(textureCoordinates01.r[n]));
+            XMStoreFloat2(&spriteVertices[2].textureCoordinate, textureCoordinates23.r[n]);
+            XMStoreFloat2(&spriteVertices[3].textureCoordinate, XMVectorSwizzle<2, 3, 2, 3>(textureCoordinates23.r[n]));
+        }
+    }
+
+    for (; i < count; i++, sprites++, vertices += VerticesPerSprite)
+    {
+        ExpandSprite(*sprites, textureSize, inverseTextureSize, vertices);
+    }
+}
+
+
+_Use_decl_annotations_
+void XM_CALLCONV SpriteBatchKernels::ExpandSprite(SpriteInfo const* sprite,
+    FXMVECTOR textureSize,
+    FXMVECTOR inverseTextureSize,
+    VertexPositionColorTexture* vertices)
+{
+    // Load sprite parameters into SIMD registers.
+    XMVECTOR source = XMLoadFloat4A(&sprite->source);
+    XMVECTOR destination = XMLoadFloat4A(&sprite->destination);
+    XMVECTOR color = XMLoadFloat4A(&sprite->color);
+    XMVECTOR originRotationDepth = XMLoadFloat4A(&sprite->originRotationDepth);
+
+    float rotation = sprite->originRotationDepth.z;
+    int flags = sprite->flags;
+
+    // Extract the source and destination sizes into separate vectors.
+    XMVECTOR sourceSize = XMVectorSwizzle<2, 3, 2, 3>(source);
+    XMVECTOR destinationSize = XMVectorSwizzle<2, 3, 2, 3>(destination);
+
+    // Scale the origin offset by source size, taking care to avoid overflow if the source region is zero.
+    XMVECTOR isZeroMask = XMVectorEqual(sourceSize, XMVectorZero());
+    XMVECTOR nonZeroSourceSize = XMVectorSelect(sourceSize, g_XMEpsilon, isZeroMask);
+
+    XMVECTOR origin = XMVectorDivide(originRotationDepth, nonZeroSourceSize);
+
+    // Convert the source region from texels to mod-1 texture coordinate format.
+    if (flags & SpriteInfo::SourceInTexels)
+    {
+        source *= inverseTextureSize;
+        sourceSize *= inverseTextureSize;
+    }
+    else
+    {
+        origin *= inverseTextureSize;
+    }
+
+    // If the destination size is relative to the source region, convert it to pixels.
+    if (!(flags & SpriteInfo::DestSizeInPixels))
+    {
+        destinationSize *= textureSize;
+    }
+
+    // Compute a 2x2 rotation matrix.
+    XMVECTOR rotationMatrix1;
+    XMVECTOR rotationMatrix2;
+
+    if (rotation != 0)
+    {
+        float sin, cos;
+
+        XMScalarSinCos(&sin, &cos, rotation);
+
+        XMVECTOR sinV = XMLoadFloat(&sin);
+        XMVECTOR cosV = XMLoadFloat(&cos);
+
+        rotationMatrix1 = XMVectorMergeXY(cosV, sinV);
+        rotationMatrix2 = XMVectorMergeXY(-sinV, cosV);
+    }
+    else
+    {
+        rotationMatrix1 = g_XMIdentityR0;
+        rotationMatrix2 = g_XMIdentityR1;
+    }
+
+    // Tricksy alert! Texture coordinates are computed from the same cornerOffsets
+    // table as vertex positions, but if the sprite is mirrored, this table
+    // must be indexed in a different order. This is done as follows:
+    //
+    //    position = cornerOffsets[i]
+    //    texcoord = cornerOffsets[i ^ SpriteEffects]
+
+    int mirrorBits = flags & 3;
+
+    // Generate the four output vertices.
+    for (size_t i = 0; i < VerticesPerSprite; i++)
+    {
+        // Calculate position.
+        XMVECTOR cornerOffset = (cornerOffsets[i] - origin) * destinationSize;
+
+        // Apply 2x2 rotation matrix.
+        XMVECTOR position1 = XMVectorMultiplyAdd(XMVectorSplatX(cornerOffset), rotationMatrix1, destination);
+        XMVECTOR position2 = XMVectorMultiplyAdd(XMVectorSplatY(cornerOffset), rotationMatrix2, position1);
+
+        // Set z = depth.
+        XMVECTOR position = XMVectorPermute<0, 1, 7, 6>(position2, originRotationDepth);
+
+        // Write position as a Float4, even though VertexPositionColor::position is an XMFLOAT3.
+        // This is faster, and harmless as we are just clobbering the first element of the
+        // following color field, which will immediately be overwritten with its correct value.
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&vertices[i].position), position);
+
+        // Write the color.
+        XMStoreFloat4(&vertices[i].color, color);
+
+        // Compute and write the texture coordinate.
+        XMVECTOR textureCoordinate = XMVectorMultiplyAdd(cornerOffsets[i ^ mirrorBits], sourceSize, source);
+
+        XMStoreFloat2(&vertices[i].textureCoordinate, textureCoordinate);
+    }
+}
@@ -33,7 +33,9 @@ public:
     Impl(_In_ ID3D11ShaderResourceView* texture, _In_reads_(glyphCount) Glyph const* glyphs, _In_ size_t glyphCount, _In_ float lineSpacing);
 
     Glyph const* FindGlyph(wchar_t character) const;
+    Glyph const* LookupGlyph(wchar_t character) const;
 
+    void BuildDirectGlyphs();
     void SetDefaultCharacter(wchar_t character);
 
     template<typename TAction>
@@ -45,15 +47,47 @@ public:
     std::vector<Glyph> glyphs;
     Glyph const* defaultGlyph;
     float lineSpacing;
+
+    // Direct-mapped lookup for the dense low range (ASCII and Latin-1), null where the font has no
+    // glyph. Characters above it fall back to a binary search of the sorted glyph vector.
+    static const size_t DirectGlyphCount = 256;
+
+    Glyph const* directGlyphs[DirectGlyphCount];
 };
 
 
 // Constants.
 const XMFLOAT2 SpriteFont::Float2Zero(0, 0);
+const XMFLOAT2 TextLayout::Float2Zero(0, 0);
 
 static const char spriteFontMagic[] = "DXTKfont";
 
 
+namespace
+{
+    static_assert(SpriteEffects_FlipHorizontally == 1 &&
+                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
+
+    // Lookup table indicates which way to move along each axis per SpriteEffects enum value.
+    const XMVECTORF32 axisDirectionTable[4] =
+    {
+        { -1, -1 },
+        {  1, -1 },
+        { -1,  1 },
+        {  1,  1 },
+    };
+
+    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
+    const XMVECTORF32 axisIsMirroredTable[4] =
+    {
+        { 0, 0 },
+        { 1, 0 },
+        { 0, 1 },
+        { 1, 1 },
+    };
+}
+
+
 // Comparison operators make our sorted glyph vector work with std::binary_search and lower_bound.
 namespace DirectX
 {
@@ -93,6 +127,8 @@ SpriteFont::Impl::Impl(_In_ ID3D11Device* device, _In_ BinaryReader* reader, boo
 
     glyphs.assign(glyphData, glyphData + glyphCount);
 
+    BuildDirectGlyphs();
+
     // Read font properties.
     lineSpacing = reader->Read<float>();
 
@@ -142,12 +178,34 @@ SpriteFont::Impl::Impl(ID3D11ShaderResourceView* texture, Glyph const* glyphs, s
     {
         throw std::exception("Glyphs must be in ascending codepoint order");
     }
+
+    BuildDirectGlyphs();
 }
 
 
-// Looks up the requested glyph, falling back to the default character if it is not in the font.
-SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
+// Fills the direct-mapped table from the sorted glyph vector.
+void SpriteFont::Impl::BuildDirectGlyphs()
+{
+    std::fill_n(directGlyphs, DirectGlyphCount, nullptr);
+
+    for (auto const& glyph : glyphs)
+    {
+        if (glyph.Character >= DirectGlyphCount)
+            break;
+
+        directGlyphs[glyph.Character] = &glyph;
+    }
+}
+
+
+// Looks up the requested glyph, returning null if it is not in the font.
+SpriteFont::Glyph const* SpriteFont::Impl::LookupGlyph(wchar_t character) const
 {
+    if (character < DirectGlyphCount)
+    {
+        return directGlyphs[character];
+    }
+
     auto glyph = std::lower_bound(glyphs.begin(), glyphs.end(), character);
 
     if (glyph != glyphs.end() && glyph->Character == character)
@@ -155,6 +213,20 @@ SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
         return &*glyph;
     }
 
+    return nullptr;
+}
+
+
+// Looks up the requested glyph, falling back to the default character if it is not in the font.
+SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
+{
+    auto glyph = LookupGlyph(character);
+
+    if (glyph)
+    {
+        return glyph;
+    }
+
     if (defaultGlyph)
     {
         return defaultGlyph;
@@ -293,27 +365,6 @@ void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wc
 
 void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wchar_t const* text, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, SpriteEffects effects, float layerDepth) const
 {
-    static_assert(SpriteEffects_FlipHorizontally == 1 &&
-                  SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
-
-    // Lookup table indicates which way to move along each axis per SpriteEffects enum value.
-    static XMVECTORF32 axisDirectionTable[4] =
-    {
-        { -1, -1 },
-        {  1, -1 },
-        { -1,  1 },
-        {  1,  1 },
-    };
-
-    // Lookup table indicates which axes are mirrored for each SpriteEffects enum value.
-    static XMVECTORF32 axisIsMirroredTable[4] =
-    {
-        { 0, 0 },
-        { 1, 0 },
-        { 0, 1 },
-        { 1, 1 },
-    };
-
     XMVECTOR baseOffset = origin;
 
     // If the text is mirrored, offset the start position accordingly.
@@ -365,6 +416,66 @@ XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ wchar_t const* text) const
 }
 
 
+TextLayout SpriteFont::LayoutString(_In_z_ wchar_t const* text, SpriteEffects effects) const
+{
+    TextLayout layout;
+
+    layout.mTexture = pImpl->texture;
+    layout.mEffects = effects;
+
+    XMVECTOR size = XMVectorZero();
+    XMFLOAT4 bounds(FLT_MAX, FLT_MAX, 0, 0);
+
+    // One walk gathers what MeasureString, MeasureDrawBounds and DrawString each compute.
+    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
+    {
+        float w = (float)(glyph->Subrect.right - glyph->Subrect.left);
+        float h = (float)(glyph->Subrect.bottom - glyph->Subrect.top);
+
+        size = XMVectorMax(size, XMVectorSet(x + w, y + std::max(h + glyph->YOffset, pImpl->lineSpacing), 0, 0));
+
+        float minY = y + glyph->YOffset;
+
+        bounds.x = std::min(bounds.x, x);
+        bounds.y = std::min(bounds.y, minY);
+        bounds.z = std::max(bounds.z, std::max(x + advance, x + w));
+        bounds.w = std::max(bounds.w, minY + h);
+
+        layout.mSourceRects.push_back(glyph->Subrect);
+        layout.mOrigins.push_back(XMFLOAT2(x, minY));
+    });
+
+    XMStoreFloat2(&layout.mSize, size);
+    layout.mBounds = bounds;
+
+    // Same per glyph offsets as DrawString with a zero origin; the draw origin is added on replay.
+    XMVECTOR baseOffset = XMVectorZero();
+
+    if (effects)
+    {
+        baseOffset -= size * axisIsMirroredTable[effects & 3];
+    }
+
+    for (size_t i = 0; i < layout.mOrigins.size(); i++)
+    {
+        XMVECTOR offset = XMVectorMultiplyAdd(XMLoadFloat2(&layout.mOrigins[i]), axisDirectionTable[effects & 3], baseOffset);
+
+        if (effects)
+        {
+            XMVECTOR glyphRect = XMConvertVectorIntToFloat(XMLoadInt4(reinterpret_cast<uint32_t const*>(&layout.mSourceRects[i])), 0);
+
+            glyphRect = XMVectorSwizzle<2, 3, 0, 1>(glyphRect) - glyphRect;
+
+            offset = XMVectorMultiplyAdd(glyphRect, axisIsMirroredTable[effects & 3], offset);
+        }
+
+        XMStoreFloat2(&layout.mOrigins[i], offset);
+    }
+
+    return layout;
+}
+
+
 RECT SpriteFont::MeasureDrawBounds(_In_z_ wchar_t const* text, XMFLOAT2 const& position) const
 {
     RECT result = { LONG_MAX, LONG_MAX, 0, 0 };
@@ -440,7 +551,7 @@ void SpriteFont::SetDefaultCharacter(wchar_t character)
 
 bool SpriteFont::ContainsCharacter(wchar_t character) const
 {
-    return std::binary_search(pImpl->glyphs.begin(), pImpl->glyphs.end(), character);
+    return pImpl->LookupGlyph(character) != nullptr;
 }
 
 
@@ -458,3 +569,62 @@ void SpriteFont::GetSpriteSheet( ID3D11ShaderResourceView** texture ) const
 
     ThrowIfFailed( pImpl->texture.CopyTo( texture ) );
 }
+
+
+// TextLayout
+TextLayout::TextLayout()
+  : mEffects(SpriteEffects_None),
+    mSize(0, 0),
+    mBounds(0, 0, 0, 0)
+{
+}
+
+
+void XM_CALLCONV TextLayout::Draw(_In_ SpriteBatch* spriteBatch, XMFLOAT2 const& position, FXMVECTOR color, float rotation, XMFLOAT2 const& origin, float scale, float layerDepth) const
+{
+    Draw(spriteBatch, XMLoadFloat2(&position), color, rotation, XMLoadFloat2(&origin), XMVectorReplicate(scale), layerDepth);
+}
+
+
+void XM_CALLCONV TextLayout::Draw(_In_ SpriteBatch* spriteBatch, FXMVECTOR position, FXMVECTOR color, float rotation, FXMVECTOR origin, GXMVECTOR scale, float layerDepth) const
+{
+    if (mSourceRects.empty())
+        return;
+
+    spriteBatch->DrawRects(mTexture.Get(), position, mSourceRects.data(), mOrigins.data(), mSourceRects.size(), color, rotation, origin, scale, mEffects, layerDepth);
+}
+
+
+XMVECTOR XM_CALLCONV TextLayout::GetSize() const
+{
+    return XMLoadFloat2(&mSize);
+}
+
+
+RECT TextLayout::GetDrawBounds(XMFLOAT2 const& position) const
+{
+    RECT result = { 0, 0, 0, 0 };
+
+    if (mSourceRects.empty())
+        return result;
+
+    result.left = long(position.x + mBounds.x);
+    result.top = long(position.y + mBounds.y);
+
+    float maxX = position.x + mBounds.z;
+    float maxY = position.y + mBounds.w;
+
+    if (maxX > 0)
+        result.right = long(maxX);
+
+    if (maxY > 0)
+        result.bottom = long(maxY);
+
+    return result;
+}
+
+
+size_t TextLayout::GetGlyphCount() const
+{
+    return mSourceRects.size();
+}
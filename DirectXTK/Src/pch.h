@@ -13,6 +13,8 @@
 
 #pragma once
 
+#if defined(_WIN32)
+
 #pragma warning(push)
 #pragma warning(disable : 4005)
 #define WIN32_LEAN_AND_MEAN
@@ -63,3 +65,68 @@
 #include <wrl.h>
 
 #include <wincodec.h>
+
+#else
+
+// Off Windows only the device independent sources build (sort kernel, parsers), for the
+// tests under Tests/. SAL annotations and calling conventions compile to nothing.
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// what DirectXMath selects on x86/x64, so the SIMD paths are the ones tested
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define _XM_SSE_INTRINSICS_
+#endif
+
+#define __cdecl
+#define __declspec(x) __declspec_##x
+#define __declspec_selectany __attribute__((weak))
+// GCC ignores an attribute ahead of struct; the XMFLOAT4A members align those types anyway
+#define __declspec_align(x)
+#define _Use_decl_annotations_
+#define _In_
+#define _In_z_
+#define _In_opt_
+#define _In_reads_(size)
+#define _In_reads_bytes_(size)
+#define _In_reads_opt_(size)
+#define _Inout_updates_(size)
+#define _Out_
+#define _Out_opt_
+#define _Outptr_
+#define _Outptr_result_maybenull_
+#define _Out_writes_(size)
+#define _Out_writes_bytes_(size)
+#define _Out_writes_bytes_to_(size, count)
+#define _Out_writes_opt_(size)
+
+// the Windows types the file format headers use, and the HRESULTs the parsers return
+typedef int32_t INT;
+typedef uint32_t UINT;
+typedef int32_t HRESULT;
+
+#define MAX_PATH                260
+
+#define S_OK                    ((HRESULT)0L)
+#define E_FAIL                  ((HRESULT)0x80004005L)
+#define E_INVALIDARG            ((HRESULT)0x80070057L)
+#define E_POINTER               ((HRESULT)0x80004003L)
+#define SUCCEEDED(hr)           (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)              (((HRESULT)(hr)) < 0)
+
+#define ERROR_INVALID_DATA      13L
+#define ERROR_HANDLE_EOF        38L
+#define ERROR_NOT_SUPPORTED     50L
+#define HRESULT_FROM_WIN32(x)   ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | (7 << 16) | 0x80000000)))
+
+#endif
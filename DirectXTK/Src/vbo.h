@@ -30,6 +30,9 @@ namespace VBO
         uint32_t numIndices;
     };
 
+    // header_t is followed by numVertices VertexPositionNormalTexture, then numIndices uint16_t
+    const size_t VERTEX_SIZE = 32;
+
 #pragma pack(pop)
 
 }; // namespace
@@ -34,14 +34,19 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <float.h>
 #include <assert.h>
 
 #include <algorithm>
 #include <list>
+#include <map>
 #include <memory>
 #include <vector>
 
+#include <ppl.h>
+
 #include "WAVFileReader.h"
+#include "ADPCMCodec.h"
 
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -786,6 +791,8 @@ enum OPTIONS
     OPT_COMPACT,
     OPT_NOCOMPACT,
     OPT_FRIENDLY_NAMES,
+    OPT_INCREMENTAL,
+    OPT_ADPCM,
     OPT_NOLOGO,
     OPT_MAX
 };
@@ -809,8 +816,17 @@ struct WaveFile
     size_t conv;
     MINIWAVEFORMAT miniFmt;
     std::unique_ptr<uint8_t[]> waveData;
-
-    WaveFile() : conv(0) { memset(&data, 0, sizeof(data)); }
+    uint64_t fileSize;
+    FILETIME writeTime;
+    uint64_t hash;          // of the audio data
+    uint64_t sourceHash;    // of the .wav audio, format and loop points as loaded
+    bool reused;            // audio comes from the previous bank
+    std::unique_ptr<uint8_t[]> encodedFormat;
+    std::unique_ptr<uint8_t[]> encodedData;
+    uint32_t sourceBytes;   // PCM size before ADPCM encoding
+    float snr;              // of the ADPCM encoding in dB, negative when not measured
+
+    WaveFile() : conv(0), fileSize(0), hash(0), sourceHash(0), reused(false), sourceBytes(0), snr(-1.f) { memset(&data, 0, sizeof(data)); memset(&writeTime, 0, sizeof(writeTime)); }
 
     // VS 2013 does not perform impliclit creation of move construtors nor does it support =default,
     // so we explictly add one here
@@ -818,7 +834,16 @@ struct WaveFile
         data(std::move(moveFrom.data)),
         conv(std::move(moveFrom.conv)),
         miniFmt(std::move(moveFrom.miniFmt)),
-        waveData(std::move(moveFrom.waveData))
+        waveData(std::move(moveFrom.waveData)),
+        fileSize(moveFrom.fileSize),
+        writeTime(moveFrom.writeTime),
+        hash(moveFrom.hash),
+        sourceHash(moveFrom.sourceHash),
+        reused(moveFrom.reused),
+        encodedFormat(std::move(moveFrom.encodedFormat)),
+        encodedData(std::move(moveFrom.encodedData)),
+        sourceBytes(moveFrom.sourceBytes),
+        snr(moveFrom.snr)
     {
     }
 };
@@ -852,6 +877,8 @@ const SValue g_pOptions [] =
     { L"c",         OPT_COMPACT },
     { L"nc",        OPT_NOCOMPACT },
     { L"f",         OPT_FRIENDLY_NAMES },
+    { L"i",         OPT_INCREMENTAL },
+    { L"adpcm",     OPT_ADPCM },
     { L"nologo",    OPT_NOLOGO },
     { nullptr,      0 }
 };
@@ -989,6 +1016,9 @@ namespace
         wprintf(L"   -c                  force creation of compact wavebank\n");
         wprintf(L"   -nc                 force creation of non-compact wavebank\n");
         wprintf(L"   -f                  include entry friendly names\n");
+        wprintf(L"   -i                  incremental build, reuses the audio of unchanged\n");
+        wprintf(L"                       entries from the existing output (<output>.cache)\n");
+        wprintf(L"   -adpcm              encode 8/16-bit PCM mono/stereo entries as MS ADPCM\n");
         wprintf(L"   -nologo             suppress copyright message\n");
     }
 
@@ -1047,6 +1077,404 @@ namespace
 
         return false;
     }
+
+    //--------------------------------------------------------------------------------------
+    // Incremental builds
+    //
+    // <output>.cache describes the bank next to it: for every entry the source file stamp,
+    // a hash of the source audio, the wave format, loop and seek data, where the audio sits
+    // in the bank and a hash of that audio. The stamp is only a pre-filter: the source is
+    // still loaded and hashed, and its entry is taken from the old bank (skipping the
+    // transcode) only when both hashes match.
+    //--------------------------------------------------------------------------------------
+    enum ENCODING
+    {
+        ENCODING_SOURCE = 0,            // Audio as found in the .wav files
+        ENCODING_ADPCM,                 // PCM entries transcoded to MS ADPCM (-adpcm)
+    };
+
+#pragma pack(push, 1)
+    struct CACHEHEADER
+    {
+        static const uint32_t SIGNATURE = 'CBWX';
+        static const uint32_t VERSION = 3;
+
+        uint32_t    dwSignature;
+        uint32_t    dwVersion;
+        uint32_t    dwEntryCount;
+        uint32_t    dwSeekCount;        // Seek table entries after the entries
+        uint32_t    dwEncoding;         // ENCODING_* the bank was built with
+        uint64_t    bankSize;
+        FILETIME    bankWriteTime;
+    };
+
+    struct CACHEENTRY
+    {
+        static const size_t FORMAT_LENGTH = 64;
+
+        wchar_t     szSrc[MAX_PATH];
+        uint64_t    fileSize;
+        FILETIME    writeTime;
+        uint64_t    sourceHash;         // HashSource of the .wav
+        uint64_t    hash;               // Of the audio in the bank
+        uint32_t    dwAudioOffset;      // In the bank file
+        uint32_t    dwAudioBytes;
+        uint32_t    dwLoopStart;
+        uint32_t    dwLoopLength;
+        uint32_t    dwSeekOffset;       // Into the seek tables
+        uint32_t    dwSeekCount;
+        uint8_t     format[FORMAT_LENGTH];
+    };
+#pragma pack(pop)
+
+    struct view_closer { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
+    struct path_less { bool operator()(const std::wstring& a, const std::wstring& b) const { return _wcsicmp(a.c_str(), b.c_str()) < 0; } };
+
+    struct BankCache
+    {
+        std::unique_ptr<uint8_t[]> data;
+        ScopedHandle hBank;
+        ScopedHandle hMapping;
+        std::unique_ptr<const uint8_t, view_closer> bank;
+        uint64_t bankSize;
+        std::map<std::wstring, const CACHEENTRY*, path_less> entries;
+
+        BankCache() : bankSize(0) {}
+
+        const CACHEENTRY* Find(const wchar_t* szSrc) const
+        {
+            auto it = entries.find(szSrc);
+            return (it != entries.end()) ? it->second : nullptr;
+        }
+
+        const uint32_t* SeekTables() const
+        {
+            auto header = reinterpret_cast<const CACHEHEADER*>(data.get());
+            return reinterpret_cast<const uint32_t*>(data.get() + sizeof(CACHEHEADER) + sizeof(CACHEENTRY) * header->dwEntryCount);
+        }
+
+        void CloseBank()
+        {
+            bank.reset();
+            hMapping.reset();
+            hBank.reset();
+        }
+
+        void Release()
+        {
+            CloseBank();
+            entries.clear();
+            data.reset();
+        }
+    };
+
+    uint64_t HashAudio(const uint8_t* data, size_t size)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t j = 0; j < size; ++j)
+        {
+            hash ^= data[j];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    uint64_t HashSource(const DirectX::WAVData& data)
+    {
+        // the audio, chained through its format and loop points: a resampled or re-looped
+        // file with the same samples must not reuse the old entry
+        const size_t formatSize = (data.wfx->wFormatTag == WAVE_FORMAT_PCM) ? sizeof(PCMWAVEFORMAT) : sizeof(WAVEFORMATEX) + data.wfx->cbSize;
+        const uint64_t header[3] = { HashAudio(reinterpret_cast<const uint8_t*>(data.wfx), formatSize), data.loopStart, data.loopLength };
+        return HashAudio(reinterpret_cast<const uint8_t*>(header), sizeof(header)) ^ HashAudio(data.startAudio, data.audioBytes);
+    }
+
+    bool LoadBankCache(const wchar_t* szOutputFile, const wchar_t* szCacheFile, uint32_t encoding, BankCache& cache)
+    {
+        ScopedHandle hFile(safe_handle(CreateFileW(szCacheFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+        if (!hFile)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile.get(), &fileSize) || fileSize.HighPart > 0 || fileSize.LowPart < sizeof(CACHEHEADER))
+            return false;
+
+        cache.data.reset(new uint8_t[fileSize.LowPart]);
+        DWORD bytesRead = 0;
+        if (!ReadFile(hFile.get(), cache.data.get(), fileSize.LowPart, &bytesRead, nullptr) || bytesRead != fileSize.LowPart)
+            return false;
+
+        auto header = reinterpret_cast<const CACHEHEADER*>(cache.data.get());
+        if (header->dwSignature != CACHEHEADER::SIGNATURE || header->dwVersion != CACHEHEADER::VERSION || header->dwEncoding != encoding)
+            return false;
+
+        if (uint64_t(sizeof(CACHEHEADER)) + uint64_t(sizeof(CACHEENTRY)) * header->dwEntryCount + uint64_t(sizeof(uint32_t)) * header->dwSeekCount != uint64_t(fileSize.QuadPart))
+            return false;
+
+        // The bank must be the one the cache was written with
+        WIN32_FILE_ATTRIBUTE_DATA attr;
+        if (!GetFileAttributesExW(szOutputFile, GetFileExInfoStandard, &attr))
+            return false;
+
+        cache.bankSize = (uint64_t(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+        if (cache.bankSize != header->bankSize || CompareFileTime(&attr.ftLastWriteTime, &header->bankWriteTime) != 0 || !cache.bankSize)
+            return false;
+
+        cache.hBank.reset(safe_handle(CreateFileW(szOutputFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)));
+        if (!cache.hBank)
+            return false;
+
+        cache.hMapping.reset(CreateFileMappingW(cache.hBank.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (!cache.hMapping)
+            return false;
+
+        cache.bank.reset(reinterpret_cast<const uint8_t*>(MapViewOfFile(cache.hMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+        if (!cache.bank)
+            return false;
+
+        auto entries = reinterpret_cast<const CACHEENTRY*>(cache.data.get() + sizeof(CACHEHEADER));
+        for (uint32_t j = 0; j < header->dwEntryCount; ++j)
+        {
+            auto& entry = entries[j];
+            auto wfx = reinterpret_cast<const WAVEFORMATEX*>(entry.format);
+            if (sizeof(WAVEFORMATEX) + wfx->cbSize > CACHEENTRY::FORMAT_LENGTH
+                || uint64_t(entry.dwAudioOffset) + entry.dwAudioBytes > cache.bankSize
+                || uint64_t(entry.dwSeekOffset) + entry.dwSeekCount > header->dwSeekCount
+                || wcsnlen_s(entry.szSrc, MAX_PATH) >= MAX_PATH)
+                continue;
+
+            cache.entries[entry.szSrc] = &entry;
+        }
+
+        return true;
+    }
+
+    HRESULT LoadWave(const SConversion& conv, const BankCache& cache, WaveFile& wave)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attr;
+        if (!GetFileAttributesExW(conv.szSrc, GetFileExInfoStandard, &attr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        wave.fileSize = (uint64_t(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+        wave.writeTime = attr.ftLastWriteTime;
+
+        HRESULT hr = DirectX::LoadWAVAudioFromFileEx(conv.szSrc, wave.waveData, wave.data);
+        if (FAILED(hr))
+            return hr;
+
+        wave.sourceHash = HashSource(wave.data);
+        wave.hash = HashAudio(wave.data.startAudio, wave.data.audioBytes);
+
+        // Same stamp (a cheap test that weeds out most edits) and same audio as when the entry was built
+        auto entry = cache.Find(conv.szSrc);
+        if (entry && entry->fileSize == wave.fileSize && CompareFileTime(&entry->writeTime, &wave.writeTime) == 0
+            && entry->sourceHash == wave.sourceHash)
+        {
+            auto audio = cache.bank.get() + entry->dwAudioOffset;
+            if (HashAudio(audio, entry->dwAudioBytes) == entry->hash)
+            {
+                wave.waveData.reset();
+                wave.data.wfx = reinterpret_cast<const WAVEFORMATEX*>(entry->format);
+                wave.data.startAudio = audio;
+                wave.data.audioBytes = entry->dwAudioBytes;
+                wave.data.loopStart = entry->dwLoopStart;
+                wave.data.loopLength = entry->dwLoopLength;
+                wave.data.seek = entry->dwSeekCount ? cache.SeekTables() + entry->dwSeekOffset : nullptr;
+                wave.data.seekCount = entry->dwSeekCount;
+                wave.hash = entry->hash;
+                wave.reused = true;
+            }
+        }
+
+        return S_OK;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Transcodes 8/16-bit PCM mono/stereo to MS ADPCM (about 4:1 for 16-bit). The runtime
+    // plays it natively through XAudio2, so the bank stays compressed in memory. Returns
+    // S_FALSE for entries left as they are.
+    //--------------------------------------------------------------------------------------
+    HRESULT EncodeADPCM(WaveFile& wave)
+    {
+        const int samplesPerBlock = DirectX::ADPCM::DEFAULT_SAMPLES_PER_BLOCK;
+
+        auto wfx = wave.data.wfx;
+        if (wfx->wFormatTag != WAVE_FORMAT_PCM
+            || (wfx->nChannels != 1 && wfx->nChannels != 2)
+            || (wfx->wBitsPerSample != 8 && wfx->wBitsPerSample != 16))
+            return S_FALSE;
+
+        // XAudio2 needs ADPCM loop regions on block boundaries
+        if (wave.data.loopLength > 0
+            && ((wave.data.loopStart % samplesPerBlock) != 0 || (wave.data.loopLength % samplesPerBlock) != 0))
+            return S_FALSE;
+
+        const int channels = wfx->nChannels;
+        const size_t frames = wave.data.audioBytes / wfx->nBlockAlign;
+        if (!frames)
+            return S_FALSE;
+
+        std::unique_ptr<int16_t[]> pcm(new int16_t[frames * channels]);
+        if (wfx->wBitsPerSample == 16)
+        {
+            memcpy(pcm.get(), wave.data.startAudio, sizeof(int16_t) * frames * channels);
+        }
+        else
+        {
+            for (size_t j = 0; j < frames * channels; ++j)
+                pcm[j] = int16_t((int(wave.data.startAudio[j]) - 128) << 8);
+        }
+
+        const size_t encodedBytes = DirectX::ADPCM::EncodedSize(frames, channels, samplesPerBlock);
+        if (encodedBytes > UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        wave.encodedData.reset(new uint8_t[encodedBytes]);
+        (void)DirectX::ADPCM::Encode(pcm.get(), frames, channels, samplesPerBlock, wave.encodedData.get());
+
+        // Quality metric: decode it back and compare against the source
+        const size_t decodedFrames = DirectX::ADPCM::DecodedFrames(encodedBytes, channels, samplesPerBlock);
+        std::unique_ptr<int16_t[]> decoded(new int16_t[decodedFrames * channels]);
+        (void)DirectX::ADPCM::Decode(wave.encodedData.get(), encodedBytes, channels, samplesPerBlock, decoded.get());
+        wave.snr = DirectX::ADPCM::SignalToNoise(pcm.get(), decoded.get(), frames * channels);
+
+        // ADPCMWAVEFORMAT with the 7 standard coefficient pairs
+        const size_t formatSize = sizeof(WAVEFORMATEX) + 32 /*MSADPCM_FORMAT_EXTRA_BYTES*/;
+        wave.encodedFormat.reset(new uint8_t[formatSize]);
+        memset(wave.encodedFormat.get(), 0, formatSize);
+
+        auto adpcm = reinterpret_cast<ADPCMWAVEFORMAT*>(wave.encodedFormat.get());
+        adpcm->wfx.wFormatTag = WAVE_FORMAT_ADPCM;
+        adpcm->wfx.nChannels = WORD(channels);
+        adpcm->wfx.nSamplesPerSec = wfx->nSamplesPerSec;
+        adpcm->wfx.nBlockAlign = WORD(DirectX::ADPCM::BlockAlign(channels, samplesPerBlock));
+        adpcm->wfx.nAvgBytesPerSec = DWORD(uint64_t(wfx->nSamplesPerSec) * adpcm->wfx.nBlockAlign / samplesPerBlock);
+        adpcm->wfx.wBitsPerSample = 4 /*MSADPCM_BITS_PER_SAMPLE*/;
+        adpcm->wfx.cbSize = 32 /*MSADPCM_FORMAT_EXTRA_BYTES*/;
+        adpcm->wSamplesPerBlock = WORD(samplesPerBlock);
+        adpcm->wNumCoef = DirectX::ADPCM::NUM_COEFFICIENTS;
+
+        auto coefs = reinterpret_cast<ADPCMCOEFSET*>(wave.encodedFormat.get() + sizeof(WAVEFORMATEX) + sizeof(WORD) * 2);
+        for (int j = 0; j < DirectX::ADPCM::NUM_COEFFICIENTS; ++j)
+        {
+            coefs[j].iCoef1 = DirectX::ADPCM::g_Coefficients1[j];
+            coefs[j].iCoef2 = DirectX::ADPCM::g_Coefficients2[j];
+        }
+
+        wave.sourceBytes = wave.data.audioBytes;
+        wave.data.wfx = &adpcm->wfx;
+        wave.data.startAudio = wave.encodedData.get();
+        wave.data.audioBytes = uint32_t(encodedBytes);
+        wave.waveData.reset();
+
+        wave.hash = HashAudio(wave.data.startAudio, wave.data.audioBytes);
+        return S_OK;
+    }
+
+    bool SaveBankCache(const wchar_t* szOutputFile, const wchar_t* szCacheFile, uint32_t encoding, const std::list<SConversion>& conversion, const std::vector<WaveFile>& waves, const std::vector<uint32_t>& audioOffsets)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attr;
+        if (!GetFileAttributesExW(szOutputFile, GetFileExInfoStandard, &attr))
+            return false;
+
+        CACHEHEADER header = {};
+        header.dwSignature = CACHEHEADER::SIGNATURE;
+        header.dwVersion = CACHEHEADER::VERSION;
+        header.dwEntryCount = uint32_t(waves.size());
+        header.dwEncoding = encoding;
+        header.bankSize = (uint64_t(attr.nFileSizeHigh) << 32) | attr.nFileSizeLow;
+        header.bankWriteTime = attr.ftLastWriteTime;
+
+        std::vector<CACHEENTRY> entries(waves.size());
+        std::vector<uint32_t> seekTables;
+        auto cit = conversion.cbegin();
+        for (size_t j = 0; j < waves.size(); ++j, ++cit)
+        {
+            auto& wave = waves[j];
+            auto& entry = entries[j];
+            memset(&entry, 0, sizeof(CACHEENTRY));
+
+            size_t formatSize = sizeof(WAVEFORMATEX) + wave.data.wfx->cbSize;
+            if (wave.data.wfx->wFormatTag == WAVE_FORMAT_PCM)
+                formatSize = sizeof(PCMWAVEFORMAT);
+            if (formatSize > CACHEENTRY::FORMAT_LENGTH)
+                continue; // never matches, reloaded on the next build
+
+            wcscpy_s(entry.szSrc, cit->szSrc);
+            entry.fileSize = wave.fileSize;
+            entry.writeTime = wave.writeTime;
+            entry.sourceHash = wave.sourceHash;
+            entry.hash = wave.hash;
+            entry.dwAudioOffset = audioOffsets[j];
+            entry.dwAudioBytes = wave.data.audioBytes;
+            entry.dwLoopStart = wave.data.loopStart;
+            entry.dwLoopLength = wave.data.loopLength;
+            entry.dwSeekOffset = uint32_t(seekTables.size());
+            entry.dwSeekCount = wave.data.seek ? wave.data.seekCount : 0;
+            memcpy(entry.format, wave.data.wfx, formatSize);
+            if (formatSize < sizeof(WAVEFORMATEX))
+                reinterpret_cast<WAVEFORMATEX*>(entry.format)->cbSize = 0;
+
+            seekTables.insert(seekTables.end(), wave.data.seek, wave.data.seek + entry.dwSeekCount);
+        }
+        header.dwSeekCount = uint32_t(seekTables.size());
+
+        ScopedHandle hFile(safe_handle(CreateFileW(szCacheFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)));
+        if (!hFile)
+            return false;
+
+        return WriteFile(hFile.get(), &header, sizeof(header), nullptr, nullptr)
+            && WriteFile(hFile.get(), entries.data(), DWORD(sizeof(CACHEENTRY) * entries.size()), nullptr, nullptr)
+            && (seekTables.empty() || WriteFile(hFile.get(), seekTables.data(), DWORD(sizeof(uint32_t) * seekTables.size()), nullptr, nullptr));
+    }
+
+    // Batches small writes so the bank goes out in one sequential pass
+    class BufferedWriter
+    {
+    public:
+        explicit BufferedWriter(HANDLE hFile) : m_hFile(hFile), m_buffer(new uint8_t[BUFFER_SIZE]), m_used(0) {}
+
+        bool Write(const void* data, size_t size)
+        {
+            if (m_used + size > BUFFER_SIZE)
+            {
+                if (!Flush())
+                    return false;
+
+                if (size >= BUFFER_SIZE)
+                    return WriteFile(m_hFile, data, DWORD(size), nullptr, nullptr) != 0;
+            }
+
+            memcpy(m_buffer.get() + m_used, data, size);
+            m_used += size;
+            return true;
+        }
+
+        bool Pad(size_t size)
+        {
+            static const uint8_t s_zero[ALIGNMENT_DVD] = {};
+            assert(size <= ALIGNMENT_DVD);
+            return Write(s_zero, size);
+        }
+
+        bool Flush()
+        {
+            if (!m_used)
+                return true;
+
+            BOOL result = WriteFile(m_hFile, m_buffer.get(), DWORD(m_used), nullptr, nullptr);
+            m_used = 0;
+            return result != 0;
+        }
+
+    private:
+        static const size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+        HANDLE m_hFile;
+        std::unique_ptr<uint8_t[]> m_buffer;
+        size_t m_used;
+    };
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1177,52 +1605,108 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
     bool xma = false;
 
-    size_t index = 0;
-    for (auto pConv = conversion.begin(); pConv != conversion.end(); ++pConv, ++index)
+    if (!*szOutputFile)
     {
         wchar_t ext[_MAX_EXT];
         wchar_t fname[_MAX_FNAME];
-        _wsplitpath_s(pConv->szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
+        _wsplitpath_s(conversion.begin()->szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
 
-        // Load source image
-        if (pConv != conversion.begin())
-            wprintf(L"\n");
-        else if (!*szOutputFile)
+        if (_wcsicmp(ext, L".xwb") == 0)
         {
-            if (_wcsicmp(ext, L".xwb") == 0)
-            {
-                wprintf(L"ERROR: Need to specify output file via -o\n");
-                return 1;
-            }
+            wprintf(L"ERROR: Need to specify output file via -o\n");
+            return 1;
+        }
+
+        _wmakepath_s(szOutputFile, nullptr, nullptr, fname, L".xwb");
+    }
+
+    const uint32_t encoding = (dwOptions & (1 << OPT_ADPCM)) ? ENCODING_ADPCM : ENCODING_SOURCE;
 
-            _wmakepath_s(szOutputFile, nullptr, nullptr, fname, L".xwb");
+    wchar_t szCacheFile[MAX_PATH] = { 0 };
+    BankCache cache;
+    if (dwOptions & (1 << OPT_INCREMENTAL))
+    {
+        swprintf_s(szCacheFile, L"%ls.cache", szOutputFile);
+        if (!LoadBankCache(szOutputFile, szCacheFile, encoding, cache))
+        {
+            wprintf(L"no valid cache for %ls, rebuilding every entry\n", szOutputFile);
+            cache.Release();
         }
+    }
 
-        wprintf(L"reading %ls", pConv->szSrc);
-        fflush(stdout);
+    // Load and validate the sources in parallel, then report in command-line order
+    std::vector<const SConversion*> sources;
+    for (auto pConv = conversion.cbegin(); pConv != conversion.cend(); ++pConv)
+        sources.push_back(&*pConv);
 
-        WaveFile wave;
-        wave.conv = index;
-        std::unique_ptr<uint8_t[]> waveData;
+    waves.resize(sources.size());
+    std::vector<HRESULT> results(sources.size(), S_OK);
+    std::vector<uint8_t> encoded(sources.size(), 0);
 
-        HRESULT hr = DirectX::LoadWAVAudioFromFileEx(pConv->szSrc, waveData, wave.data);
-        if (FAILED(hr))
+    concurrency::parallel_for(size_t(0), sources.size(), [&](size_t j)
+    {
+        auto& wave = waves[j];
+        wave.conv = j;
+        results[j] = LoadWave(*sources[j], cache, wave);
+        if (SUCCEEDED(results[j]) && encoding == ENCODING_ADPCM && !wave.reused)
+            results[j] = EncodeADPCM(wave);
+        if (SUCCEEDED(results[j]))
+            encoded[j] = ConvertToMiniFormat(wave.data.wfx, wave.data.seek != 0, wave.miniFmt);
+    });
+
+    size_t reused = 0;
+    size_t transcoded = 0;
+    uint64_t sourceBytes = 0;
+    uint64_t transcodedBytes = 0;
+    float minSNR = FLT_MAX;
+    double totalSNR = 0.0;
+    for (size_t j = 0; j < sources.size(); ++j)
+    {
+        wprintf(L"reading %ls", sources[j]->szSrc);
+
+        if (FAILED(results[j]))
         {
-            wprintf(L"\nERROR: Failed to load file (%08X)\n", hr);
+            wprintf(L"\nERROR: Failed to load file (%08X)\n", results[j]);
             return 1;
         }
 
-        wave.waveData = std::move(waveData);
+        PrintInfo(waves[j]);
 
-        PrintInfo(wave);
+        if (waves[j].reused)
+        {
+            wprintf(L" unchanged");
+            ++reused;
+        }
+        else if (waves[j].snr >= 0.f)
+        {
+            wprintf(L" -> MS ADPCM, SNR %.1f dB", waves[j].snr);
+            ++transcoded;
+            sourceBytes += waves[j].sourceBytes;
+            transcodedBytes += waves[j].data.audioBytes;
+            minSNR = std::min(minSNR, waves[j].snr);
+            totalSNR += waves[j].snr;
+        }
 
-        if (wave.data.wfx->wFormatTag == WAVE_FORMAT_XMA2)
-            xma = true;
+        wprintf(L"\n");
 
-        waves.emplace_back(std::move(wave));
+        if (!encoded[j])
+        {
+            wprintf(L"ERROR: Failed encoding %ls\n", sources[j]->szSrc);
+            return 1;
+        }
+
+        if (waves[j].data.wfx->wFormatTag == WAVE_FORMAT_XMA2)
+            xma = true;
     }
 
-    wprintf(L"\n");
+    if (dwOptions & (1 << OPT_INCREMENTAL))
+        wprintf(L"%Iu of %Iu entries reused from %ls\n", reused, waves.size(), szOutputFile);
+
+    if (transcoded > 0)
+    {
+        wprintf(L"%Iu entries encoded to MS ADPCM: %I64u KB -> %I64u KB, SNR min %.1f dB, average %.1f dB\n",
+            transcoded, sourceBytes / 1024, transcodedBytes / 1024, minSNR, totalSNR / double(transcoded));
+    }
 
     DWORD dwAlignment = ALIGNMENT_MIN;
     if (dwOptions & (1 << OPT_STREAMING))
@@ -1230,7 +1714,6 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     else if (xma)
         dwAlignment = 2048;
 
-    // Convert wave format to miniformat, failing if any won't map
     // Check to see if we can use the compact wave bank format
     bool compact = (dwOptions & (1 << OPT_NOCOMPACT)) ? false : true;
     int reason = 0;
@@ -1238,14 +1721,6 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
     for (auto it = waves.begin(); it != waves.end(); ++it)
     {
-        if (!ConvertToMiniFormat(it->data.wfx, it->data.seek != 0, it->miniFmt))
-        {
-            auto cit = conversion.cbegin();
-            advance(cit, it->conv);
-            wprintf(L"ERROR: Failed encoding %ls\n", cit->szSrc);
-            return 1;
-        }
-
         if (it == waves.begin())
         {
             memcpy(&compactFormat, &it->miniFmt, sizeof(MINIWAVEFORMAT));
@@ -1429,13 +1904,6 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
     }
 
-    hFile.reset(safe_handle(CreateFileW(szOutputFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr)));
-    if (!hFile)
-    {
-        wprintf(L"ERROR: Failed opening output file %ls, %u\n", szOutputFile, GetLastError());
-        return 1;
-    }
-
     // Setup wave bank header
     HEADER header;
     memset(&header, 0, sizeof(header));
@@ -1443,11 +1911,6 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     header.dwHeaderVersion = HEADER::VERSION;
     header.dwVersion = XACT_CONTENT_VERSION;
 
-    DWORD segmentOffset = sizeof(HEADER);
-
-    // Write bank metadata
-    assert((segmentOffset % 4) == 0);
-
     BANKDATA data;
     memset(&data, 0, sizeof(data));
 
@@ -1488,58 +1951,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
     }
 
-    if (SetFilePointer(hFile.get(), segmentOffset, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-    {
-        wprintf(L"ERROR: Failed writing bank data to %ls, SFP %u\n", szOutputFile, GetLastError());
-        return 1;
-    }
-
-    if (!WriteFile(hFile.get(), &data, sizeof(data), nullptr, nullptr))
-    {
-        wprintf(L"ERROR: Failed writing bank data to %ls, %u\n", szOutputFile, GetLastError());
-        return 1;
-    }
-
-    header.Segments[HEADER::SEGIDX_BANKDATA].dwOffset = segmentOffset;
-    header.Segments[HEADER::SEGIDX_BANKDATA].dwLength = sizeof(BANKDATA);
-    segmentOffset += sizeof(BANKDATA);
-
-    // Write entry metadata
-    assert((segmentOffset % 4) == 0);
-
-    if (SetFilePointer(hFile.get(), segmentOffset, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-    {
-        wprintf(L"ERROR: Failed writing entry metadata to %ls, SFP %u\n", szOutputFile, GetLastError());
-        return 1;
-    }
-
-    uint32_t entryBytes = uint32_t(waves.size() * data.dwEntryMetaDataElementSize);
-    if (!WriteFile(hFile.get(), entries.get(), entryBytes, nullptr, nullptr))
-    {
-        wprintf(L"ERROR: Failed writing entry metadata to %ls, %u\n", szOutputFile, GetLastError());
-        return 1;
-    }
-
-    header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset = segmentOffset;
-    header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwLength = entryBytes;
-    segmentOffset += entryBytes;
-
-    // Write seek tables
-    assert((segmentOffset % 4) == 0);
-
-    header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset = segmentOffset;
+    // Build seek tables
+    std::unique_ptr<uint32_t[]> seekTables;
+    uint32_t seekLen = 0;
 
     if (seekEntries > 0)
     {
         seekEntries += waves.size(); // Room for an offset per entry
 
-        std::unique_ptr<uint32_t[]> seekTables(new uint32_t[seekEntries]);
-
-        if (SetFilePointer(hFile.get(), segmentOffset, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-        {
-            wprintf(L"ERROR: Failed writing seek tables to %ls, SFP %u\n", szOutputFile, GetLastError());
-            return 1;
-        }
+        seekTables.reset(new uint32_t[seekEntries]);
 
         uint32_t seekoffset = 0;
         uint32_t index = 0;
@@ -1579,71 +1999,85 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
-        uint32_t seekLen = uint32_t(sizeof(uint32_t) * seekEntries);
-
-        if (!WriteFile(hFile.get(), seekTables.get(), seekLen, nullptr, nullptr))
-        {
-            wprintf(L"ERROR: Failed writing seek tables to %ls, %u\n", szOutputFile, GetLastError());
-            return 1;
-        }
+        seekLen = uint32_t(sizeof(uint32_t) * seekEntries);
+    }
 
-        segmentOffset += seekLen;
+    // Lay out every segment up front so the file is written front to back in one pass
+    uint32_t entryBytes = uint32_t(waves.size() * data.dwEntryMetaDataElementSize);
+    uint32_t entryNamesBytes = (dwOptions & (1 << OPT_FRIENDLY_NAMES)) ? uint32_t(count * data.dwEntryNameElementSize) : 0;
 
-        header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength = seekLen;
-    }
-    else
-    {
-        header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength = 0;
-    }
+    DWORD segmentOffset = sizeof(HEADER);
 
-    // Write entry names
-    if (dwOptions & (1 << OPT_FRIENDLY_NAMES))
-    {
-        assert((segmentOffset % 4) == 0);
+    header.Segments[HEADER::SEGIDX_BANKDATA].dwOffset = segmentOffset;
+    header.Segments[HEADER::SEGIDX_BANKDATA].dwLength = sizeof(BANKDATA);
+    segmentOffset += sizeof(BANKDATA);
 
-        if (SetFilePointer(hFile.get(), segmentOffset, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-        {
-            wprintf(L"ERROR: Failed writing friendly entry names to %ls, SFP %u\n", szOutputFile, GetLastError());
-            return 1;
-        }
+    header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwOffset = segmentOffset;
+    header.Segments[HEADER::SEGIDX_ENTRYMETADATA].dwLength = entryBytes;
+    segmentOffset += entryBytes;
 
-        uint32_t entryNamesBytes = uint32_t(count * data.dwEntryNameElementSize);
-        if (!WriteFile(hFile.get(), entryNames.get(), entryNamesBytes, nullptr, nullptr))
-        {
-            wprintf(L"ERROR: Failed writing friendly entry names to %ls, %u\n", szOutputFile, GetLastError());
-            return 1;
-        }
+    header.Segments[HEADER::SEGIDX_SEEKTABLES].dwOffset = segmentOffset;
+    header.Segments[HEADER::SEGIDX_SEEKTABLES].dwLength = seekLen;
+    segmentOffset += seekLen;
 
+    if (entryNamesBytes)
+    {
         header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwOffset = segmentOffset;
         header.Segments[HEADER::SEGIDX_ENTRYNAMES].dwLength = entryNamesBytes;
         segmentOffset += entryNamesBytes;
     }
 
-    // Write wave data
+    assert((segmentOffset % 4) == 0);
+
+    DWORD metadataEnd = segmentOffset;
     segmentOffset = BLOCKALIGNPAD(segmentOffset, dwAlignment);
 
+    if ((uint64_t(segmentOffset) + waveOffset) > UINT32_MAX)
+    {
+        wprintf(L"ERROR: Data exceeds maximum size for wavebank\n");
+        return 1;
+    }
+
     header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset = segmentOffset;
     header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwLength = uint32_t(waveOffset);
 
-    for (auto it = waves.begin(); it != waves.end(); ++it)
+    // Written to a temporary file, the old bank may still be mapped for reused entries
+    wchar_t szTempFile[MAX_PATH] = { 0 };
+    swprintf_s(szTempFile, L"%ls.tmp", szOutputFile);
+
+    hFile.reset(safe_handle(CreateFileW(szTempFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+    if (!hFile)
     {
-        if (SetFilePointer(hFile.get(), segmentOffset, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
-        {
-            wprintf(L"ERROR: Failed writing audio data to %ls, SFP %u\n", szOutputFile, GetLastError());
-            return 1;
-        }
+        wprintf(L"ERROR: Failed opening output file %ls, %u\n", szTempFile, GetLastError());
+        return 1;
+    }
 
-        if (!WriteFile(hFile.get(), it->data.startAudio, it->data.audioBytes, nullptr, nullptr))
-        {
-            wprintf(L"ERROR: Failed writing audio data to %ls, %u\n", szOutputFile, GetLastError());
-            return 1;
-        }
+    BufferedWriter writer(hFile.get());
+
+    if (!writer.Write(&header, sizeof(header))
+        || !writer.Write(&data, sizeof(data))
+        || !writer.Write(entries.get(), entryBytes)
+        || (seekLen && !writer.Write(seekTables.get(), seekLen))
+        || (entryNamesBytes && !writer.Write(entryNames.get(), entryNamesBytes))
+        || !writer.Pad(segmentOffset - metadataEnd))
+    {
+        wprintf(L"ERROR: Failed writing bank metadata to %ls, %u\n", szTempFile, GetLastError());
+        return 1;
+    }
+
+    // Write wave data
+    std::vector<uint32_t> audioOffsets;
+    audioOffsets.reserve(waves.size());
 
+    for (auto it = waves.begin(); it != waves.end(); ++it)
+    {
         DWORD alignedSize = BLOCKALIGNPAD(it->data.audioBytes, dwAlignment);
 
-        if ((uint64_t(segmentOffset) + alignedSize) > UINT32_MAX)
+        audioOffsets.push_back(segmentOffset);
+
+        if (!writer.Write(it->data.startAudio, it->data.audioBytes) || !writer.Pad(alignedSize - it->data.audioBytes))
         {
-            wprintf(L"ERROR: Data exceeds maximum size for wavebank\n");
+            wprintf(L"ERROR: Failed writing audio data to %ls, %u\n", szTempFile, GetLastError());
             return 1;
         }
 
@@ -1653,28 +2087,29 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     assert(segmentOffset == (header.Segments[HEADER::SEGIDX_ENTRYWAVEDATA].dwOffset + waveOffset));
 
     // Commit wave bank
-    if (SetFilePointer(hFile.get(), segmentOffset, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+    if (!writer.Flush())
     {
-        wprintf(L"ERROR: Failed committing output file %ls, EOF %u\n", szOutputFile, GetLastError());
+        wprintf(L"ERROR: Failed committing output file %ls, %u\n", szTempFile, GetLastError());
         return 1;
     }
 
-    if (!SetEndOfFile(hFile.get()))
-    {
-        wprintf(L"ERROR: Failed committing output file %ls, EOF %u\n", szOutputFile, GetLastError());
-        return 1;
-    }
+    hFile.reset();
+    cache.CloseBank(); // reused entries still point at the cache for their format and seek data
 
-    if (SetFilePointer(hFile.get(), 0, 0, FILE_BEGIN) == INVALID_SET_FILE_POINTER)
+    if (!MoveFileExW(szTempFile, szOutputFile, MOVEFILE_REPLACE_EXISTING))
     {
-        wprintf(L"ERROR: Failed committing output file %ls, HDR %u\n", szOutputFile, GetLastError());
+        wprintf(L"ERROR: Failed committing output file %ls, %u\n", szOutputFile, GetLastError());
+        DeleteFileW(szTempFile);
         return 1;
     }
 
-    if (!WriteFile(hFile.get(), &header, sizeof(header), nullptr, nullptr))
+    if (dwOptions & (1 << OPT_INCREMENTAL))
     {
-        wprintf(L"ERROR: Failed committing output file %ls, HDR %u\n", szOutputFile, GetLastError());
-        return 1;
+        if (!SaveBankCache(szOutputFile, szCacheFile, encoding, conversion, waves, audioOffsets))
+        {
+            wprintf(L"WARNING: Failed writing cache %ls, the next build will be a full rebuild\n", szCacheFile);
+            DeleteFileW(szCacheFile);
+        }
     }
 
     // Write C header if requested
@@ -14,7 +14,7 @@ using namespace Concurrency;
 
 // Loads and initializes application assets when the application is loaded.
 SpookyAdulthoodMain::SpookyAdulthoodMain(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-	m_deviceResources(deviceResources)
+	m_deviceResources(deviceResources), m_lastHeapAllocations(0)
 {
 #pragma warning(disable:4316)
 	m_deviceResources->RegisterDeviceNotify(this);
@@ -25,6 +25,15 @@ SpookyAdulthoodMain::SpookyAdulthoodMain(const std::shared_ptr<DX::DeviceResourc
 	// e.g. for 60 FPS fixed timestep update logic, call:
 	m_timer.SetFixedTimeStep(true);
 	m_timer.SetTargetElapsedSeconds(1.0 / 60);
+#if defined(_DEBUG)
+    // anything over two fixed steps is a visible hitch
+    m_timer.SetHitchCallback(DX::StepTimer::SecondsToTicks(2.0 / 60), [](uint64_t frameTicks)
+    {
+        wchar_t buff[64];
+        swprintf_s(buff, L"Hitch: %.1f ms\n", DX::StepTimer::TicksToSeconds(frameTicks) * 1000.0);
+        OutputDebugStringW(buff);
+    });
+#endif
 #pragma warning(default:4316)
 }
 
@@ -44,6 +53,7 @@ void SpookyAdulthoodMain::CreateWindowSizeDependentResources()
 // Updates the application state once per frame.
 void SpookyAdulthoodMain::Update()
 {
+    DX_PROFILE_SCOPE("SpookyAdulthoodMain::Update");
     try
     {
         // Update scene objects.
@@ -72,6 +82,7 @@ void SpookyAdulthoodMain::Update()
 // Returns true if the frame was rendered and is ready to be displayed.
 bool SpookyAdulthoodMain::Draw3D() 
 {
+    DX_PROFILE_SCOPE("SpookyAdulthoodMain::Draw3D");
 	// Don't try to render anything before the first Update.
 	if (m_timer.GetFrameCount() == 0)
 	{
@@ -122,6 +133,24 @@ bool SpookyAdulthoodMain::Draw3D()
 	return true;
 }
 
+// Called once per loop iteration, after presenting (or not). Everything allocated on the
+// frame arenas this frame stays valid for FrameArena::Buffering - 1 more frames
+void SpookyAdulthoodMain::EndFrame()
+{
+    const uint64_t heapAllocations = DX::GetThreadHeapAllocations();
+    auto gameRes = m_deviceResources->GetGameResources();
+    if (gameRes)
+    {
+        gameRes->m_frameHeapAllocations = (uint32_t)(heapAllocations - m_lastHeapAllocations);
+        gameRes->m_frameArenaStats = DX::FrameArena::Get().GetStats();
+    }
+    m_lastHeapAllocations = heapAllocations;
+    DX::FrameArena::EndFrame();
+#if DX_PROFILER
+    DX::Profiler::EndFrame();
+#endif
+}
+
 // Notifies renderers that device resources need to be released.
 void SpookyAdulthoodMain::OnDeviceLost()
 {
@@ -16,6 +16,7 @@ namespace SpookyAdulthood
 		void CreateWindowSizeDependentResources();
 		void Update();
 		bool Draw3D();
+        void EndFrame();
         void OnKeyDown(Windows::System::VirtualKey virtualKey);
 
 		// IDeviceNotify
@@ -32,5 +33,6 @@ namespace SpookyAdulthood
 
 		// Rendering loop timer.
 		DX::StepTimer m_timer;
+        uint64_t m_lastHeapAllocations; // main thread, at the end of the previous frame
 	};
 }
\ No newline at end of file
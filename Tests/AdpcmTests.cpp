@@ -0,0 +1,89 @@
+﻿#include "pch.h"
+#include "ADPCMCodec.h"
+#include "TestMain.h"
+
+#include <math.h>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    // tone plus noise, or full scale noise to hit the clamps
+    std::vector<int16_t> MakePcm(size_t frames, int channels, bool fullScale, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> noise(fullScale ? -32768 : -1000, fullScale ? 32767 : 1000);
+        std::vector<int16_t> pcm(frames * channels);
+        for (size_t i = 0; i < frames; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                const double tone = fullScale ? 0.0 : sin(6.283185307 * (220.0 + 110.0 * c) * double(i) / 22050.0) * 12000.0;
+                pcm[i * channels + c] = int16_t(std::max(-32768.0, std::min(32767.0, tone + noise(rng))));
+            }
+        }
+        return pcm;
+    }
+}
+
+TEST_CASE(SizesRoundTrip)
+{
+    const int blockSizes[] = { ADPCM::DEFAULT_SAMPLES_PER_BLOCK, 64, 32 };
+    for (int spb : blockSizes)
+    {
+        for (int channels = 1; channels <= 2; ++channels)
+        {
+            CHECK(ADPCM::BlockAlign(channels, spb) == size_t(ADPCM::HEADER_LENGTH * channels + (spb - 2) * channels / 2));
+            // an odd partial block in mono is padded to a whole byte, one more frame decoded
+            const size_t frameCounts[] = { 2, 4, size_t(spb), size_t(spb) + 2, size_t(spb) * 4, size_t(spb) * 9 + 8 };
+            for (size_t frames : frameCounts)
+                CHECK(ADPCM::DecodedFrames(ADPCM::EncodedSize(frames, channels, spb), channels, spb) == frames);
+        }
+    }
+}
+
+TEST_CASE(DecodeMatchesScalar)
+{
+    // whole groups of 4 lanes, leftover full blocks and a partial last block
+    const int blockSizes[] = { ADPCM::DEFAULT_SAMPLES_PER_BLOCK, 64 };
+    for (int spb : blockSizes)
+    {
+        for (int channels = 1; channels <= 2; ++channels)
+        {
+            const size_t frameCounts[] = { size_t(spb), size_t(spb) * 4, size_t(spb) * 5 + 3, size_t(spb) * 13 + spb / 2 };
+            for (size_t frames : frameCounts)
+            {
+                for (int fullScale = 0; fullScale < 2; ++fullScale)
+                {
+                    const std::vector<int16_t> pcm = MakePcm(frames, channels, fullScale != 0, uint32_t(frames * 4 + channels));
+                    std::vector<uint8_t> encoded(ADPCM::EncodedSize(frames, channels, spb));
+                    CHECK(ADPCM::Encode(pcm.data(), frames, channels, spb, encoded.data()) == encoded.size());
+
+                    const size_t decodedFrames = ADPCM::DecodedFrames(encoded.size(), channels, spb);
+                    std::vector<int16_t> scalar(decodedFrames * channels), simd(decodedFrames * channels);
+                    CHECK(ADPCM::DecodeScalar(encoded.data(), encoded.size(), channels, spb, scalar.data()) == decodedFrames);
+                    CHECK(ADPCM::Decode(encoded.data(), encoded.size(), channels, spb, simd.data()) == decodedFrames);
+                    CHECK(scalar == simd);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(ToneQuality)
+{
+    // 4 bits per sample, a clean tone must come back well above the noise
+    const size_t frames = 22050;
+    for (int channels = 1; channels <= 2; ++channels)
+    {
+        const std::vector<int16_t> pcm = MakePcm(frames, channels, false, 997);
+        const int spb = ADPCM::DEFAULT_SAMPLES_PER_BLOCK;
+        std::vector<uint8_t> encoded(ADPCM::EncodedSize(frames, channels, spb));
+        ADPCM::Encode(pcm.data(), frames, channels, spb, encoded.data());
+        std::vector<int16_t> decoded(frames * channels);
+        ADPCM::Decode(encoded.data(), encoded.size(), channels, spb, decoded.data());
+        CHECK(ADPCM::SignalToNoise(pcm.data(), decoded.data(), pcm.size()) > 20.0f);
+        CHECK(ADPCM::SignalToNoise(pcm.data(), pcm.data(), pcm.size()) == 144.0f);
+    }
+}
@@ -0,0 +1,123 @@
+﻿#include "pch.h"
+#include "Content/CollisionAndSolving.h"
+#include "TestMain.h"
+
+#include <cmath>
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    bool Near(float a, float b, float tol = 1e-4f) { return fabsf(a - b) <= tol; }
+    bool Near(const XMFLOAT2& a, const XMFLOAT2& b, float tol = 1e-4f) { return Near(a.x, b.x, tol) && Near(a.y, b.y, tol); }
+    bool Near(const XMFLOAT3& a, const XMFLOAT3& b, float tol = 1e-4f) { return Near(a.x, b.x, tol) && Near(a.y, b.y, tol) && Near(a.z, b.z, tol); }
+
+    CollSegment Segment(float x0, float y0, float x1, float y1)
+    {
+        CollSegment seg;
+        seg.start = XMFLOAT2(x0, y0);
+        seg.end = XMFLOAT2(x1, y1);
+        seg.normal = XMFLOAT2(0, 0);
+        seg.flags = CollSegment::WALL;
+        return seg;
+    }
+}
+
+TEST_CASE(SegmentsCross)
+{
+    XMFLOAT2 hit;
+    float frac = -1.0f;
+    CHECK(FPSCDRaycast(XMFLOAT2(0, 0), XMFLOAT2(4, 4), XMFLOAT2(0, 4), XMFLOAT2(4, 0), &hit, &frac));
+    CHECK(Near(frac, 0.5f) && Near(hit, XMFLOAT2(2, 2)));
+
+    // the ends count, parallel and disjoint segments do not
+    CHECK(FPSCDRaycast(XMFLOAT2(0, 0), XMFLOAT2(2, 0), XMFLOAT2(2, -1), XMFLOAT2(2, 1), &hit, &frac) && Near(frac, 1.0f));
+    CHECK(!FPSCDRaycast(XMFLOAT2(0, 0), XMFLOAT2(2, 0), XMFLOAT2(0, 1), XMFLOAT2(2, 1), &hit, &frac));
+    CHECK(!FPSCDRaycast(XMFLOAT2(0, 0), XMFLOAT2(1, 0), XMFLOAT2(2, -1), XMFLOAT2(2, 1), &hit, &frac));
+    CHECK(!FPSCDRaycast(XMFLOAT2(0, 0), XMFLOAT2(4, 0), XMFLOAT2(2, 1), XMFLOAT2(2, 3), &hit, &frac));
+}
+
+TEST_CASE(RayAgainstSegment)
+{
+    // the ray is cast 1000 units along dir, the fraction is along that
+    const CollSegment wall = Segment(5, -1, 5, 1);
+    XMFLOAT2 hit;
+    float frac = -1.0f;
+    CHECK(IntersectRaySegment(XMFLOAT2(0, 0), XMFLOAT2(1, 0), wall, hit, frac));
+    CHECK(Near(hit, XMFLOAT2(5, 0)) && Near(frac, 5.0f / 1000.0f, 1e-6f));
+    CHECK(IntersectRaySegment(XMFLOAT2(0, 0.5f), XMFLOAT2(2, 0), wall, hit, frac));
+    CHECK(Near(hit, XMFLOAT2(5, 0.5f)) && Near(frac, 5.0f / 2000.0f, 1e-6f));
+
+    // behind, beside, beyond the 1000 units and along the wall
+    CHECK(!IntersectRaySegment(XMFLOAT2(0, 0), XMFLOAT2(-1, 0), wall, hit, frac));
+    CHECK(!IntersectRaySegment(XMFLOAT2(0, 2), XMFLOAT2(1, 0), wall, hit, frac));
+    CHECK(!IntersectRaySegment(XMFLOAT2(-1000, 0), XMFLOAT2(1, 0), wall, hit, frac));
+    CHECK(!IntersectRaySegment(XMFLOAT2(5, -5), XMFLOAT2(0, 1), wall, hit, frac));
+}
+
+TEST_CASE(RayAgainstPlane)
+{
+    // only planes facing the ray are hit. The fraction divides the normalized direction to p,
+    // so it is the distance only when p - origin is a unit vector (the benchmark keeps it as is)
+    XMFLOAT3 hit;
+    float frac = -1.0f;
+    CHECK(IntersectRayPlane(XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0), XM3Up(), XM3Zero(), hit, frac));
+    CHECK(Near(frac, 1.0f) && Near(hit, XMFLOAT3(0, 0, 0)));
+    CHECK(IntersectRayPlane(XMFLOAT3(0, 1, 0), XMFLOAT3(0, -2, 0), XM3Up(), XM3Zero(), hit, frac));
+    CHECK(Near(frac, 0.5f) && Near(hit, XMFLOAT3(0, 0, 0)));
+
+    CHECK(!IntersectRayPlane(XMFLOAT3(0, 1, 0), XMFLOAT3(0, 1, 0), XM3Up(), XM3Zero(), hit, frac));    // away
+    CHECK(!IntersectRayPlane(XMFLOAT3(0, -1, 0), XMFLOAT3(0, 1, 0), XM3Up(), XM3Zero(), hit, frac));   // back face
+    CHECK(!IntersectRayPlane(XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XM3Up(), XM3Zero(), hit, frac));    // parallel
+    CHECK(!IntersectRayPlane(XMFLOAT3(0, -1, 0), XMFLOAT3(0, -1, 0), XM3Up(), XM3Zero(), hit, frac));  // behind
+}
+
+TEST_CASE(RayAgainstTriangle)
+{
+    const XMFLOAT3 tri[3] = { XMFLOAT3(0, 0, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 1, 0) };
+    XMFLOAT3 bar;
+    float t = -1.0f;
+    CHECK(IntersectRayTriangle(XMFLOAT3(0.25f, 0.5f, -2), XMFLOAT3(0, 0, 1), tri, bar, t));
+    CHECK(Near(t, 2.0f));
+    // x and y weigh the second and third corners, z the first
+    CHECK(Near(bar, XMFLOAT3(0.25f, 0.5f, 0.25f)));
+
+    // both windings are hit, t is in units of the direction
+    const XMFLOAT3 flipped[3] = { tri[0], tri[2], tri[1] };
+    CHECK(IntersectRayTriangle(XMFLOAT3(0.25f, 0.25f, 2), XMFLOAT3(0, 0, -4), flipped, bar, t));
+    CHECK(Near(t, 0.5f));
+
+    CHECK(!IntersectRayTriangle(XMFLOAT3(0.75f, 0.75f, -2), XMFLOAT3(0, 0, 1), tri, bar, t));  // outside the hypotenuse
+    CHECK(!IntersectRayTriangle(XMFLOAT3(0.25f, 0.25f, 2), XMFLOAT3(0, 0, 1), tri, bar, t));   // behind
+    CHECK(!IntersectRayTriangle(XMFLOAT3(0.25f, 0.25f, 1), XMFLOAT3(1, 0, 0), tri, bar, t));   // parallel
+}
+
+TEST_CASE(RayAgainstUnitSphere)
+{
+    // with a radius of 1 the radius and its square agree, so these hold with the defect below
+    XMFLOAT3 hit;
+    float frac = -1.0f;
+    const XMFLOAT3 center(0, 0, 10);
+    CHECK(IntersectRaySphere(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), center, 1.0f, hit, frac));
+    CHECK(Near(frac, 9.0f, 1e-3f) && Near(hit, XMFLOAT3(0, 0, 9), 1e-3f));
+    CHECK(IntersectRaySphere(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 2), center, 1.0f, hit, frac));
+    CHECK(Near(frac, 4.5f, 1e-3f));
+
+    // from inside, the way out
+    CHECK(IntersectRaySphere(center, XMFLOAT3(1, 0, 0), center, 1.0f, hit, frac));
+    CHECK(Near(frac, 1.0f, 1e-3f) && Near(hit, XMFLOAT3(1, 0, 10), 1e-3f));
+
+    CHECK(!IntersectRaySphere(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, -1), center, 1.0f, hit, frac));    // behind
+    CHECK(!IntersectRaySphere(XMFLOAT3(1.5f, 0, 0), XMFLOAT3(0, 0, 1), center, 1.0f, hit, frac));  // beside
+}
+
+TEST_CASE(KnownDefectRaySphereRadius)
+{
+    // IntersectRaySphere subtracts the radius where its square belongs, so a sphere of
+    // radius 2 is tested as one of radius sqrt(2). ctest expects this to fail until fixed
+    XMFLOAT3 hit;
+    float frac = -1.0f;
+    CHECK(IntersectRaySphere(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, 10), 2.0f, hit, frac));
+    CHECK(Near(frac, 8.0f, 1e-3f));
+    CHECK(IntersectRaySphere(XMFLOAT3(1.7f, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, 10), 2.0f, hit, frac));
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+
+//* ***************************************************************** *//
+//* DirectXColors.h
+//* Stand-in for the SDK header: the colors DirectXTK headers use as
+//* default arguments
+//* ***************************************************************** *//
+namespace DirectX
+{
+    namespace Colors
+    {
+        const XMVECTORF32 White = { { { 1.0f, 1.0f, 1.0f, 1.0f } } };
+        const XMVECTORF32 Black = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+    }
+}
@@ -0,0 +1,334 @@
+﻿#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(_XM_SSE_INTRINSICS_)
+#include <xmmintrin.h>
+#endif
+
+//* ***************************************************************** *//
+//* DirectXMath.h
+//* Stand-in for the SDK header when device independent sources build
+//* off Windows for the tests: the storage types with the same layout,
+//* and the subset of the XMVECTOR functions those sources call, on SSE2
+//* when the pch selected it (_XM_SSE_INTRINSICS_) like the real one.
+//* Sin/cos are the C library ones, not the SDK's polynomials. Shuffles
+//* and integer ops go through memory, they are only tested, not timed
+//* ***************************************************************** *//
+#define XM_CALLCONV
+
+namespace DirectX
+{
+    const float XM_PI       = 3.141592654f;
+    const float XM_2PI      = 6.283185307f;
+    const float XM_PIDIV2   = 1.570796327f;
+    const float XM_PIDIV4   = 0.785398163f;
+
+    struct XMFLOAT2
+    {
+        float x, y;
+
+        XMFLOAT2() = default;
+        XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+    };
+
+    struct XMFLOAT3
+    {
+        float x, y, z;
+
+        XMFLOAT3() = default;
+        XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+    };
+
+    struct XMFLOAT4
+    {
+        float x, y, z, w;
+
+        XMFLOAT4() = default;
+        XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+    };
+
+    struct alignas(16) XMFLOAT4A : public XMFLOAT4
+    {
+        XMFLOAT4A() = default;
+        XMFLOAT4A(float _x, float _y, float _z, float _w) : XMFLOAT4(_x, _y, _z, _w) {}
+    };
+
+    struct XMUINT2
+    {
+        uint32_t x, y;
+
+        XMUINT2() = default;
+        XMUINT2(uint32_t _x, uint32_t _y) : x(_x), y(_y) {}
+    };
+
+    struct XMUINT4
+    {
+        uint32_t x, y, z, w;
+
+        XMUINT4() = default;
+        XMUINT4(uint32_t _x, uint32_t _y, uint32_t _z, uint32_t _w) : x(_x), y(_y), z(_z), w(_w) {}
+    };
+
+    struct XMFLOAT4X4
+    {
+        float m[4][4];
+    };
+
+#if defined(_XM_SSE_INTRINSICS_)
+
+    typedef __m128 XMVECTOR;
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w)     { return _mm_setr_ps(x, y, z, w); }
+    inline XMVECTOR XMVectorReplicate(float v)                          { return _mm_set1_ps(v); }
+    inline XMVECTOR XMVectorZero()                                      { return _mm_setzero_ps(); }
+    inline float XMVectorGetX(XMVECTOR v)                               { return _mm_cvtss_f32(v); }
+    inline XMVECTOR XMVectorAdd(XMVECTOR a, XMVECTOR b)                 { return _mm_add_ps(a, b); }
+    inline XMVECTOR XMVectorSubtract(XMVECTOR a, XMVECTOR b)            { return _mm_sub_ps(a, b); }
+    inline XMVECTOR XMVectorMultiply(XMVECTOR a, XMVECTOR b)            { return _mm_mul_ps(a, b); }
+    inline XMVECTOR XMVectorDivide(XMVECTOR a, XMVECTOR b)              { return _mm_div_ps(a, b); }
+    inline XMVECTOR XMVectorSqrt(XMVECTOR v)                            { return _mm_sqrt_ps(v); }
+    inline XMVECTOR XMVectorMax(XMVECTOR a, XMVECTOR b)                 { return _mm_max_ps(a, b); }
+    inline XMVECTOR XMVectorMin(XMVECTOR a, XMVECTOR b)                 { return _mm_min_ps(a, b); }
+    inline XMVECTOR XMVectorLess(XMVECTOR a, XMVECTOR b)                { return _mm_cmplt_ps(a, b); }
+    inline XMVECTOR XMVectorSelect(XMVECTOR a, XMVECTOR b, XMVECTOR c)  { return _mm_or_ps(_mm_andnot_ps(c, a), _mm_and_ps(c, b)); }
+    inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p)                     { return _mm_loadu_ps(&p->x); }
+    inline void XMStoreFloat4(XMFLOAT4* p, XMVECTOR v)                  { _mm_storeu_ps(&p->x, v); }
+
+    inline XMVECTOR XMVectorSinCos(XMVECTOR* s, XMVECTOR* c, XMVECTOR v)
+    {
+        float a[4], sa[4], ca[4];
+        _mm_storeu_ps(a, v);
+        for (int i = 0; i < 4; ++i)
+        {
+            sa[i] = sinf(a[i]);
+            ca[i] = cosf(a[i]);
+        }
+        *s = _mm_loadu_ps(sa);
+        *c = _mm_loadu_ps(ca);
+        return *s;
+    }
+
+    inline XMVECTOR XMLoadFloat2(const XMFLOAT2* p)                     { return XMVectorSet(p->x, p->y, 0.0f, 0.0f); }
+    inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p)                     { return XMVectorSet(p->x, p->y, p->z, 0.0f); }
+
+    inline void XMStoreFloat2(XMFLOAT2* p, XMVECTOR v)
+    {
+        float f[4];
+        _mm_storeu_ps(f, v);
+        *p = XMFLOAT2(f[0], f[1]);
+    }
+
+    inline void XMStoreFloat3(XMFLOAT3* p, XMVECTOR v)
+    {
+        float f[4];
+        _mm_storeu_ps(f, v);
+        *p = XMFLOAT3(f[0], f[1], f[2]);
+    }
+
+#else
+
+    struct XMVECTOR
+    {
+        float f[4];
+    };
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w)     { XMVECTOR r = { { x, y, z, w } }; return r; }
+    inline XMVECTOR XMVectorReplicate(float v)                          { return XMVectorSet(v, v, v, v); }
+    inline XMVECTOR XMVectorZero()                                      { return XMVectorReplicate(0.0f); }
+    inline float XMVectorGetX(XMVECTOR v)                               { return v.f[0]; }
+
+#define XM_COMPAT_LANES(expr) XMVECTOR r; for (int i = 0; i < 4; ++i) { r.f[i] = (expr); } return r
+    inline XMVECTOR XMVectorAdd(XMVECTOR a, XMVECTOR b)                 { XM_COMPAT_LANES(a.f[i] + b.f[i]); }
+    inline XMVECTOR XMVectorSubtract(XMVECTOR a, XMVECTOR b)            { XM_COMPAT_LANES(a.f[i] - b.f[i]); }
+    inline XMVECTOR XMVectorMultiply(XMVECTOR a, XMVECTOR b)            { XM_COMPAT_LANES(a.f[i] * b.f[i]); }
+    inline XMVECTOR XMVectorDivide(XMVECTOR a, XMVECTOR b)              { XM_COMPAT_LANES(a.f[i] / b.f[i]); }
+    inline XMVECTOR XMVectorSqrt(XMVECTOR v)                            { XM_COMPAT_LANES(sqrtf(v.f[i])); }
+    inline XMVECTOR XMVectorMax(XMVECTOR a, XMVECTOR b)                 { XM_COMPAT_LANES(a.f[i] > b.f[i] ? a.f[i] : b.f[i]); }
+    inline XMVECTOR XMVectorMin(XMVECTOR a, XMVECTOR b)                 { XM_COMPAT_LANES(a.f[i] < b.f[i] ? a.f[i] : b.f[i]); }
+#undef XM_COMPAT_LANES
+
+    inline XMVECTOR XMVectorLess(XMVECTOR a, XMVECTOR b)
+    {
+        // all bits set in the lanes where a < b, like the SDK's control vectors
+        XMVECTOR r;
+        for (int i = 0; i < 4; ++i)
+        {
+            const uint32_t mask = a.f[i] < b.f[i] ? 0xFFFFFFFFu : 0u;
+            memcpy(&r.f[i], &mask, sizeof(mask));
+        }
+        return r;
+    }
+
+    inline XMVECTOR XMVectorSelect(XMVECTOR a, XMVECTOR b, XMVECTOR control)
+    {
+        XMVECTOR r;
+        for (int i = 0; i < 4; ++i)
+        {
+            uint32_t x, y, m;
+            memcpy(&x, &a.f[i], sizeof(x));
+            memcpy(&y, &b.f[i], sizeof(y));
+            memcpy(&m, &control.f[i], sizeof(m));
+            const uint32_t bits = (x & ~m) | (y & m);
+            memcpy(&r.f[i], &bits, sizeof(bits));
+        }
+        return r;
+    }
+
+    inline XMVECTOR XMVectorSinCos(XMVECTOR* s, XMVECTOR* c, XMVECTOR v)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            s->f[i] = sinf(v.f[i]);
+            c->f[i] = cosf(v.f[i]);
+        }
+        return *s;
+    }
+
+    inline XMVECTOR XMLoadFloat2(const XMFLOAT2* p)                     { return XMVectorSet(p->x, p->y, 0.0f, 0.0f); }
+    inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p)                     { return XMVectorSet(p->x, p->y, p->z, 0.0f); }
+    inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p)                     { return XMVectorSet(p->x, p->y, p->z, p->w); }
+    inline void XMStoreFloat2(XMFLOAT2* p, XMVECTOR v)                  { *p = XMFLOAT2(v.f[0], v.f[1]); }
+    inline void XMStoreFloat3(XMFLOAT3* p, XMVECTOR v)                  { *p = XMFLOAT3(v.f[0], v.f[1], v.f[2]); }
+    inline void XMStoreFloat4(XMFLOAT4* p, XMVECTOR v)                  { *p = XMFLOAT4(v.f[0], v.f[1], v.f[2], v.f[3]); }
+
+#endif
+
+    typedef const XMVECTOR FXMVECTOR;
+    typedef const XMVECTOR GXMVECTOR;
+    typedef const XMVECTOR& CXMVECTOR;
+
+    struct XMMATRIX
+    {
+        XMVECTOR r[4];
+
+        XMMATRIX() = default;
+        XMMATRIX(FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, CXMVECTOR r3) { r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3; }
+    };
+
+    typedef const XMMATRIX& FXMMATRIX;
+
+    // the SDK's constant initializer, { 1, 0 } style
+    struct XMVECTORF32
+    {
+        union
+        {
+            float f[4];
+            XMVECTOR v;
+        };
+
+        operator XMVECTOR() const { return v; }
+    };
+
+    const XMVECTORF32 g_XMZero          = { { { 0.0f, 0.0f, 0.0f, 0.0f } } };
+    const XMVECTORF32 g_XMEpsilon       = { { { 1.192092896e-7f, 1.192092896e-7f, 1.192092896e-7f, 1.192092896e-7f } } };
+    const XMVECTORF32 g_XMIdentityR0    = { { { 1.0f, 0.0f, 0.0f, 0.0f } } };
+    const XMVECTORF32 g_XMIdentityR1    = { { { 0.0f, 1.0f, 0.0f, 0.0f } } };
+
+    // the rest only composes the above
+    inline XMVECTOR XMVectorSplatOne()                                  { return XMVectorReplicate(1.0f); }
+    inline XMVECTOR XMVectorNegate(XMVECTOR v)                          { return XMVectorSubtract(XMVectorZero(), v); }
+    inline XMVECTOR XMVectorReciprocal(XMVECTOR v)                      { return XMVectorDivide(XMVectorSplatOne(), v); }
+    inline XMVECTOR XMVectorMultiplyAdd(XMVECTOR a, XMVECTOR b, XMVECTOR c) { return XMVectorAdd(XMVectorMultiply(a, b), c); }
+    inline XMVECTOR XMVectorClamp(XMVECTOR v, XMVECTOR lo, XMVECTOR hi) { return XMVectorMin(XMVectorMax(v, lo), hi); }
+    inline XMVECTOR XMVectorSaturate(XMVECTOR v)                        { return XMVectorClamp(v, XMVectorZero(), XMVectorSplatOne()); }
+
+    inline XMVECTOR XMVector2Length(XMVECTOR v)
+    {
+        XMFLOAT2 f;
+        XMStoreFloat2(&f, v);
+        return XMVectorReplicate(sqrtf(f.x*f.x + f.y*f.y));
+    }
+
+    inline XMVECTOR XMVector3Cross(XMVECTOR a, XMVECTOR b)
+    {
+        XMFLOAT3 u, v;
+        XMStoreFloat3(&u, a);
+        XMStoreFloat3(&v, b);
+        return XMVectorSet(u.y*v.z - u.z*v.y, u.z*v.x - u.x*v.z, u.x*v.y - u.y*v.x, 0.0f);
+    }
+
+    inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A* p)                   { return XMLoadFloat4(p); }
+    inline XMVECTOR XMLoadFloat(const float* p)                         { return XMVectorSet(*p, 0.0f, 0.0f, 0.0f); }
+
+    inline void XMScalarSinCos(float* s, float* c, float v)
+    {
+        *s = sinf(v);
+        *c = cosf(v);
+    }
+
+    // lanes through memory, bit exact
+    inline void XMCompatStore(uint32_t* u, FXMVECTOR v)
+    {
+        XMFLOAT4 f;
+        XMStoreFloat4(&f, v);
+        memcpy(u, &f, sizeof(f));
+    }
+
+    inline float XMCompatFloat(uint32_t u)
+    {
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    inline XMVECTOR XMCompatLoad(const uint32_t* u)
+    {
+        XMFLOAT4 f;
+        memcpy(&f, u, sizeof(f));
+        return XMLoadFloat4(&f);
+    }
+
+    inline XMVECTOR XMVectorSetInt(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+    {
+        const uint32_t u[4] = { x, y, z, w };
+        return XMCompatLoad(u);
+    }
+
+    inline XMVECTOR XMVectorReplicateInt(uint32_t v)                    { return XMVectorSetInt(v, v, v, v); }
+
+    template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+    XMVECTOR XMVectorPermute(FXMVECTOR a, FXMVECTOR b)
+    {
+        uint32_t u[8];
+        XMCompatStore(u, a);
+        XMCompatStore(u + 4, b);
+        return XMVectorSetInt(u[X], u[Y], u[Z], u[W]);
+    }
+
+    template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+    XMVECTOR XMVectorSwizzle(FXMVECTOR v)                               { return XMVectorPermute<X, Y, Z, W>(v, v); }
+
+    inline XMVECTOR XMVectorSplatX(FXMVECTOR v)                         { return XMVectorSwizzle<0, 0, 0, 0>(v); }
+    inline XMVECTOR XMVectorSplatY(FXMVECTOR v)                         { return XMVectorSwizzle<1, 1, 1, 1>(v); }
+    inline XMVECTOR XMVectorMergeXY(FXMVECTOR a, FXMVECTOR b)           { return XMVectorPermute<0, 4, 1, 5>(a, b); }
+
+#define XM_COMPAT_LANES(expr) uint32_t x[4], y[4]; XMCompatStore(x, a); XMCompatStore(y, b); \
+    for (int i = 0; i < 4; ++i) { x[i] = (expr); } return XMCompatLoad(x)
+    inline XMVECTOR XMVectorEqual(FXMVECTOR a, FXMVECTOR b)             { XM_COMPAT_LANES(XMCompatFloat(x[i]) == XMCompatFloat(y[i]) ? 0xFFFFFFFFu : 0u); }
+    inline XMVECTOR XMVectorNotEqual(FXMVECTOR a, FXMVECTOR b)          { XM_COMPAT_LANES(XMCompatFloat(x[i]) != XMCompatFloat(y[i]) ? 0xFFFFFFFFu : 0u); }
+    inline XMVECTOR XMVectorEqualInt(FXMVECTOR a, FXMVECTOR b)          { XM_COMPAT_LANES(x[i] == y[i] ? 0xFFFFFFFFu : 0u); }
+    inline XMVECTOR XMVectorAndInt(FXMVECTOR a, FXMVECTOR b)            { XM_COMPAT_LANES(x[i] & y[i]); }
+#undef XM_COMPAT_LANES
+
+    inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+    {
+        uint32_t u[4][4];
+        for (int i = 0; i < 4; ++i)
+            XMCompatStore(u[i], m.r[i]);
+        return XMMATRIX(XMVectorSetInt(u[0][0], u[1][0], u[2][0], u[3][0]), XMVectorSetInt(u[0][1], u[1][1], u[2][1], u[3][1]),
+            XMVectorSetInt(u[0][2], u[1][2], u[2][2], u[3][2]), XMVectorSetInt(u[0][3], u[1][3], u[2][3], u[3][3]));
+    }
+
+#if !defined(_XM_SSE_INTRINSICS_)
+    // GCC and Clang give __m128 the arithmetic operators, the float[4] stand-in needs the SDK's
+    inline XMVECTOR operator-(FXMVECTOR v)                              { return XMVectorNegate(v); }
+    inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b)                 { return XMVectorSubtract(a, b); }
+    inline XMVECTOR operator*(FXMVECTOR a, FXMVECTOR b)                 { return XMVectorMultiply(a, b); }
+    inline XMVECTOR& operator*=(XMVECTOR& a, FXMVECTOR b)               { a = XMVectorMultiply(a, b); return a; }
+#else
+    // the builtin __m128 operators do not look through the constants' conversion
+    inline XMVECTOR operator-(const XMVECTORF32& a, FXMVECTOR b)        { return XMVectorSubtract(a, b); }
+#endif
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include <dxgiformat.h>
+
+//* ***************************************************************** *//
+//* d3d11_1.h
+//* Stand-in for the Windows SDK header when the device independent
+//* DirectXTK stages (SpriteBatchKernels) build off Windows for the
+//* tests. Only declares what SpriteBatch.h and VertexTypes.h name in
+//* their declarations; nothing here can create or use a device
+//* ***************************************************************** *//
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11BlendState;
+struct ID3D11SamplerState;
+struct ID3D11DepthStencilState;
+struct ID3D11RasterizerState;
+struct ID3D11ShaderResourceView;
+
+struct D3D11_INPUT_ELEMENT_DESC;
+struct D3D11_VIEWPORT;
+
+typedef struct tagRECT RECT;
+
+typedef enum DXGI_MODE_ROTATION
+{
+    DXGI_MODE_ROTATION_UNSPECIFIED  = 0,
+    DXGI_MODE_ROTATION_IDENTITY     = 1,
+    DXGI_MODE_ROTATION_ROTATE90     = 2,
+    DXGI_MODE_ROTATION_ROTATE180    = 3,
+    DXGI_MODE_ROTATION_ROTATE270    = 4
+} DXGI_MODE_ROTATION;
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <stdint.h>
+
+//* ***************************************************************** *//
+//* mmreg.h
+//* Stand-in for the Windows SDK header when the DirectXTK wave readers
+//* build off Windows for the tests: the WAVEFORMAT family, MS-ADPCM
+//* coefficients and the format tags, with the SDK's packed layouts
+//* ***************************************************************** *//
+typedef uint8_t  BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+
+struct GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t  Data4[8];
+};
+
+#define WAVE_FORMAT_PCM             0x0001
+#define WAVE_FORMAT_ADPCM           0x0002
+#define WAVE_FORMAT_IEEE_FLOAT      0x0003
+#define WAVE_FORMAT_WMAUDIO2        0x0161
+#define WAVE_FORMAT_WMAUDIO3        0x0162
+#define WAVE_FORMAT_EXTENSIBLE      0xFFFE
+
+#pragma pack(push,1)
+struct WAVEFORMAT
+{
+    WORD  wFormatTag;
+    WORD  nChannels;
+    DWORD nSamplesPerSec;
+    DWORD nAvgBytesPerSec;
+    WORD  nBlockAlign;
+};
+
+struct PCMWAVEFORMAT
+{
+    WAVEFORMAT wf;
+    WORD       wBitsPerSample;
+};
+
+struct WAVEFORMATEX
+{
+    WORD  wFormatTag;
+    WORD  nChannels;
+    DWORD nSamplesPerSec;
+    DWORD nAvgBytesPerSec;
+    WORD  nBlockAlign;
+    WORD  wBitsPerSample;
+    WORD  cbSize;
+};
+
+struct WAVEFORMATEXTENSIBLE
+{
+    WAVEFORMATEX Format;
+    union
+    {
+        WORD wValidBitsPerSample;
+        WORD wSamplesPerBlock;
+        WORD wReserved;
+    } Samples;
+    DWORD dwChannelMask;
+    GUID  SubFormat;
+};
+
+struct ADPCMCOEFSET
+{
+    int16_t iCoef1;
+    int16_t iCoef2;
+};
+
+struct ADPCMWAVEFORMAT
+{
+    WAVEFORMATEX wfx;
+    WORD         wSamplesPerBlock;
+    WORD         wNumCoef;
+    ADPCMCOEFSET aCoef[1]; // wNumCoef of them
+};
+#pragma pack(pop)
+
+static_assert(sizeof(WAVEFORMAT) == 14 && sizeof(PCMWAVEFORMAT) == 16 && sizeof(WAVEFORMATEX) == 18, "SDK layout");
+static_assert(sizeof(WAVEFORMATEXTENSIBLE) == 40 && sizeof(ADPCMWAVEFORMAT) == 26, "SDK layout");
@@ -0,0 +1,274 @@
+﻿#include "pch.h"
+#include "DDSParser.h"
+#include "dds.h"
+#include "TestMain.h"
+
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    struct Layout
+    {
+        bool dx10;
+        DXGI_FORMAT format;
+        uint32_t dim, width, height, depth, mips, items;
+        bool cube;
+        DDS_PIXELFORMAT pf;
+    };
+
+    const DDS_PIXELFORMAT NONE = {};
+
+    // one of each path through the parser: legacy BC1 with mips, legacy cube, DX10 BC7 array, DX10 volume, DX10 1D array
+    const Layout LAYOUTS[] =
+    {
+        { false, DXGI_FORMAT_BC1_UNORM, DDS_DIMENSION_TEXTURE2D, 128, 128, 1, 8, 1, false, DDSPF_DXT1 },
+        { false, DXGI_FORMAT_BC3_UNORM, DDS_DIMENSION_TEXTURE2D, 32, 32, 1, 6, 1, true, DDSPF_DXT5 },
+        { true, DXGI_FORMAT_BC7_UNORM, DDS_DIMENSION_TEXTURE2D, 64, 64, 1, 7, 4, false, NONE },
+        { true, DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE3D, 16, 16, 16, 5, 1, false, NONE },
+        { true, DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE1D, 256, 1, 1, 9, 2, false, NONE },
+    };
+
+    const size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    const size_t DX10_HEADER_SIZE = HEADER_SIZE + sizeof(DDS_HEADER_DXT10);
+
+    size_t SurfaceBytes(const Layout& l, uint32_t mip)
+    {
+        const uint32_t w = std::max(1u, l.width >> mip), h = std::max(1u, l.height >> mip), d = std::max(1u, l.depth >> mip);
+        if (l.format == DXGI_FORMAT_R8G8B8A8_UNORM)
+            return size_t(w) * h * d * 4;
+        return size_t(std::max(1u, (w + 3) / 4)) * std::max(1u, (h + 3) / 4) * (l.format == DXGI_FORMAT_BC1_UNORM ? 8 : 16);
+    }
+
+    // the header followed by every subresource, each byte a function of its position
+    std::vector<uint8_t> MakeFile(const Layout& l)
+    {
+        const size_t headerSize = l.dx10 ? DX10_HEADER_SIZE : HEADER_SIZE;
+        size_t bits = 0;
+        for (uint32_t item = 0; item < l.items * (l.cube ? 6 : 1); ++item)
+            for (uint32_t mip = 0; mip < l.mips; ++mip)
+                bits += SurfaceBytes(l, mip);
+
+        std::vector<uint8_t> file(headerSize + bits);
+        for (size_t i = headerSize; i < file.size(); ++i)
+            file[i] = uint8_t(i * 7);
+
+        DDS_HEADER header = {};
+        header.size = sizeof(DDS_HEADER);
+        header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP | (l.dim == DDS_DIMENSION_TEXTURE3D ? DDS_HEADER_FLAGS_VOLUME : 0);
+        header.width = l.width;
+        header.height = l.height;
+        header.depth = l.depth;
+        header.mipMapCount = l.mips;
+        header.ddspf = l.dx10 ? DDSPF_DX10 : l.pf;
+        header.caps2 = l.cube ? DDS_CUBEMAP | DDS_CUBEMAP_ALLFACES : 0;
+        memcpy(file.data(), &DDS_MAGIC, sizeof(uint32_t));
+        memcpy(file.data() + sizeof(uint32_t), &header, sizeof(header));
+        if (l.dx10)
+        {
+            DDS_HEADER_DXT10 ext = {};
+            ext.dxgiFormat = l.format;
+            ext.resourceDimension = l.dim;
+            ext.arraySize = l.items;
+            memcpy(file.data() + HEADER_SIZE, &ext, sizeof(ext));
+        }
+        return file;
+    }
+
+    DDS_HEADER& Header(std::vector<uint8_t>& file) { return *reinterpret_cast<DDS_HEADER*>(file.data() + sizeof(uint32_t)); }
+    DDS_HEADER_DXT10& Extension(std::vector<uint8_t>& file) { return *reinterpret_cast<DDS_HEADER_DXT10*>(file.data() + HEADER_SIZE); }
+
+    HRESULT Parse(const std::vector<uint8_t>& file, DDSTextureInfo& info)
+    {
+        return ParseDDSTexture(file.data(), file.size(), info);
+    }
+
+    // every view inside [data, data + size), back to back, ending where the parser says the data ends
+    bool ViewsInside(const uint8_t* data, size_t size, const DDSTextureInfo& info)
+    {
+        std::vector<DDSSubresource> subs(size_t(info.mipLevels) * info.arraySize);
+        if (subs.empty() || GetDDSSubresources(info, subs.data(), subs.size()) != subs.size())
+            return false;
+        const uint8_t* next = info.bitData;
+        for (const auto& sub : subs)
+        {
+            if (sub.data != next || !sub.rowPitch || sub.slicePitch < sub.rowPitch)
+                return false;
+            next += sub.slicePitch * sub.depth;
+        }
+        return info.bitData >= data && next == info.bitData + info.bitSize && next <= data + size;
+    }
+}
+
+TEST_CASE(ParsesEveryLayout)
+{
+    for (const auto& l : LAYOUTS)
+    {
+        const auto file = MakeFile(l);
+        DDSTextureInfo info;
+        CHECK(Parse(file, info) == S_OK);
+        CHECK(info.resourceDimension == l.dim);
+        CHECK(info.width == l.width && info.height == l.height && info.depth == l.depth);
+        CHECK(info.mipLevels == l.mips);
+        CHECK(info.arraySize == l.items * (l.cube ? 6 : 1));
+        CHECK(info.isCubeMap == l.cube);
+        CHECK(info.format == l.format);
+        CHECK(info.bitData == file.data() + (l.dx10 ? DX10_HEADER_SIZE : HEADER_SIZE));
+        CHECK(info.bitData + info.bitSize == file.data() + file.size());
+        CHECK(ViewsInside(file.data(), file.size(), info));
+
+        std::vector<DDSSubresource> subs(size_t(info.mipLevels) * info.arraySize);
+        CHECK(GetDDSSubresources(info, subs.data(), subs.size() - 1) == 0);
+        GetDDSSubresources(info, subs.data(), subs.size());
+        for (uint32_t mip = 0; mip < l.mips; ++mip)
+            CHECK(subs[mip].slicePitch * subs[mip].depth == SurfaceBytes(l, mip));
+    }
+
+    // trailing bytes are ignored, not counted in the views
+    auto file = MakeFile(LAYOUTS[0]);
+    const size_t size = file.size();
+    file.resize(size + 100);
+    DDSTextureInfo info;
+    CHECK(Parse(file, info) == S_OK && info.bitData + info.bitSize == file.data() + size);
+}
+
+TEST_CASE(ReadsTheAlphaMode)
+{
+    auto file = MakeFile(LAYOUTS[2]);
+    DDSTextureInfo info;
+    CHECK(Parse(file, info) == S_OK && info.alphaMode == DDS_ALPHA_MODE_UNKNOWN);
+    Extension(file).miscFlags2 = DDS_ALPHA_MODE_PREMULTIPLIED;
+    CHECK(Parse(file, info) == S_OK && info.alphaMode == DDS_ALPHA_MODE_PREMULTIPLIED);
+    Extension(file).miscFlags2 = DDS_ALPHA_MODE_OPAQUE;
+    CHECK(Parse(file, info) == S_OK && info.alphaMode == DDS_ALPHA_MODE_OPAQUE);
+    Extension(file).miscFlags2 = 7;
+    CHECK(Parse(file, info) == S_OK && info.alphaMode == DDS_ALPHA_MODE_UNKNOWN);
+}
+
+TEST_CASE(RejectsEveryTruncation)
+{
+    for (const auto& l : LAYOUTS)
+    {
+        const auto file = MakeFile(l);
+        bool rejected = true;
+        for (size_t size = 0; size < file.size(); ++size)
+        {
+            // an exact size copy, so a read past the end is a read past the allocation
+            const std::vector<uint8_t> prefix(file.begin(), file.begin() + size);
+            DDSTextureInfo info;
+            rejected = rejected && FAILED(ParseDDSTexture(prefix.data(), prefix.size(), info));
+        }
+        CHECK(rejected);
+    }
+
+    DDSTextureInfo info;
+    CHECK(ParseDDSTexture(nullptr, 100, info) == E_INVALIDARG);
+}
+
+TEST_CASE(RejectsBadHeaders)
+{
+    DDSTextureInfo info;
+    const HRESULT NOT_SUPPORTED = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    const HRESULT INVALID_DATA = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    auto file = MakeFile(LAYOUTS[0]);
+    file[0] = 'X';
+    CHECK(Parse(file, info) == E_FAIL);
+
+    file = MakeFile(LAYOUTS[0]);
+    Header(file).size = 0;
+    CHECK(Parse(file, info) == E_FAIL);
+
+    file = MakeFile(LAYOUTS[0]);
+    Header(file).width = 0;
+    CHECK(Parse(file, info) == INVALID_DATA);
+
+    file = MakeFile(LAYOUTS[0]);
+    Header(file).mipMapCount = 9;
+    CHECK(Parse(file, info) == INVALID_DATA);
+
+    file = MakeFile(LAYOUTS[0]);
+    Header(file).width = Header(file).height = 32768;
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[1]);
+    Header(file).caps2 = DDS_CUBEMAP | DDS_CUBEMAP_POSITIVEX;
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[2]);
+    Extension(file).arraySize = 0;
+    CHECK(Parse(file, info) == INVALID_DATA);
+
+    // 0x2AAAAAAB cubes are 6 faces past 2^32 faces: must be rejected, not wrap to 2
+    file = MakeFile(LAYOUTS[2]);
+    Extension(file).miscFlag = DDS_RESOURCE_MISC_TEXTURECUBE;
+    Extension(file).arraySize = 0x2AAAAAAB;
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[2]);
+    Extension(file).dxgiFormat = DXGI_FORMAT_P8;
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[2]);
+    Extension(file).dxgiFormat = DXGI_FORMAT(200);
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[2]);
+    Extension(file).resourceDimension = 1;
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[3]);
+    Header(file).flags &= ~DDS_HEADER_FLAGS_VOLUME;
+    CHECK(Parse(file, info) == INVALID_DATA);
+
+    file = MakeFile(LAYOUTS[3]);
+    Header(file).depth = 4096;
+    CHECK(Parse(file, info) == NOT_SUPPORTED);
+
+    file = MakeFile(LAYOUTS[4]);
+    Header(file).height = 2;
+    CHECK(Parse(file, info) == INVALID_DATA);
+}
+
+TEST_CASE(MutatedHeadersStayInside)
+{
+    std::vector<std::vector<uint8_t>> files;
+    for (const auto& l : LAYOUTS)
+        files.push_back(MakeFile(l));
+
+    // bit flips, small and boundary values over the header words, plus truncations
+    std::mt19937 rng(1234);
+    auto get = [&](uint32_t lo, uint32_t hi) { return std::uniform_int_distribution<uint32_t>(lo, hi)(rng); };
+    const size_t MUTATIONS = 20000;
+    size_t accepted = 0;
+    bool inside = true;
+    for (size_t i = 0; i < MUTATIONS; ++i)
+    {
+        const auto& original = files[i % files.size()];
+        size_t size = original.size();
+        std::vector<uint8_t> header(original.begin(), original.begin() + DX10_HEADER_SIZE);
+        for (uint32_t m = get(1, 4); m > 0; --m)
+        {
+            const uint32_t at = get(0, uint32_t(DX10_HEADER_SIZE) - 4) & ~3u;
+            switch (get(0, 2))
+            {
+            case 0: header[at + get(0, 3)] ^= uint8_t(1 << get(0, 7)); break;
+            case 1: { const uint32_t v = get(0, 1) ? get(0, 70000) : 0xffffffffu >> get(0, 31); memcpy(&header[at], &v, sizeof(v)); } break;
+            case 2: size = get(0, uint32_t(size)); break;
+            }
+        }
+
+        std::vector<uint8_t> file(original.begin(), original.begin() + size);
+        memcpy(file.data(), header.data(), std::min(size, header.size()));
+
+        DDSTextureInfo info;
+        if (SUCCEEDED(ParseDDSTexture(file.data(), file.size(), info)))
+        {
+            ++accepted;
+            inside = inside && ViewsInside(file.data(), file.size(), info);
+        }
+    }
+    CHECK(inside);
+    CHECK(accepted > 0 && accepted < MUTATIONS);
+}
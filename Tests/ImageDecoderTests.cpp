@@ -0,0 +1,748 @@
+﻿#include "pch.h"
+#include "Content/ImageDecoder.h"
+#include "TestMain.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    //////////////////////////////////////////////////////////////////////////
+    // A small deflate encoder, enough to produce every block type the decoder reads
+
+    enum BlockType { STORED, FIXED, DYNAMIC };
+
+    const uint16_t LENGTH_BASE[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+    const uint8_t LENGTH_EXTRA[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+    const uint16_t DIST_BASE[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+    const uint8_t DIST_EXTRA[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+    const uint8_t CODE_LENGTH_ORDER[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : m_out(out), m_bits(0), m_count(0) {}
+
+        // lsb first, like the deflate fields
+        void Put(uint32_t v, int n)
+        {
+            m_bits |= (uint64_t)v << m_count;
+            m_count += n;
+            while (m_count >= 8)
+            {
+                m_out.push_back((uint8_t)m_bits);
+                m_bits >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        // Huffman codes go msb first
+        void PutCode(uint32_t code, int n)
+        {
+            uint32_t r = 0;
+            for (int i = 0; i < n; ++i, code >>= 1)
+                r = (r << 1) | (code & 1);
+            Put(r, n);
+        }
+
+        void Align() { if (m_count) Put(0, 8 - m_count); }
+
+    private:
+        std::vector<uint8_t>& m_out;
+        uint64_t m_bits;
+        int m_count;
+    };
+
+    struct Token
+    {
+        uint16_t m_literal; // or the length when m_dist
+        uint16_t m_dist;
+    };
+
+    // greedy matches of 3..258 bytes up to 32K back, also across block boundaries
+    std::vector<Token> Tokenize(const std::vector<uint8_t>& data, size_t begin, size_t end)
+    {
+        std::vector<Token> tokens;
+        for (size_t i = begin; i < end;)
+        {
+            size_t bestLen = 0, bestDist = 0;
+            const size_t window = i > 32768 ? i - 32768 : 0;
+            for (size_t j = window; j < i; ++j)
+            {
+                size_t len = 0;
+                while (len < 258 && i + len < end && data[j + len] == data[i + len])
+                    ++len;
+                if (len > bestLen || (len == bestLen && len && i - j < bestDist))
+                {
+                    bestLen = len;
+                    bestDist = i - j;
+                }
+            }
+            Token t;
+            if (bestLen >= 3)
+            {
+                t.m_literal = (uint16_t)bestLen;
+                t.m_dist = (uint16_t)bestDist;
+                i += bestLen;
+            }
+            else
+            {
+                t.m_literal = data[i++];
+                t.m_dist = 0;
+            }
+            tokens.push_back(t);
+        }
+        return tokens;
+    }
+
+    int LengthSymbol(int len, int& extra)
+    {
+        int s = 28;
+        while (LENGTH_BASE[s] > len) --s;
+        extra = len - LENGTH_BASE[s];
+        return 257 + s;
+    }
+
+    int DistSymbol(int dist, int& extra)
+    {
+        int s = 29;
+        while (DIST_BASE[s] > dist) --s;
+        extra = dist - DIST_BASE[s];
+        return s;
+    }
+
+    std::vector<uint16_t> CanonicalCodes(const std::vector<uint8_t>& lengths)
+    {
+        int count[16] = {}, next[16] = {};
+        for (uint8_t l : lengths) ++count[l];
+        count[0] = 0;
+        for (int b = 1, code = 0; b < 16; ++b)
+        {
+            code = (code + count[b - 1]) << 1;
+            next[b] = code;
+        }
+        std::vector<uint16_t> codes(lengths.size(), 0);
+        for (size_t i = 0; i < lengths.size(); ++i)
+        {
+            if (lengths[i])
+                codes[i] = (uint16_t)next[lengths[i]]++;
+        }
+        return codes;
+    }
+
+    // Huffman code lengths of the used symbols, flattening the counts until they fit in limit bits
+    std::vector<uint8_t> CodeLengths(std::vector<uint32_t> freq, int limit)
+    {
+        for (;;)
+        {
+            struct Node { uint32_t m_freq; int m_left, m_right; };
+            std::vector<Node> nodes;
+            std::vector<int> live;
+            for (size_t i = 0; i < freq.size(); ++i)
+            {
+                if (freq[i])
+                {
+                    Node n = { freq[i], -1, (int)i };
+                    live.push_back((int)nodes.size());
+                    nodes.push_back(n);
+                }
+            }
+            std::vector<uint8_t> lengths(freq.size(), 0);
+            if (live.size() == 1)
+                lengths[nodes[0].m_right] = 1;
+            while (live.size() > 1)
+            {
+                // the two rarest
+                for (int k = 0; k < 2; ++k)
+                {
+                    size_t m = k;
+                    for (size_t j = k; j < live.size(); ++j)
+                        if (nodes[live[j]].m_freq < nodes[live[m]].m_freq) m = j;
+                    std::swap(live[k], live[m]);
+                }
+                Node n = { nodes[live[0]].m_freq + nodes[live[1]].m_freq, live[0], live[1] };
+                live.erase(live.begin(), live.begin() + 2);
+                live.push_back((int)nodes.size());
+                nodes.push_back(n);
+            }
+            if (live.empty())
+                return lengths;
+
+            // depths by walking down from the root
+            std::vector<std::pair<int, int>> stack(1, std::make_pair(live[0], 0));
+            int deepest = 0;
+            while (!stack.empty())
+            {
+                const auto top = stack.back();
+                stack.pop_back();
+                const Node& n = nodes[top.first];
+                if (n.m_left < 0)
+                {
+                    lengths[n.m_right] = (uint8_t)std::max(1, top.second);
+                    deepest = std::max(deepest, top.second);
+                    continue;
+                }
+                stack.push_back(std::make_pair(n.m_left, top.second + 1));
+                stack.push_back(std::make_pair(n.m_right, top.second + 1));
+            }
+            if (deepest <= limit)
+                return lengths;
+            for (auto& f : freq)
+                if (f) f = (f + 1) / 2;
+        }
+    }
+
+    void WriteTokens(BitWriter& out, const std::vector<Token>& tokens, const std::vector<uint8_t>& litLengths, const std::vector<uint8_t>& distLengths)
+    {
+        const auto lit = CanonicalCodes(litLengths), dist = CanonicalCodes(distLengths);
+        for (const auto& t : tokens)
+        {
+            if (!t.m_dist)
+            {
+                out.PutCode(lit[t.m_literal], litLengths[t.m_literal]);
+                continue;
+            }
+            int lenExtra, distExtra;
+            const int ls = LengthSymbol(t.m_literal, lenExtra), ds = DistSymbol(t.m_dist, distExtra);
+            out.PutCode(lit[ls], litLengths[ls]);
+            out.Put(lenExtra, LENGTH_EXTRA[ls - 257]);
+            out.PutCode(dist[ds], distLengths[ds]);
+            out.Put(distExtra, DIST_EXTRA[ds]);
+        }
+        out.PutCode(lit[256], litLengths[256]);
+    }
+
+    void WriteDynamicHeader(BitWriter& out, std::vector<uint8_t>& litLengths, std::vector<uint8_t>& distLengths)
+    {
+        int hlit = 286, hdist = 30;
+        while (hlit > 257 && !litLengths[hlit - 1]) --hlit;
+        while (hdist > 1 && !distLengths[hdist - 1]) --hdist;
+        std::vector<uint8_t> all(litLengths.begin(), litLengths.begin() + hlit);
+        all.insert(all.end(), distLengths.begin(), distLengths.begin() + hdist);
+
+        // run length coded with 16 (repeat previous), 17 and 18 (zeros)
+        std::vector<std::pair<int, int>> symbols; // symbol, extra bits value
+        for (size_t i = 0; i < all.size();)
+        {
+            size_t run = 1;
+            while (i + run < all.size() && all[i + run] == all[i]) ++run;
+            if (!all[i] && run >= 11) { run = std::min<size_t>(run, 138); symbols.push_back(std::make_pair(18, (int)run - 11)); }
+            else if (!all[i] && run >= 3) { run = std::min<size_t>(run, 10); symbols.push_back(std::make_pair(17, (int)run - 3)); }
+            else if (all[i] && run >= 4)
+            {
+                run = std::min<size_t>(run, 7);
+                symbols.push_back(std::make_pair((int)all[i], 0));
+                symbols.push_back(std::make_pair(16, (int)run - 4));
+            }
+            else { run = 1; symbols.push_back(std::make_pair((int)all[i], 0)); }
+            i += run;
+        }
+
+        std::vector<uint32_t> freq(19, 0);
+        for (const auto& s : symbols) ++freq[s.first];
+        const auto clen = CodeLengths(freq, 7);
+        const auto codes = CanonicalCodes(clen);
+        int hclen = 19;
+        while (hclen > 4 && !clen[CODE_LENGTH_ORDER[hclen - 1]]) --hclen;
+
+        out.Put(hlit - 257, 5);
+        out.Put(hdist - 1, 5);
+        out.Put(hclen - 4, 4);
+        for (int i = 0; i < hclen; ++i)
+            out.Put(clen[CODE_LENGTH_ORDER[i]], 3);
+        for (const auto& s : symbols)
+        {
+            out.PutCode(codes[s.first], clen[s.first]);
+            if (s.first == 16) out.Put(s.second, 2);
+            if (s.first == 17) out.Put(s.second, 3);
+            if (s.first == 18) out.Put(s.second, 7);
+        }
+    }
+
+    // zlib stream of data cut in blocks.size() equal parts, each with its own block type
+    std::vector<uint8_t> Deflate(const std::vector<uint8_t>& data, const std::vector<BlockType>& blocks)
+    {
+        std::vector<uint8_t> out;
+        out.push_back(0x78);
+        out.push_back(0x01);
+        BitWriter bits(out);
+        for (size_t b = 0; b < blocks.size(); ++b)
+        {
+            const size_t begin = data.size() * b / blocks.size(), end = data.size() * (b + 1) / blocks.size();
+            const bool last = b + 1 == blocks.size();
+            bits.Put(last ? 1 : 0, 1);
+            bits.Put(blocks[b], 2);
+            if (blocks[b] == STORED)
+            {
+                const uint32_t len = uint32_t(end - begin);
+                bits.Align();
+                bits.Put(len, 16);
+                bits.Put(len ^ 0xffff, 16);
+                for (size_t i = begin; i < end; ++i)
+                    bits.Put(data[i], 8);
+                continue;
+            }
+
+            const auto tokens = Tokenize(data, begin, end);
+            std::vector<uint8_t> litLengths(288, 0), distLengths(30, 0);
+            if (blocks[b] == FIXED)
+            {
+                memset(litLengths.data(), 8, 144);
+                memset(litLengths.data() + 144, 9, 112);
+                memset(litLengths.data() + 256, 7, 24);
+                memset(litLengths.data() + 280, 8, 8);
+                memset(distLengths.data(), 5, 30);
+            }
+            else
+            {
+                std::vector<uint32_t> litFreq(286, 0), distFreq(30, 0);
+                litFreq[256] = 1;
+                for (const auto& t : tokens)
+                {
+                    int extra;
+                    if (!t.m_dist) { ++litFreq[t.m_literal]; continue; }
+                    ++litFreq[LengthSymbol(t.m_literal, extra)];
+                    ++distFreq[DistSymbol(t.m_dist, extra)];
+                }
+                litLengths = CodeLengths(litFreq, 15);
+                distLengths = CodeLengths(distFreq, 15);
+                if (std::count(distLengths.begin(), distLengths.end(), 0) == 30)
+                    distLengths[0] = 1;
+                litLengths.resize(288, 0);
+                WriteDynamicHeader(bits, litLengths, distLengths);
+            }
+            WriteTokens(bits, tokens, litLengths, distLengths);
+        }
+        bits.Align();
+
+        uint32_t a = 1, s = 0;
+        for (uint8_t v : data) { a = (a + v) % 65521; s = (s + a) % 65521; }
+        const uint32_t adler = (s << 16) | a;
+        for (int i = 3; i >= 0; --i)
+            out.push_back((uint8_t)(adler >> (i * 8)));
+        return out;
+    }
+
+    // text-like bytes: runs, repeats near and far, and noise
+    std::vector<uint8_t> SampleData(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        uint32_t x = 12345;
+        for (size_t i = 0; i < size; ++i)
+        {
+            x = x * 1103515245 + 12345;
+            const uint32_t r = x >> 16;
+            if (i >= 300 && r % 7 == 0)
+                data[i] = data[i - 300 + r % 50];
+            else if (i && r % 5 == 0)
+                data[i] = data[i - 1];
+            else
+                data[i] = (uint8_t)('a' + r % 26);
+        }
+        for (size_t i = size / 2; i < size / 2 + 600 && i < size; ++i)
+            data[i] = 'z'; // long overlapping copy at distance 1
+        return data;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // PNG writer
+
+    uint32_t Crc32(const uint8_t* p, size_t n)
+    {
+        uint32_t c = 0xffffffffu;
+        for (size_t i = 0; i < n; ++i)
+        {
+            c ^= p[i];
+            for (int k = 0; k < 8; ++k)
+                c = (c >> 1) ^ (0xedb88320u & (0u - (c & 1)));
+        }
+        return c ^ 0xffffffffu;
+    }
+
+    void PutBE32(std::vector<uint8_t>& out, uint32_t v)
+    {
+        for (int i = 3; i >= 0; --i)
+            out.push_back((uint8_t)(v >> (i * 8)));
+    }
+
+    void PutChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+    {
+        PutBE32(png, (uint32_t)data.size());
+        const size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        PutBE32(png, Crc32(png.data() + start, png.size() - start));
+    }
+
+    uint8_t Paeth(int a, int b, int c)
+    {
+        const int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+        return (uint8_t)((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+    }
+
+    struct PngImage
+    {
+        uint32_t m_width, m_height;
+        int m_colorType, m_depth, m_interlace;
+        std::vector<uint8_t> m_rows;        // unfiltered, packed rows
+        std::vector<int> m_filters;         // per row, cycled
+        std::vector<uint8_t> m_palette;     // PLTE
+        std::vector<uint8_t> m_trns;        // tRNS
+        bool m_sRGB;
+        std::vector<BlockType> m_blocks;
+
+        size_t Stride() const
+        {
+            const int channels = m_colorType == 6 ? 4 : m_colorType == 2 ? 3 : 1;
+            return ((size_t)m_width * channels * m_depth + 7) / 8;
+        }
+
+        int Bpp() const
+        {
+            const int channels = m_colorType == 6 ? 4 : m_colorType == 2 ? 3 : 1;
+            return std::max(1, channels * m_depth / 8);
+        }
+
+        std::vector<uint8_t> Filtered() const
+        {
+            const size_t stride = Stride();
+            const int bpp = Bpp();
+            std::vector<uint8_t> out;
+            for (uint32_t y = 0; y < m_height; ++y)
+            {
+                const int filter = m_filters[y % m_filters.size()];
+                const uint8_t* row = m_rows.data() + y * stride;
+                const uint8_t* prior = y ? row - stride : nullptr;
+                out.push_back((uint8_t)filter);
+                for (size_t x = 0; x < stride; ++x)
+                {
+                    const int left = x >= (size_t)bpp ? row[x - bpp] : 0;
+                    const int up = prior ? prior[x] : 0;
+                    const int upLeft = (prior && x >= (size_t)bpp) ? prior[x - bpp] : 0;
+                    const int predictor = filter == 1 ? left : filter == 2 ? up : filter == 3 ? (left + up) >> 1 : filter == 4 ? Paeth(left, up, upLeft) : 0;
+                    out.push_back((uint8_t)(row[x] - predictor));
+                }
+            }
+            return out;
+        }
+
+        std::vector<uint8_t> Encode() const
+        {
+            static const uint8_t SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+            std::vector<uint8_t> png(SIGNATURE, SIGNATURE + 8), ihdr;
+            PutBE32(ihdr, m_width);
+            PutBE32(ihdr, m_height);
+            ihdr.push_back((uint8_t)m_depth);
+            ihdr.push_back((uint8_t)m_colorType);
+            ihdr.push_back(0);
+            ihdr.push_back(0);
+            ihdr.push_back((uint8_t)m_interlace);
+            PutChunk(png, "IHDR", ihdr);
+            if (m_sRGB)
+                PutChunk(png, "sRGB", std::vector<uint8_t>(1, 0));
+            if (!m_palette.empty())
+                PutChunk(png, "PLTE", m_palette);
+            if (!m_trns.empty())
+                PutChunk(png, "tRNS", m_trns);
+
+            // the zlib stream split over two IDATs
+            const auto z = Deflate(Filtered(), m_blocks);
+            PutChunk(png, "IDAT", std::vector<uint8_t>(z.begin(), z.begin() + z.size() / 2));
+            PutChunk(png, "IDAT", std::vector<uint8_t>(z.begin() + z.size() / 2, z.end()));
+            PutChunk(png, "IEND", std::vector<uint8_t>());
+            return png;
+        }
+    };
+
+    PngImage MakeImage(uint32_t width, uint32_t height, int colorType, int depth)
+    {
+        PngImage img;
+        img.m_width = width;
+        img.m_height = height;
+        img.m_colorType = colorType;
+        img.m_depth = depth;
+        img.m_interlace = 0;
+        img.m_sRGB = false;
+        img.m_filters = { 0, 1, 2, 3, 4 };
+        img.m_blocks = { DYNAMIC };
+        img.m_rows.resize(img.Stride() * height);
+        for (size_t i = 0; i < img.m_rows.size(); ++i)
+            img.m_rows[i] = (uint8_t)((i * 37) ^ (i / img.Stride() * 11));
+        return img;
+    }
+
+    PngResult Decode(const std::vector<uint8_t>& png, DecodedImage& out, bool premultiply = false)
+    {
+        return DecodePNG(png.data(), png.size(), out, premultiply);
+    }
+}
+
+TEST_CASE(InflatesEveryBlockType)
+{
+    const auto data = SampleData(6000);
+    const std::vector<std::vector<BlockType>> streams =
+    {
+        { STORED }, { STORED, STORED, STORED },
+        { FIXED }, { DYNAMIC },
+        { STORED, FIXED, DYNAMIC, FIXED, STORED, DYNAMIC },
+    };
+    for (const auto& blocks : streams)
+    {
+        const auto z = Deflate(data, blocks);
+        std::vector<uint8_t> out;
+        CHECK(Inflate(z.data(), z.size(), out, data.size()));
+        CHECK(out == data);
+    }
+
+    // compressed blocks actually compress, with back references
+    CHECK(Deflate(data, { FIXED }).size() < data.size());
+    CHECK(Deflate(data, { DYNAMIC }).size() < Deflate(data, { FIXED }).size());
+
+    // a single byte, an empty stored block
+    for (BlockType t : { STORED, FIXED, DYNAMIC })
+    {
+        const std::vector<uint8_t> one(1, 42);
+        const auto z = Deflate(one, { t });
+        std::vector<uint8_t> out;
+        CHECK(Inflate(z.data(), z.size(), out, 1) && out == one);
+    }
+    const auto empty = Deflate(std::vector<uint8_t>(), { STORED });
+    std::vector<uint8_t> out;
+    CHECK(Inflate(empty.data(), empty.size(), out, 0) && out.empty());
+}
+
+TEST_CASE(InflateRejectsCorruptStreams)
+{
+    const auto data = SampleData(3000);
+    std::vector<uint8_t> out;
+    for (BlockType t : { STORED, FIXED, DYNAMIC })
+    {
+        const auto z = Deflate(data, { t });
+
+        // wrong size either way
+        CHECK(!Inflate(z.data(), z.size(), out, data.size() - 1));
+        CHECK(!Inflate(z.data(), z.size(), out, data.size() + 1));
+
+        // every prefix short of the last deflate byte fails, the adler32 is not read
+        bool allFail = true;
+        for (size_t n = 0; n + 4 < z.size(); ++n)
+        {
+            std::vector<uint8_t> prefix(z.begin(), z.begin() + n);
+            allFail = allFail && !Inflate(prefix.data(), prefix.size(), out, data.size());
+        }
+        CHECK(allFail);
+
+        // flipped bits must not crash or overrun out (sanitizer builds catch it)
+        for (size_t i = 2; i < z.size() - 4; i += 7)
+        {
+            std::vector<uint8_t> bad(z);
+            bad[i] ^= (uint8_t)(1 << (i % 8));
+            Inflate(bad.data(), bad.size(), out, data.size());
+        }
+    }
+
+    // zlib header: not deflate, bad check bits, preset dictionary
+    auto z = Deflate(data, { FIXED });
+    std::vector<uint8_t> bad(z);
+    bad[0] = 0x79;
+    CHECK(!Inflate(bad.data(), bad.size(), out, data.size()));
+    bad = z;
+    bad[1] = 0x02;
+    CHECK(!Inflate(bad.data(), bad.size(), out, data.size()));
+    bad = z;
+    bad[1] = 0x20 | 0x1d; // 0x783d is a multiple of 31 with FDICT
+    CHECK(!Inflate(bad.data(), bad.size(), out, data.size()));
+
+    // reserved block type 3
+    const uint8_t reserved[] = { 0x78, 0x01, 0x07, 0x00 };
+    CHECK(!Inflate(reserved, sizeof(reserved), out, 1));
+
+    // stored length not matching its complement
+    z = Deflate(data, { STORED });
+    z[5] ^= 0x01;
+    CHECK(!Inflate(z.data(), z.size(), out, data.size()));
+
+    // a back reference before the start of the output: fixed block, length 3 (257), distance 1 (code 0)
+    std::vector<uint8_t> far;
+    far.push_back(0x78);
+    far.push_back(0x01);
+    BitWriter bits(far);
+    bits.Put(1, 1);
+    bits.Put(FIXED, 2);
+    bits.PutCode(1, 7);     // 257
+    bits.PutCode(0, 5);     // distance 1
+    bits.PutCode(0, 7);     // 256
+    bits.Align();
+    CHECK(!Inflate(far.data(), far.size(), out, 3));
+}
+
+TEST_CASE(DecodesTruecolorWithEveryFilter)
+{
+    // odd widths leave SIMD tails, 40 pixels wide runs the 16 byte up filter loop
+    for (uint32_t width : { 1u, 7u, 40u })
+    {
+        for (int colorType : { 2, 6 })
+        {
+            PngImage img = MakeImage(width, 11, colorType, 8);
+            img.m_blocks = { STORED, FIXED, DYNAMIC };
+            img.m_sRGB = width == 7;
+            DecodedImage out;
+            CHECK(Decode(img.Encode(), out) == PNG_OK);
+            CHECK(out.m_width == width && out.m_height == 11 && out.m_sRGB == (width == 7) && !out.m_premultiplied);
+
+            const int channels = colorType == 6 ? 4 : 3;
+            bool same = out.m_pixels.size() == (size_t)width * 11 * 4;
+            for (size_t p = 0; same && p < (size_t)width * 11; ++p)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    const uint8_t expected = c < channels ? img.m_rows[p * channels + c] : 255;
+                    same = same && out.m_pixels[p * 4 + c] == expected;
+                }
+            }
+            CHECK(same);
+        }
+    }
+}
+
+TEST_CASE(DecodesPalettesWithTransparency)
+{
+    for (int depth : { 1, 2, 4, 8 })
+    {
+        const uint32_t colors = 1u << depth;
+        PngImage img = MakeImage(13, 5, 3, depth);
+        for (uint32_t i = 0; i < colors; ++i)
+        {
+            img.m_palette.push_back((uint8_t)(i * 3));
+            img.m_palette.push_back((uint8_t)(255 - i));
+            img.m_palette.push_back((uint8_t)(i * 7));
+        }
+        // alpha for the first half of the entries only, the rest stay opaque
+        for (uint32_t i = 0; i < std::max(1u, colors / 2); ++i)
+            img.m_trns.push_back((uint8_t)(i * 50));
+
+        DecodedImage out;
+        CHECK(Decode(img.Encode(), out) == PNG_OK);
+        bool same = true;
+        const size_t stride = img.Stride();
+        for (uint32_t y = 0; y < 5; ++y)
+        {
+            for (uint32_t x = 0; x < 13; ++x)
+            {
+                const int perByte = 8 / depth;
+                const uint32_t index = (img.m_rows[y * stride + x / perByte] >> ((perByte - 1 - x % perByte) * depth)) & (colors - 1);
+                const uint8_t* p = &out.m_pixels[(y * 13 + x) * 4];
+                const uint8_t alpha = index < img.m_trns.size() ? img.m_trns[index] : 255;
+                same = same && p[0] == img.m_palette[index * 3] && p[1] == img.m_palette[index * 3 + 1]
+                    && p[2] == img.m_palette[index * 3 + 2] && p[3] == alpha;
+            }
+        }
+        CHECK(same);
+    }
+}
+
+TEST_CASE(ColorKeyAndPremultiply)
+{
+    // RGB tRNS: pixels equal to the key become transparent
+    PngImage img = MakeImage(6, 2, 2, 8);
+    for (int c = 0; c < 3; ++c)
+        img.m_rows[3 * 3 + c] = (uint8_t)(10 * (c + 1));
+    img.m_trns = { 0, 10, 0, 20, 0, 30 };
+    DecodedImage out;
+    CHECK(Decode(img.Encode(), out) == PNG_OK);
+    CHECK(out.m_pixels[3 * 4 + 3] == 0 && out.m_pixels[2 * 4 + 3] == 255);
+
+    // premultiplied decode is the straight one through the scalar kernel
+    PngImage rgba = MakeImage(21, 9, 6, 8);
+    DecodedImage straight, premultiplied;
+    CHECK(Decode(rgba.Encode(), straight) == PNG_OK);
+    CHECK(Decode(rgba.Encode(), premultiplied, true) == PNG_OK);
+    CHECK(premultiplied.m_premultiplied);
+    PixelKernels::PremultiplyScalar(straight.m_pixels.data(), straight.m_pixels.size() / 4);
+    CHECK(straight.m_pixels == premultiplied.m_pixels);
+}
+
+TEST_CASE(RejectsOrLeavesToWic)
+{
+    DecodedImage out;
+    PngImage gray = MakeImage(4, 4, 0, 8);
+    CHECK(Decode(gray.Encode(), out) == PNG_UNSUPPORTED);
+    PngImage wide = MakeImage(4, 4, 2, 16);
+    CHECK(Decode(wide.Encode(), out) == PNG_UNSUPPORTED);
+    PngImage interlaced = MakeImage(4, 4, 6, 8);
+    interlaced.m_interlace = 1;
+    CHECK(Decode(interlaced.Encode(), out) == PNG_UNSUPPORTED);
+
+    const PngImage good = MakeImage(9, 6, 6, 8);
+    const auto png = good.Encode();
+    CHECK(Decode(png, out) == PNG_OK);
+
+    // not a PNG, every truncation
+    std::vector<uint8_t> bad(png);
+    bad[1] = 'Q';
+    CHECK(Decode(bad, out) == PNG_CORRUPT);
+    bool allFail = true;
+    for (size_t n = 0; n < png.size(); ++n)
+    {
+        std::vector<uint8_t> prefix(png.begin(), png.begin() + n);
+        allFail = allFail && DecodePNG(prefix.data(), prefix.size(), out) == PNG_CORRUPT;
+    }
+    CHECK(allFail);
+
+    // unknown filter type
+    PngImage filter = MakeImage(9, 6, 6, 8);
+    filter.m_filters = { 0, 5 };
+    CHECK(Decode(filter.Encode(), out) == PNG_CORRUPT);
+
+    // palette index past the PLTE
+    PngImage palette = MakeImage(8, 2, 3, 8);
+    palette.m_palette.assign(3 * 4, 128);
+    CHECK(Decode(palette.Encode(), out) == PNG_CORRUPT);
+
+    // chunk length past the end of the file
+    bad = png;
+    bad[8 + 8 + 13 + 4 + 0] = 0x7f;
+    CHECK(Decode(bad, out) == PNG_CORRUPT);
+}
+
+TEST_CASE(PixelKernelsMatchScalar)
+{
+    std::vector<uint8_t> src(64 * 3), simd(64 * 4), scalar(64 * 4);
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = (uint8_t)(i * 29 + 3);
+    bool same = true;
+    for (size_t pixels = 0; pixels <= 64; ++pixels)
+    {
+        std::fill(simd.begin(), simd.end(), 0xcd);
+        std::fill(scalar.begin(), scalar.end(), 0xcd);
+        PixelKernels::RGBToRGBA(src.data(), simd.data(), pixels);
+        PixelKernels::RGBToRGBAScalar(src.data(), scalar.data(), pixels);
+        same = same && simd == scalar;
+    }
+    CHECK(same);
+
+    // every value against every alpha, and the exact rounding
+    std::vector<uint8_t> rgba(256 * 256 * 4);
+    for (uint32_t v = 0; v < 256; ++v)
+    {
+        for (uint32_t a = 0; a < 256; ++a)
+        {
+            uint8_t* p = &rgba[(v * 256 + a) * 4];
+            p[0] = (uint8_t)v;
+            p[1] = (uint8_t)(255 - v);
+            p[2] = (uint8_t)(v ^ a);
+            p[3] = (uint8_t)a;
+        }
+    }
+    std::vector<uint8_t> viaScalar(rgba);
+    PixelKernels::Premultiply(rgba.data(), 256 * 256 - 3);
+    PixelKernels::PremultiplyScalar(viaScalar.data(), 256 * 256 - 3);
+    CHECK(rgba == viaScalar);
+    bool exact = true;
+    for (uint32_t v = 0; v < 256; ++v)
+        for (uint32_t a = 0; a < 256 && v * 256 + a < 256 * 256 - 3; ++a)
+            exact = exact && viaScalar[(v * 256 + a) * 4] == (uint8_t)((2 * v * a + 255) / 510) && viaScalar[(v * 256 + a) * 4 + 3] == a;
+    CHECK(exact);
+}
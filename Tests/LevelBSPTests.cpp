@@ -0,0 +1,205 @@
+﻿#include "pch.h"
+#include "Common/RandomProvider.h"
+#include "Content/LevelBSP.h"
+#include "Content/LevelPregeneration.h"
+#include "TestMain.h"
+
+#include <stdexcept>
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    // LevelMapGenerationSettings defaults
+    LevelBSPParams DefaultParams()
+    {
+        LevelBSPParams params;
+        params.m_tileCount[0] = params.m_tileCount[1] = 20;
+        params.m_minTileCount[0] = params.m_minTileCount[1] = 4;
+        params.m_maxTileCount[0] = params.m_maxTileCount[1] = 8;
+        params.m_minForPillars[0] = params.m_minForPillars[1] = 3;
+        params.m_minRecursiveDepth = 3;
+        params.m_maxRecursiveDepth = 5;
+        params.m_probRoom = 0.05f;
+        params.m_parallelMinTiles = 64 * 64;
+        return params;
+    }
+
+    // the LevelGeneration benchmark map: big and deep, so many subtrees go parallel
+    LevelBSPParams BigParams()
+    {
+        LevelBSPParams params = DefaultParams();
+        params.m_tileCount[0] = params.m_tileCount[1] = 1024;
+        params.m_maxRecursiveDepth = 24;
+        return params;
+    }
+
+    bool Inside(const LevelMapBSPTileArea& inner, const LevelMapBSPTileArea& outer)
+    {
+        return inner.m_x0 >= outer.m_x0 && inner.m_x1 <= outer.m_x1 && inner.m_y0 >= outer.m_y0 && inner.m_y1 <= outer.m_y1;
+    }
+
+    // every node is reached once from the root, children come after their parent and
+    // rooms/empties cover the map without overlapping
+    void CheckLayout(const LevelBSPLayout& layout, const LevelBSPParams& params)
+    {
+        CHECK(!layout.m_nodes.empty());
+        const LevelMapBSPTileArea map(0, params.m_tileCount[0] - 1, 0, params.m_tileCount[1] - 1);
+        std::vector<int> parents(layout.m_nodes.size(), -1);
+        uint64_t leafTiles = 0;
+        uint32_t pillars = 0;
+        for (size_t i = 0; i < layout.m_nodes.size(); ++i)
+        {
+            const LevelBSPNode& n = layout.m_nodes[i];
+            // a wall on the first row/column leaves an empty side with no tiles (x1 = x0-1)
+            const bool noTiles = n.m_type == LevelBSPNode::NODE_EMPTY && (n.m_area.SizeX() == 0 || n.m_area.SizeY() == 0);
+            CHECK(noTiles || Inside(n.m_area, map));
+            const bool wall = n.m_type == LevelBSPNode::WALL_VERT || n.m_type == LevelBSPNode::WALL_HORIZ;
+            CHECK(wall || n.m_type == LevelBSPNode::NODE_ROOM || n.m_type == LevelBSPNode::NODE_EMPTY);
+            for (int c = 0; c < 2; ++c)
+            {
+                const int32_t child = n.m_children[c];
+                CHECK(wall == (child != -1));
+                if (child == -1) continue;
+                CHECK(child > (int32_t)i && child < (int32_t)layout.m_nodes.size());
+                if (child <= (int32_t)i || child >= (int32_t)layout.m_nodes.size()) continue;
+                CHECK(parents[child] == -1);
+                parents[child] = (int)i;
+            }
+            if (!wall && !noTiles)
+                leafTiles += n.m_area.CountTiles();
+            if (n.m_type == LevelBSPNode::NODE_ROOM)
+            {
+                CHECK(n.m_profile < LevelBSPNode::PROFILE_COUNT);
+                CHECK(n.m_firstPillar == pillars || n.m_pillarCount == 0);
+                for (uint32_t p = 0; p < n.m_pillarCount; ++p)
+                {
+                    const LevelBSPPillar& pillar = layout.m_pillars[n.m_firstPillar + p];
+                    // never on the room border, next to a door
+                    CHECK(pillar.x > n.m_area.m_x0 && pillar.x < n.m_area.m_x1 && pillar.y > n.m_area.m_y0 && pillar.y < n.m_area.m_y1);
+                    for (uint32_t q = 0; q < p; ++q)
+                        CHECK(!(layout.m_pillars[n.m_firstPillar + q] == pillar));
+                }
+                pillars += n.m_pillarCount;
+            }
+            else
+            {
+                CHECK(n.m_pillarCount == 0);
+            }
+        }
+        for (size_t i = 1; i < parents.size(); ++i)
+            CHECK(parents[i] != -1);
+        CHECK(pillars == layout.m_pillars.size());
+        // walls take one row/column each, so leaves cover less than the whole map but never more
+        CHECK(leafTiles <= map.CountTiles());
+    }
+
+    // what identifies a level: every node and pillar, hashed
+    uint32_t Fingerprint(const LevelBSPLayout& layout)
+    {
+        uint32_t hash = 0;
+        for (const LevelBSPNode& n : layout.m_nodes)
+        {
+            const uint32_t fields[] = { n.m_area.m_x0, n.m_area.m_x1, n.m_area.m_y0, n.m_area.m_y1, (uint32_t)n.m_type,
+                (uint32_t)n.m_children[0], (uint32_t)n.m_children[1], n.m_profile, n.m_pillarCount };
+            for (uint32_t f : fields)
+                hash = DX::RandomProvider::Hash(hash ^ f, 0x1e7e1);
+        }
+        for (const LevelBSPPillar& p : layout.m_pillars)
+            hash = DX::RandomProvider::Hash(hash ^ (p.x << 16 | p.y), 0x1e7e1);
+        return hash;
+    }
+}
+
+TEST_CASE(LayoutIsValid)
+{
+    for (uint32_t seed = 0; seed < 32; ++seed)
+    {
+        const LevelBSPParams params = DefaultParams();
+        LevelBSPLayout layout;
+        layout.Generate(params, DX::RandomProvider(seed));
+        CheckLayout(layout, params);
+    }
+    const LevelBSPParams params = BigParams();
+    LevelBSPLayout layout;
+    layout.Generate(params, DX::RandomProvider(DX::RandomProvider::DEFAULT_SEED));
+    CheckLayout(layout, params);
+}
+
+TEST_CASE(SameStreamSameLayout)
+{
+    const LevelBSPParams params = DefaultParams();
+    LevelBSPLayout a, b, c;
+    a.Generate(params, DX::RandomProvider(1234));
+    b.Generate(params, DX::RandomProvider(1234));
+    c.Generate(params, DX::RandomProvider(1235));
+    CHECK(a == b);
+    CHECK(!(a == c));
+}
+
+TEST_CASE(ParallelMatchesSerial)
+{
+    // path derived streams: the tree can't depend on which subtrees ran in parallel
+    LevelBSPParams params = BigParams();
+    const DX::RandomProvider stream(DX::RandomProvider::DEFAULT_SEED);
+    params.m_parallelMinTiles = 0;
+    LevelBSPLayout serial;
+    serial.Generate(params, stream);
+
+    const uint32_t thresholds[] = { 64 * 64, 256 * 256 };
+    for (uint32_t threshold : thresholds)
+    {
+        params.m_parallelMinTiles = threshold;
+        LevelBSPLayout parallel;
+        parallel.Generate(params, stream);
+        CHECK(parallel == serial);
+    }
+
+    // every split in parallel, on the game sized map
+    for (uint32_t seed = 0; seed < 16; ++seed)
+    {
+        LevelBSPParams small = DefaultParams();
+        small.m_parallelMinTiles = 0;
+        serial.Generate(small, DX::RandomProvider(seed));
+        small.m_parallelMinTiles = 1;
+        LevelBSPLayout parallel;
+        parallel.Generate(small, DX::RandomProvider(seed));
+        CHECK(parallel == serial);
+    }
+}
+
+TEST_CASE(FailedWorkerFallsBackToTheSameLevel)
+{
+    // GameResources::GenerateNewLevel with LevelBSPLayout for the map: the worker built (or
+    // failed to build) the announced seed, the level the player gets must be the same
+    const LevelBSPParams params = DefaultParams();
+    const uint32_t announced = DX::RandomProvider(99).Next();
+    uint32_t newSeeds = 0;
+    auto newSeed = [&] { ++newSeeds; return announced + 1; };
+
+    LevelBSPLayout next, current;
+    auto worker = [&] { next.Generate(params, DX::RandomProvider(announced)); };
+    auto swap = [&] { std::swap(current, next); };
+    auto generate = [&](uint32_t seed) { current.Generate(params, DX::RandomProvider(seed)); };
+
+    worker();
+    CHECK(FinishNextLevel(true, announced, [] {}, swap, generate, newSeed) == announced);
+    const uint32_t pregenerated = Fingerprint(current);
+
+    // fails half way, after building part of the level
+    current.Clear();
+    auto failing = [&]
+    {
+        next.Clear();
+        next.Generate(DefaultParams(), DX::RandomProvider(announced ^ 1));
+        throw std::runtime_error("worker");
+    };
+    CHECK(FinishNextLevel(true, announced, failing, swap, generate, newSeed) == announced);
+    CHECK(Fingerprint(current) == pregenerated);
+    CHECK(newSeeds == 0);
+
+    // nothing pending, a new seed
+    CHECK(FinishNextLevel(false, announced, failing, swap, generate, newSeed) == announced + 1);
+    CHECK(newSeeds == 1);
+    CHECK(Fingerprint(current) != pregenerated);
+}
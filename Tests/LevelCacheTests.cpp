@@ -0,0 +1,290 @@
+﻿#include "pch.h"
+#include "Common/RandomProvider.h"
+#include "Content/LevelBSP.h"
+#include "Content/LevelCacheFormat.h"
+#include "TestMain.h"
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    static const uint32_t FINGERPRINT = 0x5eed5eed;
+
+    // what SaveCache writes for a generated level: the BSP tree, rooms as leaves in
+    // pre-order, portals between consecutive rooms and one teleport first <-> last room
+    LevelCacheData BuildLevel(uint32_t seed)
+    {
+        LevelBSPParams params;
+        params.m_tileCount[0] = params.m_tileCount[1] = 35;
+        params.m_minTileCount[0] = params.m_minTileCount[1] = 4;
+        params.m_maxTileCount[0] = params.m_maxTileCount[1] = 15;
+        params.m_minForPillars[0] = params.m_minForPillars[1] = 3;
+        params.m_minRecursiveDepth = 3;
+        params.m_maxRecursiveDepth = 5;
+        params.m_probRoom = 0.05f;
+        params.m_parallelMinTiles = 0;
+        LevelBSPLayout layout;
+        layout.Generate(params, DX::RandomProvider(seed));
+
+        LevelCacheData data;
+        data.m_nodes.resize(layout.m_nodes.size());
+        int32_t wall = -1;
+        for (size_t i = 0; i < layout.m_nodes.size(); ++i)
+        {
+            const auto& n = layout.m_nodes[i];
+            auto& cn = data.m_nodes[i];
+            cn = LevelCacheNode();
+            cn.area = n.m_area;
+            cn.type = n.m_type;
+            cn.parent = -1;
+            cn.children[0] = n.m_children[0];
+            cn.children[1] = n.m_children[1];
+            cn.leafNdx = -1;
+            cn.teleportNdx = -1;
+            cn.tag = (uint32_t)i;
+            if (n.m_type == LevelBSPNode::NODE_ROOM)
+            {
+                cn.profile = n.m_profile;
+                cn.leafNdx = (int32_t)data.m_leaves.size();
+                data.m_leaves.push_back((int32_t)i);
+                if (n.m_pillarCount)
+                {
+                    cn.flags |= LevelCacheNode::HAS_PILLARS;
+                    cn.firstPillar = (uint32_t)data.m_pillars.size();
+                    cn.pillarCount = n.m_pillarCount;
+                    for (uint32_t p = 0; p < n.m_pillarCount; ++p)
+                    {
+                        const LevelCacheUInt2 pillar = { layout.m_pillars[n.m_firstPillar + p].x, layout.m_pillars[n.m_firstPillar + p].y };
+                        data.m_pillars.push_back(pillar);
+                    }
+                }
+                cn.flags |= LevelCacheNode::HAS_SEGMENTS;
+                cn.firstSegment = (uint32_t)data.m_segments.size();
+                cn.segmentCount = 4;
+                for (uint32_t s = 0; s < 4; ++s)
+                {
+                    const LevelCacheSegment segment = { { (float)n.m_area.m_x0, (float)s }, { (float)n.m_area.m_x1, (float)s }, { 0.0f, 1.0f }, (int32_t)s };
+                    data.m_segments.push_back(segment);
+                }
+            }
+            else if (wall == -1 && n.m_children[0] != -1)
+            {
+                wall = (int32_t)i;
+            }
+        }
+        for (size_t i = 0; i < data.m_nodes.size(); ++i)
+            for (int32_t child : data.m_nodes[i].children)
+                if (child != -1)
+                    data.m_nodes[child].parent = (int32_t)i;
+
+        for (size_t i = 1; i < data.m_leaves.size(); ++i)
+        {
+            const LevelCachePortal portal = { { data.m_leaves[i - 1], data.m_leaves[i] }, wall, (int32_t)i, (int32_t)(i & 1) };
+            data.m_portals.push_back(portal);
+        }
+        const int32_t first = data.m_leaves.front(), last = data.m_leaves.back();
+        const LevelCacheTeleport teleport = { { first, last }, { { 1, 2 }, { 3, 4 } }, 0 };
+        data.m_teleports.push_back(teleport);
+        data.m_nodes[first].teleportNdx = data.m_nodes[last].teleportNdx = 0;
+        return data;
+    }
+
+    bool Read(const std::vector<uint8_t>& file, LevelCacheView* view = nullptr)
+    {
+        LevelCacheView unused;
+        return LevelCacheRead(file.data(), file.size(), FINGERPRINT, view ? view : &unused);
+    }
+
+    bool Read(const LevelCacheData& data)
+    {
+        const LevelCacheUInt2 tiles = { 35, 35 };
+        return Read(LevelCacheWrite(data, 1, FINGERPRINT, tiles));
+    }
+
+    template<typename T>
+    bool SameSection(const std::vector<T>& expected, const T* actual, uint32_t count)
+    {
+        return expected.size() == count && (count == 0 || memcmp(expected.data(), actual, count * sizeof(T)) == 0);
+    }
+
+    // first node of a type, -1 when none
+    int32_t FindNode(const LevelCacheData& data, int32_t type)
+    {
+        for (size_t i = 0; i < data.m_nodes.size(); ++i)
+            if (data.m_nodes[i].type == type)
+                return (int32_t)i;
+        return -1;
+    }
+}
+
+TEST_CASE(RoundTrip)
+{
+    for (uint32_t seed = 0; seed < 16; ++seed)
+    {
+        const LevelCacheData data = BuildLevel(seed);
+        CHECK(data.m_leaves.size() > 1);
+        const LevelCacheUInt2 tiles = { 35, 35 };
+        const std::vector<uint8_t> file = LevelCacheWrite(data, seed, FINGERPRINT, tiles);
+
+        LevelCacheView view;
+        CHECK(Read(file, &view));
+        if (!Read(file, &view)) continue;
+        CHECK(view.m_header->levelSeed == seed);
+        CHECK(view.m_header->tileCount.x == 35 && view.m_header->tileCount.y == 35);
+        CHECK(SameSection(data.m_nodes, view.m_nodes, view.Count(LCS_NODES)));
+        CHECK(SameSection(data.m_leaves, view.m_leaves, view.Count(LCS_LEAVES)));
+        CHECK(SameSection(data.m_portals, view.m_portals, view.Count(LCS_PORTALS)));
+        CHECK(SameSection(data.m_teleports, view.m_teleports, view.Count(LCS_TELEPORTS)));
+        CHECK(SameSection(data.m_pillars, view.m_pillars, view.Count(LCS_PILLARS)));
+        CHECK(SameSection(data.m_segments, view.m_segments, view.Count(LCS_SEGMENTS)));
+    }
+}
+
+TEST_CASE(RejectsOtherFiles)
+{
+    const LevelCacheData data = BuildLevel(7);
+    const LevelCacheUInt2 tiles = { 35, 35 };
+    const std::vector<uint8_t> file = LevelCacheWrite(data, 7, FINGERPRINT, tiles);
+    LevelCacheView view;
+    CHECK(!LevelCacheRead(file.data(), file.size(), FINGERPRINT + 1, &view));
+    CHECK(!LevelCacheRead(nullptr, 0, FINGERPRINT, &view));
+
+    std::vector<uint8_t> bad = file;
+    reinterpret_cast<LevelCacheHeader*>(bad.data())->magic ^= 1;
+    CHECK(!Read(bad));
+    bad = file;
+    reinterpret_cast<LevelCacheHeader*>(bad.data())->version += 1;
+    CHECK(!Read(bad));
+
+    // every truncation cuts the last section
+    for (size_t size = 0; size < file.size(); ++size)
+        CHECK(!Read(std::vector<uint8_t>(file.begin(), file.begin() + size)));
+
+    // sections must be aligned for in place use
+    bad = file;
+    reinterpret_cast<LevelCacheHeader*>(bad.data())->sectionOffset[LCS_NODES] += 1;
+    CHECK(!Read(bad));
+    bad = file;
+    reinterpret_cast<LevelCacheHeader*>(bad.data())->sectionCount[LCS_LEAVES] = 0xffffffff;
+    CHECK(!Read(bad));
+}
+
+TEST_CASE(RejectsBadIndices)
+{
+    const LevelCacheData good = BuildLevel(3);
+    CHECK(Read(good));
+    const int32_t room = good.m_leaves[1];
+    const int32_t wall = FindNode(good, LevelBSPNode::WALL_VERT) != -1 ? FindNode(good, LevelBSPNode::WALL_VERT) : FindNode(good, LevelBSPNode::WALL_HORIZ);
+    CHECK(wall >= 0);
+
+    LevelCacheData data = good;
+    data.m_nodes[room].teleportNdx = (int32_t)good.m_teleports.size();
+    CHECK(!Read(data));
+    data = good; // a teleport that doesn't contain the room
+    data.m_nodes[room].teleportNdx = 0;
+    CHECK(!Read(data));
+    data = good;
+    data.m_nodes[room].leafNdx = (int32_t)good.m_leaves.size();
+    CHECK(!Read(data));
+    data = good; // leaf index of another room
+    data.m_nodes[room].leafNdx = 0;
+    CHECK(!Read(data));
+    data = good; // a wall in the leaves section
+    data.m_leaves[1] = wall;
+    CHECK(!Read(data));
+    data = good;
+    data.m_leaves[1] = (int32_t)good.m_nodes.size();
+    CHECK(!Read(data));
+
+    data = good;
+    data.m_nodes[room].type = LevelBSPNode::WALL_HORIZ + 1;
+    CHECK(!Read(data));
+    data = good;
+    data.m_nodes[room].type = -1;
+    CHECK(!Read(data));
+    data = good;
+    data.m_nodes[room].profile = LevelBSPNode::PROFILE_COUNT;
+    CHECK(!Read(data));
+    data = good;
+    data.m_nodes[room].firstPillar = 0xffffffff;
+    data.m_nodes[room].pillarCount = 2;
+    CHECK(!Read(data));
+    data = good;
+    data.m_nodes[room].segmentCount = (uint32_t)good.m_segments.size() + 1;
+    CHECK(!Read(data));
+
+    data = good;
+    data.m_portals[0].leaves[1] = wall;
+    CHECK(!Read(data));
+    data = good;
+    data.m_portals[0].wallNode = -1;
+    CHECK(!Read(data));
+    data = good;
+    data.m_teleports[0].leaves[0] = (int32_t)good.m_nodes.size();
+    CHECK(!Read(data));
+}
+
+TEST_CASE(RejectsNonTrees)
+{
+    const LevelCacheData good = BuildLevel(5);
+    const int32_t room = good.m_leaves.back();
+    const int32_t parent = good.m_nodes[room].parent;
+    CHECK(parent >= 0);
+
+    LevelCacheData data = good; // room back to the root
+    data.m_nodes[room].children[0] = 0;
+    CHECK(!Read(data));
+    data = good; // and with the parent link too
+    data.m_nodes[room].children[0] = 0;
+    data.m_nodes[0].parent = room;
+    CHECK(!Read(data));
+    data = good; // a node reached twice
+    data.m_nodes[room].children[0] = good.m_nodes[parent].children[0] == room ? good.m_nodes[parent].children[1] : good.m_nodes[parent].children[0];
+    CHECK(!Read(data));
+    data = good; // self loop
+    data.m_nodes[room].children[1] = room;
+    CHECK(!Read(data));
+    data = good; // unreachable subtree
+    data.m_nodes[parent].children[good.m_nodes[parent].children[0] == room ? 0 : 1] = -1;
+    CHECK(!Read(data));
+    data = good; // wrong parent link
+    data.m_nodes[room].parent = 0;
+    CHECK(!Read(data) || parent == 0);
+}
+
+TEST_CASE(MutatedFilesAreSafe)
+{
+    // whatever is accepted can be walked the way LoadCache and GetAdjacentRooms do
+    const LevelCacheData data = BuildLevel(11);
+    const LevelCacheUInt2 tiles = { 35, 35 };
+    const std::vector<uint8_t> file = LevelCacheWrite(data, 11, FINGERPRINT, tiles);
+    DX::RandomProvider random(DX::RandomProvider::DEFAULT_SEED);
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < 20000; ++i)
+    {
+        std::vector<uint8_t> bad = file;
+        const uint32_t flips = random.Get(1, 4);
+        for (uint32_t f = 0; f < flips; ++f)
+            bad[random.Get(0, (uint32_t)bad.size() - 1)] ^= (uint8_t)(1 << random.Get(0, 7));
+
+        LevelCacheView view;
+        if (!Read(bad, &view))
+            continue;
+        ++accepted;
+        const uint32_t nodeCount = view.Count(LCS_NODES);
+        for (uint32_t l = 0; l < view.Count(LCS_LEAVES); ++l)
+        {
+            const auto& leaf = view.m_nodes[view.m_leaves[l]];
+            CHECK(leaf.leafNdx == (int32_t)l);
+            if (leaf.teleportNdx == -1) continue;
+            const auto& tp = view.m_teleports[leaf.teleportNdx];
+            const int32_t other = tp.leaves[0] == view.m_leaves[l] ? tp.leaves[1] : tp.leaves[0];
+            CHECK(other >= 0 && (uint32_t)other < nodeCount && view.m_nodes[other].leafNdx >= 0);
+        }
+        for (uint32_t p = 0; p < view.Count(LCS_PORTALS); ++p)
+            for (int32_t leaf : view.m_portals[p].leaves)
+                CHECK(view.m_nodes[leaf].leafNdx >= 0);
+    }
+    // flips in tags, areas or segment data are fine
+    CHECK(accepted > 0);
+}
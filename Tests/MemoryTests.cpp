@@ -0,0 +1,251 @@
+﻿#include "pch.h"
+#include "Common/MemoryTracker.h"
+#include "Common/FrameAllocator.h"
+#include "TestMain.h"
+
+#include <new>
+#include <thread>
+
+using namespace DX;
+
+namespace
+{
+    struct Item
+    {
+        uint64_t m_index;
+        float m_depth;
+    };
+
+    // what a frame builds: a few lists, each grown one push_back at a time
+    size_t BuildLists(int lists, int items)
+    {
+        size_t sink = 0;
+        for (int l = 0; l < lists; ++l)
+        {
+            FrameVector<Item> list;
+            for (int i = 0; i < items; ++i)
+                list.push_back(Item{ uint64_t(l * items + i), 0.0f });
+            sink += (size_t)list.back().m_index;
+        }
+        return sink;
+    }
+
+    int g_handlerCalls = 0;
+
+    void CountingNewHandler()
+    {
+        ++g_handlerCalls;
+        std::set_new_handler(nullptr);
+    }
+}
+
+TEST_CASE(CountsThreadHeapAllocations)
+{
+    const uint64_t before = GetThreadHeapAllocations();
+    int* one = new int(1);
+    int* many = new int[16];
+    delete one;
+    delete[] many;
+    CHECK(GetThreadHeapAllocations() - before == 2);
+
+    // another thread's allocations are its own
+    uint64_t other = 0;
+    const uint64_t mine = GetThreadHeapAllocations();
+    std::thread worker([&]
+    {
+        const uint64_t start = GetThreadHeapAllocations();
+        std::vector<int> v(100);
+        other = GetThreadHeapAllocations() - start;
+    });
+    worker.join();
+    CHECK(other == 1);
+    CHECK(GetThreadHeapAllocations() - mine <= 2); // std::thread's own state
+
+    // TaggedAllocator goes through the same operator new
+    const uint64_t tagged = GetThreadHeapAllocations();
+    {
+        std::vector<int, TaggedAllocator<int, MEMTAG_SOUND>> samples(64, 7);
+        CHECK(samples[63] == 7);
+    }
+    CHECK(GetThreadHeapAllocations() - tagged == 1);
+}
+
+TEST_CASE(OutOfMemoryCallsTheNewHandler)
+{
+    // the replacement operator new keeps the standard contract: ask the handler, then throw
+    volatile size_t huge = SIZE_MAX / 2;
+    g_handlerCalls = 0;
+    std::set_new_handler(CountingNewHandler);
+    bool threw = false;
+    try
+    {
+        char* p = new char[huge];
+        delete[] p;
+    }
+    catch (const std::bad_alloc&) { threw = true; }
+    CHECK(threw);
+    CHECK(g_handlerCalls == 1);
+    CHECK(std::get_new_handler() == nullptr);
+
+    // zero bytes is still a distinct block
+    char* a = new char[0];
+    char* b = new char[0];
+    CHECK(a && b && a != b);
+    delete[] a;
+    delete[] b;
+}
+
+TEST_CASE(TagNamesAndSnapshot)
+{
+    CHECK(strcmp(MemoryTracker::GetTagName(MEMTAG_UNTAGGED), "Untagged") == 0);
+    CHECK(strcmp(MemoryTracker::GetTagName(MEMTAG_FRAMEARENA), "FrameArena") == 0);
+    CHECK(strcmp(MemoryTracker::GetTagName(MEMTAG_COUNT), "?") == 0);
+
+    // scopes nest; without the debug CRT the snapshot says tracking is off and is all zero
+    MemorySnapshot snapshot;
+    {
+        MemoryTagScope level(MEMTAG_LEVELMAP);
+        {
+            MemoryTagScope sprites(MEMTAG_SPRITES);
+            std::unique_ptr<int> p(new int(3));
+        }
+        MemoryTracker::GetSnapshot(snapshot);
+    }
+    MemoryTracker::ResetPeaks();
+    bool zero = true;
+    for (const auto& tag : snapshot.m_tags)
+        zero = zero && tag.m_liveBytes == 0 && tag.m_liveAllocations == 0 && tag.m_peakBytes == 0 && tag.m_allocations == 0;
+    CHECK(snapshot.m_tracking == (DX_MEMORY_TRACKING != 0));
+    if (!snapshot.m_tracking)
+        CHECK(zero);
+}
+
+TEST_CASE(ArenaAlignsAndPacks)
+{
+    FrameArena::EndFrame();
+    FrameArena& arena = FrameArena::Get();
+    uint8_t* last = nullptr;
+    size_t lastSize = 0;
+    bool aligned = true, ordered = true;
+    for (size_t alignment = 1; alignment <= 64; alignment *= 2)
+    {
+        for (size_t size = 1; size < 100; size += 33)
+        {
+            uint8_t* p = static_cast<uint8_t*>(arena.Allocate(size, alignment));
+            aligned = aligned && ((uintptr_t)p % alignment) == 0;
+            // one block, so bump order and no overlap
+            ordered = ordered && (!last || p >= last + lastSize);
+            memset(p, 0xCD, size);
+            last = p;
+            lastSize = size;
+        }
+    }
+    CHECK(aligned);
+    CHECK(ordered);
+    CHECK(arena.GetStats().m_allocations == 7 * 3);
+    CHECK(arena.GetStats().m_bytes >= 7 * (1 + 34 + 67));
+
+    // larger than a block gets a block of its own
+    const uint32_t blocks = arena.GetStats().m_blocks;
+    void* big = arena.Allocate(FrameArena::BlockSize * 3, 16);
+    CHECK(big && arena.GetStats().m_blocks == blocks + 1);
+    CHECK(arena.GetStats().m_capacity >= FrameArena::BlockSize * 4);
+}
+
+TEST_CASE(ArenaKeepsFramesForBuffering)
+{
+    static_assert(FrameArena::Buffering == 2, "the frames below assume double buffering");
+    FrameArena::EndFrame();
+    FrameArena& arena = FrameArena::Get();
+    uint8_t* first = static_cast<uint8_t*>(arena.Allocate(256, 16));
+    memset(first, 0xAB, 256);
+
+    // the next frame uses the other region and leaves this one alone
+    FrameArena::EndFrame();
+    CHECK(arena.GetStats().m_allocations == 0);
+    uint8_t* second = static_cast<uint8_t*>(arena.Allocate(256, 16));
+    memset(second, 0x11, 256);
+    bool intact = second != first;
+    for (int i = 0; i < 256; ++i)
+        intact = intact && first[i] == 0xAB;
+    CHECK(intact);
+
+    // two frames later the first region is handed out again, from its start
+    FrameArena::EndFrame();
+    CHECK(arena.Allocate(256, 16) == first);
+}
+
+TEST_CASE(SteadyFramesStayOffTheHeap)
+{
+    // once warm, a frame of FrameVector lists does no heap allocation
+    static const int WARMUP = 4;
+    size_t sink = 0;
+    for (int f = 0; f < WARMUP; ++f)
+    {
+        sink += BuildLists(64, 200);
+        FrameArena::EndFrame();
+    }
+    const uint64_t before = GetThreadHeapAllocations();
+    const uint32_t blocks = FrameArena::GetTotalBlocks();
+    for (int f = 0; f < 50; ++f)
+    {
+        sink += BuildLists(64, 200);
+        FrameArena::EndFrame();
+    }
+    CHECK(GetThreadHeapAllocations() == before);
+    CHECK(FrameArena::GetTotalBlocks() == blocks);
+    CHECK(sink > 0);
+}
+
+TEST_CASE(WorkersUseTheirOwnArena)
+{
+    // a worker recycles lazily on its first allocation of a frame; past its own growth
+    // (new blocks) it must not touch the heap either
+    static const int FRAMES = 40;
+    std::atomic<int> done(0);
+    std::atomic<uint32_t> heapLists(0);
+    std::atomic<uintptr_t> workerArena(0);
+    const uint32_t start = FrameArena::GetFrame();
+    std::thread worker([&]
+    {
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            while (FrameArena::GetFrame() != start + (uint32_t)f)
+                std::this_thread::yield();
+            FrameArena& arena = FrameArena::Get();
+            workerArena = (uintptr_t)&arena;
+            const uint32_t blocks = arena.GetStats().m_blocks;
+            const uint64_t heap = GetThreadHeapAllocations();
+            BuildLists(16, 300);
+            if (GetThreadHeapAllocations() != heap && arena.GetStats().m_blocks == blocks)
+                ++heapLists;
+            done = f + 1;
+        }
+    });
+    for (int f = 0; f < FRAMES; ++f)
+    {
+        BuildLists(4, 100);
+        while (done.load() != f + 1)
+            std::this_thread::yield();
+        FrameArena::EndFrame();
+    }
+    worker.join();
+    CHECK(heapLists == 0);
+    CHECK(workerArena != (uintptr_t)&FrameArena::Get());
+}
+
+TEST_CASE(FrameAllocatorContract)
+{
+    FrameAllocator<int> a;
+    FrameAllocator<double> b(a);
+    CHECK(a == FrameAllocator<int>(b));
+    bool threw = false;
+    try { a.allocate(SIZE_MAX / sizeof(int) + 1); }
+    catch (const std::bad_alloc&) { threw = true; }
+    CHECK(threw);
+
+    // another thread's allocator is another arena
+    FrameAllocator<int> other;
+    std::thread([&] { other = FrameAllocator<int>(); }).join();
+    CHECK(a != other);
+}
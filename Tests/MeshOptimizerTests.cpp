@@ -0,0 +1,274 @@
+﻿#include "pch.h"
+#include "MeshOptimizer.h"
+#include "TestMain.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+using namespace DirectX;
+using namespace DirectX::MeshOptimizer;
+
+namespace
+{
+    // size x size quads on the floor, two triangles each, counter clockwise seen from above
+    void CreateGrid(uint32_t size, std::vector<XMFLOAT3>& positions, std::vector<uint16_t>& indices)
+    {
+        positions.clear();
+        indices.clear();
+        for (uint32_t z = 0; z <= size; ++z)
+            for (uint32_t x = 0; x <= size; ++x)
+                positions.push_back(XMFLOAT3(float(x), 0.0f, float(z)));
+        for (uint32_t z = 0; z < size; ++z)
+        {
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                const uint16_t a = uint16_t(z * (size + 1) + x), b = uint16_t(a + 1);
+                const uint16_t c = uint16_t(a + size + 1), d = uint16_t(c + 1);
+                const uint16_t quad[] = { a, c, b, b, c, d };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+    }
+
+    // the triangles in random order, so there is something to gain
+    void Scramble(std::vector<uint16_t>& indices, uint32_t seed)
+    {
+        std::vector<uint32_t> order(indices.size() / 3);
+        std::iota(order.begin(), order.end(), 0u);
+        std::mt19937 rng(seed);
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<uint16_t> scrambled;
+        scrambled.reserve(indices.size());
+        for (uint32_t t : order)
+            scrambled.insert(scrambled.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        indices.swap(scrambled);
+    }
+
+    // Each triangle rotated to start at its lowest index, then sorted: two index buffers drawing
+    // the same faces with the same winding give the same list
+    template<typename T>
+    std::vector<uint64_t> CanonicalTriangles(const std::vector<T>& indices)
+    {
+        std::vector<uint64_t> tris;
+        tris.reserve(indices.size() / 3);
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            uint64_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+            if (b < a && b <= c) { std::swap(a, b); std::swap(b, c); }
+            else if (c < a && c < b) { std::swap(a, c); std::swap(b, c); }
+            tris.push_back((a << 42) | (b << 21) | c);
+        }
+        std::sort(tris.begin(), tris.end());
+        return tris;
+    }
+
+    template<typename F>
+    bool Throws(F f)
+    {
+        try { f(); }
+        catch (const std::runtime_error&) { return true; }
+        return false;
+    }
+}
+
+TEST_CASE(AnalyzeCountsMisses)
+{
+    // a single triangle: three misses, three vertices
+    const uint16_t tri[] = { 0, 1, 2 };
+    auto stats = AnalyzeVertexCache(tri, 3, 3);
+    CHECK(stats.triangles == 1 && stats.vertices == 3 && stats.transformed == 3);
+    CHECK(stats.acmr == 3.0f && stats.atvr == 1.0f);
+
+    // the same triangle twice hits the cache, a vertex never referenced is not counted
+    const uint16_t twice[] = { 0, 1, 2, 2, 1, 0 };
+    stats = AnalyzeVertexCache(twice, 6, 4);
+    CHECK(stats.triangles == 2 && stats.vertices == 3 && stats.transformed == 3);
+
+    // a FIFO of 4 entries has pushed vertex 0 out by the last triangle
+    const uint16_t fifo[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+    CHECK(AnalyzeVertexCache(fifo, 9, 6, 4).transformed == 9);
+    CHECK(AnalyzeVertexCache(fifo, 9, 6, 8).transformed == 6);
+}
+
+TEST_CASE(FacesGetCheaper)
+{
+    std::vector<XMFLOAT3> positions;
+    std::vector<uint16_t> indices;
+    CreateGrid(48, positions, indices);
+    Scramble(indices, 43);
+    const auto reference = CanonicalTriangles(indices);
+    const auto before = AnalyzeVertexCache(indices.data(), indices.size(), positions.size());
+    CHECK(before.acmr > 2.5f);
+
+    // a regular grid can get close to 0.5 on a 16 entry cache
+    std::vector<uint16_t> forsyth(indices), tipsify(indices);
+    OptimizeFaces(forsyth.data(), forsyth.size(), positions.size(), FaceOrder_Forsyth);
+    OptimizeFaces(tipsify.data(), tipsify.size(), positions.size(), FaceOrder_Tipsify);
+    const auto forsythStats = AnalyzeVertexCache(forsyth.data(), forsyth.size(), positions.size());
+    const auto tipsifyStats = AnalyzeVertexCache(tipsify.data(), tipsify.size(), positions.size());
+    CHECK(forsythStats.acmr < 0.75f);
+    CHECK(tipsifyStats.acmr < 0.75f);
+    CHECK(forsythStats.triangles == before.triangles && tipsifyStats.triangles == before.triangles);
+
+    // same faces, same winding
+    CHECK(CanonicalTriangles(forsyth) == reference);
+    CHECK(CanonicalTriangles(tipsify) == reference);
+}
+
+TEST_CASE(CacheSizesAndIndexWidths)
+{
+    std::vector<XMFLOAT3> positions;
+    std::vector<uint16_t> indices;
+    CreateGrid(24, positions, indices);
+    Scramble(indices, 44);
+    const std::vector<uint32_t> wide(indices.begin(), indices.end());
+    const auto reference = CanonicalTriangles(indices);
+
+    const uint32_t sizes[] = { MinCacheSize, 8, DefaultCacheSize, 32, MaxCacheSize };
+    for (uint32_t cacheSize : sizes)
+    {
+        for (FaceOrder order : { FaceOrder_Forsyth, FaceOrder_Tipsify })
+        {
+            const float before = AnalyzeVertexCache(indices.data(), indices.size(), positions.size(), cacheSize).acmr;
+
+            std::vector<uint16_t> narrow(indices);
+            OptimizeFaces(narrow.data(), narrow.size(), positions.size(), order, cacheSize);
+            CHECK(CanonicalTriangles(narrow) == reference);
+            CHECK(AnalyzeVertexCache(narrow.data(), narrow.size(), positions.size(), cacheSize).acmr < before);
+
+            // 16 and 32 bit indices get the same order
+            std::vector<uint32_t> optimized(wide);
+            OptimizeFaces(optimized.data(), optimized.size(), positions.size(), order, cacheSize);
+            CHECK(std::equal(optimized.begin(), optimized.end(), narrow.begin()));
+        }
+    }
+}
+
+TEST_CASE(OverdrawKeepsTheFaces)
+{
+    // a closed box, so some clusters face away from the others
+    std::vector<XMFLOAT3> positions;
+    std::vector<uint16_t> indices;
+    CreateGrid(16, positions, indices);
+    const size_t floor = positions.size();
+    for (size_t v = 0; v < floor; ++v)
+        positions.push_back(XMFLOAT3(positions[v].x, 16.0f, positions[v].z));
+    const size_t floorIndices = indices.size();
+    for (size_t i = 0; i < floorIndices; i += 3)
+    {
+        // the ceiling faces down: same corners, opposite winding
+        indices.push_back(uint16_t(indices[i] + floor));
+        indices.push_back(uint16_t(indices[i + 2] + floor));
+        indices.push_back(uint16_t(indices[i + 1] + floor));
+    }
+    Scramble(indices, 45);
+    const auto reference = CanonicalTriangles(indices);
+    const float before = AnalyzeVertexCache(indices.data(), indices.size(), positions.size()).acmr;
+
+    std::vector<uint16_t> optimized(indices);
+    OptimizeOverdraw(optimized.data(), optimized.size(), positions.data(), sizeof(XMFLOAT3), positions.size());
+    CHECK(CanonicalTriangles(optimized) == reference);
+    CHECK(AnalyzeVertexCache(optimized.data(), optimized.size(), positions.size()).acmr < before);
+
+    // positions inside a larger vertex
+    struct Vertex { float u, v; XMFLOAT3 position; };
+    std::vector<Vertex> vertices(positions.size());
+    for (size_t v = 0; v < positions.size(); ++v)
+        vertices[v].position = positions[v];
+    std::vector<uint16_t> strided(indices);
+    OptimizeOverdraw(strided.data(), strided.size(), &vertices[0].position, sizeof(Vertex), vertices.size());
+    CHECK(strided == optimized);
+}
+
+TEST_CASE(VertexFetchRemap)
+{
+    std::vector<XMFLOAT3> positions;
+    std::vector<uint16_t> indices;
+    CreateGrid(20, positions, indices);
+    Scramble(indices, 46);
+    // a vertex no triangle refers to
+    positions.push_back(XMFLOAT3(-1.0f, -1.0f, -1.0f));
+    const std::vector<uint16_t> original(indices);
+
+    std::vector<uint32_t> remap(positions.size());
+    const size_t used = OptimizeVertexFetch(indices.data(), indices.size(), positions.size(), remap.data());
+    CHECK(used == positions.size() - 1);
+    CHECK(remap.back() == UnusedVertex);
+
+    // indices[i] == remap[original[i]], and new vertices are numbered in first use order
+    bool consistent = true;
+    uint32_t next = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        consistent = consistent && indices[i] == remap[original[i]];
+        if (indices[i] == next) ++next;
+        else consistent = consistent && indices[i] < next;
+    }
+    CHECK(consistent);
+    CHECK(next == used);
+
+    // a permutation of the used vertices
+    std::vector<uint32_t> targets;
+    for (uint32_t r : remap)
+        if (r != UnusedVertex) targets.push_back(r);
+    std::sort(targets.begin(), targets.end());
+    std::vector<uint32_t> expected(used);
+    std::iota(expected.begin(), expected.end(), 0u);
+    CHECK(targets == expected);
+
+    // the remapped vertex buffer draws the same positions
+    std::vector<XMFLOAT3> optimized(used);
+    RemapVertices(positions.data(), sizeof(XMFLOAT3), positions.size(), remap.data(), optimized.data());
+    bool same = true;
+    for (size_t i = 0; i < indices.size(); ++i)
+        same = same && memcmp(&optimized[indices[i]], &positions[original[i]], sizeof(XMFLOAT3)) == 0;
+    CHECK(same);
+}
+
+TEST_CASE(OptimizeMeshInVectors)
+{
+    struct Vertex { XMFLOAT3 position; uint32_t id; };
+    std::vector<XMFLOAT3> positions;
+    std::vector<uint16_t> indices;
+    CreateGrid(32, positions, indices);
+    Scramble(indices, 47);
+    std::vector<Vertex> vertices(positions.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        vertices[v] = Vertex{ positions[v], uint32_t(v) };
+
+    const auto before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    const auto reference = CanonicalTriangles(indices);
+    OptimizeMesh(vertices, indices);
+    const auto after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    CHECK(vertices.size() == positions.size());
+    CHECK(after.acmr < before.acmr);
+
+    // back in the original numbering through the ids carried along
+    std::vector<uint32_t> restored(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        restored[i] = vertices[indices[i]].id;
+    CHECK(CanonicalTriangles(restored) == reference);
+}
+
+TEST_CASE(RejectsBadInput)
+{
+    std::vector<uint16_t> indices = { 0, 1, 2, 2, 1, 3 };
+    const XMFLOAT3 positions[4] = {};
+    uint32_t remap[4];
+    CHECK(Throws([&] { OptimizeFaces(static_cast<uint16_t*>(nullptr), 3, 4); }));
+    CHECK(Throws([&] { OptimizeFaces(indices.data(), 5, 4); }));
+    CHECK(Throws([&] { OptimizeFaces(indices.data(), indices.size(), 3); }));
+    CHECK(Throws([&] { OptimizeFaces(indices.data(), indices.size(), 4, FaceOrder_Tipsify, MinCacheSize - 1); }));
+    CHECK(Throws([&] { OptimizeFaces(indices.data(), indices.size(), 4, FaceOrder_Forsyth, MaxCacheSize + 1); }));
+    CHECK(Throws([&] { OptimizeFaces(indices.data(), indices.size(), 4, FaceOrder(7)); }));
+    CHECK(Throws([&] { OptimizeOverdraw(indices.data(), indices.size(), nullptr, sizeof(XMFLOAT3), 4); }));
+    CHECK(Throws([&] { OptimizeOverdraw(indices.data(), indices.size(), positions, sizeof(float), 4); }));
+    CHECK(Throws([&] { OptimizeVertexFetch(indices.data(), indices.size(), 4, nullptr); }));
+    CHECK(Throws([&] { AnalyzeVertexCache(indices.data(), indices.size(), 4, 0); }));
+    CHECK(Throws([&] { RemapVertices(nullptr, 12, 4, remap, nullptr); }));
+
+    // and the buffers were left alone
+    CHECK((indices == std::vector<uint16_t>{ 0, 1, 2, 2, 1, 3 }));
+}
@@ -0,0 +1,268 @@
+﻿#include "pch.h"
+#include "MixerCore.h"
+#include "TestMain.h"
+
+#include <math.h>
+
+using namespace DirectX;
+using namespace DirectX::Mixer;
+
+namespace
+{
+    const int RATE = 8000;
+
+    inline bool Near(float a, float b, float tolerance = 1e-4f)
+    {
+        return fabsf(a - b) <= tolerance;
+    }
+
+    const uint8_t* Bytes(const std::vector<float>& samples)
+    {
+        return reinterpret_cast<const uint8_t*>(samples.data());
+    }
+
+    std::vector<float> Render(VoicePool& pool, size_t frames)
+    {
+        std::vector<float> out(frames * 2, -1.f);
+        pool.Render(out.data(), frames);
+        return out;
+    }
+
+    // hands out its data in pulls of at most m_chunk bytes (not frame multiples), none while m_stalled
+    class ScriptedSource : public StreamSource
+    {
+    public:
+        ScriptedSource(const std::vector<uint8_t>& data, size_t chunk) : m_data(data), m_chunk(chunk), m_cursor(0), m_stalled(false) {}
+
+        virtual size_t Read(uint8_t* dest, size_t maxBytes) override
+        {
+            if (m_stalled)
+                return 0;
+            const size_t count = std::min(std::min(maxBytes, m_chunk), m_data.size() - m_cursor);
+            memcpy(dest, m_data.data() + m_cursor, count);
+            m_cursor += count;
+            return count;
+        }
+
+        virtual bool IsEndOfStream() const override { return m_cursor == m_data.size(); }
+
+        std::vector<uint8_t> m_data;
+        size_t m_chunk;
+        size_t m_cursor;
+        bool m_stalled;
+    };
+
+    std::vector<uint8_t> StereoRamp(size_t frames)
+    {
+        std::vector<int16_t> samples;
+        for (size_t i = 0; i < frames; ++i)
+        {
+            samples.push_back(int16_t(i * 7));
+            samples.push_back(int16_t(-int(i) * 3));
+        }
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(samples.data());
+        return std::vector<uint8_t>(bytes, bytes + samples.size() * sizeof(int16_t));
+    }
+}
+
+TEST_CASE(SilenceWithoutVoices)
+{
+    VoicePool pool(RATE, 4);
+    const auto out = Render(pool, 1000);
+    for (float s : out)
+        CHECK(s == 0.f);
+    CHECK(pool.GetStatistics().renderedFrames == 1000);
+}
+
+TEST_CASE(FormatsAndPan)
+{
+    // a constant source of 0.5 in every format
+    const std::vector<float> f(64, 0.5f);
+    const std::vector<int16_t> s16(64, 16384);
+    const std::vector<uint8_t> s8(64, 192);
+    const uint8_t* sources[] = { reinterpret_cast<const uint8_t*>(s8.data()), reinterpret_cast<const uint8_t*>(s16.data()), Bytes(f) };
+    const SampleFormat formats[] = { SAMPLE_PCM8, SAMPLE_PCM16, SAMPLE_FLOAT };
+    for (int i = 0; i < 3; ++i)
+    {
+        VoicePool pool(RATE, 4);
+        pool.Play(formats[i], 1, RATE, sources[i], 64, 0, 0, 1.f, 0.f, 0.f, true);
+        auto out = Render(pool, 32);
+        CHECK(Near(out[20], 0.5f) && Near(out[21], 0.5f));
+
+        // mono hard left/right, ComputePan law
+        VoicePool left(RATE, 4), right(RATE, 4);
+        left.Play(formats[i], 1, RATE, sources[i], 64, 0, 0, 0.5f, 0.f, -1.f, true);
+        right.Play(formats[i], 1, RATE, sources[i], 64, 0, 0, 0.5f, 0.f, 1.f, true);
+        out = Render(left, 32);
+        CHECK(Near(out[20], 0.25f) && Near(out[21], 0.f));
+        out = Render(right, 32);
+        CHECK(Near(out[20], 0.f) && Near(out[21], 0.25f));
+    }
+
+    // stereo panned left folds half of the right channel in
+    std::vector<float> stereo;
+    for (int i = 0; i < 64; ++i) { stereo.push_back(0.25f); stereo.push_back(0.5f); }
+    VoicePool pool(RATE, 4);
+    pool.Play(SAMPLE_FLOAT, 2, RATE, Bytes(stereo), 64, 0, 0, 1.f, 0.f, -1.f, true);
+    const auto out = Render(pool, 32);
+    CHECK(Near(out[20], 0.25f * 0.5f + 0.5f * 0.5f) && Near(out[21], 0.f));
+}
+
+TEST_CASE(LoopWrapsStepsLongerThanTheLoop)
+{
+    // every source frame holds its index, the source is 8x the output rate so each output
+    // frame steps 8 source frames, longer than the 3 frame loop at [1, 4)
+    std::vector<float> ramp;
+    for (int i = 0; i < 6; ++i)
+        ramp.push_back(float(i));
+    const uint32_t loopBegin = 1, loopLength = 3, step = 8;
+
+    VoicePool pool(RATE, 4);
+    const uint32_t voice = pool.Play(SAMPLE_FLOAT, 1, RATE * step, Bytes(ramp), 6, loopBegin, loopLength, 1.f, 0.f, -1.f, true);
+    CHECK(voice != INVALID_VOICE);
+    const auto out = Render(pool, 600);
+    for (uint32_t k = 0; k < 600; ++k)
+    {
+        const uint32_t p = k * step;
+        const uint32_t expected = p < loopBegin + loopLength ? p : loopBegin + (p - loopBegin) % loopLength;
+        CHECK(out[k * 2] == float(expected));
+    }
+    CHECK(pool.IsPlaying(voice));
+}
+
+TEST_CASE(OneShotEndsAndFreesTheVoice)
+{
+    const std::vector<float> f(100, 1.f);
+    VoicePool pool(RATE, 2);
+    const uint32_t voice = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 100, 0, 0, 1.f, 0.f, -1.f, false);
+    auto out = Render(pool, 300);
+    CHECK(out[99 * 2] == 1.f);
+    CHECK(out[100 * 2] == 0.f);
+    CHECK(!pool.IsPlaying(voice));
+    CHECK(pool.GetStatistics().activeVoices == 0);
+
+    // an octave up reads it twice as fast
+    const uint32_t fast = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 100, 0, 0, 1.f, 1.f, -1.f, false);
+    out = Render(pool, 300);
+    CHECK(out[49 * 2] == 1.f);
+    CHECK(out[50 * 2] == 0.f);
+    CHECK(!pool.IsPlaying(fast));
+}
+
+TEST_CASE(VolumeChangesRampOverOneBlock)
+{
+    const std::vector<float> f(16, 1.f);
+    VoicePool pool(RATE, 2);
+    const uint32_t voice = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 16, 0, 0, 1.f, 0.f, -1.f, true);
+    Render(pool, BLOCK_FRAMES);
+    pool.SetVolume(voice, 0.f);
+    auto out = Render(pool, BLOCK_FRAMES);
+    CHECK(out[0] == 1.f);
+    for (size_t i = 1; i < BLOCK_FRAMES; ++i)
+        CHECK(out[i * 2] < out[(i - 1) * 2]);
+    out = Render(pool, BLOCK_FRAMES);
+    CHECK(out[0] == 0.f && out[(BLOCK_FRAMES - 1) * 2] == 0.f);
+
+    pool.SetVolume(voice, 1.f);
+    pool.SetMasterVolume(0.5f);
+    Render(pool, BLOCK_FRAMES);
+    out = Render(pool, BLOCK_FRAMES);
+    CHECK(Near(out[10], 0.5f));
+}
+
+TEST_CASE(HandlesAndPool)
+{
+    const std::vector<float> f(16, 1.f);
+    VoicePool pool(RATE, 2);
+    const uint32_t a = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 16, 0, 0, 1.f, 0.f, 0.f, true);
+    const uint32_t b = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 16, 0, 0, 1.f, 0.f, 0.f, true);
+    CHECK(a != INVALID_VOICE && b != INVALID_VOICE && a != b);
+    CHECK(pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 16, 0, 0, 1.f, 0.f, 0.f, true) == INVALID_VOICE);
+    CHECK(pool.GetStatistics().rejectedPlays == 1);
+    CHECK(pool.GetStatistics().peakVoices == 2);
+
+    // a stopped handle stays dead after its slot is reused
+    pool.Stop(a);
+    const uint32_t c = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 16, 0, 0, 1.f, 0.f, 0.f, true);
+    CHECK(c != a && !pool.IsPlaying(a) && pool.IsPlaying(c));
+    pool.SetVolume(a, 0.f);
+    Render(pool, 8);
+    const auto out = Render(pool, 8);
+    CHECK(Near(out[0], 2.f));
+
+    pool.Pause(b);
+    CHECK(!pool.IsPlaying(b));
+    pool.Resume(b);
+    CHECK(pool.IsPlaying(b));
+
+    // everything reading a source stops before it is freed
+    const std::vector<float> other(16, 1.f);
+    pool.Stop(c);
+    const uint32_t d = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(other), 16, 0, 0, 1.f, 0.f, 0.f, true);
+    CHECK(pool.StopSource(Bytes(f)) == 1);
+    CHECK(!pool.IsPlaying(b) && pool.IsPlaying(d));
+    pool.StopAll();
+    CHECK(pool.GetStatistics().activeVoices == 0);
+}
+
+TEST_CASE(NullSinkAdvancesVoices)
+{
+    const std::vector<float> f(100, 1.f);
+    VoicePool pool(RATE, 2);
+    const uint32_t voice = pool.Play(SAMPLE_FLOAT, 1, RATE, Bytes(f), 100, 0, 0, 1.f, 0.f, 0.f, false);
+    pool.Render(nullptr, 99);
+    CHECK(pool.IsPlaying(voice));
+    pool.Render(nullptr, 2);
+    CHECK(!pool.IsPlaying(voice));
+}
+
+TEST_CASE(StreamedVoiceMatchesInMemory)
+{
+    // 3/4 pitch so frames are interpolated across pull boundaries
+    const size_t FRAMES = 5000;
+    const auto data = StereoRamp(FRAMES);
+    const size_t chunks[] = { 1, 333, STREAM_STAGING_BYTES * 2 };
+    for (size_t chunk : chunks)
+    {
+        VoicePool memory(RATE, 2), streamed(RATE, 2);
+        ScriptedSource source(data, chunk);
+        memory.Play(SAMPLE_PCM16, 2, RATE, data.data(), FRAMES, 0, 0, 1.f, -0.415f, 0.3f, false);
+        const uint32_t voice = streamed.PlayStream(SAMPLE_PCM16, 2, RATE, &source, 1.f, -0.415f, 0.3f);
+        CHECK(voice != INVALID_VOICE);
+
+        const auto expected = Render(memory, FRAMES * 2);
+        const auto out = Render(streamed, FRAMES * 2);
+        bool same = true;
+        for (size_t i = 0; i < out.size(); ++i)
+            same = same && Near(out[i], expected[i], 1e-6f);
+        CHECK(same);
+        CHECK(!streamed.IsPlaying(voice));
+        CHECK(streamed.GetStatistics().streamUnderruns == 0);
+    }
+}
+
+TEST_CASE(StreamUnderrunPadsWithSilence)
+{
+    std::vector<float> ones(4096, 1.f);
+    ScriptedSource source(std::vector<uint8_t>(Bytes(ones), Bytes(ones) + ones.size() * sizeof(float)), 1024);
+    VoicePool pool(RATE, 2);
+    const uint32_t voice = pool.PlayStream(SAMPLE_FLOAT, 1, RATE, &source, 1.f, 0.f, -1.f);
+    auto out = Render(pool, 64);
+    CHECK(out[0] == 1.f && out[63 * 2] == 1.f);
+
+    // the voice keeps its place while the source has nothing and picks up where it left off
+    // (the last frame pulled waits for the next one to interpolate towards)
+    source.m_stalled = true;
+    const size_t staged = source.m_cursor / sizeof(float) - 64;
+    out = Render(pool, staged + BLOCK_FRAMES);
+    CHECK(out[(staged - 2) * 2] == 1.f);
+    CHECK(out[(staged - 1) * 2] == 0.f && out[(staged + 10) * 2] == 0.f);
+    CHECK(pool.IsPlaying(voice));
+    CHECK(pool.GetStatistics().streamUnderruns >= 1);
+
+    source.m_stalled = false;
+    out = Render(pool, 64);
+    CHECK(out[0] == 1.f);
+    pool.Render(nullptr, 8192);
+    CHECK(!pool.IsPlaying(voice));
+}
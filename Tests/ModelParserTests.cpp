@@ -0,0 +1,453 @@
+﻿#include "pch.h"
+#include "ModelParser.h"
+#include "TestMain.h"
+
+#include <DirectXMath.h>
+#include <dxgiformat.h>
+#include <functional>
+#include <random>
+#include <string>
+
+#include "SDKMesh.h"
+#include "CMO.h"
+#include "vbo.h"
+
+using namespace DirectX;
+
+namespace
+{
+    template<typename T>
+    void Append(std::vector<uint8_t>& file, const T* data, size_t count)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        file.insert(file.end(), bytes, bytes + sizeof(T) * count);
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& file, const T& value) { Append(file, &value, 1); }
+
+    void AppendCMOString(std::vector<uint8_t>& file, const char* str)
+    {
+        const uint32_t length = uint32_t(strlen(str));
+        Append(file, length);
+        for (uint32_t i = 0; i < length; ++i)
+            Append(file, uint16_t(str[i]));
+    }
+
+    // vertex bytes are a function of their position, so misplaced views show
+    void AppendVertices(std::vector<uint8_t>& file, size_t count, size_t stride)
+    {
+        for (size_t i = 0; i < count * stride; ++i)
+            file.push_back(uint8_t(i * 13));
+    }
+
+    const uint16_t QUAD[] = { 0, 1, 2, 2, 1, 3 };
+
+    std::vector<uint8_t> BuildVBO()
+    {
+        std::vector<uint8_t> file;
+        Append(file, 4u);
+        Append(file, 6u);
+        AppendVertices(file, 4, VBO::VERTEX_SIZE);
+        Append(file, QUAD, 6);
+        return file;
+    }
+
+    // two meshes, the first skinned and with a skeleton so the parser has to skip its bones and clips
+    std::vector<uint8_t> BuildCMO()
+    {
+        VSD3DStarter::Material material = {};
+        material.SpecularPower = 16.0f;
+        VSD3DStarter::SubMesh submesh = { 0, 0, 0, 0, 2 };
+        VSD3DStarter::MeshExtents extents = {};
+        extents.Radius = 1.0f;
+
+        std::vector<uint8_t> file;
+        Append(file, 2u);
+        for (uint32_t mesh = 0; mesh < 2; ++mesh)
+        {
+            const bool skinned = mesh == 0;
+            AppendCMOString(file, skinned ? "body" : "hat");
+            Append(file, 1u);
+            AppendCMOString(file, "material");
+            Append(file, material);
+            AppendCMOString(file, "ps");
+            for (uint32_t t = 0; t < VSD3DStarter::MAX_TEXTURE; ++t)
+                AppendCMOString(file, t ? "" : "diffuse.dds");
+            Append(file, uint8_t(skinned ? 1 : 0));
+            Append(file, 1u);
+            Append(file, submesh);
+            Append(file, 1u);
+            Append(file, 6u);
+            Append(file, QUAD, 6);
+            Append(file, 1u);
+            Append(file, 4u);
+            AppendVertices(file, 4, VSD3DStarter::VERTEX_SIZE);
+            Append(file, skinned ? 1u : 0u);
+            if (skinned)
+            {
+                Append(file, 4u);
+                const VSD3DStarter::SkinningVertex skin = { { 0, 0, 0, 0 }, { 1.0f, 0.0f, 0.0f, 0.0f } };
+                for (int v = 0; v < 4; ++v)
+                    Append(file, skin);
+            }
+            Append(file, extents);
+            if (skinned)
+            {
+                const VSD3DStarter::Bone bone = {};
+                const VSD3DStarter::Clip clip = { 0.0f, 1.0f, 2 };
+                const VSD3DStarter::Keyframe key = {};
+                Append(file, 1u);
+                AppendCMOString(file, "root");
+                Append(file, bone);
+                Append(file, 1u);
+                AppendCMOString(file, "idle");
+                Append(file, clip);
+                Append(file, key);
+                Append(file, key);
+            }
+        }
+        return file;
+    }
+
+    // two meshes sharing one vertex buffer and one 16 bit index buffer, one subset each
+    std::vector<uint8_t> BuildSDKMESH()
+    {
+        using namespace DXUT;
+        const uint32_t MESHES = 2;
+        const uint64_t VB_BYTES = 4 * VBO::VERTEX_SIZE, IB_BYTES = sizeof(QUAD);
+
+        SDKMESH_HEADER header = {};
+        header.Version = SDKMESH_FILE_VERSION;
+        header.NumVertexBuffers = 1;
+        header.NumIndexBuffers = 1;
+        header.NumMeshes = MESHES;
+        header.NumTotalSubsets = MESHES;
+        header.NumFrames = 1;
+        header.NumMaterials = 1;
+        header.HeaderSize = sizeof(SDKMESH_HEADER) + sizeof(SDKMESH_VERTEX_BUFFER_HEADER) + sizeof(SDKMESH_INDEX_BUFFER_HEADER);
+        header.VertexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
+        header.IndexStreamHeadersOffset = header.VertexStreamHeadersOffset + sizeof(SDKMESH_VERTEX_BUFFER_HEADER);
+        header.MeshDataOffset = header.HeaderSize;
+        header.SubsetDataOffset = header.MeshDataOffset + sizeof(SDKMESH_MESH) * MESHES;
+        header.FrameDataOffset = header.SubsetDataOffset + sizeof(SDKMESH_SUBSET) * MESHES;
+        header.MaterialDataOffset = header.FrameDataOffset + sizeof(SDKMESH_FRAME);
+        const uint64_t subsetIndexOffset = header.MaterialDataOffset + sizeof(SDKMESH_MATERIAL);
+        header.NonBufferDataSize = subsetIndexOffset + sizeof(uint32_t) * MESHES - header.HeaderSize;
+        const uint64_t bufferDataOffset = header.HeaderSize + header.NonBufferDataSize;
+        header.BufferDataSize = VB_BYTES + IB_BYTES;
+
+        SDKMESH_VERTEX_BUFFER_HEADER vb = {};
+        vb.NumVertices = 4;
+        vb.SizeBytes = VB_BYTES;
+        vb.StrideBytes = VBO::VERTEX_SIZE;
+        vb.DataOffset = bufferDataOffset;
+
+        SDKMESH_INDEX_BUFFER_HEADER ib = {};
+        ib.NumIndices = 6;
+        ib.SizeBytes = IB_BYTES;
+        ib.IndexType = IT_16BIT;
+        ib.DataOffset = bufferDataOffset + VB_BYTES;
+
+        std::vector<uint8_t> file;
+        Append(file, header);
+        Append(file, vb);
+        Append(file, ib);
+        for (uint32_t mesh = 0; mesh < MESHES; ++mesh)
+        {
+            SDKMESH_MESH mh = {};
+            mh.NumVertexBuffers = 1;
+            mh.NumSubsets = 1;
+            mh.SubsetOffset = subsetIndexOffset + sizeof(uint32_t) * mesh;
+            Append(file, mh);
+        }
+        for (uint32_t mesh = 0; mesh < MESHES; ++mesh)
+        {
+            SDKMESH_SUBSET subset = {};
+            subset.PrimitiveType = PT_TRIANGLE_LIST;
+            subset.IndexStart = 3 * mesh;
+            subset.IndexCount = 3;
+            subset.VertexCount = 4;
+            Append(file, subset);
+        }
+        Append(file, SDKMESH_FRAME());
+        Append(file, SDKMESH_MATERIAL());
+        for (uint32_t mesh = 0; mesh < MESHES; ++mesh)
+            Append(file, mesh);
+        AppendVertices(file, 4, VBO::VERTEX_SIZE);
+        Append(file, QUAD, 6);
+        return file;
+    }
+
+    bool ViewInside(const uint8_t* data, size_t size, const void* view, uint64_t bytes)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(view);
+        return p >= data && p <= data + size && bytes <= uint64_t(data + size - p);
+    }
+
+    // Each parses a file and checks every view it hands out, the parser throws on the ones it rejects
+    typedef std::function<bool(const uint8_t*, size_t)> ModelParse;
+
+    bool ParseVBOFile(const uint8_t* data, size_t size)
+    {
+        VBOModelInfo info;
+        ParseVBO(data, size, info);
+        return ViewInside(data, size, info.vertices, uint64_t(info.vertexCount) * VBO::VERTEX_SIZE)
+            && ViewInside(data, size, info.indices, uint64_t(info.indexCount) * sizeof(uint16_t));
+    }
+
+    bool ParseCMOFile(const uint8_t* data, size_t size)
+    {
+        std::vector<CMOMeshInfo> meshes;
+        ParseCMO(data, size, meshes);
+        bool inside = true;
+        for (const auto& mesh : meshes)
+        {
+            inside = inside && ViewInside(data, size, mesh.name.chars, uint64_t(mesh.name.length) * sizeof(uint16_t))
+                && ViewInside(data, size, mesh.submeshes, uint64_t(mesh.submeshCount) * sizeof(VSD3DStarter::SubMesh))
+                && ViewInside(data, size, mesh.extents, sizeof(VSD3DStarter::MeshExtents));
+            for (const auto& material : mesh.materials)
+            {
+                inside = inside && ViewInside(data, size, material.material, sizeof(VSD3DStarter::Material));
+                for (const auto& texture : material.textures)
+                    inside = inside && ViewInside(data, size, texture.chars, uint64_t(texture.length) * sizeof(uint16_t));
+            }
+            for (const auto& ib : mesh.indexBuffers)
+                inside = inside && ViewInside(data, size, ib.indices, uint64_t(ib.indexCount) * sizeof(uint16_t));
+            for (const auto& vb : mesh.vertexBuffers)
+            {
+                inside = inside && ViewInside(data, size, vb.vertices, uint64_t(vb.vertexCount) * VSD3DStarter::VERTEX_SIZE);
+                if (vb.skinning)
+                    inside = inside && ViewInside(data, size, vb.skinning, uint64_t(vb.vertexCount) * sizeof(VSD3DStarter::SkinningVertex));
+            }
+        }
+        return inside;
+    }
+
+    bool ParseSDKMESHFile(const uint8_t* data, size_t size)
+    {
+        SDKMESHModelInfo info;
+        ParseSDKMESH(data, size, info);
+        const auto& header = *info.header;
+        bool inside = ViewInside(data, size, info.meshes, uint64_t(header.NumMeshes) * sizeof(DXUT::SDKMESH_MESH))
+            && ViewInside(data, size, info.subsets, uint64_t(header.NumTotalSubsets) * sizeof(DXUT::SDKMESH_SUBSET))
+            && ViewInside(data, size, info.frames, uint64_t(header.NumFrames) * sizeof(DXUT::SDKMESH_FRAME))
+            && ViewInside(data, size, info.materials, uint64_t(header.NumMaterials) * sizeof(DXUT::SDKMESH_MATERIAL));
+        for (uint32_t j = 0; j < header.NumVertexBuffers; ++j)
+            inside = inside && ViewInside(data, size, info.vertexData[j], info.vertexBuffers[j].SizeBytes);
+        for (uint32_t j = 0; j < header.NumIndexBuffers; ++j)
+            inside = inside && ViewInside(data, size, info.indexData[j], info.indexBuffers[j].SizeBytes);
+        for (uint32_t j = 0; j < header.NumMeshes; ++j)
+            inside = inside && ViewInside(data, size, info.meshSubsets[j], uint64_t(info.meshes[j].NumSubsets) * sizeof(uint32_t));
+        return inside;
+    }
+
+    // the message of the runtime_error a parse throws, empty when it accepts the file
+    std::string Rejection(const ModelParse& parse, const std::vector<uint8_t>& file)
+    {
+        try
+        {
+            parse(file.data(), file.size());
+        }
+        catch (const std::runtime_error& e)
+        {
+            return e.what();
+        }
+        return std::string();
+    }
+
+    template<typename T>
+    void Poke(std::vector<uint8_t>& file, size_t offset, T value) { memcpy(file.data() + offset, &value, sizeof(value)); }
+}
+
+TEST_CASE(ParsesVBO)
+{
+    const auto file = BuildVBO();
+    VBOModelInfo info;
+    ParseVBO(file.data(), file.size(), info);
+    CHECK(info.vertexCount == 4 && info.indexCount == 6);
+    CHECK(info.vertices == file.data() + sizeof(VBO::header_t));
+    CHECK(reinterpret_cast<const uint8_t*>(info.indices) == file.data() + sizeof(VBO::header_t) + 4 * VBO::VERTEX_SIZE);
+    CHECK(memcmp(info.indices, QUAD, sizeof(QUAD)) == 0);
+}
+
+TEST_CASE(ParsesCMO)
+{
+    const auto file = BuildCMO();
+    std::vector<CMOMeshInfo> meshes;
+    ParseCMO(file.data(), file.size(), meshes);
+    CHECK(meshes.size() == 2);
+    CHECK(meshes[0].name.length == 4 && meshes[0].name.chars[0] == 'b');
+    CHECK(meshes[0].skinning && meshes[0].hasSkeleton);
+    CHECK(!meshes[1].skinning && !meshes[1].hasSkeleton);
+    for (const auto& mesh : meshes)
+    {
+        CHECK(mesh.materials.size() == 1 && mesh.materials[0].textures[0].length == 11 && mesh.materials[0].textures[1].length == 0);
+        CHECK(mesh.submeshCount == 1);
+        CHECK(mesh.indexBuffers.size() == 1 && mesh.indexBuffers[0].indexCount == 6);
+        CHECK(mesh.vertexBuffers.size() == 1 && mesh.vertexBuffers[0].vertexCount == 4);
+        CHECK((mesh.vertexBuffers[0].skinning != nullptr) == mesh.skinning);
+        CHECK(memcmp(mesh.indexBuffers[0].indices, QUAD, sizeof(QUAD)) == 0);
+    }
+    // the second mesh starts after the first mesh's animation data
+    CHECK(meshes[1].name.chars > reinterpret_cast<const uint16_t*>(meshes[0].extents + 1));
+    CHECK(reinterpret_cast<const uint8_t*>(meshes[1].extents + 1) == file.data() + file.size());
+    CHECK(ParseCMOFile(file.data(), file.size()));
+}
+
+TEST_CASE(ParsesSDKMESH)
+{
+    const auto file = BuildSDKMESH();
+    SDKMESHModelInfo info;
+    ParseSDKMESH(file.data(), file.size(), info);
+    CHECK(info.header == reinterpret_cast<const DXUT::SDKMESH_HEADER*>(file.data()));
+    CHECK(info.vertexData.size() == 1 && info.indexData.size() == 1 && info.meshSubsets.size() == 2);
+    CHECK(info.indexData[0] + sizeof(QUAD) == file.data() + file.size());
+    CHECK(memcmp(info.indexData[0], QUAD, sizeof(QUAD)) == 0);
+    CHECK(info.vertexData[0] + 4 * VBO::VERTEX_SIZE == info.indexData[0]);
+    CHECK(info.meshSubsets[1][0] == 1);
+    CHECK(ParseSDKMESHFile(file.data(), file.size()));
+}
+
+TEST_CASE(RejectsEveryTruncation)
+{
+    const std::pair<ModelParse, std::vector<uint8_t>> models[] =
+    {
+        { ParseVBOFile, BuildVBO() },
+        { ParseCMOFile, BuildCMO() },
+        { ParseSDKMESHFile, BuildSDKMESH() },
+    };
+    for (const auto& model : models)
+    {
+        bool rejected = true;
+        for (size_t size = 0; size < model.second.size(); ++size)
+        {
+            // an exact size copy, so a read past the end is a read past the allocation
+            const std::vector<uint8_t> prefix(model.second.begin(), model.second.begin() + size);
+            rejected = rejected && !Rejection(model.first, prefix).empty();
+        }
+        CHECK(rejected);
+        CHECK(Rejection(model.first, model.second).empty());
+    }
+
+    VBOModelInfo vbo;
+    bool threw = false;
+    try { ParseVBO(nullptr, 100, vbo); }
+    catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+}
+
+TEST_CASE(RejectsBadTables)
+{
+    // VBO counts
+    auto file = BuildVBO();
+    Poke(file, 0, 0u);
+    CHECK(Rejection(ParseVBOFile, file) == "No vertices or indices found");
+    file = BuildVBO();
+    Poke(file, 0, 0xffffffffu);
+    CHECK(Rejection(ParseVBOFile, file) == "End of file");
+
+    // SDKMESH header and tables
+    using namespace DXUT;
+    const auto sdkmesh = BuildSDKMESH();
+    const auto& header = *reinterpret_cast<const SDKMESH_HEADER*>(sdkmesh.data());
+    file = sdkmesh;
+    Poke(file, offsetof(SDKMESH_HEADER, Version), 100u);
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Not a supported SDKMESH version");
+    file = sdkmesh;
+    Poke(file, offsetof(SDKMESH_HEADER, NumVertexBuffers), 2u);
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Not a valid SDKMESH file");
+    file = sdkmesh;
+    Poke(file, offsetof(SDKMESH_HEADER, MaterialDataOffset), uint64_t(sdkmesh.size()));
+    CHECK(Rejection(ParseSDKMESHFile, file) == "End of file");
+    file = sdkmesh;
+    Poke(file, size_t(header.IndexStreamHeadersOffset) + offsetof(SDKMESH_INDEX_BUFFER_HEADER, IndexType), 7u);
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Invalid index buffer type found");
+
+    const size_t subset1 = size_t(header.SubsetDataOffset) + sizeof(SDKMESH_SUBSET);
+    file = sdkmesh;
+    Poke(file, subset1 + offsetof(SDKMESH_SUBSET, IndexCount), uint64_t(4));
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Invalid mesh found");
+    file = sdkmesh;
+    Poke(file, subset1 + offsetof(SDKMESH_SUBSET, IndexStart), uint64_t(-1));
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Invalid mesh found");
+    file = sdkmesh;
+    Poke(file, subset1 + offsetof(SDKMESH_SUBSET, PrimitiveType), uint32_t(PT_QUAD_PATCH_LIST));
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Direct3D9 era tessellation not supported");
+    file = sdkmesh;
+    Poke(file, size_t(header.MeshDataOffset) + offsetof(SDKMESH_MESH, IndexBuffer), 1u);
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Invalid mesh found");
+    file = sdkmesh;
+    Poke(file, size_t(header.HeaderSize + header.NonBufferDataSize) - sizeof(uint32_t), 2u);
+    CHECK(Rejection(ParseSDKMESHFile, file) == "Invalid mesh found");
+
+    // CMO counts
+    const auto cmo = BuildCMO();
+    file = cmo;
+    Poke(file, 0, 0x10000000u);
+    CHECK(Rejection(ParseCMOFile, file) == "End of file");
+    file = cmo;
+    Poke(file, sizeof(uint32_t), 0x7fffffffu);
+    CHECK(Rejection(ParseCMOFile, file) == "End of file");
+
+    std::vector<CMOMeshInfo> meshes;
+    ParseCMO(cmo.data(), cmo.size(), meshes);
+    const size_t submesh = reinterpret_cast<const uint8_t*>(meshes[1].submeshes) - cmo.data();
+    file = cmo;
+    Poke(file, submesh + offsetof(VSD3DStarter::SubMesh, PrimCount), 3u);
+    CHECK(Rejection(ParseCMOFile, file) == "Invalid submesh found\n");
+    file = cmo;
+    Poke(file, submesh + offsetof(VSD3DStarter::SubMesh, VertexBufferIndex), 1u);
+    CHECK(Rejection(ParseCMOFile, file) == "Invalid submesh found\n");
+    file = cmo;
+    const size_t skinCount = reinterpret_cast<const uint8_t*>(meshes[0].vertexBuffers[0].skinning) - cmo.data() - sizeof(uint32_t);
+    Poke(file, skinCount, 3u);
+    CHECK(Rejection(ParseCMOFile, file) == "Mismatched number of verts for skin VBs");
+}
+
+TEST_CASE(MutatedFilesStayInside)
+{
+    const std::pair<ModelParse, std::vector<uint8_t>> models[] =
+    {
+        { ParseVBOFile, BuildVBO() },
+        { ParseCMOFile, BuildCMO() },
+        { ParseSDKMESHFile, BuildSDKMESH() },
+    };
+
+    // bit flips, small and boundary values over the whole file, plus truncations
+    std::mt19937 rng(4321);
+    auto get = [&](uint32_t lo, uint32_t hi) { return std::uniform_int_distribution<uint32_t>(lo, hi)(rng); };
+    const size_t MUTATIONS = 30000;
+    size_t accepted = 0;
+    bool inside = true;
+    for (size_t i = 0; i < MUTATIONS; ++i)
+    {
+        const auto& model = models[i % 3];
+        std::vector<uint8_t> file = model.second;
+        size_t size = file.size();
+        for (uint32_t m = get(1, 3); m > 0; --m)
+        {
+            const uint32_t at = get(0, uint32_t(file.size()) - 8) & ~3u;
+            switch (get(0, 3))
+            {
+            case 0: file[at + get(0, 3)] ^= uint8_t(1 << get(0, 7)); break;
+            case 1: Poke(file, at, get(0, 1) ? get(0, 4096) : 0xffffffffu >> get(0, 31)); break;
+            case 2: Poke(file, at, uint64_t(get(0, 1) ? get(0, 4096) : 0xffffffffu) << (get(0, 1) * 32)); break;
+            case 3: size = get(0, uint32_t(size)); break;
+            }
+        }
+        // an exact size copy, so a read past the end is a read past the allocation
+        const std::vector<uint8_t> mutated(file.begin(), file.begin() + size);
+
+        try
+        {
+            inside = inside && model.first(mutated.data(), mutated.size());
+            ++accepted;
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+    }
+    CHECK(inside);
+    CHECK(accepted > 0 && accepted < MUTATIONS);
+}
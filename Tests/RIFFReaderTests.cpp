@@ -0,0 +1,286 @@
+﻿#include "pch.h"
+#include "RIFFReader.h"
+#include "TestMain.h"
+
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::RIFF;
+
+namespace
+{
+    void Append(std::vector<uint8_t>& out, const void* data, size_t bytes)
+    {
+        out.insert(out.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + bytes);
+    }
+
+    void AppendU32(std::vector<uint8_t>& out, uint32_t v)
+    {
+        Append(out, &v, sizeof(v));
+    }
+
+    void AppendChunk(std::vector<uint8_t>& out, uint32_t tag, const void* data, uint32_t bytes)
+    {
+        AppendU32(out, tag);
+        AppendU32(out, bytes);
+        Append(out, data, bytes);
+    }
+
+    // RIFF header around the chunks, its size from the chunks
+    std::vector<uint8_t> MakeRiff(uint32_t type, const std::vector<uint8_t>& chunks)
+    {
+        std::vector<uint8_t> file;
+        AppendU32(file, FOURCC_RIFF_TAG);
+        AppendU32(file, uint32_t(sizeof(uint32_t) + chunks.size()));
+        AppendU32(file, type);
+        Append(file, chunks.data(), chunks.size());
+        return file;
+    }
+
+    std::vector<uint8_t> Samples(uint32_t bytes)
+    {
+        std::vector<uint8_t> data(bytes);
+        for (uint32_t i = 0; i < bytes; ++i)
+            data[i] = uint8_t(i * 13);
+        return data;
+    }
+
+    // 16-bit stereo 22KHz, with the short PCMWAVEFORMAT fmt chunk like most tools write
+    std::vector<uint8_t> MakePcm(uint32_t dataBytes, const std::vector<uint8_t>& extraChunks = std::vector<uint8_t>())
+    {
+        PCMWAVEFORMAT pcm = {};
+        pcm.wf.wFormatTag = WAVE_FORMAT_PCM;
+        pcm.wf.nChannels = 2;
+        pcm.wf.nSamplesPerSec = 22050;
+        pcm.wf.nBlockAlign = 4;
+        pcm.wf.nAvgBytesPerSec = 22050 * 4;
+        pcm.wBitsPerSample = 16;
+        std::vector<uint8_t> chunks;
+        AppendChunk(chunks, FOURCC_FORMAT_TAG, &pcm, sizeof(pcm));
+        Append(chunks, extraChunks.data(), extraChunks.size());
+        const auto samples = Samples(dataBytes);
+        AppendChunk(chunks, FOURCC_DATA_TAG, samples.data(), dataBytes);
+        return MakeRiff(FOURCC_WAVE_FILE_TAG, chunks);
+    }
+
+    std::vector<uint8_t> MakeAdpcm(uint16_t extraBytes)
+    {
+        static const int16_t COEF1[] = { 256, 512, 0, 192, 240, 460, 392 };
+        static const int16_t COEF2[] = { 0, -256, 0, 64, 0, -208, -232 };
+        std::vector<uint8_t> fmt;
+        WAVEFORMATEX wfx = {};
+        wfx.wFormatTag = WAVE_FORMAT_ADPCM;
+        wfx.nChannels = 1;
+        wfx.nSamplesPerSec = 22050;
+        wfx.nBlockAlign = 512;
+        wfx.nAvgBytesPerSec = 11100;
+        wfx.wBitsPerSample = 4;
+        wfx.cbSize = extraBytes;
+        Append(fmt, &wfx, sizeof(wfx));
+        const uint16_t samplesPerBlock = 1012, coefs = 7;
+        Append(fmt, &samplesPerBlock, 2);
+        Append(fmt, &coefs, 2);
+        for (int i = 0; i < 7; ++i)
+        {
+            Append(fmt, &COEF1[i], 2);
+            Append(fmt, &COEF2[i], 2);
+        }
+        fmt.resize(sizeof(WAVEFORMATEX) + extraBytes);
+
+        std::vector<uint8_t> chunks;
+        AppendChunk(chunks, FOURCC_FORMAT_TAG, fmt.data(), uint32_t(fmt.size()));
+        const auto samples = Samples(1024);
+        AppendChunk(chunks, FOURCC_DATA_TAG, samples.data(), 1024);
+        return MakeRiff(FOURCC_WAVE_FILE_TAG, chunks);
+    }
+
+    // xWMA: WMA2 format, the packet table and the data
+    std::vector<uint8_t> MakeXwma(uint32_t tableBytes)
+    {
+        WAVEFORMATEX wfx = {};
+        wfx.wFormatTag = WAVE_FORMAT_WMAUDIO2;
+        wfx.nChannels = 2;
+        wfx.nSamplesPerSec = 44100;
+        wfx.nAvgBytesPerSec = 6000;
+        wfx.nBlockAlign = 2230;
+        wfx.wBitsPerSample = 16;
+        std::vector<uint8_t> chunks;
+        AppendChunk(chunks, FOURCC_FORMAT_TAG, &wfx, sizeof(wfx));
+        const uint32_t table[] = { 4096, 8192, 12288 };
+        std::vector<uint8_t> tableBytesData(tableBytes);
+        memcpy(tableBytesData.data(), table, std::min<size_t>(tableBytes, sizeof(table)));
+        AppendChunk(chunks, FOURCC_XWMA_DPDS, tableBytesData.data(), tableBytes);
+        const auto samples = Samples(2230 * 3);
+        AppendChunk(chunks, FOURCC_DATA_TAG, samples.data(), uint32_t(samples.size()));
+        return MakeRiff(FOURCC_XWMA_FILE_TAG, chunks);
+    }
+
+    HRESULT Parse(const std::vector<uint8_t>& file, size_t size, const WAVEFORMATEX** wfx, const uint8_t** data, uint32_t* dataSize, bool& dpds, bool& seek)
+    {
+        return WaveFindFormatAndData(file.data(), size, wfx, data, dataSize, dpds, seek);
+    }
+
+    HRESULT Parse(const std::vector<uint8_t>& file, size_t size)
+    {
+        const WAVEFORMATEX* wfx = nullptr;
+        const uint8_t* data = nullptr;
+        uint32_t dataSize = 0;
+        bool dpds, seek;
+        return Parse(file, size, &wfx, &data, &dataSize, dpds, seek);
+    }
+
+    void SetU32(std::vector<uint8_t>& file, size_t offset, uint32_t v)
+    {
+        memcpy(&file[offset], &v, sizeof(v));
+    }
+}
+
+TEST_CASE(FindsPcmFormatAndData)
+{
+    const auto file = MakePcm(400);
+    const WAVEFORMATEX* wfx = nullptr;
+    const uint8_t* data = nullptr;
+    uint32_t dataSize = 0;
+    bool dpds = true, seek = true;
+    CHECK(Parse(file, file.size(), &wfx, &data, &dataSize, dpds, seek) == S_OK);
+    CHECK(wfx && wfx->wFormatTag == WAVE_FORMAT_PCM && wfx->nChannels == 2 && wfx->nSamplesPerSec == 22050);
+    CHECK(dataSize == 400 && data == file.data() + file.size() - 400);
+    CHECK(data[1] == 13 && data[399] == uint8_t(399 * 13));
+    CHECK(!dpds && !seek);
+
+    uint32_t loopStart = 1, loopLength = 1;
+    CHECK(WaveFindLoopInfo(file.data(), file.size(), &loopStart, &loopLength) == S_OK);
+    CHECK(loopStart == 0 && loopLength == 0);
+}
+
+TEST_CASE(FindsAdpcmFormat)
+{
+    const auto file = MakeAdpcm(32);
+    const WAVEFORMATEX* wfx = nullptr;
+    const uint8_t* data = nullptr;
+    uint32_t dataSize = 0;
+    bool dpds, seek;
+    CHECK(Parse(file, file.size(), &wfx, &data, &dataSize, dpds, seek) == S_OK);
+    CHECK(wfx->wFormatTag == WAVE_FORMAT_ADPCM && dataSize == 1024);
+    const auto adpcm = reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx);
+    CHECK(adpcm->wSamplesPerBlock == 1012 && adpcm->wNumCoef == 7);
+    CHECK(adpcm->aCoef[1].iCoef1 == 512 && adpcm->aCoef[6].iCoef2 == -232);
+
+    // without the coefficient table it isn't MS-ADPCM
+    const auto shortFmt = MakeAdpcm(4);
+    CHECK(Parse(shortFmt, shortFmt.size()) == E_FAIL);
+}
+
+TEST_CASE(FindsXwmaAndItsPacketTable)
+{
+    const auto file = MakeXwma(12);
+    const WAVEFORMATEX* wfx = nullptr;
+    const uint8_t* data = nullptr;
+    uint32_t dataSize = 0;
+    bool dpds = false, seek = true;
+    CHECK(Parse(file, file.size(), &wfx, &data, &dataSize, dpds, seek) == S_OK);
+    CHECK(wfx->wFormatTag == WAVE_FORMAT_WMAUDIO2 && dataSize == 2230 * 3);
+    CHECK(dpds && !seek);
+
+    const uint32_t* table = nullptr;
+    uint32_t count = 0;
+    CHECK(WaveFindTable(file.data(), file.size(), FOURCC_XWMA_DPDS, &table, &count) == S_OK);
+    CHECK(count == 3 && table[0] == 4096 && table[2] == 12288);
+    CHECK(WaveFindTable(file.data(), file.size(), FOURCC_XMA_SEEK, &table, &count) == S_OK);
+    CHECK(!table && count == 0);
+
+    // xWMA has no loops, a table of partial entries is corrupt
+    uint32_t loopStart = 1, loopLength = 1;
+    CHECK(WaveFindLoopInfo(file.data(), file.size(), &loopStart, &loopLength) == S_OK && loopLength == 0);
+    const auto ragged = MakeXwma(10);
+    CHECK(WaveFindTable(ragged.data(), ragged.size(), FOURCC_XWMA_DPDS, &table, &count) == E_FAIL);
+}
+
+TEST_CASE(FindsLoops)
+{
+    // 'smpl' with a backward loop first, then a forward one over samples [100, 299]
+    std::vector<uint8_t> smpl(36, 0);
+    SetU32(smpl, 28, 2); // loopCount
+    const uint32_t backward[6] = { 0, 2, 10, 20, 0, 0 }, forward[6] = { 1, 0, 100, 299, 0, 0 };
+    Append(smpl, backward, sizeof(backward));
+    Append(smpl, forward, sizeof(forward));
+    std::vector<uint8_t> chunks;
+    AppendChunk(chunks, FOURCC_MIDI_SAMPLE, smpl.data(), uint32_t(smpl.size()));
+    auto file = MakePcm(64, chunks);
+    uint32_t loopStart = 0, loopLength = 0;
+    CHECK(WaveFindLoopInfo(file.data(), file.size(), &loopStart, &loopLength) == S_OK);
+    CHECK(loopStart == 100 && loopLength == 200);
+
+    // 'wsmp' (DLS) carries start and length as is
+    std::vector<uint8_t> wsmp(20, 0);
+    SetU32(wsmp, 0, 20);  // header size
+    SetU32(wsmp, 16, 1);  // loopCount
+    const uint32_t dlsLoop[4] = { 16, 0, 48, 512 };
+    Append(wsmp, dlsLoop, sizeof(dlsLoop));
+    chunks.clear();
+    AppendChunk(chunks, FOURCC_DLS_SAMPLE, wsmp.data(), uint32_t(wsmp.size()));
+    file = MakePcm(64, chunks);
+    CHECK(WaveFindLoopInfo(file.data(), file.size(), &loopStart, &loopLength) == S_OK);
+    CHECK(loopStart == 48 && loopLength == 512);
+
+    // more loops declared than the chunk holds: no loop, no overread
+    SetU32(file, file.size() - 64 - 8 - 16 - 4, 1000);
+    CHECK(WaveFindLoopInfo(file.data(), file.size(), &loopStart, &loopLength) == S_OK);
+    CHECK(loopStart == 0 && loopLength == 0);
+}
+
+TEST_CASE(TruncatedFilesFail)
+{
+    const auto file = MakePcm(400);
+    // in the data, in the data chunk header, in the fmt chunk, in the RIFF header
+    CHECK(Parse(file, file.size() - 1) == HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+    CHECK(FAILED(Parse(file, file.size() - 400 - 4)));
+    CHECK(FAILED(Parse(file, 12 + 8 + 10)));
+    CHECK(Parse(file, 8) == E_FAIL);
+    CHECK(Parse(file, 0) == E_FAIL);
+
+    // every prefix fails cleanly, none reads past its end (run under a sanitizer to see it)
+    bool allFail = true;
+    for (size_t size = 0; size < file.size(); ++size)
+    {
+        std::vector<uint8_t> prefix(file.begin(), file.begin() + size);
+        allFail = allFail && FAILED(Parse(prefix, prefix.size()));
+    }
+    CHECK(allFail);
+}
+
+TEST_CASE(OversizedChunksFail)
+{
+    // a chunk claiming 4GB before 'fmt ' stops the walk instead of wrapping the offset
+    std::vector<uint8_t> chunks;
+    AppendChunk(chunks, 'KNUJ', "abcd", 4);
+    auto file = MakePcm(64, chunks);
+    CHECK(Parse(file, file.size()) == S_OK);
+    SetU32(file, 12 + 8 + sizeof(PCMWAVEFORMAT) + 4, 0xFFFFFFF8u);
+    CHECK(Parse(file, file.size()) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    CHECK(FindChunk(file.data() + 12, file.size() - 12, FOURCC_DATA_TAG) == nullptr);
+
+    // data and fmt sizes past the end of the file
+    file = MakePcm(64);
+    SetU32(file, file.size() - 64 - 4, 65);
+    CHECK(Parse(file, file.size()) == HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+    SetU32(file, file.size() - 64 - 4, 0xFFFFFFFFu);
+    CHECK(FAILED(Parse(file, file.size())));
+    file = MakePcm(64);
+    SetU32(file, 12 + 4, 0x7FFFFFFFu);
+    CHECK(FAILED(Parse(file, file.size())));
+
+    // a RIFF size past the end only limits nothing, the buffer does
+    file = MakePcm(64);
+    SetU32(file, 4, 0xFFFFFFFFu);
+    CHECK(Parse(file, file.size()) == S_OK);
+
+    // not a wave, empty data
+    file = MakePcm(64);
+    SetU32(file, 8, 'IVA ');
+    CHECK(Parse(file, file.size()) == E_FAIL);
+    file = MakePcm(0);
+    CHECK(Parse(file, file.size()) == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    CHECK(FindChunk(nullptr, 64, FOURCC_DATA_TAG) == nullptr);
+}
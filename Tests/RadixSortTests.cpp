@@ -0,0 +1,73 @@
+﻿#include "pch.h"
+#include "RadixSort.h"
+#include "TestMain.h"
+
+#include <numeric>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    // what the radix sort must match: a stable sort of the indices by key
+    std::vector<uint32_t> Reference(const std::vector<uint64_t>& keys)
+    {
+        std::vector<uint32_t> indices(keys.size());
+        std::iota(indices.begin(), indices.end(), 0u);
+        std::stable_sort(indices.begin(), indices.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        return indices;
+    }
+
+    bool SortMatches(const std::vector<uint64_t>& keys)
+    {
+        std::vector<uint32_t> indices(keys.size()), scratch(keys.size());
+        RadixSortIndices(keys.data(), keys.size(), indices.data(), scratch.data());
+        return indices == Reference(keys);
+    }
+}
+
+TEST_CASE(EmptyAndSingle)
+{
+    CHECK(SortMatches(std::vector<uint64_t>()));
+    CHECK(SortMatches(std::vector<uint64_t>(1, 42)));
+}
+
+TEST_CASE(RandomKeys)
+{
+    std::mt19937_64 rng(997);
+    const size_t counts[] = { 2, 7, 255, 256, 257, 4096, 100000 };
+    for (size_t count : counts)
+    {
+        std::vector<uint64_t> keys(count);
+        for (auto& k : keys)
+            k = rng();
+        CHECK(SortMatches(keys));
+    }
+}
+
+TEST_CASE(StableOnEqualKeys)
+{
+    // SpriteBatch keys: few depths and textures, many sprites sharing a key
+    std::mt19937_64 rng(998);
+    std::vector<uint64_t> keys(5000);
+    for (auto& k : keys)
+        k = (uint64_t(rng() % 4) << 32) | (rng() % 3);
+    CHECK(SortMatches(keys));
+    std::fill(keys.begin(), keys.end(), 0x1234567812345678ull);
+    CHECK(SortMatches(keys));
+}
+
+TEST_CASE(SkippedPasses)
+{
+    // only some digits change (texture ids only, depth only, one middle byte), the other passes
+    // are skipped and the result must still end up in the indices buffer
+    const int shifts[] = { 0, 24, 32, 56 };
+    for (int shift : shifts)
+    {
+        std::mt19937_64 rng(static_cast<uint64_t>(shift));
+        std::vector<uint64_t> keys(1000);
+        for (auto& k : keys)
+            k = 0xabcd000000000000ull ^ ((rng() & 0xff) << shift);
+        CHECK(SortMatches(keys));
+    }
+}
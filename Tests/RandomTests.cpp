@@ -0,0 +1,149 @@
+﻿#include "pch.h"
+#include "Common/RandomProvider.h"
+#include "TestMain.h"
+
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const uint32_t SEED = RandomProvider::DEFAULT_SEED;
+}
+
+TEST_CASE(SameSeedSameSequence)
+{
+    RandomProvider a(SEED), b;
+    b.SetSeed(SEED);
+    for (int i = 0; i < 1000; ++i)
+        CHECK(a.Next() == b.Next());
+
+    // an unseeded provider starts as DEFAULT_SEED
+    RandomProvider c, d(SEED);
+    CHECK(c.Next() == d.Next());
+}
+
+TEST_CASE(GetIsInRange)
+{
+    RandomProvider rnd(SEED);
+    bool sawMin = false, sawMax = false;
+    for (int i = 0; i < 10000; ++i)
+    {
+        const uint32_t v = rnd.Get(3, 9);
+        CHECK(v >= 3 && v <= 9);
+        sawMin |= v == 3;
+        sawMax |= v == 9;
+        const uint32_t s = rnd.Get(9, 3); // swapped bounds
+        CHECK(s >= 3 && s <= 9);
+        const float f = rnd.GetF(-1.0f, 1.0f);
+        CHECK(f >= -1.0f && f < 1.0f);
+    }
+    CHECK(sawMin && sawMax);
+}
+
+TEST_CASE(FillMatchesGet)
+{
+    // sizes around the 4 wide SIMD batches, whole 32 bits range included
+    const uint32_t ranges[][2] = { { 0, 99 }, { 5, 5 }, { 0, 0xffffffff }, { 1000, 0x7fffffff } };
+    for (const auto& range : ranges)
+    {
+        for (size_t count = 0; count < 40; ++count)
+        {
+            RandomProvider fill(SEED), get(SEED);
+            fill.Next(); get.Next(); // not aligned to 4 counters
+            std::vector<uint32_t> filled(count), expected(count);
+            fill.Fill(filled.data(), count, range[0], range[1]);
+            for (size_t i = 0; i < count; ++i)
+                expected[i] = get.Get(range[0], range[1]);
+            CHECK(filled == expected);
+            CHECK(fill.GetCounter() == get.GetCounter());
+            CHECK(fill.Next() == get.Next());
+        }
+    }
+}
+
+TEST_CASE(FillFMatchesGetF)
+{
+    for (size_t count = 0; count < 40; ++count)
+    {
+        RandomProvider fill(SEED), get(SEED);
+        std::vector<float> filled(count), expected(count);
+        fill.FillF(filled.data(), count, -2.5f, 7.0f);
+        for (size_t i = 0; i < count; ++i)
+            expected[i] = get.GetF(-2.5f, 7.0f);
+        CHECK(filled == expected);
+        CHECK(fill.GetCounter() == get.GetCounter());
+    }
+}
+
+TEST_CASE(SplitIgnoresCounter)
+{
+    // a child stream only depends on the parent key, not on what was drawn from it
+    RandomProvider parent(SEED);
+    RandomProvider before = parent.Split(7);
+    for (int i = 0; i < 100; ++i)
+        parent.Next();
+    RandomProvider after = parent.Split(7);
+    for (int i = 0; i < 100; ++i)
+        CHECK(before.Next() == after.Next());
+}
+
+TEST_CASE(StreamsAreIndependent)
+{
+    // drawing from one named stream does not change what another one generates
+    RandomProvider root(SEED);
+    RandomProvider levelA = root.Split(RANDOM_LEVEL), spawnA = root.Split(RANDOM_SPAWN);
+    RandomProvider levelB = root.Split(RANDOM_LEVEL);
+    for (int i = 0; i < 500; ++i)
+        spawnA.Next();
+    for (int i = 0; i < 100; ++i)
+        CHECK(levelA.Next() == levelB.Next());
+
+    // sibling and nested streams are different sequences
+    for (uint32_t s = 0; s < RANDOM_STREAM_MAX; ++s)
+    {
+        for (uint32_t t = s + 1; t < RANDOM_STREAM_MAX; ++t)
+        {
+            RandomProvider a = root.Split(s), b = root.Split(t);
+            int same = 0;
+            for (int i = 0; i < 64; ++i)
+                same += a.Next() == b.Next() ? 1 : 0;
+            CHECK(same < 4);
+        }
+    }
+    RandomProvider child = root.Split(1), grandChild = root.Split(1).Split(1);
+    int same = 0;
+    for (int i = 0; i < 64; ++i)
+        same += child.Next() == grandChild.Next() ? 1 : 0;
+    CHECK(same < 4);
+}
+
+TEST_CASE(StreamIsUniform)
+{
+    // 16 buckets of 2^16 draws each, a broken mix shows up as a bucket far off
+    static const int BUCKETS = 16, DRAWS = BUCKETS << 16;
+    RandomProvider rnd(SEED);
+    int histogram[BUCKETS] = {};
+    for (int i = 0; i < DRAWS; ++i)
+        ++histogram[rnd.Get(0, BUCKETS - 1)];
+    for (int b = 0; b < BUCKETS; ++b)
+        CHECK(histogram[b] > (1 << 16) - 2048 && histogram[b] < (1 << 16) + 2048);
+}
+
+TEST_CASE(DensityOutOfRangeThrows)
+{
+    RandomProvider rnd(SEED);
+    const uint32_t full[] = { 50, 100 };
+    for (int i = 0; i < 100; ++i)
+        CHECK(rnd.GetWithDensity(full, 2) < 2);
+
+    // the last entry doesn't reach 100, some draws fall out of the function
+    const uint32_t partial[] = { 10 };
+    bool threw = false;
+    for (int i = 0; i < 100 && !threw; ++i)
+    {
+        try { rnd.GetWithDensity(partial, 1); }
+        catch (const std::out_of_range&) { threw = true; }
+    }
+    CHECK(threw);
+}
@@ -0,0 +1,143 @@
+﻿#include "pch.h"
+#include "Content/AudioSpatializer.h"
+#include "Common/RandomProvider.h"
+#include "TestMain.h"
+
+#include <math.h>
+#include <vector>
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    inline bool Near(float a, float b, float tolerance = 1e-4f)
+    {
+        return fabsf(a - b) <= tolerance;
+    }
+
+    // rooms in a row along x, one tile wide each; portal i joins room i and room i+1
+    class RowOfRooms : public AudioRoomGraph
+    {
+    public:
+        RowOfRooms(uint32_t rooms) : m_version(1), m_rooms(rooms), m_open(rooms - 1, true) {}
+
+        virtual uint32_t GetVersion() const override { return m_version; }
+        virtual uint32_t GetRoomCount() const override { return m_rooms; }
+        virtual int RoomAt(const XMFLOAT3& pos) const override { return (pos.x >= 0.0f && pos.x < (float)m_rooms) ? (int)pos.x : -1; }
+        virtual uint32_t GetPortalCount() const override { return (uint32_t)m_open.size(); }
+        virtual bool GetPortalRooms(uint32_t portal, int& roomA, int& roomB) const override { roomA = (int)portal; roomB = (int)portal + 1; return true; }
+        virtual bool IsPortalOpen(uint32_t portal) const override { return m_open[portal]; }
+
+        uint32_t m_version;
+        uint32_t m_rooms;
+        std::vector<bool> m_open;
+    };
+
+    bool SameOutputs(const AudioSpatializer& a, const AudioSpatializer& b)
+    {
+        bool same = a.GetCount() == b.GetCount();
+        for (uint32_t i = 0; same && i < a.GetCount(); ++i)
+        {
+            same = Near(a.GetGain(i), b.GetGain(i)) && Near(a.GetPan(i), b.GetPan(i))
+                && Near(a.GetLeft(i), b.GetLeft(i)) && Near(a.GetRight(i), b.GetRight(i))
+                && Near(a.GetDoppler(i), b.GetDoppler(i)) && Near(a.GetOcclusion(i), b.GetOcclusion(i));
+        }
+        return same;
+    }
+}
+
+TEST_CASE(SimdMatchesScalar)
+{
+    const XMFLOAT3 listener(8.5f, 0.0f, 3.5f), forward(0.6f, 0.0f, -0.8f), listenerVel(1.5f, 0.0f, -2.0f);
+    RowOfRooms rooms(16);
+    rooms.m_open[3] = false;
+    rooms.m_open[10] = false;
+
+    // odd counts leave padded lanes, the fast velocities hit the doppler clamps
+    for (uint32_t count : { 1u, 3u, 4u, 7u, 64u, 301u })
+    {
+        DX::RandomProvider rnd(count);
+        AudioSpatializer simd, scalar;
+        simd.SetRooms(&rooms);
+        scalar.SetRooms(&rooms);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const XMFLOAT3 pos(rnd.GetF(0.0f, 16.0f), 0.0f, rnd.GetF(0.0f, 8.0f));
+            const float speed = (i % 5 == 0) ? 400.0f : 3.0f;
+            const XMFLOAT3 vel(rnd.GetF(-speed, speed), 0.0f, rnd.GetF(-speed, speed));
+            const float maxDist = rnd.GetF(4.0f, 16.0f), volume = rnd.GetF(0.2f, 1.0f);
+            simd.AddEmitter(pos, vel, maxDist, volume, simd.RoomAt(pos));
+            scalar.AddEmitter(pos, vel, maxDist, volume, scalar.RoomAt(pos));
+        }
+        // on top of the listener, no direction
+        simd.AddEmitter(listener, XMFLOAT3(1, 0, 0), 8.0f, 1.0f, 8);
+        scalar.AddEmitter(listener, XMFLOAT3(1, 0, 0), 8.0f, 1.0f, 8);
+
+        simd.Process(listener, forward, listenerVel, simd.RoomAt(listener));
+        scalar.ProcessScalar(listener, forward, listenerVel, scalar.RoomAt(listener));
+        CHECK(SameOutputs(simd, scalar));
+    }
+}
+
+TEST_CASE(PanAttenuationAndDoppler)
+{
+    // looking down -z, right is +x
+    const XMFLOAT3 listener(0, 0, 0), forward(0, 0, -1), still(0, 0, 0);
+    AudioSpatializer sp;
+    sp.AddEmitter(XMFLOAT3(5, 0, 0), still, 10.0f, 1.0f, -1);     // right, half way out
+    sp.AddEmitter(XMFLOAT3(-2, 0, 0), still, 8.0f, 0.5f, -1);     // left
+    sp.AddEmitter(XMFLOAT3(0, 0, -4), still, 8.0f, 1.0f, -1);     // ahead
+    sp.AddEmitter(XMFLOAT3(0, 0, -20), still, 8.0f, 1.0f, -1);    // out of range
+    sp.AddEmitter(XMFLOAT3(0, 0, -4), XMFLOAT3(0, 0, -34.3f), 8.0f, 1.0f, -1); // receding at c/10
+    sp.Process(listener, forward, XMFLOAT3(0, 0, -34.3f), -1);    // and the listener following it
+
+    CHECK(Near(sp.GetGain(0), 0.5f) && Near(sp.GetPan(0), 1.0f));
+    CHECK(Near(sp.GetLeft(0), 0.0f) && Near(sp.GetRight(0), 0.5f));
+    CHECK(Near(sp.GetGain(1), 0.375f) && Near(sp.GetPan(1), -1.0f));
+    CHECK(Near(sp.GetLeft(1), 0.375f) && Near(sp.GetRight(1), 0.0f));
+    CHECK(Near(sp.GetPan(2), 0.0f) && Near(sp.GetLeft(2), sp.GetRight(2)));
+    CHECK(Near(sp.GetLeft(2)*sp.GetLeft(2) + sp.GetRight(2)*sp.GetRight(2), 0.5f*0.5f));
+    CHECK(sp.GetGain(3) == 0.0f);
+
+    // the listener approaches the still ones, both move together for the last one
+    CHECK(Near(sp.GetDoppler(2), 1.1f));
+    CHECK(Near(sp.GetDoppler(4), 1.0f));
+    CHECK(Near(sp.GetDoppler(0), 1.0f));
+}
+
+TEST_CASE(OcclusionThroughPortals)
+{
+    RowOfRooms rooms(5);
+    rooms.m_open[1] = false;
+    AudioSpatializer sp;
+    AudioSpatializer::Settings settings;
+    settings.m_maxPortalHops = 3;
+    sp.SetSettings(settings);
+    sp.SetRooms(&rooms);
+    for (int r = 0; r < 5; ++r)
+        sp.AddEmitter(XMFLOAT3(r + 0.5f, 0, 0.5f), XMFLOAT3(0, 0, 0), 100.0f, 1.0f, r);
+    sp.Process(XMFLOAT3(0.5f, 0, 0.5f), XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, 0), 0);
+
+    const float open = settings.m_openPortalGain, closed = settings.m_closedPortalGain;
+    CHECK(Near(sp.GetRoomGain(0), 1.0f));
+    CHECK(Near(sp.GetRoomGain(1), open));
+    CHECK(Near(sp.GetRoomGain(2), open*closed));
+    CHECK(Near(sp.GetRoomGain(3), open*closed*open));
+    CHECK(sp.GetRoomGain(4) == 0.0f); // more hops than allowed
+    CHECK(Near(sp.GetOcclusion(2), open*closed));
+    CHECK(sp.GetRoomGain(-1) == 1.0f);
+
+    // a new version (the next level) rebuilds the edges
+    rooms.m_rooms = 2;
+    rooms.m_open.assign(1, false);
+    ++rooms.m_version;
+    sp.Process(XMFLOAT3(0.5f, 0, 0.5f), XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, 0), 0);
+    CHECK(Near(sp.GetRoomGain(1), closed));
+    CHECK(sp.GetRoomGain(4) == 1.0f); // not a room anymore
+
+    // no graph, no occlusion
+    sp.SetRooms(nullptr);
+    CHECK(sp.RoomAt(XMFLOAT3(0.5f, 0, 0.5f)) == -1);
+    sp.Process(XMFLOAT3(0.5f, 0, 0.5f), XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, 0), 0);
+    CHECK(sp.GetOcclusion(2) == 1.0f);
+}
@@ -0,0 +1,196 @@
+﻿#include "pch.h"
+#include "SpriteBatchKernels.h"
+#include "TestMain.h"
+
+#include <numeric>
+#include <random>
+
+using namespace DirectX;
+using namespace DirectX::SpriteBatchKernels;
+
+namespace
+{
+    ID3D11ShaderResourceView* FakeTexture(uint32_t t) { return reinterpret_cast<ID3D11ShaderResourceView*>((uintptr_t)(t + 1) * 256); }
+
+    const XMVECTOR TextureSize() { return XMVectorSet(512.0f, 256.0f, 0.0f, 0.0f); }
+    const XMVECTOR InverseTextureSize() { return XMVectorReciprocal(TextureSize()); }
+
+    bool Near(float a, float b) { return fabsf(a - b) <= 1e-3f; }
+
+    bool Corner(const VertexPositionColorTexture& v, float x, float y, float u, float t)
+    {
+        return Near(v.position.x, x) && Near(v.position.y, y) && Near(v.textureCoordinate.x, u) && Near(v.textureCoordinate.y, t);
+    }
+
+    SpriteInfo AtlasSprite(float x, float y, int flags)
+    {
+        // a 32x64 texel rect drawn at its size in pixels
+        SpriteInfo sp;
+        sp.source = XMFLOAT4A(64.0f, 128.0f, 32.0f, 64.0f);
+        sp.destination = XMFLOAT4A(x, y, 32.0f, 64.0f);
+        sp.color = XMFLOAT4A(1.0f, 0.5f, 0.25f, 1.0f);
+        sp.originRotationDepth = XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.5f);
+        sp.texture = FakeTexture(0);
+        sp.flags = SpriteInfo::SourceInTexels | SpriteInfo::DestSizeInPixels | flags;
+        return sp;
+    }
+
+    // both SpriteBatch workloads plus the corner cases of the lane selects
+    std::vector<SpriteInfo> RandomSprites(size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        auto uniform = [&](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+        std::vector<SpriteInfo> sprites(count);
+        for (auto& sp : sprites)
+        {
+            const uint32_t kind = rng() % 4;
+            sp.source = kind == 3 ? XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f) : XMFLOAT4A(float(rng() % 16) * 32.0f, float(rng() % 8) * 32.0f, 32.0f, 32.0f);
+            sp.destination = XMFLOAT4A(uniform(0.0f, 1920.0f), uniform(0.0f, 1080.0f), uniform(0.01f, 64.0f), uniform(0.01f, 64.0f));
+            sp.color = XMFLOAT4A(uniform(0.0f, 1.0f), uniform(0.0f, 1.0f), uniform(0.0f, 1.0f), 1.0f);
+            sp.originRotationDepth = XMFLOAT4A(uniform(0.0f, 32.0f), uniform(0.0f, 32.0f), kind == 0 ? 0.0f : uniform(-XM_PI, XM_PI), uniform(0.0f, 1.0f));
+            sp.texture = FakeTexture(rng() % 8);
+            sp.flags = int(rng() % 4);
+            if (kind != 1) sp.flags |= SpriteInfo::SourceInTexels;
+            if (kind != 2) sp.flags |= SpriteInfo::DestSizeInPixels;
+        }
+        return sprites;
+    }
+
+    std::vector<const SpriteInfo*> Queue(const std::vector<SpriteInfo>& sprites)
+    {
+        std::vector<const SpriteInfo*> queue;
+        for (const auto& sp : sprites)
+            queue.push_back(&sp);
+        return queue;
+    }
+
+    std::vector<uint32_t> SortedOrder(const std::vector<const SpriteInfo*>& queue, SpriteSortMode mode)
+    {
+        const size_t n = queue.size();
+        std::vector<uint32_t> ids(n), indices(n), scratch(n);
+        std::vector<uint64_t> keys(n);
+        // SpriteBatch only numbers the textures for the modes that group by them
+        const bool withTextures = mode == SpriteSortMode_Texture || mode == SpriteSortMode_BackToFrontTexture || mode == SpriteSortMode_FrontToBackTexture;
+        if (withTextures)
+            AssignTextureIds(queue.data(), n, ids.data());
+        BuildSortKeys(queue.data(), withTextures ? ids.data() : nullptr, n, mode, keys.data());
+        RadixSortIndices(keys.data(), n, indices.data(), scratch.data());
+        return indices;
+    }
+}
+
+TEST_CASE(ExpandsAtlasRect)
+{
+    const SpriteInfo sp = AtlasSprite(100.0f, 200.0f, SpriteEffects_None);
+    VertexPositionColorTexture v[VerticesPerSprite];
+    ExpandSprite(&sp, TextureSize(), InverseTextureSize(), v);
+
+    // texels to 0..1 over the 512x256 texture, corners in Z order
+    CHECK(Corner(v[0], 100.0f, 200.0f, 0.125f, 0.5f));
+    CHECK(Corner(v[1], 132.0f, 200.0f, 0.1875f, 0.5f));
+    CHECK(Corner(v[2], 100.0f, 264.0f, 0.125f, 0.75f));
+    CHECK(Corner(v[3], 132.0f, 264.0f, 0.1875f, 0.75f));
+    for (const auto& vertex : v)
+        CHECK(vertex.position.z == 0.5f && vertex.color.x == 1.0f && vertex.color.y == 0.5f && vertex.color.z == 0.25f && vertex.color.w == 1.0f);
+}
+
+TEST_CASE(FlipsSwapTextureCorners)
+{
+    VertexPositionColorTexture v[VerticesPerSprite];
+    SpriteInfo sp = AtlasSprite(0.0f, 0.0f, SpriteEffects_FlipHorizontally);
+    ExpandSprite(&sp, TextureSize(), InverseTextureSize(), v);
+    CHECK(Corner(v[0], 0.0f, 0.0f, 0.1875f, 0.5f) && Corner(v[1], 32.0f, 0.0f, 0.125f, 0.5f));
+
+    sp = AtlasSprite(0.0f, 0.0f, SpriteEffects_FlipBoth);
+    ExpandSprite(&sp, TextureSize(), InverseTextureSize(), v);
+    CHECK(Corner(v[0], 0.0f, 0.0f, 0.1875f, 0.75f) && Corner(v[3], 32.0f, 64.0f, 0.125f, 0.5f));
+}
+
+TEST_CASE(OriginAndRotation)
+{
+    // rotated a quarter turn about its center: the top left corner goes to the top right
+    SpriteInfo sp = AtlasSprite(100.0f, 100.0f, SpriteEffects_None);
+    sp.originRotationDepth = XMFLOAT4A(16.0f, 32.0f, XM_PIDIV2, 0.0f);
+    VertexPositionColorTexture v[VerticesPerSprite];
+    ExpandSprite(&sp, TextureSize(), InverseTextureSize(), v);
+    CHECK(Corner(v[0], 132.0f, 84.0f, 0.125f, 0.5f));
+    CHECK(Corner(v[3], 68.0f, 116.0f, 0.1875f, 0.75f));
+
+    // a zero sized source does not divide the origin by zero
+    sp.source = XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f);
+    ExpandSprite(&sp, TextureSize(), InverseTextureSize(), v);
+    bool finite = true;
+    for (const auto& vertex : v)
+        finite = finite && std::isfinite(vertex.position.x) && std::isfinite(vertex.position.y);
+    CHECK(finite);
+}
+
+TEST_CASE(SimdMatchesScalar)
+{
+    // four at a time must match one at a time bit for bit, remainders included
+    const size_t counts[] = { 1, 3, 4, 5, 8, 1001 };
+    for (size_t count : counts)
+    {
+        const auto sprites = RandomSprites(count, 1000u + uint32_t(count));
+        const auto queue = Queue(sprites);
+        std::vector<VertexPositionColorTexture> scalar(count * VerticesPerSprite), simd(scalar.size());
+        for (size_t i = 0; i < count; ++i)
+            ExpandSprite(queue[i], TextureSize(), InverseTextureSize(), &scalar[i * VerticesPerSprite]);
+        ExpandSprites(queue.data(), count, TextureSize(), InverseTextureSize(), simd.data());
+        CHECK(memcmp(scalar.data(), simd.data(), scalar.size() * sizeof(VertexPositionColorTexture)) == 0);
+    }
+}
+
+TEST_CASE(TextureIdsInFirstUseOrder)
+{
+    // 100 textures grow the table past its initial 64 slots
+    std::vector<SpriteInfo> sprites(300);
+    const uint32_t textures[] = { 7, 7, 3, 7, 0, 3 };
+    for (size_t i = 0; i < sprites.size(); ++i)
+        sprites[i].texture = FakeTexture(i < 6 ? textures[i] : uint32_t(i % 100));
+    const auto queue = Queue(sprites);
+    std::vector<uint32_t> ids(sprites.size());
+    const size_t distinct = AssignTextureIds(queue.data(), queue.size(), ids.data());
+    CHECK(distinct == 100);
+    CHECK(ids[0] == 0 && ids[1] == 0 && ids[2] == 1 && ids[3] == 0 && ids[4] == 2 && ids[5] == 1);
+
+    bool consistent = true;
+    for (size_t i = 0; i < sprites.size(); ++i)
+        for (size_t j = 0; j < i; ++j)
+            consistent = consistent && ((ids[i] == ids[j]) == (sprites[i].texture == sprites[j].texture));
+    CHECK(consistent);
+}
+
+TEST_CASE(SortModes)
+{
+    auto sprites = RandomSprites(2000, 77);
+    // few distinct depths, so the texture and stability orders show
+    for (size_t i = 0; i < sprites.size(); ++i)
+        sprites[i].originRotationDepth.w = float(i % 5) * 0.25f - 0.5f;
+    sprites[0].originRotationDepth.w = -0.0f;
+    const auto queue = Queue(sprites);
+    std::vector<uint32_t> ids(queue.size());
+    AssignTextureIds(queue.data(), queue.size(), ids.data());
+    auto depth = [&](uint32_t i) { return queue[i]->originRotationDepth.w; };
+
+    bool backToFront = true, frontToBack = true, byTexture = true, byDepthThenTexture = true;
+    auto order = SortedOrder(queue, SpriteSortMode_BackToFront);
+    for (size_t i = 1; i < order.size(); ++i)
+        backToFront = backToFront && (depth(order[i - 1]) > depth(order[i]) || (depth(order[i - 1]) == depth(order[i]) && order[i - 1] < order[i]));
+    order = SortedOrder(queue, SpriteSortMode_FrontToBack);
+    for (size_t i = 1; i < order.size(); ++i)
+        frontToBack = frontToBack && (depth(order[i - 1]) < depth(order[i]) || (depth(order[i - 1]) == depth(order[i]) && order[i - 1] < order[i]));
+    order = SortedOrder(queue, SpriteSortMode_Texture);
+    for (size_t i = 1; i < order.size(); ++i)
+        byTexture = byTexture && (ids[order[i - 1]] < ids[order[i]] || (ids[order[i - 1]] == ids[order[i]] && order[i - 1] < order[i]));
+    order = SortedOrder(queue, SpriteSortMode_BackToFrontTexture);
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        const uint32_t a = order[i - 1], b = order[i];
+        byDepthThenTexture = byDepthThenTexture && (depth(a) > depth(b) || (depth(a) == depth(b) && (ids[a] < ids[b] || (ids[a] == ids[b] && a < b))));
+    }
+    CHECK(backToFront);
+    CHECK(frontToBack);
+    CHECK(byTexture);
+    CHECK(byDepthThenTexture);
+}
@@ -0,0 +1,197 @@
+﻿#include "pch.h"
+#include "Common/StepTimer.h"
+#include "TestMain.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+    // A clock the test moves by hand, in microseconds
+    struct ScriptedClock
+    {
+        ScriptedClock() : m_now(1000000) {}
+
+        uint64_t GetFrequency() const { return 1000000; }
+        uint64_t Now() const { return m_now; }
+
+        uint64_t m_now;
+    };
+
+    typedef BasicStepTimer<ScriptedClock> ScriptedTimer;
+
+    const uint64_t TICKS_PER_MS = ScriptedTimer::TicksPerSecond / 1000;
+    const uint64_t STEP_60 = ScriptedTimer::TicksPerSecond / 60;
+
+    // advances the clock by us and ticks, returns the updates run
+    uint32_t Advance(ScriptedTimer& timer, uint64_t us)
+    {
+        timer.GetClock().m_now += us;
+        uint32_t updates = 0;
+        timer.Tick([&]() { ++updates; });
+        CHECK(updates == timer.GetUpdatesThisFrame());
+        return updates;
+    }
+
+    ScriptedTimer* FixedTimer()
+    {
+        ScriptedTimer* timer = new ScriptedTimer();
+        timer->SetFixedTimeStep(true);
+        timer->SetTargetElapsedSeconds(1.0 / 60);
+        return timer;
+    }
+}
+
+TEST_CASE(VariableStepFollowsTheClock)
+{
+    ScriptedTimer timer;
+    CHECK(Advance(timer, 16000) == 1);
+    CHECK(timer.GetElapsedTicks() == 16 * TICKS_PER_MS);
+    CHECK(Advance(timer, 33000) == 1);
+    CHECK(timer.GetElapsedTicks() == 33 * TICKS_PER_MS);
+    CHECK(timer.GetTotalTicks() == 49 * TICKS_PER_MS);
+    CHECK(timer.GetFrameCount() == 2);
+
+    // the simulation sees at most 100 ms, the pacing statistics the real frame
+    CHECK(Advance(timer, 2000000) == 1);
+    CHECK(timer.GetElapsedTicks() == 100 * TICKS_PER_MS);
+    CHECK(timer.GetFrameTimePercentile(100.0) == 2000 * TICKS_PER_MS);
+    CHECK(timer.GetFramesPerSecond() == 3);
+}
+
+TEST_CASE(FixedStepCatchesUp)
+{
+    std::unique_ptr<ScriptedTimer> timer(FixedTimer());
+
+    // too early, then the rest of the step
+    CHECK(Advance(*timer, 10000) == 0);
+    CHECK(Advance(*timer, 6667) == 1);
+    CHECK(timer->GetElapsedTicks() == STEP_60);
+
+    // 50 ms: three steps and the rest carried over
+    CHECK(Advance(*timer, 50000) == 3);
+    CHECK(timer->GetCatchUpFrames() == 1);
+    CHECK(timer->GetDroppedTicks() == 0);
+    CHECK(timer->GetFrameCount() == 4);
+    CHECK(timer->GetTotalTicks() == 4 * STEP_60);
+}
+
+TEST_CASE(CatchUpLimitDropsWholeSteps)
+{
+    // 90 ms are five steps and a fraction; the limit keeps two and the fraction
+    const uint64_t delta = 90 * TICKS_PER_MS;
+    const uint64_t fraction = delta % STEP_60;
+
+    std::unique_ptr<ScriptedTimer> unlimited(FixedTimer());
+    CHECK(Advance(*unlimited, 90000) == 5);
+    CHECK(unlimited->GetDroppedTicks() == 0);
+
+    std::unique_ptr<ScriptedTimer> timer(FixedTimer());
+    timer->SetMaxUpdatesPerFrame(2);
+    CHECK(Advance(*timer, 90000) == 2);
+    CHECK(timer->GetDroppedTicks() == 3 * STEP_60);
+    CHECK(timer->GetDroppedTicks() == delta - 2 * STEP_60 - fraction);
+    CHECK(timer->GetTotalTicks() == 2 * STEP_60);
+
+    // the fraction is kept: 60 Hz frames, snapped to the step, run one update each
+    CHECK(Advance(*timer, 16667) == 1);
+    CHECK(timer->GetDroppedTicks() == 3 * STEP_60);
+    CHECK(Advance(*timer, 16667) == 1);
+    CHECK(timer->GetCatchUpFrames() == 1);
+
+    // up to the limit nothing is dropped
+    CHECK(Advance(*timer, 33333) == 2);
+    CHECK(timer->GetDroppedTicks() == 3 * STEP_60);
+    CHECK(timer->GetCatchUpFrames() == 2);
+
+    // a debugger sized pause is clamped first, then limited
+    CHECK(Advance(*timer, 5000000) == 2);
+    CHECK(timer->GetDroppedTicks() > 3 * STEP_60);
+    CHECK(timer->GetFrameTimePercentile(100.0) == 5000 * TICKS_PER_MS);
+}
+
+TEST_CASE(PercentilesAndHistogram)
+{
+    ScriptedTimer timer;
+    CHECK(timer.GetFrameTimePercentile(50.0) == 0);
+
+    // 1..100 ms, in a scrambled order
+    for (uint64_t i = 0; i < 100; ++i)
+        Advance(timer, ((i * 37) % 100 + 1) * 1000);
+
+    CHECK(timer.GetPacingFrameCount() == 100);
+    CHECK(timer.GetFrameTimePercentile(0.0) == 1 * TICKS_PER_MS);
+    CHECK(timer.GetFrameTimePercentile(-5.0) == 1 * TICKS_PER_MS);
+    CHECK(timer.GetFrameTimePercentile(50.0) == 51 * TICKS_PER_MS);
+    CHECK(timer.GetFrameTimePercentile(99.0) == 99 * TICKS_PER_MS);
+    CHECK(timer.GetFrameTimePercentile(100.0) == 100 * TICKS_PER_MS);
+    CHECK(timer.GetFrameTimePercentile(200.0) == 100 * TICKS_PER_MS);
+
+    // 1 ms buckets, the last one collects 63 ms and up
+    const uint32_t* histogram = timer.GetHistogram();
+    const uint32_t last = ScriptedTimer::HistogramBuckets - 1;
+    bool buckets = histogram[0] == 0 && histogram[last] == 100 - 62;
+    for (uint32_t b = 1; b < last; ++b)
+        buckets = buckets && histogram[b] == 1;
+    CHECK(buckets);
+}
+
+TEST_CASE(WindowEvictsTheOldestFrames)
+{
+    std::unique_ptr<ScriptedTimer> timer(FixedTimer());
+    const uint32_t window = ScriptedTimer::PacingWindow;
+
+    // 50 ms catch-up frames, then a full window of 60 Hz ones pushes them all out
+    for (int i = 0; i < 10; ++i)
+        Advance(*timer, 50000);
+    CHECK(timer->GetCatchUpFrames() == 10);
+    for (uint32_t i = 0; i < window; ++i)
+        Advance(*timer, 16667);
+
+    CHECK(timer->GetPacingFrameCount() == window);
+    CHECK(timer->GetCatchUpFrames() == 0);
+    CHECK(timer->GetHistogram()[50] == 0);
+    CHECK(timer->GetHistogram()[16] == window);
+    CHECK(timer->GetFrameTimePercentile(100.0) == 166670);
+}
+
+TEST_CASE(HitchesAreReported)
+{
+    ScriptedTimer timer;
+    std::vector<uint64_t> hitches;
+    timer.SetHitchCallback(20 * TICKS_PER_MS, [&](uint64_t frameTicks) { hitches.push_back(frameTicks); });
+    Advance(timer, 16000);
+    Advance(timer, 20000);
+    Advance(timer, 45000);
+    Advance(timer, 16000);
+    CHECK(timer.GetHitchCount() == 1);
+    CHECK(hitches.size() == 1 && hitches[0] == 45 * TICKS_PER_MS);
+
+    // a zero threshold turns it off
+    timer.SetHitchCallback(0, nullptr);
+    Advance(timer, 500000);
+    CHECK(timer.GetHitchCount() == 1);
+}
+
+TEST_CASE(WritesTheWindowAsCsv)
+{
+    std::unique_ptr<ScriptedTimer> timer(FixedTimer());
+    Advance(*timer, 16000);
+    Advance(*timer, 40000);
+    Advance(*timer, 500);
+    std::ostringstream csv;
+    timer->WriteFrameTimesCsv(csv);
+    CHECK(csv.str() == "frame,ms,updates\n0,16,0\n1,40,3\n2,0.5,0\n");
+}
+
+TEST_CASE(ChronoTimerRuns)
+{
+    ChronoStepTimer timer;
+    uint32_t updates = 0;
+    timer.Tick([&]() { ++updates; });
+    CHECK(updates == 1 && timer.GetFrameCount() == 1);
+}
@@ -0,0 +1,168 @@
+﻿#include "pch.h"
+#include "PacketStream.h"
+#include "MixerCore.h"
+#include "TestMain.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace DirectX;
+using namespace DirectX::Streaming;
+
+namespace
+{
+    const char* FILE_NAME = "StreamTests.bin";
+    const wchar_t* WFILE_NAME = L"StreamTests.bin";
+
+    // every byte holds a function of its offset, so misplaced packets show
+    std::vector<uint8_t> WriteTestFile(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i)
+            data[i] = uint8_t((i * 31) ^ (i >> 9));
+        FILE* file = fopen(FILE_NAME, "wb");
+        CHECK(file != nullptr);
+        if (file)
+        {
+            fwrite(data.data(), 1, data.size(), file);
+            fclose(file);
+        }
+        return data;
+    }
+
+    // pulls like a consumer would, backing off when the ring is empty
+    std::vector<uint8_t> ReadAll(PacketStream& stream, size_t limit, size_t pull = 1000)
+    {
+        std::vector<uint8_t> out;
+        std::vector<uint8_t> buffer(pull);
+        while (out.size() < limit && !stream.IsEndOfStream())
+        {
+            const size_t got = stream.Read(buffer.data(), std::min(pull, limit - out.size()));
+            out.insert(out.end(), buffer.begin(), buffer.begin() + got);
+            if (!got)
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return out;
+    }
+
+    class PacketStreamSource : public Mixer::StreamSource
+    {
+    public:
+        explicit PacketStreamSource(PacketStream& stream) : m_stream(stream) {}
+
+        virtual size_t Read(uint8_t* dest, size_t maxBytes) override { return m_stream.Read(dest, maxBytes); }
+        virtual bool IsEndOfStream() const override { return m_stream.IsEndOfStream(); }
+
+    private:
+        PacketStream& m_stream;
+    };
+}
+
+TEST_CASE(ReadsTheEntryAtAnyOffset)
+{
+    const auto data = WriteTestFile(200000);
+    const uint64_t offsets[] = { 0, 1, 4095, 4096, 12345 };
+    const size_t packets[] = { 1, 4096, 10000, 65536 };
+    for (uint64_t offset : offsets)
+    {
+        for (size_t packet : packets)
+        {
+            const uint32_t length = uint32_t(data.size() - offset - 777);
+            PacketStream stream(WFILE_NAME, offset, length, packet, 3, false);
+            const auto out = ReadAll(stream, data.size());
+            CHECK(out.size() == length);
+            CHECK(std::equal(out.begin(), out.end(), data.begin() + size_t(offset)));
+            CHECK(stream.IsEndOfStream());
+
+            const Statistics stats = stream.GetStatistics();
+            CHECK(stats.bytesDelivered == length);
+            CHECK(stats.bytesRead >= length);
+            CHECK(stats.bufferBytes % SECTOR_SIZE == 0 && stats.bufferBytes >= 3 * SECTOR_SIZE);
+            CHECK(stats.packetsRead >= length / (stats.bufferBytes / 3));
+        }
+    }
+    remove(FILE_NAME);
+}
+
+TEST_CASE(LoopsAndRestarts)
+{
+    const auto data = WriteTestFile(50000);
+    const uint32_t offset = 100, length = 9000;
+    PacketStream stream(WFILE_NAME, offset, length, 4096, 4, true);
+    const auto out = ReadAll(stream, length * 5 + 10, 333);
+    CHECK(out.size() == length * 5 + 10);
+    bool same = true;
+    for (size_t i = 0; i < out.size(); ++i)
+        same = same && out[i] == data[offset + i % length];
+    CHECK(same);
+    CHECK(!stream.IsEndOfStream());
+
+    stream.Restart();
+    const auto again = ReadAll(stream, 10);
+    CHECK(again.size() == 10 && std::equal(again.begin(), again.end(), data.begin() + offset));
+    remove(FILE_NAME);
+}
+
+TEST_CASE(TruncatedFileEndsEarly)
+{
+    const auto data = WriteTestFile(30000);
+    PacketStream stream(WFILE_NAME, 1000, 100000, 8192, 2, false);
+    const auto out = ReadAll(stream, 200000);
+    CHECK(out.size() == data.size() - 1000);
+    CHECK(std::equal(out.begin(), out.end(), data.begin() + 1000));
+    CHECK(stream.IsEndOfStream());
+    remove(FILE_NAME);
+}
+
+TEST_CASE(RejectsBadArguments)
+{
+    bool threw = false;
+    try { PacketStream stream(L"StreamTests.missing", 0, 100, 4096, 2, false); }
+    catch (const std::runtime_error&) { threw = true; }
+    CHECK(threw);
+
+    WriteTestFile(100);
+    threw = false;
+    try { PacketStream stream(WFILE_NAME, 0, 100, 4096, 1, false); }
+    catch (const std::invalid_argument&) { threw = true; }
+    CHECK(threw);
+
+    PacketStream empty(WFILE_NAME, 0, 0, 4096, 2, false);
+    uint8_t byte;
+    CHECK(empty.IsEndOfStream() && empty.Read(&byte, 1) == 0);
+    remove(FILE_NAME);
+}
+
+TEST_CASE(MixerPullsFromTheRing)
+{
+    // 16-bit stereo, played by a voice pulling from the ring and by one reading memory
+    const size_t FRAMES = 40000;
+    const auto data = WriteTestFile(FRAMES * 4);
+    PacketStream stream(WFILE_NAME, 0, uint32_t(data.size()), 16384, 4, false);
+    PacketStreamSource source(stream);
+
+    const int RATE = 22050;
+    Mixer::VoicePool memory(RATE, 1), streamed(RATE, 1);
+    memory.Play(Mixer::SAMPLE_PCM16, 2, RATE, data.data(), FRAMES, 0, 0, 1.f, 0.f, 0.f, false);
+    const uint32_t voice = streamed.PlayStream(Mixer::SAMPLE_PCM16, 2, RATE, &source, 1.f, 0.f, 0.f);
+
+    // wait for the ring before each block, as a real time consumer with enough prefetch would
+    std::vector<float> expected(Mixer::BLOCK_FRAMES * 2), out(Mixer::BLOCK_FRAMES * 2);
+    bool same = true;
+    for (size_t block = 0; block * Mixer::BLOCK_FRAMES < FRAMES; ++block)
+    {
+        while (stream.GetStatistics().bytesRead < data.size() && stream.GetBufferedBytes() < Mixer::BLOCK_FRAMES * 4 * 2)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        memory.Render(expected.data(), Mixer::BLOCK_FRAMES);
+        streamed.Render(out.data(), Mixer::BLOCK_FRAMES);
+        same = same && out == expected;
+    }
+    CHECK(same);
+    streamed.Render(nullptr, Mixer::BLOCK_FRAMES);
+    CHECK(!streamed.IsPlaying(voice));
+    CHECK(streamed.GetStatistics().streamUnderruns == 0);
+    CHECK(stream.GetStatistics().bytesDelivered == data.size());
+    remove(FILE_NAME);
+}
@@ -0,0 +1,54 @@
+﻿#include "TestMain.h"
+
+#include <string.h>
+#include <exception>
+
+using namespace SpookyTests;
+
+namespace
+{
+    int g_failures = 0;
+}
+
+std::vector<TestCase>& SpookyTests::GetTestCases()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+void SpookyTests::ReportFailure(const char* file, int line, const char* expression)
+{
+    printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+    ++g_failures;
+}
+
+int main(int argc, char** argv)
+{
+    int run = 0, failed = 0;
+    for (const TestCase& test : GetTestCases())
+    {
+        // known defects only run when named, their ctest entry expects them to fail
+        bool selected = argc < 2 && strncmp(test.m_name, "KnownDefect", 11) != 0;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = strcmp(argv[i], test.m_name) == 0;
+        if (!selected)
+            continue;
+
+        const int failuresBefore = g_failures;
+        try
+        {
+            test.m_function();
+        }
+        catch (const std::exception& e)
+        {
+            printf("%s: unexpected exception: %s\n", test.m_name, e.what());
+            ++g_failures;
+        }
+        const bool ok = g_failures == failuresBefore;
+        printf("%-40s %s\n", test.m_name, ok ? "ok" : "FAILED");
+        ++run;
+        if (!ok) ++failed;
+    }
+    printf("%d tests, %d failed\n", run, failed);
+    return (failed || !run) ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+//* ***************************************************************** *//
+//* Test driver
+//* Every test executable links TestMain.cpp, which runs the TEST_CASEs
+//* of that executable (or only the ones named in the command line) and
+//* returns non zero when a CHECK failed. Nothing needs the game running.
+//* TEST_CASEs named KnownDefect... pin a bug that is not fixed yet: they
+//* are skipped unless named, and ctest runs them with WILL_FAIL
+//* ***************************************************************** *//
+namespace SpookyTests
+{
+    typedef void(*TestFunction)();
+
+    struct TestCase
+    {
+        const char* m_name;
+        TestFunction m_function;
+    };
+
+    std::vector<TestCase>& GetTestCases();
+    void ReportFailure(const char* file, int line, const char* expression);
+
+    struct TestRegistrar
+    {
+        TestRegistrar(const char* name, TestFunction function)
+        {
+            TestCase test = { name, function };
+            GetTestCases().push_back(test);
+        }
+    };
+}
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static SpookyTests::TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(expression) \
+    do { if (!(expression)) SpookyTests::ReportFailure(__FILE__, __LINE__, #expression); } while (0)
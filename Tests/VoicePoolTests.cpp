@@ -0,0 +1,186 @@
+﻿#include "pch.h"
+#include "Content/SoundVoicePool.h"
+#include "Common/RandomProvider.h"
+#include "TestMain.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace SpookyAdulthood;
+
+namespace
+{
+    const uint32_t VOICES = 4;
+    const float STEP = 1.0f / 60.0f;
+
+    // every sfx lasts a second
+    void InitPool(SoundVoicePool& pool, SoundVoicePool::StealPolicy policy, uint32_t voices = VOICES)
+    {
+        pool.Initialize(std::unique_ptr<SoundVoiceBackend>(new NullSoundVoiceBackend(std::vector<float>(4, 1.0f), voices)), voices, policy);
+    }
+}
+
+TEST_CASE(StealsTheOldest)
+{
+    SoundVoicePool pool;
+    InitPool(pool, SoundVoicePool::STEAL_OLDEST);
+    uint32_t voices[VOICES];
+    for (uint32_t i = 0; i < VOICES; ++i)
+        voices[i] = pool.Play(i, 1.0f, 0.0f, SOUND_PRIO_NORMAL);
+
+    const uint32_t newest = pool.Play(0, 0.1f, 0.0f, SOUND_PRIO_NORMAL);
+    CHECK(newest != SoundVoicePool::INVALID_VOICE);
+    CHECK(!pool.IsPlaying(voices[0]));
+    CHECK(pool.IsPlaying(voices[1]) && pool.IsPlaying(voices[3]) && pool.IsPlaying(newest));
+
+    // a lower priority can't take a normal voice
+    CHECK(pool.Play(1, 1.0f, 0.0f, SOUND_PRIO_LOW) == SoundVoicePool::INVALID_VOICE);
+
+    const auto& st = pool.GetStats();
+    CHECK(st.m_played == VOICES + 1 && st.m_stolen == 1 && st.m_rejected == 1);
+    CHECK(st.m_active == VOICES && st.m_peak == VOICES);
+}
+
+TEST_CASE(StealsTheQuietest)
+{
+    SoundVoicePool pool;
+    InitPool(pool, SoundVoicePool::STEAL_QUIETEST);
+    const float volumes[VOICES] = { 0.9f, 0.2f, 0.5f, 0.7f };
+    uint32_t voices[VOICES];
+    for (uint32_t i = 0; i < VOICES; ++i)
+        voices[i] = pool.Play(0, volumes[i], 0.0f, SOUND_PRIO_NORMAL);
+
+    CHECK(pool.Play(0, 0.6f, 0.0f, SOUND_PRIO_NORMAL) != SoundVoicePool::INVALID_VOICE);
+    CHECK(!pool.IsPlaying(voices[1]));
+    CHECK(pool.IsPlaying(voices[0]) && pool.IsPlaying(voices[2]) && pool.IsPlaying(voices[3]));
+
+    // quieter than every voice of its priority: dropped rather than replacing a louder one
+    CHECK(pool.Play(0, 0.1f, 0.0f, SOUND_PRIO_NORMAL) == SoundVoicePool::INVALID_VOICE);
+    // a higher priority takes the quietest anyway
+    CHECK(pool.Play(0, 0.1f, 0.0f, SOUND_PRIO_HIGH) != SoundVoicePool::INVALID_VOICE);
+    CHECK(!pool.IsPlaying(voices[2]));
+
+    const auto& st = pool.GetStats();
+    CHECK(st.m_stolen == 2 && st.m_rejected == 1 && st.m_active == VOICES);
+}
+
+TEST_CASE(CriticalVoicesAreNeverStolen)
+{
+    SoundVoicePool pool;
+    InitPool(pool, SoundVoicePool::STEAL_OLDEST, 2);
+    const uint32_t a = pool.Play(0, 1.0f, 0.0f, SOUND_PRIO_CRITICAL, true);
+    const uint32_t b = pool.Play(1, 1.0f, 0.0f, SOUND_PRIO_CRITICAL);
+    CHECK(pool.Play(2, 1.0f, 0.0f, SOUND_PRIO_CRITICAL) == SoundVoicePool::INVALID_VOICE);
+    CHECK(pool.IsPlaying(a) && pool.IsPlaying(b));
+    CHECK(pool.GetStats().m_stolen == 0 && pool.GetStats().m_rejected == 1);
+}
+
+TEST_CASE(CullsOutOfRange)
+{
+    SoundVoicePool pool;
+    InitPool(pool, SoundVoicePool::STEAL_OLDEST);
+    pool.Update(STEP, XMFLOAT3(0, 0, 0));
+
+    CHECK(pool.PlayAt(0, XMFLOAT3(20, 0, 0), 10.0f, 1.0f, 0.0f, SOUND_PRIO_HIGH) == SoundVoicePool::INVALID_VOICE);
+    CHECK(pool.PlayAt(0, XMFLOAT3(0, 0, 10), 10.0f, 1.0f, 0.0f, SOUND_PRIO_HIGH) == SoundVoicePool::INVALID_VOICE);
+    CHECK(pool.PlayAt(0, XMFLOAT3(5, 0, 0), 10.0f, 1.0f, 0.0f, SOUND_PRIO_HIGH) != SoundVoicePool::INVALID_VOICE);
+    // a loop may walk into range later, it keeps its voice
+    const uint32_t loop = pool.PlayAt(1, XMFLOAT3(20, 0, 0), 10.0f, 1.0f, 0.0f, SOUND_PRIO_LOW, true);
+    CHECK(loop != SoundVoicePool::INVALID_VOICE);
+
+    const auto& st = pool.GetStats();
+    CHECK(st.m_culled == 2 && st.m_played == 2 && st.m_active == 2 && st.m_stolen == 0);
+
+    // out of range once started isn't culled, only silent
+    pool.SetPosition(loop, XMFLOAT3(30, 0, 0));
+    pool.Update(STEP, XMFLOAT3(0, 0, 0));
+    CHECK(pool.IsPlaying(loop));
+}
+
+TEST_CASE(StaleHandlesAreRejected)
+{
+    SoundVoicePool pool;
+    InitPool(pool, SoundVoicePool::STEAL_OLDEST, 1);
+    const uint32_t first = pool.Play(0, 1.0f, 0.0f, SOUND_PRIO_NORMAL);
+    pool.Stop(first);
+    CHECK(!pool.IsPlaying(first));
+
+    // the same slot, a new generation
+    const uint32_t second = pool.Play(1, 1.0f, 0.0f, SOUND_PRIO_NORMAL);
+    CHECK(second != first && (second & 0xff) == (first & 0xff));
+    pool.Stop(first);
+    pool.SetPosition(first, XMFLOAT3(100, 0, 0));
+    CHECK(pool.IsPlaying(second));
+
+    // stolen is as stale as stopped
+    const uint32_t third = pool.Play(2, 1.0f, 0.0f, SOUND_PRIO_NORMAL);
+    CHECK(!pool.IsPlaying(second) && pool.IsPlaying(third));
+    CHECK(!pool.IsPlaying(SoundVoicePool::INVALID_VOICE));
+    CHECK(!pool.IsPlaying(0x1000 | 0xff)); // slot out of the pool
+    CHECK(pool.GetStats().m_active == 1);
+}
+
+TEST_CASE(VoicesEndAndPauseHolds)
+{
+    SoundVoicePool pool;
+    InitPool(pool, SoundVoicePool::STEAL_OLDEST);
+    const uint32_t oneShot = pool.Play(0, 1.0f, 0.0f, SOUND_PRIO_NORMAL);
+    const uint32_t paused = pool.Play(1, 1.0f, 0.0f, SOUND_PRIO_NORMAL);
+    const uint32_t loop = pool.Play(2, 1.0f, 0.0f, SOUND_PRIO_NORMAL, true);
+    pool.PauseSound(1);
+
+    for (int f = 0; f < 90; ++f)
+        pool.Update(STEP, XMFLOAT3(0, 0, 0));
+    CHECK(!pool.IsPlaying(oneShot));
+    CHECK(pool.IsPlaying(paused) && pool.IsPlaying(loop));
+    CHECK(pool.GetStats().m_active == 2);
+
+    pool.ResumeSound(1);
+    for (int f = 0; f < 90; ++f)
+        pool.Update(STEP, XMFLOAT3(0, 0, 0));
+    CHECK(!pool.IsPlaying(paused) && pool.IsPlaying(loop));
+
+    pool.StopAll();
+    CHECK(pool.GetStats().m_active == 0 && pool.GetStats().m_peak == 3);
+}
+
+TEST_CASE(AccountingUnderLoad)
+{
+    // the benchmark's load: every request is played, culled or rejected, never more voices than slots
+    const SoundVoicePool::StealPolicy policies[] = { SoundVoicePool::STEAL_OLDEST, SoundVoicePool::STEAL_QUIETEST };
+    for (auto policy : policies)
+    {
+        SoundVoicePool pool;
+        InitPool(pool, policy, 32);
+        DX::RandomProvider rnd(1234);
+        const uint32_t critical = pool.Play(0, 1.0f, 0.0f, SOUND_PRIO_CRITICAL, true);
+        uint32_t requests = 1;
+        for (int f = 0; f < 120; ++f)
+        {
+            pool.Update(STEP, XMFLOAT3(0, 0, 0));
+            for (int i = 0; i < 16; ++i, ++requests)
+            {
+                const XMFLOAT3 pos(rnd.GetF(-12.0f, 12.0f), 0.0f, rnd.GetF(-12.0f, 12.0f));
+                pool.PlayAt(rnd.Get(0, 3), pos, 8.0f, 1.0f, 0.0f, (SoundPriority)rnd.Get(SOUND_PRIO_LOW, SOUND_PRIO_HIGH));
+            }
+        }
+        const auto& st = pool.GetStats();
+        CHECK(st.m_peak <= 32 && st.m_active <= 32);
+        CHECK(pool.IsPlaying(critical));
+        CHECK(st.m_played + st.m_culled + st.m_rejected == requests);
+        CHECK(st.m_culled > 0 && st.m_stolen > 0);
+    }
+}
+
+TEST_CASE(RejectsBadInitialize)
+{
+    SoundVoicePool pool;
+    bool threw = false;
+    try { pool.Initialize(nullptr, VOICES); } catch (const std::invalid_argument&) { threw = true; }
+    CHECK(threw);
+    threw = false;
+    try { InitPool(pool, SoundVoicePool::STEAL_OLDEST, SoundVoicePool::MAX_VOICES + 1); } catch (const std::invalid_argument&) { threw = true; }
+    CHECK(threw);
+    CHECK(pool.Play(0, 1.0f, 0.0f, SOUND_PRIO_NORMAL) == SoundVoicePool::INVALID_VOICE);
+}
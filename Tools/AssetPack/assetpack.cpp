@@ -0,0 +1,577 @@
+//--------------------------------------------------------------------------------------
+// File: assetpack.cpp
+//
+// Command-line tool that packs the game assets (sprites, sounds, fonts, shaders) into
+// the single .pak archive read by DX::AssetArchive. The layout is described in
+// Common/AssetArchiveFormat.h: a table of contents sorted by name hash, the names,
+// then every payload aligned, optionally compressed (XPRESS Huffman) per entry.
+//--------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <windows.h>
+#include <compressapi.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ppl.h>
+
+#include "AssetArchiveFormat.h"
+
+#pragma comment(lib, "cabinet.lib")
+
+using namespace DX::AssetPak;
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+
+    typedef public std::unique_ptr<void, handle_closer> ScopedHandle;
+
+    inline HANDLE safe_handle(HANDLE h) { return (h == INVALID_HANDLE_VALUE) ? 0 : h; }
+
+    struct find_closer { void operator()(HANDLE h) { assert(h != INVALID_HANDLE_VALUE); if (h) FindClose(h); } };
+
+    typedef public std::unique_ptr<void, find_closer> ScopedFindHandle;
+
+    struct compressor_closer { void operator()(void* h) { if (h) CloseCompressor(static_cast<COMPRESSOR_HANDLE>(h)); } };
+
+    typedef public std::unique_ptr<void, compressor_closer> ScopedCompressor;
+}
+
+#define ALIGNUP(a, b) \
+    ((((a) + ((b) - 1)) / (b)) * (b))
+
+enum OPTIONS
+{
+    OPT_RECURSIVE = 1,
+    OPT_OUTPUTFILE,
+    OPT_ROOT,
+    OPT_ALIGNMENT,
+    OPT_COMPRESS,
+    OPT_NOOVERWRITE,
+    OPT_NOLOGO,
+    OPT_MAX
+};
+
+static_assert(OPT_MAX <= 32, "dwOptions is a DWORD bitfield");
+
+struct SConversion
+{
+    wchar_t szSrc[MAX_PATH];
+};
+
+struct SValue
+{
+    LPCWSTR pName;
+    DWORD dwValue;
+};
+
+struct AssetFile
+{
+    std::wstring name;          // normalized, relative to the root
+    uint64_t hash;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> compressed;
+    bool loaded;
+
+    AssetFile() : hash(0), loaded(false) {}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+const SValue g_pOptions [] =
+{
+    { L"r",         OPT_RECURSIVE },
+    { L"o",         OPT_OUTPUTFILE },
+    { L"root",      OPT_ROOT },
+    { L"a",         OPT_ALIGNMENT },
+    { L"z",         OPT_COMPRESS },
+    { L"n",         OPT_NOOVERWRITE },
+    { L"nologo",    OPT_NOLOGO },
+    { nullptr,      0 }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    DWORD LookupByName(const wchar_t *pName, const SValue *pArray)
+    {
+        while (pArray->pName)
+        {
+            if (!_wcsicmp(pName, pArray->pName))
+                return pArray->dwValue;
+
+            pArray++;
+        }
+
+        return 0;
+    }
+
+    void SearchForFiles(const wchar_t* path, std::list<SConversion>& files, bool recursive)
+    {
+        // Process files
+        WIN32_FIND_DATA findData = {};
+        ScopedFindHandle hFile(safe_handle(FindFirstFileExW(path,
+            FindExInfoBasic, &findData,
+            FindExSearchNameMatch, nullptr,
+            FIND_FIRST_EX_LARGE_FETCH)));
+        if (hFile)
+        {
+            for (;;)
+            {
+                if (!(findData.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_DIRECTORY)))
+                {
+                    wchar_t drive[_MAX_DRIVE] = {};
+                    wchar_t dir[_MAX_DIR] = {};
+                    _wsplitpath_s(path, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0);
+
+                    SConversion conv;
+                    _wmakepath_s(conv.szSrc, drive, dir, findData.cFileName, nullptr);
+                    files.push_back(conv);
+                }
+
+                if (!FindNextFile(hFile.get(), &findData))
+                    break;
+            }
+        }
+
+        // Process directories
+        if (recursive)
+        {
+            wchar_t searchDir[MAX_PATH] = {};
+            {
+                wchar_t drive[_MAX_DRIVE] = {};
+                wchar_t dir[_MAX_DIR] = {};
+                _wsplitpath_s(path, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0);
+                _wmakepath_s(searchDir, drive, dir, L"*", nullptr);
+            }
+
+            hFile.reset(safe_handle(FindFirstFileExW(searchDir,
+                FindExInfoBasic, &findData,
+                FindExSearchLimitToDirectories, nullptr,
+                FIND_FIRST_EX_LARGE_FETCH)));
+            if (!hFile)
+                return;
+
+            for (;;)
+            {
+                if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    if (findData.cFileName[0] != L'.')
+                    {
+                        wchar_t subdir[MAX_PATH] = {};
+
+                        {
+                            wchar_t drive[_MAX_DRIVE] = {};
+                            wchar_t dir[_MAX_DIR] = {};
+                            wchar_t fname[_MAX_FNAME] = {};
+                            wchar_t ext[_MAX_FNAME] = {};
+                            _wsplitpath_s(path, drive, dir, fname, ext);
+                            wcscat_s(dir, findData.cFileName);
+                            _wmakepath_s(subdir, drive, dir, fname, ext);
+                        }
+
+                        SearchForFiles(subdir, files, recursive);
+                    }
+                }
+
+                if (!FindNextFile(hFile.get(), &findData))
+                    break;
+            }
+        }
+    }
+
+    void PrintLogo()
+    {
+        wprintf(L"SpookyAdulthood Asset Pack Tool\n");
+#ifdef _DEBUG
+        wprintf(L"*** Debug build ***\n");
+#endif
+        wprintf(L"\n");
+    }
+
+    void PrintUsage()
+    {
+        PrintLogo();
+
+        wprintf(L"Usage: assetpack <options> <files>\n");
+        wprintf(L"\n");
+        wprintf(L"   -r                  wildcard filename search is recursive\n");
+        wprintf(L"   -o <filename>       output filename\n");
+        wprintf(L"   -root <folder>      entries are named relative to this folder (the game\n");
+        wprintf(L"                       install folder), files outside it by their file name\n");
+        wprintf(L"   -a <bytes>          payload alignment, power of 2 (default %u)\n", DEFAULT_ALIGNMENT);
+        wprintf(L"   -z                  compress the entries that shrink by at least 1/8\n");
+        wprintf(L"   -n                  do not overwrite output\n");
+        wprintf(L"   -nologo             suppress copyright message\n");
+        wprintf(L"\n");
+        wprintf(L"   e.g. assetpack -z -root . -o assets\\assets.pak assets\\sounds\\*.wav assets\\sprites\\*.png\n");
+    }
+
+    std::wstring FullPath(const wchar_t* path)
+    {
+        wchar_t full[MAX_PATH] = {};
+        if (!GetFullPathNameW(path, MAX_PATH, full, nullptr))
+            return std::wstring(path);
+        return std::wstring(full);
+    }
+
+    // Name inside the archive: relative to the root when the file lives under it
+    std::wstring EntryName(const std::wstring& fullPath, const std::wstring& root)
+    {
+        if (!root.empty() && fullPath.size() > root.size() && _wcsnicmp(fullPath.c_str(), root.c_str(), root.size()) == 0)
+            return NormalizeName(fullPath.substr(root.size()));
+
+        wchar_t fname[_MAX_FNAME] = {};
+        wchar_t ext[_MAX_EXT] = {};
+        _wsplitpath_s(fullPath.c_str(), nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
+        return NormalizeName(std::wstring(fname) + ext);
+    }
+
+    bool ReadWholeFile(const wchar_t* path, std::vector<uint8_t>& data)
+    {
+        ScopedHandle hFile(safe_handle(CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+        if (!hFile)
+            return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(hFile.get(), &size) || size.HighPart > 0)
+            return false;
+
+        data.resize(size.LowPart);
+        DWORD read = 0;
+        return !size.LowPart || (ReadFile(hFile.get(), data.data(), size.LowPart, &read, nullptr) && read == size.LowPart);
+    }
+
+    // Keeps the compressed copy only when it saves at least 1/8, small and already packed
+    // formats (png) stay stored so the game can read them straight from the mapping
+    void CompressEntry(AssetFile& asset)
+    {
+        asset.compressed.clear();
+        if (asset.data.size() < 256)
+            return;
+
+        COMPRESSOR_HANDLE handle = nullptr;
+        if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, nullptr, &handle))
+            return;
+        ScopedCompressor compressor(handle);
+
+        SIZE_T bound = 0;
+        Compress(handle, asset.data.data(), asset.data.size(), nullptr, 0, &bound);
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || !bound)
+            return;
+
+        std::vector<uint8_t> out(bound);
+        SIZE_T written = 0;
+        if (!Compress(handle, asset.data.data(), asset.data.size(), out.data(), out.size(), &written))
+            return;
+
+        if (written <= asset.data.size() - asset.data.size() / 8)
+        {
+            out.resize(written);
+            asset.compressed.swap(out);
+        }
+    }
+
+    bool WriteAll(HANDLE hFile, const void* data, size_t size)
+    {
+        DWORD written = 0;
+        return !size || (WriteFile(hFile, data, static_cast<DWORD>(size), &written, nullptr) && written == size);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    // Parameters and defaults
+    wchar_t szOutputFile[MAX_PATH] = { 0 };
+    wchar_t szRoot[MAX_PATH] = { 0 };
+    uint32_t alignment = DEFAULT_ALIGNMENT;
+
+    // Process command line
+    DWORD dwOptions = 0;
+    std::list<SConversion> conversion;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        PWSTR pArg = argv[iArg];
+
+        if (('-' == pArg[0]) || ('/' == pArg[0]))
+        {
+            pArg++;
+            PWSTR pValue;
+
+            for (pValue = pArg; *pValue && (':' != *pValue); pValue++);
+
+            if (*pValue)
+                *pValue++ = 0;
+
+            DWORD dwOption = LookupByName(pArg, g_pOptions);
+
+            if (!dwOption || (dwOptions & (1 << dwOption)))
+            {
+                PrintUsage();
+                return 1;
+            }
+
+            dwOptions |= 1 << dwOption;
+
+            // Handle options with additional value parameter
+            switch (dwOption)
+            {
+            case OPT_OUTPUTFILE:
+            case OPT_ROOT:
+            case OPT_ALIGNMENT:
+                if (!*pValue)
+                {
+                    if ((iArg + 1 >= argc))
+                    {
+                        PrintUsage();
+                        return 1;
+                    }
+
+                    iArg++;
+                    pValue = argv[iArg];
+                }
+                break;
+            }
+
+            switch (dwOption)
+            {
+            case OPT_OUTPUTFILE:
+                wcscpy_s(szOutputFile, MAX_PATH, pValue);
+                break;
+
+            case OPT_ROOT:
+                wcscpy_s(szRoot, MAX_PATH, pValue);
+                break;
+
+            case OPT_ALIGNMENT:
+                if (swscanf_s(pValue, L"%u", &alignment) != 1 || !alignment || (alignment & (alignment - 1)) || alignment > MAX_ALIGNMENT)
+                {
+                    wprintf(L"Invalid value specified with -a (%ls), must be a power of 2 up to %u\n", pValue, MAX_ALIGNMENT);
+                    return 1;
+                }
+                break;
+            }
+        }
+        else if (wcspbrk(pArg, L"?*") != nullptr)
+        {
+            size_t count = conversion.size();
+            SearchForFiles(pArg, conversion, (dwOptions & (1 << OPT_RECURSIVE)) != 0);
+            if (conversion.size() <= count)
+            {
+                wprintf(L"No matching files found for %ls\n", pArg);
+                return 1;
+            }
+        }
+        else
+        {
+            SConversion conv;
+            wcscpy_s(conv.szSrc, MAX_PATH, pArg);
+
+            conversion.push_back(conv);
+        }
+    }
+
+    if (conversion.empty())
+    {
+        wprintf(L"ERROR: Need at least 1 file to build an archive\n\n");
+        PrintUsage();
+        return 0;
+    }
+
+    if (!*szOutputFile)
+    {
+        wprintf(L"ERROR: Need to specify output file via -o\n");
+        return 1;
+    }
+
+    if (~dwOptions & (1 << OPT_NOLOGO))
+        PrintLogo();
+
+    std::wstring root;
+    if (*szRoot)
+    {
+        root = FullPath(szRoot);
+        if (!root.empty() && root.back() != L'\\')
+            root.push_back(L'\\');
+    }
+
+    // Gather and compress, every file is independent
+    std::vector<AssetFile> assets(conversion.size());
+    std::vector<const SConversion*> sources;
+    for (auto& conv : conversion)
+        sources.push_back(&conv);
+
+    const bool compress = (dwOptions & (1 << OPT_COMPRESS)) != 0;
+    concurrency::parallel_for(size_t(0), sources.size(), [&](size_t i)
+    {
+        AssetFile& asset = assets[i];
+        asset.name = EntryName(FullPath(sources[i]->szSrc), root);
+        asset.hash = HashName(asset.name.c_str(), asset.name.size());
+        asset.loaded = ReadWholeFile(sources[i]->szSrc, asset.data);
+        if (asset.loaded && compress)
+            CompressEntry(asset);
+    });
+
+    for (size_t i = 0; i < assets.size(); ++i)
+    {
+        if (!assets[i].loaded)
+        {
+            wprintf(L"ERROR: Failed to read %ls\n", sources[i]->szSrc);
+            return 1;
+        }
+        if (assets[i].name.size() > UINT16_MAX)
+        {
+            wprintf(L"ERROR: Entry name too long %ls\n", sources[i]->szSrc);
+            return 1;
+        }
+    }
+
+    // The reader binary searches the hashes, equal hashes are told apart by name
+    std::sort(assets.begin(), assets.end(), [](const AssetFile& a, const AssetFile& b)
+    {
+        return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+    });
+
+    for (size_t i = 1; i < assets.size(); ++i)
+    {
+        if (assets[i].name == assets[i - 1].name)
+        {
+            wprintf(L"ERROR: %ls was given more than once\n", assets[i].name.c_str());
+            return 1;
+        }
+    }
+
+    if (assets.size() > UINT32_MAX)
+    {
+        wprintf(L"ERROR: Too many entries (%Iu)\n", assets.size());
+        return 1;
+    }
+
+    // Layout
+    Header header = {};
+    header.m_magic = MAGIC;
+    header.m_version = VERSION;
+    header.m_entryCount = static_cast<uint32_t>(assets.size());
+    header.m_alignment = alignment;
+    header.m_tocOffset = sizeof(Header);
+
+    std::vector<Entry> toc(assets.size());
+    std::vector<wchar_t> names;
+    for (size_t i = 0; i < assets.size(); ++i)
+    {
+        Entry& e = toc[i];
+        e.m_hash = assets[i].hash;
+        e.m_nameOffset = static_cast<uint32_t>(names.size());
+        e.m_nameLength = static_cast<uint16_t>(assets[i].name.size());
+        names.insert(names.end(), assets[i].name.begin(), assets[i].name.end());
+    }
+    header.m_namesOffset = header.m_tocOffset + toc.size() * sizeof(Entry);
+    header.m_namesCount = names.size();
+
+    uint64_t offset = header.m_namesOffset + names.size() * sizeof(wchar_t);
+    uint64_t totalSize = 0, totalStored = 0;
+    size_t compressedCount = 0;
+    for (size_t i = 0; i < assets.size(); ++i)
+    {
+        Entry& e = toc[i];
+        const AssetFile& asset = assets[i];
+        const bool packed = !asset.compressed.empty();
+        offset = ALIGNUP(offset, alignment);
+        e.m_offset = offset;
+        e.m_size = asset.data.size();
+        e.m_storedSize = packed ? asset.compressed.size() : asset.data.size();
+        e.m_compression = packed ? COMPRESSION_XPRESS_HUFF : COMPRESSION_NONE;
+        offset += e.m_storedSize;
+        totalSize += e.m_size;
+        totalStored += e.m_storedSize;
+        if (packed)
+            ++compressedCount;
+    }
+    header.m_fileSize = offset;
+
+    for (size_t i = 0; i < assets.size(); ++i)
+    {
+        wprintf(L"  %-48ls %10llu -> %10llu %ls\n", assets[i].name.c_str(), toc[i].m_size, toc[i].m_storedSize,
+            toc[i].m_compression != COMPRESSION_NONE ? L"(xpress)" : L"");
+    }
+
+    // Write archive
+    wprintf(L"writing archive %ls w/ %Iu entries, %Iu compressed, %llu -> %llu bytes, aligned to %u\n",
+        szOutputFile, assets.size(), compressedCount, totalSize, header.m_fileSize, alignment);
+
+    if (dwOptions & (1 << OPT_NOOVERWRITE))
+    {
+        if (GetFileAttributesW(szOutputFile) != INVALID_FILE_ATTRIBUTES)
+        {
+            wprintf(L"ERROR: Output file %ls already exists!\n", szOutputFile);
+            return 1;
+        }
+    }
+
+    ScopedHandle hFile(safe_handle(CreateFileW(szOutputFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr)));
+    if (!hFile)
+    {
+        wprintf(L"ERROR: Failed opening output file %ls, %u\n", szOutputFile, GetLastError());
+        return 1;
+    }
+
+    static const uint8_t s_padding[MAX_ALIGNMENT] = {};
+    bool ok = WriteAll(hFile.get(), &header, sizeof(header))
+           && WriteAll(hFile.get(), toc.data(), toc.size() * sizeof(Entry))
+           && WriteAll(hFile.get(), names.data(), names.size() * sizeof(wchar_t));
+    uint64_t written = header.m_namesOffset + names.size() * sizeof(wchar_t);
+    for (size_t i = 0; ok && i < assets.size(); ++i)
+    {
+        const AssetFile& asset = assets[i];
+        ok = WriteAll(hFile.get(), s_padding, static_cast<size_t>(toc[i].m_offset - written));
+        const std::vector<uint8_t>& payload = asset.compressed.empty() ? asset.data : asset.compressed;
+        ok = ok && WriteAll(hFile.get(), payload.data(), payload.size());
+        written = toc[i].m_offset + toc[i].m_storedSize;
+    }
+
+    if (!ok)
+    {
+        wprintf(L"ERROR: Failed writing %ls, %u\n", szOutputFile, GetLastError());
+        hFile.reset();
+        DeleteFileW(szOutputFile);
+        return 1;
+    }
+
+    wprintf(L"  payloads %llu -> %llu bytes (%.1f%%)\n", totalSize, totalStored, totalSize ? 100.0 * totalStored / totalSize : 100.0);
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#if defined(__cplusplus_winrt)
+
 #pragma warning(push)
 #pragma warning(disable : 4005)
 #define WIN32_LEAN_AND_MEAN
@@ -32,11 +34,16 @@
 #include <utility>
 #include <map>
 #include <ppl.h>
+#include <ppltasks.h>
 #include <atomic>
 #include <concurrent_vector.h>
 
 // game
 #include "Common/StepTimer.h"
+#include "Common/RandomProvider.h"
+#include "Common/MemoryTracker.h"
+#include "Common/FrameAllocator.h"
+#include "Common/Profiler.h"
 
 // directxtk
 
@@ -59,11 +66,7 @@
 
 using namespace DirectX;
 
-template<typename T, typename R, typename K>
-inline T Clamp(const T& v, const R& _min, const K& _max)
-{
-    return v < _min ? _min : (v>_max?_max:v);
-}
+#include "Common/MathHelpers.h"
 
 // Calls the provided work function and returns the number of milliseconds 
 // that it takes to call that function.
@@ -75,145 +78,55 @@ inline __int64 time_call(Function&& f)
     return GetTickCount64() - begin;
 }
 
-
-inline XMFLOAT3 XM3Sub(const XMFLOAT3& a, const XMFLOAT3& b)
-{
-    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
-}
-
-inline void XM3Sub_inplace(XMFLOAT3& a, const XMFLOAT3& b)
-{
-    a.x -= b.x;
-    a.y -= b.y;
-    a.z -= b.z;
-}
-
-inline XMFLOAT3 XM3Mul(const XMFLOAT3& a, float s)
-{
-    return XMFLOAT3(a.x*s, a.y*s, a.z*s);
-}
-
-inline void XM3Mul_inplace(XMFLOAT3& a, float s)
-{
-    a.x *= s; a.y *= s; a.z *= s;
-}
-
-inline float XM3LenSq(const XMFLOAT3& a, const XMFLOAT3& b)
-{
-    const float xyz[3] = { a.x - b.x, a.y - b.y, a.z - b.z };
-    return xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2];
-}
-
-inline float XM3LenSq(const XMFLOAT3& a)
-{
-    return a.x*a.x + a.y*a.y + a.z*a.z;
-}
-
-inline XMFLOAT3 XM3Add(const XMFLOAT3& a, const XMFLOAT3& b)
-{
-    return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z);
-}
-
-inline void XM3Add_inplace(XMFLOAT3& a, const XMFLOAT3& b)
-{
-    a.x += b.x; a.y += b.y; a.z += b.z;
-}
-
-inline float XM3Len(const XMFLOAT3& a)
-{
-    return sqrt(XM3LenSq(a));
-}
-
-inline void XM3Normalize_inplace(XMFLOAT3& a)
-{
-    const float il = 1.0f / XM3Len(a);
-    a.x *= il;
-    a.y *= il;
-    a.z *= il;
-}
-
-inline XMFLOAT3 XM3Normalize(const XMFLOAT3& a)
-{
-    XMFLOAT3 _a = a;
-    XM3Normalize_inplace(_a);
-    return _a;
-}
-
-// ret a + b*c
-inline XMFLOAT3 XM3Mad(const XMFLOAT3& a, const XMFLOAT3& b, float c)
-{
-    return XMFLOAT3(a.x + b.x*c, a.y + b.y*c, a.z + b.z*c);
-}
-
-inline void XM3Mad_inplace(XMFLOAT3& a, const XMFLOAT3& b, float c)
-{
-    a.x += b.x*c; a.y += b.y*c; a.z += b.z*c;
-}
-
-inline XMFLOAT3 XM3Neg(const XMFLOAT3& a)
-{
-    return XMFLOAT3(-a.x, -a.y, -a.z);
-}
-
-inline XMFLOAT3 XM3Cross(const XMFLOAT3& a, const XMFLOAT3& b)
-{
-    XMVECTOR v1 = XMLoadFloat3(&a);
-    XMVECTOR v2 = XMLoadFloat3(&b);
-    XMFLOAT3 r;
-    XMStoreFloat3(&r, XMVector3Cross(v1, v2));
-    return r;
-}
-
-inline float XM3Dot(const XMFLOAT3& a, const XMFLOAT3& b)
-{
-    return a.x*b.x + a.y*b.y + a.z*b.z;
-}
-
-inline bool operator ==(const DirectX::XMUINT2& a, const DirectX::XMUINT2& b)
-{
-    return a.x == b.x && a.y == b.y;
-}
-
-inline bool XM3Eq(const XMFLOAT3& a, const XMFLOAT3& b, float EPSI=0.0001f)
+// Same than time_call but in microseconds (QPC), for the benchmarks
+template <class Function>
+inline __int64 time_call_us(Function&& f)
 {
-    return fabs(a.x - b.x) < EPSI && fabs(a.y - b.y) < EPSI && fabs(a.z - b.z) < EPSI;
+    LARGE_INTEGER freq, begin, end;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&begin);
+    f();
+    QueryPerformanceCounter(&end);
+    return (end.QuadPart - begin.QuadPart) * 1000000 / freq.QuadPart;
 }
 
-inline bool XM2Eq(const XMFLOAT2& a, const XMFLOAT2& b, float EPSI = 0.0001f)
-{
-    return fabs(a.x - b.x) < EPSI && fabs(a.y - b.y) < EPSI;
-}
+#else
 
-inline XMFLOAT2 XM2Neg(const XMFLOAT2& a)
-{
-    return XMFLOAT2(-a.x, -a.y);
-}
+// Outside the C++/CX app only the device independent sources build (RandomProvider,
+// LevelBSP, audio and collision math, the frame arena), for the tests under Tests/.
+// parallel_invoke stands in for PPL's one
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
 
-inline const XMFLOAT3& XM3Zero()
-{
-    static XMFLOAT3 g_zero(0, 0, 0);
-    return g_zero;
-}
+// what DirectXMath selects on x86/x64, so the SIMD paths are the ones tested
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define _XM_SSE_INTRINSICS_
+#endif
 
-inline const XMFLOAT3& XM3Up()
-{
-    static XMFLOAT3 g_up(0, 1, 0);
-    return g_up;
-}
+#define __cdecl
 
-inline const XMFLOAT4& XM4Zero()
+namespace concurrency
 {
-    static XMFLOAT4 g_zero(0, 0, 0, 0);
-    return g_zero;
+    template<typename F1, typename F2>
+    void parallel_invoke(const F1& f1, const F2& f2)
+    {
+        auto second = std::async(std::launch::async, f2);
+        f1();
+        second.get();
+    }
 }
 
-inline XMFLOAT2 XM2Mul(const XMFLOAT2& v, float s)
-{
-    return XMFLOAT2(v.x*s, v.y*s);
-}
+// the math helpers, for the tests that get the DirectXMath stand-in (spooky_sdk_compat)
+#if defined(__has_include)
+#if __has_include(<DirectXMath.h>)
+#include "Common/MathHelpers.h"
+#endif
+#endif
 
-inline void XM2Mul_inplace(XMFLOAT2& v, float s)
-{
-    v.x *= s;
-    v.y *= s;
-}
\ No newline at end of file
+#endif